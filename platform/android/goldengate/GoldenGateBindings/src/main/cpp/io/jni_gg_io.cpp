@@ -9,22 +9,37 @@
 #include "xp/loop/gg_loop.h"
 #include "xp/common/gg_port.h"
 #include "xp/common/gg_memory.h"
+#include "xp/gattlink/gg_gattlink_generic_client.h"
 
 extern "C" {
 
 //----------------------------------------------------------------------
 GG_Result
 TxSink_PutData(GG_DataSink *_self, GG_Buffer *data, const GG_BufferMetadata *metadata) {
-    GG_COMPILER_UNUSED(metadata);
     TxSink *self = GG_SELF(TxSink, GG_DataSink);
     if (self->receiver) {
         const jbyte *jbyteData = (jbyte *) GG_Buffer_GetData(data);
         jsize dataSize = (jsize) GG_Buffer_GetDataSize(data);
         JNIEnv *env = Loop_GetJNIEnv();
         jbyteArray dataArray = env->NewByteArray(dataSize);
-        GG_Log_JNI("TxSink", "Calling into Java PutData callback");
         env->SetByteArrayRegion(dataArray, 0, dataSize, jbyteData);
-        env->CallVoidMethod(self->receiver, self->callback, dataArray);
+        if (metadata && metadata->type == GG_BUFFER_METADATA_TYPE_GATTLINK_FRAGMENTS) {
+            // a batch of packets crosses into Java in a single call, with the size of each packet
+            const GG_GattlinkFragmentsMetadata *fragments = (const GG_GattlinkFragmentsMetadata *) metadata;
+            jsize fragmentCount = (jsize) fragments->fragment_count;
+            jint fragmentSizes[GG_GENERIC_GATTLINK_CLIENT_MAX_BATCH_FRAGMENTS];
+            for (jsize i = 0; i < fragmentCount; i++) {
+                fragmentSizes[i] = fragments->fragment_sizes[i];
+            }
+            jintArray sizesArray = env->NewIntArray(fragmentCount);
+            env->SetIntArrayRegion(sizesArray, 0, fragmentCount, fragmentSizes);
+            GG_Log_JNI("TxSink", "Calling into Java PutFragments callback");
+            env->CallVoidMethod(self->receiver, self->fragments_callback, dataArray, sizesArray);
+            env->DeleteLocalRef(sizesArray);
+        } else {
+            GG_Log_JNI("TxSink", "Calling into Java PutData callback");
+            env->CallVoidMethod(self->receiver, self->callback, dataArray);
+        }
         env->DeleteLocalRef(dataArray);
         return GG_SUCCESS;
     }
@@ -62,10 +77,12 @@ Java_com_fitbit_goldengate_bindings_io_TxSink_create(
     const char *method = env->GetStringUTFChars(methodName, NULL);
     const char *signature = env->GetStringUTFChars(methodSignature, NULL);
     jmethodID callback = env->GetMethodID(clazz, method, signature);
+    jmethodID fragments_callback = env->GetMethodID(clazz, "putFragments", "([B[I)V");
     env->ReleaseStringUTFChars(methodName, method);
     env->ReleaseStringUTFChars(methodSignature, signature);
     GG_Log_JNI("TxSink", "Creating TxSink");
     sink->callback = callback;
+    sink->fragments_callback = fragments_callback;
     jobject thizz = env->NewGlobalRef(
             thiz); // This is required to have a jobject we can share across JNI calls.
     sink->receiver = thizz;
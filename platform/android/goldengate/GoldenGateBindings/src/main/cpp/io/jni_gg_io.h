@@ -11,6 +11,7 @@ struct TxSink {
     GG_IMPLEMENTS(GG_DataSink);
     jobject receiver;
     jmethodID callback;
+    jmethodID fragments_callback; // called with a batch of packets and their sizes
 };
 
 struct RxSource {
@@ -386,6 +386,7 @@ JNICALL Java_com_fitbit_goldengate_bindings_stack_Stack_create(
             .buffer_size = 0,
             .initial_max_fragment_size = GG_STACK_BUILDER_DEFAULT_GATTLINK_FRAGMENT_SIZE,
             .probe_config = &probeConfig,
+            .transport_batching = true, // the TxSink delivers batches to Java in one call
     };
     parameters[parameter_count].element_type = GG_STACK_ELEMENT_TYPE_GATTLINK;
     parameters[parameter_count].element_parameters = &gl_config;
@@ -44,6 +44,20 @@ class TxSink : NativeReference, Closeable {
         dataSubject.onNext(data)
     }
 
+    /**
+     * This should only be called from the JNI code and in tests. It delivers a batch of packets,
+     * sent back to back in [data], one at a time. [sizes] gives the size of each packet.
+     */
+    @VisibleForTesting
+    @Keep
+    fun putFragments(data: ByteArray, sizes: IntArray) {
+        var offset = 0
+        for (size in sizes) {
+            putData(data.copyOfRange(offset, offset + size))
+            offset += size
+        }
+    }
+
     override fun close() {
         destroy(thisPointer)
     }
@@ -40,4 +40,14 @@ class TxSinkTest : BaseTest() {
                 .test()
                 .assertValue { Arrays.equals(bytes, it) }
     }
+
+    @Test
+    fun testPutFragments() {
+        val observer = txSink.dataObservable.test()
+        txSink.putFragments(byteArrayOf(1, 2, 3, 4, 5), intArrayOf(2, 3))
+        observer
+                .assertValueCount(2)
+                .assertValueAt(0) { Arrays.equals(byteArrayOf(1, 2), it) }
+                .assertValueAt(1) { Arrays.equals(byteArrayOf(3, 4, 5), it) }
+    }
 }
@@ -99,7 +99,8 @@ internal class GattlinkParametersContainer {
                 tx_window: self.gattlinkParameters.txWindow ?? 0,
                 buffer_size: self.gattlinkParameters.bufferSize ?? 0,
                 initial_max_fragment_size: self.gattlinkParameters.initialMaxFragmentSize,
-                probe_config: self.probeConfig?.pointer
+                probe_config: self.probeConfig?.pointer,
+                transport_batching: false
             )
         )
     }
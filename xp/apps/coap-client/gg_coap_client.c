@@ -82,6 +82,7 @@ GetOptionName(uint32_t option_number)
         case GG_COAP_MESSAGE_OPTION_URI_HOST:       return "Uri-Host";
         case GG_COAP_MESSAGE_OPTION_ETAG:           return "ETag";
         case GG_COAP_MESSAGE_OPTION_IF_NONE_MATCH:  return "If-None-Match";
+        case GG_COAP_MESSAGE_OPTION_OBSERVE:        return "Observe";
         case GG_COAP_MESSAGE_OPTION_URI_PORT:       return "Uri-Port";
         case GG_COAP_MESSAGE_OPTION_LOCATION_PATH:  return "Location-Path";
         case GG_COAP_MESSAGE_OPTION_URI_PATH:       return "Uri-Path";
@@ -96,6 +97,8 @@ GetOptionName(uint32_t option_number)
         case GG_COAP_MESSAGE_OPTION_SIZE2:          return "Size2";
         case GG_COAP_MESSAGE_OPTION_BLOCK1:         return "Block1";
         case GG_COAP_MESSAGE_OPTION_BLOCK2:         return "Block2";
+        case GG_COAP_MESSAGE_OPTION_QBLOCK1:        return "Q-Block1";
+        case GG_COAP_MESSAGE_OPTION_QBLOCK2:        return "Q-Block2";
         case GG_COAP_MESSAGE_OPTION_START_OFFSET:   return "Start-Offset";
         case GG_COAP_MESSAGE_OPTION_EXTENDED_ERROR: return "Extended-Error";
         default:                                    return "";
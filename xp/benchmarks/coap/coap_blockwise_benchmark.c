@@ -0,0 +1,422 @@
+/**
+ * @file
+ * @brief CoAP blockwise transfer benchmark over a simulated BLE link
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ * Two CoAP endpoints are connected through a simulated BLE link, carrying one CoAP
+ * datagram per link packet (as when the link MTU is large enough for a whole block),
+ * and a resource is fetched with a blockwise GET for each combination of transfer
+ * mode and link characteristics:
+ *   block2: classic BLOCK2 transfer, one block request at a time
+ *   block2_pipelined: classic BLOCK2 transfer, with several block requests in flight
+ *   qblock2: Q-Block2 transfer (RFC 9177), with payload sets sent as NON responses
+ * Time is virtual (the timer scheduler's time is advanced directly from one timer to
+ * the next), so all the results except the CPU time are deterministic.
+ *
+ * Each run prints one JSON object on its own line, with:
+ *   goodput_bytes_per_second: payload bytes delivered per second of virtual time
+ *   client_packets/server_packets: datagrams sent by each side
+ *   cpu_ms_per_mb: CPU time used by the whole simulation per MB of payload delivered
+ *
+ * Usage: gg-coap-blockwise-benchmark [<name-filter>]
+ * (the filter is matched against "<mode>/<scenario>")
+ *
+ * Logging is turned off unless GG_LOG_CONFIG is set, so that it doesn't skew the
+ * CPU time or get mixed with the results on the console.
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_memory.h"
+#include "xp/common/gg_utils.h"
+#include "xp/common/gg_timer.h"
+#include "xp/common/gg_io.h"
+#include "xp/module/gg_module.h"
+#include "xp/coap/gg_coap.h"
+#include "xp/coap/gg_coap_blockwise.h"
+#include "xp/benchmarks/common/gg_simulated_ble_link.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_PAYLOAD_SIZE      65536
+#define BENCHMARK_BLOCK_SIZE        1024
+#define BENCHMARK_BLOCKS_IN_FLIGHT  4
+#define BENCHMARK_ACK_TIMEOUT       500       // ms, for all modes
+#define BENCHMARK_MAX_RESEND_COUNT  8
+#define BENCHMARK_MAX_DURATION      600000    // give up after this much virtual time, in ms
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef enum {
+    TRANSFER_MODE_BLOCK2,
+    TRANSFER_MODE_BLOCK2_PIPELINED,
+    TRANSFER_MODE_QBLOCK2
+} TransferMode;
+
+typedef struct {
+    const char*               name;
+    GG_SimulatedBleLinkConfig link_config;
+} Scenario;
+
+//----------------------------------------------------------------------
+// Block source that returns a fixed size payload
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapBlockSource);
+} PayloadSource;
+
+//----------------------------------------------------------------------
+// Request handler that serves the payload with BLOCK2 or Q-Block2
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapRequestHandler);
+
+    bool                         qblock;
+    GG_CoapBlockwiseServerHelper helper;
+    GG_CoapBlockSource*          block_source;
+} PayloadHandler;
+
+//----------------------------------------------------------------------
+// Blockwise listener that records when the transfer ends
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapBlockwiseResponseListener);
+
+    GG_TimerScheduler* timer_scheduler;
+    size_t             byte_count;
+    bool               done;
+    GG_Result          error;
+    uint32_t           end_time;
+} TransferListener;
+
+/*----------------------------------------------------------------------
+|   globals
++---------------------------------------------------------------------*/
+static const char* const TransferModeNames[] = {
+    "block2",
+    "block2_pipelined",
+    "qblock2"
+};
+
+// the MTU is large enough for a block and its CoAP header
+static const Scenario Scenarios[] = {
+    // name                  mtu   int  pkt  queue loss burst reorder seed
+    { "ideal_ci15",        { 1152, 15,  4,   16,   0,   1,    0,      1 } },
+    { "ideal_ci50_ppi2",   { 1152, 50,  2,   16,   0,   1,    0,      1 } },
+    { "loss1pct_ci15",     { 1152, 15,  4,   16,   10,  1,    0,      1 } },
+    { "loss5pct_ci15",     { 1152, 15,  4,   16,   50,  1,    0,      1 } },
+    { "burst3_ci15",       { 1152, 15,  4,   16,   10,  3,    0,      1 } },
+    { "reorder2pct_ci15",  { 1152, 15,  4,   16,   0,   1,    20,     1 } }
+};
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+
+//----------------------------------------------------------------------
+static GG_Result
+PayloadSource_GetDataSize(GG_CoapBlockSource* _self, size_t offset, size_t* data_size, bool* more)
+{
+    GG_COMPILER_UNUSED(_self);
+
+    return GG_CoapMessageBlockInfo_AdjustAndGetChunkSize(offset, data_size, more, BENCHMARK_PAYLOAD_SIZE);
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+PayloadSource_GetData(GG_CoapBlockSource* _self, size_t offset, size_t data_size, void* data)
+{
+    GG_COMPILER_UNUSED(_self);
+
+    memset(data, (uint8_t)(offset / BENCHMARK_BLOCK_SIZE), data_size);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(PayloadSource, GG_CoapBlockSource) {
+    .GetDataSize = PayloadSource_GetDataSize,
+    .GetData     = PayloadSource_GetData
+};
+
+//----------------------------------------------------------------------
+static GG_Result
+PayloadHandler_OnRequest(GG_CoapRequestHandler*   _self,
+                         GG_CoapEndpoint*         endpoint,
+                         const GG_CoapMessage*    request,
+                         GG_CoapResponder*        responder,
+                         const GG_BufferMetadata* transport_metadata,
+                         GG_CoapMessage**         response)
+{
+    PayloadHandler* self = GG_SELF(PayloadHandler, GG_CoapRequestHandler);
+    GG_COMPILER_UNUSED(responder);
+
+    if (self->qblock) {
+        GG_Result result = GG_CoapBlockwiseServerHelper_OnRequest(&self->helper, request, NULL);
+        if (result != GG_SUCCESS) {
+            return result;
+        }
+
+        return GG_CoapBlockwiseServerHelper_CreateResponseFromBlockSource(&self->helper,
+                                                                          endpoint,
+                                                                          request,
+                                                                          transport_metadata,
+                                                                          GG_COAP_MESSAGE_CODE_CONTENT,
+                                                                          NULL, 0,
+                                                                          self->block_source,
+                                                                          response);
+    }
+
+    GG_CoapMessageBlockInfo block_info;
+    GG_Result result = GG_CoapMessage_GetBlockInfo(request,
+                                                   GG_COAP_MESSAGE_OPTION_BLOCK2,
+                                                   &block_info,
+                                                   BENCHMARK_BLOCK_SIZE);
+    if (GG_FAILED(result)) {
+        return GG_COAP_MESSAGE_CODE_BAD_OPTION;
+    }
+
+    return GG_CoapEndpoint_CreateBlockwiseResponseFromBlockSource(endpoint,
+                                                                  request,
+                                                                  GG_COAP_MESSAGE_CODE_CONTENT,
+                                                                  NULL, 0,
+                                                                  self->block_source,
+                                                                  GG_COAP_MESSAGE_OPTION_BLOCK2,
+                                                                  &block_info,
+                                                                  response);
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(PayloadHandler, GG_CoapRequestHandler) {
+    .OnRequest = PayloadHandler_OnRequest
+};
+
+//----------------------------------------------------------------------
+static void
+TransferListener_OnResponseBlock(GG_CoapBlockwiseResponseListener* _self,
+                                 GG_CoapMessageBlockInfo*          block_info,
+                                 GG_CoapMessage*                   block_message)
+{
+    TransferListener* self = GG_SELF(TransferListener, GG_CoapBlockwiseResponseListener);
+
+    self->byte_count += GG_CoapMessage_GetPayloadSize(block_message);
+    if (!block_info->more) {
+        self->done     = true;
+        self->end_time = GG_TimerScheduler_GetTime(self->timer_scheduler);
+    }
+}
+
+//----------------------------------------------------------------------
+static void
+TransferListener_OnError(GG_CoapBlockwiseResponseListener* _self, GG_Result error, const char* message)
+{
+    TransferListener* self = GG_SELF(TransferListener, GG_CoapBlockwiseResponseListener);
+    GG_COMPILER_UNUSED(message);
+
+    self->done     = true;
+    self->error    = error;
+    self->end_time = GG_TimerScheduler_GetTime(self->timer_scheduler);
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(TransferListener, GG_CoapBlockwiseResponseListener) {
+    .OnResponseBlock = TransferListener_OnResponseBlock,
+    .OnError         = TransferListener_OnError
+};
+
+//----------------------------------------------------------------------
+// Create an endpoint and connect it to one side of the link
+//----------------------------------------------------------------------
+static GG_Result
+CreateEndpoint(GG_TimerScheduler*      timer_scheduler,
+               GG_SimulatedBleLink*    link,
+               GG_SimulatedBleLinkSide side,
+               GG_CoapEndpoint**       endpoint)
+{
+    GG_Result result = GG_CoapEndpoint_Create(timer_scheduler, NULL, NULL, endpoint);
+    if (GG_FAILED(result)) return result;
+
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(*endpoint),
+                              GG_SimulatedBleLink_GetSideAsDataSink(link, side));
+    GG_DataSource_SetDataSink(GG_SimulatedBleLink_GetSideAsDataSource(link, side),
+                              GG_CoapEndpoint_AsDataSink(*endpoint));
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+RunScenario(TransferMode mode, const Scenario* scenario)
+{
+    GG_TimerScheduler*   timer_scheduler = NULL;
+    GG_SimulatedBleLink* link            = NULL;
+    GG_CoapEndpoint*     client          = NULL;
+    GG_CoapEndpoint*     server          = NULL;
+    static PayloadSource    payload_source;
+    static PayloadHandler   handler;
+    static TransferListener listener;
+
+    GG_Result result = GG_TimerScheduler_Create(&timer_scheduler);
+    if (GG_FAILED(result)) goto end;
+    result = GG_SimulatedBleLink_Create(timer_scheduler, &scenario->link_config, &link);
+    if (GG_FAILED(result)) goto end;
+    result = CreateEndpoint(timer_scheduler, link, GG_SIMULATED_BLE_LINK_SIDE_A, &client);
+    if (GG_FAILED(result)) goto end;
+    result = CreateEndpoint(timer_scheduler, link, GG_SIMULATED_BLE_LINK_SIDE_B, &server);
+    if (GG_FAILED(result)) goto end;
+
+    // setup the server
+    GG_SET_INTERFACE(&payload_source, PayloadSource, GG_CoapBlockSource);
+    memset(&handler, 0, sizeof(handler));
+    GG_SET_INTERFACE(&handler, PayloadHandler, GG_CoapRequestHandler);
+    handler.qblock       = (mode == TRANSFER_MODE_QBLOCK2);
+    handler.block_source = GG_CAST(&payload_source, GG_CoapBlockSource);
+    GG_CoapBlockwiseServerHelper_Init(&handler.helper, GG_COAP_MESSAGE_OPTION_QBLOCK2, BENCHMARK_BLOCK_SIZE);
+    result = GG_CoapEndpoint_RegisterRequestHandler(server,
+                                                    "payload",
+                                                    GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                                    GG_CAST(&handler, GG_CoapRequestHandler));
+    if (GG_FAILED(result)) goto end;
+
+    // start the transfer
+    memset(&listener, 0, sizeof(listener));
+    GG_SET_INTERFACE(&listener, TransferListener, GG_CoapBlockwiseResponseListener);
+    listener.timer_scheduler = timer_scheduler;
+    GG_CoapMessageOptionParam options[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "payload")
+    };
+    GG_CoapClientParameters client_parameters = {
+        .ack_timeout      = BENCHMARK_ACK_TIMEOUT,
+        .max_resend_count = BENCHMARK_MAX_RESEND_COUNT
+    };
+    clock_t cpu_start = clock();
+    if (mode == TRANSFER_MODE_QBLOCK2) {
+        result = GG_CoapEndpoint_SendQBlockRequest(client,
+                                                   GG_COAP_METHOD_GET,
+                                                   options,
+                                                   GG_ARRAY_SIZE(options),
+                                                   NULL,
+                                                   BENCHMARK_BLOCK_SIZE,
+                                                   &client_parameters,
+                                                   GG_CAST(&listener, GG_CoapBlockwiseResponseListener),
+                                                   NULL);
+    } else {
+        result = GG_CoapEndpoint_SendPipelinedBlockwiseRequest(client,
+                                                               GG_COAP_METHOD_GET,
+                                                               options,
+                                                               GG_ARRAY_SIZE(options),
+                                                               NULL,
+                                                               BENCHMARK_BLOCK_SIZE,
+                                                               mode == TRANSFER_MODE_BLOCK2_PIPELINED ?
+                                                               BENCHMARK_BLOCKS_IN_FLIGHT : 1,
+                                                               &client_parameters,
+                                                               GG_CAST(&listener, GG_CoapBlockwiseResponseListener),
+                                                               NULL);
+    }
+    if (GG_FAILED(result)) goto end;
+
+    // run until the transfer ends, jumping from one timer to the next
+    uint32_t now = 0;
+    while (!listener.done && now < BENCHMARK_MAX_DURATION) {
+        uint32_t next = GG_TimerScheduler_GetNextScheduledTime(timer_scheduler);
+        if (next == GG_TIMER_NEVER) {
+            break;
+        }
+        now += GG_MAX(next, 1);
+        GG_TimerScheduler_SetTime(timer_scheduler, now);
+    }
+    double cpu_ms = 1000.0 * (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    // compute the results
+    GG_SimulatedBleLinkStats client_stats;
+    GG_SimulatedBleLink_GetStats(link, GG_SIMULATED_BLE_LINK_SIDE_A, &client_stats);
+    GG_SimulatedBleLinkStats server_stats;
+    GG_SimulatedBleLink_GetStats(link, GG_SIMULATED_BLE_LINK_SIDE_B, &server_stats);
+    bool   completed  = listener.done && listener.error == GG_SUCCESS;
+    double duration_s = (double)listener.end_time / 1000.0;
+    double megabytes  = (double)listener.byte_count / 1000000.0;
+    const GG_SimulatedBleLinkConfig* config = &scenario->link_config;
+
+    printf("{\"mode\":\"%s\",\"scenario\":\"%s\","
+           "\"connection_interval\":%u,\"packets_per_interval\":%u,"
+           "\"loss_per_mille\":%u,\"loss_burst_length\":%u,\"reorder_per_mille\":%u,"
+           "\"completed\":%s,\"error\":%d,\"bytes\":%u,\"duration_ms\":%u,\"goodput_bytes_per_second\":%.1f,"
+           "\"client_packets\":%u,\"server_packets\":%u,\"link_dropped\":%u,\"link_rejected\":%u,"
+           "\"cpu_ms_per_mb\":%.3f}\n",
+           TransferModeNames[mode],
+           scenario->name,
+           (unsigned int)config->connection_interval,
+           config->packets_per_interval,
+           config->loss_per_mille,
+           config->loss_burst_length,
+           config->reorder_per_mille,
+           completed ? "true" : "false",
+           (int)listener.error,
+           (unsigned int)listener.byte_count,
+           (unsigned int)listener.end_time,
+           completed && duration_s > 0 ? (double)listener.byte_count / duration_s : 0.0,
+           (unsigned int)client_stats.packets_queued,
+           (unsigned int)server_stats.packets_queued,
+           (unsigned int)(client_stats.packets_dropped + server_stats.packets_dropped),
+           (unsigned int)(client_stats.packets_rejected + server_stats.packets_rejected),
+           megabytes > 0 ? cpu_ms / megabytes : 0.0);
+
+end:
+    // cleanup (the endpoints unregister from the sinks they're connected to)
+    GG_CoapEndpoint_Destroy(client);
+    GG_CoapEndpoint_Destroy(server);
+    GG_SimulatedBleLink_Destroy(link);
+    GG_TimerScheduler_Destroy(timer_scheduler);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : NULL;
+
+    // don't log anything unless asked to
+    if (getenv("GG_LOG_CONFIG") == NULL) {
+        setenv("GG_LOG_CONFIG", "plist:.level=OFF", 0);
+    }
+
+    // init Golden Gate
+    GG_Module_Initialize();
+
+    int exit_code = 0;
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(Scenarios); i++) {
+        for (unsigned int mode = 0; mode < GG_ARRAY_SIZE(TransferModeNames); mode++) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s/%s", TransferModeNames[mode], Scenarios[i].name);
+            if (filter && strstr(name, filter) == NULL) {
+                continue;
+            }
+            GG_Result result = RunScenario((TransferMode)mode, &Scenarios[i]);
+            if (GG_FAILED(result)) {
+                fprintf(stderr, "ERROR: %s failed (%d)\n", name, result);
+                exit_code = 1;
+            }
+        }
+    }
+
+    GG_Module_Terminate();
+
+    return exit_code;
+}
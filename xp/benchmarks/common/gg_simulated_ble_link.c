@@ -0,0 +1,346 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ * Deterministic simulation of a BLE link between two transport endpoints.
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <string.h>
+
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_memory.h"
+#include "xp/common/gg_utils.h"
+#include "xp/common/gg_buffer.h"
+#include "xp/benchmarks/common/gg_simulated_ble_link.h"
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * One direction of the link: packets put to its sink come out of its source.
+ */
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+    GG_IMPLEMENTS(GG_DataSource);
+
+    GG_SimulatedBleLink*     link;
+    GG_DataSink*             sink;            ///< Sink of the receiving side
+    GG_DataSinkListener*     sink_listener;   ///< Listener of the sending side
+    GG_Buffer**              queue;           ///< Circular queue of packets waiting for a connection event
+    unsigned int             queue_head;
+    unsigned int             queue_count;
+    GG_Buffer*               held_packet;     ///< Packet held back so that it's delivered after its successor
+    bool                     held_since_last_event;
+    unsigned int             burst_remaining; ///< Packets still to drop in the current loss burst
+    bool                     sender_blocked;  ///< True when a packet was refused because the queue was full
+    GG_SimulatedBleLinkStats stats;
+} GG_SimulatedBleLinkDirection;
+
+struct GG_SimulatedBleLink {
+    GG_IMPLEMENTS(GG_TimerListener);
+
+    GG_SimulatedBleLinkConfig    config;
+    GG_Timer*                    timer;
+    uint32_t                     random_state;
+    GG_SimulatedBleLinkDirection directions[2]; ///< Indexed by the sending side
+};
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+
+//----------------------------------------------------------------------
+// xorshift32: cheap, and identical on all platforms
+//----------------------------------------------------------------------
+static unsigned int
+GG_SimulatedBleLink_RandomPerMille(GG_SimulatedBleLink* self)
+{
+    uint32_t x = self->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    self->random_state = x;
+
+    return (unsigned int)(x % 1000);
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_SimulatedBleLinkDirection_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    GG_SimulatedBleLinkDirection* self = GG_SELF(GG_SimulatedBleLinkDirection, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+    const GG_SimulatedBleLinkConfig* config = &self->link->config;
+
+    if (GG_Buffer_GetDataSize(data) > config->mtu) {
+        ++self->stats.packets_rejected;
+        return GG_ERROR_INVALID_PARAMETERS;
+    }
+    if (self->queue_count == config->queue_size) {
+        ++self->stats.packets_rejected;
+        self->sender_blocked = true;
+        return GG_ERROR_WOULD_BLOCK;
+    }
+
+    // copy the packet, like a controller does, so that the sender's buffers aren't held until
+    // the next connection event
+    GG_DynamicBuffer* packet = NULL;
+    GG_Result result = GG_DynamicBuffer_Create(GG_Buffer_GetDataSize(data), &packet);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+    GG_DynamicBuffer_SetData(packet, GG_Buffer_GetData(data), GG_Buffer_GetDataSize(data));
+    unsigned int tail = (self->queue_head + self->queue_count) % config->queue_size;
+    self->queue[tail] = GG_DynamicBuffer_AsBuffer(packet);
+    ++self->queue_count;
+    ++self->stats.packets_queued;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_SimulatedBleLinkDirection_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    GG_SimulatedBleLinkDirection* self = GG_SELF(GG_SimulatedBleLinkDirection, GG_DataSink);
+
+    self->sink_listener = listener;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_SimulatedBleLinkDirection, GG_DataSink) {
+    .PutData     = GG_SimulatedBleLinkDirection_PutData,
+    .SetListener = GG_SimulatedBleLinkDirection_SetListener
+};
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_SimulatedBleLinkDirection_SetDataSink(GG_DataSource* _self, GG_DataSink* sink)
+{
+    GG_SimulatedBleLinkDirection* self = GG_SELF(GG_SimulatedBleLinkDirection, GG_DataSource);
+
+    // packets are delivered at connection events only, so we don't need to listen to the sink
+    self->sink = sink;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_SimulatedBleLinkDirection, GG_DataSource) {
+    .SetDataSink = GG_SimulatedBleLinkDirection_SetDataSink
+};
+
+//----------------------------------------------------------------------
+// Deliver a packet to the receiving side and release it.
+// A packet that the receiving side refuses is lost.
+//----------------------------------------------------------------------
+static void
+GG_SimulatedBleLinkDirection_Deliver(GG_SimulatedBleLinkDirection* self, GG_Buffer* packet)
+{
+    if (self->sink && GG_SUCCEEDED(GG_DataSink_PutData(self->sink, packet, NULL))) {
+        ++self->stats.packets_delivered;
+        self->stats.bytes_delivered += GG_Buffer_GetDataSize(packet);
+    } else {
+        ++self->stats.packets_dropped;
+    }
+    GG_Buffer_Release(packet);
+}
+
+//----------------------------------------------------------------------
+// Carry the packets of one direction for one connection event
+//----------------------------------------------------------------------
+static void
+GG_SimulatedBleLinkDirection_OnConnectionEvent(GG_SimulatedBleLinkDirection* self)
+{
+    GG_SimulatedBleLink* link = self->link;
+    const GG_SimulatedBleLinkConfig* config = &link->config;
+
+    // a held packet doesn't wait for its successor for more than one connection event
+    bool flush_held_packet = self->held_since_last_event;
+
+    for (unsigned int i = 0; i < config->packets_per_interval && self->queue_count; i++) {
+        GG_Buffer* packet = self->queue[self->queue_head];
+        self->queue_head = (self->queue_head + 1) % config->queue_size;
+        --self->queue_count;
+
+        // loss
+        if (self->burst_remaining ||
+            (config->loss_per_mille && GG_SimulatedBleLink_RandomPerMille(link) < config->loss_per_mille)) {
+            if (self->burst_remaining) {
+                --self->burst_remaining;
+            } else {
+                self->burst_remaining = GG_MAX(config->loss_burst_length, 1) - 1;
+            }
+            ++self->stats.packets_dropped;
+            GG_Buffer_Release(packet);
+            continue;
+        }
+
+        // reordering
+        if (self->held_packet == NULL &&
+            config->reorder_per_mille &&
+            GG_SimulatedBleLink_RandomPerMille(link) < config->reorder_per_mille) {
+            self->held_packet = packet;
+            ++self->stats.packets_reordered;
+            continue;
+        }
+
+        GG_SimulatedBleLinkDirection_Deliver(self, packet);
+        if (self->held_packet) {
+            GG_Buffer* held_packet = self->held_packet;
+            self->held_packet = NULL;
+            flush_held_packet = false;
+            GG_SimulatedBleLinkDirection_Deliver(self, held_packet);
+        }
+    }
+
+    if (flush_held_packet && self->held_packet) {
+        GG_Buffer* held_packet = self->held_packet;
+        self->held_packet = NULL;
+        GG_SimulatedBleLinkDirection_Deliver(self, held_packet);
+    }
+    self->held_since_last_event = (self->held_packet != NULL);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_SimulatedBleLink_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint32_t elapsed)
+{
+    GG_SimulatedBleLink* self = GG_SELF(GG_SimulatedBleLink, GG_TimerListener);
+    GG_COMPILER_UNUSED(elapsed);
+
+    // schedule the next connection event
+    GG_Timer_Schedule(timer, GG_CAST(self, GG_TimerListener), self->config.connection_interval);
+
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(self->directions); i++) {
+        GG_SimulatedBleLinkDirection_OnConnectionEvent(&self->directions[i]);
+    }
+
+    // let the senders that were refused a packet know that there's space in their queue
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(self->directions); i++) {
+        GG_SimulatedBleLinkDirection* direction = &self->directions[i];
+        if (direction->sender_blocked && direction->queue_count < self->config.queue_size) {
+            direction->sender_blocked = false;
+            if (direction->sink_listener) {
+                GG_DataSinkListener_OnCanPut(direction->sink_listener);
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_SimulatedBleLink, GG_TimerListener) {
+    .OnTimerFired = GG_SimulatedBleLink_OnTimerFired
+};
+
+//----------------------------------------------------------------------
+GG_Result
+GG_SimulatedBleLink_Create(GG_TimerScheduler*               timer_scheduler,
+                           const GG_SimulatedBleLinkConfig* config,
+                           GG_SimulatedBleLink**            link)
+{
+    GG_ASSERT(config);
+    *link = NULL;
+
+    // check parameters
+    if (config->mtu == 0 ||
+        config->connection_interval == 0 ||
+        config->packets_per_interval == 0 ||
+        config->queue_size == 0 ||
+        config->loss_per_mille > 1000 ||
+        config->reorder_per_mille > 1000) {
+        return GG_ERROR_INVALID_PARAMETERS;
+    }
+
+    // allocate a new object
+    GG_SimulatedBleLink* self = (GG_SimulatedBleLink*)GG_AllocateZeroMemory(sizeof(GG_SimulatedBleLink));
+    if (self == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    // init the object fields
+    self->config       = *config;
+    self->random_state = config->seed ? config->seed : 1;
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(self->directions); i++) {
+        GG_SimulatedBleLinkDirection* direction = &self->directions[i];
+        direction->link  = self;
+        direction->queue = (GG_Buffer**)GG_AllocateZeroMemory(config->queue_size * sizeof(GG_Buffer*));
+        if (direction->queue == NULL) {
+            GG_SimulatedBleLink_Destroy(self);
+            return GG_ERROR_OUT_OF_MEMORY;
+        }
+        GG_SET_INTERFACE(direction, GG_SimulatedBleLinkDirection, GG_DataSink);
+        GG_SET_INTERFACE(direction, GG_SimulatedBleLinkDirection, GG_DataSource);
+    }
+    GG_SET_INTERFACE(self, GG_SimulatedBleLink, GG_TimerListener);
+
+    // start the connection events
+    GG_Result result = GG_TimerScheduler_CreateTimer(timer_scheduler, &self->timer);
+    if (GG_FAILED(result)) {
+        GG_SimulatedBleLink_Destroy(self);
+        return result;
+    }
+    GG_Timer_Schedule(self->timer, GG_CAST(self, GG_TimerListener), config->connection_interval);
+
+    *link = self;
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+void
+GG_SimulatedBleLink_Destroy(GG_SimulatedBleLink* self)
+{
+    if (self == NULL) return;
+
+    GG_Timer_Destroy(self->timer);
+
+    // release any packet still in transit
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(self->directions); i++) {
+        GG_SimulatedBleLinkDirection* direction = &self->directions[i];
+        if (direction->queue) {
+            for (unsigned int j = 0; j < direction->queue_count; j++) {
+                GG_Buffer_Release(direction->queue[(direction->queue_head + j) % self->config.queue_size]);
+            }
+            GG_FreeMemory(direction->queue);
+        }
+        if (direction->held_packet) {
+            GG_Buffer_Release(direction->held_packet);
+        }
+    }
+
+    GG_ClearAndFreeObject(self, 1);
+}
+
+//----------------------------------------------------------------------
+GG_DataSink*
+GG_SimulatedBleLink_GetSideAsDataSink(GG_SimulatedBleLink* self, GG_SimulatedBleLinkSide side)
+{
+    return GG_CAST(&self->directions[side], GG_DataSink);
+}
+
+//----------------------------------------------------------------------
+GG_DataSource*
+GG_SimulatedBleLink_GetSideAsDataSource(GG_SimulatedBleLink* self, GG_SimulatedBleLinkSide side)
+{
+    // a side receives what the other side sends
+    return GG_CAST(&self->directions[side == GG_SIMULATED_BLE_LINK_SIDE_A ? 1 : 0], GG_DataSource);
+}
+
+//----------------------------------------------------------------------
+void
+GG_SimulatedBleLink_GetStats(GG_SimulatedBleLink*      self,
+                             GG_SimulatedBleLinkSide   side,
+                             GG_SimulatedBleLinkStats* stats)
+{
+    *stats = self->directions[side].stats;
+}
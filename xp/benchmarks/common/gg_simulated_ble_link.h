@@ -0,0 +1,134 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ * Deterministic simulation of a BLE link between two transport endpoints.
+ *
+ * Packets put to one side's sink are queued, and carried to the other side's source
+ * at each connection event, up to a fixed number of packets per event and direction.
+ * Losses and reordering are decided by a seeded pseudo-random generator, so that
+ * runs with the same config and the same timer scheduler times are reproducible.
+ */
+
+#pragma once
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+#include "xp/common/gg_types.h"
+#include "xp/common/gg_results.h"
+#include "xp/common/gg_timer.h"
+#include "xp/common/gg_io.h"
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct GG_SimulatedBleLink GG_SimulatedBleLink;
+
+/**
+ * The two ends of a link.
+ * Data put to the sink of one side comes out of the source of the other side.
+ */
+typedef enum {
+    GG_SIMULATED_BLE_LINK_SIDE_A,
+    GG_SIMULATED_BLE_LINK_SIDE_B
+} GG_SimulatedBleLinkSide;
+
+/**
+ * Link characteristics.
+ */
+typedef struct {
+    size_t       mtu;                  ///< Max size of a packet, in bytes (larger packets are rejected)
+    uint32_t     connection_interval;  ///< Time between connection events, in ms
+    unsigned int packets_per_interval; ///< Max packets carried per connection event, in each direction
+    unsigned int queue_size;           ///< Max packets waiting for a connection event, in each direction
+    unsigned int loss_per_mille;       ///< Probability that a loss burst starts at a given packet, in 1/1000
+    unsigned int loss_burst_length;    ///< Number of consecutive packets lost in each loss burst (min 1)
+    unsigned int reorder_per_mille;    ///< Probability that a packet is delivered after its successor, in 1/1000
+    uint32_t     seed;                 ///< Seed of the pseudo-random generator (0 is replaced by 1)
+} GG_SimulatedBleLinkConfig;
+
+/**
+ * Counters for one direction of a link (named after the sending side).
+ */
+typedef struct {
+    uint32_t packets_queued;    ///< Packets accepted by the sending side's sink
+    uint32_t packets_rejected;  ///< Packets refused because the queue was full or they exceeded the MTU
+    uint32_t packets_dropped;   ///< Packets lost over the air
+    uint32_t packets_reordered; ///< Packets delivered after their successor
+    uint32_t packets_delivered; ///< Packets delivered to the receiving side
+    size_t   bytes_delivered;   ///< Bytes delivered to the receiving side
+} GG_SimulatedBleLinkStats;
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+/**
+ * Create a simulated link.
+ * The connection events are driven by timers, so the link runs at the pace at
+ * which the scheduler's time is advanced.
+ *
+ * @param timer_scheduler Timer scheduler used to time connection events.
+ * @param config Link characteristics.
+ * @param link Pointer to the variable that will receive the object.
+ *
+ * @return GG_SUCCESS if the object was created, or a negative error code.
+ */
+GG_Result GG_SimulatedBleLink_Create(GG_TimerScheduler*               timer_scheduler,
+                                     const GG_SimulatedBleLinkConfig* config,
+                                     GG_SimulatedBleLink**            link);
+
+/**
+ * Destroy a simulated link.
+ * Packets still queued are discarded.
+ *
+ * @param self The object on which this method is invoked.
+ */
+void GG_SimulatedBleLink_Destroy(GG_SimulatedBleLink* self);
+
+/**
+ * Get the sink through which a side sends packets over the link.
+ *
+ * @param self The object on which this method is invoked.
+ * @param side The sending side.
+ *
+ * @return The GG_DataSink interface of that side.
+ */
+GG_DataSink* GG_SimulatedBleLink_GetSideAsDataSink(GG_SimulatedBleLink* self, GG_SimulatedBleLinkSide side);
+
+/**
+ * Get the source through which a side receives packets from the link.
+ *
+ * @param self The object on which this method is invoked.
+ * @param side The receiving side.
+ *
+ * @return The GG_DataSource interface of that side.
+ */
+GG_DataSource* GG_SimulatedBleLink_GetSideAsDataSource(GG_SimulatedBleLink* self, GG_SimulatedBleLinkSide side);
+
+/**
+ * Get the counters of the packets sent by one side.
+ *
+ * @param self The object on which this method is invoked.
+ * @param side The sending side.
+ * @param stats Pointer to the struct in which the counters will be returned.
+ */
+void GG_SimulatedBleLink_GetStats(GG_SimulatedBleLink*      self,
+                                  GG_SimulatedBleLinkSide   side,
+                                  GG_SimulatedBleLinkStats* stats);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,453 @@
+/**
+ * @file
+ * @brief Gattlink throughput benchmark over a simulated BLE link
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ * Two Gattlink generic clients are connected through a simulated BLE link, and
+ * a fixed number of IP packets is sent from one to the other for each scenario
+ * of a matrix of link characteristics. Time is virtual (the timer scheduler's time
+ * is advanced directly from one timer to the next), so all the results except the
+ * CPU time are deterministic.
+ *
+ * Each scenario prints one JSON object on its own line, with:
+ *   goodput_bytes_per_second: payload bytes delivered per second of virtual time
+ *   retransmit_ratio: fraction of the data packets sent that were retransmissions
+ *   latency_*_ms: time between a packet entering the sender and leaving the receiver
+ *   cpu_ms_per_mb: CPU time used by the whole simulation per MB of payload delivered
+ *
+ * Usage: gg-gattlink-throughput-benchmark [<scenario-name-filter>]
+ *
+ * Logging is turned off unless GG_LOG_CONFIG is set, so that it doesn't skew the
+ * CPU time or get mixed with the results on the console.
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_memory.h"
+#include "xp/common/gg_utils.h"
+#include "xp/common/gg_timer.h"
+#include "xp/common/gg_io.h"
+#include "xp/module/gg_module.h"
+#include "xp/protocols/gg_ipv4_protocol.h"
+#include "xp/gattlink/gg_gattlink.h"
+#include "xp/gattlink/gg_gattlink_generic_client.h"
+#include "xp/utils/gg_blaster_data_source.h"
+#include "xp/benchmarks/common/gg_simulated_ble_link.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_GATTLINK_BUFFER_SIZE 1152
+#define BENCHMARK_PACKET_SIZE          512
+#define BENCHMARK_PACKET_COUNT         256       // must fit in the 16-bit IP identification field
+#define BENCHMARK_MAX_DURATION         600000    // give up after this much virtual time, in ms
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    const char*               name;
+    GG_SimulatedBleLinkConfig link_config;
+} Scenario;
+
+//----------------------------------------------------------------------
+// Pass-through sink that records the time at which each packet is
+// accepted by the sender
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+    GG_IMPLEMENTS(GG_DataSource);
+    GG_IMPLEMENTS(GG_DataSinkListener);
+
+    GG_TimerScheduler*   timer_scheduler;
+    GG_DataSink*         sink;
+    GG_DataSinkListener* sink_listener;
+    uint32_t             send_times[BENCHMARK_PACKET_COUNT];
+} PacketStamper;
+
+//----------------------------------------------------------------------
+// Sink that records the latency of each packet delivered by the receiver
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    GG_TimerScheduler*   timer_scheduler;
+    const PacketStamper* stamper;
+    uint32_t             latencies[BENCHMARK_PACKET_COUNT];
+    unsigned int         packet_count;
+    size_t               byte_count;
+    uint32_t             last_receive_time;
+} PacketCollector;
+
+/*----------------------------------------------------------------------
+|   globals
++---------------------------------------------------------------------*/
+// MTUs are ATT payload sizes (ATT MTU - 3), and connection intervals are rounded to the ms
+static const Scenario Scenarios[] = {
+    // name                         mtu  int  pkt  queue loss burst reorder seed
+    { "ideal_mtu20_ci15",         { 20,  15,  4,   8,    0,   1,    0,      1 } },
+    { "ideal_mtu182_ci15",        { 182, 15,  4,   8,    0,   1,    0,      1 } },
+    { "ideal_mtu244_ci30_ppi6",   { 244, 30,  6,   12,   0,   1,    0,      1 } },
+    { "ideal_mtu182_ci50_ppi2",   { 182, 50,  2,   4,    0,   1,    0,      1 } },
+    { "loss1pct_mtu182_ci15",     { 182, 15,  4,   8,    10,  1,    0,      1 } },
+    { "loss5pct_mtu182_ci15",     { 182, 15,  4,   8,    50,  1,    0,      1 } },
+    { "burst3_mtu182_ci15",       { 182, 15,  4,   8,    10,  3,    0,      1 } },
+    { "reorder2pct_mtu182_ci15",  { 182, 15,  4,   8,    0,   1,    20,     1 } },
+    { "lossy_mtu244_ci30_ppi6",   { 244, 30,  6,   12,   20,  2,    10,     1 } },
+    { "shallow_queue_mtu182_ci15",{ 182, 15,  4,   2,    0,   1,    0,      1 } }
+};
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+
+//----------------------------------------------------------------------
+// The blaster puts the packet counter in the IP identification field
+//----------------------------------------------------------------------
+static unsigned int
+GetPacketId(GG_Buffer* packet)
+{
+    if (GG_Buffer_GetDataSize(packet) < GG_BLASTER_IP_COUNTER_PACKET_MIN_SIZE) {
+        return BENCHMARK_PACKET_COUNT;
+    }
+    const uint8_t* data = GG_Buffer_GetData(packet);
+    return (unsigned int)((data[4] << 8) | data[5]);
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+PacketStamper_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    PacketStamper* self = GG_SELF(PacketStamper, GG_DataSink);
+
+    GG_Result result = GG_DataSink_PutData(self->sink, data, metadata);
+    if (GG_SUCCEEDED(result)) {
+        unsigned int id = GetPacketId(data);
+        if (id < BENCHMARK_PACKET_COUNT) {
+            self->send_times[id] = GG_TimerScheduler_GetTime(self->timer_scheduler);
+        }
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+PacketStamper_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    PacketStamper* self = GG_SELF(PacketStamper, GG_DataSink);
+
+    self->sink_listener = listener;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+PacketStamper_SetDataSink(GG_DataSource* _self, GG_DataSink* sink)
+{
+    PacketStamper* self = GG_SELF(PacketStamper, GG_DataSource);
+
+    if (self->sink) {
+        GG_DataSink_SetListener(self->sink, NULL);
+    }
+    self->sink = sink;
+    if (sink) {
+        GG_DataSink_SetListener(sink, GG_CAST(self, GG_DataSinkListener));
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static void
+PacketStamper_OnCanPut(GG_DataSinkListener* _self)
+{
+    PacketStamper* self = GG_SELF(PacketStamper, GG_DataSinkListener);
+
+    if (self->sink_listener) {
+        GG_DataSinkListener_OnCanPut(self->sink_listener);
+    }
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(PacketStamper, GG_DataSink) {
+    .PutData     = PacketStamper_PutData,
+    .SetListener = PacketStamper_SetListener
+};
+
+GG_IMPLEMENT_INTERFACE(PacketStamper, GG_DataSource) {
+    .SetDataSink = PacketStamper_SetDataSink
+};
+
+GG_IMPLEMENT_INTERFACE(PacketStamper, GG_DataSinkListener) {
+    .OnCanPut = PacketStamper_OnCanPut
+};
+
+//----------------------------------------------------------------------
+static GG_Result
+PacketCollector_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    PacketCollector* self = GG_SELF(PacketCollector, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+
+    uint32_t now = GG_TimerScheduler_GetTime(self->timer_scheduler);
+    unsigned int id = GetPacketId(data);
+    if (id < BENCHMARK_PACKET_COUNT && self->packet_count < BENCHMARK_PACKET_COUNT) {
+        self->latencies[self->packet_count++] = now - self->stamper->send_times[id];
+    }
+    self->byte_count       += GG_Buffer_GetDataSize(data);
+    self->last_receive_time = now;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+PacketCollector_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    GG_COMPILER_UNUSED(_self);
+    GG_COMPILER_UNUSED(listener);
+
+    // we never block, so we don't need to keep the listener
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(PacketCollector, GG_DataSink) {
+    .PutData     = PacketCollector_PutData,
+    .SetListener = PacketCollector_SetListener
+};
+
+//----------------------------------------------------------------------
+static int
+CompareLatencies(const void* a, const void* b)
+{
+    uint32_t latency_a = *(const uint32_t*)a;
+    uint32_t latency_b = *(const uint32_t*)b;
+    return latency_a < latency_b ? -1 : (latency_a > latency_b ? 1 : 0);
+}
+
+//----------------------------------------------------------------------
+// Get a percentile from a sorted array of latencies (nearest rank)
+//----------------------------------------------------------------------
+static uint32_t
+GetLatencyPercentile(const uint32_t* latencies, unsigned int count, unsigned int percentile)
+{
+    if (count == 0) {
+        return 0;
+    }
+    unsigned int rank = (count * percentile + 99) / 100;
+    return latencies[rank ? rank - 1 : 0];
+}
+
+//----------------------------------------------------------------------
+// Create a gattlink client and connect its transport side to one side of the link
+//----------------------------------------------------------------------
+static GG_Result
+CreateClient(GG_TimerScheduler*         timer_scheduler,
+             GG_SimulatedBleLink*       link,
+             size_t                     mtu,
+             GG_SimulatedBleLinkSide    side,
+             GG_Ipv4FrameSerializer**   frame_serializer,
+             GG_Ipv4FrameAssembler**    frame_assembler,
+             GG_GattlinkGenericClient** client)
+{
+    GG_Result result = GG_Ipv4FrameSerializer_Create(NULL, frame_serializer);
+    if (GG_FAILED(result)) return result;
+    result = GG_Ipv4FrameAssembler_Create(BENCHMARK_GATTLINK_BUFFER_SIZE, NULL, NULL, frame_assembler);
+    if (GG_FAILED(result)) return result;
+    result = GG_GattlinkGenericClient_Create(timer_scheduler,
+                                             BENCHMARK_GATTLINK_BUFFER_SIZE,
+                                             0,
+                                             0,
+                                             mtu,
+                                             NULL,
+                                             GG_Ipv4FrameSerializer_AsFrameSerializer(*frame_serializer),
+                                             GG_Ipv4FrameAssembler_AsFrameAssembler(*frame_assembler),
+                                             client);
+    if (GG_FAILED(result)) return result;
+
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(*client),
+                              GG_SimulatedBleLink_GetSideAsDataSink(link, side));
+    GG_DataSource_SetDataSink(GG_SimulatedBleLink_GetSideAsDataSource(link, side),
+                              GG_GattlinkGenericClient_GetTransportSideAsDataSink(*client));
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+RunScenario(const Scenario* scenario)
+{
+    GG_TimerScheduler*        timer_scheduler     = NULL;
+    GG_SimulatedBleLink*      link                = NULL;
+    GG_Ipv4FrameSerializer*   frame_serializers[2] = { NULL, NULL };
+    GG_Ipv4FrameAssembler*    frame_assemblers[2]  = { NULL, NULL };
+    GG_GattlinkGenericClient* clients[2]           = { NULL, NULL };
+    GG_BlasterDataSource*     blaster             = NULL;
+    static PacketStamper      stamper;
+    static PacketCollector    collector;
+
+    GG_Result result = GG_TimerScheduler_Create(&timer_scheduler);
+    if (GG_FAILED(result)) goto end;
+    result = GG_SimulatedBleLink_Create(timer_scheduler, &scenario->link_config, &link);
+    if (GG_FAILED(result)) goto end;
+    result = CreateClient(timer_scheduler,
+                          link,
+                          scenario->link_config.mtu,
+                          GG_SIMULATED_BLE_LINK_SIDE_A,
+                          &frame_serializers[0],
+                          &frame_assemblers[0],
+                          &clients[0]);
+    if (GG_FAILED(result)) goto end;
+    result = CreateClient(timer_scheduler,
+                          link,
+                          scenario->link_config.mtu,
+                          GG_SIMULATED_BLE_LINK_SIDE_B,
+                          &frame_serializers[1],
+                          &frame_assemblers[1],
+                          &clients[1]);
+    if (GG_FAILED(result)) goto end;
+    result = GG_BlasterDataSource_Create(BENCHMARK_PACKET_SIZE,
+                                         GG_BLASTER_IP_COUNTER_PACKET_FORMAT,
+                                         BENCHMARK_PACKET_COUNT,
+                                         NULL,
+                                         0,
+                                         &blaster);
+    if (GG_FAILED(result)) goto end;
+
+    // blaster -> stamper -> client A ... client B -> collector
+    memset(&stamper, 0, sizeof(stamper));
+    stamper.timer_scheduler = timer_scheduler;
+    GG_SET_INTERFACE(&stamper, PacketStamper, GG_DataSink);
+    GG_SET_INTERFACE(&stamper, PacketStamper, GG_DataSource);
+    GG_SET_INTERFACE(&stamper, PacketStamper, GG_DataSinkListener);
+    memset(&collector, 0, sizeof(collector));
+    collector.timer_scheduler = timer_scheduler;
+    collector.stamper         = &stamper;
+    GG_SET_INTERFACE(&collector, PacketCollector, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_CAST(&stamper, GG_DataSource),
+                              GG_GattlinkGenericClient_GetUserSideAsDataSink(clients[0]));
+    GG_DataSource_SetDataSink(GG_BlasterDataSource_AsDataSource(blaster), GG_CAST(&stamper, GG_DataSink));
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetUserSideAsDataSource(clients[1]),
+                              GG_CAST(&collector, GG_DataSink));
+
+    GG_GattlinkGenericClient_Start(clients[0]);
+    GG_GattlinkGenericClient_Start(clients[1]);
+    GG_BlasterDataSource_Start(blaster);
+
+    // run until everything is delivered, jumping from one timer to the next
+    clock_t cpu_start = clock();
+    uint32_t now = 0;
+    while (collector.packet_count < BENCHMARK_PACKET_COUNT && now < BENCHMARK_MAX_DURATION) {
+        uint32_t next = GG_TimerScheduler_GetNextScheduledTime(timer_scheduler);
+        if (next == GG_TIMER_NEVER) {
+            break;
+        }
+        now += GG_MAX(next, 1);
+        GG_TimerScheduler_SetTime(timer_scheduler, now);
+    }
+    double cpu_ms = 1000.0 * (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    // compute the results
+    GG_GattlinkProtocolStats sender_stats;
+    GG_GattlinkGenericClient_GetStats(clients[0], &sender_stats);
+    GG_SimulatedBleLinkStats link_stats;
+    GG_SimulatedBleLink_GetStats(link, GG_SIMULATED_BLE_LINK_SIDE_A, &link_stats);
+    qsort(collector.latencies, collector.packet_count, sizeof(collector.latencies[0]), CompareLatencies);
+    double duration_s = (double)collector.last_receive_time / 1000.0;
+    double megabytes  = (double)collector.byte_count / 1000000.0;
+    const GG_SimulatedBleLinkConfig* config = &scenario->link_config;
+
+    printf("{\"scenario\":\"%s\","
+           "\"mtu\":%u,\"connection_interval\":%u,\"packets_per_interval\":%u,\"queue_size\":%u,"
+           "\"loss_per_mille\":%u,\"loss_burst_length\":%u,\"reorder_per_mille\":%u,"
+           "\"completed\":%s,\"bytes\":%u,\"duration_ms\":%u,\"goodput_bytes_per_second\":%.1f,"
+           "\"data_packets\":%u,\"retransmitted_packets\":%u,\"retransmit_ratio\":%.4f,"
+           "\"link_dropped\":%u,\"link_reordered\":%u,\"link_rejected\":%u,"
+           "\"latency_p50_ms\":%u,\"latency_p90_ms\":%u,\"latency_p99_ms\":%u,\"latency_max_ms\":%u,"
+           "\"cpu_ms_per_mb\":%.3f}\n",
+           scenario->name,
+           (unsigned int)config->mtu,
+           (unsigned int)config->connection_interval,
+           config->packets_per_interval,
+           config->queue_size,
+           config->loss_per_mille,
+           config->loss_burst_length,
+           config->reorder_per_mille,
+           collector.packet_count == BENCHMARK_PACKET_COUNT ? "true" : "false",
+           (unsigned int)collector.byte_count,
+           (unsigned int)collector.last_receive_time,
+           duration_s > 0 ? (double)collector.byte_count / duration_s : 0.0,
+           (unsigned int)sender_stats.data_packet_count,
+           (unsigned int)sender_stats.retransmitted_packet_count,
+           sender_stats.data_packet_count ?
+               (double)sender_stats.retransmitted_packet_count / (double)sender_stats.data_packet_count : 0.0,
+           (unsigned int)link_stats.packets_dropped,
+           (unsigned int)link_stats.packets_reordered,
+           (unsigned int)link_stats.packets_rejected,
+           (unsigned int)GetLatencyPercentile(collector.latencies, collector.packet_count, 50),
+           (unsigned int)GetLatencyPercentile(collector.latencies, collector.packet_count, 90),
+           (unsigned int)GetLatencyPercentile(collector.latencies, collector.packet_count, 99),
+           (unsigned int)GetLatencyPercentile(collector.latencies, collector.packet_count, 100),
+           megabytes > 0 ? cpu_ms / megabytes : 0.0);
+
+end:
+    // cleanup (the blaster and the clients unregister from the sinks they're connected to)
+    GG_BlasterDataSource_Destroy(blaster);
+    GG_GattlinkGenericClient_Destroy(clients[0]);
+    GG_GattlinkGenericClient_Destroy(clients[1]);
+    GG_SimulatedBleLink_Destroy(link);
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(clients); i++) {
+        GG_Ipv4FrameSerializer_Destroy(frame_serializers[i]);
+        GG_Ipv4FrameAssembler_Destroy(frame_assemblers[i]);
+    }
+    GG_TimerScheduler_Destroy(timer_scheduler);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : NULL;
+
+    // don't log anything unless asked to
+    if (getenv("GG_LOG_CONFIG") == NULL) {
+        setenv("GG_LOG_CONFIG", "plist:.level=OFF", 0);
+    }
+
+    // init Golden Gate
+    GG_Module_Initialize();
+
+    int exit_code = 0;
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(Scenarios); i++) {
+        if (filter && strstr(Scenarios[i].name, filter) == NULL) {
+            continue;
+        }
+        GG_Result result = RunScenario(&Scenarios[i]);
+        if (GG_FAILED(result)) {
+            fprintf(stderr, "ERROR: scenario %s failed (%d)\n", Scenarios[i].name, result);
+            exit_code = 1;
+        }
+    }
+
+    GG_Module_Terminate();
+
+    return exit_code;
+}
@@ -0,0 +1,263 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @author Gilles Boccon-Gibod
+ *
+ * @date 2020-06-15
+ *
+ * @details
+ *
+ * Timer scheduler microbenchmark.
+ *
+ * Measures the cost of scheduling, rescheduling and firing a large number of
+ * active timers with GG_TimerScheduler, and compares it with a minimal
+ * time-sorted list scheduler (which is how GG_TimerScheduler used to keep its
+ * timers).
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "xp/common/gg_lists.h"
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_results.h"
+#include "xp/common/gg_system.h"
+#include "xp/common/gg_timer.h"
+#include "xp/common/gg_types.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define DEFAULT_TIMER_COUNT  10000
+#define RESCHEDULE_ROUNDS    10
+#define MAX_DELAY            30000 // typical range of protocol timeouts (ms)
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    GG_LinkedListNode list_node;
+    uint32_t          fire_time;
+} SortedListTimer;
+
+typedef struct {
+    GG_LinkedList scheduled;
+    uint32_t      now;
+    size_t        fired;
+} SortedListScheduler;
+
+typedef struct {
+    GG_IMPLEMENTS(GG_TimerListener);
+
+    size_t fired;
+} FireCounter;
+
+/*----------------------------------------------------------------------
+|   globals
++---------------------------------------------------------------------*/
+static uint32_t Seed = 123456789;
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+static uint32_t
+GetRandomDelay(void)
+{
+    Seed = (1103515245 * Seed + 12345);
+    return 1 + (Seed >> 8) % MAX_DELAY;
+}
+
+//----------------------------------------------------------------------
+static double
+GetElapsedMs(GG_Timestamp start)
+{
+    return (double)(GG_System_GetCurrentTimestamp() - start) / 1000000.0;
+}
+
+//----------------------------------------------------------------------
+// Sorted list reference implementation
+//----------------------------------------------------------------------
+static void
+SortedListScheduler_Schedule(SortedListScheduler* self, SortedListTimer* timer, uint32_t ms_from_now)
+{
+    if (!GG_LINKED_LIST_NODE_IS_UNLINKED(&timer->list_node)) {
+        GG_LINKED_LIST_NODE_REMOVE(&timer->list_node);
+    }
+    timer->fire_time = self->now + ms_from_now;
+
+    GG_LinkedListNode* insertion_point = NULL;
+    GG_LINKED_LIST_FOREACH(node, &self->scheduled) {
+        SortedListTimer* scheduled = GG_LINKED_LIST_ITEM(node, SortedListTimer, list_node);
+        if (timer->fire_time < scheduled->fire_time) {
+            insertion_point = node;
+            break;
+        }
+    }
+    if (insertion_point) {
+        GG_LINKED_LIST_NODE_INSERT_BEFORE(insertion_point, &timer->list_node);
+    } else {
+        GG_LINKED_LIST_APPEND(&self->scheduled, &timer->list_node);
+    }
+}
+
+//----------------------------------------------------------------------
+static void
+SortedListScheduler_SetTime(SortedListScheduler* self, uint32_t now)
+{
+    self->now = now;
+    while (!GG_LINKED_LIST_IS_EMPTY(&self->scheduled)) {
+        SortedListTimer* timer = GG_LINKED_LIST_ITEM(GG_LINKED_LIST_HEAD(&self->scheduled),
+                                                     SortedListTimer,
+                                                     list_node);
+        if (timer->fire_time > now) {
+            break;
+        }
+        GG_LINKED_LIST_NODE_REMOVE(&timer->list_node);
+        ++self->fired;
+    }
+}
+
+//----------------------------------------------------------------------
+static void
+RunSortedListBenchmark(size_t timer_count)
+{
+    SortedListTimer* timers = calloc(timer_count, sizeof(SortedListTimer));
+    SortedListScheduler scheduler = { .now = 0, .fired = 0 };
+    GG_LINKED_LIST_INIT(&scheduler.scheduled);
+    for (size_t i = 0; i < timer_count; i++) {
+        GG_LINKED_LIST_NODE_INIT(&timers[i].list_node);
+    }
+
+    Seed = 123456789;
+    GG_Timestamp start = GG_System_GetCurrentTimestamp();
+    for (size_t i = 0; i < timer_count; i++) {
+        SortedListScheduler_Schedule(&scheduler, &timers[i], GetRandomDelay());
+    }
+    double schedule_ms = GetElapsedMs(start);
+
+    start = GG_System_GetCurrentTimestamp();
+    for (unsigned int round = 0; round < RESCHEDULE_ROUNDS; round++) {
+        for (size_t i = 0; i < timer_count; i++) {
+            SortedListScheduler_Schedule(&scheduler, &timers[i], GetRandomDelay());
+        }
+    }
+    double reschedule_ms = GetElapsedMs(start);
+
+    start = GG_System_GetCurrentTimestamp();
+    for (uint32_t now = 1; now <= MAX_DELAY; now++) {
+        SortedListScheduler_SetTime(&scheduler, now);
+    }
+    double fire_ms = GetElapsedMs(start);
+
+    printf("sorted list : schedule %8.3f ms, reschedule x%u %9.3f ms, run %8.3f ms (%u fired)\n",
+           schedule_ms,
+           RESCHEDULE_ROUNDS,
+           reschedule_ms,
+           fire_ms,
+           (unsigned int)scheduler.fired);
+
+    free(timers);
+}
+
+//----------------------------------------------------------------------
+static void
+FireCounter_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint32_t time_elapsed)
+{
+    FireCounter* self = GG_SELF(FireCounter, GG_TimerListener);
+    GG_COMPILER_UNUSED(timer);
+    GG_COMPILER_UNUSED(time_elapsed);
+    ++self->fired;
+}
+
+GG_IMPLEMENT_INTERFACE(FireCounter, GG_TimerListener) {
+    .OnTimerFired = FireCounter_OnTimerFired
+};
+
+//----------------------------------------------------------------------
+static GG_Result
+RunTimerSchedulerBenchmark(size_t timer_count)
+{
+    GG_TimerScheduler* scheduler = NULL;
+    GG_Result result = GG_TimerScheduler_Create(&scheduler);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+    GG_Timer** timers = calloc(timer_count, sizeof(GG_Timer*));
+    for (size_t i = 0; i < timer_count; i++) {
+        result = GG_TimerScheduler_CreateTimer(scheduler, &timers[i]);
+        if (GG_FAILED(result)) {
+            fprintf(stderr, "ERROR: failed to create timer %u (%d)\n", (unsigned int)i, result);
+            goto end;
+        }
+    }
+    FireCounter counter = { .fired = 0 };
+    GG_SET_INTERFACE(&counter, FireCounter, GG_TimerListener);
+    GG_TimerListener* listener = GG_CAST(&counter, GG_TimerListener);
+
+    Seed = 123456789;
+    GG_Timestamp start = GG_System_GetCurrentTimestamp();
+    for (size_t i = 0; i < timer_count; i++) {
+        GG_Timer_Schedule(timers[i], listener, GetRandomDelay());
+    }
+    double schedule_ms = GetElapsedMs(start);
+
+    start = GG_System_GetCurrentTimestamp();
+    for (unsigned int round = 0; round < RESCHEDULE_ROUNDS; round++) {
+        for (size_t i = 0; i < timer_count; i++) {
+            GG_Timer_Schedule(timers[i], listener, GetRandomDelay());
+        }
+    }
+    double reschedule_ms = GetElapsedMs(start);
+
+    start = GG_System_GetCurrentTimestamp();
+    for (uint32_t now = 1; now <= MAX_DELAY; now++) {
+        GG_TimerScheduler_SetTime(scheduler, now);
+    }
+    double fire_ms = GetElapsedMs(start);
+
+    printf("timer wheel : schedule %8.3f ms, reschedule x%u %9.3f ms, run %8.3f ms (%u fired)\n",
+           schedule_ms,
+           RESCHEDULE_ROUNDS,
+           reschedule_ms,
+           fire_ms,
+           (unsigned int)counter.fired);
+
+end:
+    for (size_t i = 0; i < timer_count; i++) {
+        GG_Timer_Destroy(timers[i]);
+    }
+    free(timers);
+    GG_TimerScheduler_Destroy(scheduler);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    size_t timer_count = DEFAULT_TIMER_COUNT;
+    if (argc > 1) {
+        timer_count = (size_t)strtoul(argv[1], NULL, 10);
+        if (timer_count == 0) {
+            fprintf(stderr, "usage: gg-timers-benchmark [<timer-count>]\n");
+            return 1;
+        }
+    }
+
+    printf("=== %u active timers, delays 1-%u ms\n", (unsigned int)timer_count, MAX_DELAY);
+    RunSortedListBenchmark(timer_count);
+    GG_Result result = RunTimerSchedulerBenchmark(timer_count);
+
+    return GG_SUCCEEDED(result) ? 0 : 1;
+}
@@ -176,6 +176,7 @@ typedef struct {
     uint32_t             filter;   ///< Iterator filter
     const uint8_t*       location; ///< Internal field used by the implementation
     const uint8_t*       end;      ///< Internal field used by the implementation
+    size_t               index;    ///< Internal field used by the implementation
 } GG_CoapMessageOptionIterator;
 
 /**
@@ -362,6 +363,19 @@ typedef struct {
     size_t max_resend_count;
 } GG_CoapClientParameters;
 
+/**
+ * Statistics for the queue in which an endpoint keeps the responses that it
+ * can't send right away because its transport sink would block.
+ */
+typedef struct {
+    size_t   depth;      ///< Number of responses currently in the queue
+    size_t   high_water; ///< Max number of responses that were in the queue at the same time
+    size_t   capacity;   ///< Max number of responses that can be queued
+    uint32_t dropped;    ///< Number of responses dropped because they couldn't be queued
+    uint32_t refused;    ///< Number of requests dropped because their peer had too many queued responses
+    uint32_t blocked;    ///< Number of times the endpoint stopped accepting requests because the queue was full
+} GG_CoapResponseQueueStats;
+
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
@@ -459,6 +473,7 @@ typedef enum {
 #define GG_COAP_MESSAGE_OPTION_URI_HOST       3
 #define GG_COAP_MESSAGE_OPTION_ETAG           4
 #define GG_COAP_MESSAGE_OPTION_IF_NONE_MATCH  5
+#define GG_COAP_MESSAGE_OPTION_OBSERVE        6 ///< RFC 7641
 #define GG_COAP_MESSAGE_OPTION_URI_PORT       7
 #define GG_COAP_MESSAGE_OPTION_LOCATION_PATH  8
 #define GG_COAP_MESSAGE_OPTION_URI_PATH       11
@@ -466,6 +481,7 @@ typedef enum {
 #define GG_COAP_MESSAGE_OPTION_MAX_AGE        14
 #define GG_COAP_MESSAGE_OPTION_URI_QUERY      15
 #define GG_COAP_MESSAGE_OPTION_ACCEPT         17
+#define GG_COAP_MESSAGE_OPTION_QBLOCK1        19 ///< RFC 9177
 #define GG_COAP_MESSAGE_OPTION_LOCATION_QUERY 20
 #define GG_COAP_MESSAGE_OPTION_PROXY_URI      35
 #define GG_COAP_MESSAGE_OPTION_PROXY_SCHEME   39
@@ -473,6 +489,7 @@ typedef enum {
 #define GG_COAP_MESSAGE_OPTION_SIZE2          28
 #define GG_COAP_MESSAGE_OPTION_BLOCK1         27
 #define GG_COAP_MESSAGE_OPTION_BLOCK2         23
+#define GG_COAP_MESSAGE_OPTION_QBLOCK2        31 ///< RFC 9177
 #define GG_COAP_MESSAGE_OPTION_START_OFFSET   2048 ///< vendor-specific option number
 #define GG_COAP_MESSAGE_OPTION_EXTENDED_ERROR 2049 ///< vendor-specific extended error code option number
 
@@ -484,6 +501,7 @@ typedef enum {
 #define GG_COAP_MESSAGE_FORMAT_ID_EXI           47
 #define GG_COAP_MESSAGE_FORMAT_ID_JSON          50
 #define GG_COAP_MESSAGE_FORMAT_ID_CBOR          60
+#define GG_COAP_MESSAGE_FORMAT_ID_MISSING_BLOCKS 272 ///< application/missing-blocks+cbor-seq (RFC 9177)
 
 // error codes
 #define GG_ERROR_COAP_UNSUPPORTED_VERSION (GG_ERROR_BASE_COAP - 0)
@@ -939,11 +957,11 @@ GG_Result GG_CoapEndpoint_CancelRequest(GG_CoapEndpoint* self, GG_CoapRequestHan
  * separated by '/' characters. No leading or trailing '/' characters should appear in the
  * path.
  * Matching of incoming requests against registered handler paths is performed as follows:
- * The handlers are checked one by one in the order in which they were registered. The first
- * matching handler will be invoked to handle the request. To match, all the URI path components
- * of the request must match the '/'-separated components of the handler's path. Partial matches
- * are allowed. For example, a handler registered at path `foo/bar/baz` will match a request with
- * the URI path components (`foo`, `bar`, `baz`) but also a request with just (`foo`, `bar`).
+ * To match, all the '/'-separated components of the handler's path must match the first URI
+ * path components of the request. Prefix matches are allowed. For example, a handler registered
+ * at path `foo/bar` will match a request with the URI path components (`foo`, `bar`) but also a
+ * request with (`foo`, `bar`, `baz`). When more than one handler matches, the one that was
+ * registered first will be invoked to handle the request.
  *
  * NOTE: this method makes an internal copy of the path parameter.
  *
@@ -963,8 +981,9 @@ GG_Result GG_CoapEndpoint_RegisterRequestHandler(GG_CoapEndpoint*       self,
  * Register a handler stored in a handler node to be called when a request is received
  * for a certain path.
  *
- * This method is a variant of GG_CoapEndpoint_RegisterRequestHandler which doesn't do any
- * dynamic memory allocation.
+ * This method is a variant of GG_CoapEndpoint_RegisterRequestHandler which doesn't allocate
+ * memory for the handler node (the endpoint may still need to grow its internal path lookup
+ * table, which is never shrunk while the endpoint exists).
  *
  * NOTE: this method doesn't make an internal copy of the path parameter, so it must remain
  * unchanged for as long as the handler is registered.
@@ -1075,6 +1094,30 @@ GG_Result GG_CoapEndpoint_SetTokenPrefix(GG_CoapEndpoint* self, const uint8_t* p
  */
 const uint8_t* GG_CoapEndpoint_GetTokenPrefix(GG_CoapEndpoint* self, size_t* prefix_size);
 
+/**
+ * Set the capacity of the response queue.
+ * Responses that can't be sent right away, because the transport sink would block,
+ * are kept in this queue. When the queue is full, the endpoint stops accepting new
+ * requests from its transport source (returning GG_ERROR_WOULD_BLOCK) until some of
+ * the queued responses have been sent. When responses are queued, a peer may not hold
+ * more than half of the queue, so that a single peer can't starve the others: new
+ * requests from a peer that exceeds its share are dropped.
+ *
+ * @param self The object on which this method is called.
+ * @param capacity Max number of queued responses (at least 1).
+ *
+ * @return GG_SUCCESS if the call succeeded, or a negative error code.
+ */
+GG_Result GG_CoapEndpoint_SetResponseQueueCapacity(GG_CoapEndpoint* self, size_t capacity);
+
+/**
+ * Get the statistics of the response queue.
+ *
+ * @param self The object on which this method is called.
+ * @param stats Pointer to the structure in which the statistics will be returned.
+ */
+void GG_CoapEndpoint_GetResponseQueueStats(GG_CoapEndpoint* self, GG_CoapResponseQueueStats* stats);
+
 /**
  * Create a CoAP response.
  * This is essentially the same as `GG_CoapEndpoint_CreateResponse` but using the endpoint
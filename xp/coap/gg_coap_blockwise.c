@@ -44,13 +44,29 @@ GG_SET_LOCAL_LOGGER("gg.xp.coap.blockwise")
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
+typedef struct GG_CoapBlockwiseRequestContext GG_CoapBlockwiseRequestContext;
 
 /**
- * Object used to keep track of the context associated with a blockwise transfer.
+ * Object used to keep track of an individual block request of a blockwise transfer.
+ * When several block requests are in flight, the response (or error) for a block may arrive
+ * before the one for an earlier block, in which case it is kept until it can be handled in order.
  */
 typedef struct {
     GG_IMPLEMENTS(GG_CoapResponseListener);
+
+    GG_CoapBlockwiseRequestContext* context;       ///< Transfer to which the block request belongs
+    GG_CoapRequestHandle            request;       ///< Handle of the request while it is in flight
+    size_t                          block2_offset; ///< Offset of the BLOCK2 block requested
+    GG_CoapMessage*                 response;      ///< Response kept until it can be handled
+    GG_Result                       error;         ///< Error kept until it can be handled
+} GG_CoapBlockwiseBlockRequest;
+
+/**
+ * Object used to keep track of the context associated with a blockwise transfer.
+ */
+struct GG_CoapBlockwiseRequestContext {
     GG_IMPLEMENTS(GG_BufferSource);
+    GG_IMPLEMENTS(GG_TimerListener);
 
     GG_LinkedListNode                 list_node;             ///< List node to allow linking this object
     GG_CoapEndpoint*                  endpoint;              ///< Endpoint to which the object belongs
@@ -60,18 +76,35 @@ typedef struct {
     GG_CoapBlockSource*               payload_source;        ///< Source of the request payload, or NULL
     uint32_t                          state;                 ///< Current blockwise transfer state
     size_t                            preferred_block_size;  ///< Preferred block size
-    GG_CoapMessageBlockInfo           block2_info;           ///< Values for the BLOCK2 option
-    GG_CoapMessageBlockInfo           block1_info;           ///< Values for the BLOCK1 option
-    size_t                            block1_payload_size;   ///< Size of the BLOCK1 payload
+    GG_CoapMessageBlockInfo           block2_info;           ///< Values for the BLOCK2 option of the next request
+    GG_CoapMessageBlockInfo           block1_info;           ///< Values for the BLOCK1 option of the next request
+    size_t                            block1_payload_size;   ///< Size of the BLOCK1 payload of the next request
+    bool                              block1_all_sent;       ///< True once the last BLOCK1 block has been sent
+    bool                              block1_size_agreed;    ///< True once the server has accepted a BLOCK1 block
+    bool                              block2_size_agreed;    ///< True once the server has returned a BLOCK2 block
     GG_CoapMessageOptionParam*        option_params;         ///< Request options in 'params' form
     size_t                            option_count;          ///< Number of options
-    GG_CoapRequestHandle              pending_request;       ///< Handle for the latest block request sent
     bool                              use_client_parameters; ///< True if this request should use custom parameters
     GG_CoapClientParameters           client_parameters;     ///< Custom client parameters
     uint8_t                           etag[GG_COAP_MESSAGE_MAX_ETAG_OPTION_SIZE]; ///< ETag
     size_t                            etag_size;                                  ///< ETag size
     bool*                             destroy_monitor;       ///< Optional monitor to catch this is destroyed
-} GG_CoapBlockwiseRequestContext;
+    size_t                            max_blocks_in_flight;  ///< Max number of block requests in flight
+    size_t                            first_block_request;   ///< Index of the oldest block request
+    size_t                            block_request_count;   ///< Number of block requests not yet handled
+    bool                              qblock;                ///< True when the Q-Block options are used
+    uint8_t                           qblock_token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH]; ///< Token of Q-Block2 responses
+    size_t                            qblock_token_length;   ///< Size of the token (0 until a response is received)
+    size_t                            qblock_set_start;      ///< Number of the first block of the payload set
+    size_t                            qblock_next_block;     ///< Next block to deliver (Q-Block2) or to send (Q-Block1)
+    bool                              qblock_request_set;    ///< True when the payload set must be requested (Q-Block2)
+    size_t                            qblock_send_list[GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS]; ///< Blocks to send
+    size_t                            qblock_send_count;     ///< Number of blocks in the send list
+    unsigned int                      qblock_recovery_count; ///< Recovery rounds since the last progress
+    GG_Timer*                         qblock_timer;          ///< Timer used to detect missing Q-Block2 blocks
+    GG_CoapMessage*                   qblock_responses[GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS]; ///< Blocks of the set
+    GG_CoapBlockwiseBlockRequest      block_requests[];      ///< Block requests, used as a ring
+};
 
 /*----------------------------------------------------------------------
 |   constants
@@ -83,7 +116,7 @@ typedef struct {
 /*----------------------------------------------------------------------
 |   forward declarations
 +---------------------------------------------------------------------*/
-static GG_Result GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(GG_CoapBlockwiseRequestContext* self);
+static void GG_CoapBlockwiseRequestContext_Pump(GG_CoapBlockwiseRequestContext* self);
 
 /*----------------------------------------------------------------------
 |   thunks
@@ -146,6 +179,28 @@ GG_CoapMessageBlockInfo_AdjustAndGetChunkSize(size_t offset, size_t* block_size,
     }
 }
 
+//----------------------------------------------------------------------
+// Cancel all the block requests still in flight, and drop any response or error
+// kept for block requests that completed out of order
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseRequestContext_CancelBlockRequests(GG_CoapBlockwiseRequestContext* self)
+{
+    for (size_t i = 0; i < self->block_request_count; i++) {
+        size_t index = (self->first_block_request + i) % self->max_blocks_in_flight;
+        GG_CoapBlockwiseBlockRequest* block_request = &self->block_requests[index];
+        if (block_request->request) {
+            GG_CoapEndpoint_CancelRequest(self->endpoint, block_request->request);
+            block_request->request = GG_COAP_INVALID_REQUEST_HANDLE;
+        }
+        GG_CoapMessage_Destroy(block_request->response);
+        block_request->response = NULL;
+        block_request->error    = GG_SUCCESS;
+    }
+    self->first_block_request = 0;
+    self->block_request_count = 0;
+}
+
 //----------------------------------------------------------------------
 static void
 GG_CoapBlockwiseRequestContext_Destroy(GG_CoapBlockwiseRequestContext* self)
@@ -156,8 +211,12 @@ GG_CoapBlockwiseRequestContext_Destroy(GG_CoapBlockwiseRequestContext* self)
     GG_LINKED_LIST_NODE_REMOVE(&self->list_node);
 
     // cancel any pending block request for this transfer
-    if (self->pending_request) {
-        GG_CoapEndpoint_CancelRequest(self->endpoint, self->pending_request);
+    GG_CoapBlockwiseRequestContext_CancelBlockRequests(self);
+
+    // release what's kept for Q-Block transfers
+    GG_Timer_Destroy(self->qblock_timer);
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->qblock_responses); i++) {
+        GG_CoapMessage_Destroy(self->qblock_responses[i]);
     }
 
     // cleanup parameters
@@ -171,7 +230,7 @@ GG_CoapBlockwiseRequestContext_Destroy(GG_CoapBlockwiseRequestContext* self)
     }
 
     // done
-    GG_ClearAndFreeObject(self, 2);
+    GG_ClearAndFreeObject(self, 1);
 }
 
 //----------------------------------------------------------------------
@@ -183,8 +242,10 @@ GG_CoapMessage_GetBlockInfo(const GG_CoapMessage*    self,
 {
     GG_ASSERT(self);
     GG_ASSERT(block_info);
-    GG_ASSERT(block_option_number == GG_COAP_MESSAGE_OPTION_BLOCK1 ||
-              block_option_number == GG_COAP_MESSAGE_OPTION_BLOCK2);
+    GG_ASSERT(block_option_number == GG_COAP_MESSAGE_OPTION_BLOCK1  ||
+              block_option_number == GG_COAP_MESSAGE_OPTION_BLOCK2  ||
+              block_option_number == GG_COAP_MESSAGE_OPTION_QBLOCK1 ||
+              block_option_number == GG_COAP_MESSAGE_OPTION_QBLOCK2);
 
     // init the info
     *block_info = (GG_CoapMessageBlockInfo) { 0 };
@@ -249,6 +310,60 @@ GG_CoapMessageBlockInfo_ToOptionValue(const GG_CoapMessageBlockInfo* blockwise_i
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Encode a block number as a CBOR unsigned integer
+// (the payload of a 4.08 Q-Block1 response is a CBOR sequence of the missing block numbers)
+//----------------------------------------------------------------------
+static size_t
+GG_CoapBlockwise_EncodeBlockNumber(uint32_t block, uint8_t* buffer)
+{
+    if (block < 24) {
+        buffer[0] = (uint8_t)block;
+        return 1;
+    } else if (block <= 0xFF) {
+        buffer[0] = 0x18;
+        buffer[1] = (uint8_t)block;
+        return 2;
+    } else if (block <= 0xFFFF) {
+        buffer[0] = 0x19;
+        GG_BytesFromInt16Be(&buffer[1], (uint16_t)block);
+        return 3;
+    } else {
+        buffer[0] = 0x1A;
+        GG_BytesFromInt32Be(&buffer[1], block);
+        return 5;
+    }
+}
+
+//----------------------------------------------------------------------
+// Decode a block number from a CBOR sequence, and advance past it
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwise_DecodeBlockNumber(const uint8_t** data, size_t* data_size, uint32_t* block)
+{
+    const uint8_t* bytes = *data;
+    size_t         size;
+    if (*data_size >= 1 && bytes[0] < 24) {
+        *block = bytes[0];
+        size = 1;
+    } else if (*data_size >= 2 && bytes[0] == 0x18) {
+        *block = bytes[1];
+        size = 2;
+    } else if (*data_size >= 3 && bytes[0] == 0x19) {
+        *block = GG_BytesToInt16Be(&bytes[1]);
+        size = 3;
+    } else if (*data_size >= 5 && bytes[0] == 0x1A) {
+        *block = GG_BytesToInt32Be(&bytes[1]);
+        size = 5;
+    } else {
+        return GG_ERROR_INVALID_FORMAT;
+    }
+    *data      += size;
+    *data_size -= size;
+
+    return GG_SUCCESS;
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_CoapEndpoint_CreateBlockwiseResponse(GG_CoapEndpoint*               self,
@@ -299,23 +414,21 @@ GG_CoapEndpoint_CreateBlockwiseResponse(GG_CoapEndpoint*               self,
 }
 
 //----------------------------------------------------------------------
-GG_Result
-GG_CoapEndpoint_CreateBlockwiseResponseFromBlockSource(GG_CoapEndpoint*               self,
-                                                       const GG_CoapMessage*          request,
-                                                       uint8_t                        code,
-                                                       GG_CoapMessageOptionParam*     options,
-                                                       size_t                         options_count,
-                                                       GG_CoapBlockSource*            payload_source,
-                                                       uint32_t                       block_option_number,
-                                                       const GG_CoapMessageBlockInfo* block_info,
-                                                       GG_CoapMessage**               response)
+// Create a response with a payload supplied by a block source, either as an ACK
+// (piggybacked response) or as a NON message with a new message ID.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapEndpoint_CreateBlockResponseFromBlockSource(GG_CoapEndpoint*               self,
+                                                   const GG_CoapMessage*          request,
+                                                   GG_CoapMessageType             type,
+                                                   uint8_t                        code,
+                                                   GG_CoapMessageOptionParam*     options,
+                                                   size_t                         options_count,
+                                                   GG_CoapBlockSource*            payload_source,
+                                                   uint32_t                       block_option_number,
+                                                   const GG_CoapMessageBlockInfo* block_info,
+                                                   GG_CoapMessage**               response)
 {
-    GG_ASSERT(self);
-    GG_ASSERT(request);
-    GG_ASSERT(payload_source);
-    GG_ASSERT(block_info);
-    GG_ASSERT(response);
-
     GG_Result result;
 
     // get the block info
@@ -345,14 +458,29 @@ GG_CoapEndpoint_CreateBlockwiseResponseFromBlockSource(GG_CoapEndpoint*
     };
 
     // create the response message without specifying the payload yet (only its size)
-    result = GG_CoapEndpoint_CreateResponse(self,
-                                            request,
-                                            code,
-                                            &option_param,
-                                            options_count + 1,
-                                            NULL,
-                                            payload_size,
-                                            response);
+    if (type == GG_COAP_MESSAGE_TYPE_ACK) {
+        result = GG_CoapEndpoint_CreateResponse(self,
+                                                request,
+                                                code,
+                                                &option_param,
+                                                options_count + 1,
+                                                NULL,
+                                                payload_size,
+                                                response);
+    } else {
+        uint8_t token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+        size_t  token_length = GG_CoapMessage_GetToken(request, token);
+        result = GG_CoapMessage_Create(code,
+                                       type,
+                                       &option_param,
+                                       options_count + 1,
+                                       self->message_id_counter++,
+                                       token,
+                                       token_length,
+                                       NULL,
+                                       payload_size,
+                                       response);
+    }
     if (GG_FAILED(result)) {
         return result;
     }
@@ -372,11 +500,54 @@ GG_CoapEndpoint_CreateBlockwiseResponseFromBlockSource(GG_CoapEndpoint*
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_CreateBlockwiseResponseFromBlockSource(GG_CoapEndpoint*               self,
+                                                       const GG_CoapMessage*          request,
+                                                       uint8_t                        code,
+                                                       GG_CoapMessageOptionParam*     options,
+                                                       size_t                         options_count,
+                                                       GG_CoapBlockSource*            payload_source,
+                                                       uint32_t                       block_option_number,
+                                                       const GG_CoapMessageBlockInfo* block_info,
+                                                       GG_CoapMessage**               response)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(request);
+    GG_ASSERT(payload_source);
+    GG_ASSERT(block_info);
+    GG_ASSERT(response);
+
+    return GG_CoapEndpoint_CreateBlockResponseFromBlockSource(self,
+                                                              request,
+                                                              GG_COAP_MESSAGE_TYPE_ACK,
+                                                              code,
+                                                              options,
+                                                              options_count,
+                                                              payload_source,
+                                                              block_option_number,
+                                                              block_info,
+                                                              response);
+}
+
+//----------------------------------------------------------------------
+// Get a block request by its position in the ring (0 being the oldest one)
+//----------------------------------------------------------------------
+static GG_CoapBlockwiseBlockRequest*
+GG_CoapBlockwiseRequestContext_GetBlockRequest(GG_CoapBlockwiseRequestContext* self, size_t position)
+{
+    return &self->block_requests[(self->first_block_request + position) % self->max_blocks_in_flight];
+}
+
+//----------------------------------------------------------------------
+// Remove the oldest block request from the ring
 //----------------------------------------------------------------------
 static void
-GG_CoapBlockwiseRequestContext_OnAck(GG_CoapResponseListener* _self)
+GG_CoapBlockwiseRequestContext_RemoveFirstBlockRequest(GG_CoapBlockwiseRequestContext* self)
 {
-    GG_COMPILER_UNUSED(_self);
+    GG_ASSERT(self->block_request_count);
+    self->first_block_request = (self->first_block_request + 1) % self->max_blocks_in_flight;
+    --self->block_request_count;
 }
 
 //----------------------------------------------------------------------
@@ -390,10 +561,12 @@ GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(GG_CoapBlockwiseRequestCo
     // notify the listener
     // NOTE: we setup a monitor so that we can detect if the listener has canceled this request,
     // in which case the `self` object here will have been destroyed when the `OnResponseBlock`
-    // callback returns
+    // callback returns. A monitor may already be setup by the caller, in which case we need to
+    // pass the information along.
     if (self->listener) {
         // setup a destroy monitor
-        bool destroy_monitor = false;
+        bool* outer_destroy_monitor = self->destroy_monitor;
+        bool  destroy_monitor       = false;
         self->destroy_monitor = &destroy_monitor;
 
         // invoke the listener
@@ -402,30 +575,20 @@ GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(GG_CoapBlockwiseRequestCo
         // check if this context has been destroyed and exit now if it has
         if (destroy_monitor) {
             GG_LOG_FINE("the request has been canceled by the listener, bailing out");
+            if (outer_destroy_monitor) {
+                *outer_destroy_monitor = true;
+            }
             return;
         }
 
-        // remove the monitor
-        self->destroy_monitor = NULL;
+        // restore the previous monitor
+        self->destroy_monitor = outer_destroy_monitor;
     }
 
     // done with this request
     GG_CoapBlockwiseRequestContext_Destroy(self);
 }
 
-//----------------------------------------------------------------------
-// Callback invoked when an error occurs with an individual request
-//----------------------------------------------------------------------
-static void
-GG_CoapBlockwiseRequestContext_OnError(GG_CoapResponseListener* _self, GG_Result error, const char* message)
-{
-    GG_CoapBlockwiseRequestContext* self = GG_SELF(GG_CoapBlockwiseRequestContext, GG_CoapResponseListener);
-
-    GG_LOG_FINE("blockwise error: %d %s", error, message ? message : "");
-
-    GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, error, message);
-}
-
 //----------------------------------------------------------------------
 // Deal with 2.31 responses (GG_COAP_MESSAGE_CODE_CONTINUE)
 //----------------------------------------------------------------------
@@ -446,24 +609,34 @@ GG_CoapBlockwiseRequestContext_OnContinueResponse(GG_CoapBlockwiseRequestContext
                 (int)block_info.size,
                 block_info.more ? "true" : "false");
 
-    // prepare for the next block, taking into account the fact that the server may have responded
-    // with a block size that is different from what we passed in the request.
-    self->block1_info.offset += self->block1_payload_size;
-    self->block1_info.size    = GG_MIN(self->block1_info.size, block_info.size);
-    self->block1_payload_size = self->block1_info.size;
-
-    result = GG_CoapBlockSource_GetDataSize(self->payload_source,
-                                            self->block1_info.offset,
-                                            &self->block1_payload_size,
-                                            &self->block1_info.more);
-    if (GG_FAILED(result)) {
-        GG_LOG_WARNING("Could not get data size (%d)", result);
-        GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, result, NULL);
+    // a 2.31 response to the last block, with no other block in flight, leaves us with nothing to send
+    if (self->block1_all_sent && self->block_request_count == 0) {
+        GG_LOG_WARNING("unexpected 2.31 response after the last BLOCK1 block");
+        GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_INVALID_RESPONSE, NULL);
         return;
     }
 
-    // request the next block
-    GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(self);
+    // now that the server has accepted a block, we can start sending several blocks at a time
+    self->block1_size_agreed = true;
+
+    // the next block to send has already been prepared when this one was sent, but we need to take
+    // into account the fact that the server may have responded with a block size that is different
+    // from what we passed in the request.
+    if (block_info.size < self->block1_info.size) {
+        self->block1_info.size = block_info.size;
+        if (!self->block1_all_sent) {
+            self->block1_payload_size = self->block1_info.size;
+            result = GG_CoapBlockSource_GetDataSize(self->payload_source,
+                                                    self->block1_info.offset,
+                                                    &self->block1_payload_size,
+                                                    &self->block1_info.more);
+            if (GG_FAILED(result)) {
+                GG_LOG_WARNING("Could not get data size (%d)", result);
+                GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, result, NULL);
+                return;
+            }
+        }
+    }
 }
 
 //----------------------------------------------------------------------
@@ -473,6 +646,7 @@ GG_CoapBlockwiseRequestContext_OnContinueResponse(GG_CoapBlockwiseRequestContext
 //----------------------------------------------------------------------
 static void
 GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseRequestContext* self,
+                                                               size_t                          block2_offset,
                                                                GG_CoapMessage*                 response)
 {
     if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) {
@@ -481,6 +655,9 @@ GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseR
         // For now, just assume that a success response is only sent when the BLOCK1 transfer is completed
         GG_LOG_FINE("BLOCK1 request phase completed");
         self->state ^= GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE;
+
+        // any other BLOCK1 block still in flight is no longer needed
+        GG_CoapBlockwiseRequestContext_CancelBlockRequests(self);
     }
 
     GG_CoapMessageBlockInfo block2_info;
@@ -488,7 +665,7 @@ GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseR
     if (GG_FAILED(result)) {
         if (result == GG_ERROR_NO_SUCH_ITEM) {
             // BLOCK2 option not present, treat this as a "last block" response if this is the first (and only) block
-            if (self->block2_info.offset == 0) {
+            if (block2_offset == 0) {
                 GG_LOG_FINE("non-blockwise response, simulating a block response");
 
                 // synthesize a BLOCK2 option
@@ -524,10 +701,10 @@ GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseR
                 block2_info.more ? "true" : "false");
 
     // check that this is the response we expect
-    if (block2_info.offset != self->block2_info.offset) {
+    if (block2_info.offset != block2_offset) {
         GG_LOG_WARNING("received out of sequence block (offset = %u vs %u)",
                        (int)block2_info.offset,
-                       (int)self->block2_info.offset);
+                       (int)block2_offset);
         GG_LOG_COMMS_ERROR(GG_LIB_COAP_UNEXPECTED_BLOCK);
         GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_UNEXPECTED_BLOCK, NULL);
         return;
@@ -539,7 +716,8 @@ GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseR
     // callback returns
     if (self->listener) {
         // setup a destroy monitor
-        bool destroy_monitor = false;
+        bool* outer_destroy_monitor = self->destroy_monitor;
+        bool  destroy_monitor       = false;
         self->destroy_monitor = &destroy_monitor;
 
         // invoke the listener
@@ -548,11 +726,14 @@ GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseR
         // check if this context has been destroyed and exit now if it has
         if (destroy_monitor) {
             GG_LOG_FINE("the request has been canceled by the listener, bailing out");
+            if (outer_destroy_monitor) {
+                *outer_destroy_monitor = true;
+            }
             return;
         }
 
-        // remove the monitor
-        self->destroy_monitor = NULL;
+        // restore the previous monitor
+        self->destroy_monitor = outer_destroy_monitor;
     }
 
     // decide what to do next
@@ -561,14 +742,24 @@ GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseR
         GG_LOG_FINE("continuing BLOCK2 request phase");
         self->state |= GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK2_ACTIVE;
 
-        // prepare to request the next block
-        self->block2_info         = block2_info;
-        self->block2_info.offset += self->block2_info.size;
-        self->block2_info.more    = false; // The RFC says: in this case the M bit has
-                                           // no function and MUST be set to zero.
+        // if the block requests in flight aren't for the blocks that follow this one (because this is
+        // the first block, or the server changed the block size), start again from the next block
+        size_t next_offset = block2_info.offset + block2_info.size;
+        if (!self->block2_size_agreed ||
+            block2_info.size != self->block2_info.size ||
+            self->block_request_count == 0 ||
+            GG_CoapBlockwiseRequestContext_GetBlockRequest(self, 0)->block2_offset != next_offset) {
+            GG_CoapBlockwiseRequestContext_CancelBlockRequests(self);
+
+            // prepare to request the next block
+            self->block2_info        = block2_info;
+            self->block2_info.offset = next_offset;
+            self->block2_info.more   = false; // The RFC says: in this case the M bit has
+                                              // no function and MUST be set to zero.
+        }
 
-        // request the next block
-        GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(self);
+        // now that the block size is known, we can request several blocks at a time
+        self->block2_size_agreed = true;
     } else {
         GG_LOG_FINE("BLOCK2 request phase completed");
         self->state &= ~GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK2_ACTIVE;
@@ -577,23 +768,193 @@ GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(GG_CoapBlockwiseR
     // check if we're done
     if (!(self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) &&
         !(self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK2_ACTIVE)) {
-        // done with this request
+        // done with this request (this also cancels any block requested past the last one)
         GG_LOG_FINE("no more BLOCK transfer active, done with request");
         GG_CoapBlockwiseRequestContext_Destroy(self);
     }
 }
 
+//----------------------------------------------------------------------
+// Deal with responses to the CON request that ends each batch of Q-Block1 blocks
 //----------------------------------------------------------------------
 static void
-GG_CoapBlockwiseRequestContext_OnResponse(GG_CoapResponseListener* _self, GG_CoapMessage* response)
+GG_CoapBlockwiseRequestContext_OnQBlock1Response(GG_CoapBlockwiseRequestContext* self, GG_CoapMessage* response)
 {
-    GG_CoapBlockwiseRequestContext* self = GG_SELF(GG_CoapBlockwiseRequestContext, GG_CoapResponseListener);
+    uint8_t code = GG_CoapMessage_GetCode(response);
 
-    GG_LOG_FINE("blockwise response");
+    // 2.31: the server has all the blocks sent so far, move on to the next payload set
+    if (code == GG_COAP_MESSAGE_CODE_CONTINUE) {
+        if (self->block1_all_sent) {
+            GG_LOG_WARNING("unexpected 2.31 response after the last Q-Block1 block");
+            GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_INVALID_RESPONSE, NULL);
+            return;
+        }
+        for (size_t i = 0; i < GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS; i++) {
+            self->qblock_send_list[i] = self->qblock_next_block + i;
+        }
+        self->qblock_send_count     = GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS;
+        self->qblock_recovery_count = 0;
+        return;
+    }
+
+    // 4.08 with a list of missing blocks: send those blocks again
+    GG_CoapMessageOption format_option;
+    if (code == GG_COAP_MESSAGE_CODE_REQUEST_ENTITY_INCOMPLETE &&
+        GG_SUCCEEDED(GG_CoapMessage_GetOption(response, GG_COAP_MESSAGE_OPTION_CONTENT_FORMAT, &format_option, 0)) &&
+        format_option.value.uint == GG_COAP_MESSAGE_FORMAT_ID_MISSING_BLOCKS) {
+        if (self->qblock_recovery_count++ == GG_CONFIG_COAP_QBLOCK_MAX_RECOVERY_ROUNDS) {
+            GG_LOG_WARNING("too many missing Q-Block1 blocks");
+            GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_SEND_FAILURE, NULL);
+            return;
+        }
+
+        const uint8_t* payload      = GG_CoapMessage_GetPayload(response);
+        size_t         payload_size = GG_CoapMessage_GetPayloadSize(response);
+        self->qblock_send_count = 0;
+        while (payload_size && self->qblock_send_count < GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS) {
+            uint32_t block;
+            if (GG_FAILED(GG_CoapBlockwise_DecodeBlockNumber(&payload, &payload_size, &block)) ||
+                block >= self->qblock_next_block) {
+                self->qblock_send_count = 0;
+                break;
+            }
+            self->qblock_send_list[self->qblock_send_count++] = block;
+        }
+        if (self->qblock_send_count == 0) {
+            GG_LOG_WARNING("invalid list of missing Q-Block1 blocks");
+            GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_INVALID_RESPONSE, NULL);
+        }
+        return;
+    }
 
-    // clear the previous handle
-    self->pending_request = 0;
+    // any other response ends the Q-Block1 phase, like a final response to the last BLOCK1 block
+    self->qblock = false;
+    GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(self, 0, response);
+}
+
+//----------------------------------------------------------------------
+// Deal with Q-Block2 responses, keeping each new block of the current payload set
+// until it can be delivered in order
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseRequestContext_OnQBlock2Response(GG_CoapBlockwiseRequestContext* self, GG_CoapMessage* response)
+{
+    GG_CoapMessageBlockInfo block_info;
+    GG_Result result = GG_CoapMessage_GetBlockInfo(response, GG_COAP_MESSAGE_OPTION_QBLOCK2, &block_info, 0);
+    if (GG_FAILED(result)) {
+        if (result == GG_ERROR_NO_SUCH_ITEM && !self->block2_size_agreed) {
+            // the server doesn't do Q-Block2 for this resource, carry on like a classic request
+            GG_LOG_FINE("no Q-Block2 option in the first response, switching to BLOCK2");
+            self->qblock = false;
+            GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(self, 0, response);
+        } else {
+            GG_LOG_WARNING("missing or invalid Q-Block2 option (%d)", result);
+            GG_LOG_COMMS_ERROR_CODE(GG_LIB_COAP_INVALID_RESPONSE, result);
+            GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_INVALID_RESPONSE, NULL);
+        }
+        return;
+    }
+
+    // the block size is set by the first block received, and may not change after that
+    if (!self->block2_size_agreed) {
+        self->block2_info.size   = block_info.size;
+        self->block2_size_agreed = true;
+    } else if (block_info.size != self->block2_info.size) {
+        GG_LOG_WARNING("Q-Block2 block size changed (%u vs %u)", (int)block_info.size, (int)self->block2_info.size);
+        GG_LOG_COMMS_ERROR(GG_LIB_COAP_UNEXPECTED_BLOCK);
+        GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_UNEXPECTED_BLOCK, NULL);
+        return;
+    }
+    size_t block = block_info.offset / block_info.size;
+    GG_LOG_FINE("Q-Block2 block %u, more=%s", (int)block, block_info.more ? "true" : "false");
+
+    // ignore blocks that were already received, or that aren't part of the current payload set
+    if (block < self->qblock_next_block ||
+        block >= self->qblock_set_start + GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS ||
+        self->qblock_responses[block - self->qblock_set_start]) {
+        GG_LOG_FINER("ignoring block");
+        return;
+    }
+
+    // keep a copy of the block
+    GG_Buffer* datagram = NULL;
+    result = GG_CoapMessage_ToDatagram(response, &datagram);
+    if (GG_SUCCEEDED(result)) {
+        result = GG_CoapMessage_CreateFromDatagram(datagram, &self->qblock_responses[block - self->qblock_set_start]);
+        GG_Buffer_Release(datagram);
+    }
+    if (GG_FAILED(result)) {
+        GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, result, NULL);
+        return;
+    }
+
+    // this is progress
+    self->qblock_recovery_count = 0;
+}
+
+//----------------------------------------------------------------------
+// Deliver, in order, the Q-Block2 blocks received so far
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseRequestContext_DeliverQBlock2Blocks(GG_CoapBlockwiseRequestContext* self)
+{
+    while (!(self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED)) {
+        // once the whole set has been delivered, the next one can be requested
+        size_t index = self->qblock_next_block - self->qblock_set_start;
+        if (index == GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS) {
+            self->qblock_set_start   = self->qblock_next_block;
+            self->qblock_request_set = true;
+            return;
+        }
+
+        // stop at the first missing block
+        GG_CoapMessage* response = self->qblock_responses[index];
+        if (response == NULL) {
+            return;
+        }
+        self->qblock_responses[index] = NULL;
+        ++self->qblock_next_block;
+
+        // notify the listener
+        // NOTE: we setup a monitor so that we can detect if the listener has canceled this request
+        GG_CoapMessageBlockInfo block_info;
+        GG_CoapMessage_GetBlockInfo(response, GG_COAP_MESSAGE_OPTION_QBLOCK2, &block_info, 0);
+        if (self->listener) {
+            bool* outer_destroy_monitor = self->destroy_monitor;
+            bool  destroy_monitor       = false;
+            self->destroy_monitor = &destroy_monitor;
+
+            GG_CoapBlockwiseResponseListener_OnResponseBlock(self->listener, &block_info, response);
+            GG_CoapMessage_Destroy(response);
+
+            if (destroy_monitor) {
+                GG_LOG_FINE("the request has been canceled by the listener, bailing out");
+                if (outer_destroy_monitor) {
+                    *outer_destroy_monitor = true;
+                }
+                return;
+            }
+            self->destroy_monitor = outer_destroy_monitor;
+        } else {
+            GG_CoapMessage_Destroy(response);
+        }
+
+        // check if we're done
+        if (!block_info.more) {
+            GG_LOG_FINE("Q-Block2 transfer completed");
+            GG_CoapBlockwiseRequestContext_Destroy(self);
+            return;
+        }
+    }
+}
 
+//----------------------------------------------------------------------
+// Check the ETag of a response against the one of the transfer.
+// Returns false if the transfer was terminated.
+//----------------------------------------------------------------------
+static bool
+GG_CoapBlockwiseRequestContext_CheckEtag(GG_CoapBlockwiseRequestContext* self, GG_CoapMessage* response)
+{
     // check if the response has an ETag
     GG_CoapMessageOption etag_option;
     GG_Result result = GG_CoapMessage_GetOption(response, GG_COAP_MESSAGE_OPTION_ETAG, &etag_option, 0);
@@ -604,7 +965,7 @@ GG_CoapBlockwiseRequestContext_OnResponse(GG_CoapResponseListener* _self, GG_Coa
         if (etag_option.value.opaque.size > GG_COAP_MESSAGE_MAX_ETAG_OPTION_SIZE) {
             GG_LOG_WARNING("invalid ETag option size");
             GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_INVALID_RESPONSE, NULL);
-            return;
+            return false;
         }
 
         // compare against our ETag field
@@ -614,7 +975,7 @@ GG_CoapBlockwiseRequestContext_OnResponse(GG_CoapResponseListener* _self, GG_Coa
                 // not the same ETag
                 GG_LOG_FINE("ETag mismatch");
                 GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_COAP_ETAG_MISMATCH, NULL);
-                return;
+                return false;
             }
         } else {
             // remember this ETag
@@ -623,25 +984,43 @@ GG_CoapBlockwiseRequestContext_OnResponse(GG_CoapResponseListener* _self, GG_Coa
         }
     }
 
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Handle the response for a block request, in the order in which the blocks were requested
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseRequestContext_HandleResponse(GG_CoapBlockwiseRequestContext* self,
+                                              size_t                          block2_offset,
+                                              GG_CoapMessage*                 response)
+{
+    if (!GG_CoapBlockwiseRequestContext_CheckEtag(self, response)) {
+        return;
+    }
+
+    // Q-Block responses are handled separately
+    if (self->qblock) {
+        if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) {
+            GG_CoapBlockwiseRequestContext_OnQBlock1Response(self, response);
+        } else {
+            GG_CoapBlockwiseRequestContext_OnQBlock2Response(self, response);
+        }
+        return;
+    }
+
     // handle the response as a "continue" or "final" response
     uint8_t code = GG_CoapMessage_GetCode(response);
     if (code == GG_COAP_MESSAGE_CODE_CONTINUE) {
         GG_CoapBlockwiseRequestContext_OnContinueResponse(self, response);
     } else {
-        GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(self, response);
+        GG_CoapBlockwiseRequestContext_OnResponseWithFinalResponseCode(self, block2_offset, response);
     }
 
     // NOTE: never access `self` past this point, because the request may have been
     // canceled by now, and `self` would be destroyed as a result.
 }
 
-//----------------------------------------------------------------------
-GG_IMPLEMENT_INTERFACE(GG_CoapBlockwiseRequestContext, GG_CoapResponseListener) {
-    .OnAck      = GG_CoapBlockwiseRequestContext_OnAck,
-    .OnError    = GG_CoapBlockwiseRequestContext_OnError,
-    .OnResponse = GG_CoapBlockwiseRequestContext_OnResponse
-};
-
 //----------------------------------------------------------------------
 static size_t
 GG_CoapBlockwiseRequestContext_GetDataSize(const GG_BufferSource* _self)
@@ -670,20 +1049,107 @@ GG_IMPLEMENT_INTERFACE(GG_CoapBlockwiseRequestContext, GG_BufferSource) {
     .GetData     = GG_CoapBlockwiseRequestContext_GetData
 };
 
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseBlockRequest_OnAck(GG_CoapResponseListener* _self)
+{
+    GG_COMPILER_UNUSED(_self);
+}
+
+//----------------------------------------------------------------------
+// Callback invoked when an error occurs with an individual block request
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseBlockRequest_OnError(GG_CoapResponseListener* _self, GG_Result error, const char* message)
+{
+    GG_CoapBlockwiseBlockRequest*   self    = GG_SELF(GG_CoapBlockwiseBlockRequest, GG_CoapResponseListener);
+    GG_CoapBlockwiseRequestContext* context = self->context;
+
+    GG_LOG_FINE("blockwise error: %d %s", error, message ? message : "");
+
+    // this request is no longer in flight
+    self->request = GG_COAP_INVALID_REQUEST_HANDLE;
+
+    // keep the error for later if earlier blocks haven't been handled yet or if we're paused
+    if (self != GG_CoapBlockwiseRequestContext_GetBlockRequest(context, 0) ||
+        (context->state & GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED)) {
+        self->error = error;
+        return;
+    }
+
+    GG_CoapBlockwiseRequestContext_RemoveFirstBlockRequest(context);
+    GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(context, error, message);
+}
+
+//----------------------------------------------------------------------
+// Callback invoked when a response is received for an individual block request
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseBlockRequest_OnResponse(GG_CoapResponseListener* _self, GG_CoapMessage* response)
+{
+    GG_CoapBlockwiseBlockRequest*   self    = GG_SELF(GG_CoapBlockwiseBlockRequest, GG_CoapResponseListener);
+    GG_CoapBlockwiseRequestContext* context = self->context;
+
+    GG_LOG_FINE("blockwise response");
+
+    // this request is no longer in flight
+    self->request = GG_COAP_INVALID_REQUEST_HANDLE;
+
+    // Q-Block2 servers send more responses with the same token, remember it so we can recognize them
+    if (context->qblock) {
+        context->qblock_token_length = GG_CoapMessage_GetToken(response, context->qblock_token);
+    }
+
+    // keep a copy of the response for later if earlier blocks haven't been handled yet or if we're paused
+    if (self != GG_CoapBlockwiseRequestContext_GetBlockRequest(context, 0) ||
+        (context->state & GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED)) {
+        GG_LOG_FINER("keeping response for later");
+        GG_Buffer* datagram = NULL;
+        GG_Result  result   = GG_CoapMessage_ToDatagram(response, &datagram);
+        if (GG_SUCCEEDED(result)) {
+            result = GG_CoapMessage_CreateFromDatagram(datagram, &self->response);
+            GG_Buffer_Release(datagram);
+        }
+        if (GG_FAILED(result)) {
+            self->error = result;
+        }
+        return;
+    }
+
+    // handle the response now, and continue with the blocks that follow if it didn't terminate the transfer
+    GG_CoapBlockwiseRequestContext_RemoveFirstBlockRequest(context);
+    bool* outer_destroy_monitor = context->destroy_monitor;
+    bool  destroy_monitor       = false;
+    context->destroy_monitor = &destroy_monitor;
+    GG_CoapBlockwiseRequestContext_HandleResponse(context, self->block2_offset, response);
+    if (destroy_monitor) {
+        if (outer_destroy_monitor) {
+            *outer_destroy_monitor = true;
+        }
+        return;
+    }
+    context->destroy_monitor = outer_destroy_monitor;
+
+    GG_CoapBlockwiseRequestContext_Pump(context);
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_CoapBlockwiseBlockRequest, GG_CoapResponseListener) {
+    .OnAck      = GG_CoapBlockwiseBlockRequest_OnAck,
+    .OnError    = GG_CoapBlockwiseBlockRequest_OnError,
+    .OnResponse = GG_CoapBlockwiseBlockRequest_OnResponse
+};
+
+//----------------------------------------------------------------------
+// Send a request for the block at the current BLOCK1/BLOCK2 position
 //----------------------------------------------------------------------
 static GG_Result
-GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(GG_CoapBlockwiseRequestContext* self)
+GG_CoapBlockwiseRequestContext_SendBlockRequest(GG_CoapBlockwiseRequestContext* self)
 {
     GG_CoapMessageOptionParam option_params[3];
     size_t                    option_count = 0;
     uint32_t                  block_option_value;
 
-    // do nothing if the request is paused
-    if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED) {
-        GG_LOG_FINE("request is paused, doing nothing now");
-        return GG_SUCCESS;
-    }
-
     // init the option params array
     memset(option_params, 0, sizeof(option_params));
 
@@ -733,6 +1199,13 @@ GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(GG_CoapBlockwiseRequestConte
         linked_option_count = self->option_count;
     }
 
+    // take the next free block request in the ring
+    // (it is accounted for before sending, in case the response comes back before the send call returns)
+    GG_CoapBlockwiseBlockRequest* block_request =
+        GG_CoapBlockwiseRequestContext_GetBlockRequest(self, self->block_request_count);
+    block_request->block2_offset = self->block2_info.offset;
+    ++self->block_request_count;
+
     // send the request
     GG_Result result;
     if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) {
@@ -744,8 +1217,8 @@ GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(GG_CoapBlockwiseRequestConte
                                                              self->use_client_parameters ?
                                                              &self->client_parameters :
                                                              NULL,
-                                                             GG_CAST(self, GG_CoapResponseListener),
-                                                             &self->pending_request);
+                                                             GG_CAST(block_request, GG_CoapResponseListener),
+                                                             &block_request->request);
     } else {
         result = GG_CoapEndpoint_SendRequest(self->endpoint,
                                              self->method,
@@ -754,38 +1227,467 @@ GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(GG_CoapBlockwiseRequestConte
                                              NULL,
                                              0,
                                              self->use_client_parameters ? &self->client_parameters : NULL,
-                                             GG_CAST(self, GG_CoapResponseListener),
-                                             &self->pending_request);
+                                             GG_CAST(block_request, GG_CoapResponseListener),
+                                             &block_request->request);
+    }
+    if (GG_FAILED(result)) {
+        block_request->request = GG_COAP_INVALID_REQUEST_HANDLE;
+        --self->block_request_count;
     }
 
     return result;
 }
 
 //----------------------------------------------------------------------
-GG_Result
-GG_CoapEndpoint_SendBlockwiseRequest(GG_CoapEndpoint*                  self,
-                                     GG_CoapMethod                     method,
-                                     GG_CoapMessageOptionParam*        options,
-                                     size_t                            options_count,
-                                     GG_CoapBlockSource*               payload_source,
-                                     size_t                            preferred_block_size,
-                                     const GG_CoapClientParameters*    client_parameters,
-                                     GG_CoapBlockwiseResponseListener* listener,
-                                     GG_CoapRequestHandle*             request_handle)
+// Send a request with Q-Block options.
+// CON requests are tracked like other block requests, NON requests (for Q-Block1 blocks)
+// are sent without expecting a response.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseRequestContext_SendQBlockRequest(GG_CoapBlockwiseRequestContext* self,
+                                                 GG_CoapMessageType              type,
+                                                 GG_CoapMessageOptionParam*      block_options,
+                                                 size_t                          block_option_count)
 {
-    GG_THREAD_GUARD_CHECK_BINDING(self);
+    // link an If-Match option if we have an ETag, and the request's client options
+    GG_CoapMessageOptionParam  if_match_option = GG_COAP_MESSAGE_OPTION_PARAM_OPAQUE(IF_MATCH,
+                                                                                    self->etag,
+                                                                                    self->etag_size);
+    GG_CoapMessageOptionParam* last_option     = &block_options[block_option_count - 1];
+    size_t                     option_count    = block_option_count + self->option_count;
+    if (self->etag_size) {
+        last_option->next = &if_match_option;
+        last_option       = &if_match_option;
+        ++option_count;
+    }
+    last_option->next = self->option_params;
+
+    GG_Result result;
+    if (type == GG_COAP_MESSAGE_TYPE_CON) {
+        // take the block request slot (accounted for before sending, in case the response comes
+        // back before the send call returns)
+        GG_CoapBlockwiseBlockRequest* block_request = GG_CoapBlockwiseRequestContext_GetBlockRequest(self, 0);
+        GG_ASSERT(self->block_request_count == 0);
+        ++self->block_request_count;
+
+        bool block1_active = (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) != 0;
+        result = GG_CoapEndpoint_SendRequestFromBufferSource(self->endpoint,
+                                                             self->method,
+                                                             block_options,
+                                                             option_count,
+                                                             block1_active ? GG_CAST(self, GG_BufferSource) : NULL,
+                                                             self->use_client_parameters ?
+                                                             &self->client_parameters :
+                                                             NULL,
+                                                             GG_CAST(block_request, GG_CoapResponseListener),
+                                                             &block_request->request);
+        if (GG_FAILED(result)) {
+            block_request->request = GG_COAP_INVALID_REQUEST_HANDLE;
+            --self->block_request_count;
+        }
+        return result;
+    }
+
+    // NON requests aren't tracked by the endpoint, so we create and send the message ourselves
+    uint8_t         token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    size_t          token_length = GG_CoapEndpoint_CreateToken(self->endpoint, token);
+    GG_CoapMessage* request      = NULL;
+    result = GG_CoapMessage_Create((uint8_t)self->method,
+                                   type,
+                                   block_options,
+                                   option_count,
+                                   self->endpoint->message_id_counter++,
+                                   token,
+                                   token_length,
+                                   NULL,
+                                   self->block1_payload_size,
+                                   &request);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+    if (self->block1_payload_size) {
+        result = GG_CoapBlockSource_GetData(self->payload_source,
+                                            self->block1_info.offset,
+                                            self->block1_payload_size,
+                                            GG_CoapMessage_UsePayload(request));
+    }
+    if (GG_SUCCEEDED(result)) {
+        result = GG_CoapEndpoint_SendMessage(self->endpoint, request, NULL);
+    }
+    GG_CoapMessage_Destroy(request);
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Send the Q-Block1 blocks of the send list.
+// All but the last one are sent as NON requests. The last one, or the last block
+// of the payload if it comes first, is sent as a CON request, to which the server
+// responds with the status of the whole set.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseRequestContext_SendQBlock1Blocks(GG_CoapBlockwiseRequestContext* self)
+{
+    size_t block_count = self->qblock_send_count;
+    self->qblock_send_count = 0;
+
+    for (size_t i = 0; i < block_count; i++) {
+        size_t block = self->qblock_send_list[i];
+
+        // get the size of the block
+        self->block1_info.offset  = block * self->block1_info.size;
+        self->block1_info.more    = false;
+        self->block1_payload_size = 0;
+        if (self->payload_source) {
+            self->block1_payload_size = self->block1_info.size;
+            GG_Result result = GG_CoapBlockSource_GetDataSize(self->payload_source,
+                                                              self->block1_info.offset,
+                                                              &self->block1_payload_size,
+                                                              &self->block1_info.more);
+            if (GG_FAILED(result)) {
+                GG_LOG_WARNING("Could not get data size (%d)", result);
+                return result;
+            }
+        }
+        if (!self->block1_info.more) {
+            self->block1_all_sent = true;
+        }
+        if (block >= self->qblock_next_block) {
+            self->qblock_next_block = block + 1;
+        }
+
+        // send the block
+        bool                      last = (i + 1 == block_count || !self->block1_info.more);
+        uint32_t                  block_option_value;
+        GG_CoapMessageBlockInfo_ToOptionValue(&self->block1_info, &block_option_value);
+        GG_CoapMessageOptionParam block_option = GG_COAP_MESSAGE_OPTION_PARAM_UINT(QBLOCK1, block_option_value);
+        GG_Result result = GG_CoapBlockwiseRequestContext_SendQBlockRequest(self,
+                                                                            last ?
+                                                                            GG_COAP_MESSAGE_TYPE_CON :
+                                                                            GG_COAP_MESSAGE_TYPE_NON,
+                                                                            &block_option,
+                                                                            1);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+        if (last) {
+            break;
+        }
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Request Q-Block2 blocks: either the payload set that starts at a block (more == true),
+// or a list of blocks (more == false)
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseRequestContext_RequestQBlock2Blocks(GG_CoapBlockwiseRequestContext* self,
+                                                    const size_t*                   blocks,
+                                                    size_t                          block_count,
+                                                    bool                            more)
+{
+    GG_ASSERT(block_count && block_count <= GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS);
+
+    GG_CoapMessageOptionParam block_options[GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS];
+    memset(block_options, 0, sizeof(block_options));
+    for (size_t i = 0; i < block_count; i++) {
+        GG_CoapMessageBlockInfo block_info = {
+            .offset = blocks[i] * self->block2_info.size,
+            .size   = self->block2_info.size,
+            .more   = more
+        };
+        GG_CoapMessageBlockInfo_ToOptionValue(&block_info, &block_options[i].option.value.uint);
+        block_options[i].option.number = GG_COAP_MESSAGE_OPTION_QBLOCK2;
+        block_options[i].option.type   = GG_COAP_MESSAGE_OPTION_TYPE_UINT;
+    }
+
+    // the endpoint takes care of retransmissions while the request is in flight
+    if (self->qblock_timer) {
+        GG_Timer_Unschedule(self->qblock_timer);
+    }
+
+    return GG_CoapBlockwiseRequestContext_SendQBlockRequest(self, GG_COAP_MESSAGE_TYPE_CON, block_options, block_count);
+}
+
+//----------------------------------------------------------------------
+// Send what's needed next in a Q-Block transfer
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseRequestContext_SendQBlockRequests(GG_CoapBlockwiseRequestContext* self)
+{
+    // nothing to do while waiting for the response to a request
+    if (self->block_request_count) {
+        return GG_SUCCESS;
+    }
+
+    if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) {
+        return GG_CoapBlockwiseRequestContext_SendQBlock1Blocks(self);
+    }
+
+    // request a new payload set if needed
+    if (self->qblock_request_set) {
+        self->qblock_request_set = false;
+        return GG_CoapBlockwiseRequestContext_RequestQBlock2Blocks(self, &self->qblock_next_block, 1, true);
+    }
+
+    // (re)start the timer used to detect missing blocks
+    if (self->qblock_timer == NULL) {
+        GG_Result result = GG_TimerScheduler_CreateTimer(self->endpoint->timer_scheduler, &self->qblock_timer);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+    uint32_t timeout = GG_CONFIG_COAP_QBLOCK_NON_RECEIVE_TIMEOUT_MS;
+    if (self->use_client_parameters && self->client_parameters.ack_timeout) {
+        timeout = self->client_parameters.ack_timeout;
+    }
+
+    return GG_Timer_Schedule(self->qblock_timer, GG_CAST(self, GG_TimerListener), timeout);
+}
+
+//----------------------------------------------------------------------
+// Timer callback invoked when no Q-Block2 block has been received for a while
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseRequestContext_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint32_t time_elapsed)
+{
+    GG_CoapBlockwiseRequestContext* self = GG_SELF(GG_CoapBlockwiseRequestContext, GG_TimerListener);
+    GG_COMPILER_UNUSED(timer);
+    GG_COMPILER_UNUSED(time_elapsed);
+
+    // nothing to do while waiting for the response to a request
+    if (self->block_request_count) {
+        return;
+    }
+
+    // give up if asking again hasn't helped
+    if (self->qblock_recovery_count++ == GG_CONFIG_COAP_QBLOCK_MAX_RECOVERY_ROUNDS) {
+        GG_LOG_WARNING("missing Q-Block2 blocks not received");
+        GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, GG_ERROR_TIMEOUT, NULL);
+        return;
+    }
+
+    // list the blocks of the set that are missing before the last one received
+    size_t missing_blocks[GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS];
+    size_t missing_block_count = 0;
+    size_t received_end = self->qblock_next_block;
+    for (size_t block = self->qblock_next_block;
+         block < self->qblock_set_start + GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS;
+         block++) {
+        if (self->qblock_responses[block - self->qblock_set_start]) {
+            received_end = block + 1;
+        }
+    }
+    for (size_t block = self->qblock_next_block; block < received_end; block++) {
+        if (self->qblock_responses[block - self->qblock_set_start] == NULL) {
+            missing_blocks[missing_block_count++] = block;
+        }
+    }
+
+    // request the missing blocks all at once, or, when the blocks at the end of the set are
+    // missing (we can't tell how many of them exist), request the rest of the set again
+    GG_Result result;
+    if (missing_block_count) {
+        GG_LOG_FINE("requesting %u missing Q-Block2 blocks", (int)missing_block_count);
+        result = GG_CoapBlockwiseRequestContext_RequestQBlock2Blocks(self,
+                                                                     missing_blocks,
+                                                                     missing_block_count,
+                                                                     false);
+    } else {
+        GG_LOG_FINE("requesting Q-Block2 blocks from %u", (int)self->qblock_next_block);
+        result = GG_CoapBlockwiseRequestContext_RequestQBlock2Blocks(self, &self->qblock_next_block, 1, true);
+    }
+    if (GG_FAILED(result)) {
+        GG_LOG_WARNING("failed to request missing blocks (%d)", result);
+        GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, result, NULL);
+    }
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_CoapBlockwiseRequestContext, GG_TimerListener) {
+    .OnTimerFired = GG_CoapBlockwiseRequestContext_OnTimerFired
+};
+
+//----------------------------------------------------------------------
+// Move the BLOCK1 or BLOCK2 position to the block that follows the one just requested
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseRequestContext_AdvanceToNextBlock(GG_CoapBlockwiseRequestContext* self)
+{
+    if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) {
+        if (!self->block1_info.more) {
+            self->block1_all_sent = true;
+            return GG_SUCCESS;
+        }
+        self->block1_info.offset += self->block1_payload_size;
+        self->block1_payload_size = self->block1_info.size;
+        GG_Result result = GG_CoapBlockSource_GetDataSize(self->payload_source,
+                                                          self->block1_info.offset,
+                                                          &self->block1_payload_size,
+                                                          &self->block1_info.more);
+        if (GG_FAILED(result)) {
+            GG_LOG_WARNING("Could not get data size (%d)", result);
+            return result;
+        }
+    } else if (self->block2_size_agreed) {
+        // BLOCK2 requests are speculative, the server will tell us when we've gone past the last one
+        self->block2_info.offset += self->block2_info.size;
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Get the number of block requests that may be in flight in the current phase of the transfer.
+// Until the server has responded to a first block, we don't know the block size it will
+// use, so we only send one block request at a time.
+//----------------------------------------------------------------------
+static size_t
+GG_CoapBlockwiseRequestContext_GetWindowSize(GG_CoapBlockwiseRequestContext* self)
+{
+    if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) {
+        if (self->block1_all_sent) {
+            return 0;
+        }
+        return self->block1_size_agreed ? self->max_blocks_in_flight : 1;
+    }
+
+    return self->block2_size_agreed ? self->max_blocks_in_flight : 1;
+}
+
+//----------------------------------------------------------------------
+// Send block requests until the window is full
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseRequestContext_SendBlockRequests(GG_CoapBlockwiseRequestContext* self)
+{
+    // do nothing if the request is paused
+    if (self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED) {
+        GG_LOG_FINE("request is paused, doing nothing now");
+        return GG_SUCCESS;
+    }
+
+    // Q-Block transfers don't use a window
+    if (self->qblock) {
+        return GG_CoapBlockwiseRequestContext_SendQBlockRequests(self);
+    }
+
+    while (self->block_request_count < GG_CoapBlockwiseRequestContext_GetWindowSize(self)) {
+        GG_Result result = GG_CoapBlockwiseRequestContext_SendBlockRequest(self);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+        result = GG_CoapBlockwiseRequestContext_AdvanceToNextBlock(self);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Handle, in order, the responses and errors kept for block requests that completed
+// out of order or while paused, then request more blocks
+//----------------------------------------------------------------------
+static void
+GG_CoapBlockwiseRequestContext_Pump(GG_CoapBlockwiseRequestContext* self)
+{
+    // setup a destroy monitor
+    bool* outer_destroy_monitor = self->destroy_monitor;
+    bool  destroy_monitor       = false;
+    self->destroy_monitor = &destroy_monitor;
+
+    while (self->block_request_count && !(self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED)) {
+        GG_CoapBlockwiseBlockRequest* block_request = GG_CoapBlockwiseRequestContext_GetBlockRequest(self, 0);
+        if (block_request->request) {
+            // still in flight
+            break;
+        }
+
+        // take the outcome out of the block request
+        GG_CoapMessage* response      = block_request->response;
+        GG_Result       error         = block_request->error;
+        size_t          block2_offset = block_request->block2_offset;
+        block_request->response = NULL;
+        block_request->error    = GG_SUCCESS;
+        GG_CoapBlockwiseRequestContext_RemoveFirstBlockRequest(self);
+
+        // handle it
+        if (response) {
+            GG_CoapBlockwiseRequestContext_HandleResponse(self, block2_offset, response);
+            GG_CoapMessage_Destroy(response);
+        } else {
+            GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, error, NULL);
+        }
+
+        // check if this context has been destroyed and exit now if it has
+        if (destroy_monitor) {
+            if (outer_destroy_monitor) {
+                *outer_destroy_monitor = true;
+            }
+            return;
+        }
+    }
+
+    // deliver the Q-Block2 blocks that can be delivered
+    if (self->qblock && !(self->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE)) {
+        GG_CoapBlockwiseRequestContext_DeliverQBlock2Blocks(self);
+        if (destroy_monitor) {
+            if (outer_destroy_monitor) {
+                *outer_destroy_monitor = true;
+            }
+            return;
+        }
+    }
+
+    // restore the previous monitor
+    self->destroy_monitor = outer_destroy_monitor;
+
+    // request more blocks
+    GG_Result result = GG_CoapBlockwiseRequestContext_SendBlockRequests(self);
+    if (GG_FAILED(result)) {
+        GG_LOG_WARNING("failed to send block request (%d)", result);
+        GG_CoapBlockwiseRequestContext_NotifyErrorAndTerminate(self, result, NULL);
+    }
+}
 
+//----------------------------------------------------------------------
+// Create a request context and send the first request(s)
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapEndpoint_StartBlockwiseRequest(GG_CoapEndpoint*                  self,
+                                      GG_CoapMethod                     method,
+                                      GG_CoapMessageOptionParam*        options,
+                                      size_t                            options_count,
+                                      GG_CoapBlockSource*               payload_source,
+                                      size_t                            preferred_block_size,
+                                      size_t                            max_blocks_in_flight,
+                                      bool                              qblock,
+                                      const GG_CoapClientParameters*    client_parameters,
+                                      GG_CoapBlockwiseResponseListener* listener,
+                                      GG_CoapRequestHandle*             request_handle)
+{
     // only PUT and POST should have a payload
     GG_ASSERT(!(payload_source && method != GG_COAP_METHOD_PUT && method != GG_COAP_METHOD_POST));
 
+    // we need room for at least one block request
+    if (max_blocks_in_flight == 0) {
+        max_blocks_in_flight = 1;
+    }
+
     // try to clone the options
     GG_CoapMessageOptionParam* cloned_options = GG_Coap_CloneOptions(options, options_count);
     if (cloned_options == NULL) {
         return GG_ERROR_OUT_OF_MEMORY;
     }
 
-    // allocate a new context object
-    GG_CoapBlockwiseRequestContext* context = GG_AllocateZeroMemory(sizeof(GG_CoapBlockwiseRequestContext));
+    // allocate a new context object, with its block requests
+    GG_CoapBlockwiseRequestContext* context =
+        GG_AllocateZeroMemory(sizeof(GG_CoapBlockwiseRequestContext) +
+                              max_blocks_in_flight * sizeof(GG_CoapBlockwiseBlockRequest));
     if (context == NULL) {
         GG_FreeMemory(cloned_options);
         return GG_ERROR_OUT_OF_MEMORY;
@@ -797,6 +1699,7 @@ GG_CoapEndpoint_SendBlockwiseRequest(GG_CoapEndpoint*                  self,
     context->payload_source       = payload_source;
     context->listener             = listener;
     context->preferred_block_size = preferred_block_size;
+    context->max_blocks_in_flight = max_blocks_in_flight;
     context->option_params        = cloned_options;
     context->option_count         = options_count;
     context->handle               = self->blockwise_request_handle_base++;
@@ -804,15 +1707,32 @@ GG_CoapEndpoint_SendBlockwiseRequest(GG_CoapEndpoint*                  self,
         context->use_client_parameters = true;
         context->client_parameters = *client_parameters;
     }
+    for (size_t i = 0; i < max_blocks_in_flight; i++) {
+        context->block_requests[i].context = context;
+        GG_SET_INTERFACE(&context->block_requests[i], GG_CoapBlockwiseBlockRequest, GG_CoapResponseListener);
+    }
 
     // setup interfaces
-    GG_SET_INTERFACE(context, GG_CoapBlockwiseRequestContext, GG_CoapResponseListener);
     GG_SET_INTERFACE(context, GG_CoapBlockwiseRequestContext, GG_BufferSource);
+    GG_SET_INTERFACE(context, GG_CoapBlockwiseRequestContext, GG_TimerListener);
 
     // prepare the initial state
     GG_Result result;
     context->block2_info.size = preferred_block_size ? preferred_block_size : GG_COAP_BLOCKWISE_DEFAULT_BLOCK_SIZE;
-    if (method == GG_COAP_METHOD_PUT || method == GG_COAP_METHOD_POST) {
+    if (qblock) {
+        // Q-Block transfers start with a full payload set, sent (Q-Block1) or requested (Q-Block2)
+        context->qblock = true;
+        if (method == GG_COAP_METHOD_PUT || method == GG_COAP_METHOD_POST) {
+            context->state |= GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE;
+            context->block1_info.size = context->block2_info.size;
+            for (size_t i = 0; i < GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS; i++) {
+                context->qblock_send_list[i] = i;
+            }
+            context->qblock_send_count = GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS;
+        } else {
+            context->qblock_request_set = true;
+        }
+    } else if (method == GG_COAP_METHOD_PUT || method == GG_COAP_METHOD_POST) {
         context->state |= GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE;
         context->block1_info.size = 1024;
         if (payload_source) {
@@ -834,7 +1754,7 @@ GG_CoapEndpoint_SendBlockwiseRequest(GG_CoapEndpoint*                  self,
     GG_LINKED_LIST_APPEND(&self->blockwise_requests, &context->list_node);
 
     // send the first request
-    result = GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(context);
+    result = GG_CoapBlockwiseRequestContext_SendBlockRequests(context);
     if (GG_FAILED(result)) {
         GG_CoapBlockwiseRequestContext_Destroy(context);
         return result;
@@ -848,6 +1768,85 @@ GG_CoapEndpoint_SendBlockwiseRequest(GG_CoapEndpoint*                  self,
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_SendPipelinedBlockwiseRequest(GG_CoapEndpoint*                  self,
+                                              GG_CoapMethod                     method,
+                                              GG_CoapMessageOptionParam*        options,
+                                              size_t                            options_count,
+                                              GG_CoapBlockSource*               payload_source,
+                                              size_t                            preferred_block_size,
+                                              size_t                            max_blocks_in_flight,
+                                              const GG_CoapClientParameters*    client_parameters,
+                                              GG_CoapBlockwiseResponseListener* listener,
+                                              GG_CoapRequestHandle*             request_handle)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    return GG_CoapEndpoint_StartBlockwiseRequest(self,
+                                                 method,
+                                                 options,
+                                                 options_count,
+                                                 payload_source,
+                                                 preferred_block_size,
+                                                 max_blocks_in_flight,
+                                                 false,
+                                                 client_parameters,
+                                                 listener,
+                                                 request_handle);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_SendQBlockRequest(GG_CoapEndpoint*                  self,
+                                  GG_CoapMethod                     method,
+                                  GG_CoapMessageOptionParam*        options,
+                                  size_t                            options_count,
+                                  GG_CoapBlockSource*               payload_source,
+                                  size_t                            preferred_block_size,
+                                  const GG_CoapClientParameters*    client_parameters,
+                                  GG_CoapBlockwiseResponseListener* listener,
+                                  GG_CoapRequestHandle*             request_handle)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    return GG_CoapEndpoint_StartBlockwiseRequest(self,
+                                                 method,
+                                                 options,
+                                                 options_count,
+                                                 payload_source,
+                                                 preferred_block_size,
+                                                 1,
+                                                 true,
+                                                 client_parameters,
+                                                 listener,
+                                                 request_handle);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_SendBlockwiseRequest(GG_CoapEndpoint*                  self,
+                                     GG_CoapMethod                     method,
+                                     GG_CoapMessageOptionParam*        options,
+                                     size_t                            options_count,
+                                     GG_CoapBlockSource*               payload_source,
+                                     size_t                            preferred_block_size,
+                                     const GG_CoapClientParameters*    client_parameters,
+                                     GG_CoapBlockwiseResponseListener* listener,
+                                     GG_CoapRequestHandle*             request_handle)
+{
+    return GG_CoapEndpoint_SendPipelinedBlockwiseRequest(self,
+                                                         method,
+                                                         options,
+                                                         options_count,
+                                                         payload_source,
+                                                         preferred_block_size,
+                                                         1,
+                                                         client_parameters,
+                                                         listener,
+                                                         request_handle);
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_CoapEndpoint_CancelBlockwiseRequest(GG_CoapEndpoint* self, GG_CoapRequestHandle request_handle)
@@ -865,6 +1864,50 @@ GG_CoapEndpoint_CancelBlockwiseRequest(GG_CoapEndpoint* self, GG_CoapRequestHand
     return GG_ERROR_NO_SUCH_ITEM;
 }
 
+//----------------------------------------------------------------------
+bool
+GG_CoapEndpoint_OnUnmatchedBlockwiseResponse(GG_CoapEndpoint* self, GG_CoapMessage* response)
+{
+    // look for a Q-Block2 transfer with the same token
+    uint8_t token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    size_t  token_length = GG_CoapMessage_GetToken(response, token);
+    GG_LINKED_LIST_FOREACH(node, &self->blockwise_requests) {
+        GG_CoapBlockwiseRequestContext* context = GG_LINKED_LIST_ITEM(node, GG_CoapBlockwiseRequestContext, list_node);
+        if (!context->qblock ||
+            (context->state & GG_COAP_BLOCKWISE_REQUEST_STATE_BLOCK1_ACTIVE) ||
+            context->qblock_token_length == 0 ||
+            context->qblock_token_length != token_length ||
+            memcmp(context->qblock_token, token, token_length)) {
+            continue;
+        }
+
+        // setup a destroy monitor
+        bool* outer_destroy_monitor = context->destroy_monitor;
+        bool  destroy_monitor       = false;
+        context->destroy_monitor = &destroy_monitor;
+
+        // handle the block
+        GG_CoapBlockwiseRequestContext_HandleResponse(context, 0, response);
+
+        // check if this context has been destroyed and exit now if it has
+        if (destroy_monitor) {
+            if (outer_destroy_monitor) {
+                *outer_destroy_monitor = true;
+            }
+            return true;
+        }
+
+        // restore the previous monitor
+        context->destroy_monitor = outer_destroy_monitor;
+
+        // deliver what can be delivered and continue
+        GG_CoapBlockwiseRequestContext_Pump(context);
+        return true;
+    }
+
+    return false;
+}
+
 //----------------------------------------------------------------------
 void
 GG_CoapEndpoint_DestroyBlockwiseRequestContexts(GG_CoapEndpoint* self)
@@ -901,9 +1944,14 @@ GG_CoapEndpoint_InspectBlockwiseRequestContexts(GG_CoapEndpoint*            self
                                context->block1_payload_size,
                                GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
         GG_Inspector_OnInteger(inspector,
-                               "pending_request",
-                               context->pending_request,
+                               "max_blocks_in_flight",
+                               context->max_blocks_in_flight,
+                               GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+        GG_Inspector_OnInteger(inspector,
+                               "block_request_count",
+                               context->block_request_count,
                                GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+        GG_Inspector_OnBoolean(inspector, "qblock", context->qblock);
         GG_Inspector_OnObjectEnd(inspector);
     }
     GG_Inspector_OnArrayEnd(inspector);
@@ -926,7 +1974,13 @@ GG_CoapEndpoint_SetBlockwiseRequestPausedState(GG_CoapEndpoint*     self,
             } else if (context->state & GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED) {
                 // resume
                 GG_LOG_FINE("resuming request");
-                GG_CoapBlockwiseRequestContext_SendBlockwiseRequest(context);
+                context->state &= ~GG_COAP_BLOCKWISE_REQUEST_STATE_PAUSED;
+
+                // when called from a listener callback, the caller of that callback will continue the
+                // transfer when it returns, otherwise deliver what was kept while paused and request more
+                if (context->destroy_monitor == NULL) {
+                    GG_CoapBlockwiseRequestContext_Pump(context);
+                }
             }
             return GG_SUCCESS;
         }
@@ -963,7 +2017,10 @@ GG_CoapBlockwiseServerHelper_Init(GG_CoapBlockwiseServerHelper* self,
     memset(self, 0, sizeof(*self));
 
     // copy fields or set defaults
-    GG_ASSERT(block_type == GG_COAP_MESSAGE_OPTION_BLOCK1 || block_type == GG_COAP_MESSAGE_OPTION_BLOCK2);
+    GG_ASSERT(block_type == GG_COAP_MESSAGE_OPTION_BLOCK1  ||
+              block_type == GG_COAP_MESSAGE_OPTION_BLOCK2  ||
+              block_type == GG_COAP_MESSAGE_OPTION_QBLOCK1 ||
+              block_type == GG_COAP_MESSAGE_OPTION_QBLOCK2);
     self->block_type = block_type;
     if (preferred_block_size) {
         self->preferred_block_size = preferred_block_size;
@@ -984,6 +2041,112 @@ GG_CoapBlockwiseServerHelper_SetEtag(GG_CoapBlockwiseServerHelper* self, const u
     }
 }
 
+//----------------------------------------------------------------------
+// Update the state of a QBLOCK1 helper when a block is received.
+// Blocks may arrive in any order, so the helper keeps track of which blocks of the
+// window that starts at the first missing block have been received.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseServerHelper_OnQBlock1Request(GG_CoapBlockwiseServerHelper* self, bool* resent)
+{
+    size_t block = self->block_info.offset / self->block_info.size;
+
+    // block 0 starts a new transfer, unless it is part of the current one
+    if (block == 0 && (self->qblock_base || self->done)) {
+        self->qblock_base  = 0;
+        self->qblock_mask  = 0;
+        self->qblock_count = 0;
+        self->done         = false;
+    }
+
+    if (block < self->qblock_base) {
+        // this block was already received
+        *resent = true;
+    } else if (block - self->qblock_base >= 32) {
+        // too far ahead of the first missing block
+        GG_LOG_WARNING("unexpected block received (got %u, expected %u or above)",
+                       (int)block,
+                       (int)self->qblock_base);
+        return GG_COAP_MESSAGE_CODE_REQUEST_ENTITY_INCOMPLETE;
+    } else {
+        uint32_t bit = (uint32_t)1 << (block - self->qblock_base);
+        *resent = (self->qblock_mask & bit) != 0;
+        self->qblock_mask |= bit;
+    }
+
+    // the last block tells us how many blocks there are
+    if (!self->block_info.more && !*resent) {
+        self->qblock_count = block + 1;
+    }
+
+    // move the window past the blocks received in sequence
+    while (self->qblock_mask & 1) {
+        self->qblock_mask >>= 1;
+        ++self->qblock_base;
+    }
+    self->next_offset = self->qblock_base * self->block_info.size;
+    self->done        = self->qblock_count && self->qblock_base >= self->qblock_count;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Update the state of a QBLOCK2 helper when a request is received.
+// A request with no Q-Block2 option, or a single one with the M bit set, asks for the
+// payload set that starts at that block. Other requests list the blocks they ask for.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapBlockwiseServerHelper_OnQBlock2Request(GG_CoapBlockwiseServerHelper* self,
+                                              const GG_CoapMessage*         request,
+                                              bool*                         resent)
+{
+    size_t first_block = self->block_info.offset / self->block_info.size;
+
+    // count the options
+    GG_CoapMessageOptionIterator iterator;
+    size_t                       option_count = 0;
+    GG_CoapMessage_InitOptionIterator(request, GG_COAP_MESSAGE_OPTION_QBLOCK2, &iterator);
+    while (iterator.option.number != GG_COAP_MESSAGE_OPTION_NONE) {
+        ++option_count;
+        GG_CoapMessage_StepOptionIterator(request, &iterator);
+    }
+
+    if (option_count == 0 || (option_count == 1 && self->block_info.more)) {
+        // payload set request
+        self->qblock_base = first_block;
+        self->qblock_mask = (uint32_t)(((uint64_t)1 << GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS) - 1);
+        *resent = false;
+    } else {
+        // list of blocks, which are resent blocks
+        self->qblock_base = first_block;
+        GG_CoapMessage_InitOptionIterator(request, GG_COAP_MESSAGE_OPTION_QBLOCK2, &iterator);
+        while (iterator.option.number != GG_COAP_MESSAGE_OPTION_NONE) {
+            size_t block = iterator.option.value.uint >> 4;
+            if (block < self->qblock_base) {
+                self->qblock_base = block;
+            }
+            GG_CoapMessage_StepOptionIterator(request, &iterator);
+        }
+        self->qblock_mask = 0;
+        GG_CoapMessage_InitOptionIterator(request, GG_COAP_MESSAGE_OPTION_QBLOCK2, &iterator);
+        while (iterator.option.number != GG_COAP_MESSAGE_OPTION_NONE) {
+            size_t block = iterator.option.value.uint >> 4;
+            if (block - self->qblock_base < 32) {
+                self->qblock_mask |= (uint32_t)1 << (block - self->qblock_base);
+            }
+            GG_CoapMessage_StepOptionIterator(request, &iterator);
+        }
+        *resent = true;
+    }
+
+    // the first requested block is the one returned by the response
+    self->block_info.offset = self->qblock_base * self->block_info.size;
+    self->block_info.more   = false;
+    self->next_offset       = self->block_info.offset + self->block_info.size;
+
+    return GG_SUCCESS;
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_CoapBlockwiseServerHelper_OnRequest(GG_CoapBlockwiseServerHelper* self,
@@ -1018,7 +2181,14 @@ GG_CoapBlockwiseServerHelper_OnRequest(GG_CoapBlockwiseServerHelper* self,
 
     // check that the block is either a resent block, or the next expected one
     bool resent = false;
-    if (self->block_type == GG_COAP_MESSAGE_OPTION_BLOCK1) {
+    if (self->block_type == GG_COAP_MESSAGE_OPTION_QBLOCK1) {
+        result = GG_CoapBlockwiseServerHelper_OnQBlock1Request(self, &resent);
+        if (result != GG_SUCCESS) {
+            return result;
+        }
+    } else if (self->block_type == GG_COAP_MESSAGE_OPTION_QBLOCK2) {
+        GG_CoapBlockwiseServerHelper_OnQBlock2Request(self, request, &resent);
+    } else if (self->block_type == GG_COAP_MESSAGE_OPTION_BLOCK1) {
         // we're receiving data
         size_t block_end_offset = self->block_info.offset + GG_CoapMessage_GetPayloadSize(request);
         if (self->block_info.offset == self->next_offset) {
@@ -1105,6 +2275,40 @@ GG_CoapBlockwiseServerHelper_CreateResponse(GG_CoapBlockwiseServerHelper* self,
         ++options_count;
     }
 
+    // QBLOCK1 blocks carried by NON requests only get a response when something is wrong,
+    // and the response to a CON request lists the blocks that are still missing, if any
+    uint8_t                   missing_blocks[32 * 5];
+    GG_CoapMessageOptionParam format_option =
+        GG_COAP_MESSAGE_OPTION_PARAM_UINT(CONTENT_FORMAT, GG_COAP_MESSAGE_FORMAT_ID_MISSING_BLOCKS);
+    if (self->block_type == GG_COAP_MESSAGE_OPTION_QBLOCK1) {
+        if (GG_CoapMessage_GetType(request) == GG_COAP_MESSAGE_TYPE_NON && (code >> 5) < 4) {
+            *response = NULL;
+            return GG_ERROR_WOULD_BLOCK;
+        }
+
+        if (code == GG_COAP_MESSAGE_CODE_CONTINUE) {
+            size_t block        = self->block_info.offset / self->block_info.size;
+            size_t missing_size = 0;
+            for (size_t missing = self->qblock_base; missing < block; missing++) {
+                if (missing_size + 5 > self->block_info.size) {
+                    break;
+                }
+                if (!(self->qblock_mask & ((uint32_t)1 << (missing - self->qblock_base)))) {
+                    missing_size += GG_CoapBlockwise_EncodeBlockNumber((uint32_t)missing,
+                                                                       &missing_blocks[missing_size]);
+                }
+            }
+            if (missing_size) {
+                code               = GG_COAP_MESSAGE_CODE_REQUEST_ENTITY_INCOMPLETE;
+                payload            = missing_blocks;
+                payload_size       = missing_size;
+                format_option.next = options;
+                options            = &format_option;
+                ++options_count;
+            }
+        }
+    }
+
     return GG_CoapEndpoint_CreateBlockwiseResponse(endpoint,
                                                    request,
                                                    code,
@@ -1116,3 +2320,90 @@ GG_CoapBlockwiseServerHelper_CreateResponse(GG_CoapBlockwiseServerHelper* self,
                                                    &self->block_info,
                                                    response);
 }
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapBlockwiseServerHelper_CreateResponseFromBlockSource(GG_CoapBlockwiseServerHelper* self,
+                                                           GG_CoapEndpoint*              endpoint,
+                                                           const GG_CoapMessage*         request,
+                                                           const GG_BufferMetadata*      transport_metadata,
+                                                           uint8_t                       code,
+                                                           GG_CoapMessageOptionParam*    options,
+                                                           size_t                        options_count,
+                                                           GG_CoapBlockSource*           payload_source,
+                                                           GG_CoapMessage**              response)
+{
+    GG_ASSERT(payload_source);
+    GG_ASSERT(response);
+
+    // chain an etag option if we have one
+    GG_CoapMessageOptionParam etag_option = GG_COAP_MESSAGE_OPTION_PARAM_OPAQUE(ETAG, self->etag, self->etag_size);
+    if (self->etag_size) {
+        etag_option.next = options;
+        options = &etag_option;
+        ++options_count;
+    }
+
+    // the response carries the first requested block
+    GG_Result result = GG_CoapEndpoint_CreateBlockResponseFromBlockSource(endpoint,
+                                                                          request,
+                                                                          GG_COAP_MESSAGE_TYPE_ACK,
+                                                                          code,
+                                                                          options,
+                                                                          options_count,
+                                                                          payload_source,
+                                                                          self->block_type,
+                                                                          &self->block_info,
+                                                                          response);
+    if (GG_FAILED(result) || self->block_type != GG_COAP_MESSAGE_OPTION_QBLOCK2) {
+        return result;
+    }
+    GG_CoapMessageBlockInfo block_info;
+    GG_CoapMessage_GetBlockInfo(*response, self->block_type, &block_info, 0);
+
+    // the other requested blocks are sent back to where the request came from
+    GG_SocketAddressMetadata destination_metadata;
+    if (transport_metadata && transport_metadata->type == GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS) {
+        destination_metadata           = *(const GG_SocketAddressMetadata*)transport_metadata;
+        destination_metadata.base.type = GG_BUFFER_METADATA_TYPE_DESTINATION_SOCKET_ADDRESS;
+        transport_metadata             = &destination_metadata.base;
+    } else {
+        transport_metadata = NULL;
+    }
+
+    // send the other requested blocks as NON responses, up to the last block of the payload
+    for (unsigned int i = 1; i < 32 && block_info.more; i++) {
+        if (!(self->qblock_mask & ((uint32_t)1 << i))) {
+            continue;
+        }
+
+        block_info = (GG_CoapMessageBlockInfo) {
+            .offset = (self->qblock_base + i) * self->block_info.size,
+            .size   = self->block_info.size
+        };
+        GG_CoapMessage* block_response = NULL;
+        result = GG_CoapEndpoint_CreateBlockResponseFromBlockSource(endpoint,
+                                                                    request,
+                                                                    GG_COAP_MESSAGE_TYPE_NON,
+                                                                    code,
+                                                                    options,
+                                                                    options_count,
+                                                                    payload_source,
+                                                                    self->block_type,
+                                                                    &block_info,
+                                                                    &block_response);
+        if (GG_FAILED(result)) {
+            GG_LOG_FINE("no block at offset %u", (int)block_info.offset);
+            break;
+        }
+        GG_CoapMessage_GetBlockInfo(block_response, self->block_type, &block_info, 0);
+        result = GG_CoapEndpoint_SendMessage(endpoint, block_response, transport_metadata);
+        GG_CoapMessage_Destroy(block_response);
+        if (GG_FAILED(result)) {
+            GG_LOG_WARNING("failed to send block (%d)", result);
+            break;
+        }
+    }
+
+    return GG_SUCCESS;
+}
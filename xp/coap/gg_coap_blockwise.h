@@ -61,7 +61,8 @@ typedef struct {
  * GG_CoapBlockwiseServerHelper_OnRequest() to analyze the request and check that it
  * matches the current expectations. If that method returns an error the handler should
  * terminate and return that error. Otherwise, the handler should check if the requested
- * block is the first block (block 0) of a new transfer (`helper.block_info.offset == 0`).
+ * block is the first block (block 0) of a new transfer (`helper.block_info.offset == 0` and the request
+ * wasn't flagged as resent).
  * If it is a new transfer, the handler should set the helper's ETag value to differentiate
  * this new transfer from previous ones, by calling GG_CoapBlockwiseServerHelper_SetEtag().
  *
@@ -85,15 +86,32 @@ typedef struct {
  * requests for the same block are possible. For PUT/POST requests, simply ignoring resent
  * blocks is usually sufficient. For GET requests, the handler may want to cache the last
  * returned block if it can't re-generate the block payload.
+ *
+ * The helper may also be initialized for the Q-Block options of RFC 9177, with a block type of
+ * GG_COAP_MESSAGE_OPTION_QBLOCK1 or GG_COAP_MESSAGE_OPTION_QBLOCK2. In that mode, blocks are
+ * exchanged in payload sets of up to GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS blocks, most of them carried
+ * by NON messages, and lost blocks are recovered with a single request or response listing them:
+ *   for QBLOCK1 PUT/POST transfers, blocks may be received in any order, so the handler must store
+ *   each block's payload at `helper.block_info.offset` (unless it was resent), and respond with
+ *   GG_COAP_MESSAGE_CODE_CONTINUE until `helper.done` is true. The helper turns that response into
+ *   a 4.08 response listing the missing blocks when some are missing, and tells the handler not to
+ *   respond to NON requests, by returning GG_ERROR_WOULD_BLOCK with no response.
+ *   for QBLOCK2 GET transfers, the handler should respond by calling
+ *   GG_CoapBlockwiseServerHelper_CreateResponseFromBlockSource(), which returns the first
+ *   requested block and sends the other ones as NON messages.
+ * Requests listing missing blocks are flagged as resent.
  */
 typedef struct {
-    uint32_t                block_type;           ///< GG_COAP_MESSAGE_OPTION_BLOCK1 or GG_COAP_MESSAGE_OPTION_BLOCK2
+    uint32_t                block_type;           ///< GG_COAP_MESSAGE_OPTION_BLOCK1, BLOCK2, QBLOCK1 or QBLOCK2
     size_t                  next_offset;          ///< Next expected block offset
-    bool                    done;                 ///< True when we've received the last block (BLOCK1 only)
+    bool                    done;                 ///< True when we've received the last block (BLOCK1/QBLOCK1 only)
     size_t                  preferred_block_size; ///< Preferred block size
-    GG_CoapMessageBlockInfo block_info;           ///< Last parsed BLOCK1/BLOCK2 option
+    GG_CoapMessageBlockInfo block_info;           ///< Last parsed BLOCK1/BLOCK2 option (first one for QBLOCK2)
     uint8_t                 etag[GG_COAP_MESSAGE_MAX_ETAG_OPTION_SIZE]; ///< ETag for the transfer session
     size_t                  etag_size;                                  ///< ETag size
+    size_t                  qblock_base;  ///< Number of the block represented by bit 0 of `qblock_mask`
+    uint32_t                qblock_mask;  ///< Blocks received (QBLOCK1) or requested (QBLOCK2), from `qblock_base`
+    size_t                  qblock_count; ///< Number of blocks in the body, once the last one is received (QBLOCK1)
 } GG_CoapBlockwiseServerHelper;
 
 /*----------------------------------------------------------------------
@@ -101,6 +119,28 @@ typedef struct {
 +---------------------------------------------------------------------*/
 #define GG_COAP_BLOCKWISE_DEFAULT_BLOCK_SIZE 1024 ///< Default block size
 
+// max number of blocks in a Q-Block payload set (MAX_PAYLOADS, RFC 9177 section 7.2)
+// (each set is sent in a burst, so this should stay below the response queue capacity)
+#if !defined(GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS)
+#define GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS 10
+#endif
+
+#if GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS < 1 || GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS > 32
+#error "GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS must be between 1 and 32"
+#endif
+
+// time without receiving any block of an incomplete Q-Block2 payload set after which the missing
+// blocks are requested again (NON_RECEIVE_TIMEOUT, RFC 9177 section 7.2), unless the client
+// parameters of the request specify an ack timeout, which is then used instead
+#if !defined(GG_CONFIG_COAP_QBLOCK_NON_RECEIVE_TIMEOUT_MS)
+#define GG_CONFIG_COAP_QBLOCK_NON_RECEIVE_TIMEOUT_MS 4000
+#endif
+
+// max number of consecutive times missing Q-Block blocks are requested or resent without any progress
+#if !defined(GG_CONFIG_COAP_QBLOCK_MAX_RECOVERY_ROUNDS)
+#define GG_CONFIG_COAP_QBLOCK_MAX_RECOVERY_ROUNDS 4
+#endif
+
 /*----------------------------------------------------------------------
 |   functions
 +---------------------------------------------------------------------*/
@@ -109,7 +149,8 @@ typedef struct {
  *
  * @param self The object on which this method is invoked.
  * @param block_option_number The block option to look for
- * (GG_COAP_MESSAGE_OPTION_BLOCK1 or GG_COAP_MESSAGE_OPTION_BLOCK2)
+ * (GG_COAP_MESSAGE_OPTION_BLOCK1, GG_COAP_MESSAGE_OPTION_BLOCK2, GG_COAP_MESSAGE_OPTION_QBLOCK1
+ * or GG_COAP_MESSAGE_OPTION_QBLOCK2). When the option is repeated, the first one is used.
  * @param block_info Pointer to the structure in which the block info will be returned.
  * @param default_block_size Default block size to use if the requested block option isn't found (pass
  * 0 for no default, in which case GG_ERROR_NO_SUCH_ITEM is returned if the option isn't found).
@@ -252,6 +293,86 @@ GG_Result GG_CoapEndpoint_SendBlockwiseRequest(GG_CoapEndpoint*
                                                GG_CoapBlockwiseResponseListener* listener,
                                                GG_CoapRequestHandle*             request_handle);
 
+/**
+ * Send a CoAP blockwise request, with several block requests in flight at the same time.
+ * This method is similar to GG_CoapEndpoint_SendBlockwiseRequest, but instead of waiting for the
+ * response to a block request before requesting the next block, up to `max_blocks_in_flight` block
+ * requests are kept outstanding, which avoids paying one round trip per block on high latency links.
+ * Only one block is requested until the server has responded to a first block, so that the block size
+ * can be agreed upon. Responses that arrive out of order are kept until the responses for all the
+ * blocks before them have been received, so the listener is always called in block order.
+ * Because the size of a BLOCK2 response isn't known in advance, blocks past the last one may be
+ * requested; those requests are cancelled when the last block is received.
+ *
+ * @param self The object on which this method is called.
+ * @param method Method for the request.
+ * @param options Options for the request.
+ * @param options_count Number of options for the request.
+ * @param payload_source Payload source for the request.
+ * @param preferred_block_size Preferred block size. If set to 0, the server's preferred block size
+ * will be used.
+ * @param max_blocks_in_flight Maximum number of block requests in flight (0 is the same as 1, which is
+ * equivalent to calling GG_CoapEndpoint_SendBlockwiseRequest).
+ * @param client_parameters Optional client parameters to customize the client behavior. Pass NULL for defaults.
+ * @param listener Listener object that will receive callbacks regarding any response or error.
+ * @param request_handle Handle to the request, that may be used subsequently to cancel the request.
+ * (the caller may pass NULL if it isn't interested in the handle value).
+ *
+ * @return GG_SUCCESS if the request could be sent, or a negative error code.
+ */
+GG_Result GG_CoapEndpoint_SendPipelinedBlockwiseRequest(GG_CoapEndpoint*                  self,
+                                                        GG_CoapMethod                     method,
+                                                        GG_CoapMessageOptionParam*        options,
+                                                        size_t                            options_count,
+                                                        GG_CoapBlockSource*               payload_source,
+                                                        size_t                            preferred_block_size,
+                                                        size_t                            max_blocks_in_flight,
+                                                        const GG_CoapClientParameters*    client_parameters,
+                                                        GG_CoapBlockwiseResponseListener* listener,
+                                                        GG_CoapRequestHandle*             request_handle);
+
+/**
+ * Send a CoAP blockwise request using the Q-Block options of RFC 9177.
+ * This method is similar to GG_CoapEndpoint_SendBlockwiseRequest, but blocks are exchanged in
+ * payload sets of up to GG_CONFIG_COAP_QBLOCK_MAX_PAYLOADS blocks, of which all but one are carried by
+ * NON messages, so that a whole set only costs one round trip:
+ *   for GET requests, each request asks the server for a payload set, with a Q-Block2 option.
+ *   The server responds with the first block of the set and sends the other ones as NON responses.
+ *   Blocks are delivered to the listener in order. When no block has been received for a while and the
+ *   set is still incomplete, the missing blocks are requested with a single request listing them.
+ *   for PUT and POST requests, the blocks of each payload set are sent with a Q-Block1 option, as NON
+ *   requests except the last one of the set, which is sent as a CON request to which the server
+ *   responds with 2.31 when it has received the whole set, or with 4.08 listing the missing blocks,
+ *   which are then sent again.
+ * The blocks have the preferred block size, or GG_COAP_BLOCKWISE_DEFAULT_BLOCK_SIZE if none is specified,
+ * and the server must use that same size for Q-Block1 transfers.
+ * If the server responds to the first request of a GET without a Q-Block2 option, the rest of the
+ * transfer proceeds as with GG_CoapEndpoint_SendBlockwiseRequest.
+ *
+ * @param self The object on which this method is called.
+ * @param method Method for the request.
+ * @param options Options for the request.
+ * @param options_count Number of options for the request.
+ * @param payload_source Payload source for the request.
+ * @param preferred_block_size Preferred block size (0 for the default block size).
+ * @param client_parameters Optional client parameters to customize the client behavior. Pass NULL for defaults.
+ * If an ack timeout is specified, it is also used as the time after which missing Q-Block2 blocks are requested.
+ * @param listener Listener object that will receive callbacks regarding any response or error.
+ * @param request_handle Handle to the request, that may be used subsequently to cancel the request.
+ * (the caller may pass NULL if it isn't interested in the handle value).
+ *
+ * @return GG_SUCCESS if the request could be sent, or a negative error code.
+ */
+GG_Result GG_CoapEndpoint_SendQBlockRequest(GG_CoapEndpoint*                  self,
+                                            GG_CoapMethod                     method,
+                                            GG_CoapMessageOptionParam*        options,
+                                            size_t                            options_count,
+                                            GG_CoapBlockSource*               payload_source,
+                                            size_t                            preferred_block_size,
+                                            const GG_CoapClientParameters*    client_parameters,
+                                            GG_CoapBlockwiseResponseListener* listener,
+                                            GG_CoapRequestHandle*             request_handle);
+
 /**
  * Cancel a previously sent blockwise request.
  * When a request is cancelled, its listener will no longer be called, even if a response datagram is
@@ -270,6 +391,8 @@ GG_Result GG_CoapEndpoint_CancelBlockwiseRequest(GG_CoapEndpoint* self, GG_CoapR
  * it is resumed.
  * This method may be used by a GG_CoapBlockwiseResponseListener::OnResponseBlock callback if it isn't
  * ready to receive more callbacks (when it is ready again, it can call GG_CoapEndpoint_ResumeBlockwiseRequest).
+ * Responses to block requests that were already in flight when the request was paused are kept, and
+ * delivered to the listener when the request is resumed.
  *
  * @param self The object on which this method is called.
  * @param request_handle Handle of the request to pause.
@@ -301,7 +424,7 @@ GG_Result GG_CoapEndpoint_ResumeBlockwiseRequest(GG_CoapEndpoint* self, GG_CoapR
  * @param payload Payload for the response.
  * @param payload_size Size of the payload.
  * @param block_option_number Block option number for the response
- * (GG_COAP_MESSAGE_OPTION_BLOCK1 or GG_COAP_MESSAGE_OPTION_BLOCK2)
+ * (GG_COAP_MESSAGE_OPTION_BLOCK1, GG_COAP_MESSAGE_OPTION_BLOCK2 or one of the Q-Block options)
  * @param block_info Details about the block.
  * @param response Pointer to the variable in which the object will be returned.
  *
@@ -330,7 +453,7 @@ GG_Result GG_CoapEndpoint_CreateBlockwiseResponse(GG_CoapEndpoint*
  * @param options_count Number of options for the response.
  * @param payload_source Payload source for the response.
  * @param block_option_number Block option number for the response
- * (GG_COAP_MESSAGE_OPTION_BLOCK1 or GG_COAP_MESSAGE_OPTION_BLOCK2)
+ * (GG_COAP_MESSAGE_OPTION_BLOCK1, GG_COAP_MESSAGE_OPTION_BLOCK2 or one of the Q-Block options)
  * @param block_info Details about the block.
  * @param response Pointer to the variable in which the object will be returned.
  *
@@ -364,6 +487,17 @@ void GG_CoapEndpoint_InspectBlockwiseRequestContexts(GG_CoapEndpoint*
                                                      GG_Inspector*               inspector,
                                                      const GG_InspectionOptions* options);
 
+/**
+ * Offer a response that doesn't match any pending request to the pending blockwise request contexts.
+ * (Q-Block2 servers send several responses to a single request)
+ *
+ * @param self The object on which this method is called.
+ * @param response The response.
+ *
+ * @return true if the response was handled as part of a blockwise transfer, false otherwise.
+ */
+bool GG_CoapEndpoint_OnUnmatchedBlockwiseResponse(GG_CoapEndpoint* self, GG_CoapMessage* response);
+
 /**
  * Encode block info into a block option value.
  *
@@ -380,7 +514,8 @@ GG_Result GG_CoapMessageBlockInfo_ToOptionValue(const GG_CoapMessageBlockInfo*
  *
  * @param self The object on which this method is invoked.
  * @param block_type The type of block transfer this object is helping with.
- * (GG_COAP_MESSAGE_OPTION_BLOCK1 for PUT/POST or GG_COAP_MESSAGE_OPTION_BLOCK2 for GET)
+ * (GG_COAP_MESSAGE_OPTION_BLOCK1 or GG_COAP_MESSAGE_OPTION_QBLOCK1 for PUT/POST, or
+ * GG_COAP_MESSAGE_OPTION_BLOCK2 or GG_COAP_MESSAGE_OPTION_QBLOCK2 for GET)
  * @param preferred_block_size The preferred block size for the server. Pass 0 to use a default value.
  */
 void GG_CoapBlockwiseServerHelper_Init(GG_CoapBlockwiseServerHelper* self,
@@ -422,14 +557,16 @@ GG_Result GG_CoapBlockwiseServerHelper_OnRequest(GG_CoapBlockwiseServerHelper* s
  * @param endpoint The endpoint to use to create the response object.
  * @param request The request for which the response is.
  * @param code The response code. Should be GG_COAP_MESSAGE_CODE_CONTINUE for BLOCK1 transfers when
- * the block is not the last block, unless an error condition needs to be returned.
+ * the block is not the last block (or for QBLOCK1 transfers until `done` is true), unless an error
+ * condition needs to be returned.
  * @param payload Payload for the response (NULL for BLOCK1).
  * @param payload_size Size of the payload.
  * @param options Optional list of response options (may be NULL if there are none).
  * @param options_count Number of options in the options list.
  * @param response Pointer to variable in which the response should be returned.
  *
- * @return GG_SUCCESS if the response could be created, or a negative error code.
+ * @return GG_SUCCESS if the response could be created, GG_ERROR_WOULD_BLOCK (with `*response` set to NULL)
+ * if no response should be sent (QBLOCK1 NON requests), or a negative error code.
  */
 GG_Result GG_CoapBlockwiseServerHelper_CreateResponse(GG_CoapBlockwiseServerHelper* self,
                                                       GG_CoapEndpoint*              endpoint,
@@ -441,6 +578,35 @@ GG_Result GG_CoapBlockwiseServerHelper_CreateResponse(GG_CoapBlockwiseServerHelp
                                                       size_t                        payload_size,
                                                       GG_CoapMessage**              response);
 
+/**
+ * Create a response, with a payload supplied by a GG_CoapBlockSource, based on the previously
+ * processed request (GG_CoapBlockwiseServerHelper_OnRequest)
+ * For QBLOCK2 transfers, the returned response carries the first requested block, and the other
+ * requested blocks are sent right away, as NON responses (so they may be received before the
+ * returned response). Requested blocks past the end of the payload are ignored.
+ *
+ * @param self The object on which this method is invoked.
+ * @param endpoint The endpoint to use to create and send responses.
+ * @param request The request for which the response is.
+ * @param transport_metadata Metadata of the request, as passed to the handler.
+ * @param code The response code.
+ * @param options Optional list of response options (may be NULL if there are none).
+ * @param options_count Number of options in the options list.
+ * @param payload_source Source of the payload.
+ * @param response Pointer to variable in which the response should be returned.
+ *
+ * @return GG_SUCCESS if the response could be created, or a negative error code.
+ */
+GG_Result GG_CoapBlockwiseServerHelper_CreateResponseFromBlockSource(GG_CoapBlockwiseServerHelper* self,
+                                                                     GG_CoapEndpoint*              endpoint,
+                                                                     const GG_CoapMessage*         request,
+                                                                     const GG_BufferMetadata*      transport_metadata,
+                                                                     uint8_t                       code,
+                                                                     GG_CoapMessageOptionParam*    options,
+                                                                     size_t                        options_count,
+                                                                     GG_CoapBlockSource*           payload_source,
+                                                                     GG_CoapMessage**              response);
+
 //! @}
 
 #if defined(__cplusplus)
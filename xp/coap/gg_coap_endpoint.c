@@ -28,6 +28,7 @@
 #include "gg_coap_endpoint.h"
 #include "gg_coap_message.h"
 #include "gg_coap_blockwise.h"
+#include "gg_coap_observe.h"
 #include "xp/common/gg_port.h"
 #include "xp/common/gg_logging.h"
 #include "xp/common/gg_memory.h"
@@ -62,14 +63,20 @@ typedef struct {
     GG_IMPLEMENTS(GG_TimerListener);
 
     GG_LinkedListNode        list_node;        ///< List node to allow linking this object
+    GG_LinkedListNode        token_node;       ///< List node to allow linking this object in a token bucket
     GG_CoapEndpoint*         endpoint;         ///< Endpoint to which the object belongs
     GG_CoapRequestHandle     handle;           ///< Handle used to identify the request when cancelling
     GG_CoapMessage*          message;          ///< Message representing the request
+    uint8_t                  token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH]; ///< Token of the request
+    size_t                   token_length;     ///< Size of the token
     GG_CoapRequestState      state;            ///< Current state of the request
     GG_Timer*                resend_timer;     ///< Timer used to resend the request after a certain time
     uint32_t                 resend_timeout;   ///< Timeout after which we need to resend, in ms
+    uint32_t                 rto;              ///< RTO estimate for the peer (0 to double the timeout on resends)
     uint8_t                  resend_count;     ///< Number of times we've already resent
     uint8_t                  max_resend_count; ///< Maximum number of resends
+    bool                     sent;             ///< True once the request has been sent at least once
+    uint32_t                 send_time;        ///< Scheduler time at which the request was first sent
     GG_CoapResponseListener* listener;         ///< Listener for ack/error/response
 } GG_CoapRequestContext;
 
@@ -78,6 +85,7 @@ typedef struct {
  */
 struct GG_CoapResponder {
     GG_CoapEndpoint*   endpoint;         ///< Endpoint to which the responder belongs
+    GG_CoapObjectPool* pool;             ///< Pool to which the object must be returned
     GG_CoapMessage*    request;          ///< Request to which this object is responding
     GG_BufferMetadata* request_metadata; ///< Request metadata (NULL or socket address)
 };
@@ -176,10 +184,15 @@ GG_CoapRequestContext_Destroy(GG_CoapRequestContext* self)
 {
     if (self == NULL) return;
 
+    // remove from the token table if we're in it
+    if (!GG_LINKED_LIST_NODE_IS_UNLINKED(&self->token_node)) {
+        GG_LINKED_LIST_NODE_REMOVE(&self->token_node);
+    }
+
     GG_Timer_Destroy(self->resend_timer);
     GG_CoapMessage_Destroy(self->message);
 
-    GG_ClearAndFreeObject(self, 1);
+    GG_CoapObjectPool_Free(self->endpoint->request_pool, self);
 }
 
 //----------------------------------------------------------------------
@@ -252,6 +265,12 @@ GG_CoapRequestContext_TryToSend(GG_CoapRequestContext* self)
 #endif
             GG_LOG_FINE("request sent, now waiting for ACK");
             self->state = GG_COAP_REQUEST_STATE_WAITING_FOR_ACK;
+
+            // remember when the request was first sent, to measure the round-trip time
+            if (!self->sent) {
+                self->sent      = true;
+                self->send_time = GG_TimerScheduler_GetTime(self->endpoint->timer_scheduler);
+            }
         }
     }
     GG_Buffer_Release(datagram);
@@ -284,7 +303,7 @@ GG_CoapRequestContext_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uin
                 (int)self->resend_count);
     if (self->resend_count < self->max_resend_count) {
         // compute the new timeout
-        self->resend_timeout *= 2;
+        self->resend_timeout = GG_CoapEndpoint_BackOffResendTimeout(self->resend_timeout, self->rto);
 
         // mark that we're ready to send
         self->state = GG_COAP_REQUEST_STATE_READY_TO_SEND;
@@ -317,7 +336,7 @@ GG_CoapRequestContext_Create(GG_CoapEndpoint*               endpoint,
                              GG_CoapRequestContext**        request_context)
 {
     // create a request context
-    *request_context = (GG_CoapRequestContext*)GG_AllocateZeroMemory(sizeof(GG_CoapRequestContext));
+    *request_context = (GG_CoapRequestContext*)GG_CoapObjectPool_Allocate(endpoint->request_pool);
     if (*request_context == NULL) {
         return GG_ERROR_OUT_OF_MEMORY;
     }
@@ -344,15 +363,15 @@ GG_CoapRequestContext_Create(GG_CoapEndpoint*               endpoint,
     }
 
     if (self->resend_timeout == 0) {
-        // pick a random value for the resend timeout
-        uint32_t random_range = (uint32_t)(GG_COAP_ACK_TIMEOUT_MS * (GG_COAP_ACK_RANDOM_FACTOR - 1.0));
-        self->resend_timeout  = (uint16_t)(GG_COAP_ACK_TIMEOUT_MS + (GG_GetRandomInteger() % random_range));
+        // pick a random value for the resend timeout, based on the round-trip time to the peer
+        // (requests are sent without a destination address, to the other end of the transport)
+        self->resend_timeout = GG_CoapEndpoint_GetResendTimeout(endpoint, NULL, &self->rto);
     }
 
     // create a timer
     GG_Result result = GG_TimerScheduler_CreateTimer(endpoint->timer_scheduler, &self->resend_timer);
     if (GG_FAILED(result)) {
-        GG_FreeMemory(self);
+        GG_CoapObjectPool_Free(endpoint->request_pool, self);
         return result;
     }
 
@@ -370,11 +389,11 @@ GG_CoapRequestContext_Create(GG_CoapEndpoint*               endpoint,
 static GG_Result
 GG_CoapEndpoint_EnqueueResponse(GG_CoapEndpoint* self, GG_Buffer* response, const GG_BufferMetadata* metadata)
 {
-    GG_ASSERT(self->responses.cursor <  GG_ARRAY_SIZE(self->responses.datagrams));
-    GG_ASSERT(self->responses.count  <= GG_ARRAY_SIZE(self->responses.datagrams));
+    GG_ASSERT(self->responses.cursor <  self->responses.capacity);
+    GG_ASSERT(self->responses.count  <= self->responses.capacity);
 
     // check if there's space in the queue
-    if (self->responses.count == GG_ARRAY_SIZE(self->responses.datagrams)) {
+    if (self->responses.count == self->responses.capacity) {
         return GG_ERROR_OUT_OF_RESOURCES;
     }
 
@@ -386,16 +405,71 @@ GG_CoapEndpoint_EnqueueResponse(GG_CoapEndpoint* self, GG_Buffer* response, cons
     }
 
     // add the response to the circular queue
-    size_t tail = (self->responses.cursor + self->responses.count) %
-                  GG_ARRAY_SIZE(self->responses.datagrams);
-    self->responses.datagrams[tail] = response;
-    self->responses.metadata[tail] = metadata_clone;
+    size_t tail = (self->responses.cursor + self->responses.count) % self->responses.capacity;
+    self->responses.entries[tail].datagram = response;
+    self->responses.entries[tail].metadata = metadata_clone;
     ++self->responses.count;
+    self->responses.stats.high_water = GG_MAX(self->responses.stats.high_water, self->responses.count);
     GG_LOG_FINE("enqued at %u", (int)tail);
 
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Release all the entries of the response queue
+//----------------------------------------------------------------------
+static void
+GG_CoapEndpoint_ClearResponseQueue(GG_CoapEndpoint* self)
+{
+    for (; self->responses.count; --self->responses.count) {
+        GG_CoapResponseQueueEntry* entry = &self->responses.entries[self->responses.cursor];
+        GG_Buffer_Release(entry->datagram);
+        if (entry->metadata) {
+            GG_FreeMemory(entry->metadata);
+        }
+        self->responses.cursor = (self->responses.cursor + 1) % self->responses.capacity;
+    }
+    self->responses.cursor = 0;
+}
+
+//----------------------------------------------------------------------
+// Count the queued responses that are addressed to a peer
+//----------------------------------------------------------------------
+static size_t
+GG_CoapEndpoint_CountQueuedResponses(GG_CoapEndpoint* self, const GG_SocketAddress* peer)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < self->responses.count; i++) {
+        size_t                  index      = (self->responses.cursor + i) % self->responses.capacity;
+        const GG_SocketAddress* entry_peer = GG_CoapEndpoint_GetPeerAddress(self->responses.entries[index].metadata);
+        if (entry_peer &&
+            entry_peer->port == peer->port &&
+            GG_IpAddress_Equal(&entry_peer->address, &peer->address)) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+//----------------------------------------------------------------------
+// Let the transport source know that requests can be accepted again, if
+// some were refused because the response queue was full
+//----------------------------------------------------------------------
+static void
+GG_CoapEndpoint_UnblockInput(GG_CoapEndpoint* self)
+{
+    if (!self->responses.input_blocked || self->responses.count >= self->responses.capacity) {
+        return;
+    }
+
+    GG_LOG_FINE("response queue has space, unblocking input");
+    self->responses.input_blocked = false;
+    if (self->sink_listener) {
+        GG_DataSinkListener_OnCanPut(self->sink_listener);
+    }
+}
+
 //----------------------------------------------------------------------
 // Send as many queued responses as possible
 //----------------------------------------------------------------------
@@ -403,8 +477,8 @@ static void
 GG_CoapEndpoint_SendPendingResponses(GG_CoapEndpoint* self)
 {
     while (self->responses.count) {
-        GG_Buffer*         datagram = self->responses.datagrams[self->responses.cursor];
-        GG_BufferMetadata* metadata = self->responses.metadata[self->responses.cursor];
+        GG_Buffer*         datagram = self->responses.entries[self->responses.cursor].datagram;
+        GG_BufferMetadata* metadata = self->responses.entries[self->responses.cursor].metadata;
 
         GG_LOG_FINE("processing queued response %u (count = %u)",
                     (int)self->responses.cursor,
@@ -418,7 +492,7 @@ GG_CoapEndpoint_SendPendingResponses(GG_CoapEndpoint* self)
                 if (result == GG_ERROR_WOULD_BLOCK) {
                     // stop trying
                     GG_LOG_FINE("would block, stopping");
-                    return;
+                    break;
                 } else {
                     // move on
                     GG_LOG_FINE("sink error, dropping (%d)", result);
@@ -428,42 +502,256 @@ GG_CoapEndpoint_SendPendingResponses(GG_CoapEndpoint* self)
 
         // remove from the queue
         --self->responses.count;
-        self->responses.cursor = (self->responses.cursor + 1) % GG_ARRAY_SIZE(self->responses.datagrams);
+        self->responses.cursor = (self->responses.cursor + 1) % self->responses.capacity;
         GG_Buffer_Release(datagram);
         if (metadata) {
             GG_FreeMemory(metadata);
         }
     }
+
+    // accept requests again if we had stopped
+    GG_CoapEndpoint_UnblockInput(self);
 }
 
 //----------------------------------------------------------------------
-// Try to send a response
+// Get the peer address from request or response metadata, if any
 //----------------------------------------------------------------------
-static GG_Result
-GG_CoapEndpoint_SendResponse(GG_CoapEndpoint* self, const GG_CoapMessage* response, const GG_BufferMetadata* metadata)
+const GG_SocketAddress*
+GG_CoapEndpoint_GetPeerAddress(const GG_BufferMetadata* metadata)
 {
-#if defined(GG_CONFIG_ENABLE_LOGGING)
-    GG_LOG_FINER("trying to send response (%u in queue)", (int)self->responses.count);
-    GG_CoapEndpoint_LogMessage(response, GG_LOG_LEVEL_FINER);
-#endif
+    if (metadata &&
+        (metadata->type == GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS ||
+         metadata->type == GG_BUFFER_METADATA_TYPE_DESTINATION_SOCKET_ADDRESS)) {
+        return &((const GG_SocketAddressMetadata*)metadata)->socket_address;
+    }
 
-    // first try to send any pending responses
-    GG_CoapEndpoint_SendPendingResponses(self);
+    return NULL;
+}
 
-    // drop the response if there's no sink
-    if (!self->connection_sink) {
-        GG_LOG_FINE("no sink, dropping");
-        return GG_SUCCESS;
+//----------------------------------------------------------------------
+// Check if a round-trip time entry represents a peer
+//----------------------------------------------------------------------
+static bool
+GG_CoapPeerRtt_Matches(const GG_CoapPeerRtt* self, const GG_SocketAddress* peer)
+{
+    if (!self->in_use) {
+        return false;
+    }
+    if (peer == NULL) {
+        return !self->has_peer;
     }
 
-    // convert the message to a datagram
-    GG_Buffer* datagram = NULL;
-    GG_Result  result   = GG_CoapMessage_ToDatagram(response, &datagram);
-    if (GG_FAILED(result)) {
-        return result;
+    return self->has_peer && self->peer.port == peer->port && GG_IpAddress_Equal(&self->peer.address, &peer->address);
+}
+
+//----------------------------------------------------------------------
+// Find the round-trip time state of a peer.
+// RTOs that haven't been updated for a while are aged: small values grow
+// back, and large values decay towards the RFC 7252 default of 2s.
+//----------------------------------------------------------------------
+static GG_CoapPeerRtt*
+GG_CoapEndpoint_FindPeerRtt(GG_CoapEndpoint* self, const GG_SocketAddress* peer)
+{
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->peer_rtts); i++) {
+        GG_CoapPeerRtt* entry = &self->peer_rtts[i];
+        if (!GG_CoapPeerRtt_Matches(entry, peer)) {
+            continue;
+        }
+
+        uint32_t now  = GG_TimerScheduler_GetTime(self->timer_scheduler);
+        uint32_t idle = now - entry->last_update;
+        if (entry->rto < 1000 && idle > 16 * entry->rto) {
+            entry->rto         = 2 * entry->rto;
+            entry->last_update = now;
+        } else if (entry->rto > 3000 && idle > 4 * entry->rto) {
+            entry->rto         = 1000 + entry->rto / 2;
+            entry->last_update = now;
+        }
+
+        return entry;
+    }
+
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Update an estimator with a new sample, and return its RTO, using a
+// variance multiplier of k (RFC 6298 section 2)
+//----------------------------------------------------------------------
+static uint32_t
+GG_CoapRttEstimator_Update(GG_CoapRttEstimator* self, uint32_t rtt, uint32_t k)
+{
+    rtt = GG_MAX(rtt, 1);
+    if (self->srtt == 0) {
+        self->srtt   = rtt;
+        self->rttvar = rtt / 2;
+    } else {
+        uint32_t delta = self->srtt > rtt ? self->srtt - rtt : rtt - self->srtt;
+        self->rttvar = (3 * self->rttvar + delta) / 4;
+        self->srtt   = (7 * self->srtt + rtt) / 8;
     }
 
+    return self->srtt + k * self->rttvar;
+}
+
+//----------------------------------------------------------------------
+void
+GG_CoapEndpoint_OnRttSample(GG_CoapEndpoint*        self,
+                            const GG_SocketAddress* peer,
+                            uint32_t                rtt,
+                            size_t                  retransmission_count)
+{
+    // with more than 2 retransmissions, we can't tell which one is acknowledged
+    if (retransmission_count > 2) {
+        return;
+    }
+
+    // find the state for the peer, or create it, replacing the least recently updated entry
+    GG_CoapPeerRtt* entry = GG_CoapEndpoint_FindPeerRtt(self, peer);
+    uint32_t        now   = GG_TimerScheduler_GetTime(self->timer_scheduler);
+    if (entry == NULL) {
+        entry = &self->peer_rtts[0];
+        for (size_t i = 0; i < GG_ARRAY_SIZE(self->peer_rtts) && entry->in_use; i++) {
+            GG_CoapPeerRtt* candidate = &self->peer_rtts[i];
+            if (!candidate->in_use || now - candidate->last_update > now - entry->last_update) {
+                entry = candidate;
+            }
+        }
+        memset(entry, 0, sizeof(*entry));
+        entry->in_use = true;
+        if (peer) {
+            entry->peer     = *peer;
+            entry->has_peer = true;
+        }
+        entry->rto = GG_COAP_ACK_TIMEOUT_MS;
+    }
+
+    // combine the strong or weak estimate with the overall RTO
+    uint32_t rto;
+    if (retransmission_count == 0) {
+        rto = (entry->rto + GG_CoapRttEstimator_Update(&entry->strong, rtt, 4)) / 2;
+    } else {
+        rto = (3 * entry->rto + GG_CoapRttEstimator_Update(&entry->weak, rtt, 1)) / 4;
+    }
+    entry->rto         = GG_MIN(GG_MAX(rto, 1), GG_COAP_MAX_RTO_MS);
+    entry->last_update = now;
+    GG_LOG_FINER("rtt sample = %u ms, rto = %u ms", (int)rtt, (int)entry->rto);
+}
+
+//----------------------------------------------------------------------
+uint32_t
+GG_CoapEndpoint_GetResendTimeout(GG_CoapEndpoint* self, const GG_SocketAddress* peer, uint32_t* rto)
+{
+    GG_CoapPeerRtt* entry = GG_CoapEndpoint_FindPeerRtt(self, peer);
+    uint32_t        base  = entry ? entry->rto : GG_COAP_ACK_TIMEOUT_MS;
+    if (rto) {
+        *rto = entry ? entry->rto : 0;
+    }
+
+    // pick a random value between the RTO and the RTO times the random factor
+    uint32_t random_range = (uint32_t)(base * (GG_COAP_ACK_RANDOM_FACTOR - 1.0));
+    return base + (random_range ? GG_GetRandomInteger() % random_range : 0);
+}
+
+//----------------------------------------------------------------------
+uint32_t
+GG_CoapEndpoint_BackOffResendTimeout(uint32_t timeout, uint32_t rto)
+{
+    if (rto == 0) {
+        return 2 * timeout;
+    } else if (rto < 1000) {
+        return 3 * timeout;
+    } else if (rto > 3000) {
+        return timeout + timeout / 2;
+    } else {
+        return 2 * timeout;
+    }
+}
+
+//----------------------------------------------------------------------
+static void
+GG_CoapExchangeCacheEntry_Clear(GG_CoapExchangeCacheEntry* self)
+{
+    if (self->response) {
+        GG_Buffer_Release(self->response);
+    }
+    memset(self, 0, sizeof(*self));
+}
+
+//----------------------------------------------------------------------
+// Find the exchange cache entry for a request received from a peer.
+// Stale entries are cleared as they are encountered.
+//----------------------------------------------------------------------
+static GG_CoapExchangeCacheEntry*
+GG_CoapEndpoint_FindExchange(GG_CoapEndpoint* self, const GG_BufferMetadata* metadata, uint16_t message_id)
+{
+    const GG_SocketAddress* peer = GG_CoapEndpoint_GetPeerAddress(metadata);
+    uint32_t                now  = GG_TimerScheduler_GetTime(self->timer_scheduler);
+
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->exchange_cache.entries); i++) {
+        GG_CoapExchangeCacheEntry* entry = &self->exchange_cache.entries[i];
+        if (!entry->in_use || entry->message_id != message_id) {
+            continue;
+        }
+        if ((int32_t)(now - entry->expiration) >= 0) {
+            GG_CoapExchangeCacheEntry_Clear(entry);
+            continue;
+        }
+        if (peer == NULL) {
+            if (!entry->has_peer) {
+                return entry;
+            }
+        } else if (entry->has_peer &&
+                   entry->peer.port == peer->port &&
+                   GG_IpAddress_Equal(&entry->peer.address, &peer->address)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Remember a request received from a peer, evicting a stale entry or,
+// if there are none, the entry that would expire first.
+//----------------------------------------------------------------------
+static void
+GG_CoapEndpoint_AddExchange(GG_CoapEndpoint* self, const GG_BufferMetadata* metadata, uint16_t message_id)
+{
+    uint32_t                   now   = GG_TimerScheduler_GetTime(self->timer_scheduler);
+    GG_CoapExchangeCacheEntry* entry = NULL;
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->exchange_cache.entries); i++) {
+        GG_CoapExchangeCacheEntry* candidate = &self->exchange_cache.entries[i];
+        if (!candidate->in_use || (int32_t)(now - candidate->expiration) >= 0) {
+            entry = candidate;
+            break;
+        }
+        if (entry == NULL || (int32_t)(candidate->expiration - entry->expiration) < 0) {
+            entry = candidate;
+        }
+    }
+    GG_CoapExchangeCacheEntry_Clear(entry);
+
+    const GG_SocketAddress* peer = GG_CoapEndpoint_GetPeerAddress(metadata);
+    if (peer) {
+        entry->peer     = *peer;
+        entry->has_peer = true;
+    }
+    entry->in_use     = true;
+    entry->message_id = message_id;
+    entry->expiration = now + GG_CONFIG_COAP_EXCHANGE_LIFETIME_MS;
+}
+
+//----------------------------------------------------------------------
+// Try to send a response datagram, or enqueue it if it can't be sent
+// right away.
+// The caller's reference to the datagram is transferred to this function.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapEndpoint_SendResponseDatagram(GG_CoapEndpoint* self, GG_Buffer* datagram, const GG_BufferMetadata* metadata)
+{
     // if the queue is empty, try to send right away
+    GG_Result result;
     if (self->responses.count == 0) {
         result = GG_DataSink_PutData(self->connection_sink, datagram, metadata);
         if (GG_SUCCEEDED(result)) {
@@ -486,13 +774,53 @@ GG_CoapEndpoint_SendResponse(GG_CoapEndpoint* self, const GG_CoapMessage* respon
     result = GG_CoapEndpoint_EnqueueResponse(self, datagram, metadata);
     if (GG_FAILED(result)) {
         GG_LOG_WARNING("failed to enqueue response (%d)", result);
-    GG_Buffer_Release(datagram);
+        ++self->responses.stats.dropped;
+        GG_Buffer_Release(datagram);
         return result;
     }
 
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Try to send a response
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapEndpoint_SendResponse(GG_CoapEndpoint* self, const GG_CoapMessage* response, const GG_BufferMetadata* metadata)
+{
+#if defined(GG_CONFIG_ENABLE_LOGGING)
+    GG_LOG_FINER("trying to send response (%u in queue)", (int)self->responses.count);
+    GG_CoapEndpoint_LogMessage(response, GG_LOG_LEVEL_FINER);
+#endif
+
+    // first try to send any pending responses
+    GG_CoapEndpoint_SendPendingResponses(self);
+
+    // drop the response if there's no sink
+    if (!self->connection_sink) {
+        GG_LOG_FINE("no sink, dropping");
+        return GG_SUCCESS;
+    }
+
+    // convert the message to a datagram
+    GG_Buffer* datagram = NULL;
+    GG_Result  result   = GG_CoapMessage_ToDatagram(response, &datagram);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+
+    // keep the datagram, so it can be replayed if the request is received again
+    if (GG_CoapMessage_GetType(response) == GG_COAP_MESSAGE_TYPE_ACK) {
+        GG_CoapExchangeCacheEntry* exchange =
+            GG_CoapEndpoint_FindExchange(self, metadata, GG_CoapMessage_GetMessageId(response));
+        if (exchange && exchange->response == NULL) {
+            exchange->response = GG_Buffer_Retain(datagram);
+        }
+    }
+
+    return GG_CoapEndpoint_SendResponseDatagram(self, datagram, metadata);
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_CoapResponder_CreateResponse(GG_CoapResponder*          self,
@@ -553,11 +881,11 @@ GG_CoapResponder_Release(GG_CoapResponder* self)
     // destroy the request
     GG_CoapMessage_Destroy(self->request);
 
-    // destroy ourself
+    // destroy ourself (the endpoint may already be gone, but not the pool)
     if (self->request_metadata) {
         GG_FreeMemory(self->request_metadata);
     }
-    GG_FreeMemory(self);
+    GG_CoapObjectPool_Free(self->pool, self);
 }
 
 //----------------------------------------------------------------------
@@ -573,19 +901,167 @@ GG_CoapEndpoint_CreateResponder(GG_CoapEndpoint*         self,
                                 GG_CoapResponder**       responder)
 {
     // allocate a new object
-    *responder = GG_AllocateZeroMemory(sizeof(GG_CoapResponder));
+    *responder = (GG_CoapResponder*)GG_CoapObjectPool_Allocate(self->responder_pool);
     if (*responder == NULL) {
         return GG_ERROR_OUT_OF_MEMORY;
     }
 
     // initialize the object
     (*responder)->endpoint = self;
+    (*responder)->pool     = self->responder_pool;
     (*responder)->request  = request;
     GG_BufferMetadata_Clone(metadata, &(*responder)->request_metadata);
 
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Find the child of a trie node with a given segment name
+//----------------------------------------------------------------------
+static GG_CoapPathTrieNode*
+GG_CoapPathTrieNode_FindChild(const GG_CoapPathTrieNode* self, const char* segment, size_t segment_length)
+{
+    for (GG_CoapPathTrieNode* child = self->first_child; child; child = child->next_sibling) {
+        if (child->segment_length == segment_length && !memcmp(child->segment, segment, segment_length)) {
+            return child;
+        }
+    }
+
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// (Re)build the handler trie from the list of handlers.
+// The node array is only re-allocated when it needs to grow, so this
+// can't fail when handlers are removed.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapEndpoint_BuildHandlerTrie(GG_CoapEndpoint* self)
+{
+    // count the nodes we may need: the root plus one per path segment
+    size_t node_count = 1;
+    GG_LINKED_LIST_FOREACH(node, &self->handlers) {
+        GG_CoapRequestHandlerNode* handler_node = GG_LINKED_LIST_ITEM(node, GG_CoapRequestHandlerNode, list_node);
+        ++node_count;
+        for (const char* path = handler_node->path; *path; ++path) {
+            if (*path == '/') {
+                ++node_count;
+            }
+        }
+    }
+
+    // grow the node array if needed
+    if (node_count > self->handler_trie.capacity) {
+        GG_CoapPathTrieNode* nodes = GG_AllocateMemory(node_count * sizeof(GG_CoapPathTrieNode));
+        if (nodes == NULL) {
+            return GG_ERROR_OUT_OF_MEMORY;
+        }
+        if (self->handler_trie.nodes) {
+            GG_FreeMemory(self->handler_trie.nodes);
+        }
+        self->handler_trie.nodes    = nodes;
+        self->handler_trie.capacity = node_count;
+    }
+
+    // start with just the root
+    GG_CoapPathTrieNode* root = &self->handler_trie.nodes[0];
+    memset(root, 0, sizeof(*root));
+    size_t nodes_used = 1;
+
+    // add each handler path, in registration order
+    size_t rank = 0;
+    GG_LINKED_LIST_FOREACH(node, &self->handlers) {
+        GG_CoapRequestHandlerNode* handler_node = GG_LINKED_LIST_ITEM(node, GG_CoapRequestHandlerNode, list_node);
+        GG_CoapPathTrieNode*       trie_node    = root;
+        const char*                segment      = handler_node->path;
+        for (;;) {
+            const char* segment_end = segment;
+            while (*segment_end && *segment_end != '/') {
+                ++segment_end;
+            }
+            size_t segment_length = (size_t)(segment_end - segment);
+
+            // find or create the node for this segment
+            GG_CoapPathTrieNode* child = GG_CoapPathTrieNode_FindChild(trie_node, segment, segment_length);
+            if (child == NULL) {
+                GG_ASSERT(nodes_used < self->handler_trie.capacity);
+                child = &self->handler_trie.nodes[nodes_used++];
+                memset(child, 0, sizeof(*child));
+                child->segment        = segment;
+                child->segment_length = segment_length;
+                child->next_sibling   = trie_node->first_child;
+                trie_node->first_child = child;
+            }
+            trie_node = child;
+
+            if (*segment_end == '\0') {
+                break;
+            }
+            segment = segment_end + 1;
+        }
+
+        // the first handler registered for a path wins
+        if (trie_node->handler == NULL) {
+            trie_node->handler      = handler_node;
+            trie_node->handler_rank = rank;
+        }
+        ++rank;
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Find the handler for a request.
+// A handler matches when all the segments of its path match the first URI
+// path components of the request. When more than one handler matches, the
+// one that was registered first is returned.
+//----------------------------------------------------------------------
+static GG_CoapRequestHandlerNode*
+GG_CoapEndpoint_FindRequestHandler(GG_CoapEndpoint* self, const GG_CoapMessage* request)
+{
+    if (self->handler_trie.nodes == NULL) {
+        return NULL;
+    }
+
+    GG_CoapRequestHandlerNode*   handler   = NULL;
+    size_t                       rank      = 0;
+    const GG_CoapPathTrieNode*   trie_node = &self->handler_trie.nodes[0];
+    GG_CoapMessageOptionIterator iterator;
+    GG_CoapMessage_InitOptionIterator(request, GG_COAP_MESSAGE_OPTION_URI_PATH, &iterator);
+    while (iterator.option.type == GG_COAP_MESSAGE_OPTION_TYPE_STRING) {
+        // a uri path component containing '/' chars must match several levels of the trie
+        const char* chars  = iterator.option.value.string.chars;
+        size_t      length = iterator.option.value.string.length;
+        for (;;) {
+            size_t segment_length = 0;
+            while (segment_length < length && chars[segment_length] != '/') {
+                ++segment_length;
+            }
+            trie_node = GG_CoapPathTrieNode_FindChild(trie_node, chars, segment_length);
+            if (trie_node == NULL) {
+                return handler;
+            }
+            if (segment_length == length) {
+                break;
+            }
+            chars  += segment_length + 1;
+            length -= segment_length + 1;
+        }
+
+        // keep the earliest registered handler seen so far
+        if (trie_node->handler && (handler == NULL || trie_node->handler_rank < rank)) {
+            handler = trie_node->handler;
+            rank    = trie_node->handler_rank;
+        }
+
+        // move on to the next uri path segment, if any
+        GG_CoapMessage_StepOptionIterator(request, &iterator);
+    }
+
+    return handler;
+}
+
 //----------------------------------------------------------------------
 // Handle a request.
 //
@@ -618,6 +1094,25 @@ GG_CoapEndpoint_OnRequest(GG_CoapEndpoint* self, GG_CoapMessage* request, const
         }
     }
 
+    // check if this is a duplicate of a recently received CON request
+    if (GG_CoapMessage_GetType(request) == GG_COAP_MESSAGE_TYPE_CON) {
+        uint16_t                   message_id = GG_CoapMessage_GetMessageId(request);
+        GG_CoapExchangeCacheEntry* exchange   = GG_CoapEndpoint_FindExchange(self, metadata, message_id);
+        if (exchange) {
+            ++self->exchange_cache.hits;
+            if (exchange->response == NULL) {
+                GG_LOG_FINE("duplicate request, no response yet, dropping");
+            } else if (self->connection_sink) {
+                GG_LOG_FINE("duplicate request, replaying response");
+                GG_CoapEndpoint_SendPendingResponses(self);
+                GG_CoapEndpoint_SendResponseDatagram(self, GG_Buffer_Retain(exchange->response), metadata);
+            }
+            return true;
+        }
+        ++self->exchange_cache.misses;
+        GG_CoapEndpoint_AddExchange(self, metadata, message_id);
+    }
+
     // prepare a default handler if needed
     GG_CoapRequestHandlerNode* handler;
     GG_CoapRequestHandlerNode  default_handler_node;
@@ -633,55 +1128,9 @@ GG_CoapEndpoint_OnRequest(GG_CoapEndpoint* self, GG_CoapMessage* request, const
     }
 
     // look for a handler
-    GG_LINKED_LIST_FOREACH(node, &self->handlers) {
-        GG_CoapRequestHandlerNode* handler_node = GG_LINKED_LIST_ITEM(node, GG_CoapRequestHandlerNode, list_node);
-
-        // try to match the path segment by segment
-        const char*                  path = handler_node->path;
-        GG_CoapMessageOptionIterator iterator;
-        GG_CoapMessage_InitOptionIterator(request, GG_COAP_MESSAGE_OPTION_URI_PATH, &iterator);
-        bool match = false;
-        GG_LOG_FINEST("looking for a match for handler at path %s", path);
-        while (iterator.option.type == GG_COAP_MESSAGE_OPTION_TYPE_STRING) {
-            // check that all the chars of the uri path segment match
-            match = true;
-            for (size_t i = 0; i < iterator.option.value.string.length; i++) {
-                if (path[i] == '\0' || path[i] != iterator.option.value.string.chars[i]) {
-                    // mismatch
-                    match = false;
-                    break;
-                }
-            }
-            if (!match) {
-                break;
-            }
-
-            // check that the uri path segment is completely matched
-            path += iterator.option.value.string.length;
-            if (*path == '\0') {
-                // end of the path, consider this a match (prefix)
-                break;
-            } else if (*path == '/') {
-                // we matched a segment, but there are more
-                ++path;
-                match = false;
-            } else {
-                // the path segment isn't
-                match = false;
-                break;
-            }
-
-            // move on to the next uri path segment, if any
-            GG_CoapMessage_StepOptionIterator(request, &iterator);
-        }
-
-        if (match) {
-            // handler found
-            handler = handler_node;
-
-            // done looking for a handler
-            break;
-        }
+    GG_CoapRequestHandlerNode* handler_node = GG_CoapEndpoint_FindRequestHandler(self, request);
+    if (handler_node) {
+        handler = handler_node;
     }
 
     if (handler) {
@@ -809,9 +1258,24 @@ GG_CoapEndpoint_OnRequest(GG_CoapEndpoint* self, GG_CoapMessage* request, const
     return fully_handled;
 }
 
+//----------------------------------------------------------------------
+// Get the bucket of the token table where requests with a given token are
+//----------------------------------------------------------------------
+static GG_LinkedList*
+GG_CoapEndpoint_GetTokenBucket(GG_CoapEndpoint* self, const uint8_t* token, size_t token_length)
+{
+    // FNV-1a hash of the token bytes
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < token_length; i++) {
+        hash = (hash ^ token[i]) * 16777619u;
+    }
+
+    return &self->requests_by_token[hash & (GG_CONFIG_COAP_REQUEST_TABLE_SIZE - 1)];
+}
+
 //----------------------------------------------------------------------
 static void
-GG_CoapEndpoint_OnResponse(GG_CoapEndpoint* self, GG_CoapMessage* response)
+GG_CoapEndpoint_OnResponse(GG_CoapEndpoint* self, GG_CoapMessage* response, const GG_BufferMetadata* metadata)
 {
     GG_CoapMessageType message_type = GG_CoapMessage_GetType(response);
 
@@ -823,14 +1287,13 @@ GG_CoapEndpoint_OnResponse(GG_CoapEndpoint* self, GG_CoapMessage* response)
     bool    matched = false;
     uint8_t message_token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
     size_t  message_token_length = GG_CoapMessage_GetToken(response, message_token);
-    GG_LINKED_LIST_FOREACH_SAFE(node, &self->requests) {
-        GG_CoapRequestContext* context = GG_LINKED_LIST_ITEM(node, GG_CoapRequestContext, list_node);
-        uint8_t                context_token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
-        size_t                 context_token_length = GG_CoapMessage_GetToken(context->message, context_token);
+    GG_LinkedList* bucket = GG_CoapEndpoint_GetTokenBucket(self, message_token, message_token_length);
+    GG_LINKED_LIST_FOREACH_SAFE(node, bucket) {
+        GG_CoapRequestContext* context = GG_LINKED_LIST_ITEM(node, GG_CoapRequestContext, token_node);
 
         // check if the token matches
-        if (context_token_length == message_token_length &&
-            !memcmp(context_token, message_token, context_token_length)) {
+        if (context->token_length == message_token_length &&
+            !memcmp(context->token, message_token, message_token_length)) {
             // match!
             GG_LOG_FINE("found matching context");
             matched = true;
@@ -852,6 +1315,12 @@ GG_CoapEndpoint_OnResponse(GG_CoapEndpoint* self, GG_CoapMessage* response)
                     if (message_type != GG_COAP_MESSAGE_TYPE_RST) {
                         context->state = GG_COAP_REQUEST_STATE_ACKED;
                         notify_ack     = true;
+
+                        // update the round-trip time estimate for the peer
+                        if (context->sent) {
+                            uint32_t now = GG_TimerScheduler_GetTime(self->timer_scheduler);
+                            GG_CoapEndpoint_OnRttSample(self, NULL, now - context->send_time, context->resend_count);
+                        }
                     }
                     break;
 
@@ -897,8 +1366,11 @@ GG_CoapEndpoint_OnResponse(GG_CoapEndpoint* self, GG_CoapMessage* response)
         }
     }
 
-    // dispose of the context if needed
-    if (!matched) {
+    // responses that don't match a request may still be part of a blockwise transfer,
+    // or be notifications (or ACKs/RSTs for notifications) of observed resources
+    if (!matched &&
+        !GG_CoapEndpoint_OnUnmatchedBlockwiseResponse(self, response) &&
+        !GG_CoapEndpoint_OnUnmatchedObserveMessage(self, response, metadata)) {
         GG_LOG_INFO("received unmatched message");
     }
 
@@ -909,6 +1381,35 @@ GG_CoapEndpoint_OnResponse(GG_CoapEndpoint* self, GG_CoapMessage* response)
     }
 }
 
+//----------------------------------------------------------------------
+// Check if a request can be accepted, given the state of the response queue.
+// When the queue is full, the input is blocked until some responses are sent.
+// When a peer already holds its share of the queue, its request is dropped.
+//----------------------------------------------------------------------
+static bool
+GG_CoapEndpoint_CanAcceptRequest(GG_CoapEndpoint* self, const GG_BufferMetadata* metadata)
+{
+    if (self->responses.count == 0) {
+        return true;
+    }
+
+    if (self->responses.count >= self->responses.capacity) {
+        GG_LOG_FINE("response queue full, blocking input");
+        self->responses.input_blocked = true;
+        ++self->responses.stats.blocked;
+        return false;
+    }
+
+    const GG_SocketAddress* peer = GG_CoapEndpoint_GetPeerAddress(metadata);
+    if (peer && GG_CoapEndpoint_CountQueuedResponses(self, peer) >= GG_MAX(1, self->responses.capacity / 2)) {
+        GG_LOG_FINE("peer has too many queued responses, dropping request");
+        ++self->responses.stats.refused;
+        return false;
+    }
+
+    return true;
+}
+
 //----------------------------------------------------------------------
 static GG_Result
 GG_CoapEndpoint_PutData(GG_DataSink* _self, GG_Buffer* buffer, const GG_BufferMetadata* metadata)
@@ -917,7 +1418,7 @@ GG_CoapEndpoint_PutData(GG_DataSink* _self, GG_Buffer* buffer, const GG_BufferMe
 
     // parse the datagram
     GG_CoapMessage* message = NULL;
-    GG_Result result = GG_CoapMessage_CreateFromDatagram(buffer, &message);
+    GG_Result result = GG_CoapMessage_CreateFromDatagramWithAllocator(&self->message_allocator, buffer, &message);
     if (GG_FAILED(result)) {
         // TODO: maybe send back an RST. Drop for now
         GG_LOG_WARNING("invalid datagram received (%d)", result);
@@ -928,13 +1429,25 @@ GG_CoapEndpoint_PutData(GG_DataSink* _self, GG_Buffer* buffer, const GG_BufferMe
     GG_CoapEndpoint_LogMessage(message, GG_LOG_LEVEL_FINER);
 #endif
 
+    // only keep socket address metadata
+    const GG_BufferMetadata* socket_metadata = NULL;
+    if (metadata && metadata->type == GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS) {
+        socket_metadata = metadata;
+    }
+
     // check if this is a request or a response
-    uint8_t message_code = GG_CoapMessage_GetCode(message);
-    if (GG_COAP_MESSAGE_CODE_CLASS(message_code) == GG_COAP_MESSAGE_CODE_CLASS_REQUEST) {
-        // this is a request
-        const GG_BufferMetadata* socket_metadata = NULL;
-        if (metadata && metadata->type == GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS) {
-            socket_metadata = metadata;
+    // (empty ACK and RST messages have a request class code, but are answers to our own messages)
+    uint8_t            message_code = GG_CoapMessage_GetCode(message);
+    GG_CoapMessageType message_type = GG_CoapMessage_GetType(message);
+    bool               empty_reply  = (message_code == 0 &&
+                                       (message_type == GG_COAP_MESSAGE_TYPE_ACK ||
+                                        message_type == GG_COAP_MESSAGE_TYPE_RST));
+    if (GG_COAP_MESSAGE_CODE_CLASS(message_code) == GG_COAP_MESSAGE_CODE_CLASS_REQUEST && !empty_reply) {
+        // this is a request, check that there's room for its response first
+        // (responses are always accepted, so that two endpoints can't block each other)
+        if (!GG_CoapEndpoint_CanAcceptRequest(self, socket_metadata)) {
+            GG_CoapMessage_Destroy(message);
+            return self->responses.input_blocked ? GG_ERROR_WOULD_BLOCK : GG_SUCCESS;
         }
         if (!GG_CoapEndpoint_OnRequest(self, message, socket_metadata)) {
             // not fully handled, prevent this message from being reclaimed now
@@ -942,7 +1455,7 @@ GG_CoapEndpoint_PutData(GG_DataSink* _self, GG_Buffer* buffer, const GG_BufferMe
         }
     } else {
         // this is a response
-        GG_CoapEndpoint_OnResponse(self, message);
+        GG_CoapEndpoint_OnResponse(self, message, socket_metadata);
     }
 
     // destroy the message
@@ -1029,6 +1542,23 @@ GG_CoapEndpoint_AsInspectable(GG_CoapEndpoint* self)
     return GG_CAST(self, GG_Inspectable);
 }
 
+//----------------------------------------------------------------------
+static void
+GG_CoapEndpoint_InspectPool(GG_Inspector* inspector, const char* name, const GG_CoapObjectPool* pool)
+{
+    GG_CoapObjectPoolStats stats;
+    GG_CoapObjectPool_GetStats(pool, &stats);
+
+    GG_Inspector_OnObjectStart(inspector, name);
+    GG_Inspector_OnInteger(inspector, "objects_in_use", stats.objects_in_use, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "objects_high_water",
+                           stats.objects_high_water,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "miss_count", stats.miss_count, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnObjectEnd(inspector);
+}
+
 //----------------------------------------------------------------------
 static GG_Result
 GG_CoapEndpoint_Inspect(GG_Inspectable* _self, GG_Inspector* inspector, const GG_InspectionOptions* options)
@@ -1109,6 +1639,60 @@ GG_CoapEndpoint_Inspect(GG_Inspectable* _self, GG_Inspector* inspector, const GG
                            "blockwise_request_handle_base",
                            self->blockwise_request_handle_base,
                            GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "exchange_cache_hits",
+                           self->exchange_cache.hits,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "exchange_cache_misses",
+                           self->exchange_cache.misses,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+
+    // inspect the round-trip time state of peers
+    GG_Inspector_OnArrayStart(inspector, "peers");
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->peer_rtts); i++) {
+        const GG_CoapPeerRtt* entry = &self->peer_rtts[i];
+        if (!entry->in_use) {
+            continue;
+        }
+
+        GG_Inspector_OnObjectStart(inspector, NULL);
+        if (entry->has_peer) {
+            char peer_str[32];
+            GG_SocketAddress_AsString(&entry->peer, peer_str, sizeof(peer_str));
+            GG_Inspector_OnString(inspector, "peer", peer_str);
+        }
+        GG_Inspector_OnInteger(inspector, "srtt", entry->strong.srtt, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+        GG_Inspector_OnInteger(inspector, "rttvar", entry->strong.rttvar, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+        GG_Inspector_OnInteger(inspector, "weak_srtt", entry->weak.srtt, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+        GG_Inspector_OnInteger(inspector, "rto", entry->rto, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+        GG_Inspector_OnObjectEnd(inspector);
+    }
+    GG_Inspector_OnArrayEnd(inspector);
+
+    // inspect the response queue
+    GG_Inspector_OnObjectStart(inspector, "response_queue");
+    GG_Inspector_OnInteger(inspector, "depth", self->responses.count, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "high_water",
+                           self->responses.stats.high_water,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "capacity", self->responses.capacity, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "dropped", self->responses.stats.dropped, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "refused", self->responses.stats.refused, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "blocked", self->responses.stats.blocked, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnBoolean(inspector, "input_blocked", self->responses.input_blocked);
+    GG_Inspector_OnObjectEnd(inspector);
+
+    // inspect the pools
+    GG_Inspector_OnObjectStart(inspector, "pools");
+    GG_CoapEndpoint_InspectPool(inspector, "messages", self->message_allocator.messages);
+    GG_CoapEndpoint_InspectPool(inspector, "requests", self->request_pool);
+    GG_CoapEndpoint_InspectPool(inspector, "responders", self->responder_pool);
+    GG_Inspector_OnInspectable(inspector,
+                               "datagrams",
+                               GG_BufferPool_AsInspectable(self->message_allocator.datagrams));
+    GG_Inspector_OnObjectEnd(inspector);
 
     return GG_SUCCESS;
 }
@@ -1119,6 +1703,43 @@ GG_IMPLEMENT_INTERFACE(GG_CoapEndpoint, GG_Inspectable) {
 };
 #endif
 
+//----------------------------------------------------------------------
+// Destroy the object pools of an endpoint.
+// (objects still in use, like responders held by handlers, remain valid)
+//----------------------------------------------------------------------
+static void
+GG_CoapEndpoint_DestroyPools(GG_CoapEndpoint* self)
+{
+    GG_CoapObjectPool_Destroy(self->message_allocator.messages);
+    GG_BufferPool_Destroy(self->message_allocator.datagrams);
+    GG_CoapObjectPool_Destroy(self->request_pool);
+    GG_CoapObjectPool_Destroy(self->responder_pool);
+}
+
+//----------------------------------------------------------------------
+// Create the object pools of an endpoint
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapEndpoint_CreatePools(GG_CoapEndpoint* self)
+{
+    GG_Result result = GG_CoapObjectPool_Create(sizeof(GG_CoapMessage),
+                                                GG_CONFIG_COAP_ENDPOINT_MESSAGE_POOL_SIZE,
+                                                &self->message_allocator.messages);
+    if (GG_FAILED(result)) return result;
+    result = GG_BufferPool_Create(GG_CONFIG_COAP_ENDPOINT_DATAGRAM_POOL_BUFFER_SIZE,
+                                  GG_CONFIG_COAP_ENDPOINT_DATAGRAM_POOL_SIZE,
+                                  &self->message_allocator.datagrams);
+    if (GG_FAILED(result)) return result;
+    result = GG_CoapObjectPool_Create(sizeof(GG_CoapRequestContext),
+                                      GG_CONFIG_COAP_ENDPOINT_REQUEST_POOL_SIZE,
+                                      &self->request_pool);
+    if (GG_FAILED(result)) return result;
+
+    return GG_CoapObjectPool_Create(sizeof(GG_CoapResponder),
+                                    GG_CONFIG_COAP_ENDPOINT_RESPONDER_POOL_SIZE,
+                                    &self->responder_pool);
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_CoapEndpoint_Create(GG_TimerScheduler* timer_scheduler,
@@ -1136,19 +1757,41 @@ GG_CoapEndpoint_Create(GG_TimerScheduler* timer_scheduler,
         return GG_ERROR_OUT_OF_MEMORY;
     }
 
+    // create the response queue and the pools
+    self->responses.capacity = GG_CONFIG_COAP_RESPONSE_QUEUE_LENGTH;
+    self->responses.entries  = GG_AllocateZeroMemory(self->responses.capacity * sizeof(GG_CoapResponseQueueEntry));
+    GG_Result result = self->responses.entries ? GG_CoapEndpoint_CreatePools(self) : GG_ERROR_OUT_OF_MEMORY;
+    if (GG_FAILED(result)) {
+        GG_FreeMemory(self->responses.entries);
+        GG_CoapEndpoint_DestroyPools(self);
+        GG_ClearAndFreeObject(self, 3);
+        *endpoint = NULL;
+        return result;
+    }
+
     // init the object
     self->connection_sink               = connection_sink;
     self->connection_source             = connection_source;
     self->timer_scheduler               = timer_scheduler;
     self->blockwise_request_handle_base = GG_COAP_INVALID_REQUEST_HANDLE + 1;
+    self->observation_handle_base       = GG_COAP_INVALID_REQUEST_HANDLE + 1;
     GG_LINKED_LIST_INIT(&self->requests);
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->requests_by_token); i++) {
+        GG_LINKED_LIST_INIT(&self->requests_by_token[i]);
+    }
     GG_LINKED_LIST_INIT(&self->blockwise_requests);
+    GG_LINKED_LIST_INIT(&self->observations);
+    GG_LINKED_LIST_INIT(&self->observables);
     GG_LINKED_LIST_INIT(&self->handlers);
     GG_LINKED_LIST_INIT(&self->request_filters);
 
     // generate a random token base
     self->token_counter = GG_GetRandomInteger();
 
+    // start with a random message ID, so that a peer doesn't mistake our requests for
+    // duplicates of requests sent before we were re-created (RFC 7252 section 4.4)
+    self->message_id_counter = (uint16_t)GG_GetRandomInteger();
+
     // setup our interfaces
     GG_SET_INTERFACE(self, GG_CoapEndpoint, GG_DataSink);
     GG_SET_INTERFACE(self, GG_CoapEndpoint, GG_DataSinkListener);
@@ -1195,6 +1838,9 @@ GG_CoapEndpoint_Destroy(GG_CoapEndpoint* self)
     // cleanup blockwise request contexts
     GG_CoapEndpoint_DestroyBlockwiseRequestContexts(self);
 
+    // cleanup observations
+    GG_CoapEndpoint_DestroyObservations(self);
+
     // cleanup pending requests
     GG_LINKED_LIST_FOREACH_SAFE(node, &self->requests) {
         GG_CoapRequestContext* context = GG_LINKED_LIST_ITEM(node, GG_CoapRequestContext, list_node);
@@ -1209,6 +1855,16 @@ GG_CoapEndpoint_Destroy(GG_CoapEndpoint* self)
         }
     }
 
+    // cleanup the handler trie
+    if (self->handler_trie.nodes) {
+        GG_FreeMemory(self->handler_trie.nodes);
+    }
+
+    // cleanup the exchange cache
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->exchange_cache.entries); i++) {
+        GG_CoapExchangeCacheEntry_Clear(&self->exchange_cache.entries[i]);
+    }
+
     // cleanup request filters
     GG_LINKED_LIST_FOREACH_SAFE(node, &self->request_filters) {
         GG_CoapRequestFilterNode* filter_node = GG_LINKED_LIST_ITEM(node, GG_CoapRequestFilterNode, list_node);
@@ -1217,6 +1873,13 @@ GG_CoapEndpoint_Destroy(GG_CoapEndpoint* self)
         }
     }
 
+    // cleanup the response queue
+    GG_CoapEndpoint_ClearResponseQueue(self);
+    GG_FreeMemory(self->responses.entries);
+
+    // cleanup the pools
+    GG_CoapEndpoint_DestroyPools(self);
+
     GG_ClearAndFreeObject(self, 3);
 }
 
@@ -1296,6 +1959,50 @@ GG_CoapEndpoint_SendPendingRequests(GG_CoapEndpoint* self)
     }
 }
 
+//----------------------------------------------------------------------
+size_t
+GG_CoapEndpoint_CreateToken(GG_CoapEndpoint* self, uint8_t* token)
+{
+    // convert the token counter into a token
+    size_t token_length = 0;
+    if (self->token_prefix_size) {
+        GG_ASSERT(self->token_prefix_size <= 4);
+        memcpy(token, self->token_prefix, self->token_prefix_size);
+        token_length += self->token_prefix_size;
+    }
+    GG_BytesFromInt32Be(&token[token_length], (uint32_t)self->token_counter++);
+    token_length += 4;
+
+    return token_length;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_SendMessage(GG_CoapEndpoint* self, const GG_CoapMessage* message, const GG_BufferMetadata* metadata)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    return GG_CoapEndpoint_SendResponse(self, message, metadata);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_SendDatagram(GG_CoapEndpoint* self, GG_Buffer* datagram, const GG_BufferMetadata* metadata)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    // first try to send any pending responses
+    GG_CoapEndpoint_SendPendingResponses(self);
+
+    // drop the datagram if there's no sink
+    if (!self->connection_sink) {
+        GG_LOG_FINE("no sink, dropping");
+        return GG_SUCCESS;
+    }
+
+    return GG_CoapEndpoint_SendResponseDatagram(self, GG_Buffer_Retain(datagram), metadata);
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_CoapEndpoint_SendRequestFromBufferSource(GG_CoapEndpoint*               self,
@@ -1310,16 +2017,9 @@ GG_CoapEndpoint_SendRequestFromBufferSource(GG_CoapEndpoint*               self,
     GG_ASSERT(self);
     GG_THREAD_GUARD_CHECK_BINDING(self);
 
-    // convert the token counter into a token
-    uint8_t token[8];
-    size_t  token_length = 0;
-    if (self->token_prefix_size) {
-        GG_ASSERT(self->token_prefix_size <= 4);
-        memcpy(token, self->token_prefix, self->token_prefix_size);
-        token_length += self->token_prefix_size;
-    }
-    GG_BytesFromInt32Be(&token[token_length], (uint32_t)self->token_counter++);
-    token_length += 4;
+    // get a new token
+    uint8_t token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    size_t  token_length = GG_CoapEndpoint_CreateToken(self, token);
 
     // create a request context
     GG_CoapRequestContext* request_context = NULL;
@@ -1335,16 +2035,17 @@ GG_CoapEndpoint_SendRequestFromBufferSource(GG_CoapEndpoint*               self,
     size_t payload_size = payload_source ? GG_BufferSource_GetDataSize(payload_source) : 0;
 
     // create a request message
-    result = GG_CoapMessage_Create((uint8_t)method,
-                                   GG_COAP_MESSAGE_TYPE_CON,
-                                   options,
-                                   options_count,
-                                   self->message_id_counter++,
-                                   token,
-                                   token_length,
-                                   NULL,
-                                   payload_size,
-                                   &request_context->message);
+    result = GG_CoapMessage_CreateWithAllocator(&self->message_allocator,
+                                                (uint8_t)method,
+                                                GG_COAP_MESSAGE_TYPE_CON,
+                                                options,
+                                                options_count,
+                                                self->message_id_counter++,
+                                                token,
+                                                token_length,
+                                                NULL,
+                                                payload_size,
+                                                &request_context->message);
     if (GG_FAILED(result)) {
         GG_CoapRequestContext_Destroy(request_context);
         return result;
@@ -1355,8 +2056,11 @@ GG_CoapEndpoint_SendRequestFromBufferSource(GG_CoapEndpoint*               self,
         GG_BufferSource_GetData(payload_source, GG_CoapMessage_UsePayload(request_context->message));
     }
 
-    // add the request to the list of pending requests
+    // add the request to the list of pending requests, and index it by token
     GG_LINKED_LIST_APPEND(&self->requests, &request_context->list_node);
+    memcpy(request_context->token, token, token_length);
+    request_context->token_length = token_length;
+    GG_LINKED_LIST_APPEND(GG_CoapEndpoint_GetTokenBucket(self, token, token_length), &request_context->token_node);
 
     // schedule the first resend timer
     GG_CoapRequestContext_ScheduleTimer(request_context);
@@ -1415,16 +2119,17 @@ GG_CoapEndpoint_CreateResponse(GG_CoapEndpoint*           self,
     size_t  token_length = GG_CoapMessage_GetToken(request, token);
 
     // create the response message
-    return GG_CoapMessage_Create(code,
-                                 GG_COAP_MESSAGE_TYPE_ACK,
-                                 options,
-                                 options_count,
-                                 GG_CoapMessage_GetMessageId(request),
-                                 token,
-                                 token_length,
-                                 payload,
-                                 payload_size,
-                                 response);
+    return GG_CoapMessage_CreateWithAllocator(&self->message_allocator,
+                                              code,
+                                              GG_COAP_MESSAGE_TYPE_ACK,
+                                              options,
+                                              options_count,
+                                              GG_CoapMessage_GetMessageId(request),
+                                              token,
+                                              token_length,
+                                              payload,
+                                              payload_size,
+                                              response);
 }
 
 //----------------------------------------------------------------------
@@ -1451,6 +2156,13 @@ GG_CoapEndpoint_RegisterRequestHandlerNode(GG_CoapEndpoint*           self,
     // add the node to the list
     GG_LINKED_LIST_APPEND(&self->handlers, &handler_node->list_node);
 
+    // update the trie
+    GG_Result result = GG_CoapEndpoint_BuildHandlerTrie(self);
+    if (GG_FAILED(result)) {
+        GG_LINKED_LIST_NODE_REMOVE(&handler_node->list_node);
+        return result;
+    }
+
     return GG_SUCCESS;
 }
 
@@ -1489,6 +2201,10 @@ GG_CoapEndpoint_RegisterRequestHandler(GG_CoapEndpoint*       self,
     handler_node->handler = handler;
 
     rc = GG_CoapEndpoint_RegisterRequestHandlerNode(self, path_ptr, flags, handler_node);
+    if (GG_FAILED(rc)) {
+        GG_FreeMemory(handler_node);
+        return rc;
+    }
 
     handler_node->auto_release = true;
 
@@ -1518,6 +2234,10 @@ GG_CoapEndpoint_UnregisterRequestHandler(GG_CoapEndpoint*       self,
             if (handler_node->auto_release) {
                 GG_FreeMemory(handler_node);
             }
+
+            // update the trie (this can't fail, since the trie doesn't grow)
+            GG_CoapEndpoint_BuildHandlerTrie(self);
+
             return GG_SUCCESS;
         }
     }
@@ -1626,3 +2346,49 @@ GG_CoapEndpoint_GetTokenPrefix(GG_CoapEndpoint* self, size_t* prefix_size)
     *prefix_size = self->token_prefix_size;
     return self->token_prefix;
 }
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_SetResponseQueueCapacity(GG_CoapEndpoint* self, size_t capacity)
+{
+    GG_ASSERT(self);
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    if (capacity == 0) {
+        return GG_ERROR_INVALID_PARAMETERS;
+    }
+    if (capacity < self->responses.count) {
+        // can't shrink below what's already queued
+        return GG_ERROR_INVALID_STATE;
+    }
+
+    // move the queued entries to a new ring, in order
+    GG_CoapResponseQueueEntry* entries = GG_AllocateZeroMemory(capacity * sizeof(GG_CoapResponseQueueEntry));
+    if (entries == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < self->responses.count; i++) {
+        entries[i] = self->responses.entries[(self->responses.cursor + i) % self->responses.capacity];
+    }
+    GG_FreeMemory(self->responses.entries);
+    self->responses.entries  = entries;
+    self->responses.capacity = capacity;
+    self->responses.cursor   = 0;
+
+    // a larger queue may have room for requests that were refused
+    GG_CoapEndpoint_UnblockInput(self);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+void
+GG_CoapEndpoint_GetResponseQueueStats(GG_CoapEndpoint* self, GG_CoapResponseQueueStats* stats)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(stats);
+
+    *stats          = self->responses.stats;
+    stats->depth    = self->responses.count;
+    stats->capacity = self->responses.capacity;
+}
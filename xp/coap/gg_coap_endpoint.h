@@ -24,7 +24,10 @@
 #include "xp/common/gg_results.h"
 #include "xp/common/gg_buffer.h"
 #include "xp/common/gg_threads.h"
+#include "xp/sockets/gg_sockets.h"
 #include "xp/coap/gg_coap.h"
+#include "xp/coap/gg_coap_message.h"
+#include "xp/coap/gg_coap_object_pool.h"
 
 #if defined(GG_COAP_ENDPOINT_PRIVATE)
 
@@ -33,14 +36,125 @@
 +---------------------------------------------------------------------*/
 #define GG_COAP_ACK_TIMEOUT_MS      5000 ///< should be 2000 according to RFC 7252, but set it higher for now
 #define GG_COAP_ACK_RANDOM_FACTOR   1.5  ///< Ack Timeout Random Factor (RFC 7252)
+#define GG_COAP_MAX_RTO_MS          32000 ///< Upper bound for RTT-based retransmission timeouts
 
+// default capacity of the response queue (see GG_CoapEndpoint_SetResponseQueueCapacity)
 #if !defined(GG_CONFIG_COAP_RESPONSE_QUEUE_LENGTH)
 #define GG_CONFIG_COAP_RESPONSE_QUEUE_LENGTH 16
 #endif
 
+// max number of recently received requests remembered for duplicate detection (at least 1)
+#if !defined(GG_CONFIG_COAP_EXCHANGE_CACHE_SIZE)
+#define GG_CONFIG_COAP_EXCHANGE_CACHE_SIZE 8
+#endif
+
+// time during which a received request is remembered for duplicate detection
+// (EXCHANGE_LIFETIME, RFC 7252 section 4.8.2)
+#if !defined(GG_CONFIG_COAP_EXCHANGE_LIFETIME_MS)
+#define GG_CONFIG_COAP_EXCHANGE_LIFETIME_MS 247000
+#endif
+
+// number of buckets in the table used to look up requests by token (must be a power of 2)
+#if !defined(GG_CONFIG_COAP_REQUEST_TABLE_SIZE)
+#define GG_CONFIG_COAP_REQUEST_TABLE_SIZE 16
+#endif
+
+#if (GG_CONFIG_COAP_REQUEST_TABLE_SIZE & (GG_CONFIG_COAP_REQUEST_TABLE_SIZE - 1)) != 0
+#error "GG_CONFIG_COAP_REQUEST_TABLE_SIZE must be a power of 2"
+#endif
+
+// number of peers for which an endpoint keeps round-trip time estimates (at least 1)
+#if !defined(GG_CONFIG_COAP_RTT_PEER_COUNT)
+#define GG_CONFIG_COAP_RTT_PEER_COUNT 4
+#endif
+
+// number of message objects pre-allocated by each endpoint (0 to always use the heap)
+#if !defined(GG_CONFIG_COAP_ENDPOINT_MESSAGE_POOL_SIZE)
+#define GG_CONFIG_COAP_ENDPOINT_MESSAGE_POOL_SIZE 8
+#endif
+
+// number of request contexts pre-allocated by each endpoint (0 to always use the heap)
+#if !defined(GG_CONFIG_COAP_ENDPOINT_REQUEST_POOL_SIZE)
+#define GG_CONFIG_COAP_ENDPOINT_REQUEST_POOL_SIZE 4
+#endif
+
+// number of responders pre-allocated by each endpoint (0 to always use the heap)
+#if !defined(GG_CONFIG_COAP_ENDPOINT_RESPONDER_POOL_SIZE)
+#define GG_CONFIG_COAP_ENDPOINT_RESPONDER_POOL_SIZE 2
+#endif
+
+// number and size of the buffers pre-allocated by each endpoint for the datagrams of the
+// messages it creates (responses are kept in the exchange cache, so there should be more
+// buffers than cache entries). Larger datagrams are allocated from the heap.
+#if !defined(GG_CONFIG_COAP_ENDPOINT_DATAGRAM_POOL_SIZE)
+#define GG_CONFIG_COAP_ENDPOINT_DATAGRAM_POOL_SIZE (GG_CONFIG_COAP_EXCHANGE_CACHE_SIZE + 8)
+#endif
+#if !defined(GG_CONFIG_COAP_ENDPOINT_DATAGRAM_POOL_BUFFER_SIZE)
+#define GG_CONFIG_COAP_ENDPOINT_DATAGRAM_POOL_BUFFER_SIZE 256
+#endif
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
+/**
+ * Node of the trie used to find the handler for a request path.
+ * Each node represents one path segment, and points into the path of one
+ * of the registered handlers.
+ */
+typedef struct GG_CoapPathTrieNode {
+    const char*                 segment;        ///< Segment chars (not null-terminated)
+    size_t                      segment_length; ///< Number of chars in the segment
+    GG_CoapRequestHandlerNode*  handler;        ///< First registered handler whose path ends here, or NULL
+    size_t                      handler_rank;   ///< Registration rank of the handler
+    struct GG_CoapPathTrieNode* first_child;    ///< First child node
+    struct GG_CoapPathTrieNode* next_sibling;   ///< Next node with the same parent
+} GG_CoapPathTrieNode;
+
+/**
+ * Entry in the cache of recently received requests.
+ * A request is identified by the address of the peer that sent it and its message ID.
+ */
+typedef struct {
+    bool             in_use;     ///< True when the entry represents a request
+    bool             has_peer;   ///< False when the transport doesn't provide peer addresses
+    GG_SocketAddress peer;       ///< Address of the peer that sent the request
+    uint16_t         message_id; ///< Message ID of the request
+    uint32_t         expiration; ///< Scheduler time after which the entry is stale
+    GG_Buffer*       response;   ///< Response datagram sent for the request, or NULL if none was sent yet
+} GG_CoapExchangeCacheEntry;
+
+/**
+ * Round-trip time estimator (RFC 6298), used for CoCoA strong and weak estimates.
+ * Times are in milliseconds.
+ */
+typedef struct {
+    uint32_t srtt;   ///< Smoothed round-trip time (0 until the first sample)
+    uint32_t rttvar; ///< Round-trip time variation
+} GG_CoapRttEstimator;
+
+/**
+ * Round-trip time state for a peer, used to compute retransmission timeouts
+ * that track the link instead of using a fixed initial timeout
+ * (CoCoA, draft-ietf-core-cocoa).
+ */
+typedef struct {
+    bool                in_use;      ///< True when the entry represents a peer
+    bool                has_peer;    ///< False for the peer at the other end of a transport without addresses
+    GG_SocketAddress    peer;        ///< Address of the peer
+    GG_CoapRttEstimator strong;      ///< Estimator for exchanges without retransmissions
+    GG_CoapRttEstimator weak;        ///< Estimator for exchanges with 1 or 2 retransmissions
+    uint32_t            rto;         ///< Overall retransmission timeout
+    uint32_t            last_update; ///< Scheduler time at which the RTO was last updated
+} GG_CoapPeerRtt;
+
+/**
+ * Entry in the response queue.
+ */
+typedef struct {
+    GG_Buffer*         datagram; ///< Response datagram
+    GG_BufferMetadata* metadata; ///< Clone of the datagram metadata, or NULL
+} GG_CoapResponseQueueEntry;
+
 /**
  * Implementation details of a GG_CoapEndpoint object
  * (only visible to files that define GG_COAP_ENDPOINT_PRIVATE)
@@ -56,27 +170,150 @@ struct GG_CoapEndpoint {
     GG_DataSource*         connection_source;
     GG_TimerScheduler*     timer_scheduler;
     GG_LinkedList          requests;
+    GG_LinkedList          requests_by_token[GG_CONFIG_COAP_REQUEST_TABLE_SIZE]; ///< requests, hashed by token
     size_t                 token_prefix_size; // optional token prefix size, up to 4 bytes
     uint8_t                token_prefix[4];   // optional token prefix bytes
     uint64_t               token_counter;     // counter used to generate unique tokens, sequentially
     uint16_t               message_id_counter;
     GG_LinkedList          handlers;
+    struct {
+        GG_CoapPathTrieNode* nodes;    ///< All the nodes, starting with the root
+        size_t               capacity; ///< Number of nodes allocated
+    }                      handler_trie; ///< trie built from the paths of the handlers
     GG_CoapRequestHandler* default_handler;
     GG_LinkedList          request_filters;
     bool                   locked; ///< Set to true to prevent mutating lists while iterating
     struct {
-        GG_Buffer*         datagrams[GG_CONFIG_COAP_RESPONSE_QUEUE_LENGTH];
-        GG_BufferMetadata* metadata[GG_CONFIG_COAP_RESPONSE_QUEUE_LENGTH];
-        size_t             cursor;
-        size_t             count;
+        GG_CoapResponseQueueEntry* entries;       ///< Ring of entries
+        size_t                     capacity;      ///< Number of entries in the ring
+        size_t                     cursor;        ///< Index of the oldest entry
+        size_t                     count;         ///< Number of entries in use
+        bool                       input_blocked; ///< True when a request was refused because the queue was full
+        GG_CoapResponseQueueStats  stats;
     }                      responses; ///< circular queue of datagrams
     bool                   try_responses_first; ///< toggle for request/response round-robin priority
+    struct {
+        GG_CoapExchangeCacheEntry entries[GG_CONFIG_COAP_EXCHANGE_CACHE_SIZE];
+        uint32_t                  hits;   ///< Number of duplicate requests detected
+        uint32_t                  misses; ///< Number of new requests
+    }                      exchange_cache; ///< recently received CON requests, for duplicate detection
 
     // support for keeping track of blockwise requests
     GG_LinkedList          blockwise_requests;
     uint64_t               blockwise_request_handle_base;
 
+    // support for observing resources and being observed
+    GG_LinkedList          observations;             ///< resources observed by this endpoint
+    uint64_t               observation_handle_base;
+    GG_LinkedList          observables;              ///< resources observed by peers
+
+    // round-trip time state for the most recently active peers
+    GG_CoapPeerRtt         peer_rtts[GG_CONFIG_COAP_RTT_PEER_COUNT];
+
+    // pools of objects recycled from one request/response exchange to the next
+    GG_CoapMessageAllocator message_allocator; ///< pools for messages and their datagrams
+    GG_CoapObjectPool*      request_pool;      ///< pool of request contexts
+    GG_CoapObjectPool*      responder_pool;    ///< pool of responders
+
     GG_THREAD_GUARD_ENABLE_BINDING
 };
 
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Create a new token, unique for this endpoint, to identify a request.
+ *
+ * @param self The object on which this method is invoked.
+ * @param token Buffer in which the token is written (at least GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH bytes).
+ *
+ * @return The size of the token.
+ */
+size_t GG_CoapEndpoint_CreateToken(GG_CoapEndpoint* self, uint8_t* token);
+
+/**
+ * Send a message that isn't tracked by the endpoint, like a NON request or a response that
+ * isn't returned by a request handler.
+ * The message is queued if it can't be sent right away.
+ *
+ * @param self The object on which this method is invoked.
+ * @param message The message to send.
+ * @param metadata Metadata for the datagram (NULL or a destination socket address).
+ *
+ * @return GG_SUCCESS if the message was sent or queued, or a negative error code.
+ */
+GG_Result GG_CoapEndpoint_SendMessage(GG_CoapEndpoint*         self,
+                                      const GG_CoapMessage*    message,
+                                      const GG_BufferMetadata* metadata);
+
+/**
+ * Send a datagram that has already been serialized, like a notification sent to observers.
+ * The datagram is queued if it can't be sent right away.
+ *
+ * @param self The object on which this method is invoked.
+ * @param datagram The datagram to send (the caller keeps its reference).
+ * @param metadata Metadata for the datagram (NULL or a destination socket address).
+ *
+ * @return GG_SUCCESS if the datagram was sent or queued, or a negative error code.
+ */
+GG_Result GG_CoapEndpoint_SendDatagram(GG_CoapEndpoint*         self,
+                                       GG_Buffer*               datagram,
+                                       const GG_BufferMetadata* metadata);
+
+/**
+ * Get the peer address from request or response metadata, if any.
+ *
+ * @param metadata The metadata (may be NULL).
+ *
+ * @return The peer address, or NULL if the metadata doesn't have one.
+ */
+const GG_SocketAddress* GG_CoapEndpoint_GetPeerAddress(const GG_BufferMetadata* metadata);
+
+/**
+ * Pick the initial timeout after which a CON message sent to a peer is retransmitted.
+ * The timeout is picked randomly between the RTO of the peer and 1.5 times that value.
+ * For peers without round-trip time samples, the RTO is GG_COAP_ACK_TIMEOUT_MS.
+ *
+ * @param self The object on which this method is invoked.
+ * @param peer Address of the peer, or NULL for the peer at the other end of the transport.
+ * @param rto Pointer to where the RTO estimated for the peer is returned (0 if there isn't one).
+ *
+ * @return The timeout, in milliseconds.
+ */
+uint32_t GG_CoapEndpoint_GetResendTimeout(GG_CoapEndpoint* self, const GG_SocketAddress* peer, uint32_t* rto);
+
+/**
+ * Compute the timeout for the next retransmission of a CON message.
+ * Without an RTO estimate, the timeout is doubled (RFC 7252). With one, the timeout
+ * is multiplied by a variable backoff factor: 3 for an RTO below 1s, 1.5 for an RTO
+ * above 3s, and 2 otherwise.
+ *
+ * @param timeout The current timeout, in milliseconds.
+ * @param rto The RTO returned by GG_CoapEndpoint_GetResendTimeout for the message.
+ *
+ * @return The new timeout, in milliseconds.
+ */
+uint32_t GG_CoapEndpoint_BackOffResendTimeout(uint32_t timeout, uint32_t rto);
+
+/**
+ * Update the round-trip time state of a peer when a CON message it was sent is acknowledged.
+ *
+ * @param self The object on which this method is invoked.
+ * @param peer Address of the peer, or NULL for the peer at the other end of the transport.
+ * @param rtt Time elapsed since the first transmission of the message, in milliseconds.
+ * @param retransmission_count Number of times the message was retransmitted.
+ */
+void GG_CoapEndpoint_OnRttSample(GG_CoapEndpoint*        self,
+                                 const GG_SocketAddress* peer,
+                                 uint32_t                rtt,
+                                 size_t                  retransmission_count);
+
+#if defined(__cplusplus)
+}
+#endif
+
 #endif
@@ -50,7 +50,29 @@ GG_CoapMessage_Destroy(GG_CoapMessage* self)
     if (self->buffer) {
         GG_Buffer_Release(self->buffer);
     }
-    GG_ClearAndFreeObject(self, 0);
+    if (self->pool) {
+        GG_CoapObjectPool_Free(self->pool, self);
+    } else {
+        GG_ClearAndFreeObject(self, 0);
+    }
+}
+
+//----------------------------------------------------------------------
+// Allocate a zero-initialized message object, from a pool if there is one
+//----------------------------------------------------------------------
+static GG_CoapMessage*
+GG_CoapMessage_Allocate(const GG_CoapMessageAllocator* allocator)
+{
+    if (allocator == NULL || allocator->messages == NULL) {
+        return (GG_CoapMessage*)GG_AllocateZeroMemory(sizeof(GG_CoapMessage));
+    }
+
+    GG_CoapMessage* self = (GG_CoapMessage*)GG_CoapObjectPool_Allocate(allocator->messages);
+    if (self) {
+        self->pool = allocator->messages;
+    }
+
+    return self;
 }
 
 #if defined(GG_CONFIG_ENABLE_INSPECTION)
@@ -179,6 +201,102 @@ GG_IMPLEMENT_INTERFACE(GG_CoapMessage, GG_Inspectable) {
 };
 #endif
 
+//----------------------------------------------------------------------
+// Check the format of the options of a message, and index them.
+// Messages with options that don't fit in the index are still valid, their
+// options are then found by parsing the message each time they are needed.
+// `options_end` is set to the offset of the first byte after the options.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapMessage_ParseOptions(GG_CoapMessage* self, size_t data_size, size_t* options_end)
+{
+    size_t         offset        = 4 + (self->data[0] & 0xF);
+    const uint8_t* data          = self->data + offset;
+    uint32_t       option_number = 0;
+
+    self->option_count          = 0;
+    self->option_index_overflow = false;
+    data_size -= offset;
+    while (data_size && data[0] != 0xFF) {
+        unsigned int option_delta  = (data[0] >> 4) & 0xF;
+        unsigned int option_length = (data[0]     ) & 0xF;
+
+        if (option_delta == 15 || option_length == 15) {
+            GG_LOG_WARNING("invalid delta");
+            return GG_ERROR_INVALID_FORMAT;
+        }
+        ++data;
+        --data_size;
+
+        // extended delta
+        if (option_delta == 13) {
+            if (data_size < 1) {
+                GG_LOG_WARNING("not enough data");
+                return GG_ERROR_INVALID_FORMAT;
+            }
+            option_delta = 13 + data[0];
+            ++data;
+            --data_size;
+        } else if (option_delta == 14) {
+            if (data_size < 2) {
+                GG_LOG_WARNING("not enough data");
+                return GG_ERROR_INVALID_FORMAT;
+            }
+            option_delta = 269 + ((data[0] << 8) | data[1]);
+            data      += 2;
+            data_size -= 2;
+        }
+
+        // extended length
+        if (option_length == 13) {
+            if (data_size < 1) {
+                GG_LOG_WARNING("not enough data");
+                return GG_ERROR_INVALID_FORMAT;
+            }
+            option_length = 13 + data[0];
+            ++data;
+            --data_size;
+        } else if (option_length == 14) {
+            if (data_size < 2) {
+                GG_LOG_WARNING("not enough data");
+                return GG_ERROR_INVALID_FORMAT;
+            }
+            option_length = 269 + ((data[0] << 8) | data[1]);
+            data      += 2;
+            data_size -= 2;
+        }
+
+        // check that we have enough for the option value
+        if (data_size < option_length) {
+            GG_LOG_WARNING("not enough data");
+            return GG_ERROR_INVALID_FORMAT;
+        }
+
+        // index the option
+        option_number += option_delta;
+        size_t value_offset = (size_t)(data - self->data);
+        if (self->option_count < GG_CONFIG_COAP_MESSAGE_MAX_INDEXED_OPTIONS &&
+            option_number <= 0xFFFF &&
+            value_offset <= 0xFFFF &&
+            option_length <= 0xFFFF) {
+            GG_CoapMessageOptionIndexEntry* entry = &self->options[self->option_count++];
+            entry->number = (uint16_t)option_number;
+            entry->offset = (uint16_t)value_offset;
+            entry->length = (uint16_t)option_length;
+        } else {
+            self->option_index_overflow = true;
+        }
+
+        // move to the next option
+        data      += option_length;
+        data_size -= option_length;
+    }
+
+    *options_end = (size_t)(data - self->data);
+
+    return GG_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
     0                   1                   2                   3
     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -194,6 +312,15 @@ GG_IMPLEMENT_INTERFACE(GG_CoapMessage, GG_Inspectable) {
 */
 GG_Result
 GG_CoapMessage_CreateFromDatagram(GG_Buffer* datagram, GG_CoapMessage** coap_message)
+{
+    return GG_CoapMessage_CreateFromDatagramWithAllocator(NULL, datagram, coap_message);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapMessage_CreateFromDatagramWithAllocator(const GG_CoapMessageAllocator* allocator,
+                                               GG_Buffer*                     datagram,
+                                               GG_CoapMessage**               coap_message)
 {
     GG_ASSERT(datagram != NULL);
     GG_ASSERT(coap_message != NULL);
@@ -218,7 +345,7 @@ GG_CoapMessage_CreateFromDatagram(GG_Buffer* datagram, GG_CoapMessage** coap_mes
 
     // obtain a new message
     GG_Result result = GG_SUCCESS;
-    GG_CoapMessage* message = (GG_CoapMessage*)GG_AllocateZeroMemory(sizeof(GG_CoapMessage));
+    GG_CoapMessage* message = GG_CoapMessage_Allocate(allocator);
     if (message == NULL) {
         return GG_ERROR_OUT_OF_MEMORY;
     }
@@ -236,72 +363,14 @@ GG_CoapMessage_CreateFromDatagram(GG_Buffer* datagram, GG_CoapMessage** coap_mes
         goto end;
     }
 
-    // parse the options
-    data      += 4 + token_length;
-    data_size -= 4 + token_length;
-    while (data_size && data[0] != 0xFF) {
-        unsigned int option_delta  = (data[0] >> 4) & 0xF;
-        unsigned int option_length = (data[0]     ) & 0xF;
-
-        if (option_delta == 15 || option_length == 15) {
-            GG_LOG_WARNING("invalid delta");
-            result = GG_ERROR_INVALID_FORMAT;
-            goto end;
-        }
-        ++data;
-        --data_size;
-
-        // extended delta
-        if (option_delta == 13) {
-            if (data_size < 1) {
-                GG_LOG_WARNING("not enough data");
-                result = GG_ERROR_INVALID_FORMAT;
-                goto end;
-            }
-            ++data;
-            --data_size;
-        } else if (option_delta == 14) {
-            if (data_size < 2) {
-                GG_LOG_WARNING("not enough data");
-                result = GG_ERROR_INVALID_FORMAT;
-                goto end;
-            }
-            data      += 2;
-            data_size -= 2;
-        }
-
-        // extended length
-        if (option_length == 13) {
-            if (data_size < 1) {
-                GG_LOG_WARNING("not enough data");
-                result = GG_ERROR_INVALID_FORMAT;
-                goto end;
-            }
-            option_length = 13 + data[0];
-            ++data;
-            --data_size;
-        } else if (option_length == 14) {
-            if (data_size < 2) {
-                GG_LOG_WARNING("not enough data");
-                result = GG_ERROR_INVALID_FORMAT;
-                goto end;
-            }
-            option_length = 269 + ((data[0] << 8) | data[1]);
-            data      += 2;
-            data_size -= 2;
-        }
-
-        // check that we have enough for the option value
-        if (data_size < option_length) {
-            GG_LOG_WARNING("not enough data");
-            result = GG_ERROR_INVALID_FORMAT;
-            goto end;
-        }
-
-        // move to the next option
-        data      += option_length;
-        data_size -= option_length;
+    // parse and index the options
+    size_t options_end = 0;
+    result = GG_CoapMessage_ParseOptions(message, data_size, &options_end);
+    if (GG_FAILED(result)) {
+        goto end;
     }
+    data      += options_end;
+    data_size -= options_end;
 
     // if we have a payload, it must be prefixed with a 0xFF marker
     if (data_size) {
@@ -555,6 +624,33 @@ GG_CoapMessage_Create(uint8_t                    code,
                       const uint8_t*             payload,
                       size_t                     payload_size,
                       GG_CoapMessage**           message)
+{
+    return GG_CoapMessage_CreateWithAllocator(NULL,
+                                              code,
+                                              type,
+                                              options,
+                                              options_count,
+                                              message_id,
+                                              token,
+                                              token_length,
+                                              payload,
+                                              payload_size,
+                                              message);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapMessage_CreateWithAllocator(const GG_CoapMessageAllocator* allocator,
+                                   uint8_t                        code,
+                                   GG_CoapMessageType             type,
+                                   GG_CoapMessageOptionParam*     options,
+                                   size_t                         options_count,
+                                   uint16_t                       message_id,
+                                   const uint8_t*                 token,
+                                   size_t                         token_length,
+                                   const uint8_t*                 payload,
+                                   size_t                         payload_size,
+                                   GG_CoapMessage**               message)
 {
     GG_ASSERT(message);
 
@@ -594,7 +690,12 @@ GG_CoapMessage_Create(uint8_t                    code,
 
     // create the buffer
     GG_DynamicBuffer* buffer = NULL;
-    GG_Result result = GG_DynamicBuffer_Create(buffer_size, &buffer);
+    GG_Result result;
+    if (allocator && allocator->datagrams) {
+        result = GG_BufferPool_AllocateBuffer(allocator->datagrams, buffer_size, &buffer);
+    } else {
+        result = GG_DynamicBuffer_Create(buffer_size, &buffer);
+    }
     if (GG_FAILED(result)) {
         return result;
     }
@@ -628,7 +729,7 @@ GG_CoapMessage_Create(uint8_t                    code,
     }
 
     // allocate the message object
-    GG_CoapMessage* self = (GG_CoapMessage*)GG_AllocateZeroMemory(sizeof(GG_CoapMessage));
+    GG_CoapMessage* self = GG_CoapMessage_Allocate(allocator);
     if (self == NULL) {
         GG_DynamicBuffer_Release(buffer);
         return GG_ERROR_OUT_OF_MEMORY;
@@ -640,6 +741,10 @@ GG_CoapMessage_Create(uint8_t                    code,
     self->payload_offset = offset;
     self->payload_size   = payload_size;
 
+    // index the options (they were just serialized, so they can't be invalid)
+    size_t options_end = 0;
+    GG_CoapMessage_ParseOptions(self, buffer_size, &options_end);
+
     // setup interfaces
     GG_IF_INSPECTION_ENABLED(GG_SET_INTERFACE(self, GG_CoapMessage, GG_Inspectable));
 
@@ -748,6 +853,64 @@ GG_CoapMessage_UsePayload(const GG_CoapMessage* self)
             NULL;
 }
 
+//----------------------------------------------------------------------
+// Decode an option value, according to the type of the option
+//----------------------------------------------------------------------
+static void
+GG_CoapMessage_DecodeOption(uint32_t              option_number,
+                            const uint8_t*        data,
+                            size_t                option_length,
+                            GG_CoapMessageOption* option)
+{
+    option->number = option_number;
+    switch (option_number) {
+        case GG_COAP_MESSAGE_OPTION_IF_NONE_MATCH:
+            // type EMPTY
+            option->type = GG_COAP_MESSAGE_OPTION_TYPE_EMPTY;
+            break;
+
+        case GG_COAP_MESSAGE_OPTION_OBSERVE:
+        case GG_COAP_MESSAGE_OPTION_URI_PORT:
+        case GG_COAP_MESSAGE_OPTION_CONTENT_FORMAT:
+        case GG_COAP_MESSAGE_OPTION_MAX_AGE:
+        case GG_COAP_MESSAGE_OPTION_ACCEPT:
+        case GG_COAP_MESSAGE_OPTION_SIZE1:
+        case GG_COAP_MESSAGE_OPTION_SIZE2:
+        case GG_COAP_MESSAGE_OPTION_BLOCK1:
+        case GG_COAP_MESSAGE_OPTION_BLOCK2:
+        case GG_COAP_MESSAGE_OPTION_QBLOCK1:
+        case GG_COAP_MESSAGE_OPTION_QBLOCK2:
+        case GG_COAP_MESSAGE_OPTION_START_OFFSET:
+            // type UINT
+            option->type = GG_COAP_MESSAGE_OPTION_TYPE_UINT;
+            option->value.uint = 0;
+            for (unsigned int i = 0; i < option_length; i++) {
+                option->value.uint = (option->value.uint << 8) | data[i];
+            }
+            break;
+
+        case GG_COAP_MESSAGE_OPTION_URI_HOST:
+        case GG_COAP_MESSAGE_OPTION_LOCATION_PATH:
+        case GG_COAP_MESSAGE_OPTION_URI_PATH:
+        case GG_COAP_MESSAGE_OPTION_URI_QUERY:
+        case GG_COAP_MESSAGE_OPTION_LOCATION_QUERY:
+        case GG_COAP_MESSAGE_OPTION_PROXY_URI:
+        case GG_COAP_MESSAGE_OPTION_PROXY_SCHEME:
+            // type STRING
+            option->type = GG_COAP_MESSAGE_OPTION_TYPE_STRING;
+            option->value.string.chars  = (const char*)data;
+            option->value.string.length = option_length;
+            break;
+
+        default:
+            // use type OPAQUE for all other options
+            option->type = GG_COAP_MESSAGE_OPTION_TYPE_OPAQUE;
+            option->value.opaque.bytes = data;
+            option->value.opaque.size  = option_length;
+            break;
+    }
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_CoapMessage_GetOption(const GG_CoapMessage* self,
@@ -755,6 +918,32 @@ GG_CoapMessage_GetOption(const GG_CoapMessage* self,
                          GG_CoapMessageOption* option,
                          unsigned int          index)
 {
+    GG_ASSERT(self);
+    GG_ASSERT(option);
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    // look in the index if all the options are in it
+    // (entries are sorted by option number, like the options in the message)
+    if (!self->option_index_overflow) {
+        for (unsigned int i = 0; i < self->option_count; i++) {
+            const GG_CoapMessageOptionIndexEntry* entry = &self->options[i];
+            if (entry->number < option_number) {
+                continue;
+            }
+            if (entry->number > option_number) {
+                break;
+            }
+            if (index-- == 0) {
+                // found
+                GG_CoapMessage_DecodeOption(entry->number, self->data + entry->offset, entry->length, option);
+                return GG_SUCCESS;
+            }
+        }
+
+        return GG_ERROR_NO_SUCH_ITEM;
+    }
+
+    // parse the options
     GG_CoapMessageOptionIterator iterator;
     GG_CoapMessage_InitOptionIterator(self, option_number, &iterator);
 
@@ -788,6 +977,7 @@ GG_CoapMessage_InitOptionIterator(const GG_CoapMessage*         self,
 
     iterator->option.number = 0;
     iterator->filter = filter;
+    iterator->index  = 0;
     size_t token_length = self->data[0] & 0xF;
     iterator->location = &self->data[4+token_length];
     iterator->end      = &self->data[self->payload_offset];
@@ -846,49 +1036,7 @@ GG_CoapMessage_StepOptionIterator_(const GG_CoapMessage* self, GG_CoapMessageOpt
 
     // setup the option type if we know it, unless we're skipping this option because of the filter
     if (iterator->filter == 0 || iterator->filter == iterator->option.number) {
-        switch (iterator->option.number) {
-            case GG_COAP_MESSAGE_OPTION_IF_NONE_MATCH:
-                // type EMPTY
-                iterator->option.type = GG_COAP_MESSAGE_OPTION_TYPE_EMPTY;
-                break;
-
-            case GG_COAP_MESSAGE_OPTION_URI_PORT:
-            case GG_COAP_MESSAGE_OPTION_CONTENT_FORMAT:
-            case GG_COAP_MESSAGE_OPTION_MAX_AGE:
-            case GG_COAP_MESSAGE_OPTION_ACCEPT:
-            case GG_COAP_MESSAGE_OPTION_SIZE1:
-            case GG_COAP_MESSAGE_OPTION_SIZE2:
-            case GG_COAP_MESSAGE_OPTION_BLOCK1:
-            case GG_COAP_MESSAGE_OPTION_BLOCK2:
-            case GG_COAP_MESSAGE_OPTION_START_OFFSET:
-                // type UINT
-                iterator->option.type = GG_COAP_MESSAGE_OPTION_TYPE_UINT;
-                iterator->option.value.uint = 0;
-                for (unsigned int i = 0; i < option_length; i++) {
-                    iterator->option.value.uint  = (iterator->option.value.uint  << 8) | data[i];
-                }
-                break;
-
-            case GG_COAP_MESSAGE_OPTION_URI_HOST:
-            case GG_COAP_MESSAGE_OPTION_LOCATION_PATH:
-            case GG_COAP_MESSAGE_OPTION_URI_PATH:
-            case GG_COAP_MESSAGE_OPTION_URI_QUERY:
-            case GG_COAP_MESSAGE_OPTION_LOCATION_QUERY:
-            case GG_COAP_MESSAGE_OPTION_PROXY_URI:
-            case GG_COAP_MESSAGE_OPTION_PROXY_SCHEME:
-                // type STRING
-                iterator->option.type = GG_COAP_MESSAGE_OPTION_TYPE_STRING;
-                iterator->option.value.string.chars  = (const char*)data;
-                iterator->option.value.string.length = option_length;
-                break;
-
-            default:
-                // use type OPAQUE for all other options
-                iterator->option.type = GG_COAP_MESSAGE_OPTION_TYPE_OPAQUE;
-                iterator->option.value.opaque.bytes = data;
-                iterator->option.value.opaque.size  = option_length;
-                break;
-        }
+        GG_CoapMessage_DecodeOption(iterator->option.number, data, option_length, &iterator->option);
     }
 
     // update the location
@@ -903,7 +1051,26 @@ GG_CoapMessage_StepOptionIterator(const GG_CoapMessage* self, GG_CoapMessageOpti
     GG_ASSERT(iterator);
     GG_THREAD_GUARD_CHECK_BINDING(self);
 
-    if (iterator->filter == 0) {
+    if (!self->option_index_overflow) {
+        // step through the index until we find an option that passes the filter, or reach the end
+        while (iterator->index < self->option_count) {
+            const GG_CoapMessageOptionIndexEntry* entry = &self->options[iterator->index++];
+            if (iterator->filter == 0 || iterator->filter == entry->number) {
+                GG_CoapMessage_DecodeOption(entry->number,
+                                            self->data + entry->offset,
+                                            entry->length,
+                                            &iterator->option);
+                return;
+            }
+            if (iterator->filter < entry->number) {
+                // the entries are sorted, there won't be any match after this one
+                break;
+            }
+        }
+        iterator->index         = self->option_count;
+        iterator->option.number = GG_COAP_MESSAGE_OPTION_NONE;
+        iterator->option.type   = GG_COAP_MESSAGE_OPTION_TYPE_EMPTY;
+    } else if (iterator->filter == 0) {
         // no filter, just go to the next option
         GG_CoapMessage_StepOptionIterator_(self, iterator);
     } else {
@@ -21,14 +21,44 @@
 |   types
 +---------------------------------------------------------------------*/
 #include "xp/common/gg_threads.h"
+#include "xp/common/gg_buffer.h"
 #include "xp/coap/gg_coap.h"
+#include "xp/coap/gg_coap_object_pool.h"
 
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
 
+/**
+ * Pools from which messages and the datagrams of the messages they create are allocated.
+ * Either pool may be NULL, in which case the heap is used.
+ */
+typedef struct {
+    GG_CoapObjectPool* messages;  ///< Pool of message objects (of size sizeof(GG_CoapMessage))
+    GG_BufferPool*     datagrams; ///< Pool of buffers for the datagrams of created messages
+} GG_CoapMessageAllocator;
+
 #if defined(GG_COAP_MESSAGE_PRIVATE)
 
+// max number of options indexed when a message is created (the options of messages
+// with more options than that are found by parsing the message each time)
+#if !defined(GG_CONFIG_COAP_MESSAGE_MAX_INDEXED_OPTIONS)
+#define GG_CONFIG_COAP_MESSAGE_MAX_INDEXED_OPTIONS 16
+#endif
+
+#if GG_CONFIG_COAP_MESSAGE_MAX_INDEXED_OPTIONS > 255
+#error "GG_CONFIG_COAP_MESSAGE_MAX_INDEXED_OPTIONS must be at most 255"
+#endif
+
+/**
+ * Entry in the option index of a message
+ */
+typedef struct {
+    uint16_t number; ///< Option number
+    uint16_t offset; ///< Offset of the option value from the start of the message data
+    uint16_t length; ///< Length of the option value
+} GG_CoapMessageOptionIndexEntry;
+
 /**
  * Internal representation of a CoAP message
  * (not visible to the public API)
@@ -36,12 +66,52 @@
 struct GG_CoapMessage {
     GG_IF_INSPECTION_ENABLED(GG_IMPLEMENTS(GG_Inspectable);)
 
-    GG_Buffer*     buffer;         ///< Buffer that contains the encoded message
-    const uint8_t* data;           ///< Pointer to the buffer data (convenience shortcut)
-    size_t         payload_offset; ///< Offset of the payload portion of the data
-    size_t         payload_size;   ///< Size of the payload portion of the data
+    GG_CoapObjectPool* pool;                  ///< Pool to which the object must be returned, or NULL
+    GG_Buffer*         buffer;                ///< Buffer that contains the encoded message
+    const uint8_t*     data;                  ///< Pointer to the buffer data (convenience shortcut)
+    size_t             payload_offset;        ///< Offset of the payload portion of the data
+    size_t             payload_size;          ///< Size of the payload portion of the data
+    uint8_t            option_count;          ///< Number of entries in the option index
+    bool               option_index_overflow; ///< True if some options aren't in the index
+
+    /// Index of the options, in the order in which they appear in the message
+    GG_CoapMessageOptionIndexEntry options[GG_CONFIG_COAP_MESSAGE_MAX_INDEXED_OPTIONS];
 
     GG_THREAD_GUARD_ENABLE_BINDING
 };
 
 #endif
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+/**
+ * Same as GG_CoapMessage_Create, but with the message object and its datagram
+ * allocated from pools.
+ *
+ * @param allocator Pools to allocate from (NULL to use the heap).
+ *
+ * @see GG_CoapMessage_Create for the other parameters.
+ */
+GG_Result GG_CoapMessage_CreateWithAllocator(const GG_CoapMessageAllocator* allocator,
+                                             uint8_t                        code,
+                                             GG_CoapMessageType             type,
+                                             GG_CoapMessageOptionParam*     options,
+                                             size_t                         options_count,
+                                             uint16_t                       message_id,
+                                             const uint8_t*                 token,
+                                             size_t                         token_length,
+                                             const uint8_t*                 payload,
+                                             size_t                         payload_size,
+                                             GG_CoapMessage**               message);
+
+/**
+ * Same as GG_CoapMessage_CreateFromDatagram, but with the message object allocated from a pool.
+ *
+ * @param allocator Pools to allocate from (NULL to use the heap).
+ *
+ * @see GG_CoapMessage_CreateFromDatagram for the other parameters.
+ */
+GG_Result GG_CoapMessage_CreateFromDatagramWithAllocator(const GG_CoapMessageAllocator* allocator,
+                                                         GG_Buffer*                     datagram,
+                                                         GG_CoapMessage**               message);
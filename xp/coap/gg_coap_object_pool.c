@@ -0,0 +1,169 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ *
+ * CoAP library - object pools
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <string.h>
+
+#include "gg_coap_object_pool.h"
+#include "xp/common/gg_memory.h"
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_types.h"
+#include "xp/common/gg_utils.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define GG_COAP_OBJECT_POOL_ALIGNMENT 8
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+struct GG_CoapObjectPool {
+    size_t                 object_size;  // size of each object, rounded up to the alignment
+    size_t                 object_count; // number of objects in the slab
+    size_t                 free_count;   // number of objects in the free list
+    size_t                 outstanding;  // number of objects not returned yet, including heap objects
+    bool                   destroyed;    // true when the pool has been destroyed but objects are still in use
+    GG_CoapObjectPoolStats stats;
+    void*                  free_list;    // free objects, each one starting with a pointer to the next
+    uint8_t*               slab;         // memory for all the objects
+};
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+
+//----------------------------------------------------------------------
+static void
+GG_CoapObjectPool_FreePool(GG_CoapObjectPool* self)
+{
+    GG_FreeMemory(self->slab);
+    GG_ClearAndFreeObject(self, 0);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapObjectPool_Create(size_t object_size, size_t object_count, GG_CoapObjectPool** pool)
+{
+    GG_ASSERT(pool);
+    *pool = NULL;
+
+    // allocate the object and its memory
+    GG_CoapObjectPool* self = (GG_CoapObjectPool*)GG_AllocateZeroMemory(sizeof(GG_CoapObjectPool));
+    if (self == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+    object_size = GG_MAX(object_size, sizeof(void*));
+    self->object_size  = (object_size + GG_COAP_OBJECT_POOL_ALIGNMENT - 1) &
+                         ~(size_t)(GG_COAP_OBJECT_POOL_ALIGNMENT - 1);
+    self->object_count = object_count;
+    if (object_count) {
+        self->slab = (uint8_t*)GG_AllocateMemory(object_count * self->object_size);
+        if (self->slab == NULL) {
+            GG_CoapObjectPool_FreePool(self);
+            return GG_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    // link all the objects in the free list
+    for (size_t i = object_count; i > 0; i--) {
+        void** object = (void**)(void*)(self->slab + (i - 1) * self->object_size);
+        *object = self->free_list;
+        self->free_list = object;
+    }
+    self->free_count = object_count;
+
+    *pool = self;
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+void
+GG_CoapObjectPool_Destroy(GG_CoapObjectPool* self)
+{
+    if (self == NULL) return;
+
+    // if some objects are still in use, the last one to be returned will free the pool
+    if (self->outstanding) {
+        self->destroyed = true;
+    } else {
+        GG_CoapObjectPool_FreePool(self);
+    }
+}
+
+//----------------------------------------------------------------------
+void*
+GG_CoapObjectPool_Allocate(GG_CoapObjectPool* self)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(!self->destroyed);
+
+    // fall back to the heap if the pool is empty
+    void* object = self->free_list;
+    if (object == NULL) {
+        ++self->stats.miss_count;
+        object = GG_AllocateZeroMemory(self->object_size);
+        if (object == NULL) {
+            return NULL;
+        }
+    } else {
+        self->free_list = *(void**)object;
+        --self->free_count;
+        size_t in_use = self->object_count - self->free_count;
+        self->stats.objects_high_water = GG_MAX(self->stats.objects_high_water, in_use);
+        memset(object, 0, self->object_size);
+    }
+    ++self->outstanding;
+
+    return object;
+}
+
+//----------------------------------------------------------------------
+void
+GG_CoapObjectPool_Free(GG_CoapObjectPool* self, void* object)
+{
+    if (object == NULL) return;
+    if (self == NULL) {
+        GG_FreeMemory(object);
+        return;
+    }
+
+    // return the object to the free list if it belongs to the slab, or to the heap if it doesn't
+    GG_ASSERT(self->outstanding);
+    uint8_t* address = (uint8_t*)object;
+    if (self->slab && address >= self->slab && address < self->slab + self->object_count * self->object_size) {
+        *(void**)object = self->free_list;
+        self->free_list = object;
+        ++self->free_count;
+    } else {
+        GG_FreeMemory(object);
+    }
+
+    // free the pool if it has been destroyed and this was the last object in use
+    if (--self->outstanding == 0 && self->destroyed) {
+        GG_CoapObjectPool_FreePool(self);
+    }
+}
+
+//----------------------------------------------------------------------
+void
+GG_CoapObjectPool_GetStats(const GG_CoapObjectPool* self, GG_CoapObjectPoolStats* stats)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(stats);
+
+    *stats = self->stats;
+    stats->objects_in_use = self->object_count - self->free_count;
+}
@@ -0,0 +1,101 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ *
+ * CoAP library - object pools (internal header)
+ */
+
+#pragma once
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include "xp/common/gg_results.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * Pool of pre-allocated, fixed-size objects, used by an endpoint to recycle the
+ * objects that it creates and destroys for each request/response exchange.
+ * The objects are allocated in a single block when the pool is created. When the
+ * pool is empty, objects are allocated from the heap instead (this is counted as
+ * a miss), and freed when they are returned.
+ * Pools aren't thread-safe: objects must be allocated and returned on the thread
+ * to which the endpoint is bound.
+ */
+typedef struct GG_CoapObjectPool GG_CoapObjectPool;
+
+/**
+ * Statistics for a GG_CoapObjectPool object.
+ */
+typedef struct {
+    size_t objects_in_use;     ///< Number of pool objects currently in use
+    size_t objects_high_water; ///< Max number of pool objects that were in use at the same time
+    size_t miss_count;         ///< Number of times an object had to be allocated from the heap
+} GG_CoapObjectPoolStats;
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+/**
+ * Create a pool.
+ *
+ * @param object_size Size of each object.
+ * @param object_count Number of objects in the pool (may be 0).
+ * @param pool Pointer to where the new object will be returned.
+ *
+ * @return GG_SUCCESS if the pool could be created, or a negative error code.
+ */
+GG_Result GG_CoapObjectPool_Create(size_t object_size, size_t object_count, GG_CoapObjectPool** pool);
+
+/**
+ * Destroy a pool.
+ * Objects obtained from the pool that are still in use remain valid, the memory
+ * for the pool is freed when the last one is returned.
+ *
+ * @param self The object on which this method is invoked.
+ */
+void GG_CoapObjectPool_Destroy(GG_CoapObjectPool* self);
+
+/**
+ * Get a zero-initialized object from a pool.
+ *
+ * @param self The object on which this method is invoked.
+ *
+ * @return The object, or NULL if it couldn't be allocated.
+ */
+void* GG_CoapObjectPool_Allocate(GG_CoapObjectPool* self);
+
+/**
+ * Return an object to the pool from which it was obtained.
+ *
+ * @param self The pool from which the object was obtained (or NULL for an object
+ * that was allocated with GG_AllocateMemory or GG_AllocateZeroMemory).
+ * @param object The object to return (may be NULL).
+ */
+void GG_CoapObjectPool_Free(GG_CoapObjectPool* self, void* object);
+
+/**
+ * Get the statistics of a pool.
+ *
+ * @param self The object on which this method is invoked.
+ * @param stats Pointer to the structure in which the statistics will be returned.
+ */
+void GG_CoapObjectPool_GetStats(const GG_CoapObjectPool* self, GG_CoapObjectPoolStats* stats);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,796 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ *
+ * CoAP library - Observing Resources (RFC 7641)
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <string.h>
+
+#define GG_COAP_ENDPOINT_PRIVATE
+
+#include "gg_coap.h"
+#include "gg_coap_endpoint.h"
+#include "gg_coap_observe.h"
+#include "xp/common/gg_logging.h"
+#include "xp/common/gg_memory.h"
+#include "xp/common/gg_utils.h"
+#include "xp/common/gg_threads.h"
+#include "xp/common/gg_timer.h"
+#include "xp/common/gg_port.h"
+#include "xp/sockets/gg_sockets.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+GG_SET_LOCAL_LOGGER("gg.xp.coap.observe")
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * Entry in the list of observers of an observable resource.
+ */
+typedef struct {
+    bool                     in_use;         ///< True when the entry represents an observer
+    bool                     has_peer;       ///< False when the transport doesn't provide peer addresses
+    GG_SocketAddressMetadata destination;    ///< Where to send notifications (only valid if has_peer is true)
+    uint8_t                  token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH]; ///< Token of the registration request
+    size_t                   token_length;   ///< Size of the token
+    uint16_t                 message_id;     ///< Message ID of the last notification sent to the observer
+    GG_Buffer*               pending;        ///< CON notification waiting for an ACK, or NULL
+    uint32_t                 resend_timeout; ///< Timeout after which the pending notification is resent, in ms
+    uint32_t                 resend_time;    ///< Scheduler time at which the pending notification is resent
+    uint8_t                  resend_count;   ///< Number of times the pending notification has been resent
+    uint32_t                 rto;            ///< RTO estimate for the observer (0 to double the timeout on resends)
+    bool                     rtt_sample;     ///< True if the ACK of the pending notification gives an RTT sample
+    uint32_t                 send_time;      ///< Scheduler time at which the pending notification was first sent
+} GG_CoapObserver;
+
+/**
+ * Server-side state of an observable resource.
+ */
+struct GG_CoapObservable {
+    GG_IMPLEMENTS(GG_TimerListener);
+
+    GG_LinkedListNode list_node;          ///< List node to allow linking this object
+    GG_CoapEndpoint*  endpoint;           ///< Endpoint through which notifications are sent
+    GG_Timer*         resend_timer;       ///< Timer used to resend CON notifications
+    uint32_t          sequence_number;    ///< Observe value of the last notification
+    uint32_t          notification_count; ///< Number of notifications sent, to pick CON notifications
+    GG_CoapObserver   observers[GG_CONFIG_COAP_OBSERVE_MAX_OBSERVERS]; ///< Observers
+};
+
+/**
+ * Client-side state of an observation.
+ */
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapResponseListener);
+
+    GG_LinkedListNode        list_node;         ///< List node to allow linking this object
+    GG_CoapEndpoint*         endpoint;          ///< Endpoint to which the object belongs
+    GG_CoapRequestHandle     handle;            ///< Handle used to identify the observation when cancelling
+    GG_CoapRequestHandle     request;           ///< Handle of the registration request while it is in flight
+    GG_CoapResponseListener* listener;          ///< Listener for responses/notifications/errors
+    uint8_t                  token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH]; ///< Token of the notifications
+    size_t                   token_length;      ///< Size of the token (0 until the registration response)
+    uint32_t                 sequence_number;   ///< Observe value of the last notification delivered
+    uint32_t                 notification_time; ///< Scheduler time at which it was delivered
+} GG_CoapObservation;
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+
+//----------------------------------------------------------------------
+// Get the metadata to use to reply to a message, given the metadata of that message
+//----------------------------------------------------------------------
+static const GG_BufferMetadata*
+GG_CoapObserve_GetReplyMetadata(const GG_BufferMetadata* metadata, GG_SocketAddressMetadata* reply_metadata)
+{
+    const GG_SocketAddress* peer = GG_CoapEndpoint_GetPeerAddress(metadata);
+    if (peer == NULL) {
+        return NULL;
+    }
+
+    reply_metadata->base.type      = GG_BUFFER_METADATA_TYPE_DESTINATION_SOCKET_ADDRESS;
+    reply_metadata->base.size      = sizeof(GG_SocketAddressMetadata);
+    reply_metadata->socket_address = *peer;
+
+    return &reply_metadata->base;
+}
+
+//----------------------------------------------------------------------
+// Send an empty ACK or RST message in reply to a message
+//----------------------------------------------------------------------
+static void
+GG_CoapObserve_SendEmptyMessage(GG_CoapEndpoint*         endpoint,
+                                GG_CoapMessageType       type,
+                                uint16_t                 message_id,
+                                const GG_BufferMetadata* metadata)
+{
+    GG_CoapMessage* message = NULL;
+    GG_Result result = GG_CoapMessage_Create(0, type, NULL, 0, message_id, NULL, 0, NULL, 0, &message);
+    if (GG_FAILED(result)) {
+        GG_LOG_WARNING("failed to create empty message (%d)", result);
+        return;
+    }
+
+    GG_SocketAddressMetadata reply_metadata;
+    GG_CoapEndpoint_SendMessage(endpoint, message, GG_CoapObserve_GetReplyMetadata(metadata, &reply_metadata));
+    GG_CoapMessage_Destroy(message);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_CoapObserver_Clear(GG_CoapObserver* self)
+{
+    if (self->pending) {
+        GG_Buffer_Release(self->pending);
+    }
+    memset(self, 0, sizeof(*self));
+}
+
+//----------------------------------------------------------------------
+// Check if an observer is at a given address, and, if a token is given,
+// registered with that token
+//----------------------------------------------------------------------
+static bool
+GG_CoapObserver_Matches(const GG_CoapObserver* self,
+                        const GG_SocketAddress* peer,
+                        const uint8_t*          token,
+                        size_t                  token_length)
+{
+    if (!self->in_use) {
+        return false;
+    }
+    if (peer == NULL) {
+        if (self->has_peer) {
+            return false;
+        }
+    } else if (!self->has_peer ||
+               self->destination.socket_address.port != peer->port ||
+               !GG_IpAddress_Equal(&self->destination.socket_address.address, &peer->address)) {
+        return false;
+    }
+
+    return token == NULL || (self->token_length == token_length && !memcmp(self->token, token, token_length));
+}
+
+//----------------------------------------------------------------------
+// Schedule the resend timer for the earliest pending CON notification, if any
+//----------------------------------------------------------------------
+static void
+GG_CoapObservable_ScheduleTimer(GG_CoapObservable* self)
+{
+    uint32_t now     = GG_TimerScheduler_GetTime(self->endpoint->timer_scheduler);
+    bool     pending = false;
+    uint32_t delay   = 0;
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->observers); i++) {
+        GG_CoapObserver* observer = &self->observers[i];
+        if (observer->pending == NULL) {
+            continue;
+        }
+        uint32_t observer_delay = (int32_t)(observer->resend_time - now) > 0 ? observer->resend_time - now : 0;
+        if (!pending || observer_delay < delay) {
+            delay = observer_delay;
+        }
+        pending = true;
+    }
+
+    if (pending) {
+        GG_Timer_Schedule(self->resend_timer, GG_CAST(self, GG_TimerListener), delay);
+    } else {
+        GG_Timer_Unschedule(self->resend_timer);
+    }
+}
+
+//----------------------------------------------------------------------
+// Send a notification to an observer.
+// The datagram is built from a notification serialized without a token,
+// by rewriting the header and inserting the observer's token.
+//----------------------------------------------------------------------
+static GG_Result
+GG_CoapObservable_SendNotification(GG_CoapObservable* self,
+                                   GG_CoapObserver*   observer,
+                                   const uint8_t*     notification,
+                                   size_t             notification_size,
+                                   bool               confirmable)
+{
+    if (observer->pending) {
+        // the new notification replaces the one that is still being retransmitted,
+        // and takes over its retransmission state (RFC 7641 section 4.5.2)
+        GG_Buffer_Release(observer->pending);
+        observer->pending    = NULL;
+        observer->rtt_sample = false; // the ACK would be for the new notification
+        confirmable          = true;
+    } else if (confirmable) {
+        // pick a random value for the resend timeout, like for requests
+        const GG_SocketAddress* peer = observer->has_peer ? &observer->destination.socket_address : NULL;
+        observer->send_time      = GG_TimerScheduler_GetTime(self->endpoint->timer_scheduler);
+        observer->resend_timeout = GG_CoapEndpoint_GetResendTimeout(self->endpoint, peer, &observer->rto);
+        observer->resend_time    = observer->send_time + observer->resend_timeout;
+        observer->resend_count   = 0;
+        observer->rtt_sample     = true;
+    }
+
+    // build the datagram
+    size_t            datagram_size = notification_size + observer->token_length;
+    GG_DynamicBuffer* buffer        = NULL;
+    GG_Result result = GG_DynamicBuffer_Create(datagram_size, &buffer);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+    GG_DynamicBuffer_SetDataSize(buffer, datagram_size);
+    uint8_t* data = GG_DynamicBuffer_UseData(buffer);
+    GG_CoapMessageType type = confirmable ? GG_COAP_MESSAGE_TYPE_CON : GG_COAP_MESSAGE_TYPE_NON;
+    observer->message_id = self->endpoint->message_id_counter++;
+    data[0] = (uint8_t)((1 << 6) | (type << 4) | observer->token_length); // Ver | T | TKL
+    data[1] = notification[1];                                             // Code
+    GG_BytesFromInt16Be(&data[2], observer->message_id);                   // Message ID
+    memcpy(&data[4], observer->token, observer->token_length);
+    memcpy(&data[4 + observer->token_length], &notification[4], notification_size - 4);
+    GG_Buffer* datagram = GG_DynamicBuffer_AsBuffer(buffer);
+
+    // keep CON notifications until they are acknowledged
+    if (confirmable) {
+        observer->pending = GG_Buffer_Retain(datagram);
+    }
+
+    // send
+    result = GG_CoapEndpoint_SendDatagram(self->endpoint,
+                                          datagram,
+                                          observer->has_peer ? &observer->destination.base : NULL);
+    GG_Buffer_Release(datagram);
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Called when the resend timer fires
+//----------------------------------------------------------------------
+static void
+GG_CoapObservable_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint32_t elapsed)
+{
+    GG_CoapObservable* self = GG_SELF(GG_CoapObservable, GG_TimerListener);
+    GG_COMPILER_UNUSED(timer);
+    GG_COMPILER_UNUSED(elapsed);
+
+    uint32_t now = GG_TimerScheduler_GetTime(self->endpoint->timer_scheduler);
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->observers); i++) {
+        GG_CoapObserver* observer = &self->observers[i];
+        if (observer->pending == NULL || (int32_t)(observer->resend_time - now) > 0) {
+            continue;
+        }
+
+        // give up on observers that don't acknowledge notifications
+        if (observer->resend_count >= GG_COAP_DEFAULT_MAX_RETRANSMIT) {
+            GG_LOG_INFO("notification not acknowledged, removing observer");
+            GG_CoapObserver_Clear(observer);
+            continue;
+        }
+
+        // resend
+        GG_LOG_FINE("resending notification (count = %d)", (int)observer->resend_count);
+        ++observer->resend_count;
+        observer->resend_timeout = GG_CoapEndpoint_BackOffResendTimeout(observer->resend_timeout, observer->rto);
+        observer->resend_time    = now + observer->resend_timeout;
+        GG_CoapEndpoint_SendDatagram(self->endpoint,
+                                     observer->pending,
+                                     observer->has_peer ? &observer->destination.base : NULL);
+    }
+
+    GG_CoapObservable_ScheduleTimer(self);
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_CoapObservable, GG_TimerListener) {
+    .OnTimerFired = GG_CoapObservable_OnTimerFired
+};
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapObservable_Create(GG_CoapEndpoint* endpoint, GG_CoapObservable** observable)
+{
+    GG_ASSERT(endpoint);
+    GG_ASSERT(observable);
+
+    // allocate a new object
+    GG_CoapObservable* self = (GG_CoapObservable*)GG_AllocateZeroMemory(sizeof(GG_CoapObservable));
+    if (self == NULL) {
+        *observable = NULL;
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    // create a timer
+    GG_Result result = GG_TimerScheduler_CreateTimer(endpoint->timer_scheduler, &self->resend_timer);
+    if (GG_FAILED(result)) {
+        GG_FreeMemory(self);
+        *observable = NULL;
+        return result;
+    }
+
+    // init the object
+    self->endpoint = endpoint;
+    GG_SET_INTERFACE(self, GG_CoapObservable, GG_TimerListener);
+    GG_LINKED_LIST_APPEND(&endpoint->observables, &self->list_node);
+
+    *observable = self;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+void
+GG_CoapObservable_Destroy(GG_CoapObservable* self)
+{
+    if (self == NULL) return;
+
+    GG_LINKED_LIST_NODE_REMOVE(&self->list_node);
+    GG_Timer_Destroy(self->resend_timer);
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->observers); i++) {
+        GG_CoapObserver_Clear(&self->observers[i]);
+    }
+
+    GG_ClearAndFreeObject(self, 1);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapObservable_OnRequest(GG_CoapObservable*         self,
+                            const GG_CoapMessage*      request,
+                            const GG_BufferMetadata*   transport_metadata,
+                            GG_CoapMessageOptionParam* observe_option,
+                            size_t*                    observe_option_count)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(request);
+    GG_ASSERT(observe_option);
+    GG_ASSERT(observe_option_count);
+
+    *observe_option_count = 0;
+
+    // only GET requests with an Observe option are for us
+    GG_CoapMessageOption option;
+    if (GG_CoapMessage_GetCode(request) != GG_COAP_METHOD_GET ||
+        GG_FAILED(GG_CoapMessage_GetOption(request, GG_COAP_MESSAGE_OPTION_OBSERVE, &option, 0))) {
+        return GG_SUCCESS;
+    }
+
+    // look for an existing registration
+    const GG_SocketAddress* peer = GG_CoapEndpoint_GetPeerAddress(transport_metadata);
+    uint8_t                 token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    size_t                  token_length = GG_CoapMessage_GetToken(request, token);
+    GG_CoapObserver*        observer     = NULL;
+    GG_CoapObserver*        free_entry   = NULL;
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->observers); i++) {
+        if (GG_CoapObserver_Matches(&self->observers[i], peer, token, token_length)) {
+            observer = &self->observers[i];
+            break;
+        }
+        if (free_entry == NULL && !self->observers[i].in_use) {
+            free_entry = &self->observers[i];
+        }
+    }
+
+    if (option.value.uint == GG_COAP_OBSERVE_DEREGISTER) {
+        if (observer) {
+            GG_LOG_FINE("removing observer");
+            GG_CoapObserver_Clear(observer);
+            GG_CoapObservable_ScheduleTimer(self);
+        }
+        return GG_SUCCESS;
+    }
+    if (option.value.uint != GG_COAP_OBSERVE_REGISTER) {
+        return GG_SUCCESS;
+    }
+
+    // register the observer, or refresh its registration
+    if (observer == NULL) {
+        if (free_entry == NULL) {
+            GG_LOG_INFO("too many observers, not registering");
+            return GG_SUCCESS;
+        }
+        GG_LOG_FINE("adding observer");
+        observer = free_entry;
+        observer->in_use = true;
+        if (GG_CoapObserve_GetReplyMetadata(transport_metadata, &observer->destination)) {
+            observer->has_peer = true;
+        }
+        memcpy(observer->token, token, token_length);
+        observer->token_length = token_length;
+    }
+
+    // return the Observe option for the response
+    memset(observe_option, 0, sizeof(*observe_option));
+    observe_option->option.number     = GG_COAP_MESSAGE_OPTION_OBSERVE;
+    observe_option->option.type       = GG_COAP_MESSAGE_OPTION_TYPE_UINT;
+    observe_option->option.value.uint = self->sequence_number;
+    *observe_option_count = 1;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapObservable_Notify(GG_CoapObservable*         self,
+                         uint8_t                    code,
+                         GG_CoapMessageOptionParam* options,
+                         size_t                     options_count,
+                         const uint8_t*             payload,
+                         size_t                     payload_size)
+{
+    GG_ASSERT(self);
+    GG_THREAD_GUARD_CHECK_BINDING(self->endpoint);
+
+    // a notification that isn't a success ends the observations
+    bool final = (GG_COAP_MESSAGE_CODE_CLASS(code) != GG_COAP_MESSAGE_CODE_CLASS_SUCCESS_RESPONSE);
+
+    // advance the sequence number
+    self->sequence_number = (self->sequence_number + 1) & GG_COAP_OBSERVE_SEQUENCE_NUMBER_MASK;
+    bool confirmable = !final && (++self->notification_count % GG_CONFIG_COAP_OBSERVE_CON_INTERVAL) == 0;
+
+    // serialize the notification once, with no token
+    GG_CoapMessageOptionParam observe_option = {
+        .option.number     = GG_COAP_MESSAGE_OPTION_OBSERVE,
+        .option.type       = GG_COAP_MESSAGE_OPTION_TYPE_UINT,
+        .option.value.uint = self->sequence_number,
+        .next              = options // chain with the passed-in options
+    };
+    GG_CoapMessage* notification = NULL;
+    GG_Result result = GG_CoapMessage_Create(code,
+                                             GG_COAP_MESSAGE_TYPE_NON,
+                                             final ? options : &observe_option,
+                                             final ? options_count : options_count + 1,
+                                             0,
+                                             NULL,
+                                             0,
+                                             payload,
+                                             payload_size,
+                                             &notification);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+    GG_Buffer* notification_datagram = NULL;
+    result = GG_CoapMessage_ToDatagram(notification, &notification_datagram);
+    GG_CoapMessage_Destroy(notification);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+
+    // send a copy to each observer
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->observers); i++) {
+        GG_CoapObserver* observer = &self->observers[i];
+        if (!observer->in_use) {
+            continue;
+        }
+
+        result = GG_CoapObservable_SendNotification(self,
+                                                    observer,
+                                                    GG_Buffer_GetData(notification_datagram),
+                                                    GG_Buffer_GetDataSize(notification_datagram),
+                                                    confirmable);
+        if (GG_FAILED(result)) {
+            GG_LOG_WARNING("failed to send notification (%d)", result);
+        }
+        if (final) {
+            GG_CoapObserver_Clear(observer);
+        }
+    }
+    GG_Buffer_Release(notification_datagram);
+
+    GG_CoapObservable_ScheduleTimer(self);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+size_t
+GG_CoapObservable_GetObserverCount(const GG_CoapObservable* self)
+{
+    GG_ASSERT(self);
+
+    size_t count = 0;
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->observers); i++) {
+        if (self->observers[i].in_use) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+//----------------------------------------------------------------------
+// Handle an empty ACK or RST message that may be for a notification
+//----------------------------------------------------------------------
+static bool
+GG_CoapObservable_OnEmptyMessage(GG_CoapObservable*       self,
+                                 const GG_CoapMessage*    message,
+                                 const GG_BufferMetadata* metadata)
+{
+    const GG_SocketAddress* peer       = GG_CoapEndpoint_GetPeerAddress(metadata);
+    uint16_t                message_id = GG_CoapMessage_GetMessageId(message);
+    for (size_t i = 0; i < GG_ARRAY_SIZE(self->observers); i++) {
+        GG_CoapObserver* observer = &self->observers[i];
+        if (!GG_CoapObserver_Matches(observer, peer, NULL, 0) || observer->message_id != message_id) {
+            continue;
+        }
+
+        if (GG_CoapMessage_GetType(message) == GG_COAP_MESSAGE_TYPE_RST) {
+            // the observer isn't interested anymore
+            GG_LOG_FINE("notification rejected, removing observer");
+            GG_CoapObserver_Clear(observer);
+        } else if (observer->pending) {
+            GG_LOG_FINER("notification acknowledged");
+            GG_Buffer_Release(observer->pending);
+            observer->pending = NULL;
+            if (observer->rtt_sample) {
+                uint32_t now = GG_TimerScheduler_GetTime(self->endpoint->timer_scheduler);
+                GG_CoapEndpoint_OnRttSample(self->endpoint, peer, now - observer->send_time, observer->resend_count);
+            }
+        }
+        GG_CoapObservable_ScheduleTimer(self);
+
+        return true;
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_CoapObservation_Destroy(GG_CoapObservation* self)
+{
+    if (self == NULL) return;
+
+    if (self->request != GG_COAP_INVALID_REQUEST_HANDLE) {
+        GG_CoapEndpoint_CancelRequest(self->endpoint, self->request);
+    }
+    GG_LINKED_LIST_NODE_REMOVE(&self->list_node);
+
+    GG_ClearAndFreeObject(self, 1);
+}
+
+//----------------------------------------------------------------------
+// Check if a notification is more recent than the last one delivered (RFC 7641 section 3.4)
+//----------------------------------------------------------------------
+static bool
+GG_CoapObservation_IsFresh(const GG_CoapObservation* self, uint32_t sequence_number, uint32_t now)
+{
+    uint32_t v1 = self->sequence_number;
+    uint32_t v2 = sequence_number;
+
+    return (v1 < v2 && v2 - v1 < (1UL << 23)) ||
+           (v1 > v2 && v1 - v2 > (1UL << 23)) ||
+           (now - self->notification_time > GG_COAP_OBSERVE_FRESHNESS_TIMEOUT_MS);
+}
+
+//----------------------------------------------------------------------
+// Deliver the response to the registration request, or a notification
+//----------------------------------------------------------------------
+static void
+GG_CoapObservation_OnMessage(GG_CoapObservation* self, GG_CoapMessage* message, bool registration)
+{
+    GG_CoapMessageOption observe_option;
+    if (GG_COAP_MESSAGE_CODE_CLASS(GG_CoapMessage_GetCode(message)) != GG_COAP_MESSAGE_CODE_CLASS_SUCCESS_RESPONSE ||
+        GG_FAILED(GG_CoapMessage_GetOption(message, GG_COAP_MESSAGE_OPTION_OBSERVE, &observe_option, 0))) {
+        // the observation is over, deliver this last message
+        GG_LOG_FINE("observation ended");
+        GG_CoapResponseListener* listener = self->listener;
+        GG_CoapObservation_Destroy(self);
+        GG_CoapResponseListener_OnResponse(listener, message);
+        return;
+    }
+
+    // drop notifications that arrive out of order
+    uint32_t now = GG_TimerScheduler_GetTime(self->endpoint->timer_scheduler);
+    if (!registration && !GG_CoapObservation_IsFresh(self, (uint32_t)observe_option.value.uint, now)) {
+        GG_LOG_FINE("stale notification, dropping");
+        return;
+    }
+    self->sequence_number   = (uint32_t)observe_option.value.uint;
+    self->notification_time = now;
+    if (registration) {
+        self->token_length = GG_CoapMessage_GetToken(message, self->token);
+    }
+
+    // deliver (the listener may cancel the observation, so this is the last thing we do)
+    GG_CoapResponseListener_OnResponse(self->listener, message);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_CoapObservation_OnAck(GG_CoapResponseListener* _self)
+{
+    GG_CoapObservation* self = GG_SELF(GG_CoapObservation, GG_CoapResponseListener);
+
+    GG_CoapResponseListener_OnAck(self->listener);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_CoapObservation_OnError(GG_CoapResponseListener* _self, GG_Result error, const char* message)
+{
+    GG_CoapObservation* self = GG_SELF(GG_CoapObservation, GG_CoapResponseListener);
+
+    // the request is done, the observation is over
+    GG_CoapResponseListener* listener = self->listener;
+    self->request = GG_COAP_INVALID_REQUEST_HANDLE;
+    GG_CoapObservation_Destroy(self);
+
+    GG_CoapResponseListener_OnError(listener, error, message);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_CoapObservation_OnResponse(GG_CoapResponseListener* _self, GG_CoapMessage* response)
+{
+    GG_CoapObservation* self = GG_SELF(GG_CoapObservation, GG_CoapResponseListener);
+
+    self->request = GG_COAP_INVALID_REQUEST_HANDLE;
+    GG_CoapObservation_OnMessage(self, response, true);
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_CoapObservation, GG_CoapResponseListener) {
+    .OnAck      = GG_CoapObservation_OnAck,
+    .OnError    = GG_CoapObservation_OnError,
+    .OnResponse = GG_CoapObservation_OnResponse
+};
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_SendObserveRequest(GG_CoapEndpoint*               self,
+                                   GG_CoapMessageOptionParam*     options,
+                                   size_t                         options_count,
+                                   const GG_CoapClientParameters* client_parameters,
+                                   GG_CoapResponseListener*       listener,
+                                   GG_CoapRequestHandle*          request_handle)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(listener);
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    // allocate a new observation
+    GG_CoapObservation* observation = (GG_CoapObservation*)GG_AllocateZeroMemory(sizeof(GG_CoapObservation));
+    if (observation == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+    observation->endpoint = self;
+    observation->listener = listener;
+    observation->handle   = self->observation_handle_base++;
+    GG_SET_INTERFACE(observation, GG_CoapObservation, GG_CoapResponseListener);
+    GG_LINKED_LIST_APPEND(&self->observations, &observation->list_node);
+
+    // send the registration request
+    GG_CoapMessageOptionParam observe_option = {
+        .option.number     = GG_COAP_MESSAGE_OPTION_OBSERVE,
+        .option.type       = GG_COAP_MESSAGE_OPTION_TYPE_UINT,
+        .option.value.uint = GG_COAP_OBSERVE_REGISTER,
+        .next              = options // chain with the passed-in options
+    };
+    GG_Result result = GG_CoapEndpoint_SendRequest(self,
+                                                   GG_COAP_METHOD_GET,
+                                                   &observe_option,
+                                                   options_count + 1,
+                                                   NULL,
+                                                   0,
+                                                   client_parameters,
+                                                   GG_CAST(observation, GG_CoapResponseListener),
+                                                   &observation->request);
+    if (GG_FAILED(result)) {
+        observation->request = GG_COAP_INVALID_REQUEST_HANDLE;
+        GG_CoapObservation_Destroy(observation);
+        return result;
+    }
+
+    // return the handle
+    if (request_handle) {
+        *request_handle = observation->handle;
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_CoapEndpoint_CancelObservation(GG_CoapEndpoint* self, GG_CoapRequestHandle request_handle)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    GG_LINKED_LIST_FOREACH(node, &self->observations) {
+        GG_CoapObservation* observation = GG_LINKED_LIST_ITEM(node, GG_CoapObservation, list_node);
+        if (observation->handle == request_handle) {
+            GG_CoapObservation_Destroy(observation);
+            return GG_SUCCESS;
+        }
+    }
+
+    return GG_ERROR_NO_SUCH_ITEM;
+}
+
+//----------------------------------------------------------------------
+void
+GG_CoapEndpoint_DestroyObservations(GG_CoapEndpoint* self)
+{
+    GG_LINKED_LIST_FOREACH_SAFE(node, &self->observations) {
+        GG_CoapObservation* observation = GG_LINKED_LIST_ITEM(node, GG_CoapObservation, list_node);
+        GG_CoapObservation_Destroy(observation);
+    }
+}
+
+//----------------------------------------------------------------------
+bool
+GG_CoapEndpoint_OnUnmatchedObserveMessage(GG_CoapEndpoint*         self,
+                                          GG_CoapMessage*          message,
+                                          const GG_BufferMetadata* metadata)
+{
+    GG_CoapMessageType type = GG_CoapMessage_GetType(message);
+
+    // empty ACK and RST messages may be for notifications sent to observers
+    if (GG_CoapMessage_GetCode(message) == 0) {
+        if (type != GG_COAP_MESSAGE_TYPE_ACK && type != GG_COAP_MESSAGE_TYPE_RST) {
+            return false;
+        }
+        GG_LINKED_LIST_FOREACH(node, &self->observables) {
+            GG_CoapObservable* observable = GG_LINKED_LIST_ITEM(node, GG_CoapObservable, list_node);
+            if (GG_CoapObservable_OnEmptyMessage(observable, message, metadata)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // only CON and NON messages can be notifications
+    if (type != GG_COAP_MESSAGE_TYPE_CON && type != GG_COAP_MESSAGE_TYPE_NON) {
+        return false;
+    }
+
+    // look for an observation with the same token
+    uint8_t token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    size_t  token_length         = GG_CoapMessage_GetToken(message, token);
+    bool    registration_pending = false;
+    GG_LINKED_LIST_FOREACH(node, &self->observations) {
+        GG_CoapObservation* observation = GG_LINKED_LIST_ITEM(node, GG_CoapObservation, list_node);
+        if (observation->token_length == 0) {
+            registration_pending = true;
+            continue;
+        }
+        if (observation->token_length != token_length || memcmp(observation->token, token, token_length)) {
+            continue;
+        }
+
+        // acknowledge CON notifications, even stale ones
+        if (type == GG_COAP_MESSAGE_TYPE_CON) {
+            GG_CoapObserve_SendEmptyMessage(self,
+                                            GG_COAP_MESSAGE_TYPE_ACK,
+                                            GG_CoapMessage_GetMessageId(message),
+                                            metadata);
+        }
+
+        GG_CoapObservation_OnMessage(observation, message, false);
+        return true;
+    }
+
+    // reject notifications that we're not interested in (RFC 7641 section 3.6), unless they
+    // may be for a registration that hasn't been confirmed yet
+    GG_CoapMessageOption observe_option;
+    if (GG_FAILED(GG_CoapMessage_GetOption(message, GG_COAP_MESSAGE_OPTION_OBSERVE, &observe_option, 0))) {
+        return false;
+    }
+    if (!registration_pending) {
+        GG_LOG_FINE("unexpected notification, rejecting");
+        GG_CoapObserve_SendEmptyMessage(self, GG_COAP_MESSAGE_TYPE_RST, GG_CoapMessage_GetMessageId(message), metadata);
+    }
+
+    return true;
+}
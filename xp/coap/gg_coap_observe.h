@@ -0,0 +1,216 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @details
+ *
+ * CoAP library - Observing Resources (RFC 7641).
+ *
+ */
+
+#pragma once
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "xp/coap/gg_coap.h"
+
+//! @addtogroup CoAP CoAP
+//! CoAP Observe
+//! @{
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * Server-side state of an observable resource.
+ *
+ * A request handler that serves an observable resource passes the GET requests it
+ * receives to GG_CoapObservable_OnRequest(), which registers (or deregisters) the client
+ * as an observer, and returns the Observe option that the handler must add to its response.
+ * Every time the state of the resource changes, GG_CoapObservable_Notify() sends the new
+ * representation to all the registered observers.
+ *
+ * Observers are identified by their address (when the transport provides one) and the
+ * token of their registration request. Most notifications are sent as NON messages; one
+ * in every GG_CONFIG_COAP_OBSERVE_CON_INTERVAL notifications is sent as a CON message,
+ * and observers that don't acknowledge it, or that reject a notification with a RST,
+ * are removed.
+ */
+typedef struct GG_CoapObservable GG_CoapObservable;
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Maximum number of observers of a single observable resource.
+ */
+#if !defined(GG_CONFIG_COAP_OBSERVE_MAX_OBSERVERS)
+#define GG_CONFIG_COAP_OBSERVE_MAX_OBSERVERS 8
+#endif
+
+/**
+ * One in this many notifications is sent as a CON message (1 to send all notifications as CON).
+ */
+#if !defined(GG_CONFIG_COAP_OBSERVE_CON_INTERVAL)
+#define GG_CONFIG_COAP_OBSERVE_CON_INTERVAL 8
+#endif
+
+#if GG_CONFIG_COAP_OBSERVE_CON_INTERVAL < 1
+#error "GG_CONFIG_COAP_OBSERVE_CON_INTERVAL must be at least 1"
+#endif
+
+#define GG_COAP_OBSERVE_REGISTER             0        ///< Observe option value of a registration
+#define GG_COAP_OBSERVE_DEREGISTER           1        ///< Observe option value of a deregistration
+#define GG_COAP_OBSERVE_SEQUENCE_NUMBER_MASK 0xFFFFFF ///< Notification sequence numbers are 24 bits
+#define GG_COAP_OBSERVE_FRESHNESS_TIMEOUT_MS 128000   ///< Time after which any notification is fresh
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+/**
+ * Create an observable resource.
+ * The object must be destroyed before the endpoint.
+ *
+ * @param endpoint The endpoint through which notifications are sent.
+ * @param observable Pointer to the variable in which the object will be returned.
+ *
+ * @return GG_SUCCESS if the object could be created, or a negative error code.
+ */
+GG_Result GG_CoapObservable_Create(GG_CoapEndpoint* endpoint, GG_CoapObservable** observable);
+
+/**
+ * Destroy an observable resource.
+ * Observers are forgotten without being notified.
+ *
+ * @param self The object on which this method is invoked.
+ */
+void GG_CoapObservable_Destroy(GG_CoapObservable* self);
+
+/**
+ * Update the list of observers when a request for the resource is received.
+ * This should be called by the request handler for every request it accepts.
+ * A GET request with an Observe option equal to GG_COAP_OBSERVE_REGISTER registers its sender
+ * as an observer (or refreshes its registration), and one with an Observe option equal to
+ * GG_COAP_OBSERVE_DEREGISTER removes it. Other requests are left alone.
+ *
+ * @param self The object on which this method is invoked.
+ * @param request The request received by the handler.
+ * @param transport_metadata Metadata of the request, as passed to the handler.
+ * @param observe_option Pointer to the option param in which the Observe option of the response is returned.
+ * @param observe_option_count Pointer to the variable in which the number of options to add to the
+ * response is returned (1 if the sender is an observer, or 0 otherwise, for example when the list
+ * of observers is full).
+ *
+ * @return GG_SUCCESS if the request could be processed, or a negative error code.
+ */
+GG_Result GG_CoapObservable_OnRequest(GG_CoapObservable*         self,
+                                      const GG_CoapMessage*      request,
+                                      const GG_BufferMetadata*   transport_metadata,
+                                      GG_CoapMessageOptionParam* observe_option,
+                                      size_t*                    observe_option_count);
+
+/**
+ * Send a notification with the current representation of the resource to all the observers.
+ * The notification is serialized once, and only the header and token are rewritten for each observer.
+ * A notification with a code that isn't a success code (2.xx) ends all observations, and is sent
+ * without an Observe option.
+ *
+ * @param self The object on which this method is invoked.
+ * @param code The notification code (usually GG_COAP_MESSAGE_CODE_CONTENT).
+ * @param options Options for the notification (the Observe option is added automatically).
+ * @param options_count Number of options.
+ * @param payload Payload of the notification.
+ * @param payload_size Size of the payload.
+ *
+ * @return GG_SUCCESS if the notification could be created, or a negative error code.
+ */
+GG_Result GG_CoapObservable_Notify(GG_CoapObservable*         self,
+                                   uint8_t                    code,
+                                   GG_CoapMessageOptionParam* options,
+                                   size_t                     options_count,
+                                   const uint8_t*             payload,
+                                   size_t                     payload_size);
+
+/**
+ * Get the number of registered observers.
+ *
+ * @param self The object on which this method is invoked.
+ *
+ * @return The number of observers.
+ */
+size_t GG_CoapObservable_GetObserverCount(const GG_CoapObservable* self);
+
+/**
+ * Send a GET request that registers the endpoint as an observer of a resource.
+ * The listener's OnResponse method is called with the response to the request, and then with
+ * every fresh notification. Stale notifications (older than the last one delivered) are dropped.
+ * The observation ends, and the listener isn't called anymore, after a response without an Observe
+ * option (including error responses) has been delivered, or after OnError has been called.
+ *
+ * @param self The object on which this method is called.
+ * @param options Options for the request (the Observe option is added automatically).
+ * @param options_count Number of options for the request.
+ * @param client_parameters Optional client parameters for the registration request. Pass NULL for defaults.
+ * @param listener Listener object that will receive the response, notifications and errors.
+ * @param request_handle Handle to the observation, that may be used subsequently to cancel it.
+ * (the caller may pass NULL if it is not interested in the handle value)
+ *
+ * @return GG_SUCCESS if the call succeeded, or a negative error code.
+ */
+GG_Result GG_CoapEndpoint_SendObserveRequest(GG_CoapEndpoint*               self,
+                                             GG_CoapMessageOptionParam*     options,
+                                             size_t                         options_count,
+                                             const GG_CoapClientParameters* client_parameters,
+                                             GG_CoapResponseListener*       listener,
+                                             GG_CoapRequestHandle*          request_handle);
+
+/**
+ * Cancel an observation.
+ * The observation is forgotten, so the server is told that the endpoint isn't interested anymore
+ * when it sends its next notification, which is rejected with a RST (RFC 7641 section 3.6).
+ * The listener isn't called anymore after this call.
+ *
+ * @param self The object on which this method is called.
+ * @param request_handle Handle of the observation.
+ *
+ * @return GG_SUCCESS if the observation was cancelled, or GG_ERROR_NO_SUCH_ITEM if there is
+ * no observation with that handle.
+ */
+GG_Result GG_CoapEndpoint_CancelObservation(GG_CoapEndpoint* self, GG_CoapRequestHandle request_handle);
+
+/**
+ * Destroy all observations.
+ *
+ * @param self The object on which this method is called.
+ */
+void GG_CoapEndpoint_DestroyObservations(GG_CoapEndpoint* self);
+
+/**
+ * Offer a message that doesn't match any pending request to the observations and observable
+ * resources: notifications are delivered to the matching observation, and empty ACK and RST
+ * messages are matched with the notifications sent to observers.
+ *
+ * @param self The object on which this method is called.
+ * @param message The message.
+ * @param metadata Metadata of the message (NULL or a source socket address).
+ *
+ * @return true if the message was handled, false otherwise.
+ */
+bool GG_CoapEndpoint_OnUnmatchedObserveMessage(GG_CoapEndpoint*         self,
+                                               GG_CoapMessage*          message,
+                                               const GG_BufferMetadata* metadata);
+
+//! @}
+
+#if defined(__cplusplus)
+}
+#endif
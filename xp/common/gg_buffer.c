@@ -24,6 +24,8 @@
 #include "gg_buffer.h"
 #include "gg_port.h"
 #include "gg_memory.h"
+#include "gg_inspect.h"
+#include "gg_utils.h"
 
 /*----------------------------------------------------------------------
 |   functions
@@ -133,11 +135,25 @@ GG_StaticBuffer_Init(GG_StaticBuffer* self, const uint8_t* data, size_t data_siz
 struct GG_DynamicBuffer {
     GG_IMPLEMENTS(GG_Buffer);
 
-    unsigned int reference_counter;
-    bool         buffer_is_local;
-    uint8_t*     buffer;
-    size_t       buffer_size;
-    size_t       data_size;
+    unsigned int   reference_counter;
+    bool           buffer_is_local;
+    bool           buffer_is_pooled; // true when using the storage that follows the object in a pool
+    uint8_t*       buffer;
+    size_t         buffer_size;
+    size_t         data_size;
+    GG_BufferPool* pool;             // pool this object belongs to, or NULL
+};
+
+struct GG_BufferPool {
+    GG_IF_INSPECTION_ENABLED(GG_IMPLEMENTS(GG_Inspectable);)
+
+    size_t             buffer_size;
+    size_t             buffer_count;
+    size_t             free_count;
+    bool               destroyed;     // true when the pool has been destroyed but buffers are still in use
+    GG_BufferPoolStats stats;
+    GG_DynamicBuffer** free_buffers;  // stack of free buffers
+    uint8_t*           slab;          // memory for all the buffer objects and their storage
 };
 
 /*----------------------------------------------------------------------
@@ -145,6 +161,12 @@ struct GG_DynamicBuffer {
 +---------------------------------------------------------------------*/
 #define GG_DATA_BUFFER_EXTRA_GROW_SPACE     256
 #define GG_DATA_BUFFER_TRY_DOUBLE_THRESHOLD 4096
+#define GG_BUFFER_POOL_ALIGNMENT            8
+
+// max number of buffers that can be appended to a chain
+#if !defined(GG_CONFIG_BUFFER_CHAIN_MAX_SEGMENTS)
+#define GG_CONFIG_BUFFER_CHAIN_MAX_SEGMENTS 8
+#endif
 
 //----------------------------------------------------------------------
 GG_Buffer*
@@ -170,6 +192,7 @@ GG_DynamicBuffer_Retain_(GG_Buffer* _self)
 }
 
 //----------------------------------------------------------------------
+static void GG_BufferPool_ReturnBuffer(GG_BufferPool* self, GG_DynamicBuffer* buffer);
 static void
 GG_DynamicBuffer_Destroy(GG_DynamicBuffer* self)
 {
@@ -180,6 +203,12 @@ GG_DynamicBuffer_Destroy(GG_DynamicBuffer* self)
     /* free the buffer */
     if (self->buffer_is_local) GG_FreeMemory((void*)self->buffer);
 
+    /* pooled objects go back to their pool */
+    if (self->pool) {
+        GG_BufferPool_ReturnBuffer(self->pool, self);
+        return;
+    }
+
     /* free the object */
     GG_ClearAndFreeObject(self, 1);
 }
@@ -238,11 +267,15 @@ GG_DynamicBuffer_ReallocateBuffer(GG_DynamicBuffer* self, size_t size)
     }
 
     /* destroy the previous buffer */
-    GG_FreeMemory((void*)self->buffer);
+    if (self->buffer_is_local) {
+        GG_FreeMemory((void*)self->buffer);
+    }
 
     /* use the new buffer */
     self->buffer = new_buffer;
     self->buffer_size = size;
+    self->buffer_is_local  = true;
+    self->buffer_is_pooled = false;
 
     return GG_SUCCESS;
 }
@@ -259,7 +292,8 @@ GG_DynamicBuffer_SetBuffer(GG_DynamicBuffer* self,
     }
 
     /* we're now using an external buffer */
-    self->buffer_is_local = false;
+    self->buffer_is_local  = false;
+    self->buffer_is_pooled = false;
     self->buffer = buffer;
     self->buffer_size = buffer_size;
     self->data_size = 0;
@@ -272,7 +306,7 @@ GG_Result
 GG_DynamicBuffer_SetBufferSize(GG_DynamicBuffer* self,
                                size_t            buffer_size)
 {
-    if (self->buffer_is_local) {
+    if (self->buffer_is_local || self->buffer_is_pooled) {
         return GG_DynamicBuffer_ReallocateBuffer(self, buffer_size);
     } else {
         /* cannot change an external buffer */
@@ -360,7 +394,7 @@ GG_DynamicBuffer_SetDataSize(GG_DynamicBuffer* self, size_t size)
 {
     if (size > self->buffer_size) {
         /* the buffer is too small, we need to reallocate it */
-        if (self->buffer_is_local) {
+        if (self->buffer_is_local || self->buffer_is_pooled) {
             GG_CHECK(GG_DynamicBuffer_ReallocateBuffer(self, size));
         } else {
             /* we cannot reallocate an external buffer */
@@ -379,7 +413,7 @@ GG_DynamicBuffer_SetData(GG_DynamicBuffer* self,
                          size_t            data_size)
 {
     if (data_size > self->buffer_size) {
-        if (self->buffer_is_local) {
+        if (self->buffer_is_local || self->buffer_is_pooled) {
             GG_CHECK(GG_DynamicBuffer_ReallocateBuffer(self, data_size));
         } else {
             return GG_ERROR_OUT_OF_RESOURCES;
@@ -465,6 +499,178 @@ GG_DynamicBuffer_Create(size_t size, GG_DynamicBuffer** buffer)
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+static size_t
+GG_BufferPool_GetStride(size_t buffer_size)
+{
+    size_t stride = sizeof(GG_DynamicBuffer) + buffer_size;
+    return (stride + GG_BUFFER_POOL_ALIGNMENT - 1) & ~(size_t)(GG_BUFFER_POOL_ALIGNMENT - 1);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_BufferPool_Free(GG_BufferPool* self)
+{
+    GG_FreeMemory(self->slab);
+    GG_FreeMemory(self->free_buffers);
+    GG_ClearAndFreeObject(self, 0);
+}
+
+#if defined(GG_CONFIG_ENABLE_INSPECTION)
+//----------------------------------------------------------------------
+static GG_Result
+GG_BufferPool_Inspect(GG_Inspectable* _self, GG_Inspector* inspector, const GG_InspectionOptions* options)
+{
+    GG_COMPILER_UNUSED(options);
+    GG_BufferPool* self = GG_SELF(GG_BufferPool, GG_Inspectable);
+
+    GG_BufferPoolStats stats;
+    GG_BufferPool_GetStats(self, &stats);
+    GG_Inspector_OnInteger(inspector, "buffer_size", self->buffer_size, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "buffer_count", self->buffer_count, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "buffers_in_use", stats.buffers_in_use, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "buffers_high_water",
+                           stats.buffers_high_water,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "miss_count", stats.miss_count, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_BufferPool, GG_Inspectable) {
+    .Inspect = GG_BufferPool_Inspect
+};
+#endif
+
+//----------------------------------------------------------------------
+GG_Result
+GG_BufferPool_Create(size_t buffer_size, size_t buffer_count, GG_BufferPool** pool)
+{
+    GG_ASSERT(pool);
+    *pool = NULL;
+
+    // allocate the object and its memory
+    GG_BufferPool* self = (GG_BufferPool*)GG_AllocateZeroMemory(sizeof(GG_BufferPool));
+    if (self == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+    size_t stride = GG_BufferPool_GetStride(buffer_size);
+    self->free_buffers = (GG_DynamicBuffer**)GG_AllocateMemory(buffer_count * sizeof(GG_DynamicBuffer*));
+    self->slab         = (uint8_t*)GG_AllocateMemory(buffer_count * stride);
+    if (buffer_count && (self->free_buffers == NULL || self->slab == NULL)) {
+        GG_BufferPool_Free(self);
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    // setup all the buffer objects
+    self->buffer_size  = buffer_size;
+    self->buffer_count = buffer_count;
+    for (size_t i = 0; i < buffer_count; i++) {
+        GG_DynamicBuffer* buffer = (GG_DynamicBuffer*)(void*)(self->slab + i * stride);
+        memset(buffer, 0, sizeof(*buffer));
+        buffer->pool = self;
+        GG_SET_INTERFACE(buffer, GG_DynamicBuffer, GG_Buffer);
+        self->free_buffers[self->free_count++] = buffer;
+    }
+
+    // setup interfaces
+    GG_IF_INSPECTION_ENABLED(GG_SET_INTERFACE(self, GG_BufferPool, GG_Inspectable));
+
+    *pool = self;
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+void
+GG_BufferPool_Destroy(GG_BufferPool* self)
+{
+    if (self == NULL) return;
+
+    // if some buffers are still in use, the last one to be returned will free the pool
+    if (self->free_count != self->buffer_count) {
+        self->destroyed = true;
+    } else {
+        GG_BufferPool_Free(self);
+    }
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_BufferPool_AllocateBuffer(GG_BufferPool* self, size_t size, GG_DynamicBuffer** buffer)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(buffer);
+
+    // try to get a buffer from the pool
+    GG_DynamicBuffer* pooled = NULL;
+    if (size <= self->buffer_size && self->free_count) {
+        pooled = self->free_buffers[--self->free_count];
+        size_t in_use = self->buffer_count - self->free_count;
+        self->stats.buffers_high_water = GG_MAX(self->stats.buffers_high_water, in_use);
+    } else {
+        ++self->stats.miss_count;
+    }
+
+    // fall back to a regular buffer if needed
+    if (pooled == NULL) {
+        return GG_DynamicBuffer_Create(size, buffer);
+    }
+
+    // setup the buffer
+    pooled->reference_counter = 1;
+    pooled->buffer_is_local   = false;
+    pooled->buffer_is_pooled  = true;
+    pooled->buffer            = (uint8_t*)(pooled + 1);
+    pooled->buffer_size       = self->buffer_size;
+    pooled->data_size         = 0;
+    *buffer = pooled;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_BufferPool_ReturnBuffer(GG_BufferPool* self, GG_DynamicBuffer* buffer)
+{
+    GG_ASSERT(self->free_count < self->buffer_count);
+    self->free_buffers[self->free_count++] = buffer;
+
+    // free the pool if it has been destroyed and this was the last buffer in use
+    if (self->destroyed && self->free_count == self->buffer_count) {
+        GG_BufferPool_Free(self);
+    }
+}
+
+//----------------------------------------------------------------------
+size_t
+GG_BufferPool_GetBufferSize(const GG_BufferPool* self)
+{
+    GG_ASSERT(self);
+    return self->buffer_size;
+}
+
+//----------------------------------------------------------------------
+void
+GG_BufferPool_GetStats(GG_BufferPool* self, GG_BufferPoolStats* stats)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(stats);
+
+    *stats = self->stats;
+    stats->buffers_in_use = self->buffer_count - self->free_count;
+}
+
+#if defined(GG_CONFIG_ENABLE_INSPECTION)
+//----------------------------------------------------------------------
+GG_Inspectable*
+GG_BufferPool_AsInspectable(GG_BufferPool* self)
+{
+    return GG_CAST(self, GG_Inspectable);
+}
+#endif
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -570,6 +776,306 @@ GG_SubBuffer_Create(GG_Buffer* data, size_t offset, size_t size, GG_Buffer** buf
     return GG_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    GG_Buffer*     owner; // buffer that owns the segment data
+    const uint8_t* data;
+    size_t         size;
+} GG_BufferChainSegment;
+
+struct GG_BufferChain {
+    GG_IMPLEMENTS(GG_Buffer);
+
+    unsigned int          reference_counter;
+    size_t                data_size;     // total size, including the header
+    size_t                headroom;      // size of the headroom
+    size_t                header_offset; // offset of the header in the headroom
+    GG_BufferChainSegment segments[GG_CONFIG_BUFFER_CHAIN_MAX_SEGMENTS];
+    size_t                segment_count; // number of appended segments (the header isn't counted)
+    GG_DynamicBuffer*     coalesced;     // contiguous copy of the data, created on demand
+    uint8_t               headroom_data[];
+};
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+
+//----------------------------------------------------------------------
+GG_BufferChain*
+GG_BufferChain_Retain(GG_BufferChain* self)
+{
+    ++self->reference_counter;
+    return self;
+}
+
+//----------------------------------------------------------------------
+void
+GG_BufferChain_Release(GG_BufferChain* self)
+{
+    if (self == NULL) return;
+
+    if (--self->reference_counter == 0) {
+        for (size_t i = 0; i < self->segment_count; i++) {
+            GG_Buffer_Release(self->segments[i].owner);
+        }
+        if (self->coalesced) {
+            GG_DynamicBuffer_Release(self->coalesced);
+        }
+        GG_FreeMemory(self);
+    }
+}
+
+//----------------------------------------------------------------------
+static GG_Buffer*
+GG_BufferChain_Retain_(GG_Buffer* _self)
+{
+    GG_BufferChain* self = GG_SELF(GG_BufferChain, GG_Buffer);
+    return GG_CAST(GG_BufferChain_Retain(self), GG_Buffer);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_BufferChain_Release_(GG_Buffer* _self)
+{
+    GG_BufferChain* self = GG_SELF(GG_BufferChain, GG_Buffer);
+    GG_BufferChain_Release(self);
+}
+
+//----------------------------------------------------------------------
+static const uint8_t*
+GG_BufferChain_GetData(const GG_Buffer* _self)
+{
+    GG_BufferChain* self = (GG_BufferChain*)GG_SELF(GG_BufferChain, GG_Buffer);
+
+    // no need to copy anything if there's only one segment
+    if (GG_BufferChain_GetSegmentCount(self) <= 1) {
+        size_t size = 0;
+        return self->data_size ? GG_BufferChain_GetSegment(self, 0, &size) : NULL;
+    }
+
+    // coalesce the segments if we haven't done it yet
+    if (self->coalesced == NULL) {
+        if (GG_FAILED(GG_DynamicBuffer_Create(self->data_size, &self->coalesced))) {
+            return NULL;
+        }
+        GG_DynamicBuffer_SetDataSize(self->coalesced, self->data_size);
+        GG_BufferChain_CopyData(self, 0, GG_DynamicBuffer_UseData(self->coalesced), self->data_size);
+    }
+
+    return GG_DynamicBuffer_GetData(self->coalesced);
+}
+
+//----------------------------------------------------------------------
+static uint8_t*
+GG_BufferChain_UseData(GG_Buffer* _self)
+{
+    GG_COMPILER_UNUSED(_self);
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+static size_t
+GG_BufferChain_GetDataSize(const GG_Buffer* _self)
+{
+    GG_BufferChain* self = (GG_BufferChain*)GG_SELF(GG_BufferChain, GG_Buffer);
+    return self->data_size;
+}
+
+/*----------------------------------------------------------------------
+|   function table
++---------------------------------------------------------------------*/
+GG_IMPLEMENT_INTERFACE(GG_BufferChain, GG_Buffer)
+{
+    GG_BufferChain_Retain_,
+    GG_BufferChain_Release_,
+    GG_BufferChain_GetData,
+    GG_BufferChain_UseData,
+    GG_BufferChain_GetDataSize
+};
+
+//----------------------------------------------------------------------
+GG_Result
+GG_BufferChain_Create(size_t headroom, GG_BufferChain** chain)
+{
+    GG_ASSERT(chain);
+
+    // allocate a new object, with the headroom at the end
+    GG_BufferChain* self = (GG_BufferChain*)GG_AllocateZeroMemory(sizeof(GG_BufferChain) + headroom);
+    *chain = self;
+    if (self == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    // initialize the object
+    self->reference_counter = 1;
+    self->headroom          = headroom;
+    self->header_offset     = headroom;
+
+    // setup the interface
+    GG_SET_INTERFACE(self, GG_BufferChain, GG_Buffer);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Buffer*
+GG_BufferChain_AsBuffer(GG_BufferChain* self)
+{
+    return GG_CAST(self, GG_Buffer);
+}
+
+//----------------------------------------------------------------------
+GG_BufferChain*
+GG_BufferChain_FromBuffer(GG_Buffer* buffer)
+{
+    if (buffer == NULL || buffer->vtable != &GG_BufferChain_GG_BufferInterface) {
+        return NULL;
+    }
+
+    return GG_SELF_O(buffer, GG_BufferChain, GG_Buffer);
+}
+
+//----------------------------------------------------------------------
+// Forget the contiguous copy of the data, if any, after a change
+//----------------------------------------------------------------------
+static void
+GG_BufferChain_Invalidate(GG_BufferChain* self)
+{
+    if (self->coalesced) {
+        GG_DynamicBuffer_Release(self->coalesced);
+        self->coalesced = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_BufferChain_AppendSegment(GG_BufferChain* self, GG_Buffer* owner, const uint8_t* data, size_t size)
+{
+    if (size == 0) {
+        return GG_SUCCESS;
+    }
+    if (self->segment_count == GG_ARRAY_SIZE(self->segments)) {
+        return GG_ERROR_OUT_OF_RESOURCES;
+    }
+
+    GG_BufferChainSegment* segment = &self->segments[self->segment_count++];
+    segment->owner = GG_Buffer_Retain(owner);
+    segment->data  = data;
+    segment->size  = size;
+    self->data_size += size;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_BufferChain_AppendBuffer(GG_BufferChain* self, GG_Buffer* buffer)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(buffer);
+
+    GG_BufferChain_Invalidate(self);
+
+    // simple case: not a chain
+    GG_BufferChain* other = GG_BufferChain_FromBuffer(buffer);
+    if (other == NULL) {
+        return GG_BufferChain_AppendSegment(self, buffer, GG_Buffer_GetData(buffer), GG_Buffer_GetDataSize(buffer));
+    }
+
+    // flatten the other chain's segments into this one
+    size_t segment_count = GG_BufferChain_GetSegmentCount(other);
+    size_t header_size = other->headroom - other->header_offset;
+    if (self->segment_count + segment_count > GG_ARRAY_SIZE(self->segments)) {
+        return GG_ERROR_OUT_OF_RESOURCES;
+    }
+    GG_BufferChain_AppendSegment(self, buffer, other->headroom_data + other->header_offset, header_size);
+    for (size_t i = 0; i < other->segment_count; i++) {
+        GG_BufferChainSegment* segment = &other->segments[i];
+        GG_BufferChain_AppendSegment(self, segment->owner, segment->data, segment->size);
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_BufferChain_Prepend(GG_BufferChain* self, size_t size, uint8_t** header)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(header);
+
+    if (size > self->header_offset) {
+        *header = NULL;
+        return GG_ERROR_NOT_ENOUGH_SPACE;
+    }
+
+    GG_BufferChain_Invalidate(self);
+    self->header_offset -= size;
+    self->data_size     += size;
+    *header = self->headroom_data + self->header_offset;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+size_t
+GG_BufferChain_GetSegmentCount(const GG_BufferChain* self)
+{
+    GG_ASSERT(self);
+    return self->segment_count + (self->header_offset < self->headroom ? 1 : 0);
+}
+
+//----------------------------------------------------------------------
+const uint8_t*
+GG_BufferChain_GetSegment(const GG_BufferChain* self, size_t index, size_t* size)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(size);
+
+    // the header comes first
+    if (self->header_offset < self->headroom) {
+        if (index == 0) {
+            *size = self->headroom - self->header_offset;
+            return self->headroom_data + self->header_offset;
+        }
+        --index;
+    }
+
+    if (index >= self->segment_count) {
+        *size = 0;
+        return NULL;
+    }
+    *size = self->segments[index].size;
+    return self->segments[index].data;
+}
+
+//----------------------------------------------------------------------
+size_t
+GG_BufferChain_CopyData(const GG_BufferChain* self, size_t offset, uint8_t* data, size_t size)
+{
+    GG_ASSERT(self);
+
+    size_t copied = 0;
+    size_t segment_count = GG_BufferChain_GetSegmentCount(self);
+    for (size_t i = 0; i < segment_count && copied < size; i++) {
+        size_t segment_size = 0;
+        const uint8_t* segment = GG_BufferChain_GetSegment(self, i, &segment_size);
+        if (offset >= segment_size) {
+            // skip this segment entirely
+            offset -= segment_size;
+            continue;
+        }
+        size_t chunk = GG_MIN(segment_size - offset, size - copied);
+        memcpy(data + copied, segment + offset, chunk);
+        copied += chunk;
+        offset = 0;
+    }
+
+    return copied;
+}
+
 /*----------------------------------------------------------------------
 |   thunks
 +---------------------------------------------------------------------*/
@@ -21,6 +21,7 @@
 
 #include "xp/common/gg_types.h"
 #include "xp/common/gg_results.h"
+#include "xp/common/gg_inspect.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -288,6 +289,89 @@ bool GG_DynamicBuffer_Equals(const GG_DynamicBuffer* self, const GG_Buffer* othe
  */
 GG_Result GG_DynamicBuffer_AppendData(GG_DynamicBuffer* self, const uint8_t* data, size_t data_size);
 
+//---------------------------------------------------------------------
+//! @class GG_BufferPool
+//
+//! Pool of pre-allocated GG_DynamicBuffer objects, all with the same buffer size.
+//! The buffer objects and their payload storage are allocated in a single block
+//! when the pool is created. A buffer obtained from the pool goes back to the pool
+//! when its last reference is released, so that steady-state packet processing
+//! doesn't need any heap allocation.
+//! When the pool is empty, or when a buffer larger than the pool's buffer size is
+//! requested, a regular heap-allocated buffer is returned instead (this is counted
+//! as a miss).
+//! A pooled buffer can still grow beyond the pool's buffer size: its data is
+//! then moved to a heap-allocated buffer, like for any other GG_DynamicBuffer.
+//! Pools aren't thread-safe: buffers must be obtained and released on the thread
+//! that uses the pool (typically the loop thread), like GG_DynamicBuffer references.
+//---------------------------------------------------------------------
+typedef struct GG_BufferPool GG_BufferPool;
+
+/**
+ * Statistics for a GG_BufferPool object.
+ */
+typedef struct {
+    size_t buffers_in_use;     ///< Number of pool buffers currently in use
+    size_t buffers_high_water; ///< Max number of pool buffers that were in use at the same time
+    size_t miss_count;         ///< Number of times a buffer had to be allocated outside of the pool
+} GG_BufferPoolStats;
+
+/**
+ * Create a new GG_BufferPool object.
+ * @relates GG_BufferPool
+ * @param buffer_size Size of each buffer in the pool.
+ * @param buffer_count Number of buffers in the pool.
+ * @param pool Pointer to where the new object instance will be returned.
+ * @return #GG_SUCCESS if the object could be created, or an error code.
+ */
+GG_Result GG_BufferPool_Create(size_t buffer_size, size_t buffer_count, GG_BufferPool** pool);
+
+/**
+ * Destroy a GG_BufferPool object.
+ * Buffers obtained from the pool that are still in use remain valid, the
+ * memory for the pool is freed when the last one is released.
+ * @relates GG_BufferPool
+ * @param self The object on which this method is invoked.
+ */
+void GG_BufferPool_Destroy(GG_BufferPool* self);
+
+/**
+ * Get a buffer from the pool.
+ * The returned buffer has a data size of 0, and a buffer size of at least `size`.
+ * @relates GG_BufferPool
+ * @param self The object on which this method is invoked.
+ * @param size Size of the buffer needed.
+ * @param buffer Pointer to where the buffer will be returned.
+ * @return #GG_SUCCESS if a buffer could be obtained, or an error code.
+ */
+GG_Result GG_BufferPool_AllocateBuffer(GG_BufferPool* self, size_t size, GG_DynamicBuffer** buffer);
+
+/**
+ * Get the buffer size of a pool.
+ * @relates GG_BufferPool
+ * @param self The object on which this method is invoked.
+ * @return The size of the buffers in the pool.
+ */
+size_t GG_BufferPool_GetBufferSize(const GG_BufferPool* self);
+
+/**
+ * Get the statistics of a pool.
+ * @relates GG_BufferPool
+ * @param self The object on which this method is invoked.
+ * @param stats Pointer to the structure in which the statistics will be returned.
+ */
+void GG_BufferPool_GetStats(GG_BufferPool* self, GG_BufferPoolStats* stats);
+
+#if defined(GG_CONFIG_ENABLE_INSPECTION)
+/**
+ * Get the GG_Inspectable interface of a pool.
+ * @relates GG_BufferPool
+ * @param self The object on which this method is invoked.
+ * @return The GG_Inspectable interface of the object.
+ */
+GG_Inspectable* GG_BufferPool_AsInspectable(GG_BufferPool* self);
+#endif
+
 //---------------------------------------------------------------------
 //! @class GG_SubBuffer
 //! @implements GG_Buffer
@@ -308,6 +392,126 @@ typedef struct GG_SubBuffer GG_SubBuffer;
  */
 GG_Result GG_SubBuffer_Create(GG_Buffer* data, size_t offset, size_t size, GG_Buffer** buffer);
 
+//---------------------------------------------------------------------
+//! @class GG_BufferChain
+//! @implements GG_Buffer
+//
+//! Class that implements the GG_Buffer interface, representing data
+//! made of a list of segments, each referencing another buffer, plus an
+//! optional header area carved out of a reserved headroom.
+//! This allows layers to prepend their headers to a payload without
+//! copying it. Chain-aware consumers can access the segments directly,
+//! while other consumers can use the GG_Buffer interface, in which case
+//! the segments are coalesced into a contiguous copy on demand.
+//!
+//! Chains are read-only: GG_Buffer_UseData always returns NULL.
+//---------------------------------------------------------------------
+typedef struct GG_BufferChain GG_BufferChain;
+
+/**
+ * Create a new GG_BufferChain object.
+ *
+ * @relates GG_BufferChain
+ * @param headroom Number of bytes reserved for headers that may be prepended.
+ * @param chain Pointer to where the new object instance will be returned.
+ * @return #GG_SUCCESS if the object could be created, or an error code.
+ */
+GG_Result GG_BufferChain_Create(size_t headroom, GG_BufferChain** chain);
+
+/**
+ * Get the GG_Buffer interface of a GG_BufferChain object.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ * @return The GG_Buffer interface of the object.
+ */
+GG_Buffer* GG_BufferChain_AsBuffer(GG_BufferChain* self);
+
+/**
+ * Get the GG_BufferChain object that implements a GG_Buffer interface, if any.
+ *
+ * @relates GG_BufferChain
+ * @param buffer The buffer to check.
+ * @return The GG_BufferChain object, or NULL if the buffer isn't a chain.
+ */
+GG_BufferChain* GG_BufferChain_FromBuffer(GG_Buffer* buffer);
+
+/**
+ * Retain a reference to a GG_BufferChain object.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ * @return The retained object.
+ */
+GG_BufferChain* GG_BufferChain_Retain(GG_BufferChain* self);
+
+/**
+ * Release a reference to a GG_BufferChain object.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ */
+void GG_BufferChain_Release(GG_BufferChain* self);
+
+/**
+ * Append a buffer at the end of a chain.
+ * The buffer is retained, not copied. If the buffer is itself a chain, its
+ * segments are appended individually.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ * @param buffer The buffer to append.
+ * @return #GG_SUCCESS if the buffer could be appended, or #GG_ERROR_OUT_OF_RESOURCES if
+ * the chain has no more free segments.
+ */
+GG_Result GG_BufferChain_AppendBuffer(GG_BufferChain* self, GG_Buffer* buffer);
+
+/**
+ * Prepend a header to a chain, using space from the chain's headroom.
+ * The caller is expected to write the header bytes at the returned address.
+ * Successive calls prepend headers in front of each other.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ * @param size Size of the header.
+ * @param header Pointer to where the address of the header bytes will be returned.
+ * @return #GG_SUCCESS if the header could be prepended, or #GG_ERROR_NOT_ENOUGH_SPACE
+ * if there isn't enough headroom left.
+ */
+GG_Result GG_BufferChain_Prepend(GG_BufferChain* self, size_t size, uint8_t** header);
+
+/**
+ * Get the number of non-empty segments in a chain, including the header segment, if any.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ * @return The number of segments.
+ */
+size_t GG_BufferChain_GetSegmentCount(const GG_BufferChain* self);
+
+/**
+ * Get one of the segments of a chain.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ * @param index Index of the segment, between 0 and the segment count minus 1.
+ * @param size Pointer to where the size of the segment will be returned.
+ * @return Pointer to the segment data.
+ */
+const uint8_t* GG_BufferChain_GetSegment(const GG_BufferChain* self, size_t index, size_t* size);
+
+/**
+ * Copy a range of a chain's data to a contiguous memory buffer.
+ *
+ * @relates GG_BufferChain
+ * @param self The object on which this method is invoked.
+ * @param offset Offset of the first byte to copy.
+ * @param data Memory buffer where the data will be copied.
+ * @param size Number of bytes to copy.
+ * @return The number of bytes copied, which may be less than requested if the chain is shorter.
+ */
+size_t GG_BufferChain_CopyData(const GG_BufferChain* self, size_t offset, uint8_t* data, size_t size);
+
 //----------------------------------------------------------------------
 //! Interface implemented by objects that represent data
 //! buffers that can write their data into another buffer
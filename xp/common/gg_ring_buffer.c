@@ -109,6 +109,28 @@ GG_RingBuffer_GetContiguousAvailable(GG_RingBuffer* self)
          (self->data.end - self->out));
 }
 
+/*--------------------------------------------------------------------*/
+const uint8_t*
+GG_RingBuffer_GetContiguousData(GG_RingBuffer* self, size_t offset, size_t* size)
+{
+    size_t available = GG_RingBuffer_GetAvailable(self);
+    if (offset >= available) {
+        *size = 0;
+        return self->in;
+    }
+
+    // the first block goes from the read position to the end of the data or storage,
+    // the second one (if any) from the start of the storage
+    size_t contiguous = GG_RingBuffer_GetContiguousAvailable(self);
+    if (offset < contiguous) {
+        *size = contiguous - offset;
+        return self->out + offset;
+    } else {
+        *size = available - offset;
+        return self->data.start + (offset - contiguous);
+    }
+}
+
 /*--------------------------------------------------------------------*/
 size_t
 GG_RingBuffer_GetAvailable(GG_RingBuffer* self)
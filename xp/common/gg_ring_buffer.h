@@ -91,6 +91,20 @@ size_t GG_RingBuffer_GetAvailable(GG_RingBuffer* self);
  */
 size_t GG_RingBuffer_GetContiguousAvailable(GG_RingBuffer* self);
 
+/**
+ * Get direct access to the data at a given offset from the read position, without
+ * copying it. Because the data may wrap around the end of the storage, only part of
+ * it may be accessible in one block: the rest can be obtained with another call,
+ * at the offset right after the returned block.
+ *
+ * @param self The object on which this method is invoked.
+ * @param offset Offset from the read position.
+ * @param size Pointer to where the number of contiguous bytes at that offset will be
+ *             returned (0 if the offset is past the available data).
+ * @return Pointer to the data at that offset.
+ */
+const uint8_t* GG_RingBuffer_GetContiguousData(GG_RingBuffer* self, size_t offset, size_t* size);
+
 /**
  * Read one byte from the buffer.
  * NOTE: This method does not do any bounds checking, so it always returns
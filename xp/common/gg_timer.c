@@ -20,15 +20,35 @@
 #include "xp/common/gg_memory.h"
 #include "xp/common/gg_port.h"
 #include "xp/common/gg_timer.h"
+#include "xp/common/gg_utils.h"
 #include "xp/common/gg_logging.h"
 
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
+// number of timers pre-allocated when a scheduler is created
 #if !defined(GG_CONFIG_MAX_TIMERS)
 #define GG_CONFIG_MAX_TIMERS 32
 #endif
 
+// number of timers allocated each time the pool runs out (0 for a fixed-size pool)
+#if !defined(GG_CONFIG_TIMER_POOL_GROWTH_SIZE)
+#define GG_CONFIG_TIMER_POOL_GROWTH_SIZE 32
+#endif
+
+// number of bits of the time value covered by each level of the timing wheel
+#if !defined(GG_CONFIG_TIMER_WHEEL_BITS)
+#define GG_CONFIG_TIMER_WHEEL_BITS 6
+#endif
+
+#if GG_CONFIG_TIMER_WHEEL_BITS < 1 || GG_CONFIG_TIMER_WHEEL_BITS > 6
+#error "GG_CONFIG_TIMER_WHEEL_BITS must be between 1 and 6"
+#endif
+
+#define GG_TIMER_WHEEL_SLOTS     (1 << GG_CONFIG_TIMER_WHEEL_BITS)
+#define GG_TIMER_WHEEL_SLOT_MASK (GG_TIMER_WHEEL_SLOTS - 1)
+#define GG_TIMER_WHEEL_LEVELS    ((32 + GG_CONFIG_TIMER_WHEEL_BITS - 1) / GG_CONFIG_TIMER_WHEEL_BITS)
+
 /*----------------------------------------------------------------------
 |   logging
 +---------------------------------------------------------------------*/
@@ -38,19 +58,46 @@ GG_SET_LOCAL_LOGGER("gg.xp.common.timer")
 |   types
 +---------------------------------------------------------------------*/
 struct GG_Timer {
-    GG_LinkedListNode  list_node;  // to link this object in the scheduled/frozen/nursery lists
+    GG_LinkedListNode  list_node;  // to link this object in a wheel slot or the frozen/nursery lists
     GG_TimerScheduler* scheduler;  // the scheduler that created this timer
     GG_TimerListener*  listener;   // listener that will be called when the timer fires
     uint32_t           start_time; // time when the timer was scheduled
     uint32_t           fire_time;  // time at which the timer will fire
+    uint8_t            level;      // wheel level in which the timer is linked, when scheduled
+    uint8_t            slot;       // wheel slot in which the timer is linked, when scheduled
 };
 
+/**
+ * Block of timers allocated when the initial pool is exhausted.
+ */
+typedef struct {
+    GG_LinkedListNode list_node;
+    GG_Timer          timers[];
+} GG_TimerBlock;
+
+/**
+ * The scheduled timers are kept in a hierarchical timing wheel.
+ *
+ * Level L of the wheel has GG_TIMER_WHEEL_SLOTS slots, each covering 2^(L*GG_CONFIG_TIMER_WHEEL_BITS)
+ * milliseconds. A timer is linked in the level corresponding to the most significant group of
+ * bits by which its fire time differs from the wheel time, in the slot selected by that group of
+ * bits of its fire time. Timers at level 0 are thus sorted by exact fire time, while timers at
+ * higher levels are moved down ("cascaded") when the wheel time reaches the start of their slot.
+ * Timers with the same fire time always end up in the same slot, in the order in which they were
+ * scheduled, so they fire in that order, like they did with a sorted list.
+ *
+ * Each level has a bitmap of non-empty slots, so that finding the next slot to process doesn't
+ * require walking empty slots.
+ */
 struct GG_TimerScheduler {
     GG_Timer      timers[GG_CONFIG_MAX_TIMERS];
-    GG_LinkedList scheduled; // time-ordered list of scheduled timers
-    GG_LinkedList frozen;    // timers that have been created but not scheduled
-    GG_LinkedList nursery;   // timers that are waiting to be created
-    uint32_t      now;       // current time
+    GG_LinkedList wheel[GG_TIMER_WHEEL_LEVELS][GG_TIMER_WHEEL_SLOTS]; // timing wheel slots
+    uint64_t      occupied[GG_TIMER_WHEEL_LEVELS];                    // bitmap of non-empty slots
+    GG_LinkedList frozen;     // timers that have been created but not scheduled
+    GG_LinkedList nursery;    // timers that are waiting to be created
+    GG_LinkedList blocks;     // timer blocks allocated beyond the initial pool
+    uint32_t      now;        // current time
+    uint32_t      wheel_time; // time up to which the wheel has been processed (<= now)
 };
 
 /*----------------------------------------------------------------------
@@ -67,6 +114,170 @@ GG_TimerListener_OnTimerFired(GG_TimerListener *self, GG_Timer *timer, uint32_t
 |   functions
 +---------------------------------------------------------------------*/
 
+//----------------------------------------------------------------------
+// Links a timer in the wheel slot where it belongs, relative to the
+// current wheel time.
+//----------------------------------------------------------------------
+static void
+GG_TimerScheduler_LinkTimer(GG_TimerScheduler* self, GG_Timer* timer)
+{
+    unsigned int level = 0;
+    unsigned int slot;
+    if (timer->fire_time <= self->wheel_time) {
+        // due now (or in the past): put it in the current slot of level 0
+        slot = self->wheel_time & GG_TIMER_WHEEL_SLOT_MASK;
+    } else {
+        // find the most significant group of bits that differs from the wheel time
+        uint32_t diff = timer->fire_time ^ self->wheel_time;
+        while (level < GG_TIMER_WHEEL_LEVELS - 1 && (diff >> ((level + 1) * GG_CONFIG_TIMER_WHEEL_BITS))) {
+            ++level;
+        }
+        slot = (timer->fire_time >> (level * GG_CONFIG_TIMER_WHEEL_BITS)) & GG_TIMER_WHEEL_SLOT_MASK;
+    }
+
+    timer->level = (uint8_t)level;
+    timer->slot  = (uint8_t)slot;
+    GG_LINKED_LIST_APPEND(&self->wheel[level][slot], &timer->list_node);
+    self->occupied[level] |= (uint64_t)1 << slot;
+}
+
+//----------------------------------------------------------------------
+// Unlinks a scheduled timer from its wheel slot.
+//----------------------------------------------------------------------
+static void
+GG_TimerScheduler_UnlinkTimer(GG_TimerScheduler* self, GG_Timer* timer)
+{
+    GG_LINKED_LIST_NODE_REMOVE(&timer->list_node);
+    if (GG_LINKED_LIST_IS_EMPTY(&self->wheel[timer->level][timer->slot])) {
+        self->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+    }
+}
+
+//----------------------------------------------------------------------
+// Finds the start time of the earliest non-empty slot of the wheel.
+// Because the time ranges covered by the pending slots of each level
+// don't overlap and increase with the level, the earliest slot is
+// the first non-empty one at the lowest non-empty level.
+// For level 0, this is the exact fire time of the timers in that slot,
+// for other levels it is a lower bound.
+//
+// Returns false if no timer is scheduled.
+//----------------------------------------------------------------------
+static bool
+GG_TimerScheduler_GetNextSlotTime(GG_TimerScheduler* self, uint64_t* slot_time)
+{
+    for (unsigned int level = 0; level < GG_TIMER_WHEEL_LEVELS; level++) {
+        unsigned int shift   = level * GG_CONFIG_TIMER_WHEEL_BITS;
+        unsigned int current = (self->wheel_time >> shift) & GG_TIMER_WHEEL_SLOT_MASK;
+
+        // only consider the slots from the current one (excluded above level 0)
+        unsigned int first = level ? current + 1 : current;
+        if (first >= GG_TIMER_WHEEL_SLOTS) {
+            continue;
+        }
+        uint64_t pending = self->occupied[level] & (~(uint64_t)0 << first);
+        if (!pending) {
+            continue;
+        }
+
+        // compute the start time of the slot
+        uint64_t epoch_mask = ((uint64_t)1 << (shift + GG_CONFIG_TIMER_WHEEL_BITS)) - 1;
+        *slot_time = ((uint64_t)self->wheel_time & ~epoch_mask) +
+                     ((uint64_t)GG_LowestBitIndex(pending) << shift);
+        return true;
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+// Moves the timers in the slots that start at the current wheel time
+// down to the lower levels.
+//----------------------------------------------------------------------
+static void
+GG_TimerScheduler_Cascade(GG_TimerScheduler* self)
+{
+    for (unsigned int level = GG_TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+        unsigned int shift = level * GG_CONFIG_TIMER_WHEEL_BITS;
+        if (self->wheel_time & (((uint32_t)1 << shift) - 1)) {
+            // the wheel time isn't at a slot boundary for this level
+            continue;
+        }
+        unsigned int slot = (self->wheel_time >> shift) & GG_TIMER_WHEEL_SLOT_MASK;
+        if (!(self->occupied[level] & ((uint64_t)1 << slot))) {
+            continue;
+        }
+
+        // re-link all the timers from this slot, in order
+        GG_LinkedList* list = &self->wheel[level][slot];
+        self->occupied[level] &= ~((uint64_t)1 << slot);
+        while (!GG_LINKED_LIST_IS_EMPTY(list)) {
+            GG_LinkedListNode* node = GG_LINKED_LIST_HEAD(list);
+            GG_LINKED_LIST_NODE_REMOVE(node);
+            GG_TimerScheduler_LinkTimer(self, GG_LINKED_LIST_ITEM(node, GG_Timer, list_node));
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Re-links all the scheduled timers relative to the current time.
+// This is only needed in the unusual case where the time goes backwards.
+//----------------------------------------------------------------------
+static void
+GG_TimerScheduler_Rebase(GG_TimerScheduler* self)
+{
+    // move all the scheduled timers to a temporary list, keeping the order of
+    // timers within a slot, so that timers with the same fire time stay in order
+    GG_LinkedList timers;
+    GG_LINKED_LIST_INIT(&timers);
+    for (unsigned int level = 0; level < GG_TIMER_WHEEL_LEVELS; level++) {
+        while (self->occupied[level]) {
+            unsigned int slot = GG_LowestBitIndex(self->occupied[level]);
+            GG_LinkedList* list = &self->wheel[level][slot];
+            while (!GG_LINKED_LIST_IS_EMPTY(list)) {
+                GG_LinkedListNode* node = GG_LINKED_LIST_HEAD(list);
+                GG_LINKED_LIST_NODE_REMOVE(node);
+                GG_LINKED_LIST_APPEND(&timers, node);
+            }
+            self->occupied[level] &= ~((uint64_t)1 << slot);
+        }
+    }
+
+    // re-link them
+    self->wheel_time = self->now;
+    while (!GG_LINKED_LIST_IS_EMPTY(&timers)) {
+        GG_LinkedListNode* node = GG_LINKED_LIST_HEAD(&timers);
+        GG_LINKED_LIST_NODE_REMOVE(node);
+        GG_TimerScheduler_LinkTimer(self, GG_LINKED_LIST_ITEM(node, GG_Timer, list_node));
+    }
+}
+
+//----------------------------------------------------------------------
+// Adds timers to the nursery by allocating a new block.
+//----------------------------------------------------------------------
+static GG_Result
+GG_TimerScheduler_GrowPool(GG_TimerScheduler* self)
+{
+#if GG_CONFIG_TIMER_POOL_GROWTH_SIZE > 0
+    GG_TimerBlock* block =
+        (GG_TimerBlock*)GG_AllocateZeroMemory(sizeof(GG_TimerBlock) +
+                                              GG_CONFIG_TIMER_POOL_GROWTH_SIZE * sizeof(GG_Timer));
+    if (block == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+    GG_LINKED_LIST_APPEND(&self->blocks, &block->list_node);
+    for (unsigned int i = 0; i < GG_CONFIG_TIMER_POOL_GROWTH_SIZE; i++) {
+        block->timers[i].scheduler = self;
+        GG_LINKED_LIST_APPEND(&self->nursery, &block->timers[i].list_node);
+    }
+
+    return GG_SUCCESS;
+#else
+    GG_COMPILER_UNUSED(self);
+    return GG_ERROR_OUT_OF_RESOURCES;
+#endif
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_TimerScheduler_Create(GG_TimerScheduler** scheduler)
@@ -81,9 +292,14 @@ GG_TimerScheduler_Create(GG_TimerScheduler** scheduler)
     }
 
     // initialize the object
-    GG_LINKED_LIST_INIT(&self->scheduled);
+    for (unsigned int level = 0; level < GG_TIMER_WHEEL_LEVELS; level++) {
+        for (unsigned int slot = 0; slot < GG_TIMER_WHEEL_SLOTS; slot++) {
+            GG_LINKED_LIST_INIT(&self->wheel[level][slot]);
+        }
+    }
     GG_LINKED_LIST_INIT(&self->frozen);
     GG_LINKED_LIST_INIT(&self->nursery);
+    GG_LINKED_LIST_INIT(&self->blocks);
     for (unsigned int i = 0; i < GG_CONFIG_MAX_TIMERS; i++) {
         self->timers[i].scheduler = self;
         GG_LINKED_LIST_APPEND(&self->nursery, &self->timers[i].list_node);
@@ -101,6 +317,13 @@ GG_TimerScheduler_Destroy(GG_TimerScheduler* self)
 {
     if (self == NULL) return;
 
+    // free the blocks that were allocated when the pool grew
+    while (!GG_LINKED_LIST_IS_EMPTY(&self->blocks)) {
+        GG_LinkedListNode* node = GG_LINKED_LIST_HEAD(&self->blocks);
+        GG_LINKED_LIST_NODE_REMOVE(node);
+        GG_FreeMemory(GG_LINKED_LIST_ITEM(node, GG_TimerBlock, list_node));
+    }
+
     GG_ClearAndFreeObject(self, 0);
 }
 
@@ -110,11 +333,14 @@ GG_TimerScheduler_CreateTimer(GG_TimerScheduler* self, GG_Timer** timer)
 {
     GG_ASSERT(self);
 
-    // check that we have a timer available
+    // check that we have a timer available, or grow the pool
     if (GG_LINKED_LIST_IS_EMPTY(&self->nursery)) {
-        GG_LOG_WARNING("timer pool empty");
-        *timer = NULL;
-        return GG_ERROR_OUT_OF_RESOURCES;
+        GG_Result result = GG_TimerScheduler_GrowPool(self);
+        if (GG_FAILED(result)) {
+            GG_LOG_WARNING("timer pool empty");
+            *timer = NULL;
+            return GG_ERROR_OUT_OF_RESOURCES;
+        }
     }
 
     // return a timer from the nursery and add it to the frozen list
@@ -137,27 +363,40 @@ GG_TimerScheduler_SetTime(GG_TimerScheduler* self, uint32_t now)
 
     // set the current time
     self->now = now;
+    if (now < self->wheel_time) {
+        // the time went backwards (or wrapped around)
+        GG_TimerScheduler_Rebase(self);
+    }
 
-    while (!GG_LINKED_LIST_IS_EMPTY(&self->scheduled)) {
-        GG_Timer* timer = GG_LINKED_LIST_ITEM(GG_LINKED_LIST_HEAD(&self->scheduled), GG_Timer, list_node);
-        if (timer->fire_time > now) {
-            // timers past this point don't fire yet
-            break;
-        }
+    // advance the wheel, one non-empty slot at a time
+    uint64_t slot_time;
+    while (GG_TimerScheduler_GetNextSlotTime(self, &slot_time) && slot_time <= now) {
+        self->wheel_time = (uint32_t)slot_time;
+
+        // bring down the timers from the higher levels that may be due now
+        GG_TimerScheduler_Cascade(self);
+
+        // fire all the timers in the current level 0 slot
+        // (this includes timers scheduled with a 0 delay by listeners while we're firing)
+        GG_LinkedList* due = &self->wheel[0][self->wheel_time & GG_TIMER_WHEEL_SLOT_MASK];
+        while (!GG_LINKED_LIST_IS_EMPTY(due)) {
+            GG_Timer* timer = GG_LINKED_LIST_ITEM(GG_LINKED_LIST_HEAD(due), GG_Timer, list_node);
 
-        // prepare to fire this timer
-        GG_ASSERT(timer->listener);
-        GG_ASSERT(timer->start_time <= now);
-        GG_TimerListener* listener = timer->listener;
-        uint32_t          elapsed  = now-timer->start_time;
+            // prepare to fire this timer
+            GG_ASSERT(timer->listener);
+            GG_ASSERT(timer->start_time <= now);
+            GG_TimerListener* listener = timer->listener;
+            uint32_t          elapsed  = now-timer->start_time;
 
-        // unschedule this timer (do this before notifying the listener, so that the listener
-        // can re-schedule or destroy it if it wants to).
-        GG_Timer_Unschedule(timer);
+            // unschedule this timer (do this before notifying the listener, so that the listener
+            // can re-schedule or destroy it if it wants to).
+            GG_Timer_Unschedule(timer);
 
-        // notify the listener
-        GG_TimerListener_OnTimerFired(listener, timer, elapsed);
+            // notify the listener
+            GG_TimerListener_OnTimerFired(listener, timer, elapsed);
+        }
     }
+    self->wheel_time = now;
 
     return GG_SUCCESS;
 }
@@ -174,12 +413,12 @@ uint32_t
 GG_TimerScheduler_GetNextScheduledTime(GG_TimerScheduler* self)
 {
     GG_ASSERT(self);
-    if (GG_LINKED_LIST_IS_EMPTY(&self->scheduled)) {
+    uint64_t slot_time;
+    if (!GG_TimerScheduler_GetNextSlotTime(self, &slot_time)) {
         return GG_TIMER_NEVER;
     }
-    GG_Timer* next_timer = GG_LINKED_LIST_ITEM(GG_LINKED_LIST_HEAD(&self->scheduled), GG_Timer, list_node);
-    if (next_timer->fire_time >= self->now) {
-        return next_timer->fire_time-self->now;
+    if (slot_time >= self->now) {
+        return (uint32_t)(slot_time-self->now);
     } else {
         return 0;
     }
@@ -193,7 +432,7 @@ GG_Timer_Destroy(GG_Timer* self)
 
     // cleanup this timer and move it to the nursery
     GG_ASSERT(!GG_LINKED_LIST_NODE_IS_UNLINKED(&self->list_node));
-    self->listener   = NULL;
+    GG_Timer_Unschedule(self);
     self->start_time = 0;
     self->fire_time  = 0;
     GG_LINKED_LIST_NODE_REMOVE(&self->list_node);
@@ -211,31 +450,21 @@ GG_Timer_Schedule(GG_Timer *self, GG_TimerListener *listener, uint32_t ms_from_n
         return GG_ERROR_INVALID_PARAMETERS;
     }
 
-    // remove this timer from the scheduled or frozen list
-    GG_LINKED_LIST_NODE_REMOVE(&self->list_node);
+    // remove this timer from its wheel slot or the frozen list
+    GG_TimerScheduler* scheduler = self->scheduler;
+    if (self->listener) {
+        GG_TimerScheduler_UnlinkTimer(scheduler, self);
+    } else {
+        GG_LINKED_LIST_NODE_REMOVE(&self->list_node);
+    }
 
     // update the timer
-    GG_TimerScheduler* scheduler = self->scheduler;
     self->start_time = scheduler->now;
     self->fire_time  = scheduler->now + ms_from_now;
     self->listener   = listener;
 
-    // (re)insert the timer into the scheduled list at the proper location
-    GG_LinkedListNode* insertion_point = NULL;
-    GG_LINKED_LIST_FOREACH(node, &scheduler->scheduled) {
-        GG_Timer* timer = GG_LINKED_LIST_ITEM(node, GG_Timer, list_node);
-        if (self->fire_time < timer->fire_time) {
-            insertion_point = node;
-            break;
-        }
-    }
-    if (insertion_point) {
-        // insert before the insertion point
-        GG_LINKED_LIST_NODE_INSERT_BEFORE(insertion_point, &self->list_node);
-    } else {
-        // we're last
-        GG_LINKED_LIST_APPEND(&scheduler->scheduled, &self->list_node);
-    }
+    // (re)insert the timer in the wheel
+    GG_TimerScheduler_LinkTimer(scheduler, self);
 
     return GG_SUCCESS;
 }
@@ -261,8 +490,8 @@ GG_Timer_Unschedule(GG_Timer *self)
         return;
     }
 
-    // remove this from the scheduled list and put it in the frozen list
-    GG_LINKED_LIST_NODE_REMOVE(&self->list_node);
+    // remove this from its wheel slot and put it in the frozen list
+    GG_TimerScheduler_UnlinkTimer(self->scheduler, self);
     GG_LINKED_LIST_PREPEND(&self->scheduler->frozen, &self->list_node);
 
     // NULL out the listener to mark that we're not scheduled anymore
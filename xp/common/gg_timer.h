@@ -116,6 +116,8 @@ GG_Result GG_TimerScheduler_Create(GG_TimerScheduler** scheduler);
 void GG_TimerScheduler_Destroy(GG_TimerScheduler* self);
 
 //! Create a timer.
+//! Timers are taken from a pool that grows as needed (unless the platform is
+//! configured with a fixed-size pool), so this only fails when memory is exhausted.
 GG_Result GG_TimerScheduler_CreateTimer(GG_TimerScheduler* self, GG_Timer** timer);
 
 //! Set the current time of the scheduler.
@@ -128,6 +130,9 @@ uint32_t GG_TimerScheduler_GetTime(GG_TimerScheduler* self);
 
 //! Returns the number of milliseconds after which the next scheduled timer is set
 //! to fire, or #GG_TIMER_NEVER if no timer is scheduled.
+//! NOTE: when the next timer is far in the future, the returned value may be
+//! earlier than its actual fire time (but never later). Calling
+//! GG_TimerScheduler_SetTime at that time is still correct: no timer fires early.
 uint32_t GG_TimerScheduler_GetNextScheduledTime(GG_TimerScheduler* self);
 
 //! @}
@@ -411,6 +411,23 @@ GG_BytesToInt64Le(const uint8_t* buffer)
         (((uint64_t)buffer[0])      );
 }
 
+//----------------------------------------------------------------------
+unsigned int
+GG_LowestBitIndex(uint64_t bits)
+{
+    GG_ASSERT(bits);
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_ctzll(bits);
+#else
+    unsigned int index = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
 //----------------------------------------------------------------------
 char
 GG_NibbleToHex(unsigned int nibble, bool uppercase)
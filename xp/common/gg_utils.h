@@ -287,6 +287,17 @@ size_t GG_DecodeProtobufVarint(const uint8_t* encoded, size_t encoded_size, uint
 uint64_t GG_ProtobufSignedToZigZag(int64_t value);
 int64_t GG_ProtobufSignedFromZigZag(uint64_t value);
 
+/*----------------------------------------------------------------------
+|   bit manipulation
++---------------------------------------------------------------------*/
+/**
+ * Get the index of the least significant bit that is set in a value.
+ *
+ * @param bits Value to examine, which must not be 0.
+ * @return The index of the lowest bit set, between 0 and 63.
+ */
+unsigned int GG_LowestBitIndex(uint64_t bits);
+
 //! @}
 
 #ifdef __cplusplus
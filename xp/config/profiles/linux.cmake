@@ -12,7 +12,7 @@ set(GG_PORTS_ENABLE_MBEDTLS_TLS TRUE CACHE BOOL "")
 set(GG_PORTS_ENABLE_LWIP_SOCKETS TRUE CACHE BOOL "")
 set(GG_PORTS_ENABLE_NIP_SOCKETS TRUE CACHE BOOL "")
 set(GG_PORTS_ENABLE_BSD_SOCKETS TRUE CACHE BOOL "")
-set(GG_PORTS_ENABLE_BSD_SELECT_LOOP TRUE CACHE BOOL "")
+set(GG_PORTS_ENABLE_LINUX_EPOLL_LOOP TRUE CACHE BOOL "")
 set(GG_PORTS_ENABLE_STDC_ENV TRUE CACHE BOOL "")
 set(GG_PORTS_ENABLE_STDC_CONSOLE TRUE CACHE BOOL "")
 set(GG_PORTS_ENABLE_STDC_RANDOM TRUE CACHE BOOL "")
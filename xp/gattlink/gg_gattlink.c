@@ -31,14 +31,35 @@ GG_SET_LOCAL_LOGGER("gg.xp.gattlink.protocol")
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
-#define GG_GATTLINK_SN_WINDOW_SIZE              (1 << 5) ///< Number of packet serial numbers we can track
-#define GG_GATTLINK_SEND_ACK_TIMEOUT            200      ///< Time to wait before ack'ing a received packet, in ms
+#define GG_GATTLINK_SN_SPACE_SIZE               (1 << 5) ///< Number of packet serial numbers (base format)
+#define GG_GATTLINK_EXTENDED_SN_SPACE_SIZE      (1 << 8) ///< Number of packet serial numbers (extended format)
+#define GG_GATTLINK_SEND_ACK_TIMEOUT            200      ///< Default max time to wait before ack'ing a received packet, in ms
+#define GG_GATTLINK_MIN_ACK_DELAY               10       ///< Min time to wait before ack'ing a received packet, in ms
 #define GG_GATTLINK_RESET_COMPLETE_TIMEOUT      1000     ///< Time to wait for a reset completion, in ms
 #define GG_GATTLINK_RESET_COMPLETE_ACK_TIMEOUT  2000     ///< Time to wait for a reset completion ack, in ms
-#define GG_GATTLINK_EXPECTED_ACK_TIMEOUT        4000     ///< Time to wait for a data packet ack before resending
+#define GG_GATTLINK_EXPECTED_ACK_TIMEOUT        4000     ///< Default time to wait for a data packet ack before the first RTT sample
+#define GG_GATTLINK_MIN_RETRANSMIT_TIMEOUT      250      ///< Default lower bound for the retransmission timeout, in ms
+#define GG_GATTLINK_MAX_RETRANSMIT_TIMEOUT      8000     ///< Default upper bound for the retransmission timeout, in ms
+#define GG_GATTLINK_MAX_RETRANSMIT_BACKOFF      16       ///< Max number of times the retransmission timeout is doubled
 #define GG_GATTLINK_STALL_NOTIFICATION_INTERVAL 12000    ///< Time after which we notify of a stall, in ms
 #define GG_GATTLINK_MIN_VERSION                 0x0
-#define GG_GATTLINK_MAX_VERSION                 0x0
+#define GG_GATTLINK_MAX_VERSION                 0x2
+#define GG_GATTLINK_VERSION_SELECTIVE_ACK       0x1      ///< First version supporting selective acks
+#define GG_GATTLINK_VERSION_EXTENDED_FORMAT     0x2      ///< First version using the extended packet format
+#define GG_GATTLINK_SELECTIVE_ACK_SIZE          4        ///< Size of the selective ack bitmap, in bytes
+#define GG_GATTLINK_MAX_REORDER_SLOTS           (8 * GG_GATTLINK_SELECTIVE_ACK_SIZE) ///< Max packets held out of order
+#define GG_GATTLINK_INITIAL_CONGESTION_WINDOW   4        ///< Congestion window at the start of a session, in packets
+#define GG_GATTLINK_MIN_SLOW_START_THRESHOLD    2        ///< Lower bound for the slow start threshold, in packets
+#define GG_GATTLINK_DELAY_CONTROL_MIN_QUEUED    1        ///< Delay-based control grows the window below this
+#define GG_GATTLINK_DELAY_CONTROL_MAX_QUEUED    3        ///< Delay-based control shrinks the window above this
+
+// the per-packet state is indexed by serial number modulo the max window size
+#if (GG_GATTLINK_MAX_WINDOW_SIZE < GG_GATTLINK_SN_SPACE_SIZE) || \
+    (GG_GATTLINK_MAX_WINDOW_SIZE > GG_GATTLINK_EXTENDED_SN_SPACE_SIZE / 2) || \
+    (GG_GATTLINK_MAX_WINDOW_SIZE & (GG_GATTLINK_MAX_WINDOW_SIZE - 1))
+#error "GG_GATTLINK_MAX_WINDOW_SIZE must be a power of 2 between 32 and 128"
+#endif
+#define GG_GATTLINK_SN_SLOT(_sn) ((_sn) & (GG_GATTLINK_MAX_WINDOW_SIZE - 1))
 
 /*----------------------------------------------------------------------
 |   types
@@ -126,23 +147,97 @@ typedef struct {
     uint8_t   next_expected_ack_sn;
     uint8_t   next_data_sn;
     uint8_t   send_buf[GG_GATTLINK_MAX_PACKET_SIZE];
-    size_t    payload_sizes[GG_GATTLINK_SN_WINDOW_SIZE];
+    size_t    payload_sizes[GG_GATTLINK_MAX_WINDOW_SIZE];     ///< Indexed with GG_GATTLINK_SN_SLOT, as below
+    uint32_t  send_times[GG_GATTLINK_MAX_WINDOW_SIZE];        ///< Time at which each packet was first sent
+    bool      retransmitted[GG_GATTLINK_MAX_WINDOW_SIZE];     ///< Packets sent more than once (not sampled)
+    bool      selectively_acked[GG_GATTLINK_MAX_WINDOW_SIZE]; ///< Packets the peer received out of order
+    bool      retransmit_needed[GG_GATTLINK_MAX_WINDOW_SIZE]; ///< Packets to resend before any new data
     GG_Timer* ack_timer;
     GG_Timer* retransmit_timer;
     bool      ack_now;
+    uint32_t  data_packet_count;          ///< Total number of data packets sent, including retransmissions
+    uint32_t  retransmitted_packet_count; ///< Total number of data packets sent more than once
 } GG_GattlinkOutboundPayloadInfo;
 
 /**
  * Details of the inbound state
  */
 typedef struct {
-    uint8_t next_expected_data_psn;
-    bool    payload_buffer_full;
-    uint8_t payload_buf[GG_GATTLINK_MAX_PACKET_SIZE];
-    size_t  payload_len;
-    size_t  bytes_consumed;
+    uint8_t  next_expected_data_psn;
+    bool     payload_buffer_full;
+    uint8_t  payload_buf[GG_GATTLINK_MAX_PACKET_SIZE];
+    size_t   payload_len;
+    size_t   bytes_consumed;
+    bool     notifying;           ///< True while the client is being notified of incoming data
+    bool     has_arrival_time;    ///< True once a data packet has been received
+    uint32_t last_arrival_time;   ///< Time at which the last data packet was received
+    uint32_t arrival_interval_x8; ///< Smoothed interval between data packets, in 1/8 ms
 } GG_GattlinkInboundPayloadInfo;
 
+/**
+ * Storage for packets received out of order, used when selective acks are enabled.
+ * The slots form a ring: the slot at `base` is for the next expected PSN, the one
+ * after it for the PSN after that, and so on.
+ */
+typedef struct {
+    uint8_t* buffer;                              ///< Storage for `slot_count` slots of `slot_size` bytes
+    size_t   slot_size;                           ///< Max size of a packet payload
+    uint8_t  slot_count;                          ///< Number of slots (0 when not buffering)
+    uint8_t  base;                                ///< Slot of the next expected PSN
+    size_t   sizes[GG_GATTLINK_MAX_REORDER_SLOTS];   ///< Payload size for each slot
+    bool     filled[GG_GATTLINK_MAX_REORDER_SLOTS];  ///< Whether each slot holds a packet
+} GG_GattlinkReorderBuffer;
+
+/**
+ * Round-trip time estimator state, used to compute the retransmission timeout
+ * as specified in RFC 6298 (with Karn's algorithm and exponential backoff).
+ * The smoothed RTT and RTT variance are kept scaled, to avoid losing precision
+ * with short round-trip times.
+ */
+typedef struct {
+    bool     has_sample;               ///< True once an RTT sample has been taken
+    uint32_t smoothed_rtt_x8;          ///< Smoothed RTT, in 1/8 ms
+    uint32_t rtt_variance_x4;          ///< RTT variance, in 1/4 ms
+    uint32_t retransmit_timeout;       ///< Base retransmission timeout, in ms
+    uint8_t  backoff;                  ///< Number of consecutive retransmission timeouts
+    uint32_t rtt_sample_count;         ///< Total number of RTT samples
+    uint32_t retransmit_timeout_count; ///< Total number of retransmission timeouts
+} GG_GattlinkRttEstimator;
+
+typedef struct GG_GattlinkCongestionController GG_GattlinkCongestionController;
+
+/**
+ * Congestion control state.
+ * The congestion window limits the number of packets in the link (the packets in flight
+ * that haven't been selectively acked or marked for retransmission), below the tx window.
+ */
+typedef struct {
+    const GG_GattlinkCongestionController* controller;           ///< Algorithm in use, NULL when disabled
+    uint32_t                               window;               ///< Congestion window, in packets
+    uint32_t                               slow_start_threshold; ///< Slow start threshold, in packets
+    uint32_t                               packets_acked;        ///< Packets acked since the window last grew
+    bool                                   in_recovery;          ///< True until the packets lost are all acked
+    uint8_t                                recovery_sn;          ///< Last PSN sent when the recovery started
+    uint32_t                               base_rtt;             ///< Lowest RTT sample of the session, in ms
+    uint32_t                               round_rtt;            ///< Lowest RTT sample of the current round, in ms
+    uint32_t                               event_count;          ///< Number of times the window was reduced
+} GG_GattlinkCongestionState;
+
+/**
+ * Congestion control algorithm.
+ * The algorithms only differ in how they grow the window as packets are acked, and
+ * how they reduce it when a loss is detected. Retransmission timeouts are always handled
+ * the same way, by restarting from a window of one packet.
+ */
+struct GG_GattlinkCongestionController {
+    //! Called when packets are acked, outside of loss recovery.
+    //! `window_limited` is true when the congestion window was full when the packets were acked.
+    void (*OnAck)(GG_GattlinkProtocol* self, uint32_t packets_acked, bool window_limited);
+
+    //! Called when a loss is detected, at most once per window of packets.
+    void (*OnLoss)(GG_GattlinkProtocol* self);
+};
+
 /**
  * Protocol state
  */
@@ -154,11 +249,17 @@ struct GG_GattlinkProtocol {
     GG_GattlinkState               state;
     GG_GattlinkSessionConfig       desired_session_cfg;
     GG_GattlinkSessionConfig       actual_session_cfg;
+    uint8_t                        version;                  ///< Negotiated protocol version
+    uint32_t                       sn_space_size;            ///< Number of serial numbers for this version
+    uint8_t                        tx_window_limit;          ///< Max packets in flight set by the client (0=none)
     uint32_t                       stall_time;               ///< Stall time in ms
     uint32_t                       last_notified_stall_time; ///< Last notified stall time
 
     GG_GattlinkInboundPayloadInfo  in;
     GG_GattlinkOutboundPayloadInfo out;
+    GG_GattlinkRttEstimator        rtt;
+    GG_GattlinkReorderBuffer       reorder;
+    GG_GattlinkCongestionState     congestion;
 
     GG_THREAD_GUARD_ENABLE_BINDING
 };
@@ -202,9 +303,22 @@ typedef enum {
     GG_GATTLINK_DATA_PACKET_TYPE_WITHOUT_ACK     = 0x00,
     GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK        = 0x40,
     GG_GATTLINK_DATA_PACKET_TYPE_MASK            = 0x40,
+    GG_GATTLINK_DATA_PACKET_TYPE_SELECTIVE_ACK   = 0x20, ///< Set in an ack byte when a bitmap follows
     GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK = 0x1f
 } GG_GattlinkDataPacketType;
 
+/*
+ * With the extended packet format, a data packet always starts with a header byte
+ * carrying the flags above (the PSN bits are 0), followed by the 8-bit ack PSN if
+ * the packet has an ack, the selective ack bitmap if any, and then the 8-bit PSN
+ * of the payload if there is one.
+ */
+
+/*----------------------------------------------------------------------
+|   forward declarations
++---------------------------------------------------------------------*/
+static void GG_GattlinkProtocol_ResetCongestionState(GG_GattlinkProtocol* self);
+
 /*----------------------------------------------------------------------
 |   GG_GattlinkClient thunks
 +---------------------------------------------------------------------*/
@@ -281,6 +395,40 @@ GG_GattlinkClient_NotifySessionStalled(GG_GattlinkClient* self, uint32_t stalled
     GG_INTERFACE(self)->NotifySessionStalled(self, stalled_time);
 }
 
+/*--------------------------------------------------------------------*/
+GG_Result
+GG_GattlinkClient_SendPacket(GG_GattlinkClient* self,
+                             const void*        header,
+                             size_t             header_size,
+                             size_t             payload_offset,
+                             size_t             payload_size)
+{
+    GG_ASSERT(self);
+    GG_ASSERT(header);
+    GG_ASSERT(GG_INTERFACE(self)->SendPacket);
+    return GG_INTERFACE(self)->SendPacket(self, header, header_size, payload_offset, payload_size);
+}
+
+/*--------------------------------------------------------------------*/
+void
+GG_GattlinkClient_BeginPacketBatch(GG_GattlinkClient* self)
+{
+    GG_ASSERT(self);
+    if (GG_INTERFACE(self)->BeginPacketBatch) {
+        GG_INTERFACE(self)->BeginPacketBatch(self);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+void
+GG_GattlinkClient_EndPacketBatch(GG_GattlinkClient* self)
+{
+    GG_ASSERT(self);
+    if (GG_INTERFACE(self)->EndPacketBatch) {
+        GG_INTERFACE(self)->EndPacketBatch(self);
+    }
+}
+
 /*----------------------------------------------------------------------
 |   functions
 +---------------------------------------------------------------------*/
@@ -288,7 +436,7 @@ GG_GattlinkClient_NotifySessionStalled(GG_GattlinkClient* self, uint32_t stalled
 //----------------------------------------------------------------------
 #if defined(GG_CONFIG_ENABLE_LOGGING)
 
-static void LogPacket(int level, char* prefix, const uint8_t* bytes, size_t length)
+static void LogPacket(int level, char* prefix, bool extended, const uint8_t* bytes, size_t length)
 {
     if (level >= _GG_LocalLogger.logger.level) {
         // Check if this is a control packet
@@ -311,12 +459,22 @@ static void LogPacket(int level, char* prefix, const uint8_t* bytes, size_t leng
             snprintf(ack_info,
                      sizeof(ack_info),
                      "Ack: PSN=%d",
-                     bytes[0] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK);
+                     extended ? bytes[1] : bytes[0] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK);
             ack_info[sizeof(ack_info)-1] = 0;
         }
 
         char payload_info[60] = { 0 };
-        uint8_t payload_offset = has_ack ? 1 : 0;
+        uint8_t payload_offset = (has_ack || extended) ? 1 : 0;
+        if (has_ack && extended) {
+            payload_offset += 1;
+        }
+        if (has_ack && (bytes[0] & GG_GATTLINK_DATA_PACKET_TYPE_SELECTIVE_ACK)) {
+            payload_offset += GG_GATTLINK_SELECTIVE_ACK_SIZE;
+        }
+        if (payload_offset > length) {
+            GG_LOG_LL(_GG_LocalLogger, level, "%s truncated packet", prefix);
+            return;
+        }
         size_t payload_size = length - payload_offset;
         if (payload_size > 0) {
             // If there's a payload, it should be at least 2 bytes (PSN + data)
@@ -325,7 +483,9 @@ static void LogPacket(int level, char* prefix, const uint8_t* bytes, size_t leng
             snprintf(payload_info,
                      sizeof(payload_info),
                      "Payload: PSN=%d, Data=0x%02hhx, Size=%d Byte%s %s",
-                     bytes[payload_offset] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK,
+                     extended ?
+                         bytes[payload_offset] :
+                         bytes[payload_offset] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK,
                      bytes[payload_offset+1],
                      (int)payload_size-1,
                      payload_size > 1 ? "s" : "",
@@ -337,11 +497,12 @@ static void LogPacket(int level, char* prefix, const uint8_t* bytes, size_t leng
     }
 }
 
-#define GG_LOG_PACKET(_level, _prefix, _bytes, _length)  LogPacket((_level), (_prefix), (_bytes), (_length))
+#define GG_LOG_PACKET(_level, _prefix, _extended, _bytes, _length) \
+    LogPacket((_level), (_prefix), (_extended), (_bytes), (_length))
 
 #else /* GG_CONFIG_ENABLE_LOGGING */
 
-#define GG_LOG_PACKET(_level, _prefix, _bytes, _length)
+#define GG_LOG_PACKET(_level, _prefix, _extended, _bytes, _length)
 
 #endif /* GG_CONFIG_ENABLE_LOGGING */
 
@@ -353,6 +514,153 @@ GG_GattlinkProtocol_ScheduleTimer(GG_GattlinkProtocol* self, GG_Timer* timer, ui
     return GG_Timer_Schedule(timer, listener, ms_timeout);
 }
 
+//----------------------------------------------------------------------
+// Reset the round-trip time estimate, keeping the counters
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_ResetRttEstimator(GG_GattlinkProtocol* self)
+{
+    self->rtt.has_sample         = false;
+    self->rtt.smoothed_rtt_x8    = 0;
+    self->rtt.rtt_variance_x4    = 0;
+    self->rtt.retransmit_timeout = self->desired_session_cfg.initial_retransmit_timeout;
+    self->rtt.backoff            = 0;
+}
+
+//----------------------------------------------------------------------
+// Update the round-trip time estimate with a new sample (RFC 6298)
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_OnRttSample(GG_GattlinkProtocol* self, uint32_t rtt)
+{
+    GG_GattlinkRttEstimator* estimator = &self->rtt;
+
+    ++estimator->rtt_sample_count;
+    if (!estimator->has_sample) {
+        // first sample: SRTT = R, RTTVAR = R/2
+        estimator->smoothed_rtt_x8 = rtt << 3;
+        estimator->rtt_variance_x4 = rtt << 1;
+        estimator->has_sample      = true;
+    } else {
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+        int32_t delta = (int32_t)rtt - (int32_t)(estimator->smoothed_rtt_x8 >> 3);
+        uint32_t abs_delta = (uint32_t)(delta < 0 ? -delta : delta);
+        estimator->rtt_variance_x4 = estimator->rtt_variance_x4 - (estimator->rtt_variance_x4 >> 2) + abs_delta;
+        estimator->smoothed_rtt_x8 = (uint32_t)((int32_t)estimator->smoothed_rtt_x8 + delta);
+    }
+
+    // RTO = SRTT + 4 * RTTVAR, within the configured bounds
+    uint32_t timeout = (estimator->smoothed_rtt_x8 >> 3) + estimator->rtt_variance_x4;
+    timeout = GG_MAX(timeout, self->desired_session_cfg.min_retransmit_timeout);
+    timeout = GG_MIN(timeout, self->desired_session_cfg.max_retransmit_timeout);
+    estimator->retransmit_timeout = timeout;
+
+    // we got a valid sample, so we can stop backing off
+    estimator->backoff = 0;
+
+    GG_LOG_FINEST("RTT sample: %u ms, SRTT=%u, RTO=%u",
+                  (int)rtt, (int)(estimator->smoothed_rtt_x8 >> 3), (int)timeout);
+}
+
+//----------------------------------------------------------------------
+// Get the timeout to use for the retransmission timer, including backoff
+//----------------------------------------------------------------------
+static uint32_t
+GG_GattlinkProtocol_GetRetransmitTimeout(GG_GattlinkProtocol* self)
+{
+    uint32_t max_timeout = self->desired_session_cfg.max_retransmit_timeout;
+    uint32_t timeout = self->rtt.retransmit_timeout;
+    for (unsigned int i = 0; i < self->rtt.backoff && timeout < max_timeout; i++) {
+        timeout *= 2;
+    }
+
+    return GG_MIN(timeout, max_timeout);
+}
+
+//----------------------------------------------------------------------
+// Get the time to wait before ack'ing received data.
+// We wait for roughly two packets worth of time, based on the recent
+// arrival rate, so that acks can be coalesced when data is streaming,
+// without ever waiting longer than the configured max.
+//----------------------------------------------------------------------
+static uint32_t
+GG_GattlinkProtocol_GetAckDelay(GG_GattlinkProtocol* self)
+{
+    uint32_t max_delay = self->desired_session_cfg.max_ack_delay;
+    if (self->in.arrival_interval_x8 == 0) {
+        return max_delay;
+    }
+
+    uint32_t delay = (self->in.arrival_interval_x8 >> 3) * 2;
+    delay = GG_MAX(delay, GG_GATTLINK_MIN_ACK_DELAY);
+    return GG_MIN(delay, max_delay);
+}
+
+//----------------------------------------------------------------------
+// Update the smoothed inter-arrival time of data packets
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_OnDataArrival(GG_GattlinkProtocol* self)
+{
+    uint32_t now = GG_TimerScheduler_GetTime(self->scheduler);
+    if (self->in.has_arrival_time) {
+        // idle periods are capped so that they don't dominate the average
+        uint32_t interval = GG_MIN(now - self->in.last_arrival_time, self->desired_session_cfg.max_ack_delay);
+        if (self->in.arrival_interval_x8 == 0) {
+            self->in.arrival_interval_x8 = GG_MAX(interval << 3, 1);
+        } else {
+            self->in.arrival_interval_x8 = self->in.arrival_interval_x8 -
+                                           (self->in.arrival_interval_x8 >> 3) +
+                                           interval;
+        }
+    }
+    self->in.has_arrival_time  = true;
+    self->in.last_arrival_time = now;
+}
+
+//----------------------------------------------------------------------
+static bool
+GG_GattlinkProtocol_SelectiveAckEnabled(GG_GattlinkProtocol* self)
+{
+    return self->version >= GG_GATTLINK_VERSION_SELECTIVE_ACK;
+}
+
+//----------------------------------------------------------------------
+static bool
+GG_GattlinkProtocol_ExtendedFormatEnabled(GG_GattlinkProtocol* self)
+{
+    return self->version >= GG_GATTLINK_VERSION_EXTENDED_FORMAT;
+}
+
+//----------------------------------------------------------------------
+// Release the reorder buffer, and allocate a new one if the session
+// uses selective acks
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_ResetReorderBuffer(GG_GattlinkProtocol* self)
+{
+    if (self->reorder.buffer) {
+        GG_FreeMemory(self->reorder.buffer);
+    }
+    memset(&self->reorder, 0, sizeof(self->reorder));
+
+    // (the rx window is already capped to what the packet format allows with selective acks)
+    uint8_t slot_count = GG_MIN(self->actual_session_cfg.max_rx_window_size, GG_GATTLINK_MAX_REORDER_SLOTS);
+    if (!GG_GattlinkProtocol_SelectiveAckEnabled(self) || slot_count < 2) {
+        return;
+    }
+
+    size_t slot_size = GG_MIN(GG_GattlinkClient_GetTransportMaxPacketSize(self->client), GG_GATTLINK_MAX_PACKET_SIZE);
+    self->reorder.buffer = (uint8_t*)GG_AllocateMemory(slot_size * slot_count);
+    if (self->reorder.buffer == NULL) {
+        // not fatal, out of order packets will just be dropped
+        GG_LOG_WARNING("not enough memory for the reorder buffer");
+        return;
+    }
+    self->reorder.slot_size  = slot_size;
+    self->reorder.slot_count = slot_count;
+}
+
 //----------------------------------------------------------------------
 static uint8_t
 GG_GattlinkProtocol_BuildControlPacket(GG_GattlinkControlPacketType type)
@@ -396,7 +704,7 @@ GG_GattlinkProtocol_UnscheduleTimers(GG_GattlinkProtocol* self)
 static GG_Result
 GG_GattlinkProtocol_SendRawData(GG_GattlinkProtocol* self, const void* buffer, size_t size)
 {
-    GG_LOG_PACKET(GG_LOG_LEVEL_FINEST, "Sending", buffer, size);
+    GG_LOG_PACKET(GG_LOG_LEVEL_FINEST, "Sending", GG_GattlinkProtocol_ExtendedFormatEnabled(self), buffer, size);
     return GG_GattlinkClient_SendRawData(self->client, buffer, size);
 }
 
@@ -508,11 +816,39 @@ GG_GattlinkProtocol_HandleResetComplete(GG_GattlinkProtocol* self,
     const GG_GattlinkResetCompletePacket* pkt = (const GG_GattlinkResetCompletePacket*)rx_raw_data;
     // TODO: Version Check - Should we add a way to communicate that a reset failed?
 
+    // Use the highest version we both support (version 0 is supported by all peers)
+    self->version = GG_MIN(GG_GATTLINK_MAX_VERSION, pkt->gattlink_max_version);
+    if (self->version < pkt->gattlink_min_version) {
+        GG_LOG_WARNING("peer requires version %d or above, we only support up to %d",
+                       (int)pkt->gattlink_min_version, (int)GG_GATTLINK_MAX_VERSION);
+    }
+
+    // The packet format, and thus the max window size, depends on the version.
+    // With selective acks, the receiver must be able to tell a packet ahead of the one it
+    // expects from a retransmission, so the window can't be more than half the PSN space.
+    uint8_t max_window_size;
+    if (GG_GattlinkProtocol_ExtendedFormatEnabled(self)) {
+        self->sn_space_size = GG_GATTLINK_EXTENDED_SN_SPACE_SIZE;
+        max_window_size     = GG_GATTLINK_MAX_WINDOW_SIZE;
+    } else if (GG_GattlinkProtocol_SelectiveAckEnabled(self)) {
+        self->sn_space_size = GG_GATTLINK_SN_SPACE_SIZE;
+        max_window_size     = GG_GATTLINK_SN_SPACE_SIZE / 2;
+    } else {
+        self->sn_space_size = GG_GATTLINK_SN_SPACE_SIZE;
+        max_window_size     = GG_GATTLINK_SN_SPACE_SIZE - 1;
+    }
+
     // Window sizes
     GG_GattlinkSessionConfig* actual_cfg = &self->actual_session_cfg;
     GG_GattlinkSessionConfig* desired_cfg = &self->desired_session_cfg;
     actual_cfg->max_tx_window_size = GG_MIN(desired_cfg->max_tx_window_size, pkt->max_rx_window_size);
+    actual_cfg->max_tx_window_size = GG_MIN(actual_cfg->max_tx_window_size, max_window_size);
     actual_cfg->max_rx_window_size = GG_MIN(desired_cfg->max_rx_window_size, pkt->max_tx_window_size);
+    actual_cfg->max_rx_window_size = GG_MIN(actual_cfg->max_rx_window_size, max_window_size);
+    GG_LOG_FINE("session version: %d, tx window: %d, rx window: %d",
+                (int)self->version,
+                (int)actual_cfg->max_tx_window_size,
+                (int)actual_cfg->max_rx_window_size);
 
     if (self->state == GG_GATTLINK_STATE_AWAITING_RESET_COMPLETE_SELF_INITIATED) {
         // We sent a 'reset request', and have now gotten a 'reset complete' from the peer.
@@ -526,6 +862,12 @@ GG_GattlinkProtocol_HandleResetComplete(GG_GattlinkProtocol* self,
     GG_GattlinkProtocol_DestroyTimers(self);
     memset(&self->out, 0x0, sizeof(self->out));
     memset(&self->in, 0x0, sizeof(self->in));
+    GG_GattlinkProtocol_ResetRttEstimator(self);
+    GG_GattlinkProtocol_ResetReorderBuffer(self);
+    GG_GattlinkProtocol_ResetCongestionState(self);
+
+    // Nothing has been received yet, so an ack for the PSN before the first one acks nothing
+    self->out.psn_to_ack_with = (uint8_t)(self->sn_space_size - 1);
     GG_GattlinkProtocol_CreateTimers(self);
 
     self->state = GG_GATTLINK_STATE_READY;
@@ -570,21 +912,33 @@ GG_GattlinkProtocol_HandleControlPacket(GG_GattlinkProtocol*         self,
 static void
 GG_GattlinkProtocol_SetPayloadSize(GG_GattlinkProtocol* self, uint32_t sn, size_t payload_size)
 {
-    self->out.payload_sizes[sn] = payload_size;
+    self->out.payload_sizes[GG_GATTLINK_SN_SLOT(sn)] = payload_size;
 }
 
 //----------------------------------------------------------------------
 static uint32_t
-GG_GattlinkProtocol_CalculateDistance(uint8_t sn_begin_incl, uint32_t sn_end_excl)
+GG_GattlinkProtocol_CalculateDistance(GG_GattlinkProtocol* self, uint8_t sn_begin_incl, uint32_t sn_end_excl)
 {
-    return ((uint32_t) GG_GATTLINK_SN_WINDOW_SIZE + sn_end_excl - sn_begin_incl) % GG_GATTLINK_SN_WINDOW_SIZE;
+    return (self->sn_space_size + sn_end_excl - sn_begin_incl) % self->sn_space_size;
 }
 
 //----------------------------------------------------------------------
 static uint8_t
-GG_GattlinkProtocol_GetNextSn(uint32_t current_sn)
+GG_GattlinkProtocol_GetNextSn(GG_GattlinkProtocol* self, uint32_t current_sn)
 {
-    return (current_sn + 1) % GG_GATTLINK_SN_WINDOW_SIZE;
+    return (uint8_t)((current_sn + 1) % self->sn_space_size);
+}
+
+//----------------------------------------------------------------------
+static uint32_t
+GG_GattlinkProtocol_GetTxWindowSizeInternal(GG_GattlinkProtocol* self)
+{
+    uint32_t window_size = self->actual_session_cfg.max_tx_window_size;
+    if (self->tx_window_limit) {
+        window_size = GG_MIN(window_size, self->tx_window_limit);
+    }
+
+    return window_size;
 }
 
 //----------------------------------------------------------------------
@@ -592,23 +946,30 @@ GG_GattlinkProtocol_GetNextSn(uint32_t current_sn)
 static uint32_t
 GG_GattlinkProtocol_GetNumPacketsInFlight(GG_GattlinkProtocol* self)
 {
-    return GG_GattlinkProtocol_CalculateDistance(self->out.next_expected_ack_sn, self->out.next_data_sn);
+    return GG_GattlinkProtocol_CalculateDistance(self, self->out.next_expected_ack_sn, self->out.next_data_sn);
 }
 
 //----------------------------------------------------------------------
 static size_t
 GG_GattlinkProtocol_GetPayloadSize(GG_GattlinkProtocol* self, uint32_t sn)
 {
-    return self->out.payload_sizes[sn];
+    return self->out.payload_sizes[GG_GATTLINK_SN_SLOT(sn)];
 }
 
 //----------------------------------------------------------------------
-// Returns `true` if the packet is awaiting an ACK
+// Returns `true` if the packet is awaiting an ACK.
+// The per-packet state only covers one window past the next expected ack,
+// anything else (like a stale ack) can't be awaiting an ACK.
 //----------------------------------------------------------------------
 static size_t
 GG_GattlinkProtocol_PacketIsAwaitingAck(GG_GattlinkProtocol* self, uint32_t sn)
 {
-    return self->out.payload_sizes[sn] != 0;
+    if (GG_GattlinkProtocol_CalculateDistance(self, self->out.next_expected_ack_sn, sn) >=
+        GG_GATTLINK_MAX_WINDOW_SIZE) {
+        return false;
+    }
+
+    return self->out.payload_sizes[GG_GATTLINK_SN_SLOT(sn)] != 0;
 }
 
 //----------------------------------------------------------------------
@@ -618,7 +979,7 @@ GG_GattlinkProtocol_GetTotalNumBytesAwaitingAckUpTo(GG_GattlinkProtocol* self, u
     size_t num_bytes = 0;
     for (uint32_t sn = self->out.next_expected_ack_sn;
          sn != sn_end_excl;
-         sn = GG_GattlinkProtocol_GetNextSn(sn)) {
+         sn = GG_GattlinkProtocol_GetNextSn(self, sn)) {
         num_bytes += GG_GattlinkProtocol_GetPayloadSize(self, sn);
     }
     return num_bytes;
@@ -637,19 +998,484 @@ ClearPayloadSizesUpTo(GG_GattlinkProtocol* self, uint32_t sn_end_excl)
 {
     for (uint32_t sn = self->out.next_expected_ack_sn;
          sn != sn_end_excl;
-         sn = GG_GattlinkProtocol_GetNextSn(sn)) {
+         sn = GG_GattlinkProtocol_GetNextSn(self, sn)) {
         GG_GattlinkProtocol_SetPayloadSize(self, sn, 0);
+        self->out.selectively_acked[GG_GATTLINK_SN_SLOT(sn)] = false;
+        self->out.retransmit_needed[GG_GATTLINK_SN_SLOT(sn)] = false;
+    }
+}
+
+//----------------------------------------------------------------------
+// Get the first in-flight packet that needs to be retransmitted, if any.
+//----------------------------------------------------------------------
+static bool
+GG_GattlinkProtocol_GetNextRetransmission(GG_GattlinkProtocol* self, uint8_t* sn)
+{
+    for (uint32_t i = self->out.next_expected_ack_sn;
+         i != self->out.next_data_sn;
+         i = GG_GattlinkProtocol_GetNextSn(self, i)) {
+        if (self->out.retransmit_needed[GG_GATTLINK_SN_SLOT(i)]) {
+            *sn = (uint8_t)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+// Get the number of packets that are still in the link: the packets in flight,
+// except the ones that the peer reported as received out of order and the
+// ones considered lost (the "pipe" of RFC 6675)
+//----------------------------------------------------------------------
+static uint32_t
+GG_GattlinkProtocol_GetNumPacketsInLink(GG_GattlinkProtocol* self)
+{
+    uint32_t count = 0;
+    for (uint32_t sn = self->out.next_expected_ack_sn;
+         sn != self->out.next_data_sn;
+         sn = GG_GattlinkProtocol_GetNextSn(self, sn)) {
+        uint32_t slot = GG_GATTLINK_SN_SLOT(sn);
+        if (!self->out.selectively_acked[slot] && !self->out.retransmit_needed[slot]) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+//----------------------------------------------------------------------
+// Returns `true` if congestion control allows one more packet to be sent.
+//----------------------------------------------------------------------
+static bool
+GG_GattlinkProtocol_CongestionWindowIsOpen(GG_GattlinkProtocol* self)
+{
+    if (self->congestion.controller == NULL) {
+        return true;
+    }
+
+    return GG_GattlinkProtocol_GetNumPacketsInLink(self) < self->congestion.window;
+}
+
+//----------------------------------------------------------------------
+// Set the congestion window, within [1, tx window]
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_SetCongestionWindow(GG_GattlinkProtocol* self, uint32_t window)
+{
+    window = GG_MAX(window, 1);
+    window = GG_MIN(window, self->actual_session_cfg.max_tx_window_size);
+    if (window != self->congestion.window) {
+        GG_LOG_FINER("congestion window: %u -> %u (ssthresh=%u)",
+                     (int)self->congestion.window, (int)window, (int)self->congestion.slow_start_threshold);
+        self->congestion.window = window;
+    }
+}
+
+//----------------------------------------------------------------------
+// Set the slow start threshold to a fraction of a number of packets
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_SetSlowStartThreshold(GG_GattlinkProtocol* self, uint32_t packets, uint32_t num, uint32_t den)
+{
+    self->congestion.slow_start_threshold = GG_MAX((packets * num) / den, GG_GATTLINK_MIN_SLOW_START_THRESHOLD);
+}
+
+//----------------------------------------------------------------------
+// AIMD: slow start up to the threshold, then one more packet per window acked
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_AimdOnAck(GG_GattlinkProtocol* self, uint32_t packets_acked, bool window_limited)
+{
+    GG_GattlinkCongestionState* congestion = &self->congestion;
+
+    // don't grow the window when we're not using it (RFC 7661)
+    if (!window_limited) {
+        return;
+    }
+
+    if (congestion->window < congestion->slow_start_threshold) {
+        GG_GattlinkProtocol_SetCongestionWindow(self,
+                                                GG_MIN(congestion->window + packets_acked,
+                                                       congestion->slow_start_threshold));
+    } else {
+        congestion->packets_acked += packets_acked;
+        if (congestion->packets_acked >= congestion->window) {
+            congestion->packets_acked -= congestion->window;
+            GG_GattlinkProtocol_SetCongestionWindow(self, congestion->window + 1);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// AIMD: halve the window on loss (RFC 5681)
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_AimdOnLoss(GG_GattlinkProtocol* self)
+{
+    GG_GattlinkProtocol_SetSlowStartThreshold(self, GG_GattlinkProtocol_GetNumPacketsInFlight(self), 1, 2);
+    GG_GattlinkProtocol_SetCongestionWindow(self, self->congestion.slow_start_threshold);
+}
+
+//----------------------------------------------------------------------
+// Delay-based (TCP Vegas style): once per round-trip, estimate the number of
+// packets queued in the link from how much the RTT exceeds the lowest one
+// measured, and adjust the window to keep that number small.
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_DelayOnAck(GG_GattlinkProtocol* self, uint32_t packets_acked, bool window_limited)
+{
+    GG_GattlinkCongestionState* congestion = &self->congestion;
+
+    // a round ends when a window's worth of packets has been acked
+    uint32_t rtt = 0;
+    congestion->packets_acked += packets_acked;
+    if (congestion->packets_acked >= congestion->window) {
+        rtt = congestion->round_rtt;
+        congestion->packets_acked = 0;
+        congestion->round_rtt     = 0;
+    }
+
+    // queued = window * (RTT - base RTT) / RTT
+    uint32_t queued = 0;
+    if (rtt) {
+        queued = (congestion->window * (rtt - congestion->base_rtt)) / rtt;
+        GG_LOG_FINEST("delay control: RTT=%u, base RTT=%u, queued=%u",
+                      (int)rtt, (int)congestion->base_rtt, (int)queued);
+    }
+
+    if (congestion->window < congestion->slow_start_threshold) {
+        // slow start until the link starts queuing, then back off to what it can carry
+        if (queued > GG_GATTLINK_DELAY_CONTROL_MIN_QUEUED) {
+            GG_GattlinkProtocol_SetCongestionWindow(self, congestion->window - queued);
+            congestion->slow_start_threshold = congestion->window;
+        } else if (window_limited) {
+            GG_GattlinkProtocol_SetCongestionWindow(self, congestion->window + packets_acked);
+        }
+        return;
+    }
+
+    if (rtt == 0) {
+        return;
+    }
+    if (queued < GG_GATTLINK_DELAY_CONTROL_MIN_QUEUED) {
+        if (window_limited) {
+            GG_GattlinkProtocol_SetCongestionWindow(self, congestion->window + 1);
+        }
+    } else if (queued > GG_GATTLINK_DELAY_CONTROL_MAX_QUEUED) {
+        GG_GattlinkProtocol_SetCongestionWindow(self, congestion->window - 1);
+    }
+}
+
+//----------------------------------------------------------------------
+// Delay-based: a loss means the queues are already full, reduce the
+// window less than AIMD would, since the delay control keeps it close to
+// what the link can carry
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_DelayOnLoss(GG_GattlinkProtocol* self)
+{
+    GG_GattlinkProtocol_SetSlowStartThreshold(self, self->congestion.window, 3, 4);
+    GG_GattlinkProtocol_SetCongestionWindow(self, self->congestion.slow_start_threshold);
+}
+
+//----------------------------------------------------------------------
+static const GG_GattlinkCongestionController GG_GattlinkAimdCongestionController = {
+    .OnAck  = GG_GattlinkProtocol_AimdOnAck,
+    .OnLoss = GG_GattlinkProtocol_AimdOnLoss
+};
+
+//----------------------------------------------------------------------
+static const GG_GattlinkCongestionController GG_GattlinkDelayCongestionController = {
+    .OnAck  = GG_GattlinkProtocol_DelayOnAck,
+    .OnLoss = GG_GattlinkProtocol_DelayOnLoss
+};
+
+//----------------------------------------------------------------------
+// Reset the congestion control state at the start of a session
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_ResetCongestionState(GG_GattlinkProtocol* self)
+{
+    GG_GattlinkCongestionState* congestion = &self->congestion;
+    uint32_t event_count = congestion->event_count;
+    memset(congestion, 0, sizeof(*congestion));
+    congestion->event_count = event_count;
+
+    switch (self->desired_session_cfg.congestion_control) {
+        case GG_GATTLINK_CONGESTION_CONTROL_AIMD:
+            congestion->controller = &GG_GattlinkAimdCongestionController;
+            break;
+
+        case GG_GATTLINK_CONGESTION_CONTROL_DELAY:
+            congestion->controller = &GG_GattlinkDelayCongestionController;
+            break;
+
+        default:
+            return;
+    }
+
+    congestion->slow_start_threshold = self->actual_session_cfg.max_tx_window_size;
+    GG_GattlinkProtocol_SetCongestionWindow(self, GG_GATTLINK_INITIAL_CONGESTION_WINDOW);
+}
+
+//----------------------------------------------------------------------
+// Called when new packets are acked, before they are removed from the
+// packets in flight.
+// `rtt` is the RTT sample taken with this ack, or 0 if there isn't one.
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_OnCongestionAck(GG_GattlinkProtocol* self, uint32_t packets_acked, uint32_t rtt)
+{
+    GG_GattlinkCongestionState* congestion = &self->congestion;
+    if (congestion->controller == NULL) {
+        return;
+    }
+
+    if (rtt) {
+        congestion->base_rtt  = congestion->base_rtt  ? GG_MIN(congestion->base_rtt, rtt)  : rtt;
+        congestion->round_rtt = congestion->round_rtt ? GG_MIN(congestion->round_rtt, rtt) : rtt;
+    }
+
+    // the window doesn't grow until all the packets that were in flight when the loss
+    // was detected are acked
+    if (congestion->in_recovery) {
+        uint32_t distance = GG_GattlinkProtocol_CalculateDistance(self,
+                                                                  self->out.next_expected_ack_sn,
+                                                                  congestion->recovery_sn);
+        if (distance < packets_acked) {
+            GG_LOG_FINER("loss recovery complete");
+            congestion->in_recovery = false;
+        }
+        return;
+    }
+
+    bool window_limited = (GG_GattlinkProtocol_GetNumPacketsInLink(self) >= congestion->window);
+    congestion->controller->OnAck(self, packets_acked, window_limited);
+}
+
+//----------------------------------------------------------------------
+// Called when packets are found to be lost, without waiting for the
+// retransmission timer
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_OnCongestionLoss(GG_GattlinkProtocol* self)
+{
+    GG_GattlinkCongestionState* congestion = &self->congestion;
+    if (congestion->controller == NULL || congestion->in_recovery) {
+        return;
+    }
+
+    // react only once for all the losses in the current window
+    congestion->in_recovery   = true;
+    congestion->recovery_sn   = (uint8_t)((self->out.next_data_sn + self->sn_space_size - 1) % self->sn_space_size);
+    congestion->packets_acked = 0;
+    ++congestion->event_count;
+    congestion->controller->OnLoss(self);
+}
+
+//----------------------------------------------------------------------
+// Called when the retransmission timer expires, before the packets in
+// flight are rolled back or marked for retransmission: restart with a
+// window of one packet (RFC 5681)
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_OnCongestionTimeout(GG_GattlinkProtocol* self)
+{
+    GG_GattlinkCongestionState* congestion = &self->congestion;
+    if (congestion->controller == NULL) {
+        return;
+    }
+
+    ++congestion->event_count;
+    GG_GattlinkProtocol_SetSlowStartThreshold(self, GG_GattlinkProtocol_GetNumPacketsInFlight(self), 1, 2);
+    GG_GattlinkProtocol_SetCongestionWindow(self, 1);
+    congestion->in_recovery   = false;
+    congestion->packets_acked = 0;
+    congestion->round_rtt     = 0;
+}
+
+//----------------------------------------------------------------------
+// Called when the peer reports packets that it received out of order.
+// Bit N of the bitmap is set when the peer has the packet N+2 PSNs after
+// the acked one (the packet right after the acked one is always missing).
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_OnSelectiveAck(GG_GattlinkProtocol* self, uint8_t ackd_psn, uint32_t bitmap)
+{
+    uint32_t in_flight = GG_GattlinkProtocol_GetNumPacketsInFlight(self);
+    uint32_t highest_distance = 0;
+    uint32_t sn = GG_GattlinkProtocol_GetNextSn(self, GG_GattlinkProtocol_GetNextSn(self, ackd_psn));
+    for (; bitmap; bitmap >>= 1, sn = GG_GattlinkProtocol_GetNextSn(self, sn)) {
+        if ((bitmap & 1) == 0) {
+            continue;
+        }
+
+        // ignore anything that isn't in flight (stale ack)
+        uint32_t distance = GG_GattlinkProtocol_CalculateDistance(self, self->out.next_expected_ack_sn, sn);
+        if (distance >= in_flight) {
+            continue;
+        }
+        self->out.selectively_acked[GG_GATTLINK_SN_SLOT(sn)] = true;
+        highest_distance = GG_MAX(highest_distance, distance + 1);
+    }
+
+    // The packets sent before the last one received by the peer, and that the peer doesn't have,
+    // are most likely lost: retransmit them right away, but only once (after that, we rely on the
+    // retransmission timer)
+    bool loss = false;
+    sn = self->out.next_expected_ack_sn;
+    for (uint32_t i = 0; i < highest_distance; i++, sn = GG_GattlinkProtocol_GetNextSn(self, sn)) {
+        uint32_t slot = GG_GATTLINK_SN_SLOT(sn);
+        if (!self->out.selectively_acked[slot] && !self->out.retransmitted[slot] &&
+            !self->out.retransmit_needed[slot]) {
+            GG_LOG_FINER("PSN %d missing, will retransmit", (int)sn);
+            self->out.retransmit_needed[slot] = true;
+            loss = true;
+        }
+    }
+
+    if (loss) {
+        GG_GattlinkProtocol_OnCongestionLoss(self);
+    }
+}
+
+//----------------------------------------------------------------------
+// Get the bitmap of packets received out of order, in the format
+// described in GG_GattlinkProtocol_OnSelectiveAck
+//----------------------------------------------------------------------
+static uint32_t
+GG_GattlinkProtocol_GetSelectiveAckBitmap(GG_GattlinkProtocol* self)
+{
+    const GG_GattlinkReorderBuffer* reorder = &self->reorder;
+    uint32_t bitmap = 0;
+    for (unsigned int distance = 1; distance < reorder->slot_count; distance++) {
+        if (reorder->filled[(reorder->base + distance) % reorder->slot_count]) {
+            bitmap |= (uint32_t)1 << (distance - 1);
+        }
+    }
+
+    return bitmap;
+}
+
+//----------------------------------------------------------------------
+// Store a packet received ahead of the next expected one.
+// Returns `true` if the packet is (or was already) buffered.
+//----------------------------------------------------------------------
+static bool
+GG_GattlinkProtocol_BufferOutOfOrderPacket(GG_GattlinkProtocol* self,
+                                           uint8_t              psn,
+                                           const uint8_t*       payload,
+                                           size_t               payload_size)
+{
+    GG_GattlinkReorderBuffer* reorder = &self->reorder;
+    uint32_t distance = GG_GattlinkProtocol_CalculateDistance(self, self->in.next_expected_data_psn, psn);
+    if (distance >= reorder->slot_count || payload_size > reorder->slot_size) {
+        return false;
+    }
+
+    uint8_t slot = (uint8_t)((reorder->base + distance) % reorder->slot_count);
+    if (!reorder->filled[slot]) {
+        memcpy(&reorder->buffer[slot * reorder->slot_size], payload, payload_size);
+        reorder->sizes[slot]  = payload_size;
+        reorder->filled[slot] = true;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_AdvanceExpectedPsn(GG_GattlinkProtocol* self)
+{
+    self->in.next_expected_data_psn = GG_GattlinkProtocol_GetNextSn(self, self->in.next_expected_data_psn);
+    if (self->reorder.slot_count) {
+        self->reorder.base = (uint8_t)((self->reorder.base + 1) % self->reorder.slot_count);
+    }
+}
+
+//----------------------------------------------------------------------
+// Count a received packet as needing an ack, and (re)schedule the ack timer
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_ScheduleAck(GG_GattlinkProtocol* self)
+{
+    // Increment the number of unacked packets
+    self->out.outstanding_unacked_packets++;
+    GG_LOG_FINEST("%u unacked packets", (int)self->out.outstanding_unacked_packets);
+
+    // Schedule the ack timer
+    GG_Result result = GG_Timer_Schedule(self->out.ack_timer,
+                                         GG_CAST(self, GG_TimerListener),
+                                         GG_GattlinkProtocol_GetAckDelay(self));
+    GG_COMPILER_UNUSED(result); // needed to remove warning if GG_ASSERT is compiled out below
+    GG_ASSERT(GG_SUCCEEDED(result));
+}
+
+//----------------------------------------------------------------------
+// Move the next expected packet from the reorder buffer to the payload
+// buffer, if we have it.
+// Returns `true` if a packet was moved.
+//----------------------------------------------------------------------
+static bool
+GG_GattlinkProtocol_PromoteBufferedPacket(GG_GattlinkProtocol* self)
+{
+    GG_GattlinkReorderBuffer* reorder = &self->reorder;
+    if (reorder->slot_count == 0 || !reorder->filled[reorder->base]) {
+        return false;
+    }
+
+    GG_ASSERT(!self->in.payload_buffer_full);
+    memcpy(&self->in.payload_buf[0],
+           &reorder->buffer[reorder->base * reorder->slot_size],
+           reorder->sizes[reorder->base]);
+    self->in.payload_len         = reorder->sizes[reorder->base];
+    self->in.bytes_consumed      = 0;
+    self->in.payload_buffer_full = true;
+    reorder->filled[reorder->base] = false;
+
+    uint8_t psn = self->in.next_expected_data_psn;
+    GG_GattlinkProtocol_AdvanceExpectedPsn(self);
+    GG_LOG_FINER("Delivering buffered PSN: %d, Next expected PSN: %d", (int)psn, (int)self->in.next_expected_data_psn);
+
+    // the packet is now in sequence, so it can be acked
+    self->out.psn_to_ack_with = psn;
+    GG_GattlinkProtocol_ScheduleAck(self);
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Notify the client that data is available, and keep delivering packets
+// from the reorder buffer for as long as the client consumes them.
+//----------------------------------------------------------------------
+static void
+GG_GattlinkProtocol_NotifyIncomingData(GG_GattlinkProtocol* self)
+{
+    if (self->in.notifying) {
+        // we're being called from within the client, the outer call will take care of it
+        return;
     }
+
+    self->in.notifying = true;
+    do {
+        GG_GattlinkClient_NotifyIncomingDataAvailable(self->client);
+    } while (!self->in.payload_buffer_full && GG_GattlinkProtocol_PromoteBufferedPacket(self));
+    self->in.notifying = false;
 }
 
 //----------------------------------------------------------------------
 // Prepare the next packet to send, if any.
+// Only the header is written to the send buffer: when the packet has a payload,
+// its location in the client's outgoing data is returned instead.
 // Returns `true` if there is something to send, or `false` if not.
 //----------------------------------------------------------------------
 static bool
 GG_GattlinkProtocol_PrepareNextPacket(GG_GattlinkProtocol* self,
                                       uint8_t**            send_bufp,
                                       size_t*              buf_len,
+                                      uint8_t*             payload_psn,
+                                      size_t*              payload_offset,
                                       size_t*              payload_size)
 {
     size_t max_packet_size = GG_MIN(GG_GattlinkClient_GetTransportMaxPacketSize(self->client),
@@ -668,54 +1494,106 @@ GG_GattlinkProtocol_PrepareNextPacket(GG_GattlinkProtocol* self,
     *buf_len = 0;
     *payload_size = 0;
 
+    // With the extended format, there's always a header byte before the PSNs
+    bool extended = GG_GattlinkProtocol_ExtendedFormatEnabled(self);
+    if (extended) {
+        *send_buf = GG_GATTLINK_DATA_PACKET_TYPE_WITHOUT_ACK;
+        max_packet_size -= 1;
+        send_buf++;
+    }
+
     if (ack_now) {
-        *send_buf = GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK;
-        *send_buf |= self->out.psn_to_ack_with;
+        if (extended) {
+            (*send_bufp)[0] = GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK;
+            *send_buf = self->out.psn_to_ack_with;
+        } else {
+            *send_buf = GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK;
+            *send_buf |= self->out.psn_to_ack_with;
+        }
         max_packet_size -= 1;
         // for now, we will assume only an ACK is being sent. If we find out otherwise,
         // we will update accordingly below
-        *buf_len += 1;
+        *buf_len = (size_t)(send_buf + 1 - *send_bufp);
         send_buf++;
-    }
 
-    // do we have available windows for data too?
-    if (GG_GattlinkProtocol_GetNumPacketsInFlight(self) >= self->actual_session_cfg.max_tx_window_size) {
-        return ack_now; // nope, just send the ack if there is one
+        // Report the packets we received out of order, if any
+        uint32_t selective_ack = GG_GattlinkProtocol_GetSelectiveAckBitmap(self);
+        if (selective_ack) {
+            (*send_bufp)[0] |= GG_GATTLINK_DATA_PACKET_TYPE_SELECTIVE_ACK;
+            GG_BytesFromInt32Be(send_buf, selective_ack);
+            max_packet_size -= GG_GATTLINK_SELECTIVE_ACK_SIZE;
+            *buf_len += GG_GATTLINK_SELECTIVE_ACK_SIZE;
+            send_buf += GG_GATTLINK_SELECTIVE_ACK_SIZE;
+        }
     }
 
-    size_t data_to_send = GG_GattlinkClient_GetOutgoingDataAvailable(self->client);
-    if (data_to_send == 0) { // no data to send
+    // we need room for at least the PSN and one byte of data
+    if (max_packet_size < 2) {
         return ack_now;
     }
 
-    size_t offset = GG_GattlinkProtocol_GetTotalNumBytesAwaitingAck(self);
+    uint8_t sn;
+    size_t  offset;
+    size_t  data_size;
+    if (!GG_GattlinkProtocol_CongestionWindowIsOpen(self)) {
+        return ack_now; // the link can't take more packets for now
+    }
+    if (GG_GattlinkProtocol_GetNextRetransmission(self, &sn)) {
+        // Selective retransmission of a packet that is already in flight, with the same
+        // fragmentation as the previous transmission
+        offset    = GG_GattlinkProtocol_GetTotalNumBytesAwaitingAckUpTo(self, sn);
+        data_size = GG_GattlinkProtocol_GetPayloadSize(self, sn);
+    } else {
+        // do we have available windows for data too?
+        if (GG_GattlinkProtocol_GetNumPacketsInFlight(self) >= GG_GattlinkProtocol_GetTxWindowSizeInternal(self)) {
+            return ack_now; // nope, just send the ack if there is one
+        }
 
-    // If retransmitting, we need to use the same fragmentation as the previous transmission.
-    // The payload_sizes field will still contain the previously used size, unless it was zero'ed
-    // out because it got ack'd.
-    size_t data_size = GG_GattlinkProtocol_GetPayloadSize(self, self->out.next_data_sn);
-    if (data_size == 0) {
-        GG_ASSERT(data_to_send >= offset);
-        data_size = data_to_send - offset;
-        if (data_size == 0) {
-            // All the data we have to send is already in flight
+        size_t data_to_send = GG_GattlinkClient_GetOutgoingDataAvailable(self->client);
+        if (data_to_send == 0) { // no data to send
             return ack_now;
         }
 
-        // Cap the size to the max of what the transport allows - 1 for the header itself:
-        data_size = GG_MIN(data_size, max_packet_size - 1);
+        sn     = self->out.next_data_sn;
+        offset = GG_GattlinkProtocol_GetTotalNumBytesAwaitingAck(self);
+
+        // If retransmitting, we need to use the same fragmentation as the previous transmission.
+        // The payload_sizes field will still contain the previously used size, unless it was zero'ed
+        // out because it got ack'd.
+        data_size = GG_GattlinkProtocol_GetPayloadSize(self, sn);
+        if (data_size == 0) {
+            GG_ASSERT(data_to_send >= offset);
+            data_size = data_to_send - offset;
+            if (data_size == 0) {
+                // All the data we have to send is already in flight
+                return ack_now;
+            }
+
+            // Cap the size to the max of what the transport allows - 1 for the header itself:
+            data_size = GG_MIN(data_size, max_packet_size - 1);
+        }
+    }
+
+    // A previously sent packet may not fit after the ack, in which case we send the ack alone first
+    if (data_size + 1 > max_packet_size) {
+        return ack_now;
     }
-    *send_buf = self->out.next_data_sn;
+
+    // The payload itself is fetched from the client when sending
+    *send_buf = sn;
     send_buf++;
-    GG_GattlinkClient_GetOutgoingData(self->client, offset, send_buf, data_size);
-    *buf_len += (1 + data_size);
-    *payload_size = data_size;
+    *buf_len = (size_t)(send_buf - *send_bufp);
+    *payload_psn    = sn;
+    *payload_offset = offset;
+    *payload_size   = data_size;
 
     // We are about to send data, prep the retransmit timer if it isn't already set
     if (!GG_Timer_IsScheduled(self->out.retransmit_timer)) {
         GG_LOG_FINER("scheduling retransmit timer");
         GG_TimerListener* listener = GG_CAST(self, GG_TimerListener);
-        GG_Result result = GG_Timer_Schedule(self->out.retransmit_timer, listener, GG_GATTLINK_EXPECTED_ACK_TIMEOUT);
+        GG_Result result = GG_Timer_Schedule(self->out.retransmit_timer,
+                                             listener,
+                                             GG_GattlinkProtocol_GetRetransmitTimeout(self));
         GG_COMPILER_UNUSED(result); // needed to remove warning if GG_ASSERT is compiled out below
         GG_ASSERT(GG_SUCCEEDED(result));
     }
@@ -723,6 +1601,38 @@ GG_GattlinkProtocol_PrepareNextPacket(GG_GattlinkProtocol* self,
     return true;
 }
 
+//----------------------------------------------------------------------
+// Send a packet prepared by GG_GattlinkProtocol_PrepareNextPacket.
+// When the client supports it, the payload goes straight from the client's
+// outgoing data to the transport, otherwise it is copied after the header.
+//----------------------------------------------------------------------
+static GG_Result
+GG_GattlinkProtocol_SendPacket(GG_GattlinkProtocol* self,
+                               uint8_t*             header,
+                               size_t               header_size,
+                               size_t               payload_offset,
+                               size_t               payload_size)
+{
+    if (payload_size && GG_INTERFACE(self->client)->SendPacket) {
+        GG_LOG_FINEST("Sending Payload: PSN=%d, Size=%d Bytes (header size=%d)",
+                      (int)header[header_size - 1], (int)payload_size, (int)header_size);
+        return GG_GattlinkClient_SendPacket(self->client, header, header_size, payload_offset, payload_size);
+    }
+
+    if (payload_size) {
+        GG_ASSERT(header_size + payload_size <= sizeof(self->out.send_buf));
+        GG_Result result = GG_GattlinkClient_GetOutgoingData(self->client,
+                                                             payload_offset,
+                                                             header + header_size,
+                                                             payload_size);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+
+    return GG_GattlinkProtocol_SendRawData(self, header, header_size + payload_size);
+}
+
 //----------------------------------------------------------------------
 static void
 GG_GattlinkProtocol_SendNextPackets(GG_GattlinkProtocol* self)
@@ -730,12 +1640,21 @@ GG_GattlinkProtocol_SendNextPackets(GG_GattlinkProtocol* self)
     GG_Result result;
     uint8_t*  buf_to_send;
     size_t    buf_to_send_size;
+    uint8_t   psn;
+    size_t    payload_offset;
     size_t    payload_size;
 
-    // Note: with a large window size we could be in this loop until we flush 31 packets
-
-    while (GG_GattlinkProtocol_PrepareNextPacket(self, &buf_to_send, &buf_to_send_size, &payload_size)) {
-        if ((result = GG_GattlinkProtocol_SendRawData(self, buf_to_send, buf_to_send_size)) != 0) {
+    // Note: with a large window size we could be in this loop until we flush a whole window of packets
+    // (the client may deliver them to the transport all at once when the batch ends)
+    GG_GattlinkClient_BeginPacketBatch(self->client);
+    while (GG_GattlinkProtocol_PrepareNextPacket(self,
+                                                 &buf_to_send,
+                                                 &buf_to_send_size,
+                                                 &psn,
+                                                 &payload_offset,
+                                                 &payload_size)) {
+        result = GG_GattlinkProtocol_SendPacket(self, buf_to_send, buf_to_send_size, payload_offset, payload_size);
+        if (result != GG_SUCCESS) {
             // error occurred
             GG_LOG_FATAL("Failed to send raw data over transport");
             GG_LOG_COMMS_ERROR_CODE(GG_LIB_GATTLINK_SEND_FAILED, result);
@@ -754,11 +1673,24 @@ GG_GattlinkProtocol_SendNextPackets(GG_GattlinkProtocol* self)
 
         // did we just send data as well?
         if (payload_size > 0) {
-            uint8_t psn = self->out.next_data_sn;
+            // Only packets sent once can be used as RTT samples (Karn's algorithm)
+            ++self->out.data_packet_count;
+            if (GG_GattlinkProtocol_PacketIsAwaitingAck(self, psn)) {
+                self->out.retransmitted[GG_GATTLINK_SN_SLOT(psn)] = true;
+                ++self->out.retransmitted_packet_count;
+            } else {
+                self->out.retransmitted[GG_GATTLINK_SN_SLOT(psn)] = false;
+                self->out.send_times[GG_GATTLINK_SN_SLOT(psn)]    = GG_TimerScheduler_GetTime(self->scheduler);
+            }
+
             GG_GattlinkProtocol_SetPayloadSize(self, psn, payload_size);
-            self->out.next_data_sn = GG_GattlinkProtocol_GetNextSn(psn);
+            self->out.retransmit_needed[GG_GATTLINK_SN_SLOT(psn)] = false;
+            if (psn == self->out.next_data_sn) {
+                self->out.next_data_sn = GG_GattlinkProtocol_GetNextSn(self, psn);
+            }
         }
     }
+    GG_GattlinkClient_EndPacketBatch(self->client);
 }
 
 //----------------------------------------------------------------------
@@ -810,14 +1742,34 @@ GG_GattlinkProtocol_OnSendTimeoutFired(GG_GattlinkProtocol* self, uint32_t elaps
         return;
     }
 
+    // back off until we get a valid RTT sample
+    ++self->rtt.retransmit_timeout_count;
+    if (self->rtt.backoff < GG_GATTLINK_MAX_RETRANSMIT_BACKOFF) {
+        ++self->rtt.backoff;
+    }
+
+    // restart slowly, to avoid resending a whole window into a congested link
+    GG_GattlinkProtocol_OnCongestionTimeout(self);
+
     // retransmit un-acked data
     uint8_t sn = self->out.next_expected_ack_sn;
 
-    GG_LOG_WARNING("Data Ack Timeout: Rolling back from (%d, %d) to %d",
-                   (int)self->out.next_data_sn,
-                   (int)self->out.next_expected_ack_sn, (int)sn);
+    if (GG_GattlinkProtocol_SelectiveAckEnabled(self)) {
+        // Only resend what the peer doesn't have (the first packet is never selectively acked)
+        GG_LOG_WARNING("Data Ack Timeout: Retransmitting missing packets from %d to %d",
+                       (int)sn, (int)self->out.next_data_sn);
+        for (; sn != self->out.next_data_sn; sn = GG_GattlinkProtocol_GetNextSn(self, sn)) {
+            if (!self->out.selectively_acked[GG_GATTLINK_SN_SLOT(sn)]) {
+                self->out.retransmit_needed[GG_GATTLINK_SN_SLOT(sn)] = true;
+            }
+        }
+    } else {
+        GG_LOG_WARNING("Data Ack Timeout: Rolling back from (%d, %d) to %d",
+                       (int)self->out.next_data_sn,
+                       (int)self->out.next_expected_ack_sn, (int)sn);
 
-    self->out.next_data_sn = sn;
+        self->out.next_data_sn = sn;
+    }
     GG_GattlinkProtocol_SendNextPackets(self);
 }
 
@@ -836,18 +1788,57 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
     }
 
     const uint8_t* data = (const uint8_t*)rx_raw_data;
-    if ((data[0] & GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK) == GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK) {
-        uint8_t ackd_psn = data[0] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK;
+    const uint8_t  header = data[0];
+
+    // With the extended format, the header byte is separate from the PSNs
+    bool extended = GG_GattlinkProtocol_ExtendedFormatEnabled(self);
+    if (extended) {
+        data++;
+        rx_raw_data_len--;
+    }
+
+    if ((header & GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK) == GG_GATTLINK_DATA_PACKET_TYPE_WITH_ACK) {
+        if (rx_raw_data_len == 0) {
+            return GG_ERROR_INVALID_PARAMETERS;
+        }
+        uint8_t ackd_psn = extended ? data[0] : (data[0] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK);
+        size_t  ack_size = 1;
+
+        // Check if the ack is followed by a selective ack bitmap
+        uint32_t selective_ack = 0;
+        if (GG_GattlinkProtocol_SelectiveAckEnabled(self) &&
+            (header & GG_GATTLINK_DATA_PACKET_TYPE_SELECTIVE_ACK)) {
+            if (rx_raw_data_len < 1 + GG_GATTLINK_SELECTIVE_ACK_SIZE) {
+                return GG_ERROR_INVALID_PARAMETERS;
+            }
+            selective_ack = GG_BytesToInt32Be(&data[1]);
+            ack_size += GG_GATTLINK_SELECTIVE_ACK_SIZE;
+        }
 
         // Handle this ACK if we haven't done so already
         if (GG_GattlinkProtocol_PacketIsAwaitingAck(self, ackd_psn)) {
             // Get the number of bytes ack'd before we wipe the counters
-            uint32_t next_psn = GG_GattlinkProtocol_GetNextSn(ackd_psn);
+            uint32_t next_psn = GG_GattlinkProtocol_GetNextSn(self, ackd_psn);
             size_t num_bytes_acked = GG_GattlinkProtocol_GetTotalNumBytesAwaitingAckUpTo(self, next_psn);
 
             GG_LOG_FINER("Received Ack PSN: %d for %d byte(s), Next expected Ack PSN: %d",
                          (int)ackd_psn, (int)num_bytes_acked, (int)next_psn);
 
+            // Sample the RTT, unless the packet was retransmitted (Karn's algorithm)
+            uint32_t rtt = 0;
+            if (!self->out.retransmitted[GG_GATTLINK_SN_SLOT(ackd_psn)]) {
+                uint32_t now = GG_TimerScheduler_GetTime(self->scheduler);
+                rtt = now - self->out.send_times[GG_GATTLINK_SN_SLOT(ackd_psn)];
+                GG_GattlinkProtocol_OnRttSample(self, rtt);
+                rtt = GG_MAX(rtt, 1);
+            }
+
+            // Let congestion control know how much got through
+            uint32_t packets_acked = GG_GattlinkProtocol_CalculateDistance(self,
+                                                                           self->out.next_expected_ack_sn,
+                                                                           next_psn);
+            GG_GattlinkProtocol_OnCongestionAck(self, packets_acked, rtt);
+
             // We know the bytes are received so clear the sizes
             ClearPayloadSizesUpTo(self, next_psn);
 
@@ -858,7 +1849,7 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
                 // Still awaiting for an ack .. re-arm our retransmit timer
                 GG_Result result = GG_Timer_Schedule(self->out.retransmit_timer,
                                                      GG_CAST(self, GG_TimerListener),
-                                                     GG_GATTLINK_EXPECTED_ACK_TIMEOUT);
+                                                     GG_GattlinkProtocol_GetRetransmitTimeout(self));
                 GG_COMPILER_UNUSED(result); // needed to remove warning if GG_ASSERT is compiled out below
                 GG_ASSERT(GG_SUCCEEDED(result));
             }
@@ -869,8 +1860,12 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
             GG_LOG_FINE("Ignoring retransmitted Ack PSN: %d", (int)ackd_psn);
         }
 
-        data++;
-        rx_raw_data_len--;
+        if (selective_ack) {
+            GG_GattlinkProtocol_OnSelectiveAck(self, ackd_psn, selective_ack);
+        }
+
+        data += ack_size;
+        rx_raw_data_len -= ack_size;
     }
 
     if (rx_raw_data_len == 0) {
@@ -879,7 +1874,11 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
         return GG_SUCCESS;
     }
 
-    if (self->in.payload_buffer_full) {
+    // When we have a reorder buffer, packets received out of order can be kept even if the client
+    // hasn't consumed the current payload yet
+    uint8_t psn = extended ? data[0] : (data[0] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK);
+    bool can_buffer = (self->reorder.slot_count != 0 && psn != self->in.next_expected_data_psn);
+    if (self->in.payload_buffer_full && !can_buffer) {
         // Client still hasn't consumed the data ... drop and rely on a retransmit
         GG_LOG_WARNING("Our receive buffer is full because the client hasn't consumed the data yet");
         GG_LOG_COMMS_ERROR(GG_LIB_GATTLINK_BUFFER_FULL);
@@ -887,7 +1886,9 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
         return GG_ERROR_NOT_ENOUGH_SPACE;
     }
 
-    uint8_t psn = data[0] & GG_GATTLINK_DATA_PACKET_TYPE_ACK_OR_PSN_MASK;
+    // Keep track of the arrival rate, to adapt the ack delay
+    GG_GattlinkProtocol_OnDataArrival(self);
+
     if (psn == self->in.next_expected_data_psn) {
         // That's the PSN we expected, grab the underlying data
         data++;
@@ -898,16 +1899,23 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
         self->in.bytes_consumed = 0;
         self->in.payload_buffer_full = true;
 
-        self->in.next_expected_data_psn = GG_GattlinkProtocol_GetNextSn((uint32_t)psn);
+        GG_GattlinkProtocol_AdvanceExpectedPsn(self);
         GG_LOG_FINER("Received %d Byte(s): 0x%02hhx... PSN: %d, Next expected PSN: %d",
                     (int)rx_raw_data_len, data[0], (int)psn, (int)self->in.next_expected_data_psn);
-        GG_GattlinkClient_NotifyIncomingDataAvailable(self->client);
 
         self->out.psn_to_ack_with = psn;
-    } else {
-        // Not what we expected, check if it's a resent packet we've already received and acked
-        uint32_t psn_distance = GG_GattlinkProtocol_CalculateDistance(psn, self->in.next_expected_data_psn);
-        if (psn_distance >= self->actual_session_cfg.max_rx_window_size) {
+        GG_GattlinkProtocol_NotifyIncomingData(self);
+    } else if (GG_GattlinkProtocol_CalculateDistance(self, psn, self->in.next_expected_data_psn) >
+               self->actual_session_cfg.max_rx_window_size) {
+        // Not a retransmission of a packet we've already received, check if it's ahead of the
+        // one we expect and we can keep it for later
+        if (GG_GattlinkProtocol_BufferOutOfOrderPacket(self, psn, data + 1, rx_raw_data_len - 1)) {
+            GG_LOG_FINER("Buffered out of order PSN: %d, Expected PSN: %d",
+                         (int)psn, (int)self->in.next_expected_data_psn);
+
+            // ack right away, so that the peer can retransmit the missing packets
+            self->out.ack_now = true;
+        } else {
             // Not a restransmission, ignore. Should we reset gattlink if too far in the future?
             GG_LOG_WARNING("Received PSN (%d) != Expected PSN (%d)", (int)psn,
                            (int)self->in.next_expected_data_psn);
@@ -916,7 +1924,8 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
 
             return GG_ERROR_GATTLINK_UNEXPECTED_PSN;
         }
-
+    } else {
+        // It's a resent packet we've already received and acked.
         // The ack for this will be sent later (either when the ack timer expires, or with our outgoing data)
         GG_LOG_WARNING("Received previously received PSN (%d) != Expected (%d), Re-acking with last received PSN (%d)",
                        (int)psn, (int)self->in.next_expected_data_psn, self->out.psn_to_ack_with);
@@ -924,16 +1933,8 @@ GG_GattlinkProtocol_HandleDataPacket(GG_GattlinkProtocol* self,
                                (int)self->out.next_expected_ack_sn, (int)psn);
     }
 
-    // Increment the number of unacked packets
-    self->out.outstanding_unacked_packets++;
-    GG_LOG_FINEST("%u unacked packets", (int)self->out.outstanding_unacked_packets);
-
-    // Schedule the ack timer
-    GG_Result result = GG_Timer_Schedule(self->out.ack_timer,
-                                         GG_CAST(self, GG_TimerListener),
-                                         GG_GATTLINK_SEND_ACK_TIMEOUT);
-    GG_COMPILER_UNUSED(result); // needed to remove warning if GG_ASSERT is compiled out below
-    GG_ASSERT(GG_SUCCEEDED(result));
+    // Count this packet as unacked and schedule the ack timer
+    GG_GattlinkProtocol_ScheduleAck(self);
 
     // Flush data/acks if necessary
     GG_GattlinkProtocol_SendNextPackets(self);
@@ -983,6 +1984,26 @@ GG_GattlinkProtocol_Create(GG_GattlinkClient*              client,
     self->client              = client;
     self->desired_session_cfg = *config;
     self->scheduler           = scheduler;
+    self->sn_space_size       = GG_GATTLINK_SN_SPACE_SIZE;
+
+    // Apply the defaults for the timing parameters that aren't set
+    GG_GattlinkSessionConfig* cfg = &self->desired_session_cfg;
+    if (cfg->min_retransmit_timeout == 0) {
+        cfg->min_retransmit_timeout = GG_GATTLINK_MIN_RETRANSMIT_TIMEOUT;
+    }
+    if (cfg->max_retransmit_timeout == 0) {
+        cfg->max_retransmit_timeout = GG_MAX(GG_GATTLINK_MAX_RETRANSMIT_TIMEOUT, cfg->min_retransmit_timeout);
+    }
+    cfg->min_retransmit_timeout = GG_MIN(cfg->min_retransmit_timeout, cfg->max_retransmit_timeout);
+    if (cfg->initial_retransmit_timeout == 0) {
+        cfg->initial_retransmit_timeout = GG_GATTLINK_EXPECTED_ACK_TIMEOUT;
+    }
+    cfg->initial_retransmit_timeout = GG_MAX(cfg->initial_retransmit_timeout, cfg->min_retransmit_timeout);
+    cfg->initial_retransmit_timeout = GG_MIN(cfg->initial_retransmit_timeout, cfg->max_retransmit_timeout);
+    if (cfg->max_ack_delay == 0) {
+        cfg->max_ack_delay = GG_GATTLINK_SEND_ACK_TIMEOUT;
+    }
+    GG_GattlinkProtocol_ResetRttEstimator(self);
 
     GG_GattlinkProtocol_CreateTimers(self);
 
@@ -1007,6 +2028,9 @@ GG_GattlinkProtocol_Destroy(GG_GattlinkProtocol* self)
     GG_THREAD_GUARD_CHECK_BINDING(self);
 
     GG_GattlinkProtocol_DestroyTimers(self);
+    if (self->reorder.buffer) {
+        GG_FreeMemory(self->reorder.buffer);
+    }
     GG_ClearAndFreeObject(self, 1);
 }
 
@@ -1064,6 +2088,12 @@ GG_GattlinkProtocol_ConsumeIncomingData(GG_GattlinkProtocol* self, size_t num_by
     self->in.bytes_consumed += num_bytes;
     if (self->in.bytes_consumed == self->in.payload_len) {
         self->in.payload_buffer_full = false;
+
+        // Deliver the next packet if we received it out of order earlier
+        // (when called while notifying, the notification loop takes care of it)
+        if (!self->in.notifying && GG_GattlinkProtocol_PromoteBufferedPacket(self)) {
+            GG_GattlinkProtocol_NotifyIncomingData(self);
+        }
     }
 
     return GG_SUCCESS;
@@ -1084,7 +2114,11 @@ GG_GattlinkProtocol_HandleIncomingRawData(GG_GattlinkProtocol* self,
         return GG_SUCCESS;
     }
 
-    GG_LOG_PACKET(GG_LOG_LEVEL_FINEST, "Received", rx_raw_data, rx_raw_data_len);
+    GG_LOG_PACKET(GG_LOG_LEVEL_FINEST,
+                  "Received",
+                  GG_GattlinkProtocol_ExtendedFormatEnabled(self),
+                  rx_raw_data,
+                  rx_raw_data_len);
 
     // Ignore the packet if we haven't started yet
     if (self->state == GG_GATTLINK_STATE_INITIALIZED) {
@@ -1137,6 +2171,57 @@ GG_GattlinkProtocol_NotifyOutgoingDataAvailable(GG_GattlinkProtocol* self)
     GG_GattlinkProtocol_SendNextPackets(self);
 }
 
+//----------------------------------------------------------------------
+void
+GG_GattlinkProtocol_SetTxWindowLimit(GG_GattlinkProtocol* self, uint8_t window_size)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    self->tx_window_limit = window_size;
+
+    // the window may have just opened up
+    if (self->state == GG_GATTLINK_STATE_READY) {
+        GG_GattlinkProtocol_SendNextPackets(self);
+    }
+}
+
+//----------------------------------------------------------------------
+uint8_t
+GG_GattlinkProtocol_GetTxWindowSize(GG_GattlinkProtocol* self)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    if (self->state != GG_GATTLINK_STATE_READY) {
+        return 0;
+    }
+
+    return (uint8_t)GG_GattlinkProtocol_GetTxWindowSizeInternal(self);
+}
+
+//----------------------------------------------------------------------
+void
+GG_GattlinkProtocol_GetStats(GG_GattlinkProtocol* self, GG_GattlinkProtocolStats* stats)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    stats->smoothed_rtt             = self->rtt.smoothed_rtt_x8 >> 3;
+    stats->rtt_variance             = self->rtt.rtt_variance_x4 >> 2;
+    stats->retransmit_timeout       = GG_GattlinkProtocol_GetRetransmitTimeout(self);
+    stats->ack_delay                = GG_GattlinkProtocol_GetAckDelay(self);
+    stats->rtt_sample_count         = self->rtt.rtt_sample_count;
+    stats->retransmit_timeout_count = self->rtt.retransmit_timeout_count;
+    stats->congestion_event_count   = self->congestion.event_count;
+    stats->data_packet_count          = self->out.data_packet_count;
+    stats->retransmitted_packet_count = self->out.retransmitted_packet_count;
+    if (self->congestion.controller) {
+        stats->congestion_window    = self->congestion.window;
+        stats->slow_start_threshold = self->congestion.slow_start_threshold;
+    } else {
+        stats->congestion_window    = 0;
+        stats->slow_start_threshold = 0;
+    }
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_GattlinkProtocol_Start(GG_GattlinkProtocol* self)
@@ -37,6 +37,15 @@ extern "C" {
  +---------------------------------------------------------------------*/
 #define GG_GATTLINK_MAX_PACKET_SIZE 512
 
+// Max number of packets that can be in flight in either direction, when the extended
+// packet format is used (sessions using the base format are limited to 31, or to 16
+// with selective acks).
+// Must be a power of 2 between 32 and 128.
+#if !defined(GG_CONFIG_GATTLINK_MAX_WINDOW_SIZE)
+#define GG_CONFIG_GATTLINK_MAX_WINDOW_SIZE 64
+#endif
+#define GG_GATTLINK_MAX_WINDOW_SIZE GG_CONFIG_GATTLINK_MAX_WINDOW_SIZE
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -133,6 +142,37 @@ GG_DECLARE_INTERFACE(GG_GattlinkClient) {
     //! @param[in] self The object on which this method is invoked.
     //! @param[in] stalled_time Number of milliseconds we have been stalled for so far.
     void (*NotifySessionStalled)(GG_GattlinkClient* self, uint32_t stalled_time);
+
+    //! Optional (may be NULL): called instead of SendRawData to send a packet that carries a
+    //! payload, so that the client can send the payload straight from where it keeps its
+    //! outgoing data, instead of having it copied into the packet.
+    //! The packet consists of the header bytes followed by the payload.
+    //!
+    //! @param[in] self The object on which this method is invoked.
+    //! @param[in] header The gattlink packet header
+    //! @param[in] header_size The size of the header
+    //! @param[in] payload_offset The index within the currently outstanding send data at which the payload starts
+    //! @param[in] payload_size The size of the payload
+    //! @return #GG_SUCCESS on success, or an error code
+    GG_Result (*SendPacket)(GG_GattlinkClient* self,
+                            const void*        header,
+                            size_t             header_size,
+                            size_t             payload_offset,
+                            size_t             payload_size);
+
+    //! Optional (may be NULL, but only if EndPacketBatch is also NULL): called before the protocol
+    //! sends a group of packets in one go. Until EndPacketBatch is called, the client may hold
+    //! the packets passed to SendRawData and SendPacket, so that it can deliver them to the
+    //! transport together.
+    //!
+    //! @param[in] self The object on which this method is invoked.
+    void (*BeginPacketBatch)(GG_GattlinkClient* self);
+
+    //! Optional (may be NULL, but only if BeginPacketBatch is also NULL): called after a group of
+    //! packets has been sent, so that the client delivers any packet it is still holding.
+    //!
+    //! @param[in] self The object on which this method is invoked.
+    void (*EndPacketBatch)(GG_GattlinkClient* self);
 };
 
 //! @var GG_GattlinkClient::iface
@@ -177,14 +217,75 @@ void GG_GattlinkClient_NotifySessionReset(GG_GattlinkClient* self);
 //! @copydoc GG_GattlinkClientInterface::NotifySessionStalled
 void GG_GattlinkClient_NotifySessionStalled(GG_GattlinkClient* self, uint32_t stalled_time);
 
+//! @relates GG_GattlinkClient
+//! @copydoc GG_GattlinkClientInterface::SendPacket
+GG_Result GG_GattlinkClient_SendPacket(GG_GattlinkClient* self,
+                                       const void*        header,
+                                       size_t             header_size,
+                                       size_t             payload_offset,
+                                       size_t             payload_size);
+
+//! @relates GG_GattlinkClient
+//! @copydoc GG_GattlinkClientInterface::BeginPacketBatch
+void GG_GattlinkClient_BeginPacketBatch(GG_GattlinkClient* self);
+
+//! @relates GG_GattlinkClient
+//! @copydoc GG_GattlinkClientInterface::EndPacketBatch
+void GG_GattlinkClient_EndPacketBatch(GG_GattlinkClient* self);
+
+//! Congestion control algorithms that can be used to limit the number of packets in flight,
+//! below the transmit window size, when the link can't absorb a full window.
+typedef enum {
+    //! No congestion control: packets are sent as long as the transmit window allows it
+    GG_GATTLINK_CONGESTION_CONTROL_NONE = 0,
+    //! Loss-based: slow start, then additive increase of the congestion window, halved on loss
+    //! and collapsed to one packet when the retransmission timer expires
+    GG_GATTLINK_CONGESTION_CONTROL_AIMD,
+    //! Delay-based: the congestion window is adjusted once per round-trip so that only a small
+    //! number of packets are queued in the link, based on the increase of the round-trip time
+    //! over the lowest one measured. Losses are handled like with GG_GATTLINK_CONGESTION_CONTROL_AIMD
+    GG_GATTLINK_CONGESTION_CONTROL_DELAY
+} GG_GattlinkCongestionControl;
+
 //! Configuration information for the a GattLink Session
+//!
+//! The timing fields are optional: a value of 0 selects the default.
+//! The retransmission timeout is computed from round-trip time samples (smoothed RTT plus
+//! four times the RTT variance), starting at `initial_retransmit_timeout` until the first
+//! sample is taken, and kept within [`min_retransmit_timeout`, `max_retransmit_timeout`].
+//! The timeout doubles after each consecutive retransmission.
 typedef struct {
     //! The max number of transport in-flight outbound packets at any given time
     uint8_t max_tx_window_size;
     //! The max number of transport in-flight inbound packets at any given time
     uint8_t max_rx_window_size;
+    //! Retransmission timeout used before any round-trip time sample is available, in ms
+    uint32_t initial_retransmit_timeout;
+    //! Lower bound for the retransmission timeout, in ms
+    uint32_t min_retransmit_timeout;
+    //! Upper bound for the retransmission timeout, including backoff, in ms
+    uint32_t max_retransmit_timeout;
+    //! Max time to wait before ack'ing a received packet, in ms
+    uint32_t max_ack_delay;
+    //! Congestion control algorithm (none by default)
+    GG_GattlinkCongestionControl congestion_control;
 } GG_GattlinkSessionConfig;
 
+//! Timing estimates and counters for a GattLink session
+typedef struct {
+    uint32_t smoothed_rtt;                 ///< Smoothed round-trip time, in ms (0 until sampled)
+    uint32_t rtt_variance;                 ///< Round-trip time variance, in ms
+    uint32_t retransmit_timeout;           ///< Current retransmission timeout, including backoff, in ms
+    uint32_t ack_delay;                    ///< Current delayed-ack timeout, in ms
+    uint32_t rtt_sample_count;             ///< Number of round-trip time samples taken
+    uint32_t retransmit_timeout_count;     ///< Number of times the retransmission timer expired
+    uint32_t congestion_window;            ///< Max packets in flight allowed by congestion control (0 if none)
+    uint32_t slow_start_threshold;         ///< Congestion window below which it grows exponentially (0 if none)
+    uint32_t congestion_event_count;       ///< Number of times the congestion window was reduced
+    uint32_t data_packet_count;            ///< Number of data packets sent in the session, including retransmissions
+    uint32_t retransmitted_packet_count;   ///< Number of data packets that were sent more than once
+} GG_GattlinkProtocolStats;
+
 /*----------------------------------------------------------------------
 |   functions
 +---------------------------------------------------------------------*/
@@ -223,6 +324,26 @@ GG_Result GG_GattlinkProtocol_Start(GG_GattlinkProtocol* protocol);
 //! @return #GG_SUCCESS on success, or an error code
 GG_Result GG_GattlinkProtocol_Reset(GG_GattlinkProtocol* protocol);
 
+//! Get the current timing estimates and counters of a GattLink session.
+//!
+//! @param[in] protocol The protocol to query
+//! @param[out] stats Pointer to the struct in which the stats will be returned
+void GG_GattlinkProtocol_GetStats(GG_GattlinkProtocol* protocol, GG_GattlinkProtocolStats* stats);
+
+//! Limit the number of packets that can be in flight, below the negotiated transmit window size.
+//! This lets a client size its window to what the link can actually absorb.
+//!
+//! @param[in] protocol The protocol to act on
+//! @param[in] window_size Max number of packets in flight, or 0 to only use the negotiated window size
+void GG_GattlinkProtocol_SetTxWindowLimit(GG_GattlinkProtocol* protocol, uint8_t window_size);
+
+//! Get the number of packets that can currently be in flight, which is the negotiated transmit
+//! window size, capped by the limit set with GG_GattlinkProtocol_SetTxWindowLimit.
+//!
+//! @param[in] protocol The protocol to query
+//! @return The transmit window size, or 0 if the session isn't open
+uint8_t GG_GattlinkProtocol_GetTxWindowSize(GG_GattlinkProtocol* protocol);
+
 //! Inform the GattLink layer that there is more data ready to be sent. This effectively primes
 //! GattLink to call the client's GattlinkGetOutgoingData implementation
 //! @param[in] protocol The protocol to notify
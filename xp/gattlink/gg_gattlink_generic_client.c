@@ -28,27 +28,86 @@
 +---------------------------------------------------------------------*/
 GG_SET_LOCAL_LOGGER("gg.xp.gattlink.generic-client")
 
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+// number of buffers in the pool used for outgoing transport packets
+#if !defined(GG_CONFIG_GATTLINK_CLIENT_PACKET_POOL_SIZE)
+#define GG_CONFIG_GATTLINK_CLIENT_PACKET_POOL_SIZE 8
+#endif
+
+// number of views of the output ring buffer that the transport can hold at the same time
+// (when they are all in use, payloads are copied instead)
+#if !defined(GG_CONFIG_GATTLINK_CLIENT_RING_VIEW_COUNT)
+#define GG_CONFIG_GATTLINK_CLIENT_RING_VIEW_COUNT 16
+#endif
+
+// congestion control algorithm used by the protocol (see GG_GattlinkCongestionControl)
+#if !defined(GG_CONFIG_GATTLINK_CLIENT_CONGESTION_CONTROL)
+#define GG_CONFIG_GATTLINK_CLIENT_CONGESTION_CONTROL GG_GATTLINK_CONGESTION_CONTROL_AIMD
+#endif
+
+// the tx window is sized to this multiple of the measured bandwidth-delay product,
+// so that it can keep growing while the link isn't saturated
+#define GG_GATTLINK_CLIENT_TX_WINDOW_GAIN 2
+
+// delivery rate samples spanning more than this many round-trips include idle time, and are ignored
+#define GG_GATTLINK_CLIENT_MAX_RATE_SAMPLE_RTTS 4
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
 
+/**
+ * Read-only view of a range of the output ring buffer, used to pass
+ * payloads to the transport without copying them.
+ */
+typedef struct {
+    GG_IMPLEMENTS(GG_Buffer);
+
+    GG_GattlinkGenericClient* client;
+    unsigned int              reference_counter; ///< 0 when the view is free
+    const uint8_t*            data;
+    size_t                    data_size;
+    uint64_t                  stream_offset;     ///< Position of the data in the outgoing stream
+} GG_GattlinkGenericClientRingView;
+
 struct GG_GattlinkGenericClient {
     GG_IMPLEMENTS(GG_GattlinkClient);
     GG_IMPLEMENTS(GG_TimerListener);
     GG_IF_INSPECTION_ENABLED(GG_IMPLEMENTS(GG_Inspectable);)
 
     GG_EventEmitterBase     event_emitter;
+    GG_TimerScheduler*      timer_scheduler;
     bool                    session_open;
     GG_GattlinkProtocol*    protocol;
     GG_FrameSerializer*     frame_serializer;
     GG_FrameAssembler*      frame_assembler;
     GG_RingBuffer           output_buffer;
+    uint64_t                output_consumed;   ///< Number of bytes removed from the output buffer so far
+    GG_GattlinkGenericClientRingView ring_views[GG_CONFIG_GATTLINK_CLIENT_RING_VIEW_COUNT];
+    size_t                  ring_views_in_use;
+    bool                    user_side_blocked; ///< True when a write was refused because of ring views
+    bool                    destroyed;         ///< True when waiting for ring views to be released
     size_t                  max_transport_fragment_size;
+    GG_BufferPool*          packet_pool;
     uint8_t                 max_tx_window_size;
+    struct {
+        uint8_t  size;         ///< Current tx window size
+        uint32_t sample_start; ///< Time at which the current delivery rate sample started
+        size_t   bytes_acked;  ///< Number of bytes acked since the start of the sample
+    }                       tx_window;
     GG_DataProbe*           probe;
+    GG_DataProbe*           congestion_probe;  ///< Samples of the congestion window, in bytes
     GG_GattlinkProbeConfig  probe_config;
     bool                    buffer_over_threshold;
     GG_Timer*               buffer_fullness_timer;
+    struct {
+        bool                         enabled;
+        unsigned int                 depth;    ///< Nesting depth of the protocol's packet batches
+        GG_DynamicBuffer*            buffer;   ///< Packets held until the end of the batch, back to back
+        GG_GattlinkFragmentsMetadata metadata; ///< Size of each packet held
+    }                       batch;
     struct {
         GG_IMPLEMENTS(GG_DataSink);
         GG_IMPLEMENTS(GG_DataSource);
@@ -64,6 +123,7 @@ struct GG_GattlinkGenericClient {
 
         GG_DataSink*         sink;
         GG_DataSinkListener* sink_listener;
+        GG_Buffer*           pending_frame; ///< Frame pushed back by the sink, to deliver before any other
     } user_side;
 };
 
@@ -127,6 +187,289 @@ GG_GattlinkGenericClient_UpdateBufferState(GG_GattlinkGenericClient* self, bool
     }
 }
 
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClient_Free(GG_GattlinkGenericClient* self)
+{
+    GG_FreeMemory(self->output_buffer.data.start);
+    GG_ClearAndFreeObject(self, 2);
+}
+
+//----------------------------------------------------------------------
+// Check if some ring views still reference data that has been removed from
+// the output buffer, and could thus be overwritten by new data
+//----------------------------------------------------------------------
+static bool
+GG_GattlinkGenericClient_HasStaleRingViews(GG_GattlinkGenericClient* self)
+{
+    if (self->ring_views_in_use == 0) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < GG_CONFIG_GATTLINK_CLIENT_RING_VIEW_COUNT; i++) {
+        const GG_GattlinkGenericClientRingView* view = &self->ring_views[i];
+        if (view->reference_counter && view->stream_offset < self->output_consumed) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+static GG_Buffer*
+GG_GattlinkGenericClientRingView_Retain(GG_Buffer* _self)
+{
+    GG_GattlinkGenericClientRingView* self = GG_SELF(GG_GattlinkGenericClientRingView, GG_Buffer);
+    ++self->reference_counter;
+    return _self;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClientRingView_Release(GG_Buffer* _self)
+{
+    GG_GattlinkGenericClientRingView* self = GG_SELF(GG_GattlinkGenericClientRingView, GG_Buffer);
+    GG_ASSERT(self->reference_counter);
+    if (--self->reference_counter) {
+        return;
+    }
+
+    GG_GattlinkGenericClient* client = self->client;
+    --client->ring_views_in_use;
+    if (client->destroyed) {
+        if (client->ring_views_in_use == 0) {
+            GG_GattlinkGenericClient_Free(client);
+        }
+        return;
+    }
+
+    // a writer may have been waiting for this view to go away
+    if (client->user_side_blocked && !GG_GattlinkGenericClient_HasStaleRingViews(client)) {
+        client->user_side_blocked = false;
+        if (client->user_side.sink_listener) {
+            GG_DataSinkListener_OnCanPut(client->user_side.sink_listener);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+static const uint8_t*
+GG_GattlinkGenericClientRingView_GetData(const GG_Buffer* _self)
+{
+    const GG_GattlinkGenericClientRingView* self = GG_SELF(GG_GattlinkGenericClientRingView, GG_Buffer);
+    return self->data;
+}
+
+//----------------------------------------------------------------------
+static uint8_t*
+GG_GattlinkGenericClientRingView_UseData(GG_Buffer* _self)
+{
+    GG_COMPILER_UNUSED(_self);
+    return NULL; // read-only
+}
+
+//----------------------------------------------------------------------
+static size_t
+GG_GattlinkGenericClientRingView_GetDataSize(const GG_Buffer* _self)
+{
+    const GG_GattlinkGenericClientRingView* self = GG_SELF(GG_GattlinkGenericClientRingView, GG_Buffer);
+    return self->data_size;
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_GattlinkGenericClientRingView, GG_Buffer) {
+    GG_GattlinkGenericClientRingView_Retain,
+    GG_GattlinkGenericClientRingView_Release,
+    GG_GattlinkGenericClientRingView_GetData,
+    GG_GattlinkGenericClientRingView_UseData,
+    GG_GattlinkGenericClientRingView_GetDataSize
+};
+
+//----------------------------------------------------------------------
+// Get a free view for a block of the output buffer.
+// Returns NULL if all views are in use.
+//----------------------------------------------------------------------
+static GG_GattlinkGenericClientRingView*
+GG_GattlinkGenericClient_AllocateRingView(GG_GattlinkGenericClient* self,
+                                          const uint8_t*            data,
+                                          size_t                    data_size,
+                                          size_t                    offset)
+{
+    for (unsigned int i = 0; i < GG_CONFIG_GATTLINK_CLIENT_RING_VIEW_COUNT; i++) {
+        GG_GattlinkGenericClientRingView* view = &self->ring_views[i];
+        if (view->reference_counter == 0) {
+            view->reference_counter = 1;
+            view->data              = data;
+            view->data_size         = data_size;
+            view->stream_offset     = self->output_consumed + offset;
+            ++self->ring_views_in_use;
+            return view;
+        }
+    }
+
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Create a packet made of a header followed by views of the output buffer
+//----------------------------------------------------------------------
+static GG_Result
+GG_GattlinkGenericClient_CreatePacketChain(GG_GattlinkGenericClient* self,
+                                           const void*               header,
+                                           size_t                    header_size,
+                                           size_t                    payload_offset,
+                                           size_t                    payload_size,
+                                           GG_Buffer**               packet)
+{
+    GG_BufferChain* chain = NULL;
+    GG_Result result = GG_BufferChain_Create(header_size, &chain);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+
+    // the payload may be split in two blocks if it wraps around the end of the ring
+    while (payload_size) {
+        size_t block_size = 0;
+        const uint8_t* block = GG_RingBuffer_GetContiguousData(&self->output_buffer, payload_offset, &block_size);
+        if (block_size == 0) {
+            GG_BufferChain_Release(chain);
+            return GG_ERROR_OUT_OF_RANGE;
+        }
+        block_size = GG_MIN(block_size, payload_size);
+
+        GG_GattlinkGenericClientRingView* view =
+            GG_GattlinkGenericClient_AllocateRingView(self, block, block_size, payload_offset);
+        if (view == NULL) {
+            GG_BufferChain_Release(chain);
+            return GG_ERROR_OUT_OF_RESOURCES;
+        }
+        result = GG_BufferChain_AppendBuffer(chain, GG_CAST(view, GG_Buffer));
+        GG_Buffer_Release(GG_CAST(view, GG_Buffer)); // the chain holds its own reference
+        if (GG_FAILED(result)) {
+            GG_BufferChain_Release(chain);
+            return result;
+        }
+
+        payload_offset += block_size;
+        payload_size   -= block_size;
+    }
+
+    uint8_t* header_data = NULL;
+    result = GG_BufferChain_Prepend(chain, header_size, &header_data);
+    if (GG_FAILED(result)) {
+        GG_BufferChain_Release(chain);
+        return result;
+    }
+    memcpy(header_data, header, header_size);
+
+    *packet = GG_BufferChain_AsBuffer(chain);
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Create a packet made of a header followed by a copy of a range of the output buffer
+//----------------------------------------------------------------------
+static GG_Result
+GG_GattlinkGenericClient_CreatePacketCopy(GG_GattlinkGenericClient* self,
+                                          const void*               header,
+                                          size_t                    header_size,
+                                          size_t                    payload_offset,
+                                          size_t                    payload_size,
+                                          GG_Buffer**               packet)
+{
+    GG_DynamicBuffer* buffer = NULL;
+    GG_Result result = GG_BufferPool_AllocateBuffer(self->packet_pool, header_size + payload_size, &buffer);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+    GG_DynamicBuffer_SetDataSize(buffer, header_size + payload_size);
+
+    uint8_t* data = GG_DynamicBuffer_UseData(buffer);
+    memcpy(data, header, header_size);
+    if (GG_RingBuffer_Peek(&self->output_buffer, data + header_size, payload_offset, payload_size) != payload_size) {
+        GG_DynamicBuffer_Release(buffer);
+        return GG_ERROR_OUT_OF_RANGE;
+    }
+
+    *packet = GG_DynamicBuffer_AsBuffer(buffer);
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Deliver the packets held in the current batch to the transport, as a single
+// buffer with the packet sizes in its metadata
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClient_FlushBatch(GG_GattlinkGenericClient* self)
+{
+    GG_DynamicBuffer* buffer = self->batch.buffer;
+    if (buffer == NULL) {
+        return;
+    }
+    GG_GattlinkFragmentsMetadata metadata = self->batch.metadata;
+
+    // start a new batch before delivering this one, since the transport may call us back
+    self->batch.buffer                  = NULL;
+    self->batch.metadata.fragment_count = 0;
+
+    // send the buffer to the transport-side sink, ignoring errors (a single packet doesn't need metadata)
+    if (self->transport_side.sink) {
+        GG_LOG_FINE("sending %u packets (%u bytes) to the transport",
+                    (int)metadata.fragment_count,
+                    (int)GG_DynamicBuffer_GetDataSize(buffer));
+        GG_DataSink_PutData(self->transport_side.sink,
+                            GG_DynamicBuffer_AsBuffer(buffer),
+                            metadata.fragment_count > 1 ? &metadata.base : NULL);
+    }
+
+    // don't keep a reference to the buffer
+    GG_DynamicBuffer_Release(buffer);
+}
+
+//----------------------------------------------------------------------
+// Add a packet, made of a header followed by a range of the output buffer,
+// to the current batch
+//----------------------------------------------------------------------
+static GG_Result
+GG_GattlinkGenericClient_AddToBatch(GG_GattlinkGenericClient* self,
+                                    const void*               header,
+                                    size_t                    header_size,
+                                    size_t                    payload_offset,
+                                    size_t                    payload_size)
+{
+    if (self->batch.metadata.fragment_count == GG_GENERIC_GATTLINK_CLIENT_MAX_BATCH_FRAGMENTS) {
+        GG_GattlinkGenericClient_FlushBatch(self);
+    }
+
+    GG_Result result;
+    if (self->batch.buffer == NULL) {
+        result = GG_DynamicBuffer_Create(self->max_transport_fragment_size, &self->batch.buffer);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+
+    // append the packet
+    size_t batch_size  = GG_DynamicBuffer_GetDataSize(self->batch.buffer);
+    size_t packet_size = header_size + payload_size;
+    result = GG_DynamicBuffer_Reserve(self->batch.buffer, batch_size + packet_size);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+    GG_DynamicBuffer_SetDataSize(self->batch.buffer, batch_size + packet_size);
+    uint8_t* packet = GG_DynamicBuffer_UseData(self->batch.buffer) + batch_size;
+    memcpy(packet, header, header_size);
+    if (payload_size &&
+        GG_RingBuffer_Peek(&self->output_buffer, packet + header_size, payload_offset, payload_size) != payload_size) {
+        GG_DynamicBuffer_SetDataSize(self->batch.buffer, batch_size);
+        return GG_ERROR_OUT_OF_RANGE;
+    }
+    self->batch.metadata.fragment_sizes[self->batch.metadata.fragment_count++] = (uint16_t)packet_size;
+
+    return GG_SUCCESS;
+}
+
 //----------------------------------------------------------------------
 static size_t
 GG_GattlinkGenericClient_GetOutgoingDataAvailable(GG_GattlinkClient* _self)
@@ -149,6 +492,64 @@ GG_GattlinkGenericClient_GetOutgoingData(GG_GattlinkClient* _self, size_t offset
     }
 }
 
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClient_SetTxWindowSize(GG_GattlinkGenericClient* self, uint32_t window_size)
+{
+    window_size = GG_MAX(window_size, GG_GENERIC_GATTLINK_CLIENT_MIN_TX_WINDOW_SIZE);
+    window_size = GG_MIN(window_size, self->max_tx_window_size);
+    if (window_size != self->tx_window.size) {
+        GG_LOG_FINE("tx window size: %u -> %u", (int)self->tx_window.size, (int)window_size);
+        self->tx_window.size = (uint8_t)window_size;
+        GG_GattlinkProtocol_SetTxWindowLimit(self->protocol, self->tx_window.size);
+    }
+}
+
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClient_StartRateSample(GG_GattlinkGenericClient* self)
+{
+    self->tx_window.sample_start = GG_TimerScheduler_GetTime(self->timer_scheduler);
+    self->tx_window.bytes_acked  = 0;
+}
+
+//----------------------------------------------------------------------
+// Size the tx window from the bandwidth-delay product of the link: the number
+// of bytes acked per round-trip, divided by the size of a transport packet.
+// Each sample spans at least one round-trip.
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClient_UpdateTxWindowSize(GG_GattlinkGenericClient* self, size_t bytes_acked)
+{
+    self->tx_window.bytes_acked += bytes_acked;
+
+    GG_GattlinkProtocolStats stats;
+    GG_GattlinkProtocol_GetStats(self->protocol, &stats);
+    if (stats.rtt_sample_count == 0 || stats.smoothed_rtt == 0) {
+        return;
+    }
+
+    uint32_t elapsed = GG_TimerScheduler_GetTime(self->timer_scheduler) - self->tx_window.sample_start;
+    if (elapsed < stats.smoothed_rtt) {
+        return;
+    }
+    if (elapsed > GG_GATTLINK_CLIENT_MAX_RATE_SAMPLE_RTTS * stats.smoothed_rtt) {
+        GG_GattlinkGenericClient_StartRateSample(self);
+        return;
+    }
+
+    uint64_t bdp = (uint64_t)self->tx_window.bytes_acked * stats.smoothed_rtt / elapsed;
+    size_t packet_size = GG_MAX(self->max_transport_fragment_size, 1);
+    uint32_t window_size = (uint32_t)((GG_GATTLINK_CLIENT_TX_WINDOW_GAIN * bdp + packet_size - 1) / packet_size);
+
+    // when we ran out of data to send, the sample only tells us that the window was big enough
+    if (GG_RingBuffer_GetAvailable(&self->output_buffer) == 0) {
+        window_size = GG_MAX(window_size, self->tx_window.size);
+    }
+    GG_GattlinkGenericClient_SetTxWindowSize(self, window_size);
+    GG_GattlinkGenericClient_StartRateSample(self);
+}
+
 //----------------------------------------------------------------------
 static void
 GG_GattlinkGenericClient_ConsumeOutgoingData(GG_GattlinkClient* _self, size_t bytes_consumed)
@@ -157,6 +558,7 @@ GG_GattlinkGenericClient_ConsumeOutgoingData(GG_GattlinkClient* _self, size_t by
     if (GG_RingBuffer_GetAvailable(&self->output_buffer) >= bytes_consumed) {
         GG_LOG_FINE("%d bytes consumed", (int)bytes_consumed);
         GG_RingBuffer_MoveOut(&self->output_buffer, bytes_consumed);
+        self->output_consumed += bytes_consumed;
 
         // notify listeners who may be waiting for some space to free up
         if (self->user_side.sink_listener) {
@@ -166,10 +568,50 @@ GG_GattlinkGenericClient_ConsumeOutgoingData(GG_GattlinkClient* _self, size_t by
         GG_LOG_WARNING("unexpected value offset=%u, exceeds ring buffer fullness", (int)bytes_consumed);
     }
 
-    // update data probe if configured
+    // adapt the tx window to what the link can take
+    GG_GattlinkGenericClient_UpdateTxWindowSize(self, bytes_consumed);
+
+    // update data probes if configured
     if (self->probe != NULL) {
         GG_GattlinkGenericClient_UpdateBufferState(self, false);
     }
+    if (self->congestion_probe != NULL) {
+        GG_GattlinkProtocolStats stats;
+        GG_GattlinkProtocol_GetStats(self->protocol, &stats);
+        GG_DataProbe_Accumulate(self->congestion_probe,
+                                stats.congestion_window * self->max_transport_fragment_size);
+    }
+}
+
+//----------------------------------------------------------------------
+// Deliver a frame to the user side sink, or the pending frame if frame is NULL.
+// If the sink pushes back, the frame is kept as the pending frame and
+// GG_ERROR_WOULD_BLOCK is returned. Frames that fail otherwise are dropped.
+//----------------------------------------------------------------------
+static GG_Result
+GG_GattlinkGenericClient_DeliverFrame(GG_GattlinkGenericClient* self, GG_Buffer* frame)
+{
+    if (frame == NULL) {
+        frame = self->user_side.pending_frame;
+        if (frame == NULL) {
+            return GG_SUCCESS;
+        }
+        self->user_side.pending_frame = NULL;
+    }
+
+    GG_Result result = GG_DataSink_PutData(self->user_side.sink, frame, NULL);
+    if (result == GG_ERROR_WOULD_BLOCK) {
+        // keep the frame until the sink calls us back
+        GG_LOG_FINE("sink would block, keeping the frame");
+        self->user_side.pending_frame = frame;
+        return result;
+    }
+    if (GG_FAILED(result)) {
+        GG_LOG_WARNING("GG_DataSink_PutData failed (%d), dropping frame", result);
+    }
+    GG_Buffer_Release(frame);
+
+    return GG_SUCCESS;
 }
 
 //----------------------------------------------------------------------
@@ -178,8 +620,13 @@ GG_GattlinkGenericClient_NotifyIncomingDataAvailable(GG_GattlinkClient* _self)
 {
     GG_GattlinkGenericClient* self = GG_SELF(GG_GattlinkGenericClient, GG_GattlinkClient);
 
+    // deliver any frame that was pushed back before assembling new ones
+    if (self->user_side.sink == NULL || GG_FAILED(GG_GattlinkGenericClient_DeliverFrame(self, NULL))) {
+        return;
+    }
+
     // feed the available data to the frame assembler until it stops consuming it
-    for (; self->user_side.sink != NULL;) {
+    for (;;) {
         // first, see how much we can feed the frame assembler
         uint8_t* feed_buffer = NULL;
         size_t   feed_buffer_size = 0;
@@ -216,27 +663,24 @@ GG_GattlinkGenericClient_NotifyIncomingDataAvailable(GG_GattlinkClient* _self)
             GG_LOG_WARNING("GG_FrameAssembler_Feed failed (%d)", result);
         }
 
-        // if we got a frame, send it now
-        if (frame) {
-            GG_LOG_FINE("got a frame");
-            result = GG_DataSink_PutData(self->user_side.sink, frame, NULL);
-            GG_Buffer_Release(frame);
-            if (GG_FAILED(result)) {
-                // couldn't send, so don't consume this data, we'll feed it again later
-                GG_LOG_WARNING("GG_DataSink_PutData failed (%d)", result);
-                break;
-            }
-        }
-
         // let the protocol know how much data we consumed
+        // (the assembler has taken those bytes, whether or not the frame can be delivered now)
         if (feed_buffer_size) {
             GG_GattlinkProtocol_ConsumeIncomingData(self->protocol, feed_buffer_size);
-        } else {
+        } else if (frame == NULL) {
             // nothing consumed?
             GG_LOG_WARNING("no data consumed by the frame assembler?");
             break;
         }
 
+        // if we got a frame, send it now (stop if the sink pushes back, we'll retry later)
+        if (frame) {
+            GG_LOG_FINE("got a frame");
+            if (GG_FAILED(GG_GattlinkGenericClient_DeliverFrame(self, frame))) {
+                break;
+            }
+        }
+
         // stop if we've fed everything
         if (feed_buffer_size == bytes_available) {
             break;
@@ -262,9 +706,14 @@ GG_GattlinkGenericClient_SendRawData(GG_GattlinkClient* _self, const void* data,
         return GG_ERROR_INVALID_STATE;
     }
 
+    // hold the packet until the end of the batch if we're batching
+    if (self->batch.enabled && self->batch.depth) {
+        return GG_GattlinkGenericClient_AddToBatch(self, data, data_size, 0, 0);
+    }
+
     // allocate a buffer to wrap the data
     GG_DynamicBuffer* buffer;
-    GG_Result result = GG_DynamicBuffer_Create(data_size, &buffer);
+    GG_Result result = GG_BufferPool_AllocateBuffer(self->packet_pool, data_size, &buffer);
     if (GG_FAILED(result)) return result;
 
     // copy the data into the buffer
@@ -282,16 +731,92 @@ GG_GattlinkGenericClient_SendRawData(GG_GattlinkClient* _self, const void* data,
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Send a packet with a payload taken straight from the output buffer
+//----------------------------------------------------------------------
+static GG_Result
+GG_GattlinkGenericClient_SendPacket(GG_GattlinkClient* _self,
+                                    const void*        header,
+                                    size_t             header_size,
+                                    size_t             payload_offset,
+                                    size_t             payload_size)
+{
+    GG_GattlinkGenericClient* self = GG_SELF(GG_GattlinkGenericClient, GG_GattlinkClient);
+    // check that we have a tansport sink
+    if (self->transport_side.sink == NULL) {
+        return GG_ERROR_INVALID_STATE;
+    }
+
+    // hold the packet until the end of the batch if we're batching
+    if (self->batch.enabled && self->batch.depth) {
+        return GG_GattlinkGenericClient_AddToBatch(self, header, header_size, payload_offset, payload_size);
+    }
+
+    GG_Buffer* packet = NULL;
+    GG_Result result = GG_GattlinkGenericClient_CreatePacketChain(self,
+                                                                  header,
+                                                                  header_size,
+                                                                  payload_offset,
+                                                                  payload_size,
+                                                                  &packet);
+    if (GG_FAILED(result)) {
+        // we're out of views (or memory), copy the payload instead
+        GG_LOG_FINER("can't reference the payload (%d), copying it", result);
+        result = GG_GattlinkGenericClient_CreatePacketCopy(self,
+                                                           header,
+                                                           header_size,
+                                                           payload_offset,
+                                                           payload_size,
+                                                           &packet);
+        if (GG_FAILED(result)) return result;
+    }
+
+    // send the packet to the transport-side sink, ignoring errors
+    GG_LOG_FINE("sending %u bytes to the transport", (int)(header_size + payload_size));
+    GG_DataSink_PutData(self->transport_side.sink, packet, NULL);
+
+    // don't keep a reference to the packet
+    GG_Buffer_Release(packet);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClient_BeginPacketBatch(GG_GattlinkClient* _self)
+{
+    GG_GattlinkGenericClient* self = GG_SELF(GG_GattlinkGenericClient, GG_GattlinkClient);
+    ++self->batch.depth;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_GattlinkGenericClient_EndPacketBatch(GG_GattlinkClient* _self)
+{
+    GG_GattlinkGenericClient* self = GG_SELF(GG_GattlinkGenericClient, GG_GattlinkClient);
+    GG_ASSERT(self->batch.depth);
+
+    // deliver the packets once the outermost batch ends
+    if (--self->batch.depth == 0) {
+        GG_GattlinkGenericClient_FlushBatch(self);
+    }
+}
+
 //----------------------------------------------------------------------
 static void
 GG_GattlinkGenericClient_Flush(GG_GattlinkGenericClient* self)
 {
-    // reset the frame assembler
+    // reset the frame assembler and drop any frame that was pushed back
     if (self->frame_assembler) {
         GG_FrameAssembler_Reset(self->frame_assembler);
     }
+    if (self->user_side.pending_frame) {
+        GG_Buffer_Release(self->user_side.pending_frame);
+        self->user_side.pending_frame = NULL;
+    }
 
     // reset the ring buffer
+    self->output_consumed += GG_RingBuffer_GetAvailable(&self->output_buffer);
     GG_RingBuffer_Reset(&self->output_buffer);
 }
 
@@ -304,6 +829,11 @@ GG_GattlinkGenericClient_NotifySessionReady(GG_GattlinkClient* _self)
     // remember that we have an open session
     self->session_open = true;
 
+    // start with a conservative tx window until we have measured the link
+    self->tx_window.size = 0;
+    GG_GattlinkGenericClient_SetTxWindowSize(self, GG_GENERIC_GATTLINK_CLIENT_INITIAL_TX_WINDOW_SIZE);
+    GG_GattlinkGenericClient_StartRateSample(self);
+
     // notify any listener who may be waiting for this
     if (self->user_side.sink_listener) {
         GG_DataSinkListener_OnCanPut(self->user_side.sink_listener);
@@ -382,11 +912,15 @@ GG_GattlinkGenericClient_UserSide_PutData(GG_DataSink* _self, GG_Buffer* data, c
         return GG_ERROR_WOULD_BLOCK;
     }
 
+    // don't overwrite data that the transport may still be reading through ring views
+    if (GG_GattlinkGenericClient_HasStaleRingViews(self)) {
+        GG_LOG_FINE("ring views still in use, waiting");
+        self->user_side_blocked = true;
+        return GG_ERROR_WOULD_BLOCK;
+    }
+
     // serialize the frame
-    GG_Result result = GG_FrameSerializer_SerializeFrame(self->frame_serializer,
-                                                         GG_Buffer_GetData(data),
-                                                         data_size,
-                                                         &self->output_buffer);
+    GG_Result result = GG_FrameSerializer_SerializeFrame(self->frame_serializer, data, &self->output_buffer);
     if (GG_FAILED(result)) {
         return result;
     }
@@ -463,21 +997,52 @@ GG_IMPLEMENT_INTERFACE(GG_GattlinkGenericClient_UserSide, GG_DataSinkListener) {
 };
 
 //----------------------------------------------------------------------
-static GG_Result
-GG_GattlinkGenericClient_TransportSide_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+static void
+GG_GattlinkGenericClient_HandleTransportPacket(GG_GattlinkGenericClient* self,
+                                               const uint8_t*            packet,
+                                               size_t                    packet_size)
 {
-    GG_COMPILER_UNUSED(metadata);
-    GG_GattlinkGenericClient* self = GG_SELF_M(transport_side, GG_GattlinkGenericClient, GG_DataSink);
-
-    GG_LOG_FINE("transport data, size=%u", (int)GG_Buffer_GetDataSize(data));
+    GG_LOG_FINE("transport data, size=%u", (int)packet_size);
 
     // forward the data to the protocol handler (ignore errors)
-    GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(self->protocol,
-                                                                 GG_Buffer_GetData(data),
-                                                                 GG_Buffer_GetDataSize(data));
+    GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(self->protocol, packet, packet_size);
     if (GG_FAILED(result)) {
         GG_LOG_WARNING("GG_GattlinkProtocol_HandleIncomingRawData failed (%d)", result);
     }
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_GattlinkGenericClient_TransportSide_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    GG_GattlinkGenericClient* self = GG_SELF_M(transport_side, GG_GattlinkGenericClient, GG_DataSink);
+    const uint8_t* packet      = GG_Buffer_GetData(data);
+    size_t         packet_size = GG_Buffer_GetDataSize(data);
+
+    // a batch of packets is handled one packet at a time
+    if (metadata && metadata->type == GG_BUFFER_METADATA_TYPE_GATTLINK_FRAGMENTS) {
+        const GG_GattlinkFragmentsMetadata* fragments = (const GG_GattlinkFragmentsMetadata*)metadata;
+        if (fragments->fragment_count > GG_GENERIC_GATTLINK_CLIENT_MAX_BATCH_FRAGMENTS) {
+            GG_LOG_WARNING("too many fragments in batch (%u)", (int)fragments->fragment_count);
+            return GG_ERROR_INVALID_PARAMETERS;
+        }
+        size_t batch_size = 0;
+        for (size_t i = 0; i < fragments->fragment_count; i++) {
+            batch_size += fragments->fragment_sizes[i];
+        }
+        if (batch_size != packet_size) {
+            GG_LOG_WARNING("batch size mismatch (%u != %u)", (int)batch_size, (int)packet_size);
+            return GG_ERROR_INVALID_PARAMETERS;
+        }
+
+        for (size_t i = 0; i < fragments->fragment_count; i++) {
+            GG_GattlinkGenericClient_HandleTransportPacket(self, packet, fragments->fragment_sizes[i]);
+            packet += fragments->fragment_sizes[i];
+        }
+        return GG_SUCCESS;
+    }
+
+    GG_GattlinkGenericClient_HandleTransportPacket(self, packet, packet_size);
 
     return GG_SUCCESS;
 }
@@ -549,7 +1114,10 @@ GG_IMPLEMENT_INTERFACE(GG_GattlinkGenericClient, GG_GattlinkClient) {
     GG_GattlinkGenericClient_SendRawData,
     GG_GattlinkGenericClient_NotifySessionReady,
     GG_GattlinkGenericClient_NotifySessionReset,
-    GG_GattlinkGenericClient_NotifySessionStalled
+    GG_GattlinkGenericClient_NotifySessionStalled,
+    GG_GattlinkGenericClient_SendPacket,
+    GG_GattlinkGenericClient_BeginPacketBatch,
+    GG_GattlinkGenericClient_EndPacketBatch
 };
 
 #if defined(GG_CONFIG_ENABLE_INSPECTION)
@@ -573,6 +1141,49 @@ GG_GattlinkGenericClient_Inspect(GG_Inspectable* _self, GG_Inspector* inspector,
                            "max_transport_fragment_size",
                            self->max_transport_fragment_size,
                            GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInspectable(inspector, "packet_pool", GG_BufferPool_AsInspectable(self->packet_pool));
+    GG_Inspector_OnInteger(inspector,
+                           "tx_window_size",
+                           GG_GattlinkProtocol_GetTxWindowSize(self->protocol),
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+
+    GG_GattlinkProtocolStats stats;
+    GG_GattlinkProtocol_GetStats(self->protocol, &stats);
+    GG_Inspector_OnInteger(inspector, "smoothed_rtt", stats.smoothed_rtt, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "rtt_variance", stats.rtt_variance, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "retransmit_timeout",
+                           stats.retransmit_timeout,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector, "ack_delay", stats.ack_delay, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "rtt_sample_count",
+                           stats.rtt_sample_count,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "retransmit_timeout_count",
+                           stats.retransmit_timeout_count,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "congestion_window",
+                           stats.congestion_window,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "slow_start_threshold",
+                           stats.slow_start_threshold,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "congestion_event_count",
+                           stats.congestion_event_count,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "data_packet_count",
+                           stats.data_packet_count,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnInteger(inspector,
+                           "retransmitted_packet_count",
+                           stats.retransmitted_packet_count,
+                           GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
 
     return GG_SUCCESS;
 }
@@ -632,15 +1243,21 @@ GG_GattlinkGenericClient_Create(GG_TimerScheduler*            timer_scheduler,
     }
 
     // check window bounds and compute final values
-    GG_GattlinkSessionConfig config = {
-        max_tx_window_size ? max_tx_window_size : GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_TX_WINDOW_SIZE,
-        max_rx_window_size ? max_rx_window_size : GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_RX_WINDOW_SIZE
-    };
+    // (the timing parameters are left at 0 to use the protocol defaults)
+    GG_GattlinkSessionConfig config;
+    memset(&config, 0, sizeof(config));
+    config.max_tx_window_size =
+        max_tx_window_size ? max_tx_window_size : GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_TX_WINDOW_SIZE;
+    config.max_rx_window_size =
+        max_rx_window_size ? max_rx_window_size : GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_RX_WINDOW_SIZE;
+    config.congestion_control = GG_CONFIG_GATTLINK_CLIENT_CONGESTION_CONTROL;
 
     // setup the state
     GG_EventEmitterBase_Init(&self->event_emitter);
+    self->timer_scheduler             = timer_scheduler;
     self->session_open                = false;
     self->max_transport_fragment_size = GG_MIN(max_transport_fragment_size, GG_GATTLINK_MAX_PACKET_SIZE);
+    self->batch.metadata.base = GG_BUFFER_METADATA_INITIALIZER(GATTLINK_FRAGMENTS, GG_GattlinkFragmentsMetadata);
     self->max_tx_window_size          = config.max_tx_window_size;
     self->frame_serializer            = frame_serializer;
     self->frame_assembler             = frame_assembler;
@@ -657,12 +1274,25 @@ GG_GattlinkGenericClient_Create(GG_TimerScheduler*            timer_scheduler,
     GG_SET_INTERFACE(&self->transport_side, GG_GattlinkGenericClient_TransportSide, GG_DataSinkListener);
     GG_IF_INSPECTION_ENABLED(GG_SET_INTERFACE(self, GG_GattlinkGenericClient, GG_Inspectable));
 
-    // init the buffer
+    // init the buffer and the views used to send data from it
     GG_RingBuffer_Init(&self->output_buffer, buffer, buffer_size);
+    for (unsigned int i = 0; i < GG_CONFIG_GATTLINK_CLIENT_RING_VIEW_COUNT; i++) {
+        self->ring_views[i].client = self;
+        GG_SET_INTERFACE(&self->ring_views[i], GG_GattlinkGenericClientRingView, GG_Buffer);
+    }
+
+    // create a pool for the packets sent to the transport
+    GG_Result result = GG_BufferPool_Create(self->max_transport_fragment_size,
+                                            GG_CONFIG_GATTLINK_CLIENT_PACKET_POOL_SIZE,
+                                            &self->packet_pool);
+    if (GG_FAILED(result)) {
+        GG_GattlinkGenericClient_Destroy(self);
+        return result;
+    }
 
     // register the client
     GG_GattlinkClient* client = GG_CAST(self, GG_GattlinkClient);
-    GG_Result result = GG_GattlinkProtocol_Create(client,
+    result = GG_GattlinkProtocol_Create(client,
                                                   &config,
                                                   timer_scheduler,
                                                   &self->protocol);
@@ -685,6 +1315,19 @@ GG_GattlinkGenericClient_Create(GG_TimerScheduler*            timer_scheduler,
             goto end;
         }
 
+        // the congestion window is sampled over the same window, so that its average can be
+        // compared with the buffer fullness
+        result = GG_DataProbe_Create(GG_DATA_PROBE_OPTION_WINDOW_INTEGRAL,
+                                     self->probe_config.buffer_sample_count,
+                                     self->probe_config.window_size_ms,
+                                     0,
+                                     NULL,
+                                     &self->congestion_probe);
+        if (GG_FAILED(result)) {
+            GG_LOG_WARNING("Unable to create data probe!");
+            goto end;
+        }
+
         result = GG_TimerScheduler_CreateTimer(timer_scheduler, &self->buffer_fullness_timer);
         if (GG_FAILED(result)) {
             GG_LOG_WARNING("Unable to create data probe!");
@@ -717,9 +1360,6 @@ GG_GattlinkGenericClient_Destroy(GG_GattlinkGenericClient* self)
         GG_DataSink_SetListener(self->transport_side.sink, NULL);
     }
 
-    // free the ring buffer memory
-    GG_FreeMemory(self->output_buffer.data.start);
-
     // deregister the client
     GG_GattlinkProtocol_Destroy(self->protocol);
 
@@ -731,10 +1371,40 @@ GG_GattlinkGenericClient_Destroy(GG_GattlinkGenericClient* self)
 
     // free the probe and timer
     GG_DataProbe_Destroy(self->probe);
+    GG_DataProbe_Destroy(self->congestion_probe);
     GG_Timer_Destroy(self->buffer_fullness_timer);
 
-    // free the object memory
-    GG_ClearAndFreeObject(self, 2);
+    // free the packet pool, any batch in progress and any pending frame
+    GG_BufferPool_Destroy(self->packet_pool);
+    if (self->user_side.pending_frame) {
+        GG_Buffer_Release(self->user_side.pending_frame);
+        self->user_side.pending_frame = NULL;
+    }
+    if (self->batch.buffer) {
+        GG_DynamicBuffer_Release(self->batch.buffer);
+        self->batch.buffer = NULL;
+    }
+
+    // the transport may still hold views of the output buffer, in which case
+    // the last one to be released will free the memory
+    self->destroyed = true;
+    if (self->ring_views_in_use == 0) {
+        GG_GattlinkGenericClient_Free(self);
+    }
+}
+
+//----------------------------------------------------------------------
+GG_DataProbe*
+GG_GattlinkGenericClient_GetCongestionWindowProbe(GG_GattlinkGenericClient* self)
+{
+    return self->congestion_probe;
+}
+
+//----------------------------------------------------------------------
+void
+GG_GattlinkGenericClient_GetStats(GG_GattlinkGenericClient* self, GG_GattlinkProtocolStats* stats)
+{
+    GG_GattlinkProtocol_GetStats(self->protocol, stats);
 }
 
 //----------------------------------------------------------------------
@@ -773,6 +1443,16 @@ GG_GattlinkGenericClient_Reset(GG_GattlinkGenericClient* self)
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+void
+GG_GattlinkGenericClient_EnableTransportBatching(GG_GattlinkGenericClient* self, bool enable)
+{
+    if (!enable) {
+        GG_GattlinkGenericClient_FlushBatch(self);
+    }
+    self->batch.enabled = enable;
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_GattlinkGenericClient_SetMaxTransportFragmentSize(GG_GattlinkGenericClient* self,
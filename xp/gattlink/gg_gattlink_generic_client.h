@@ -27,6 +27,7 @@
 #include "xp/common/gg_inspect.h"
 #include "xp/gattlink/gg_gattlink.h"
 #include "xp/protocols/gg_protocols.h"
+#include "xp/utils/gg_data_probe.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -99,12 +100,30 @@ typedef struct {
     uint32_t buffer_threshold;       ///< Threshold to use for when deciding to send event.
 } GG_GattlinkProbeConfig;
 
+/**
+ * Max number of transport packets in a batch (see GG_GattlinkGenericClient_EnableTransportBatching).
+ */
+#define GG_GENERIC_GATTLINK_CLIENT_MAX_BATCH_FRAGMENTS 16
+
+/**
+ * Metadata attached to a buffer that carries several transport packets (fragments) back to back.
+ */
+typedef struct {
+    GG_BufferMetadata base;
+    size_t            fragment_count;                                           ///< Number of fragments
+    uint16_t          fragment_sizes[GG_GENERIC_GATTLINK_CLIENT_MAX_BATCH_FRAGMENTS]; ///< Size of each fragment
+} GG_GattlinkFragmentsMetadata;
+
 
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
-#define GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_TX_WINDOW_SIZE    8
-#define GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_RX_WINDOW_SIZE    8
+// Default window sizes, for sessions using the extended packet format
+// (the protocol caps them for peers that only support the base format)
+#define GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_TX_WINDOW_SIZE    32
+#define GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_RX_WINDOW_SIZE    32
+#define GG_GENERIC_GATTLINK_CLIENT_INITIAL_TX_WINDOW_SIZE        8  ///< Tx window used until the link is measured
+#define GG_GENERIC_GATTLINK_CLIENT_MIN_TX_WINDOW_SIZE            2
 #define GG_GENERIC_GATTLINK_CLIENT_OUTPUT_BUFFER_MONITOR_TIMEOUT 5000
 
 /**
@@ -153,6 +172,12 @@ typedef struct {
  */
 #define GG_EVENT_TYPE_GATTLINK_SESSION_STALLED GG_4CC('g', 'l', 's', '#')
 
+/**
+ * Buffer metadata type that indicates that a buffer carries several transport packets.
+ * Metadata structs with this type ID must be of type GG_GattlinkFragmentsMetadata
+ */
+#define GG_BUFFER_METADATA_TYPE_GATTLINK_FRAGMENTS GG_4CC('g', 'l', 'f', 'b')
+
 /*----------------------------------------------------------------------
 |   functions
 +---------------------------------------------------------------------*/
@@ -163,6 +188,9 @@ typedef struct {
  * @param timer_scheduler Timer scheduler used for retransmit and delayed ack timers.
  * @param buffer_size Size of the circular buffer where data is held before being sent to the transport.
  * @param max_tx_window_size Maximum outgoing window size, or 0 to use the default value.
+ * The actual outgoing window is sized, within that limit, from the measured round-trip time,
+ * delivery rate and transport fragment size, and the packets in flight are further limited by
+ * the protocol's congestion control (see GG_CONFIG_GATTLINK_CLIENT_CONGESTION_CONTROL).
  * @param max_rx_window_size Maximum incoming window size, or 0 to use the default value.
  * @param initial_max_transport_fragment_size Initial value of the maximum size that may be sent to the
  * transport in a single packet. This value may be changed later by calling
@@ -209,6 +237,27 @@ GG_EventEmitter* GG_GattlinkGenericClient_AsEventEmitter(GG_GattlinkGenericClien
  */
 GG_Inspectable* GG_GattlinkGenericClient_AsInspectable(GG_GattlinkGenericClient* self);
 
+/**
+ * Get the data probe that samples the congestion window of the session, in bytes
+ * (the number of packets allowed in flight times the max transport fragment size),
+ * each time outgoing data is acked.
+ * The probe's windowed byte-seconds, divided by the probe window size, give the average
+ * congestion window over that window.
+ *
+ * @param self The object on which this method is invoked.
+ *
+ * @return The probe, or NULL if the client was created without a probe config.
+ */
+GG_DataProbe* GG_GattlinkGenericClient_GetCongestionWindowProbe(GG_GattlinkGenericClient* self);
+
+/**
+ * Get the timing estimates and counters of the underlying protocol session.
+ *
+ * @param self The object on which this method is invoked.
+ * @param stats Pointer to the struct in which the stats will be returned.
+ */
+void GG_GattlinkGenericClient_GetStats(GG_GattlinkGenericClient* self, GG_GattlinkProtocolStats* stats);
+
 /**
  * Start the session.
  *
@@ -228,6 +277,22 @@ GG_Result GG_GattlinkGenericClient_Start(GG_GattlinkGenericClient* self);
  */
 GG_Result GG_GattlinkGenericClient_Reset(GG_GattlinkGenericClient* self);
 
+/**
+ * Enable or disable the batching of transport packets.
+ * When enabled, the packets that the protocol sends in one go are delivered to the
+ * transport-side sink as a single buffer, with a GG_GattlinkFragmentsMetadata that gives
+ * the size of each packet, so that sinks with a high per-call cost (like thread or
+ * language boundaries) pay it once per batch. A batch of one packet is delivered as a
+ * plain packet, without metadata.
+ * This must only be enabled when the transport-side sink handles that metadata (the
+ * transport-side sink of a GG_GattlinkGenericClient always does).
+ * Batching is disabled by default.
+ *
+ * @param self The object on which this method is invoked.
+ * @param enable True to enable batching, false to disable it.
+ */
+void GG_GattlinkGenericClient_EnableTransportBatching(GG_GattlinkGenericClient* self, bool enable);
+
 /**
  * Set the maximum transport fragment size.
  * This parameter has the same semantics as the one passed to the constructor.
@@ -27,6 +27,17 @@
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
+/**
+ * Handler for events on a file descriptor.
+ *
+ * The `event_mask` field may be modified by the handler at any time to select which
+ * conditions it wants to be notified of. Before the handler is called, the loop sets
+ * `event_flags` to the conditions that are true.
+ * A handler that reads until the file descriptor has no more data available (i.e until
+ * a read would block) may clear #GG_EVENT_FLAG_FD_CAN_READ from `event_flags` before
+ * returning, to let loop implementations that are edge-triggered know that they don't
+ * need to check again for readability until the next edge.
+ */
 typedef struct {
     GG_LoopEventHandlerItem base;
     int                     fd;
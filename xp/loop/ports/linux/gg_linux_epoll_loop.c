@@ -0,0 +1,703 @@
+/**
+ *
+ * @file
+ *
+ * @copyright
+ * Copyright 2017-2020 Fitbit, Inc
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * @author Gilles Boccon-Gibod
+ *
+ * @date 2026-10-16
+ *
+ * @details
+ *
+ * Event loop implementation based on the Linux epoll() API.
+ *
+ * File descriptors are registered once, in edge-triggered mode, when a handler
+ * is added, and stay registered until the handler is removed. Readiness edges
+ * reported by the kernel are accumulated in a per-handler entry, and only the
+ * entries that have pending readiness are looked at on each iteration, so the
+ * cost of an iteration grows with the number of ready file descriptors, not
+ * with the number of registered ones.
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "xp/common/gg_types.h"
+#include "xp/common/gg_utils.h"
+#include "xp/common/gg_lists.h"
+#include "xp/common/gg_memory.h"
+#include "xp/common/gg_system.h"
+#include "xp/common/gg_logging.h"
+#include "xp/common/gg_results.h"
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_threads.h"
+#include "xp/loop/gg_loop.h"
+#include "xp/loop/gg_loop_base.h"
+#include "xp/loop/extensions/gg_loop_fd.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+GG_SET_LOCAL_LOGGER("gg.xp.loop.linux-epoll")
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#if !defined(GG_CONFIG_LINUX_EPOLL_LOOP_MAX_EVENTS)
+#define GG_CONFIG_LINUX_EPOLL_LOOP_MAX_EVENTS 64 // max number of events returned by one epoll_wait() call
+#endif
+
+#define GG_LINUX_EPOLL_LOOP_MIN_ENTRY_TABLE_SIZE 64
+
+// events we register for. We always register for all the events we may
+// be interested in, so that the registration never needs to be modified when
+// a handler changes its event mask.
+#define GG_LINUX_EPOLL_LOOP_EVENTS (EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLET)
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * Per-file-descriptor state maintained by the loop.
+ */
+typedef struct {
+    GG_LoopFileDescriptorEventHandler* handler;
+    GG_LinkedListNode                  ready_node;  ///< linked in the ready list when ready_flags != 0
+    uint32_t                           ready_flags; ///< readiness conditions not yet delivered to the handler
+} GG_EpollLoopEntry;
+
+struct GG_Loop {
+    // inherited base class
+    GG_LoopBase base;
+
+    // subclass members
+    int                               epoll_fd;
+    GG_LoopFileDescriptorEventHandler wakeup_handler;
+    int                               wakeup_fd;
+    GG_LinkedList                     monitor_handlers; ///< all registered handlers
+    GG_EpollLoopEntry**               entries;          ///< entries indexed by file descriptor
+    size_t                            entry_table_size;
+    GG_LinkedList                     ready_entries;    ///< entries with pending readiness
+    GG_EpollLoopEntry*                current_entry;    ///< entry for which a handler is being invoked
+    struct epoll_event                events[GG_CONFIG_LINUX_EPOLL_LOOP_MAX_EVENTS];
+};
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+
+//----------------------------------------------------------------------
+#if defined(GG_CONFIG_ENABLE_INSPECTION)
+GG_Inspectable*
+GG_Loop_AsInspectable(GG_Loop* self)
+{
+    return GG_CAST(&self->base, GG_Inspectable);
+}
+
+static GG_Result
+GG_Loop_Inspect(GG_Inspectable* _self, GG_Inspector* inspector, const GG_InspectionOptions* options)
+{
+    GG_COMPILER_UNUSED(options);
+    GG_Loop* self = GG_SELF_M(base, GG_Loop, GG_Inspectable);
+
+    GG_Inspector_OnInteger(inspector, "start_time", (int64_t)self->base.start_time, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    GG_Inspector_OnArrayStart(inspector, "monitors");
+    GG_LINKED_LIST_FOREACH(node, &self->monitor_handlers) {
+        GG_LoopFileDescriptorEventHandler* handler =
+            GG_LINKED_LIST_ITEM(node, GG_LoopFileDescriptorEventHandler, base.list_node);
+        GG_Inspector_OnObjectStart(inspector, NULL);
+        GG_Inspector_OnInteger(inspector, "fd",          handler->fd,          GG_INSPECTOR_FORMAT_HINT_NONE);
+        GG_Inspector_OnInteger(inspector, "event_flags", handler->event_flags, GG_INSPECTOR_FORMAT_HINT_HEX);
+        GG_Inspector_OnInteger(inspector, "event_mask",  handler->event_mask,  GG_INSPECTOR_FORMAT_HINT_HEX);
+        if (handler->fd >= 0 && (size_t)handler->fd < self->entry_table_size && self->entries[handler->fd]) {
+            GG_Inspector_OnInteger(inspector,
+                                   "ready_flags",
+                                   self->entries[handler->fd]->ready_flags,
+                                   GG_INSPECTOR_FORMAT_HINT_HEX);
+        }
+        GG_Inspector_OnObjectEnd(inspector);
+    }
+    GG_Inspector_OnArrayEnd(inspector);
+
+    return GG_SUCCESS;
+}
+
+GG_IMPLEMENT_INTERFACE(GG_Loop, GG_Inspectable) {
+    .Inspect = GG_Loop_Inspect
+};
+#endif
+
+//----------------------------------------------------------------------
+// Map epoll events to GG_EVENT_FLAG_FD_XXX flags.
+// A pending error is reported as readable and writable, like select() does,
+// so that handlers get a chance to pick up the error with their next I/O call.
+//----------------------------------------------------------------------
+static uint32_t
+GG_Loop_MapEpollEvents(uint32_t events)
+{
+    uint32_t flags = 0;
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        flags |= GG_EVENT_FLAG_FD_CAN_READ;
+    }
+    if (events & (EPOLLOUT | EPOLLERR)) {
+        flags |= GG_EVENT_FLAG_FD_CAN_WRITE;
+    }
+    if (events & (EPOLLPRI | EPOLLERR)) {
+        flags |= GG_EVENT_FLAG_FD_ERROR;
+    }
+
+    return flags;
+}
+
+//----------------------------------------------------------------------
+// Returns true if at least one of the ready entries can be delivered to its
+// handler without waiting.
+//----------------------------------------------------------------------
+static bool
+GG_Loop_HasDeliverableEntries(GG_Loop* self)
+{
+    GG_LINKED_LIST_FOREACH(node, &self->ready_entries) {
+        GG_EpollLoopEntry* entry = GG_LINKED_LIST_ITEM(node, GG_EpollLoopEntry, ready_node);
+        if (entry->ready_flags & entry->handler->event_mask) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------
+// Deliver the pending events of an entry to its handler.
+// Returns false if the handler was removed while it was being called, in which
+// case the entry no longer exists.
+//----------------------------------------------------------------------
+static bool
+GG_Loop_DeliverEvents(GG_Loop* self, GG_EpollLoopEntry* entry)
+{
+    GG_LoopFileDescriptorEventHandler* handler = entry->handler;
+
+    // conditions the handler is interested in
+    uint32_t event_flags = entry->ready_flags & handler->event_mask;
+
+    // conditions other than CAN_READ are only meaningful if the handler is
+    // waiting for them right now (a handler only starts waiting for CAN_WRITE
+    // after a write would block, in which case a new edge will be reported),
+    // whereas readability persists until the handler drains the file descriptor,
+    // so we keep it pending until the handler is interested in it.
+    entry->ready_flags &= GG_EVENT_FLAG_FD_CAN_READ;
+    entry->ready_flags &= ~event_flags;
+    if (!event_flags) {
+        return true;
+    }
+
+    // call the handler
+    handler->event_flags = event_flags;
+    self->current_entry = entry;
+    GG_LoopEventHandler_OnEvent(GG_CAST(&handler->base, GG_LoopEventHandler), self);
+
+    // check that the handler hasn't been removed while we were calling it
+    if (self->current_entry == NULL) {
+        return false;
+    }
+    self->current_entry = NULL;
+
+    // a handler that has read everything it could from the file descriptor
+    // clears the CAN_READ flag. If it didn't, we don't know if there's more
+    // to read, so we re-arm the registration, which causes the kernel to
+    // report a new edge if the file descriptor is still readable.
+    if ((event_flags & GG_EVENT_FLAG_FD_CAN_READ) && (handler->event_flags & GG_EVENT_FLAG_FD_CAN_READ)) {
+        struct epoll_event event = {
+            .events   = GG_LINUX_EPOLL_LOOP_EVENTS,
+            .data.ptr = entry
+        };
+        if (epoll_ctl(self->epoll_fd, EPOLL_CTL_MOD, handler->fd, &event)) {
+            GG_LOG_WARNING("epoll_ctl(MOD) failed for fd %d (%d)", handler->fd, errno);
+        }
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_Loop_MonitorFileDescriptors(GG_Loop* self, uint32_t max_wait_time_ms)
+{
+    // don't wait if some events are ready to be delivered
+    int timeout = -1;
+    if (GG_Loop_HasDeliverableEntries(self)) {
+        timeout = 0;
+    } else if (max_wait_time_ms != GG_TIMER_NEVER) {
+        timeout = (int)GG_MIN(max_wait_time_ms, (uint32_t)INT32_MAX);
+    }
+
+    // wait for a file descriptor to be ready or a timeout
+    int event_count;
+    do {
+        GG_LOG_FINER("waiting for events, timeout=%d", timeout);
+        event_count = epoll_wait(self->epoll_fd,
+                                 self->events,
+                                 GG_CONFIG_LINUX_EPOLL_LOOP_MAX_EVENTS,
+                                 timeout);
+        GG_LOG_FINER("epoll_wait returned %d", event_count);
+    } while (event_count < 0 && errno == EINTR);
+
+    // check for errors
+    if (event_count < 0) {
+        return GG_ERROR_ERRNO(errno);
+    }
+
+    // update the timer scheduler now so that its notion of time is current
+    GG_LoopBase_UpdateTime(&self->base);
+
+    // record the readiness edges
+    for (int i = 0; i < event_count; i++) {
+        GG_EpollLoopEntry* entry = (GG_EpollLoopEntry*)self->events[i].data.ptr;
+        entry->ready_flags |= GG_Loop_MapEpollEvents(self->events[i].events);
+        if (entry->ready_flags && GG_LINKED_LIST_NODE_IS_UNLINKED(&entry->ready_node)) {
+            GG_LINKED_LIST_APPEND(&self->ready_entries, &entry->ready_node);
+        }
+    }
+
+    // IMPORTANT NOTE
+    // because we are calling handlers during an iteration of the ready
+    // list, and handlers may be causing entries in the list to be
+    // removed (ex: a socket being destroyed), we proceed in two steps:
+    // * first, we move the list to a temporary list variable that we use
+    //   as a queue of entries to process
+    // * then we process entries in the queue, one by one, always taking the
+    //   first entry in the queue, processing it and then moving it back to
+    //   the ready list if it still has some pending conditions.
+    // (since we're only looking at the head of the queue, and not
+    // iterating further through it, that is safe)
+    GG_LinkedList entry_queue = GG_LINKED_LIST_INITIALIZER(entry_queue);
+    GG_LINKED_LIST_MOVE(&self->ready_entries, &entry_queue);
+    while (!GG_LINKED_LIST_IS_EMPTY(&entry_queue)) {
+        // pop the head of the queue
+        GG_LinkedListNode* head;
+        GG_LINKED_LIST_POP_HEAD(head, &entry_queue);
+        GG_EpollLoopEntry* entry = GG_LINKED_LIST_ITEM(head, GG_EpollLoopEntry, ready_node);
+
+        // move it back to the ready list right away, so that it can be
+        // unlinked safely if the handler is removed during the call
+        GG_LINKED_LIST_APPEND(&self->ready_entries, head);
+
+        // deliver the events, and if the entry still exists and has nothing
+        // pending anymore, remove it from the ready list
+        if (GG_Loop_DeliverEvents(self, entry) &&
+            !entry->ready_flags &&
+            !GG_LINKED_LIST_NODE_IS_UNLINKED(&entry->ready_node)) {
+            GG_LINKED_LIST_NODE_REMOVE(&entry->ready_node);
+        }
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Inner loop, called from within an auto-release wrapper
+// (because some platforms need the wrapper to avoid retainining released
+// objects forever)
+//
+// Returns GG_SUCCESS if the loop should continue, or GG_FAILURE if it should stop
+//----------------------------------------------------------------------
+static GG_Result
+GG_Loop_Inner(void* _self)
+{
+    GG_Loop* self = _self;
+
+    // process all timers
+    uint32_t max_wait_time = GG_LoopBase_CheckTimers(&self->base);
+
+    // check for termination in case a timer handler requested it
+    if (self->base.termination_requested) {
+        return GG_ERROR_INTERRUPTED;
+    }
+
+    // wait for I/O or messages
+    GG_Result result = GG_Loop_MonitorFileDescriptors(self, max_wait_time);
+    if (GG_FAILED(result)) {
+        GG_LOG_WARNING("GG_Loop_MonitorFileDescriptors failed (%d)", result);
+        return result;
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_Run(GG_Loop* self)
+{
+    GG_LOG_INFO("loop starting");
+
+    // if it isn't already bound, bind the loop to the current thread
+    GG_ASSERT(!GG_THREAD_GUARD_IS_OBJECT_BOUND(&self->base) || GG_THREAD_GUARD_IS_CURRENT_THREAD_BOUND(&self->base));
+    if (!GG_THREAD_GUARD_IS_OBJECT_BOUND(&self->base)) {
+        GG_Result result = GG_Loop_BindToCurrentThread(self);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+
+    // loop until termination
+    GG_Result result = GG_SUCCESS;
+    self->base.termination_requested = false;
+    while (!self->base.termination_requested) {
+        // call the inner part of the loop from within a wrapper function
+        result = GG_AutoreleaseWrap(GG_Loop_Inner, self);
+        if (GG_FAILED(result)) {
+            if (result == GG_ERROR_INTERRUPTED && self->base.termination_requested) {
+                // that's a normal termination, don't report an error
+                result = GG_SUCCESS;
+            }
+            break;
+        }
+    }
+    GG_LOG_INFO("loop terminating");
+
+    return result;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_Loop_SendWakeup(GG_Loop* self)
+{
+    uint64_t increment = 1;
+    ssize_t io_result;
+    do {
+        GG_LOG_FINEST("writing to wakeup fd");
+        io_result = write(self->wakeup_fd, &increment, sizeof(increment));
+    } while (io_result < 0 && errno == EINTR);
+
+    if (io_result < 0) {
+        // ignore the error that indicates that the counter would overflow,
+        // because in that case the other side will wake up anyway from
+        // what's already pending.
+        if (errno != EAGAIN) {
+            GG_LOG_WARNING("write failed, errno=%d", errno);
+            return GG_ERROR_ERRNO(errno);
+        }
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_PostMessage(GG_Loop* self, GG_LoopMessage* message, GG_Timeout timeout)
+{
+    // call the base implementation to post the message in the queue
+    GG_Result result = GG_LoopBase_PostMessage(&self->base, message, timeout);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+
+    // wake up the loop
+    return GG_Loop_SendWakeup(self);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_InvokeSync(GG_Loop*            self,
+                   GG_LoopSyncFunction function,
+                   void*               function_argument,
+                   int*                function_result)
+{
+    if (!self) {
+        GG_LOG_WARNING("InvokeSync(%p, %p) called without GG Loop running", (void*)function, function_argument);
+        return GG_ERROR_INVALID_STATE;
+    }
+    return GG_LoopBase_InvokeSync(&self->base, function, function_argument, function_result);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_InvokeAsync(GG_Loop*             self,
+                    GG_LoopAsyncFunction function,
+                    void*                function_argument)
+{
+    if (!self) {
+        GG_LOG_WARNING("InvokeAsync(%p, %p) called without GG Loop running", (void*)function, function_argument);
+        return GG_ERROR_INVALID_STATE;
+    }
+    return GG_LoopBase_InvokeAsync(&self->base, function, function_argument);
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_Loop_ReserveEntries(GG_Loop* self, int fd)
+{
+    if ((size_t)fd < self->entry_table_size) {
+        return GG_SUCCESS;
+    }
+
+    // grow the table by doubling its size until the fd fits
+    size_t new_size = GG_MAX(self->entry_table_size, GG_LINUX_EPOLL_LOOP_MIN_ENTRY_TABLE_SIZE);
+    while (new_size <= (size_t)fd) {
+        new_size *= 2;
+    }
+    GG_EpollLoopEntry** new_entries = GG_AllocateZeroMemory(new_size * sizeof(GG_EpollLoopEntry*));
+    if (new_entries == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+    if (self->entries) {
+        memcpy(new_entries, self->entries, self->entry_table_size * sizeof(GG_EpollLoopEntry*));
+        GG_FreeMemory(self->entries);
+    }
+    self->entries          = new_entries;
+    self->entry_table_size = new_size;
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_AddFileDescriptorHandler(GG_Loop*                           self,
+                                 GG_LoopFileDescriptorEventHandler* handler)
+{
+    GG_ASSERT(self);
+
+    // remove first in case this handler is already registered (should not happen)
+    if (!GG_LINKED_LIST_NODE_IS_UNLINKED(&handler->base.list_node)) {
+        GG_Loop_RemoveFileDescriptorHandler(self, handler);
+    }
+
+    // register with epoll
+    if (handler->fd >= 0) {
+        GG_Result result = GG_Loop_ReserveEntries(self, handler->fd);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+        if (self->entries[handler->fd]) {
+            GG_LOG_WARNING("fd %d already has a handler", handler->fd);
+            return GG_ERROR_INVALID_STATE;
+        }
+
+        GG_EpollLoopEntry* entry = GG_AllocateZeroMemory(sizeof(GG_EpollLoopEntry));
+        if (entry == NULL) {
+            return GG_ERROR_OUT_OF_MEMORY;
+        }
+        entry->handler = handler;
+
+        struct epoll_event event = {
+            .events   = GG_LINUX_EPOLL_LOOP_EVENTS,
+            .data.ptr = entry
+        };
+        if (epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, handler->fd, &event)) {
+            result = GG_ERROR_ERRNO(errno);
+            GG_LOG_WARNING("epoll_ctl(ADD) failed for fd %d (%d)", handler->fd, result);
+            GG_FreeMemory(entry);
+            return result;
+        }
+        self->entries[handler->fd] = entry;
+    }
+
+    // add the handler to the monitors
+    GG_LINKED_LIST_APPEND(&self->monitor_handlers, &handler->base.list_node);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_RemoveFileDescriptorHandler(GG_Loop*                           self,
+                                    GG_LoopFileDescriptorEventHandler* handler)
+{
+    GG_ASSERT(self);
+
+    // check that this handler is linked
+    if (GG_LINKED_LIST_NODE_IS_UNLINKED(&handler->base.list_node)) {
+        return GG_SUCCESS;
+    }
+
+    // remove the handler from the monitors
+    GG_LINKED_LIST_NODE_REMOVE(&handler->base.list_node);
+
+    // unregister from epoll
+    if (handler->fd < 0 || (size_t)handler->fd >= self->entry_table_size) {
+        return GG_SUCCESS;
+    }
+    GG_EpollLoopEntry* entry = self->entries[handler->fd];
+    if (entry == NULL || entry->handler != handler) {
+        return GG_SUCCESS;
+    }
+    if (epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, handler->fd, NULL)) {
+        GG_LOG_FINE("epoll_ctl(DEL) failed for fd %d (%d)", handler->fd, errno);
+    }
+    if (!GG_LINKED_LIST_NODE_IS_UNLINKED(&entry->ready_node)) {
+        GG_LINKED_LIST_NODE_REMOVE(&entry->ready_node);
+    }
+    if (self->current_entry == entry) {
+        self->current_entry = NULL;
+    }
+    self->entries[handler->fd] = NULL;
+    GG_FreeMemory(entry);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_Loop_OnEvent(GG_LoopEventHandler* _self, GG_Loop* loop)
+{
+    GG_ASSERT(_self);
+    GG_COMPILER_UNUSED(loop);
+    GG_Loop* self = GG_SELF_M(wakeup_handler.base, GG_Loop, GG_LoopEventHandler);
+
+    // reset the eventfd counter, ignoring errors
+    uint64_t counter;
+    ssize_t io_result;
+    do {
+        io_result = read(self->wakeup_fd, &counter, sizeof(counter));
+    } while (io_result < 0 && errno == EINTR);
+
+    // let the loop know that we have drained the file descriptor
+    self->wakeup_handler.event_flags &= ~GG_EVENT_FLAG_FD_CAN_READ;
+
+    // process all queued messages without waiting
+    GG_Result result;
+    unsigned int message_count = 0;
+    do {
+        result = GG_LoopBase_ProcessMessage(&self->base, 0);
+        ++message_count;
+    } while (GG_SUCCEEDED(result));
+    GG_LOG_FINER("processed %d messages", (int)(message_count-1));
+}
+
+//----------------------------------------------------------------------
+GG_TimerScheduler*
+GG_Loop_GetTimerScheduler(GG_Loop* self)
+{
+    GG_ASSERT(self);
+    return self->base.timer_scheduler;
+}
+
+//----------------------------------------------------------------------
+void
+GG_Loop_RequestTermination(GG_Loop* self)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(&self->base);
+
+    GG_LoopBase_RequestTermination(&self->base);
+}
+
+//----------------------------------------------------------------------
+GG_LoopMessage*
+GG_Loop_CreateTerminationMessage(GG_Loop* self)
+{
+    return GG_LoopBase_CreateTerminationMessage(&self->base);
+}
+
+/*----------------------------------------------------------------------
+|   function table
++---------------------------------------------------------------------*/
+GG_IMPLEMENT_INTERFACE(GG_Loop, GG_LoopEventHandler) {
+    GG_Loop_OnEvent
+};
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_BindToCurrentThread(GG_Loop* self)
+{
+    return GG_LoopBase_BindToCurrentThread(&self->base);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_Loop_Create(GG_Loop** loop)
+{
+    GG_ASSERT(loop);
+
+    // default return value
+    *loop = NULL;
+
+    // allocate a new object
+    GG_Loop* self = (GG_Loop*)GG_AllocateZeroMemory(sizeof(GG_Loop));
+    if (self == NULL) return GG_ERROR_OUT_OF_MEMORY;
+
+    // init the file descriptors so we don't risk leaving them in an undefined state
+    self->epoll_fd  = -1;
+    self->wakeup_fd = -1;
+
+    // init the lists
+    GG_LINKED_LIST_INIT(&self->monitor_handlers);
+    GG_LINKED_LIST_INIT(&self->ready_entries);
+
+    // init the base class
+    GG_Result result = GG_LoopBase_Init(&self->base);
+    if (GG_FAILED(result)) {
+        goto end;
+    }
+
+    // init the inspectable interface
+    GG_IF_INSPECTION_ENABLED(GG_SET_INTERFACE(&self->base, GG_Loop, GG_Inspectable));
+
+    // create the epoll instance
+    self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (self->epoll_fd < 0) {
+        result = GG_ERROR_ERRNO(errno);
+        GG_LOG_WARNING("epoll_create1 failed (%d)", result);
+        goto end;
+    }
+
+    // create the wakeup file descriptor
+    self->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (self->wakeup_fd < 0) {
+        result = GG_ERROR_ERRNO(errno);
+        GG_LOG_WARNING("eventfd failed (%d)", result);
+        goto end;
+    }
+
+    // register the wakeup handler
+    self->wakeup_handler.fd         = self->wakeup_fd;
+    self->wakeup_handler.event_mask = GG_EVENT_FLAG_FD_CAN_READ;
+    GG_SET_INTERFACE(&self->wakeup_handler.base, GG_Loop, GG_LoopEventHandler);
+    result = GG_Loop_AddFileDescriptorHandler(self, &self->wakeup_handler);
+
+end:
+    if (GG_SUCCEEDED(result)) {
+        *loop = self;
+    } else {
+        GG_Loop_Destroy(self);
+        *loop = NULL;
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------
+void
+GG_Loop_Destroy(GG_Loop* self)
+{
+    if (self == NULL) return;
+
+    // unregister the wakeup handler
+    GG_Loop_RemoveFileDescriptorHandler(self, &self->wakeup_handler);
+
+    // free any entry left behind by handlers that didn't unregister
+    for (size_t i = 0; i < self->entry_table_size; i++) {
+        GG_FreeMemory(self->entries[i]);
+    }
+    GG_FreeMemory(self->entries);
+
+    // close file descriptors
+    if (self->wakeup_fd >= 0) {
+        close(self->wakeup_fd);
+    }
+    if (self->epoll_fd >= 0) {
+        close(self->epoll_fd);
+    }
+
+    // deinit the base class
+    GG_LoopBase_Deinit(&self->base);
+
+    // free the object memory
+    GG_FreeMemory(self);
+}
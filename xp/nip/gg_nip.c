@@ -23,6 +23,7 @@
 #include "xp/common/gg_io.h"
 #include "xp/common/gg_lists.h"
 #include "xp/common/gg_logging.h"
+#include "xp/common/gg_memory.h"
 #include "xp/common/gg_port.h"
 #include "xp/common/gg_results.h"
 #include "xp/common/gg_utils.h"
@@ -35,6 +36,19 @@
 +---------------------------------------------------------------------*/
 GG_SET_LOCAL_LOGGER("gg.xp.nip")
 
+/*----------------------------------------------------------------------
+|   config
++---------------------------------------------------------------------*/
+
+// initial number of slots in the port->endpoint hash table (the table grows as endpoints are added)
+#if !defined(GG_CONFIG_NIP_UDP_PORT_TABLE_SIZE)
+#define GG_CONFIG_NIP_UDP_PORT_TABLE_SIZE 32
+#endif
+
+#if (GG_CONFIG_NIP_UDP_PORT_TABLE_SIZE & (GG_CONFIG_NIP_UDP_PORT_TABLE_SIZE - 1)) != 0
+#error "GG_CONFIG_NIP_UDP_PORT_TABLE_SIZE must be a power of 2"
+#endif
+
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
@@ -42,7 +56,13 @@ GG_SET_LOCAL_LOGGER("gg.xp.nip")
 // dynamic UDP port numbers, according to http://www.iana.org/assignments/port-numbers:
 #define GG_NIP_UDP_DYNAMIC_PORT_RANGE_START (0xC000)
 #define GG_NIP_UDP_DYNAMIC_PORT_RANGE_END   (0xFFFF)
-#define GG_NIP_UDP_DYNAMIC_PORT_RANGE_SPAN  (GG_NIP_UDP_DYNAMIC_PORT_RANGE_END - GG_NIP_UDP_DYNAMIC_PORT_RANGE_START)
+#define GG_NIP_UDP_DYNAMIC_PORT_RANGE_SPAN \
+    (GG_NIP_UDP_DYNAMIC_PORT_RANGE_END - GG_NIP_UDP_DYNAMIC_PORT_RANGE_START + 1)
+#define GG_NIP_UDP_DYNAMIC_PORT_MAP_WORDS   (GG_NIP_UDP_DYNAMIC_PORT_RANGE_SPAN / 32)
+
+// the port table is grown when it would become more than 3/4 full
+#define GG_NIP_UDP_PORT_TABLE_MAX_LOAD_NUM  3
+#define GG_NIP_UDP_PORT_TABLE_MAX_LOAD_DEN  4
 
 #define GG_NIP_MAX_PACKET_SIZE                  0xFFFF
 #define GG_NIP_IP_HEADER_SIZE                   20
@@ -90,15 +110,17 @@ static const uint8_t GG_NipIpUdpHeaderPrototype[10] = {
     0x11  // Protocol (UDP)
 };
 
-/*----------------------------------------------------------------------
-|   globals
-+---------------------------------------------------------------------*/
-typedef struct {
-    bool          initialized;     ///< set to `true` when the stack has been initialized
-    GG_LinkedList udp_endpoints;   ///< list of sockets attached to the stack
-    uint8_t       header_template[GG_NIP_IP_HEADER_SIZE + GG_NIP_UDP_HEADER_SIZE];
-    uint16_t      dynamic_port_scan_start; ///< starting point when looking for an unassigned dynamic port
-    uint16_t      next_ip_identification;  ///< counter for the IP identification field
+struct GG_NipStack {
+    GG_LinkedList      udp_endpoints;      ///< list of sockets attached to the stack
+    unsigned int       udp_endpoint_count; ///< number of sockets attached to the stack
+    GG_NipUdpEndpoint** udp_port_table;     ///< local port -> socket (open addressing), allocated on demand
+    unsigned int        udp_port_table_size; ///< number of slots in the port table (0 or a power of 2)
+    GG_NipUdpEndpoint* udp_wildcard_endpoint; ///< socket that receives datagrams for unknown ports, if any
+    uint32_t           dynamic_ports_in_use[GG_NIP_UDP_DYNAMIC_PORT_MAP_WORDS]; ///< bitmap of the used dynamic ports
+    uint8_t            header_template[GG_NIP_IP_HEADER_SIZE + GG_NIP_UDP_HEADER_SIZE];
+    uint16_t           dynamic_port_scan_start; ///< offset from which to look for an unassigned dynamic port
+    uint16_t           next_ip_identification;  ///< counter for the IP identification field
+    GG_NipUdpEndpoint* blocked_udp_endpoint;    ///< endpoint whose sink pushed back a received packet, if any
 
     // the following fields represent the single network interface
     struct {
@@ -106,20 +128,39 @@ typedef struct {
         GG_IMPLEMENTS(GG_DataSink);         ///< To receive data from the transport
         GG_IMPLEMENTS(GG_DataSinkListener); ///< To receive notifications from the transport sink
 
-        uint32_t     address;        ///< IP address assigned to the network interface
-        GG_DataSink* transport_sink; ///< Transport data sink
+        uint32_t             address;            ///< IP address assigned to the network interface
+        GG_DataSink*         transport_sink;     ///< Transport data sink
+        GG_DataSinkListener* transport_listener; ///< Listener (typically the transport source) for the netif sink
     } netif;
-} GG_NipStack;
+};
 
 /*----------------------------------------------------------------------
 |   globals
 +---------------------------------------------------------------------*/
-static GG_NipStack GG_IpStack; ///< IP stack singleton
+static GG_NipStack GG_IpStack;            ///< default IP stack
+static bool        GG_IpStackInitialized; ///< set to `true` when the default stack has been initialized
 
 /*----------------------------------------------------------------------
 |   functions
 +---------------------------------------------------------------------*/
 
+//----------------------------------------------------------------------
+void
+GG_NipStack_Configure(GG_NipStack* self, const GG_IpAddress* netif_address)
+{
+    GG_ASSERT(self);
+
+    // assign the netif IP address
+    self->netif.address = GG_IpAddress_AsInteger(netif_address);
+
+    // fill in the IP+UDP header template
+    memcpy(self->header_template, GG_NipIpUdpHeaderPrototype, sizeof(GG_NipIpUdpHeaderPrototype));
+    memset(&self->header_template[sizeof(GG_NipIpUdpHeaderPrototype)],
+           0,
+           sizeof(self->header_template) - sizeof(GG_NipIpUdpHeaderPrototype));
+    GG_BytesFromInt32Be(&self->header_template[GG_NIP_IP_HEADER_SRC_ADDR_OFFSET], self->netif.address);
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_Nip_Configure(const GG_IpAddress* netif_address)
@@ -130,15 +171,7 @@ GG_Nip_Configure(const GG_IpAddress* netif_address)
         return result;
     }
 
-    // assign the netif IP address
-    GG_IpStack.netif.address = GG_IpAddress_AsInteger(netif_address);
-
-    // fill in the IP+UDP header template
-    memcpy(GG_IpStack.header_template, GG_NipIpUdpHeaderPrototype, sizeof(GG_NipIpUdpHeaderPrototype));
-    memset(&GG_IpStack.header_template[sizeof(GG_NipIpUdpHeaderPrototype)],
-           0,
-           sizeof(GG_IpStack.header_template) - sizeof(GG_NipIpUdpHeaderPrototype));
-    GG_BytesFromInt32Be(&GG_IpStack.header_template[GG_NIP_IP_HEADER_SRC_ADDR_OFFSET], GG_IpStack.netif.address);
+    GG_NipStack_Configure(&GG_IpStack, netif_address);
 
     return GG_SUCCESS;
 }
@@ -147,6 +180,7 @@ GG_Nip_Configure(const GG_IpAddress* netif_address)
 // This function is called when a socket user sends a UDP datagram.
 // It creates a packet with an IP and UDP header, followed by the payload,
 // and sends it to the transport.
+// The packet is a buffer chain, so the payload isn't copied.
 // The optional UDP checksum is left un-computed.
 //----------------------------------------------------------------------
 static GG_Result
@@ -165,7 +199,8 @@ GG_NipUdpEndpoint_PutData(GG_DataSink*             _self,
     }
 
     // check that we have a network interface transport to send to
-    if (!GG_IpStack.netif.transport_sink) {
+    GG_NipStack* stack = self->stack;
+    if (stack == NULL || !stack->netif.transport_sink) {
         return GG_ERROR_NETWORK_UNREACHABLE;
     }
 
@@ -189,23 +224,28 @@ GG_NipUdpEndpoint_PutData(GG_DataSink*             _self,
         return GG_ERROR_INVALID_STATE;
     }
 
-    // allocate a buffer large enough for the IP+UDP header and payload
-    GG_DynamicBuffer* packet = NULL;
-    GG_Result result = GG_DynamicBuffer_Create(packet_size, &packet);
+    // create a chain with room for the IP+UDP header, followed by the payload
+    GG_BufferChain* packet = NULL;
+    GG_Result result = GG_BufferChain_Create(sizeof(stack->header_template), &packet);
     if (GG_FAILED(result)) {
         return result;
     }
+    result = GG_BufferChain_AppendBuffer(packet, data);
+    if (GG_FAILED(result)) {
+        GG_BufferChain_Release(packet);
+        return result;
+    }
 
     // start with the header template
-    GG_DynamicBuffer_SetDataSize(packet, packet_size);
-    uint8_t* packet_data = GG_DynamicBuffer_UseData(packet);
-    memcpy(packet_data, GG_IpStack.header_template, sizeof(GG_IpStack.header_template));
+    uint8_t* packet_data = NULL;
+    GG_BufferChain_Prepend(packet, sizeof(stack->header_template), &packet_data);
+    memcpy(packet_data, stack->header_template, sizeof(stack->header_template));
 
     // fill in the template blanks for the IP header
     uint8_t* ip_header = packet_data;
     GG_BytesFromInt32Be(&ip_header[GG_NIP_IP_HEADER_DST_ADDR_OFFSET], dst_address);
     GG_NIP_SET_16(ip_header, GG_NIP_IP_HEADER_TOTAL_LENGTH_OFFSET, packet_size);
-    uint16_t identification = GG_IpStack.next_ip_identification++; // it is normal for the counter to cycle
+    uint16_t identification = stack->next_ip_identification++; // it is normal for the counter to cycle
     GG_NIP_SET_16(ip_header, GG_NIP_IP_HEADER_IDENTIFICATION_OFFSET, identification);
     uint16_t checksum = ~GG_Ipv4Checksum(ip_header, GG_NIP_IP_HEADER_SIZE);
     GG_NIP_SET_16(ip_header, GG_NIP_IP_HEADER_CHECKSUM_OFFSET, checksum);
@@ -217,15 +257,11 @@ GG_NipUdpEndpoint_PutData(GG_DataSink*             _self,
     GG_NIP_SET_16(udp_header, GG_NIP_UDP_HEADER_DST_PORT_OFFSET, self->remote_address.port);
     GG_NIP_SET_16(udp_header, GG_NIP_UDP_HEADER_LENGTH_OFFSET,   udp_length);
 
-    // copy the payload
-    uint8_t* udp_payload = &packet_data[GG_NIP_IP_HEADER_SIZE + GG_NIP_UDP_HEADER_SIZE];
-    memcpy(udp_payload, GG_Buffer_GetData(data), payload_size);
-
     // send the packet to the transport
-    result = GG_DataSink_PutData(GG_IpStack.netif.transport_sink, GG_DynamicBuffer_AsBuffer(packet), NULL);
+    result = GG_DataSink_PutData(stack->netif.transport_sink, GG_BufferChain_AsBuffer(packet), NULL);
 
     // done with the packet
-    GG_DynamicBuffer_Release(packet);
+    GG_BufferChain_Release(packet);
 
     return result;
 }
@@ -247,18 +283,49 @@ GG_NipUdpEndpoint_SetDataSink(GG_DataSource* _self, GG_DataSink* data_sink)
 {
     GG_NipUdpEndpoint* self = GG_SELF(GG_NipUdpEndpoint, GG_DataSource);
 
+    // de-register as a listener from the current sink
+    if (self->data_sink) {
+        GG_DataSink_SetListener(self->data_sink, NULL);
+    }
+
     // keep a reference to the sink
     self->data_sink = data_sink;
 
+    // register as a listener, so that we know when the sink can accept data again after pushing back
+    if (data_sink) {
+        GG_DataSink_SetListener(data_sink, GG_CAST(self, GG_DataSinkListener));
+    }
+
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Let the transport know that it can retry a packet that the network
+// interface pushed back because of an endpoint's sink.
+//----------------------------------------------------------------------
+static void
+GG_NipStack_UnblockUdpEndpoint(GG_NipStack* self, GG_NipUdpEndpoint* udp_endpoint)
+{
+    if (self->blocked_udp_endpoint != udp_endpoint) {
+        return;
+    }
+    self->blocked_udp_endpoint = NULL;
+
+    if (self->netif.transport_listener) {
+        GG_DataSinkListener_OnCanPut(self->netif.transport_listener);
+    }
+}
+
 //----------------------------------------------------------------------
 static void
 GG_NipUdpEndpoint_OnCanPut(GG_DataSinkListener* _self)
 {
-    // nothing to do, in this implementation we don't keep a pending buffer queue
-    GG_COMPILER_UNUSED(_self);
+    GG_NipUdpEndpoint* self = GG_SELF(GG_NipUdpEndpoint, GG_DataSinkListener);
+
+    // we don't keep a pending packet queue, the transport holds the packet that was pushed back
+    if (self->stack) {
+        GG_NipStack_UnblockUdpEndpoint(self->stack, self);
+    }
 }
 
 /*----------------------------------------------------------------------
@@ -303,75 +370,265 @@ GG_NipUdpEndpoint_Init(GG_NipUdpEndpoint*      self,
 }
 
 //----------------------------------------------------------------------
-// Returns `true` if the specified port number is already assigned to
-// a socket.
+// Returns the home slot of a port number in the port table
 //----------------------------------------------------------------------
-static bool
-GG_Nip_UdpSrcPortInUse(uint16_t port)
+static unsigned int
+GG_NipStack_UdpPortHash(GG_NipStack* self, uint16_t port)
 {
-    GG_LINKED_LIST_FOREACH(list_node, &GG_IpStack.udp_endpoints) {
-        GG_NipUdpEndpoint* udp_endpoint = GG_LINKED_LIST_ITEM(list_node, GG_NipUdpEndpoint, list_node);
+    // Fibonacci hashing, so that consecutive ports are spread out
+    return (unsigned int)(((uint32_t)port * 0x9E3779B1u) >> 16) & (self->udp_port_table_size - 1);
+}
+
+//----------------------------------------------------------------------
+// Returns the socket assigned to a local port number, or NULL if the
+// port isn't used.
+//----------------------------------------------------------------------
+static GG_NipUdpEndpoint*
+GG_NipStack_FindUdpEndpoint(GG_NipStack* self, uint16_t port)
+{
+    if (self->udp_port_table == NULL) {
+        return NULL;
+    }
+
+    unsigned int mask = self->udp_port_table_size - 1;
+    unsigned int slot = GG_NipStack_UdpPortHash(self, port);
+    for (unsigned int i = 0; i < self->udp_port_table_size; i++) {
+        GG_NipUdpEndpoint* udp_endpoint = self->udp_port_table[slot];
+        if (udp_endpoint == NULL) {
+            // end of the probe sequence
+            return NULL;
+        }
         if (udp_endpoint->local_address.port == port) {
-            return true;
+            return udp_endpoint;
         }
+        slot = (slot + 1) & mask;
     }
 
-    return false;
+    return NULL;
 }
 
 //----------------------------------------------------------------------
-GG_Result
-GG_Nip_AddUdpEndpoint(GG_NipUdpEndpoint* udp_endpoint)
+// Mark a port as used or unused in the dynamic port bitmap.
+// Ports outside of the dynamic range are ignored.
+//----------------------------------------------------------------------
+static void
+GG_NipStack_MarkDynamicPort(GG_NipStack* self, uint16_t port, bool in_use)
 {
-    // lazy-initialize
-    GG_Result result = GG_Nip_Initialize();
-    if (GG_FAILED(result)) {
-        return result;
+    if (port < GG_NIP_UDP_DYNAMIC_PORT_RANGE_START) {
+        return;
+    }
+    unsigned int offset = port - GG_NIP_UDP_DYNAMIC_PORT_RANGE_START;
+    uint32_t     mask   = (uint32_t)1 << (offset % 32);
+    if (in_use) {
+        self->dynamic_ports_in_use[offset / 32] |= mask;
+    } else {
+        self->dynamic_ports_in_use[offset / 32] &= ~mask;
+    }
+}
+
+//----------------------------------------------------------------------
+// Find an unused port in the dynamic range, starting at the current scan
+// position and wrapping around.
+// Returns 0 if all the dynamic ports are in use.
+//----------------------------------------------------------------------
+static uint16_t
+GG_NipStack_FindFreeDynamicPort(GG_NipStack* self)
+{
+    unsigned int start      = self->dynamic_port_scan_start;
+    unsigned int start_word = start / 32;
+    uint32_t     start_mask = (uint32_t)0xFFFFFFFF << (start % 32);
+
+    // visit each word once, and the starting word a second time for the bits below the start
+    for (unsigned int i = 0; i <= GG_NIP_UDP_DYNAMIC_PORT_MAP_WORDS; i++) {
+        unsigned int word      = (start_word + i) % GG_NIP_UDP_DYNAMIC_PORT_MAP_WORDS;
+        uint32_t     free_bits = ~self->dynamic_ports_in_use[word];
+        if (i == 0) {
+            free_bits &= start_mask;
+        } else if (i == GG_NIP_UDP_DYNAMIC_PORT_MAP_WORDS) {
+            free_bits &= ~start_mask;
+        }
+        if (free_bits) {
+            unsigned int offset = 32 * word + GG_LowestBitIndex(free_bits);
+            return (uint16_t)(GG_NIP_UDP_DYNAMIC_PORT_RANGE_START + offset);
+        }
+    }
+
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// Insert a socket in the port table.
+// The caller must have checked that the port isn't already used and that
+// the table isn't full.
+//----------------------------------------------------------------------
+static void
+GG_NipStack_InsertUdpEndpoint(GG_NipStack* self, GG_NipUdpEndpoint* udp_endpoint)
+{
+    unsigned int slot = GG_NipStack_UdpPortHash(self, udp_endpoint->local_address.port);
+    while (self->udp_port_table[slot]) {
+        slot = (slot + 1) & (self->udp_port_table_size - 1);
+    }
+    self->udp_port_table[slot] = udp_endpoint;
+}
+
+//----------------------------------------------------------------------
+// Make sure that the port table has room for one more socket, growing
+// and rehashing it if it would otherwise exceed its maximum load factor.
+//----------------------------------------------------------------------
+static GG_Result
+GG_NipStack_ReserveUdpPortTableSlot(GG_NipStack* self)
+{
+    if ((self->udp_endpoint_count + 1) * GG_NIP_UDP_PORT_TABLE_MAX_LOAD_DEN <=
+        self->udp_port_table_size * GG_NIP_UDP_PORT_TABLE_MAX_LOAD_NUM) {
+        return GG_SUCCESS;
+    }
+
+    // allocate a new table, twice as large as the current one
+    unsigned int new_size = self->udp_port_table_size ?
+                            2 * self->udp_port_table_size :
+                            GG_CONFIG_NIP_UDP_PORT_TABLE_SIZE;
+    GG_NipUdpEndpoint** new_table = GG_AllocateZeroMemory(new_size * sizeof(GG_NipUdpEndpoint*));
+    if (new_table == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    // move the existing entries to the new table
+    GG_NipUdpEndpoint** old_table = self->udp_port_table;
+    unsigned int        old_size  = self->udp_port_table_size;
+    self->udp_port_table      = new_table;
+    self->udp_port_table_size = new_size;
+    for (unsigned int i = 0; i < old_size; i++) {
+        if (old_table[i]) {
+            GG_NipStack_InsertUdpEndpoint(self, old_table[i]);
+        }
     }
+    GG_FreeMemory(old_table);
+
+    GG_LOG_FINE("UDP port table resized to %u slots", new_size);
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Remove a socket from the port table, shifting back the entries that
+// follow it in its probe sequence so that no tombstones are needed.
+//----------------------------------------------------------------------
+static void
+GG_NipStack_EraseUdpEndpoint(GG_NipStack* self, GG_NipUdpEndpoint* udp_endpoint)
+{
+    if (self->udp_port_table == NULL) {
+        return;
+    }
+
+    // find the slot where the socket is
+    unsigned int mask = self->udp_port_table_size - 1;
+    unsigned int hole = GG_NipStack_UdpPortHash(self, udp_endpoint->local_address.port);
+    unsigned int i;
+    for (i = 0; i < self->udp_port_table_size; i++) {
+        if (self->udp_port_table[hole] == udp_endpoint) {
+            break;
+        }
+        hole = (hole + 1) & mask;
+    }
+    if (i == self->udp_port_table_size) {
+        // not found
+        return;
+    }
+    self->udp_port_table[hole] = NULL;
+
+    // move back any entry that can't be reached anymore
+    unsigned int slot = hole;
+    for (;;) {
+        slot = (slot + 1) & mask;
+        GG_NipUdpEndpoint* entry = self->udp_port_table[slot];
+        if (entry == NULL) {
+            break;
+        }
+
+        // the entry can stay where it is if its home slot is cyclically in (hole, slot]
+        unsigned int home = GG_NipStack_UdpPortHash(self, entry->local_address.port);
+        if (((slot - home) & mask) < ((slot - hole) & mask)) {
+            continue;
+        }
+
+        self->udp_port_table[hole] = entry;
+        self->udp_port_table[slot] = NULL;
+        hole = slot;
+    }
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_NipStack_AddUdpEndpoint(GG_NipStack* self, GG_NipUdpEndpoint* udp_endpoint)
+{
+    GG_ASSERT(self);
 
     // check that this endpoint isn't already linked
     if (!GG_LINKED_LIST_NODE_IS_UNLINKED(&udp_endpoint->list_node)) {
         return GG_ERROR_INVALID_STATE;
     }
 
+    // make room for one more endpoint
+    GG_Result result = GG_NipStack_ReserveUdpPortTableSlot(self);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+
     // if the local address isn't set, use the interface address
     if (GG_IpAddress_IsAny(&udp_endpoint->local_address.address)) {
-        GG_IpAddress_SetFromInteger(&udp_endpoint->local_address.address, GG_IpStack.netif.address);
+        GG_IpAddress_SetFromInteger(&udp_endpoint->local_address.address, self->netif.address);
     }
 
     // if the port is 0, find a free port
     if (udp_endpoint->local_address.port == 0) {
         udp_endpoint->local_port_bound = false;
-        for (unsigned int i = 0; i < GG_NIP_UDP_DYNAMIC_PORT_RANGE_SPAN; i++) {
-            uint16_t port = (uint16_t)(GG_NIP_UDP_DYNAMIC_PORT_RANGE_START +
-                                       ((GG_IpStack.dynamic_port_scan_start + i) %
-                                        GG_NIP_UDP_DYNAMIC_PORT_RANGE_SPAN));
-            if (!GG_Nip_UdpSrcPortInUse(port)) {
-                udp_endpoint->local_address.port = port;
-                GG_IpStack.dynamic_port_scan_start = (i + 1) % GG_NIP_UDP_DYNAMIC_PORT_RANGE_SPAN;
-                break;
-            }
-        }
+        uint16_t port = GG_NipStack_FindFreeDynamicPort(self);
 
         // return now if we couldn't find a free dynamic port
-        if (udp_endpoint->local_address.port == 0) {
+        if (port == 0) {
             return GG_ERROR_OUT_OF_RESOURCES;
         }
+        udp_endpoint->local_address.port = port;
+        self->dynamic_port_scan_start =
+            (uint16_t)((port - GG_NIP_UDP_DYNAMIC_PORT_RANGE_START + 1) % GG_NIP_UDP_DYNAMIC_PORT_RANGE_SPAN);
     } else {
         // check that this port isn't already used
-        if (GG_Nip_UdpSrcPortInUse(udp_endpoint->local_address.port)) {
+        if (GG_NipStack_FindUdpEndpoint(self, udp_endpoint->local_address.port)) {
             GG_LOG_WARNING("UDP port already in use");
             return GG_ERROR_ADDRESS_IN_USE;
         }
         udp_endpoint->local_port_bound = true;
     }
 
+    // index the endpoint by port
+    GG_NipStack_InsertUdpEndpoint(self, udp_endpoint);
+    GG_NipStack_MarkDynamicPort(self, udp_endpoint->local_address.port, true);
+
+    // the first unbound endpoint receives the datagrams that don't match any port
+    if (!udp_endpoint->local_port_bound && self->udp_wildcard_endpoint == NULL) {
+        self->udp_wildcard_endpoint = udp_endpoint;
+    }
+
     // add the endpoint to the list
-    GG_LINKED_LIST_APPEND(&GG_IpStack.udp_endpoints, &udp_endpoint->list_node);
+    GG_LINKED_LIST_APPEND(&self->udp_endpoints, &udp_endpoint->list_node);
+    ++self->udp_endpoint_count;
+    udp_endpoint->stack = self;
 
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+GG_Result
+GG_Nip_AddUdpEndpoint(GG_NipUdpEndpoint* udp_endpoint)
+{
+    // lazy-initialize
+    GG_Result result = GG_Nip_Initialize();
+    if (GG_FAILED(result)) {
+        return result;
+    }
+
+    return GG_NipStack_AddUdpEndpoint(&GG_IpStack, udp_endpoint);
+}
+
 //----------------------------------------------------------------------
 GG_Result
 GG_Nip_RemoveEndpoint(GG_NipUdpEndpoint* udp_endpoint)
@@ -381,6 +638,31 @@ GG_Nip_RemoveEndpoint(GG_NipUdpEndpoint* udp_endpoint)
     }
 
     GG_LINKED_LIST_NODE_REMOVE(&udp_endpoint->list_node);
+
+    GG_NipStack* stack = udp_endpoint->stack;
+    if (stack) {
+        // un-index the endpoint
+        GG_NipStack_EraseUdpEndpoint(stack, udp_endpoint);
+        GG_NipStack_MarkDynamicPort(stack, udp_endpoint->local_address.port, false);
+        --stack->udp_endpoint_count;
+
+        // elect a new wildcard endpoint if needed (this is the only case where we need to scan the list)
+        if (stack->udp_wildcard_endpoint == udp_endpoint) {
+            stack->udp_wildcard_endpoint = NULL;
+            GG_LINKED_LIST_FOREACH(list_node, &stack->udp_endpoints) {
+                GG_NipUdpEndpoint* other = GG_LINKED_LIST_ITEM(list_node, GG_NipUdpEndpoint, list_node);
+                if (!other->local_port_bound) {
+                    stack->udp_wildcard_endpoint = other;
+                    break;
+                }
+            }
+        }
+
+        // if the transport is holding a packet for this endpoint, let it retry
+        GG_NipStack_UnblockUdpEndpoint(stack, udp_endpoint);
+    }
+    udp_endpoint->stack = NULL;
+
     return GG_SUCCESS;
 }
 
@@ -388,16 +670,17 @@ GG_Nip_RemoveEndpoint(GG_NipUdpEndpoint* udp_endpoint)
 // This function is called when a UDP packet has been received from
 // the transport
 //----------------------------------------------------------------------
-static void
-GG_NipStack_OnUdpPacketReceived(GG_Buffer* packet,
-                                size_t     packet_offset,
-                                size_t     packet_size,
-                                uint32_t   src_address)
+static GG_Result
+GG_NipStack_OnUdpPacketReceived(GG_NipStack* self,
+                                GG_Buffer*   packet,
+                                size_t       packet_offset,
+                                size_t       packet_size,
+                                uint32_t     src_address)
 {
     // check the size
     if (packet_size < GG_NIP_UDP_HEADER_SIZE) {
         GG_LOG_WARNING("UDP packet too short");
-        return;
+        return GG_SUCCESS;
     }
 
     // check the length
@@ -406,7 +689,7 @@ GG_NipStack_OnUdpPacketReceived(GG_Buffer* packet,
     if (udp_length != packet_size) {
         // uh oh... mismatch
         GG_LOG_WARNING("UDP length mismatch (expected %u, got %u)", (int)packet_size, (int)udp_length);
-        return;
+        return GG_SUCCESS;
     }
 
     // get the source and destination ports
@@ -414,44 +697,54 @@ GG_NipStack_OnUdpPacketReceived(GG_Buffer* packet,
     uint16_t dst_port = GG_NIP_GET_16(udp_header, GG_NIP_UDP_HEADER_DST_PORT_OFFSET);
     GG_LOG_FINEST("UDP src_port = %d, dst_port = %d", src_port, dst_port);
 
-    // find a matching socket to deliver to (either not locally bound, or a direct port match)
-    GG_LINKED_LIST_FOREACH(list_node, &GG_IpStack.udp_endpoints) {
-        GG_NipUdpEndpoint* udp_endpoint = GG_LINKED_LIST_ITEM(list_node, GG_NipUdpEndpoint, list_node);
-        if (!udp_endpoint->local_port_bound || udp_endpoint->local_address.port == dst_port) {
-            GG_LOG_FINER("found matching socket");
-
-            // check that the socket has a sink to deliver to
-            if (udp_endpoint->data_sink == NULL) {
-                GG_LOG_INFO("socket has no sink, dropping");
-                return;
-            }
+    // find a matching socket to deliver to (a direct port match, or the wildcard socket)
+    GG_NipUdpEndpoint* udp_endpoint = GG_NipStack_FindUdpEndpoint(self, dst_port);
+    if (udp_endpoint == NULL) {
+        udp_endpoint = self->udp_wildcard_endpoint;
+        if (udp_endpoint == NULL) {
+            GG_LOG_INFO("no matching socket found");
+            return GG_SUCCESS;
+        }
+    }
+    GG_LOG_FINER("found matching socket");
 
-            // create a packet with just the payload of the packet, without the header
-            GG_Buffer* payload = NULL;
-            GG_Result result = GG_SubBuffer_Create(packet,
-                                                   packet_offset + GG_NIP_UDP_HEADER_SIZE,
-                                                   packet_size - GG_NIP_UDP_HEADER_SIZE,
-                                                   &payload);
-            if (GG_FAILED(result)) {
-                GG_LOG_WARNING("failed to create payload buffer (%d)", result);
-                return;
-            }
+    // check that the socket has a sink to deliver to
+    if (udp_endpoint->data_sink == NULL) {
+        GG_LOG_INFO("socket has no sink, dropping");
+        return GG_SUCCESS;
+    }
 
-            // deliver the payload (ignore errors here, as we don't want to maintain a packet queue)
-            GG_SocketAddressMetadata metadata;
-            metadata.base = GG_BUFFER_METADATA_INITIALIZER(SOURCE_SOCKET_ADDRESS, GG_SocketAddressMetadata);
-            GG_IpAddress_SetFromInteger(&metadata.socket_address.address, src_address);
-            metadata.socket_address.port = src_port;
-            GG_DataSink_PutData(udp_endpoint->data_sink, payload, &metadata.base);
+    // create a packet with just the payload of the packet, without the header
+    GG_Buffer* payload = NULL;
+    GG_Result result = GG_SubBuffer_Create(packet,
+                                           packet_offset + GG_NIP_UDP_HEADER_SIZE,
+                                           packet_size - GG_NIP_UDP_HEADER_SIZE,
+                                           &payload);
+    if (GG_FAILED(result)) {
+        GG_LOG_WARNING("failed to create payload buffer (%d)", result);
+        return GG_SUCCESS;
+    }
 
-            // done
-            GG_Buffer_Release(payload);
-            return;
-        }
+    // deliver the payload
+    // (we don't maintain a packet queue, so if the sink pushes back, we push back on the
+    // transport, which will retry when the endpoint's sink notifies us that it can accept
+    // data again. Other errors drop the packet)
+    GG_SocketAddressMetadata metadata;
+    metadata.base = GG_BUFFER_METADATA_INITIALIZER(SOURCE_SOCKET_ADDRESS, GG_SocketAddressMetadata);
+    GG_IpAddress_SetFromInteger(&metadata.socket_address.address, src_address);
+    metadata.socket_address.port = src_port;
+    result = GG_DataSink_PutData(udp_endpoint->data_sink, payload, &metadata.base);
+    if (result == GG_ERROR_WOULD_BLOCK) {
+        GG_LOG_FINER("socket sink would block, pushing back");
+        self->blocked_udp_endpoint = udp_endpoint;
+    } else {
+        result = GG_SUCCESS;
     }
 
-    // no matching socket found
-    GG_LOG_INFO("no matching socket found");
+    // done
+    GG_Buffer_Release(payload);
+
+    return result;
 }
 
 //----------------------------------------------------------------------
@@ -459,12 +752,12 @@ GG_NipStack_OnUdpPacketReceived(GG_Buffer* packet,
 // transport.
 //----------------------------------------------------------------------
 static GG_Result
-GG_NipStack_PutData(GG_DataSink*             self,
+GG_NipStack_PutData(GG_DataSink*             _self,
                     GG_Buffer*               data,
                     const GG_BufferMetadata* metadata)
 {
     GG_ASSERT(data);
-    GG_COMPILER_UNUSED(self);
+    GG_NipStack* self = GG_SELF_M(netif, GG_NipStack, GG_DataSink);
     GG_COMPILER_UNUSED(metadata);
 
     // get the packet data and size
@@ -503,7 +796,7 @@ GG_NipStack_PutData(GG_DataSink*             self,
 
     // check that this packet is for us
     uint32_t dst_address = GG_BytesToInt32Be(&packet_data[GG_NIP_IP_HEADER_DST_ADDR_OFFSET]);
-    if (dst_address != GG_IpStack.netif.address) {
+    if (dst_address != self->netif.address) {
         GG_LOG_INFO("packet destination (%08x) isn't for our network interface", (int)dst_address);
         return GG_SUCCESS;
     }
@@ -511,18 +804,17 @@ GG_NipStack_PutData(GG_DataSink*             self,
     GG_LOG_FINER("source address = %08x", (int)src_address);
 
     // process the packet
-    GG_NipStack_OnUdpPacketReceived(data, header_size, packet_size - header_size, src_address);
-
-    return GG_SUCCESS;
+    return GG_NipStack_OnUdpPacketReceived(self, data, header_size, packet_size - header_size, src_address);
 }
 
 //----------------------------------------------------------------------
 static GG_Result
-GG_NipStack_SetListener(GG_DataSink* self, GG_DataSinkListener* listener)
+GG_NipStack_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
 {
-    // ignore the listener, as the network interface always accepts or drops
-    GG_COMPILER_UNUSED(self);
-    GG_COMPILER_UNUSED(listener);
+    GG_NipStack* self = GG_SELF_M(netif, GG_NipStack, GG_DataSink);
+
+    // keep the listener, to notify it when a packet that was pushed back can be retried
+    self->netif.transport_listener = listener;
 
     return GG_SUCCESS;
 }
@@ -582,39 +874,106 @@ GG_IMPLEMENT_INTERFACE(GG_NipStack, GG_DataSource) {
     .SetDataSink = GG_NipStack_SetDataSink
 };
 
+//----------------------------------------------------------------------
+GG_DataSink*
+GG_NipStack_AsDataSink(GG_NipStack* self)
+{
+    return GG_CAST(&self->netif, GG_DataSink);
+}
+
+//----------------------------------------------------------------------
+GG_DataSource*
+GG_NipStack_AsDataSource(GG_NipStack* self)
+{
+    return GG_CAST(&self->netif, GG_DataSource);
+}
+
+//----------------------------------------------------------------------
+static void
+GG_NipStack_Init(GG_NipStack* self)
+{
+    // start clean
+    memset(self, 0, sizeof(*self));
+
+    // initialize fields
+    GG_LINKED_LIST_INIT(&self->udp_endpoints);
+
+    // setup the vtable for the netif
+    GG_SET_INTERFACE(&self->netif, GG_NipStack, GG_DataSource);
+    GG_SET_INTERFACE(&self->netif, GG_NipStack, GG_DataSink);
+    GG_SET_INTERFACE(&self->netif, GG_NipStack, GG_DataSinkListener);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_NipStack_Create(const GG_IpAddress* netif_address, GG_NipStack** stack)
+{
+    GG_ASSERT(netif_address);
+    GG_ASSERT(stack);
+
+    // allocate a new object
+    *stack = (GG_NipStack*)GG_AllocateMemory(sizeof(GG_NipStack));
+    if (*stack == NULL) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    // initialize and configure the object
+    GG_NipStack_Init(*stack);
+    GG_NipStack_Configure(*stack, netif_address);
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+void
+GG_NipStack_Destroy(GG_NipStack* self)
+{
+    if (self == NULL) return;
+
+    // detach any endpoint that may still be there
+    GG_LINKED_LIST_FOREACH_SAFE(list_node, &self->udp_endpoints) {
+        GG_NipUdpEndpoint* udp_endpoint = GG_LINKED_LIST_ITEM(list_node, GG_NipUdpEndpoint, list_node);
+        GG_Nip_RemoveEndpoint(udp_endpoint);
+    }
+    GG_FreeMemory(self->udp_port_table);
+
+    GG_ClearAndFreeObject(self, 0);
+}
+
+//----------------------------------------------------------------------
+GG_NipStack*
+GG_Nip_GetDefaultStack(void)
+{
+    GG_Nip_Initialize();
+    return &GG_IpStack;
+}
+
 //----------------------------------------------------------------------
 GG_DataSink*
 GG_Nip_AsDataSink(void)
 {
-    return GG_CAST(&GG_IpStack.netif, GG_DataSink);
+    return GG_NipStack_AsDataSink(&GG_IpStack);
 }
 
 //----------------------------------------------------------------------
 GG_DataSource*
 GG_Nip_AsDataSource(void)
 {
-    return GG_CAST(&GG_IpStack.netif, GG_DataSource);
+    return GG_NipStack_AsDataSource(&GG_IpStack);
 }
 
 //----------------------------------------------------------------------
 GG_Result
 GG_Nip_Initialize(void)
 {
-    if (GG_IpStack.initialized) {
+    if (GG_IpStackInitialized) {
         return GG_SUCCESS;
     }
 
-    // initialize fields
-    GG_LINKED_LIST_INIT(&GG_IpStack.udp_endpoints);
-    GG_IpStack.dynamic_port_scan_start = GG_NIP_UDP_DYNAMIC_PORT_RANGE_START;
-
-    // setup the vtable for the netif
-    GG_SET_INTERFACE(&GG_IpStack.netif, GG_NipStack, GG_DataSource);
-    GG_SET_INTERFACE(&GG_IpStack.netif, GG_NipStack, GG_DataSink);
-    GG_SET_INTERFACE(&GG_IpStack.netif, GG_NipStack, GG_DataSinkListener);
+    GG_NipStack_Init(&GG_IpStack);
 
     // done
-    GG_IpStack.initialized = true;
+    GG_IpStackInitialized = true;
 
     return GG_SUCCESS;
 }
@@ -624,8 +983,15 @@ void
 GG_Nip_Terminate(void)
 {
     // detach from any previous transport we may have
-    GG_IpStack.netif.transport_sink = NULL;
+    GG_IpStack.netif.transport_sink     = NULL;
+    GG_IpStack.netif.transport_listener = NULL;
+    GG_IpStack.blocked_udp_endpoint     = NULL;
+
+    // release the port table
+    GG_FreeMemory(GG_IpStack.udp_port_table);
+    GG_IpStack.udp_port_table      = NULL;
+    GG_IpStack.udp_port_table_size = 0;
 
     // done
-    GG_IpStack.initialized = false;
+    GG_IpStackInitialized = false;
 }
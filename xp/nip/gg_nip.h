@@ -23,8 +23,9 @@
  * or for other protocols than UDP (TCP for example) use something like LWIP.
  *
  * This library is not re-entrant, so it must only be called from a single thread.
- * This library uses an internal singleton, so only one instance of the stack may
- * exist in a process (this could easily be changed if needed).
+ * Any number of independent stacks, each with its own network interface and
+ * UDP endpoints, may be created with GG_NipStack_Create. For convenience, the
+ * GG_Nip_XXX functions operate on a default stack instance, created on demand.
  */
 
 #pragma once
@@ -43,6 +44,11 @@
 |   types
 +---------------------------------------------------------------------*/
 
+/**
+ * IP stack with a single network interface.
+ */
+typedef struct GG_NipStack GG_NipStack;
+
 /**
  * Object that can send and receive UDP datagrams
  */
@@ -52,6 +58,7 @@ typedef struct {
     GG_IMPLEMENTS(GG_DataSinkListener); ///< to receive notifications from the sink
 
     GG_LinkedListNode    list_node;          ///< to allow putting this struct in a list
+    GG_NipStack*         stack;              ///< stack the endpoint has been added to, if any
     GG_DataSink*         data_sink;          ///< the sink to which data will be sent
     GG_DataSinkListener* data_sink_listener; ///< the listener interested in our data events
     GG_SocketAddress     local_address;      ///< local address/port of the socket
@@ -68,20 +75,85 @@ extern "C" {
 #endif
 
 /**
- * Initialize the stack.
+ * Create a new stack instance.
+ *
+ * @param netif_address IP Address to assign to the network interface.
+ * @param stack Pointer to where the new object will be returned.
+ *
+ * @return GG_SUCCESS if the object could be created, or a negative error code.
+ */
+GG_Result GG_NipStack_Create(const GG_IpAddress* netif_address, GG_NipStack** stack);
+
+/**
+ * Destroy a stack instance.
+ * All endpoints must have been removed prior to calling this function.
+ *
+ * @param self The object on which this method is invoked.
+ */
+void GG_NipStack_Destroy(GG_NipStack* self);
+
+/**
+ * Configure a stack instance.
+ *
+ * NOTE: the transport source *must* deliver buffers in exact increments
+ * of complete IP packets, as the network will not accept partial packets
+ * or more than one packet per buffer.
+ *
+ * @param self The object on which this method is invoked.
+ * @param netif_address IP Address to assign to the network interface.
+ */
+void GG_NipStack_Configure(GG_NipStack* self, const GG_IpAddress* netif_address);
+
+/**
+ * Get the GG_DataSink interface for the network interface of a stack.
+ * When the sink of the endpoint to which a received packet is addressed pushes
+ * back, the network interface sink returns GG_ERROR_WOULD_BLOCK for that packet,
+ * and notifies its listener when the endpoint's sink can accept data again.
+ *
+ * @param self The object on which this method is invoked.
+ */
+GG_DataSink* GG_NipStack_AsDataSink(GG_NipStack* self);
+
+/**
+ * Get the GG_DataSource interface for the network interface of a stack.
+ *
+ * @param self The object on which this method is invoked.
+ */
+GG_DataSource* GG_NipStack_AsDataSource(GG_NipStack* self);
+
+/**
+ * Add a UDP endpoint to a stack.
+ * @see GG_Nip_AddUdpEndpoint
+ *
+ * @param self The object on which this method is invoked.
+ * @param udp_endpoint The endpoint to add to the stack.
+ *
+ * @return GG_SUCCESS if the endpoint could be added, or a negative error code.
+ */
+GG_Result GG_NipStack_AddUdpEndpoint(GG_NipStack* self, GG_NipUdpEndpoint* udp_endpoint);
+
+/**
+ * Get the default stack instance, initializing it if needed.
+ *
+ * @return The default stack instance.
+ */
+GG_NipStack* GG_Nip_GetDefaultStack(void);
+
+/**
+ * Initialize the default stack.
  * NOTE: it isn't necessary to call this function directly,
  * since calling GG_Nip_Configure will perform lazy initialization.
  */
 GG_Result GG_Nip_Initialize(void);
 
 /**
- * Terminate the stack.
+ * Terminate the default stack.
  * All sockets must have been removed prior to calling this function.
  */
 void GG_Nip_Terminate(void);
 
 /**
- * Configure the stack.
+ * Configure the default stack.
  *
  * NOTE: the transport source *must* deliver buffers in exact increments
  * of complete IP packets, as the network will not accept partial packets
@@ -94,21 +166,25 @@ void GG_Nip_Terminate(void);
 GG_Result GG_Nip_Configure(const GG_IpAddress* netif_address);
 
 /**
- * Get the GG_DataSink interface for the network interface.
+ * Get the GG_DataSink interface for the network interface of the default stack.
  */
 GG_DataSink* GG_Nip_AsDataSink(void);
 
 /**
- * Get the GG_DataSource interface for the network interface.
+ * Get the GG_DataSource interface for the network interface of the default stack.
  */
 GG_DataSource* GG_Nip_AsDataSource(void);
 
 /**
- * Add a UDP endpoint to the stack.
+ * Add a UDP endpoint to the default stack.
  * UDP endpoints that are added to the stack may send and receive datagrams.
  * The same endpoint may only be added once.
  * Endpoints that have a local port set to 0 will automatically be assigned
- * a dynamic port number by the stack.
+ * a dynamic port number by the stack. Datagrams are delivered to the endpoint
+ * bound to their destination port, or, if there isn't one, to the first
+ * endpoint that was added with a dynamic port.
+ * The stack's port table grows as needed, so the number of endpoints is only
+ * limited by the available memory and the number of ports.
  *
  * @param udp_endpoint The endpoint to add to the stack.
  *
@@ -117,7 +193,7 @@ GG_DataSource* GG_Nip_AsDataSource(void);
 GG_Result GG_Nip_AddUdpEndpoint(GG_NipUdpEndpoint* udp_endpoint);
 
 /**
- * Remove a UDP endpoint from the stack.
+ * Remove a UDP endpoint from the stack it was added to.
  * After removal, the endpoint will not longer be able to send or receive
  * datagrams.
  *
@@ -43,6 +43,20 @@ GG_SET_LOCAL_LOGGER("gg.xp.protocol.ipv4")
 #define GG_IPV4_HEADER_MIN_IHL           5  // min value for the header IHL field
 #define GG_IPV4_HEADER_MAX_IHL           15 // max value for the header IHL field
 
+// number of buffers in the pool used by a frame assembler to emit packets
+#if !defined(GG_CONFIG_IPV4_FRAME_ASSEMBLER_POOL_SIZE)
+#define GG_CONFIG_IPV4_FRAME_ASSEMBLER_POOL_SIZE 4
+#endif
+
+// number of max-size packet slots in each ring used for in-place reassembly
+#if !defined(GG_CONFIG_IPV4_FRAME_ASSEMBLER_RING_PACKETS)
+#define GG_CONFIG_IPV4_FRAME_ASSEMBLER_RING_PACKETS 4
+#endif
+
+// space reserved in front of each packet reassembled in place, so that decompressed
+// headers, which may be larger than the compressed ones, can be written in front of the payload
+#define GG_IPV4_FRAME_ASSEMBLER_RING_HEADROOM (GG_IPV4_MAX_IP_HEADER_SIZE + GG_UDP_HEADER_SIZE)
+
 #define GG_IPV4_HEADER_COMPRESSION_FIXED_SIZE           6    // flags and two fixed-size fields
 #define GG_IPV4_HEADER_COMPRESSION_MAX_OVERHEAD         2    // maximum added size in the worst case
 #define GG_IPV4_HEADER_COMPRESSION_PACKET_IS_COMPRESSED 0x80 // and with fist byte of packet
@@ -83,6 +97,31 @@ GG_SET_LOCAL_LOGGER("gg.xp.protocol.ipv4")
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
+typedef struct GG_Ipv4FrameAssemblerRing GG_Ipv4FrameAssemblerRing;
+
+/**
+ * View of a packet reassembled in place in a slot of a ring.
+ */
+typedef struct {
+    GG_IMPLEMENTS(GG_Buffer);
+
+    GG_Ipv4FrameAssemblerRing* ring;
+    unsigned int               reference_counter; ///< 0 when the slot is free
+    uint8_t*                   data;
+    size_t                     data_size;
+} GG_Ipv4FrameAssemblerPacketView;
+
+/**
+ * Buffer in which packets are reassembled in place, one per slot.
+ * The ring stays alive as long as the assembler or one of the packet views uses it.
+ */
+struct GG_Ipv4FrameAssemblerRing {
+    unsigned int                    reference_counter; ///< 1 for the assembler + 1 per view in use
+    size_t                          slot_size;
+    GG_Ipv4FrameAssemblerPacketView views[GG_CONFIG_IPV4_FRAME_ASSEMBLER_RING_PACKETS];
+    uint8_t                         slots[]; // slot bytes follow
+};
+
 struct GG_Ipv4FrameAssembler {
     GG_IMPLEMENTS(GG_FrameAssembler);
     GG_IF_INSPECTION_ENABLED(GG_IMPLEMENTS(GG_Inspectable);)
@@ -92,6 +131,11 @@ struct GG_Ipv4FrameAssembler {
     GG_Ipv4FrameSerializationIpConfig ip_config;
     bool                              enable_remapping;
     GG_Ipv4FrameAssemblerIpMap        ip_map;
+    GG_BufferPool*                    packet_pool;
+    bool                              in_place;
+    GG_Ipv4FrameAssemblerRing*        ring;        // ring in which packets are reassembled in place
+    GG_Ipv4FrameAssemblerPacketView*  ring_view;   // view for the packet being reassembled in the ring
+    uint8_t*                          packet;      // where the current packet is reassembled
     size_t                            skip;
     size_t                            payload_size;
     size_t                            packet_size;
@@ -107,6 +151,7 @@ struct GG_Ipv4FrameSerializer {
     uint8_t                           workspace[GG_IPV4_MAX_IP_HEADER_SIZE +
                                                 GG_UDP_HEADER_SIZE +
                                                 GG_IPV4_HEADER_COMPRESSION_MAX_OVERHEAD];
+    uint8_t                           headers[GG_IPV4_MAX_IP_HEADER_SIZE + GG_UDP_HEADER_SIZE];
 };
 
 /*----------------------------------------------------------------------
@@ -597,6 +642,170 @@ GG_Ipv4_DecompressHeaders(const uint8_t*                           data,
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+static void
+GG_Ipv4FrameAssemblerRing_Release(GG_Ipv4FrameAssemblerRing* self)
+{
+    GG_ASSERT(self->reference_counter);
+    if (--self->reference_counter == 0) {
+        GG_FreeMemory(self);
+    }
+}
+
+//----------------------------------------------------------------------
+static GG_Buffer*
+GG_Ipv4FrameAssemblerPacketView_Retain(GG_Buffer* _self)
+{
+    GG_Ipv4FrameAssemblerPacketView* self = GG_SELF(GG_Ipv4FrameAssemblerPacketView, GG_Buffer);
+    ++self->reference_counter;
+    return _self;
+}
+
+//----------------------------------------------------------------------
+static void
+GG_Ipv4FrameAssemblerPacketView_Release(GG_Buffer* _self)
+{
+    GG_Ipv4FrameAssemblerPacketView* self = GG_SELF(GG_Ipv4FrameAssemblerPacketView, GG_Buffer);
+    GG_ASSERT(self->reference_counter);
+    if (--self->reference_counter == 0) {
+        // the slot can now be reused, and the ring freed if the assembler is done with it
+        GG_Ipv4FrameAssemblerRing_Release(self->ring);
+    }
+}
+
+//----------------------------------------------------------------------
+static const uint8_t*
+GG_Ipv4FrameAssemblerPacketView_GetData(const GG_Buffer* _self)
+{
+    const GG_Ipv4FrameAssemblerPacketView* self = GG_SELF(GG_Ipv4FrameAssemblerPacketView, GG_Buffer);
+    return self->data;
+}
+
+//----------------------------------------------------------------------
+static uint8_t*
+GG_Ipv4FrameAssemblerPacketView_UseData(GG_Buffer* _self)
+{
+    GG_Ipv4FrameAssemblerPacketView* self = GG_SELF(GG_Ipv4FrameAssemblerPacketView, GG_Buffer);
+    return self->data;
+}
+
+//----------------------------------------------------------------------
+static size_t
+GG_Ipv4FrameAssemblerPacketView_GetDataSize(const GG_Buffer* _self)
+{
+    const GG_Ipv4FrameAssemblerPacketView* self = GG_SELF(GG_Ipv4FrameAssemblerPacketView, GG_Buffer);
+    return self->data_size;
+}
+
+//----------------------------------------------------------------------
+GG_IMPLEMENT_INTERFACE(GG_Ipv4FrameAssemblerPacketView, GG_Buffer) {
+    GG_Ipv4FrameAssemblerPacketView_Retain,
+    GG_Ipv4FrameAssemblerPacketView_Release,
+    GG_Ipv4FrameAssemblerPacketView_GetData,
+    GG_Ipv4FrameAssemblerPacketView_UseData,
+    GG_Ipv4FrameAssemblerPacketView_GetDataSize
+};
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_Ipv4FrameAssemblerRing_Create(size_t slot_size, GG_Ipv4FrameAssemblerRing** ring)
+{
+    size_t ring_size = sizeof(GG_Ipv4FrameAssemblerRing) + GG_CONFIG_IPV4_FRAME_ASSEMBLER_RING_PACKETS * slot_size;
+    GG_Ipv4FrameAssemblerRing* self = (GG_Ipv4FrameAssemblerRing*)GG_AllocateZeroMemory(ring_size);
+    if (self == NULL) {
+        *ring = NULL;
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    self->reference_counter = 1;
+    self->slot_size         = slot_size;
+    for (unsigned int i = 0; i < GG_CONFIG_IPV4_FRAME_ASSEMBLER_RING_PACKETS; i++) {
+        self->views[i].ring = self;
+        GG_SET_INTERFACE(&self->views[i], GG_Ipv4FrameAssemblerPacketView, GG_Buffer);
+    }
+
+    *ring = self;
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Pick a free slot of the ring, before starting to reassemble a packet in place.
+// Slots are free again once the packets emitted from them are released, so in
+// steady state no memory is allocated.
+// When all the slots are still in use, the ring is left to the packets emitted
+// from it, which keep it alive until they are released, and a new one takes its place.
+//----------------------------------------------------------------------
+static GG_Result
+GG_Ipv4FrameAssembler_PrepareRing(GG_Ipv4FrameAssembler* self)
+{
+    self->ring_view = NULL;
+    self->packet    = NULL;
+    if (self->ring) {
+        for (unsigned int i = 0; i < GG_CONFIG_IPV4_FRAME_ASSEMBLER_RING_PACKETS; i++) {
+            if (self->ring->views[i].reference_counter == 0) {
+                self->ring_view = &self->ring->views[i];
+                break;
+            }
+        }
+        if (self->ring_view == NULL) {
+            GG_Ipv4FrameAssemblerRing_Release(self->ring);
+            self->ring = NULL;
+        }
+    }
+    if (self->ring == NULL) {
+        GG_Result result = GG_Ipv4FrameAssemblerRing_Create(GG_IPV4_FRAME_ASSEMBLER_RING_HEADROOM + self->buffer_size,
+                                                            &self->ring);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+        self->ring_view = &self->ring->views[0];
+    }
+
+    size_t slot_index = (size_t)(self->ring_view - self->ring->views);
+    self->packet = &self->ring->slots[slot_index * self->ring->slot_size + GG_IPV4_FRAME_ASSEMBLER_RING_HEADROOM];
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Emit the packet reassembled in the current ring slot, as a view of that slot
+//----------------------------------------------------------------------
+static GG_Buffer*
+GG_Ipv4FrameAssembler_EmitRingView(GG_Ipv4FrameAssembler* self, uint8_t* data, size_t data_size)
+{
+    GG_Ipv4FrameAssemblerPacketView* view = self->ring_view;
+    GG_ASSERT(view);
+    GG_ASSERT(view->reference_counter == 0);
+    view->reference_counter = 1;
+    view->data              = data;
+    view->data_size         = data_size;
+    ++self->ring->reference_counter;
+    self->ring_view = NULL;
+
+    return GG_CAST(view, GG_Buffer);
+}
+
+//----------------------------------------------------------------------
+// Get a buffer for a packet that isn't reassembled in place.
+// The pool is only created when needed, so that it doesn't take up memory
+// when reassembling in place.
+//----------------------------------------------------------------------
+static GG_Result
+GG_Ipv4FrameAssembler_AllocatePacket(GG_Ipv4FrameAssembler* self, size_t size, GG_DynamicBuffer** packet)
+{
+    if (self->packet_pool == NULL) {
+        // (decompressed headers may be larger than the compressed ones)
+        GG_Result result = GG_BufferPool_Create(self->buffer_size + GG_IPV4_MAX_IP_HEADER_SIZE + GG_UDP_HEADER_SIZE,
+                                                GG_CONFIG_IPV4_FRAME_ASSEMBLER_POOL_SIZE,
+                                                &self->packet_pool);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+
+    return GG_BufferPool_AllocateBuffer(self->packet_pool, size, packet);
+}
+
 //----------------------------------------------------------------------
 static void
 GG_Ipv4FrameAssembler_GetFeedBuffer(GG_FrameAssembler* _self, uint8_t** buffer, size_t* buffer_size)
@@ -610,11 +819,21 @@ GG_Ipv4FrameAssembler_GetFeedBuffer(GG_FrameAssembler* _self, uint8_t** buffer,
         *buffer      = self->buffer;
         *buffer_size = GG_MIN(self->skip, self->buffer_size);
         return;
-    } else {
-        GG_ASSERT(self->buffer_size >= self->payload_size);
-        *buffer = &self->buffer[self->payload_size];
     }
 
+    // when reassembling in place, a new packet needs room in the ring
+    if (self->in_place && self->packet_size == 0 && self->payload_size == 0) {
+        GG_Result result = GG_Ipv4FrameAssembler_PrepareRing(self);
+        if (GG_FAILED(result)) {
+            GG_LOG_WARNING("failed to allocate a reassembly buffer (%d)", result);
+            *buffer      = NULL;
+            *buffer_size = 0;
+            return;
+        }
+    }
+    GG_ASSERT(self->buffer_size >= self->payload_size);
+    *buffer = &self->packet[self->payload_size];
+
     // if we're still accumulating the header, only accept that much
     if (self->packet_size == 0) {
         *buffer_size = GG_IPV4_MIN_PARTIAL_HEADER_SIZE - self->payload_size;
@@ -637,7 +856,7 @@ GG_Ipv4FrameAssembler_DecompressAndEmitPacket(GG_Ipv4FrameAssembler* self, GG_Bu
     GG_Ipv4PacketHeader ip_header;
     GG_UdpPacketHeader udp_header;
     size_t compressed_header_size = 0;
-    GG_Result result = GG_Ipv4_DecompressHeaders(self->buffer,
+    GG_Result result = GG_Ipv4_DecompressHeaders(self->packet,
                                                  self->packet_size,
                                                  &self->ip_config,
                                                  &ip_header,
@@ -657,22 +876,39 @@ GG_Ipv4FrameAssembler_DecompressAndEmitPacket(GG_Ipv4FrameAssembler* self, GG_Bu
     GG_ASSERT(compressed_header_size <= self->packet_size);
     GG_ASSERT(compressed_header_size <= ip_header.total_length);
 
-    // allocate a packet
-    GG_DynamicBuffer* packet;
-    result = GG_DynamicBuffer_Create(ip_header.total_length, &packet);
-    if (GG_FAILED(result)) {
-        return result;
-    }
-    GG_DynamicBuffer_SetDataSize(packet, ip_header.total_length);
-
-    // serialize the headers
     // NOTE: GG_Ipv4_DecompressHeaders guarantees us that ip_header.total_length is correct
     // with respect to the other header size fields
     size_t ip_header_size = 4 * ip_header.ihl;
+    size_t headers_size = ip_header_size + (ip_header.protocol == GG_IPV4_PROTOCOL_UDP ? GG_UDP_HEADER_SIZE : 0);
+
+    // when reassembling in place, the headers are written just before the payload, in the headroom
+    // and the space of the compressed headers, and the packet is a view of the ring slot
+    GG_DynamicBuffer* packet = NULL;
+    uint8_t* output;
+    if (self->in_place) {
+        GG_ASSERT(headers_size <= GG_IPV4_FRAME_ASSEMBLER_RING_HEADROOM + compressed_header_size);
+        output = self->packet + compressed_header_size - headers_size;
+        *frame = GG_Ipv4FrameAssembler_EmitRingView(self, output, ip_header.total_length);
+    } else {
+        // allocate a packet
+        result = GG_Ipv4FrameAssembler_AllocatePacket(self, ip_header.total_length, &packet);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+        GG_DynamicBuffer_SetDataSize(packet, ip_header.total_length);
+        output = GG_DynamicBuffer_UseData(packet);
+    }
+
+    // serialize the headers
     size_t buffer_size = ip_header_size;
-    uint8_t* output = GG_DynamicBuffer_UseData(packet);
     result = GG_Ipv4PacketHeader_Serialize(&ip_header, output, &buffer_size, true);
     if (GG_FAILED(result)) {
+        if (packet) {
+            GG_DynamicBuffer_Release(packet);
+        } else {
+            GG_Buffer_Release(*frame);
+        }
+        *frame = NULL;
         return result;
     }
     output += ip_header_size;
@@ -681,11 +917,13 @@ GG_Ipv4FrameAssembler_DecompressAndEmitPacket(GG_Ipv4FrameAssembler* self, GG_Bu
         output += GG_UDP_HEADER_SIZE;
     }
 
-    // copy the payload
-    if (self->packet_size > compressed_header_size) {
-        memcpy(output, self->buffer + compressed_header_size, self->packet_size - compressed_header_size);
+    // copy the payload, unless it is already in place
+    if (packet) {
+        if (self->packet_size > compressed_header_size) {
+            memcpy(output, self->packet + compressed_header_size, self->packet_size - compressed_header_size);
+        }
+        *frame = GG_DynamicBuffer_AsBuffer(packet);
     }
-    *frame = GG_DynamicBuffer_AsBuffer(packet);
 
     return GG_SUCCESS;
 }
@@ -694,12 +932,18 @@ GG_Ipv4FrameAssembler_DecompressAndEmitPacket(GG_Ipv4FrameAssembler* self, GG_Bu
 static GG_Result
 GG_Ipv4FrameAssembler_CopyAndEmitPacket(GG_Ipv4FrameAssembler* self, GG_Buffer** frame)
 {
+    // when reassembling in place, the packet is already complete in the ring
+    if (self->in_place) {
+        *frame = GG_Ipv4FrameAssembler_EmitRingView(self, self->packet, self->packet_size);
+        return GG_SUCCESS;
+    }
+
     // allocate a packet
     GG_DynamicBuffer* packet;
-    GG_Result result = GG_DynamicBuffer_Create(self->packet_size, &packet);
+    GG_Result result = GG_Ipv4FrameAssembler_AllocatePacket(self, self->packet_size, &packet);
     if (GG_SUCCEEDED(result)) {
         // copy the data
-        memcpy(GG_DynamicBuffer_UseData(packet), self->buffer, self->packet_size);
+        memcpy(GG_DynamicBuffer_UseData(packet), self->packet, self->packet_size);
         GG_DynamicBuffer_SetDataSize(packet, self->packet_size);
         *frame = GG_DynamicBuffer_AsBuffer(packet);
     }
@@ -712,7 +956,7 @@ static GG_Result
 GG_Ipv4FrameAssembler_EmitPacket(GG_Ipv4FrameAssembler* self, GG_Buffer** frame)
 {
     GG_Result result;
-    if (self->buffer[0] & GG_IPV4_HEADER_COMPRESSION_PACKET_IS_COMPRESSED) {
+    if (self->packet[0] & GG_IPV4_HEADER_COMPRESSION_PACKET_IS_COMPRESSED) {
         // this is a compressed packet
         result = GG_Ipv4FrameAssembler_DecompressAndEmitPacket(self, frame);
     } else {
@@ -805,7 +1049,7 @@ GG_Ipv4FrameAssembler_Feed(GG_FrameAssembler* _self, size_t* data_size, GG_Buffe
         consumed = needed;
 
         // header complete, parse the total packet size
-        self->packet_size = GG_BytesToInt16Be(&self->buffer[2]);
+        self->packet_size = GG_BytesToInt16Be(&self->packet[2]);
         GG_LOG_FINEST("got packet header, packet_size=%u", (int)self->packet_size);
 
         // sanity check
@@ -876,10 +1120,14 @@ GG_Ipv4FrameAssembler_Inspect(GG_Inspectable* _self, GG_Inspector* inspector, co
 
     GG_Inspector_OnBoolean(inspector, "enable_decompression", self->enable_decompression);
     GG_Inspector_OnBoolean(inspector, "enable_remapping",     self->enable_remapping);
+    GG_Inspector_OnBoolean(inspector, "in_place",             self->in_place);
     GG_Inspector_OnInteger(inspector, "skip",         self->skip,         GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
     GG_Inspector_OnInteger(inspector, "payload_size", self->payload_size, GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
     GG_Inspector_OnInteger(inspector, "packet_size",  self->packet_size,  GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
     GG_Inspector_OnInteger(inspector, "buffer_size",  self->buffer_size,  GG_INSPECTOR_FORMAT_HINT_UNSIGNED);
+    if (self->packet_pool) {
+        GG_Inspector_OnInspectable(inspector, "packet_pool", GG_BufferPool_AsInspectable(self->packet_pool));
+    }
 
     return GG_SUCCESS;
 }
@@ -921,6 +1169,7 @@ GG_Ipv4FrameAssembler_Create(uint16_t                                 max_packet
 
     // setup the object
     (*assembler)->buffer_size = max_packet_size;
+    (*assembler)->packet      = (*assembler)->buffer;
 
     // setup the vtables
     GG_SET_INTERFACE(*assembler, GG_Ipv4FrameAssembler, GG_FrameAssembler);
@@ -939,9 +1188,45 @@ GG_Ipv4FrameAssembler_Destroy(GG_Ipv4FrameAssembler* self)
     if (self == NULL) return;
     GG_THREAD_GUARD_CHECK_BINDING(self);
 
+    if (self->packet_pool) {
+        GG_BufferPool_Destroy(self->packet_pool);
+    }
+    if (self->ring) {
+        GG_Ipv4FrameAssemblerRing_Release(self->ring);
+    }
     GG_ClearAndFreeObject(self, 1);
 }
 
+//----------------------------------------------------------------------
+void
+GG_Ipv4FrameAssembler_EnableInPlaceReassembly(GG_Ipv4FrameAssembler* self, bool enable)
+{
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    if (enable == self->in_place) {
+        return;
+    }
+
+    // any partially reassembled packet is dropped
+    GG_FrameAssembler_Reset(GG_CAST(self, GG_FrameAssembler));
+    self->in_place = enable;
+    if (enable) {
+        // the ring is allocated when the first packet starts, and the packet pool isn't needed
+        self->packet = NULL;
+        if (self->packet_pool) {
+            GG_BufferPool_Destroy(self->packet_pool);
+            self->packet_pool = NULL;
+        }
+    } else {
+        if (self->ring) {
+            GG_Ipv4FrameAssemblerRing_Release(self->ring);
+            self->ring      = NULL;
+            self->ring_view = NULL;
+        }
+        self->packet = self->buffer;
+    }
+}
+
 //----------------------------------------------------------------------
 GG_FrameAssembler*
 GG_Ipv4FrameAssembler_AsFrameAssembler(GG_Ipv4FrameAssembler* self)
@@ -958,14 +1243,40 @@ GG_Ipv4FrameAssembler_AsInspectable(GG_Ipv4FrameAssembler* self)
 }
 #endif
 
+//----------------------------------------------------------------------
+// Write the data of a frame, starting at a given offset, to a ring buffer.
+// Chains are written segment by segment, without coalescing them first.
+//----------------------------------------------------------------------
+static void
+GG_Ipv4FrameSerializer_WriteData(GG_Buffer* frame, size_t offset, GG_RingBuffer* output_buffer)
+{
+    GG_BufferChain* chain = GG_BufferChain_FromBuffer(frame);
+    if (chain == NULL) {
+        GG_RingBuffer_Write(output_buffer, GG_Buffer_GetData(frame) + offset, GG_Buffer_GetDataSize(frame) - offset);
+        return;
+    }
+
+    size_t segment_count = GG_BufferChain_GetSegmentCount(chain);
+    for (size_t i = 0; i < segment_count; i++) {
+        size_t segment_size = 0;
+        const uint8_t* segment = GG_BufferChain_GetSegment(chain, i, &segment_size);
+        if (offset >= segment_size) {
+            offset -= segment_size;
+            continue;
+        }
+        GG_RingBuffer_Write(output_buffer, segment + offset, segment_size - offset);
+        offset = 0;
+    }
+}
+
 //----------------------------------------------------------------------
 static GG_Result
 GG_Ipv4FrameSerializer_SerializeFrame(GG_FrameSerializer* _self,
-                                      const uint8_t*      frame,
-                                      size_t              frame_size,
+                                      GG_Buffer*          frame,
                                       GG_RingBuffer*      output_buffer)
 {
     GG_Ipv4FrameSerializer* self = GG_SELF(GG_Ipv4FrameSerializer, GG_FrameSerializer);
+    size_t frame_size = GG_Buffer_GetDataSize(frame);
 
     // check the parameters
     if (frame_size >= output_buffer->size) {
@@ -987,9 +1298,21 @@ GG_Ipv4FrameSerializer_SerializeFrame(GG_FrameSerializer* _self,
 
     // serialize
     if (self->enable_compression) {
+        // get a contiguous view of the headers (chains need to be gathered)
+        const uint8_t*  headers;
+        size_t          headers_size;
+        GG_BufferChain* chain = GG_BufferChain_FromBuffer(frame);
+        if (chain) {
+            headers_size = GG_BufferChain_CopyData(chain, 0, self->headers, sizeof(self->headers));
+            headers      = self->headers;
+        } else {
+            headers_size = frame_size;
+            headers      = GG_Buffer_GetData(frame);
+        }
+
         // parse the frame
         GG_Ipv4PacketHeader ip_header;
-        GG_Result result = GG_Ipv4PacketHeader_Parse(&ip_header, frame, frame_size);
+        GG_Result result = GG_Ipv4PacketHeader_Parse(&ip_header, headers, headers_size);
         if (GG_FAILED(result)) {
             return result;
         }
@@ -1004,7 +1327,9 @@ GG_Ipv4FrameSerializer_SerializeFrame(GG_FrameSerializer* _self,
             if (frame_size < header_size) {
                 return GG_ERROR_INVALID_FORMAT;
             }
-            result = GG_UdpPacketHeader_Parse(&udp_header, frame + ip_header_size, frame_size - ip_header_size);
+            result = GG_UdpPacketHeader_Parse(&udp_header,
+                                              headers + ip_header_size,
+                                              headers_size - ip_header_size);
             if (GG_FAILED(result)) {
                 return result;
             }
@@ -1021,10 +1346,10 @@ GG_Ipv4FrameSerializer_SerializeFrame(GG_FrameSerializer* _self,
         GG_RingBuffer_Write(output_buffer, self->workspace, compressed_header_size);
 
         // copy the payload
-        GG_RingBuffer_Write(output_buffer, frame + header_size, frame_size - header_size);
+        GG_Ipv4FrameSerializer_WriteData(frame, header_size, output_buffer);
     } else {
         // copy the data as-is into the ring buffer
-        GG_RingBuffer_Write(output_buffer, frame, frame_size);
+        GG_Ipv4FrameSerializer_WriteData(frame, 0, output_buffer);
     }
 
     return GG_SUCCESS;
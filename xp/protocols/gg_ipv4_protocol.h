@@ -135,6 +135,21 @@ GG_Result GG_Ipv4FrameAssembler_Create(uint16_t
  */
 void GG_Ipv4FrameAssembler_Destroy(GG_Ipv4FrameAssembler* self);
 
+/**
+ * Enable or disable in-place reassembly.
+ * When enabled, packets are reassembled directly in a reference-counted buffer,
+ * and emitted as #GG_SubBuffer views of that buffer instead of being copied to a
+ * new buffer (compressed headers are decompressed in place, in space reserved in
+ * front of each packet). A buffer holds several packets, and a new one is allocated
+ * when it is full. Emitted packets keep their buffer alive until they are released,
+ * so this mode is best suited to consumers that don't hold on to packets for long.
+ * Any partially reassembled packet is dropped when the mode changes.
+ *
+ * @param self Object on which this method is called.
+ * @param enable Whether in-place reassembly should be enabled.
+ */
+void GG_Ipv4FrameAssembler_EnableInPlaceReassembly(GG_Ipv4FrameAssembler* self, bool enable);
+
 /**
  * Get the #GG_FrameAssembler interface for this object.
  *
@@ -55,10 +55,9 @@ GG_FrameAssembler_Reset(GG_FrameAssembler* self)
 //----------------------------------------------------------------------
 GG_Result
 GG_FrameSerializer_SerializeFrame(GG_FrameSerializer* self,
-                                  const uint8_t*      frame,
-                                  size_t              frame_size,
+                                  GG_Buffer*          frame,
                                   GG_RingBuffer*      output)
 {
     GG_ASSERT(self);
-    return GG_INTERFACE(self)->SerializeFrame(self, frame, frame_size, output);
+    return GG_INTERFACE(self)->SerializeFrame(self, frame, output);
 }
@@ -113,17 +113,17 @@ GG_DECLARE_INTERFACE(GG_FrameSerializer) {
     /**
      * Serialize a frame into an output buffer.
      * The serializer must consume the entire frame in a single call.
+     * The frame may be a GG_BufferChain, in which case the serializer should
+     * read its segments directly rather than coalescing them.
      *
      * @param self The object on which this method is called.
-     * @param frame Pointer to the frame data to serialize
-     * @param frame_size Size of frame
+     * @param frame The frame to serialize
      * @param output The buffer in which the serialized data should be written.
      *
      * @return GG_SUCCESS if the frame could be serialized, or a negative error code
      */
     GG_Result (*SerializeFrame)(GG_FrameSerializer* self,
-                                const uint8_t*      frame,
-                                size_t              frame_size,
+                                GG_Buffer*          frame,
                                 GG_RingBuffer*      output);
 };
 
@@ -136,8 +136,7 @@ GG_DECLARE_INTERFACE(GG_FrameSerializer) {
 //! @relates GG_FrameSerializer
 //! @copydoc GG_FrameSerializerInterface::SerializeFrame
 GG_Result GG_FrameSerializer_SerializeFrame(GG_FrameSerializer* self,
-                                            const uint8_t*      frame,
-                                            size_t              frame_size,
+                                            GG_Buffer*          frame,
                                             GG_RingBuffer*      output);
 
 //!@}
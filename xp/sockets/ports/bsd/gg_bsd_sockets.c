@@ -18,6 +18,10 @@
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // needed for recvmmsg/sendmmsg
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -67,6 +71,7 @@ typedef int           GG_ssize_t;
 // standard unix/BSD
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/ioctl.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -106,6 +111,31 @@ GG_SET_LOCAL_LOGGER("gg.xp.sockets.bsd")
 #define GG_BSD_DATAGRAM_SOCKET_MAX_RESEND_SLEEP_TIME 128   // milliseconds
 #define GG_BSD_DATAGRAM_SOCKET_MIN_RESEND_SLEEP_TIME 8     // milliseconds
 
+// max number of datagrams received or sent with a single system call
+#if !defined(GG_CONFIG_BSD_SOCKETS_BATCH_SIZE)
+#define GG_CONFIG_BSD_SOCKETS_BATCH_SIZE 16
+#endif
+
+// max number of bytes in a socket's pool of receive buffers (the pool has one buffer
+// per datagram read with a single system call, but at least one)
+#if !defined(GG_CONFIG_BSD_SOCKETS_RECEIVE_POOL_MAX_SIZE)
+#define GG_CONFIG_BSD_SOCKETS_RECEIVE_POOL_MAX_SIZE (32 * 1024)
+#endif
+
+// use recvmmsg/sendmmsg where available
+#if defined(__linux__) && !defined(GG_CONFIG_BSD_SOCKETS_DISABLE_MMSG)
+#define GG_BSD_SOCKETS_HAVE_MMSG
+#endif
+
+// use sendmsg where available, so that buffer chains can be sent without being coalesced
+#if GG_CONFIG_PLATFORM != GG_PLATFORM_BISON && GG_CONFIG_PLATFORM != GG_PLATFORM_WINDOWS
+#define GG_BSD_SOCKETS_HAVE_SENDMSG
+#endif
+
+// max number of segments of a buffer chain sent as separate iovecs
+// (chains with more segments are coalesced before being sent)
+#define GG_BSD_SOCKETS_MAX_IOVECS 8
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -114,6 +144,15 @@ typedef union {
     struct sockaddr_in sa_in;
 } GG_sockaddr;
 
+/**
+ * Outgoing datagram waiting to be sent.
+ */
+typedef struct {
+    GG_Buffer*   data;
+    GG_sockaddr  destination_address;
+    GG_socklen_t destination_address_length;
+} GG_BsdDatagramSocketSendEntry;
+
 typedef struct {
     GG_IMPLEMENTS(GG_DatagramSocket);
     GG_IMPLEMENTS(GG_DataSink);
@@ -133,6 +172,15 @@ typedef struct {
     GG_DataSinkListener*              sink_listener;
     GG_Timer*                         resend_timer;
     uint32_t                          resend_sleep_time;
+    GG_BufferPool*                    buffer_pool; // created when the first datagram is received
+    unsigned int                      receive_batch_size; // max number of datagrams read with one system call
+    bool                              delivering; // true while received datagrams are being delivered
+    GG_DynamicBuffer*                 receive_queue[GG_CONFIG_BSD_SOCKETS_BATCH_SIZE]; // last batch received
+    GG_sockaddr                       receive_addresses[GG_CONFIG_BSD_SOCKETS_BATCH_SIZE];
+    unsigned int                      receive_queue_length;  // number of datagrams in the last batch
+    unsigned int                      receive_queue_delivered; // number of those accepted by the sink
+    GG_BsdDatagramSocketSendEntry     send_queue[GG_CONFIG_BSD_SOCKETS_BATCH_SIZE];
+    unsigned int                      send_queue_length;
 
     GG_THREAD_GUARD_ENABLE_BINDING
 } GG_BsdDatagramSocket;
@@ -268,6 +316,22 @@ SetNonBlocking(GG_SocketFd fd)
 }
 #endif
 
+//----------------------------------------------------------------------
+// Remove the first entries of the send queue
+//----------------------------------------------------------------------
+static void
+GG_BsdDatagramSocket_DequeueSent(GG_BsdDatagramSocket* self, unsigned int count)
+{
+    GG_ASSERT(count <= self->send_queue_length);
+    for (unsigned int i = 0; i < count; i++) {
+        GG_Buffer_Release(self->send_queue[i].data);
+    }
+    self->send_queue_length -= count;
+    memmove(&self->send_queue[0],
+            &self->send_queue[count],
+            self->send_queue_length * sizeof(self->send_queue[0]));
+}
+
 //----------------------------------------------------------------------
 static GG_DataSink*
 GG_BsdDatagramSocket_AsDataSink(GG_DatagramSocket* _self)
@@ -299,6 +363,15 @@ GG_BsdDatagramSocket_Destroy(GG_DatagramSocket* _self)
     // destroy the resend timer if we have one
     GG_Timer_Destroy(self->resend_timer);
 
+    // drop anything that's still queued
+    GG_BsdDatagramSocket_DequeueSent(self, self->send_queue_length);
+    for (unsigned int i = self->receive_queue_delivered; i < self->receive_queue_length; i++) {
+        GG_DynamicBuffer_Release(self->receive_queue[i]);
+    }
+
+    // destroy the buffer pool (buffers still held by sinks remain valid)
+    GG_BufferPool_Destroy(self->buffer_pool);
+
     // de-register from the loop
     if (self->loop) {
         GG_Loop_RemoveFileDescriptorHandler(self->loop, &self->handler);
@@ -339,48 +412,127 @@ GG_BsdDatagramSocket_Attach(GG_DatagramSocket* _self, GG_Loop* loop)
 
 //----------------------------------------------------------------------
 static GG_Result
-GG_BsdDatagramSocket_TryToSend(GG_BsdDatagramSocket*    self,
-                               GG_Buffer*               data,
-                               const GG_BufferMetadata* metadata)
+GG_BsdDatagramSocket_GetDestination(GG_BsdDatagramSocket*    self,
+                                    const GG_BufferMetadata* metadata,
+                                    GG_sockaddr*             destination_address,
+                                    GG_socklen_t*            destination_address_length)
+{
+    if (metadata && metadata->type == GG_BUFFER_METADATA_TYPE_DESTINATION_SOCKET_ADDRESS) {
+        SocketAddressToInetAddress(&((const GG_SocketAddressMetadata*)metadata)->socket_address,
+                                   destination_address,
+                                   destination_address_length);
+    } else if (self->remote_address.port) {
+        SocketAddressToInetAddress(&self->remote_address,
+                                   destination_address,
+                                   destination_address_length);
+    } else {
+        return GG_ERROR_INVALID_STATE;
+    }
+
+    return GG_SUCCESS;
+}
+
+#if defined(GG_BSD_SOCKETS_HAVE_SENDMSG)
+//----------------------------------------------------------------------
+// Describe the data of a datagram with an iovec array.
+// Buffer chains are described segment by segment, so they can be sent
+// without being coalesced.
+// Returns the number of iovecs used.
+//----------------------------------------------------------------------
+static size_t
+GG_BsdDatagramSocket_GetIovecs(GG_Buffer* data, struct iovec* iovecs)
+{
+    GG_BufferChain* chain = GG_BufferChain_FromBuffer(data);
+    if (chain) {
+        size_t segment_count = GG_BufferChain_GetSegmentCount(chain);
+        if (segment_count <= GG_BSD_SOCKETS_MAX_IOVECS) {
+            for (size_t i = 0; i < segment_count; i++) {
+                size_t segment_size = 0;
+                iovecs[i].iov_base = (void*)(uintptr_t)GG_BufferChain_GetSegment(chain, i, &segment_size);
+                iovecs[i].iov_len  = segment_size;
+            }
+            return segment_count;
+        }
+    }
+
+    iovecs[0].iov_base = (void*)(uintptr_t)GG_Buffer_GetData(data);
+    iovecs[0].iov_len  = GG_Buffer_GetDataSize(data);
+    return 1;
+}
+#endif
+
+//----------------------------------------------------------------------
+// Send a single datagram, retrying if the call is interrupted.
+// The destination address is ignored if the socket is connected.
+//----------------------------------------------------------------------
+static GG_ssize_t
+GG_BsdDatagramSocket_SendDatagram(GG_BsdDatagramSocket* self,
+                                  GG_Buffer*            data,
+                                  const GG_sockaddr*    destination_address,
+                                  GG_socklen_t          destination_address_length)
 {
-    // decide where to send
     GG_ssize_t io_result;
-    if (self->connected) {
-        // try to send the payload
-        do {
+#if defined(GG_BSD_SOCKETS_HAVE_SENDMSG)
+    struct iovec  iovecs[GG_BSD_SOCKETS_MAX_IOVECS];
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov    = iovecs;
+    message.msg_iovlen = GG_BsdDatagramSocket_GetIovecs(data, iovecs);
+    if (!self->connected) {
+        message.msg_name    = (void*)(uintptr_t)&destination_address->sa;
+        message.msg_namelen = destination_address_length;
+    }
+    do {
+        io_result = sendmsg(self->fd, &message, 0);
+        GG_LOG_FINER("sendmsg returned %d", (int)io_result);
+    } while (GG_BSD_SOCKET_CALL_FAILED(io_result) && GetLastSocketError() == EINTR);
+#else
+    do {
+        if (self->connected) {
             io_result = send(self->fd,
                              (const void*)GG_Buffer_GetData(data),
                              (size_t)GG_Buffer_GetDataSize(data),
                              0);
             GG_LOG_FINER("send returned %d", (int)io_result);
-        } while (GG_BSD_SOCKET_CALL_FAILED(io_result) && GetLastSocketError() == EINTR);
-    } else {
-        GG_sockaddr  destination_address;
-        GG_socklen_t destination_address_length;
-        if (metadata && metadata->type == GG_BUFFER_METADATA_TYPE_DESTINATION_SOCKET_ADDRESS) {
-            SocketAddressToInetAddress(&((const GG_SocketAddressMetadata*)metadata)->socket_address,
-                                       &destination_address,
-                                       &destination_address_length);
-        } else if (self->remote_address.port) {
-            SocketAddressToInetAddress(&self->remote_address,
-                                       &destination_address,
-                                       &destination_address_length);
         } else {
-            return GG_ERROR_INVALID_STATE;
-        }
-
-        // try to send the payload
-        do {
             io_result = sendto(self->fd,
                                (const void*)GG_Buffer_GetData(data),
                                (size_t)GG_Buffer_GetDataSize(data),
                                0,
-                               &destination_address.sa,
+                               &destination_address->sa,
                                destination_address_length);
             GG_LOG_FINER("sendto returned %d", (int)io_result);
-        } while (GG_BSD_SOCKET_CALL_FAILED(io_result) && GetLastSocketError() == EINTR);
+        }
+    } while (GG_BSD_SOCKET_CALL_FAILED(io_result) && GetLastSocketError() == EINTR);
+#endif
+
+    return io_result;
+}
+
+//----------------------------------------------------------------------
+static GG_Result
+GG_BsdDatagramSocket_TryToSend(GG_BsdDatagramSocket*    self,
+                               GG_Buffer*               data,
+                               const GG_BufferMetadata* metadata)
+{
+    // decide where to send
+    GG_sockaddr  destination_address;
+    GG_socklen_t destination_address_length = 0;
+    if (!self->connected) {
+        GG_Result result = GG_BsdDatagramSocket_GetDestination(self,
+                                                               metadata,
+                                                               &destination_address,
+                                                               &destination_address_length);
+        if (GG_FAILED(result)) {
+            return result;
+        }
     }
 
+    // try to send the payload
+    GG_ssize_t io_result = GG_BsdDatagramSocket_SendDatagram(self,
+                                                             data,
+                                                             &destination_address,
+                                                             destination_address_length);
     if (GG_BSD_SOCKET_CALL_FAILED(io_result)) {
         GG_LOG_FINER("sendto error = %d", (int)GetLastSocketError());
         return MapErrorCode(GetLastSocketError());
@@ -389,19 +541,71 @@ GG_BsdDatagramSocket_TryToSend(GG_BsdDatagramSocket*    self,
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Send as many queued datagrams as possible.
+// Returns GG_SUCCESS when the queue is empty, or the error that
+// prevented the queue from being emptied.
 //----------------------------------------------------------------------
 static GG_Result
-GG_BsdDatagramSocket_PutData(GG_DataSink*             _self,
-                             GG_Buffer*               data,
-                             const GG_BufferMetadata* metadata)
+GG_BsdDatagramSocket_FlushSendQueue(GG_BsdDatagramSocket* self)
 {
-    GG_ASSERT(_self);
-    GG_ASSERT(data);
-    GG_BsdDatagramSocket* self = GG_SELF(GG_BsdDatagramSocket, GG_DataSink);
-    GG_THREAD_GUARD_CHECK_BINDING(self);
+    while (self->send_queue_length) {
+        GG_ssize_t io_result;
+#if defined(GG_BSD_SOCKETS_HAVE_MMSG)
+        // send the whole queue with a single call
+        struct mmsghdr messages[GG_CONFIG_BSD_SOCKETS_BATCH_SIZE];
+        struct iovec   iovecs[GG_CONFIG_BSD_SOCKETS_BATCH_SIZE][GG_BSD_SOCKETS_MAX_IOVECS];
+        memset(messages, 0, self->send_queue_length * sizeof(messages[0]));
+        for (unsigned int i = 0; i < self->send_queue_length; i++) {
+            GG_BsdDatagramSocketSendEntry* entry = &self->send_queue[i];
+            messages[i].msg_hdr.msg_iov    = iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = GG_BsdDatagramSocket_GetIovecs(entry->data, iovecs[i]);
+            if (!self->connected) {
+                messages[i].msg_hdr.msg_name    = &entry->destination_address.sa;
+                messages[i].msg_hdr.msg_namelen = entry->destination_address_length;
+            }
+        }
+        do {
+            io_result = sendmmsg(self->fd, messages, self->send_queue_length, 0);
+            GG_LOG_FINER("sendmmsg returned %d", (int)io_result);
+        } while (GG_BSD_SOCKET_CALL_FAILED(io_result) && GetLastSocketError() == EINTR);
+#else
+        // send the datagrams one by one
+        GG_BsdDatagramSocketSendEntry* entry = &self->send_queue[0];
+        io_result = GG_BsdDatagramSocket_SendDatagram(self,
+                                                      entry->data,
+                                                      &entry->destination_address,
+                                                      entry->destination_address_length);
+        if (!GG_BSD_SOCKET_CALL_FAILED(io_result)) {
+            io_result = 1;
+        }
+#endif
 
-    // try to send
-    GG_Result result = GG_BsdDatagramSocket_TryToSend(self, data, metadata);
+        if (GG_BSD_SOCKET_CALL_FAILED(io_result)) {
+            GG_Result result = MapErrorCode(GetLastSocketError());
+            if (result == GG_ERROR_WOULD_BLOCK || result == GG_ERROR_OUT_OF_RESOURCES) {
+                // keep the queue for later
+                return result;
+            }
+
+            // the first datagram can't be sent, drop it
+            GG_LOG_FINE("dropping datagram (%d)", result);
+            io_result = 1;
+        }
+
+        GG_BsdDatagramSocket_DequeueSent(self, (unsigned int)io_result);
+    }
+
+    return GG_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+// Handle the outcome of a send attempt, setting up what is needed to
+// be notified when it is possible to try again.
+//----------------------------------------------------------------------
+static GG_Result
+GG_BsdDatagramSocket_OnSendResult(GG_BsdDatagramSocket* self, GG_Result result)
+{
     if (GG_SUCCEEDED(result)) {
         // cancel any active resend timer and reset the exponential back-off counter
         self->resend_sleep_time = 0;
@@ -440,6 +644,49 @@ GG_BsdDatagramSocket_PutData(GG_DataSink*             _self,
     return result;
 }
 
+//----------------------------------------------------------------------
+static GG_Result
+GG_BsdDatagramSocket_PutData(GG_DataSink*             _self,
+                             GG_Buffer*               data,
+                             const GG_BufferMetadata* metadata)
+{
+    GG_ASSERT(_self);
+    GG_ASSERT(data);
+    GG_BsdDatagramSocket* self = GG_SELF(GG_BsdDatagramSocket, GG_DataSink);
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    // send right away, unless there are datagrams queued (we must preserve the order)
+    // or received datagrams are being delivered (datagrams sent in response
+    // will be sent together when the delivery is complete)
+    if (!self->send_queue_length && !self->delivering) {
+        return GG_BsdDatagramSocket_OnSendResult(self, GG_BsdDatagramSocket_TryToSend(self, data, metadata));
+    }
+
+    // make room in the queue if needed
+    if (self->send_queue_length == GG_ARRAY_SIZE(self->send_queue)) {
+        GG_Result result = GG_BsdDatagramSocket_OnSendResult(self, GG_BsdDatagramSocket_FlushSendQueue(self));
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+
+    // queue the datagram
+    GG_BsdDatagramSocketSendEntry* entry = &self->send_queue[self->send_queue_length];
+    if (!self->connected) {
+        GG_Result result = GG_BsdDatagramSocket_GetDestination(self,
+                                                               metadata,
+                                                               &entry->destination_address,
+                                                               &entry->destination_address_length);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+    entry->data = GG_Buffer_Retain(data);
+    ++self->send_queue_length;
+
+    return GG_SUCCESS;
+}
+
 //----------------------------------------------------------------------
 static GG_Result
 GG_BsdDatagramSocket_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
@@ -461,15 +708,160 @@ GG_BsdDatagramSocket_SetDataSink(GG_DataSource* _self, GG_DataSink* data_sink)
     GG_BsdDatagramSocket* self = GG_SELF(GG_BsdDatagramSocket, GG_DataSource);
     GG_THREAD_GUARD_CHECK_BINDING(self);
 
+    // de-register as a listener from the current sink
+    if (self->data_sink) {
+        GG_DataSink_SetListener(self->data_sink, NULL);
+    }
+
     // keep a reference to the sink
     self->data_sink = data_sink;
 
+    // register as a listener, so that we can resume delivering when the sink pushes back
+    if (data_sink) {
+        GG_DataSink_SetListener(data_sink, GG_CAST(self, GG_DataSinkListener));
+    }
+
     // express an interest in being notified when data is available to read
     self->handler.event_mask |= GG_EVENT_FLAG_FD_CAN_READ;
 
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+// Receive up to receive_batch_size datagrams.
+// Returns the number of datagrams received, or a negative error code.
+//----------------------------------------------------------------------
+static int
+GG_BsdDatagramSocket_Receive(GG_BsdDatagramSocket* self,
+                             GG_DynamicBuffer*     buffers[],
+                             GG_sockaddr           sender_addresses[])
+{
+    // create the pool of receive buffers if we don't have one yet, so that sockets
+    // that never receive anything don't hold on to it
+    if (self->buffer_pool == NULL) {
+        GG_Result result = GG_BufferPool_Create(self->max_datagram_size,
+                                                self->receive_batch_size,
+                                                &self->buffer_pool);
+        if (GG_FAILED(result)) {
+            return result;
+        }
+    }
+
+    // get buffers to receive into
+    unsigned int buffer_count = 0;
+    for (; buffer_count < self->receive_batch_size; buffer_count++) {
+        GG_Result result = GG_BufferPool_AllocateBuffer(self->buffer_pool,
+                                                        self->max_datagram_size,
+                                                        &buffers[buffer_count]);
+        if (GG_FAILED(result)) {
+            break;
+        }
+    }
+    if (buffer_count == 0) {
+        return GG_ERROR_OUT_OF_MEMORY;
+    }
+
+    // read
+    int received;
+#if defined(GG_BSD_SOCKETS_HAVE_MMSG)
+    struct mmsghdr messages[GG_CONFIG_BSD_SOCKETS_BATCH_SIZE];
+    struct iovec   iovecs[GG_CONFIG_BSD_SOCKETS_BATCH_SIZE];
+    memset(messages, 0, buffer_count * sizeof(messages[0]));
+    for (unsigned int i = 0; i < buffer_count; i++) {
+        iovecs[i].iov_base = GG_DynamicBuffer_UseData(buffers[i]);
+        iovecs[i].iov_len  = self->max_datagram_size;
+        messages[i].msg_hdr.msg_iov     = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen  = 1;
+        messages[i].msg_hdr.msg_name    = &sender_addresses[i].sa;
+        messages[i].msg_hdr.msg_namelen = sizeof(sender_addresses[i]);
+    }
+    do {
+        received = recvmmsg(self->fd, messages, buffer_count, 0, NULL);
+        GG_LOG_FINER("recvmmsg returned %d", received);
+    } while (GG_BSD_SOCKET_CALL_FAILED(received) && GetLastSocketError() == EINTR);
+    for (int i = 0; i < received; i++) {
+        GG_DynamicBuffer_SetDataSize(buffers[i], messages[i].msg_len);
+    }
+#else
+    GG_socklen_t sender_address_length = sizeof(sender_addresses[0]);
+    GG_ssize_t   io_result;
+    do {
+        io_result = recvfrom(self->fd,
+                             (void*)GG_DynamicBuffer_UseData(buffers[0]),
+                             (size_t)self->max_datagram_size,
+                             0,
+                             &sender_addresses[0].sa,
+                             &sender_address_length);
+        GG_LOG_FINER("recvfrom returned %d", (int)io_result);
+    } while (GG_BSD_SOCKET_CALL_FAILED(io_result) && GetLastSocketError() == EINTR);
+    if (GG_BSD_SOCKET_CALL_FAILED(io_result)) {
+        received = -1;
+    } else {
+        GG_DynamicBuffer_SetDataSize(buffers[0], (size_t)io_result);
+        received = 1;
+    }
+#endif
+
+    // return the unused buffers to the pool
+    GG_Result result = GG_BSD_SOCKET_CALL_FAILED(received) ? MapErrorCode(GetLastSocketError()) : GG_SUCCESS;
+    for (unsigned int i = GG_BSD_SOCKET_CALL_FAILED(received) ? 0 : (unsigned int)received; i < buffer_count; i++) {
+        GG_DynamicBuffer_Release(buffers[i]);
+    }
+
+    return GG_FAILED(result) ? result : received;
+}
+
+//----------------------------------------------------------------------
+// Deliver the received datagrams that the sink hasn't accepted yet.
+// If the sink pushes back, the remaining datagrams are kept, reading is paused,
+// and GG_ERROR_WOULD_BLOCK is returned. Delivery resumes when the sink calls
+// our OnCanPut listener method.
+//----------------------------------------------------------------------
+static GG_Result
+GG_BsdDatagramSocket_DeliverReceivedDatagrams(GG_BsdDatagramSocket* self)
+{
+    GG_Result result = GG_SUCCESS;
+
+    self->delivering = true;
+    while (self->receive_queue_delivered < self->receive_queue_length) {
+        GG_DynamicBuffer* buffer         = self->receive_queue[self->receive_queue_delivered];
+        GG_sockaddr*      sender_address = &self->receive_addresses[self->receive_queue_delivered];
+
+        // setup the metadata
+        GG_SocketAddressMetadata metadata = GG_SOURCE_SOCKET_ADDRESS_METADATA_INITIALIZER(
+            GG_IP_ADDRESS_NULL_INITIALIZER, (uint16_t)sender_address->sa_in.sin_port);
+        InetAddressToSocketAddress(sender_address, &metadata.socket_address);
+
+        // if in auto-bind mode, save remote address to be used to send back data
+        if (self->auto_bind) {
+            InetAddressToSocketAddress(sender_address, &self->remote_address);
+#if defined(GG_CONFIG_ENABLE_LOGGING)
+            char address_str[20];
+            GG_SocketAddress_AsString(&self->remote_address, address_str, sizeof(address_str));
+            GG_LOG_FINER("auto-binding to %s", address_str);
+#endif
+        }
+
+        // push the data to the sink (other errors than GG_ERROR_WOULD_BLOCK drop the datagram)
+        if (self->data_sink) {
+            result = GG_DataSink_PutData(self->data_sink, GG_DynamicBuffer_AsBuffer(buffer), &metadata.base);
+            if (result == GG_ERROR_WOULD_BLOCK) {
+                // keep the datagram and don't read any more until the sink can accept it
+                GG_LOG_FINER("sink would block, pausing");
+                self->handler.event_mask &= ~GG_EVENT_FLAG_FD_CAN_READ;
+                break;
+            }
+        }
+
+        // we don't need this buffer anymore
+        GG_DynamicBuffer_Release(buffer);
+        ++self->receive_queue_delivered;
+    }
+    self->delivering = false;
+
+    return result == GG_ERROR_WOULD_BLOCK ? result : GG_SUCCESS;
+}
+
 //----------------------------------------------------------------------
 static void
 GG_BsdDatagramSocket_OnEvent(GG_LoopEventHandler* _self, GG_Loop* loop)
@@ -482,55 +874,35 @@ GG_BsdDatagramSocket_OnEvent(GG_LoopEventHandler* _self, GG_Loop* loop)
     GG_ASSERT(self->fd == self->handler.fd);
     GG_LOG_FINER("got event for FD %d, flags=%d", self->fd, self->handler.event_flags);
 
-    // check if we can read
-    if (self->handler.event_flags & GG_EVENT_FLAG_FD_CAN_READ) {
+    // check if we can read (but first deliver what's left of the previous batch, if anything)
+    if ((self->handler.event_flags & GG_EVENT_FLAG_FD_CAN_READ) &&
+        GG_BsdDatagramSocket_DeliverReceivedDatagrams(self) == GG_SUCCESS) {
         GG_ASSERT(self->data_sink);
 
-        // allocate a buffer to read into
-        // TEMP: use a dynamic buffer fow now, but we should get a buffer from a pool
-        GG_DynamicBuffer* buffer = NULL;
-        GG_Result result = GG_DynamicBuffer_Create(self->max_datagram_size, &buffer);
-        if (GG_SUCCEEDED(result)) {
-            // read a datagram
-            GG_sockaddr  sender_address;
-            GG_socklen_t sender_address_length = sizeof(sender_address);
-            GG_ssize_t io_result;
-            do {
-                io_result = recvfrom(self->fd,
-                                     (void*)GG_DynamicBuffer_UseData(buffer),
-                                     (size_t)self->max_datagram_size,
-                                     0,
-                                     &sender_address.sa,
-                                     &sender_address_length);
-                GG_LOG_FINER("recvfrom returned %d", (int)io_result);
-            } while (GG_BSD_SOCKET_CALL_FAILED(io_result) && GetLastSocketError() == EINTR);
-            if (io_result >= 0) {
-                // we now know how much data was received
-                GG_DynamicBuffer_SetDataSize(buffer, (size_t)io_result);
-
-                // setup the metadata
-                GG_SocketAddressMetadata metadata = GG_SOURCE_SOCKET_ADDRESS_METADATA_INITIALIZER(
-                    GG_IP_ADDRESS_NULL_INITIALIZER, (uint16_t)sender_address.sa_in.sin_port);
-                InetAddressToSocketAddress(&sender_address, &metadata.socket_address);
-
-                // if in auto-bind mode, save remote address to be used to send back data
-                if (self->auto_bind) {
-                    InetAddressToSocketAddress(&sender_address, &self->remote_address);
-#if defined(GG_CONFIG_ENABLE_LOGGING)
-                    char address_str[20];
-                    GG_SocketAddress_AsString(&self->remote_address, address_str, sizeof(address_str));
-                    GG_LOG_FINER("auto-binding to %s", address_str);
+        // read a batch of datagrams
+        int received = GG_BsdDatagramSocket_Receive(self, self->receive_queue, self->receive_addresses);
+        if (received >= 0) {
+            // deliver the datagrams one by one
+            self->receive_queue_length    = (unsigned int)received;
+            self->receive_queue_delivered = 0;
+            GG_BsdDatagramSocket_DeliverReceivedDatagrams(self);
+
+#if defined(GG_BSD_SOCKETS_HAVE_MMSG)
+            // a partial batch means that there's nothing left to read for now
+            if ((unsigned int)received < self->receive_batch_size) {
+                self->handler.event_flags &= ~GG_EVENT_FLAG_FD_CAN_READ;
+            }
 #endif
-                }
-
-                // push the data to the sink (ignore errors for now)
-                GG_DataSink_PutData(self->data_sink, GG_DynamicBuffer_AsBuffer(buffer), &metadata.base);
 
-                // we don't need this buffer anymore
-                GG_DynamicBuffer_Release(buffer);
+            // send what was queued in response
+            if (self->send_queue_length && !(self->handler.event_mask & GG_EVENT_FLAG_FD_CAN_WRITE)) {
+                GG_BsdDatagramSocket_OnSendResult(self, GG_BsdDatagramSocket_FlushSendQueue(self));
             }
-        } else {
-            GG_LOG_SEVERE("failed to allocate read buffer (%d)", result);
+        } else if (received == GG_ERROR_WOULD_BLOCK) {
+            // nothing left to read, let the loop know
+            self->handler.event_flags &= ~GG_EVENT_FLAG_FD_CAN_READ;
+        } else if (received == GG_ERROR_OUT_OF_MEMORY) {
+            GG_LOG_SEVERE("failed to allocate read buffer");
 
             // don't read anymore to avoid looping forever
             self->handler.event_mask &= ~GG_EVENT_FLAG_FD_CAN_READ;
@@ -539,13 +911,19 @@ GG_BsdDatagramSocket_OnEvent(GG_LoopEventHandler* _self, GG_Loop* loop)
 
     // check if we can write
     if (self->handler.event_flags & GG_EVENT_FLAG_FD_CAN_WRITE) {
-        // notify our listener that they can try to put again
-        if (self->sink_listener) {
-            GG_DataSinkListener_OnCanPut(self->sink_listener);
+        // send what's been queued
+        GG_Result result = GG_BsdDatagramSocket_FlushSendQueue(self);
+        if (result != GG_ERROR_WOULD_BLOCK) {
+            // we don't need to monitor CAN_WRITE anymore
+            self->handler.event_mask &= ~GG_EVENT_FLAG_FD_CAN_WRITE;
+            GG_BsdDatagramSocket_OnSendResult(self, result);
+
+            // notify our listener that they can try to put again
+            // (unless we need to wait for the resend timer)
+            if (GG_SUCCEEDED(result) && self->sink_listener) {
+                GG_DataSinkListener_OnCanPut(self->sink_listener);
+            }
         }
-
-        // we don't need to monitor CAN_WRITE anymore
-        self->handler.event_mask &= ~GG_EVENT_FLAG_FD_CAN_WRITE;
     }
 }
 
@@ -563,12 +941,48 @@ GG_BsdDatagramSocket_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint
     // adjust the timer based on a capped exponential back-off
     self->resend_sleep_time = GG_MIN(2 * self->resend_sleep_time, GG_BSD_DATAGRAM_SOCKET_MAX_RESEND_SLEEP_TIME);
 
+    // send what's been queued
+    if (self->send_queue_length) {
+        GG_Result result = GG_BsdDatagramSocket_FlushSendQueue(self);
+        if (result == GG_ERROR_OUT_OF_RESOURCES) {
+            GG_BsdDatagramSocket_OnSendResult(self, result);
+            return;
+        }
+    }
+
     // notify our listener that they can try to put again
     if (self->sink_listener) {
         GG_DataSinkListener_OnCanPut(self->sink_listener);
     }
 }
 
+//----------------------------------------------------------------------
+// Called when the sink to which we deliver received datagrams can accept
+// data again after having pushed back.
+//----------------------------------------------------------------------
+static void
+GG_BsdDatagramSocket_OnCanPut(GG_DataSinkListener* _self)
+{
+    GG_BsdDatagramSocket* self = GG_SELF(GG_BsdDatagramSocket, GG_DataSinkListener);
+    GG_THREAD_GUARD_CHECK_BINDING(self);
+
+    // nothing to do if we're not holding any datagram (or are already delivering them)
+    if (self->delivering || self->receive_queue_delivered == self->receive_queue_length) {
+        return;
+    }
+
+    // deliver what we held, and resume reading if the sink took everything
+    if (GG_BsdDatagramSocket_DeliverReceivedDatagrams(self) == GG_SUCCESS && self->data_sink) {
+        GG_LOG_FINER("sink can accept data again, resuming");
+        self->handler.event_mask |= GG_EVENT_FLAG_FD_CAN_READ;
+    }
+
+    // send what was queued in response
+    if (self->send_queue_length && !(self->handler.event_mask & GG_EVENT_FLAG_FD_CAN_WRITE)) {
+        GG_BsdDatagramSocket_OnSendResult(self, GG_BsdDatagramSocket_FlushSendQueue(self));
+    }
+}
+
 /*----------------------------------------------------------------------
 |   function table
 +---------------------------------------------------------------------*/
@@ -596,6 +1010,10 @@ GG_IMPLEMENT_INTERFACE(GG_BsdDatagramSocket, GG_TimerListener) {
     GG_BsdDatagramSocket_OnTimerFired
 };
 
+GG_IMPLEMENT_INTERFACE(GG_BsdDatagramSocket, GG_DataSinkListener) {
+    GG_BsdDatagramSocket_OnCanPut
+};
+
 //----------------------------------------------------------------------
 GG_Result
 GG_BsdDatagramSocket_Create(const GG_SocketAddress* local_address,
@@ -668,6 +1086,18 @@ GG_BsdDatagramSocket_Create(const GG_SocketAddress* local_address,
     // init the instance
     self->fd                = fd;
     self->max_datagram_size = max_datagram_size;
+
+    // read as many datagrams at a time as the receive buffer pool size allows
+#if defined(GG_BSD_SOCKETS_HAVE_MMSG)
+    self->receive_batch_size = GG_CONFIG_BSD_SOCKETS_BATCH_SIZE;
+    if (max_datagram_size) {
+        self->receive_batch_size = GG_MIN(self->receive_batch_size,
+                                          GG_CONFIG_BSD_SOCKETS_RECEIVE_POOL_MAX_SIZE / max_datagram_size);
+        self->receive_batch_size = GG_MAX(self->receive_batch_size, 1);
+    }
+#else
+    self->receive_batch_size = 1;
+#endif
     if (local_address) {
         self->local_address = *local_address;
     }
@@ -689,6 +1119,7 @@ GG_BsdDatagramSocket_Create(const GG_SocketAddress* local_address,
     GG_SET_INTERFACE(self, GG_BsdDatagramSocket, GG_DataSink);
     GG_SET_INTERFACE(self, GG_BsdDatagramSocket, GG_DataSource);
     GG_SET_INTERFACE(self, GG_BsdDatagramSocket, GG_TimerListener);
+    GG_SET_INTERFACE(self, GG_BsdDatagramSocket, GG_DataSinkListener);
 
     // bind to the current thread
     GG_THREAD_GUARD_BIND(self);
@@ -107,6 +107,24 @@ GG_NipDatagramSocket_Create(const GG_SocketAddress* local_address,
                             unsigned int            max_datagram_size,
                             GG_DatagramSocket**     socket_object)
 {
+    return GG_NipDatagramSocket_CreateWithStack(GG_Nip_GetDefaultStack(),
+                                                local_address,
+                                                remote_address,
+                                                connect_to_remote,
+                                                max_datagram_size,
+                                                socket_object);
+}
+
+//----------------------------------------------------------------------
+GG_Result
+GG_NipDatagramSocket_CreateWithStack(GG_NipStack*            stack,
+                                     const GG_SocketAddress* local_address,
+                                     const GG_SocketAddress* remote_address,
+                                     bool                    connect_to_remote,
+                                     unsigned int            max_datagram_size,
+                                     GG_DatagramSocket**     socket_object)
+{
+    GG_ASSERT(stack);
     GG_COMPILER_UNUSED(max_datagram_size);
 
     // default return value
@@ -123,7 +141,7 @@ GG_NipDatagramSocket_Create(const GG_SocketAddress* local_address,
                            local_address,
                            remote_address,
                            connect_to_remote);
-    GG_Result result = GG_Nip_AddUdpEndpoint(&self->udp_endpoint);
+    GG_Result result = GG_NipStack_AddUdpEndpoint(stack, &self->udp_endpoint);
     if (GG_FAILED(result)) {
         GG_FreeMemory(self);
         return result;
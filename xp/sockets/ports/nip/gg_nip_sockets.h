@@ -25,6 +25,7 @@
 #include "xp/common/gg_types.h"
 #include "xp/common/gg_results.h"
 #include "xp/sockets/gg_sockets.h"
+#include "xp/nip/gg_nip.h"
 
 /*----------------------------------------------------------------------
 |   functions
@@ -44,6 +45,20 @@ GG_Result GG_NipDatagramSocket_Create(const GG_SocketAddress* local_address,
                                       unsigned int            max_datagram_size,
                                       GG_DatagramSocket**     socket);
 
+/**
+ * Create a UDP socket for a specific NIP IP stack instance.
+ *
+ * @param stack The stack to which the socket will be added.
+ *
+ * @see GG_DatagramSocket_Create
+ */
+GG_Result GG_NipDatagramSocket_CreateWithStack(GG_NipStack*            stack,
+                                               const GG_SocketAddress* local_address,
+                                               const GG_SocketAddress* remote_address,
+                                               bool                    connect_to_remote,
+                                               unsigned int            max_datagram_size,
+                                               GG_DatagramSocket**     socket);
+
 #if defined(__cplusplus)
 }
 #endif
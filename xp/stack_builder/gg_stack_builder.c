@@ -311,6 +311,10 @@ GG_StackGattlinkElement_Create(const GG_StackElementGattlinkParameters* paramete
         goto end;
     }
 
+    // reassembled packets are handed straight to the IP stack, which doesn't hold on to them,
+    // so they can be views of the reassembly buffer rather than copies
+    GG_Ipv4FrameAssembler_EnableInPlaceReassembly(self->frame_assembler, true);
+
     // create a gattlink client
     size_t gattlink_buffer_size;
     if (parameters && parameters->buffer_size) {
@@ -325,7 +329,7 @@ GG_StackGattlinkElement_Create(const GG_StackElementGattlinkParameters* paramete
             // the window size, without waiting, even if it has nothing to send. Up to 1/2 of the window,
             // it will wait up to some configured timeout (200ms by default) before sending an ACK.
             self->max_transport_fragment_size_limit = stack->ip_configuration.ip_mtu /
-                                                      ( 1 + GG_GENERIC_GATTLINK_CLIENT_DEFAULT_MAX_TX_WINDOW_SIZE / 2);
+                                                      ( 1 + GG_GENERIC_GATTLINK_CLIENT_INITIAL_TX_WINDOW_SIZE / 2);
         }
     }
     GG_LOG_FINE("creating gattlink client - buffer_size=%d, tx_window=%d, rx_window=%d, initial_max_fragment_size=%d",
@@ -357,6 +361,9 @@ GG_StackGattlinkElement_Create(const GG_StackElementGattlinkParameters* paramete
     if (GG_FAILED(result)) {
         goto end;
     }
+    if (parameters && parameters->transport_batching) {
+        GG_GattlinkGenericClient_EnableTransportBatching(self->client, true);
+    }
 
     // register the stack as a listener for the gattlink object
     GG_EventEmitter_SetListener(GG_GattlinkGenericClient_AsEventEmitter(self->client),
@@ -446,12 +453,21 @@ GG_StackDatagramSocketElement_Create(const GG_StackElementDatagramSocketParamete
                 (int)local_address.port,
                 (int)remote_address.port);
 
-    // instantiate the socket
-    GG_Result result = GG_DatagramSocket_Create(&local_address,
-                                                &remote_address,
-                                                false,
-                                                (uint16_t)stack->max_datagram_size,
-                                                &self->socket);
+    // instantiate the socket (on the stack's own network interface, if there's one)
+    GG_Result result;
+    if (stack->netif_element) {
+        result = GG_StackNetworkInterfaceElement_CreateDatagramSocket(stack->netif_element,
+                                                                      &local_address,
+                                                                      &remote_address,
+                                                                      (uint16_t)stack->max_datagram_size,
+                                                                      &self->socket);
+    } else {
+        result = GG_DatagramSocket_Create(&local_address,
+                                          &remote_address,
+                                          false,
+                                          (uint16_t)stack->max_datagram_size,
+                                          &self->socket);
+    }
     if (GG_FAILED(result)) {
         goto end;
     }
@@ -605,8 +621,8 @@ GG_Stack_Destroy(GG_Stack* self)
     // destroy all the elements
     GG_StackActivityMonitorElement_Destroy(self->activity_monitor_element);
     GG_StackGattlinkElement_Destroy(self->gattlink_element);
-    GG_StackNetworkInterfaceElement_Destroy(self->netif_element);
     GG_StackDatagramSocketElement_Destroy(self->datagram_socket_element);
+    GG_StackNetworkInterfaceElement_Destroy(self->netif_element);
     GG_StackDtlsElement_Destroy(self->dtls_element);
 
     // free memory resources
@@ -1053,6 +1069,19 @@ GG_StackBuilder_BuildStack(const char*                      descriptor,
     }
     self->element_count = element_count;
 
+    // create the network interface element first, if there's one, because the
+    // datagram socket element above it needs it to create its socket
+    if (memchr(descriptor, 'N', element_count)) {
+        GG_LOG_FINE("creating Network Interface element");
+        result = GG_StackNetworkInterfaceElement_Create(self,
+                                                        self->ip_configuration.ip_mtu,
+                                                        memchr(descriptor, 'S', element_count) != NULL,
+                                                        &self->netif_element);
+        if (GG_FAILED(result)) {
+            goto end;
+        }
+    }
+
     // build one element at a time, starting from the top
     for (size_t i = 0; i < element_count; i++) {
         GG_StackElement* element = NULL;
@@ -1099,15 +1128,10 @@ GG_StackBuilder_BuildStack(const char*                      descriptor,
                 element = &self->gattlink_element->base;
                 break;
 
-            case 'N': // Network Interface
-                GG_LOG_FINE("creating Network Interface element");
-
-                // create the element
-                result = GG_StackNetworkInterfaceElement_Create(
-                    self,
-                    self->ip_configuration.ip_mtu,
-                    &self->netif_element);
-                if (GG_FAILED(result)) {
+            case 'N': // Network Interface (already created above)
+                if (memchr(descriptor, 'N', i)) {
+                    GG_LOG_SEVERE("Multiple network interface elements not supported");
+                    result = GG_ERROR_NOT_SUPPORTED;
                     goto end;
                 }
 
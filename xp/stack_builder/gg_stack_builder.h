@@ -137,6 +137,8 @@ typedef struct {
     size_t   buffer_size;                       ///< Size of the buffer            (use 0 for default)
     uint16_t initial_max_fragment_size;         ///< Initial maximum fragment size (use 0 for default)
     const GG_GattlinkProbeConfig* probe_config; ///< Configuration for data probe  (use NULL to disable)
+    bool     transport_batching;                ///< Send packets to the transport in batches (the transport
+                                                ///< sink must handle GG_GattlinkFragmentsMetadata)
 } GG_StackElementGattlinkParameters;
 
 /**
@@ -157,11 +157,18 @@ struct GG_Stack {
 // declarations for functions that are implemented in specific port elements
 GG_Result GG_StackNetworkInterfaceElement_Create(GG_Stack*                         stack,
                                                  size_t                            netif_mtu,
+                                                 bool                              with_socket_element,
                                                  GG_StackNetworkInterfaceElement** element);
 void GG_StackNetworkInterfaceElement_Inspect(GG_StackNetworkInterfaceElement* self, GG_Inspector* inspector);
 
 void GG_StackNetworkInterfaceElement_Destroy(GG_StackNetworkInterfaceElement* self);
 
+GG_Result GG_StackNetworkInterfaceElement_CreateDatagramSocket(GG_StackNetworkInterfaceElement* self,
+                                                               const GG_SocketAddress*          local_address,
+                                                               const GG_SocketAddress*          remote_address,
+                                                               unsigned int                     max_datagram_size,
+                                                               GG_DatagramSocket**              socket);
+
 //! @}
 
 #ifdef __cplusplus
@@ -54,8 +54,11 @@ GG_StackNetworkInterfaceElement_Destroy(GG_StackNetworkInterfaceElement* self)
 GG_Result
 GG_StackNetworkInterfaceElement_Create(GG_Stack*                         stack,
                                        size_t                            netif_mtu,
+                                       bool                              with_socket_element,
                                        GG_StackNetworkInterfaceElement** element)
 {
+    GG_COMPILER_UNUSED(with_socket_element);
+
     // allocate the element
     GG_StackNetworkInterfaceElement* self = GG_AllocateZeroMemory(sizeof(GG_StackNetworkInterfaceElement));
     *element = self;
@@ -93,6 +96,20 @@ end:
     return result;
 }
 
+//----------------------------------------------------------------------
+GG_Result
+GG_StackNetworkInterfaceElement_CreateDatagramSocket(GG_StackNetworkInterfaceElement* self,
+                                                     const GG_SocketAddress*          local_address,
+                                                     const GG_SocketAddress*          remote_address,
+                                                     unsigned int                     max_datagram_size,
+                                                     GG_DatagramSocket**              socket)
+{
+    GG_COMPILER_UNUSED(self);
+
+    // sockets for this port aren't tied to a specific network interface
+    return GG_DatagramSocket_Create(local_address, remote_address, false, max_datagram_size, socket);
+}
+
 #if defined(GG_CONFIG_ENABLE_INSPECTION)
 //----------------------------------------------------------------------
 void
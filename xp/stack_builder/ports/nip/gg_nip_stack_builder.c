@@ -24,6 +24,7 @@
 #include "xp/stack_builder/gg_stack_builder.h"
 #include "xp/stack_builder/gg_stack_builder_base.h"
 #include "xp/nip/gg_nip.h"
+#include "xp/sockets/ports/nip/gg_nip_sockets.h"
 
 /*----------------------------------------------------------------------
 |   types
@@ -33,19 +34,28 @@
  */
 struct GG_StackNetworkInterfaceElement {
     GG_StackElement base;
+    GG_NipStack*    nip_stack;     ///< IP stack instance used by this element
+    bool            own_nip_stack; ///< true if nip_stack was created by (and is owned by) this element
 };
 
 //----------------------------------------------------------------------
 void
 GG_StackNetworkInterfaceElement_Destroy(GG_StackNetworkInterfaceElement* self)
 {
-    GG_COMPILER_UNUSED(self);
+    if (self == NULL) return;
+
+    if (self->own_nip_stack) {
+        GG_NipStack_Destroy(self->nip_stack);
+    }
+
+    GG_ClearAndFreeObject(self, 0);
 }
 
 //----------------------------------------------------------------------
 GG_Result
 GG_StackNetworkInterfaceElement_Create(GG_Stack*                         stack,
                                        size_t                            netif_mtu,
+                                       bool                              with_socket_element,
                                        GG_StackNetworkInterfaceElement** element)
 {
     // allocate the element
@@ -59,16 +69,45 @@ GG_StackNetworkInterfaceElement_Create(GG_Stack*                         stack,
     self->base.stack = stack;
     self->base.type  = GG_STACK_ELEMENT_TYPE_IP_NETWORK_INTERFACE;
 
-    // configure NIP
-    GG_Nip_Configure(&stack->ip_configuration.local_address);
+    // when the stack has its own socket element, give it a private NIP stack instance,
+    // otherwise use the default instance, on which the application creates its sockets
+    GG_Result result;
+    if (with_socket_element) {
+        result = GG_NipStack_Create(&stack->ip_configuration.local_address, &self->nip_stack);
+        self->own_nip_stack = GG_SUCCEEDED(result);
+    } else {
+        result = GG_Nip_Configure(&stack->ip_configuration.local_address);
+        self->nip_stack = GG_Nip_GetDefaultStack();
+    }
+    if (GG_FAILED(result)) {
+        GG_StackNetworkInterfaceElement_Destroy(self);
+        *element = NULL;
+        return result;
+    }
 
     // setup the ports
-    self->base.bottom_port.source = GG_Nip_AsDataSource();
-    self->base.bottom_port.sink   = GG_Nip_AsDataSink();
+    self->base.bottom_port.source = GG_NipStack_AsDataSource(self->nip_stack);
+    self->base.bottom_port.sink   = GG_NipStack_AsDataSink(self->nip_stack);
 
     return GG_SUCCESS;
 }
 
+//----------------------------------------------------------------------
+GG_Result
+GG_StackNetworkInterfaceElement_CreateDatagramSocket(GG_StackNetworkInterfaceElement* self,
+                                                     const GG_SocketAddress*          local_address,
+                                                     const GG_SocketAddress*          remote_address,
+                                                     unsigned int                     max_datagram_size,
+                                                     GG_DatagramSocket**              socket)
+{
+    return GG_NipDatagramSocket_CreateWithStack(self->nip_stack,
+                                                local_address,
+                                                remote_address,
+                                                false,
+                                                max_datagram_size,
+                                                socket);
+}
+
 #if defined(GG_CONFIG_ENABLE_INSPECTION)
 //----------------------------------------------------------------------
 void
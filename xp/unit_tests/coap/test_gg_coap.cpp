@@ -19,6 +19,7 @@
 #include "xp/coap/gg_coap_endpoint.h"
 #include "xp/coap/gg_coap_message.h"
 #include "xp/coap/gg_coap_filters.h"
+#include "xp/utils/gg_async_pipe.h"
 #include "xp/utils/gg_memory_data_sink.h"
 
 /*----------------------------------------------------------------------
@@ -366,6 +367,66 @@ TEST(GG_COAP, Test_RequestToken) {
     MemSink_Reset(&mem_sink);
 }
 
+TEST(GG_COAP, Test_ManyPendingRequests) {
+    GG_TimerScheduler_SetTime(timer_scheduler, 0);
+    MemSink_Reset(&mem_sink);
+
+    // send many requests, keeping a copy of each one
+    TestClient      clients[40];
+    GG_CoapMessage* requests[40];
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(clients); i++) {
+        TestClient_Init(&clients[i]);
+        GG_Result result = GG_CoapEndpoint_SendRequest(test_endpoint,
+                                                       GG_COAP_METHOD_GET,
+                                                       NULL,
+                                                       0,
+                                                       NULL,
+                                                       0,
+                                                       NULL,
+                                                       GG_CAST(&clients[i], GG_CoapResponseListener),
+                                                       &clients[i].request_handle);
+        CHECK_EQUAL(GG_SUCCESS, result);
+        result = GG_CoapMessage_CreateFromDatagram(mem_sink.last_received_buffer, &requests[i]);
+        CHECK_EQUAL(GG_SUCCESS, result);
+    }
+
+    // respond in reverse order, with the index of the request as the payload
+    for (unsigned int i = GG_ARRAY_SIZE(clients); i--;) {
+        uint8_t payload = (uint8_t)i;
+        GG_CoapMessage* response = NULL;
+        GG_Result result = GG_CoapEndpoint_CreateResponse(test_endpoint,
+                                                          requests[i],
+                                                          GG_COAP_MESSAGE_CODE_CONTENT,
+                                                          NULL,
+                                                          0,
+                                                          &payload,
+                                                          1,
+                                                          &response);
+        CHECK_EQUAL(GG_SUCCESS, result);
+        GG_Buffer* response_datagram = NULL;
+        result = GG_CoapMessage_ToDatagram(response, &response_datagram);
+        CHECK_EQUAL(GG_SUCCESS, result);
+        GG_CoapMessage_Destroy(response);
+        result = GG_DataSink_PutData(null_source.sink, response_datagram, NULL);
+        CHECK_EQUAL(GG_SUCCESS, result);
+        GG_Buffer_Release(response_datagram);
+    }
+
+    // check that each client got its own response, and that no request is left
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(clients); i++) {
+        CHECK_TRUE(clients[i].response != NULL);
+        LONGS_EQUAL(1, GG_CoapMessage_GetPayloadSize(clients[i].response));
+        LONGS_EQUAL(i, GG_CoapMessage_GetPayload(clients[i].response)[0]);
+        GG_Result result = GG_CoapEndpoint_CancelRequest(test_endpoint, clients[i].request_handle);
+        CHECK_EQUAL(GG_ERROR_NO_SUCH_ITEM, result);
+        TestClient_Cleanup(&clients[i]);
+        GG_CoapMessage_Destroy(requests[i]);
+    }
+
+    MemSink_Reset(&mem_sink);
+    GG_TimerScheduler_SetTime(timer_scheduler, 100);
+}
+
 static uint32_t
 CalculateRetryAbsoluteTime(uint32_t retry_count) {
     GG_ASSERT(retry_count >= 1);
@@ -896,6 +957,184 @@ TEST(GG_COAP, Test_Handlers) {
     GG_CoapEndpoint_Destroy(endpoint2);
 }
 
+//----------------------------------------------------------------------
+// Send a GET request with up to 3 URI path components, and return the response code
+//----------------------------------------------------------------------
+static uint8_t
+GetResponseCodeForPath(GG_CoapEndpoint* endpoint, const char* p1, const char* p2, const char* p3)
+{
+    GG_CoapMessageOptionParam options[3] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, p1),
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, p2),
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, p3)
+    };
+    size_t option_count = p3 ? 3 : (p2 ? 2 : 1);
+
+    TestClient client;
+    TestClient_Init(&client);
+    GG_Result result = GG_CoapEndpoint_SendRequest(endpoint,
+                                                   GG_COAP_METHOD_GET,
+                                                   options, option_count,
+                                                   NULL, 0,
+                                                   NULL,
+                                                   GG_CAST(&client, GG_CoapResponseListener),
+                                                   &client.request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    CHECK_TRUE(client.response != NULL);
+    uint8_t code = GG_CoapMessage_GetCode(client.response);
+    TestClient_Cleanup(&client);
+
+    return code;
+}
+
+TEST(GG_COAP, Test_HandlerPathMatching) {
+    // create two endpoints and connect them together
+    GG_TimerScheduler* timer_scheduler1 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler1);
+    GG_CoapEndpoint* endpoint1;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint1);
+    GG_CoapEndpoint* endpoint2;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint2);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1),
+                              GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2),
+                              GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // register handlers that each respond with a different code
+    struct {
+        const char* path;
+        uint8_t     code;
+        TestHandler handler;
+    } handlers[] = {
+        { "foo/bar",   GG_COAP_MESSAGE_CODE_DELETED, TestHandler() },
+        { "foo/baz/1", GG_COAP_MESSAGE_CODE_VALID,   TestHandler() },
+        { "/foo",      GG_COAP_MESSAGE_CODE_CREATED, TestHandler() },
+        { "x/y",       GG_COAP_MESSAGE_CODE_CHANGED, TestHandler() },
+        { "foo/baz/1", GG_COAP_MESSAGE_CODE_CONTENT, TestHandler() }  // shadowed by the earlier one
+    };
+    for (size_t i = 0; i < GG_ARRAY_SIZE(handlers); i++) {
+        memset(&handlers[i].handler, 0, sizeof(handlers[i].handler));
+        GG_SET_INTERFACE(&handlers[i].handler, TestHandler, GG_CoapRequestHandler);
+        handlers[i].handler.result_to_return = handlers[i].code;
+        GG_Result result = GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                                                  handlers[i].path,
+                                                                  GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                                                  GG_CAST(&handlers[i].handler,
+                                                                          GG_CoapRequestHandler));
+        LONGS_EQUAL(GG_SUCCESS, result);
+    }
+
+    // exact and prefix matches, with the earliest registered handler winning
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_DELETED,   GetResponseCodeForPath(endpoint1, "foo", "bar", NULL));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_DELETED,   GetResponseCodeForPath(endpoint1, "foo", "bar", "zz"));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_VALID,     GetResponseCodeForPath(endpoint1, "foo", "baz", "1"));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CREATED,   GetResponseCodeForPath(endpoint1, "foo", "baz", "2"));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CREATED,   GetResponseCodeForPath(endpoint1, "foo", "baz", NULL));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CREATED,   GetResponseCodeForPath(endpoint1, "foo", NULL, NULL));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CREATED,   GetResponseCodeForPath(endpoint1, "foo", "ba", NULL));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_NOT_FOUND, GetResponseCodeForPath(endpoint1, "fo", NULL, NULL));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_NOT_FOUND, GetResponseCodeForPath(endpoint1, "x", NULL, NULL));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CHANGED,   GetResponseCodeForPath(endpoint1, "x", "y", NULL));
+
+    // a single uri path component containing a '/' char
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CHANGED,   GetResponseCodeForPath(endpoint1, "x/y", NULL, NULL));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_NOT_FOUND, GetResponseCodeForPath(endpoint1, "x/", NULL, NULL));
+
+    // unregistering updates the lookup
+    GG_Result result = GG_CoapEndpoint_UnregisterRequestHandler(endpoint2, "foo/bar", NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CREATED, GetResponseCodeForPath(endpoint1, "foo", "bar", NULL));
+    result = GG_CoapEndpoint_UnregisterRequestHandler(endpoint2, "foo/baz/1", NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_CoapEndpoint_UnregisterRequestHandler(endpoint2, "foo", NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CONTENT,   GetResponseCodeForPath(endpoint1, "foo", "baz", "1"));
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_NOT_FOUND, GetResponseCodeForPath(endpoint1, "foo", "bar", NULL));
+
+    // cleanup
+    GG_TimerScheduler_Destroy(timer_scheduler1);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+}
+
+TEST(GG_COAP, Test_DuplicateRequests) {
+    GG_TimerScheduler_SetTime(timer_scheduler, 0);
+    MemSink_Reset(&mem_sink);
+
+    // register a handler
+    TestHandler handler;
+    memset(&handler, 0, sizeof(handler));
+    GG_SET_INTERFACE(&handler, TestHandler, GG_CoapRequestHandler);
+    handler.code_to_respond_with = GG_COAP_MESSAGE_CODE_CONTENT;
+    GG_Result result = GG_CoapEndpoint_RegisterRequestHandler(test_endpoint,
+                                                              "foo",
+                                                              GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                                              GG_CAST(&handler, GG_CoapRequestHandler));
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a CON request
+    GG_CoapMessageOptionParam options[] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "foo")
+    };
+    uint8_t token[2] = { 1, 2 };
+    GG_CoapMessage* request = NULL;
+    result = GG_CoapMessage_Create(GG_COAP_METHOD_GET, GG_COAP_MESSAGE_TYPE_CON,
+                                   options, GG_ARRAY_SIZE(options),
+                                   1234,
+                                   token, sizeof(token),
+                                   NULL, 0,
+                                   &request);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* request_datagram = NULL;
+    result = GG_CoapMessage_ToDatagram(request, &request_datagram);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapMessage_Destroy(request);
+
+    // send it twice, the handler should only be called once, but both should get a response
+    result = GG_DataSink_PutData(null_source.sink, request_datagram, NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, handler.call_count);
+    LONGS_EQUAL(1, mem_sink.receive_count);
+    GG_Buffer* first_response = GG_Buffer_Retain(mem_sink.last_received_buffer);
+    result = GG_DataSink_PutData(null_source.sink, request_datagram, NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, handler.call_count);
+    LONGS_EQUAL(2, mem_sink.receive_count);
+    LONGS_EQUAL(GG_Buffer_GetDataSize(first_response), GG_Buffer_GetDataSize(mem_sink.last_received_buffer));
+    MEMCMP_EQUAL(GG_Buffer_GetData(first_response),
+                 GG_Buffer_GetData(mem_sink.last_received_buffer),
+                 GG_Buffer_GetDataSize(first_response));
+    GG_Buffer_Release(first_response);
+
+    // the same message ID from a different peer isn't a duplicate
+    GG_SocketAddressMetadata metadata;
+    memset(&metadata, 0, sizeof(metadata));
+    metadata.base.type = GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS;
+    metadata.base.size = sizeof(metadata);
+    GG_IpAddress_SetFromString(&metadata.socket_address.address, "10.0.0.1");
+    metadata.socket_address.port = 5683;
+    result = GG_DataSink_PutData(null_source.sink, request_datagram, &metadata.base);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(2, handler.call_count);
+    result = GG_DataSink_PutData(null_source.sink, request_datagram, &metadata.base);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(2, handler.call_count);
+    LONGS_EQUAL(4, mem_sink.receive_count);
+
+    // once the exchange lifetime has elapsed, the request is handled again
+    GG_TimerScheduler_SetTime(timer_scheduler, 300000);
+    result = GG_DataSink_PutData(null_source.sink, request_datagram, NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(3, handler.call_count);
+
+    // cleanup
+    GG_Buffer_Release(request_datagram);
+    GG_CoapEndpoint_UnregisterRequestHandler(test_endpoint, NULL, GG_CAST(&handler, GG_CoapRequestHandler));
+    MemSink_Reset(&mem_sink);
+}
+
 TEST(GG_COAP, Test_Handlers2) {
     // create two endpoints and connect them together
     GG_TimerScheduler* timer_scheduler1 = NULL;
@@ -2168,3 +2407,358 @@ TEST(GG_COAP, Test_ResponseQueue)
     GG_CoapEndpoint_Destroy(endpoint1);
     GG_CoapEndpoint_Destroy(endpoint2);
 }
+
+TEST(GG_COAP, Test_ObjectPools)
+{
+    // create two endpoints, connected with async pipes
+    GG_CoapEndpoint* endpoint1;
+    GG_Result result = GG_CoapEndpoint_Create(timer_scheduler, NULL, NULL, &endpoint1);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapEndpoint* endpoint2;
+    result = GG_CoapEndpoint_Create(timer_scheduler, NULL, NULL, &endpoint2);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe1 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler, 1, &pipe1);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe2 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler, 1, &pipe2);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), GG_AsyncPipe_AsDataSink(pipe1));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), GG_AsyncPipe_AsDataSink(pipe2));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // attach a handler to endpoint2
+    TestHandler handler;
+    GG_SET_INTERFACE(&handler, TestHandler, GG_CoapRequestHandler);
+    handler.result_to_return = GG_SUCCESS;
+    handler.code_to_respond_with = GG_COAP_MESSAGE_CODE_CONTENT;
+    handler.last_message_code_handled = 0;
+    handler.call_count = 0;
+    result = GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                                    "foo",
+                                                    GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                                    GG_CAST(&handler, GG_CoapRequestHandler));
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    TestClient client;
+    TestClient_Init(&client);
+    uint32_t now = 0;
+    GG_CoapObjectPoolStats warm_stats[3];
+    GG_BufferPoolStats warm_datagram_stats;
+    for (unsigned int i = 0; i < 100; i++) {
+        // remember the stats once the pools are warm
+        if (i == 10) {
+            GG_CoapObjectPool_GetStats(endpoint1->message_allocator.messages, &warm_stats[0]);
+            GG_CoapObjectPool_GetStats(endpoint1->request_pool, &warm_stats[1]);
+            GG_CoapObjectPool_GetStats(endpoint2->message_allocator.messages, &warm_stats[2]);
+            GG_BufferPool_GetStats(endpoint2->message_allocator.datagrams, &warm_datagram_stats);
+        }
+
+        GG_CoapMessageOptionParam options[] = {
+            GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "foo")
+        };
+        result = GG_CoapEndpoint_SendRequest(endpoint1,
+                                             GG_COAP_METHOD_GET,
+                                             options,
+                                             GG_ARRAY_SIZE(options),
+                                             NULL,
+                                             0,
+                                             NULL,
+                                             GG_CAST(&client, GG_CoapResponseListener),
+                                             &client.request_handle);
+        LONGS_EQUAL(GG_SUCCESS, result);
+
+        // let the pipes deliver the request and the response
+        for (unsigned int step = 0; step < 4; step++) {
+            GG_TimerScheduler_SetTime(timer_scheduler, ++now);
+        }
+        LONGS_EQUAL(i + 1, handler.call_count);
+        CHECK_TRUE(client.response != NULL);
+        LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CONTENT, GG_CoapMessage_GetCode(client.response));
+        GG_CoapMessage_Destroy(client.response);
+        client.response = NULL;
+    }
+    TestClient_Cleanup(&client);
+
+    // check that nothing was allocated from the heap after the warm up, and that
+    // all the objects have been returned
+    GG_CoapObjectPoolStats stats;
+    GG_CoapObjectPool_GetStats(endpoint1->message_allocator.messages, &stats);
+    LONGS_EQUAL(warm_stats[0].miss_count, stats.miss_count);
+    LONGS_EQUAL(0, stats.objects_in_use);
+    GG_CoapObjectPool_GetStats(endpoint1->request_pool, &stats);
+    LONGS_EQUAL(warm_stats[1].miss_count, stats.miss_count);
+    LONGS_EQUAL(0, stats.objects_in_use);
+    CHECK_TRUE(stats.objects_high_water >= 1);
+    GG_CoapObjectPool_GetStats(endpoint2->message_allocator.messages, &stats);
+    LONGS_EQUAL(warm_stats[2].miss_count, stats.miss_count);
+    LONGS_EQUAL(0, stats.objects_in_use);
+    GG_BufferPoolStats datagram_stats;
+    GG_BufferPool_GetStats(endpoint2->message_allocator.datagrams, &datagram_stats);
+    LONGS_EQUAL(warm_datagram_stats.miss_count, datagram_stats.miss_count);
+    CHECK_TRUE(datagram_stats.buffers_high_water <= GG_CONFIG_COAP_ENDPOINT_DATAGRAM_POOL_SIZE);
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), NULL);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+    GG_AsyncPipe_Destroy(pipe1);
+    GG_AsyncPipe_Destroy(pipe2);
+}
+
+//----------------------------------------------------------------------
+//  Source listener, counting the times an endpoint accepts data again
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSinkListener);
+
+    unsigned int can_put_count;
+} SourceListener;
+
+static void
+SourceListener_OnCanPut(GG_DataSinkListener* _self)
+{
+    SourceListener* self = GG_SELF(SourceListener, GG_DataSinkListener);
+
+    ++self->can_put_count;
+}
+
+GG_IMPLEMENT_INTERFACE(SourceListener, GG_DataSinkListener) {
+    SourceListener_OnCanPut
+};
+
+static GG_Result
+PutRequest(GG_CoapEndpoint* endpoint, uint16_t message_id, uint32_t peer)
+{
+    GG_CoapMessageOptionParam options[] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "foo")
+    };
+    GG_CoapMessage* request = NULL;
+    GG_Result result = GG_CoapMessage_Create(GG_COAP_METHOD_GET,
+                                             GG_COAP_MESSAGE_TYPE_CON,
+                                             options,
+                                             GG_ARRAY_SIZE(options),
+                                             message_id,
+                                             NULL, 0,
+                                             NULL, 0,
+                                             &request);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* datagram = NULL;
+    result = GG_CoapMessage_ToDatagram(request, &datagram);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapMessage_Destroy(request);
+
+    GG_SocketAddressMetadata metadata;
+    memset(&metadata, 0, sizeof(metadata));
+    metadata.base.type = GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS;
+    metadata.base.size = sizeof(metadata);
+    GG_IpAddress_SetFromInteger(&metadata.socket_address.address, peer);
+    metadata.socket_address.port = 5683;
+    result = GG_DataSink_PutData(GG_CoapEndpoint_AsDataSink(endpoint), datagram, &metadata.base);
+    GG_Buffer_Release(datagram);
+
+    return result;
+}
+
+TEST(GG_COAP, Test_ResponseQueueBackpressure)
+{
+    MemSink_Reset(&mem_sink);
+    mem_sink.block = true;
+
+    // create an endpoint that sends to a blocked sink
+    GG_CoapEndpoint* endpoint;
+    GG_Result result = GG_CoapEndpoint_Create(timer_scheduler,
+                                              GG_CAST(&mem_sink, GG_DataSink),
+                                              NULL,
+                                              &endpoint);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    SourceListener source_listener;
+    GG_SET_INTERFACE(&source_listener, SourceListener, GG_DataSinkListener);
+    source_listener.can_put_count = 0;
+    GG_DataSink_SetListener(GG_CoapEndpoint_AsDataSink(endpoint),
+                            GG_CAST(&source_listener, GG_DataSinkListener));
+
+    TestHandler handler;
+    GG_SET_INTERFACE(&handler, TestHandler, GG_CoapRequestHandler);
+    handler.result_to_return = GG_SUCCESS;
+    handler.code_to_respond_with = GG_COAP_MESSAGE_CODE_CONTENT;
+    handler.last_message_code_handled = 0;
+    handler.call_count = 0;
+    result = GG_CoapEndpoint_RegisterRequestHandler(endpoint,
+                                                    "foo",
+                                                    GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                                    GG_CAST(&handler, GG_CoapRequestHandler));
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // check the capacity bounds
+    LONGS_EQUAL(GG_ERROR_INVALID_PARAMETERS, GG_CoapEndpoint_SetResponseQueueCapacity(endpoint, 0));
+    result = GG_CoapEndpoint_SetResponseQueueCapacity(endpoint, 4);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapResponseQueueStats stats;
+    GG_CoapEndpoint_GetResponseQueueStats(endpoint, &stats);
+    LONGS_EQUAL(4, stats.capacity);
+    LONGS_EQUAL(0, stats.depth);
+
+    // one peer can only use half of the queue
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 1, 0x0A000001));
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 2, 0x0A000001));
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 3, 0x0A000001));
+    LONGS_EQUAL(2, handler.call_count);
+    GG_CoapEndpoint_GetResponseQueueStats(endpoint, &stats);
+    LONGS_EQUAL(2, stats.depth);
+    LONGS_EQUAL(1, stats.refused);
+
+    // other peers can fill the rest of the queue
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 4, 0x0A000002));
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 5, 0x0A000003));
+    LONGS_EQUAL(4, handler.call_count);
+    LONGS_EQUAL(GG_ERROR_INVALID_STATE, GG_CoapEndpoint_SetResponseQueueCapacity(endpoint, 3));
+
+    // when the queue is full, requests are pushed back instead of being dropped
+    LONGS_EQUAL(GG_ERROR_WOULD_BLOCK, PutRequest(endpoint, 6, 0x0A000004));
+    LONGS_EQUAL(4, handler.call_count);
+    GG_CoapEndpoint_GetResponseQueueStats(endpoint, &stats);
+    LONGS_EQUAL(4, stats.depth);
+    LONGS_EQUAL(4, stats.high_water);
+    LONGS_EQUAL(1, stats.blocked);
+    LONGS_EQUAL(0, stats.dropped);
+    LONGS_EQUAL(0, source_listener.can_put_count);
+
+    // unblock the sink, the queue drains and the source is told it can resume
+    mem_sink.block = false;
+    GG_DataSinkListener_OnCanPut(mem_sink.listener);
+    LONGS_EQUAL(4, mem_sink.receive_count);
+    LONGS_EQUAL(1, source_listener.can_put_count);
+    GG_CoapEndpoint_GetResponseQueueStats(endpoint, &stats);
+    LONGS_EQUAL(0, stats.depth);
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 6, 0x0A000004));
+    LONGS_EQUAL(5, handler.call_count);
+    LONGS_EQUAL(5, mem_sink.receive_count);
+
+    // growing the queue also unblocks the source
+    mem_sink.block = true;
+    result = GG_CoapEndpoint_SetResponseQueueCapacity(endpoint, 1);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 7, 0x0A000001));
+    LONGS_EQUAL(GG_ERROR_WOULD_BLOCK, PutRequest(endpoint, 8, 0x0A000002));
+    result = GG_CoapEndpoint_SetResponseQueueCapacity(endpoint, 8);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(2, source_listener.can_put_count);
+    LONGS_EQUAL(GG_SUCCESS, PutRequest(endpoint, 8, 0x0A000002));
+    GG_CoapEndpoint_GetResponseQueueStats(endpoint, &stats);
+    LONGS_EQUAL(2, stats.depth);
+    LONGS_EQUAL(2, stats.blocked);
+
+    // queued responses are released with the endpoint
+    GG_CoapEndpoint_Destroy(endpoint);
+    MemSink_Reset(&mem_sink);
+}
+
+static void
+AckLastRequest(GG_CoapEndpoint* endpoint)
+{
+    GG_CoapMessage* request = NULL;
+    GG_Result result = GG_CoapMessage_CreateFromDatagram(mem_sink.last_received_buffer, &request);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    uint8_t token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    size_t  token_length = GG_CoapMessage_GetToken(request, token);
+
+    GG_CoapMessage* response = NULL;
+    result = GG_CoapMessage_Create(GG_COAP_MESSAGE_CODE_CONTENT,
+                                   GG_COAP_MESSAGE_TYPE_ACK,
+                                   NULL, 0,
+                                   GG_CoapMessage_GetMessageId(request),
+                                   token, token_length,
+                                   NULL, 0,
+                                   &response);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* datagram = NULL;
+    result = GG_CoapMessage_ToDatagram(response, &datagram);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_DataSink_PutData(GG_CoapEndpoint_AsDataSink(endpoint), datagram, NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    GG_Buffer_Release(datagram);
+    GG_CoapMessage_Destroy(response);
+    GG_CoapMessage_Destroy(request);
+}
+
+TEST(GG_COAP, Test_AdaptiveResendTimeout) {
+    TestClient test_client;
+    TestClient_Init(&test_client);
+    MemSink_Reset(&mem_sink);
+    uint32_t now = 0;
+    GG_TimerScheduler_SetTime(timer_scheduler, now);
+
+    // without samples, the default timeout applies
+    uint32_t rto = 0;
+    uint32_t timeout = GG_CoapEndpoint_GetResendTimeout(test_endpoint, NULL, &rto);
+    LONGS_EQUAL(0, rto);
+    CHECK_TRUE(timeout >= GG_COAP_ACK_TIMEOUT_MS);
+    LONGS_EQUAL(2 * timeout, GG_CoapEndpoint_BackOffResendTimeout(timeout, rto));
+
+    // acknowledge a few requests after 200ms each
+    for (unsigned int i = 0; i < 10; i++) {
+        GG_Result result = GG_CoapEndpoint_SendRequest(test_endpoint,
+                                                       GG_COAP_METHOD_GET,
+                                                       NULL, 0,
+                                                       NULL, 0,
+                                                       NULL,
+                                                       GG_CAST(&test_client, GG_CoapResponseListener),
+                                                       &test_client.request_handle);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        now += 200;
+        GG_TimerScheduler_SetTime(timer_scheduler, now);
+        AckLastRequest(test_endpoint);
+        CHECK_TRUE(test_client.response != NULL);
+    }
+    LONGS_EQUAL(10, mem_sink.receive_count);
+
+    // the RTO now tracks the round-trip time
+    CHECK_TRUE(test_endpoint->peer_rtts[0].in_use);
+    CHECK_FALSE(test_endpoint->peer_rtts[0].has_peer);
+    LONGS_EQUAL(200, test_endpoint->peer_rtts[0].strong.srtt);
+    rto = test_endpoint->peer_rtts[0].rto;
+    CHECK_TRUE(rto > 200 && rto < 1000);
+
+    // an unacknowledged request is resent after the RTO, with a backoff factor of 3
+    GG_Result result = GG_CoapEndpoint_SendRequest(test_endpoint,
+                                                   GG_COAP_METHOD_GET,
+                                                   NULL, 0,
+                                                   NULL, 0,
+                                                   NULL,
+                                                   GG_CAST(&test_client, GG_CoapResponseListener),
+                                                   &test_client.request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    uint32_t start = now;
+    GG_TimerScheduler_SetTime(timer_scheduler, start + rto - 1);
+    LONGS_EQUAL(11, mem_sink.receive_count);
+    GG_TimerScheduler_SetTime(timer_scheduler, start + (uint32_t)(rto * GG_COAP_ACK_RANDOM_FACTOR));
+    LONGS_EQUAL(12, mem_sink.receive_count);
+    GG_TimerScheduler_SetTime(timer_scheduler, start + 3 * rto);
+    LONGS_EQUAL(12, mem_sink.receive_count);
+    GG_TimerScheduler_SetTime(timer_scheduler, start + (uint32_t)(4 * rto * GG_COAP_ACK_RANDOM_FACTOR));
+    LONGS_EQUAL(13, mem_sink.receive_count);
+
+    // an acknowledgement after two resends is a weak sample, measured from the first transmission
+    now = start + (uint32_t)(4 * rto * GG_COAP_ACK_RANDOM_FACTOR) + 10;
+    GG_TimerScheduler_SetTime(timer_scheduler, now);
+    LONGS_EQUAL(0, test_endpoint->peer_rtts[0].weak.srtt);
+    AckLastRequest(test_endpoint);
+    LONGS_EQUAL(now - start, test_endpoint->peer_rtts[0].weak.srtt);
+    CHECK_TRUE(test_endpoint->peer_rtts[0].rto > rto);
+
+    // an RTO that isn't updated for a while grows back
+    rto = test_endpoint->peer_rtts[0].rto;
+    now += 16 * rto + 1;
+    GG_TimerScheduler_SetTime(timer_scheduler, now);
+    uint32_t aged_rto = 0;
+    GG_CoapEndpoint_GetResendTimeout(test_endpoint, NULL, &aged_rto);
+    LONGS_EQUAL(2 * rto, aged_rto);
+
+    TestClient_Cleanup(&test_client);
+}
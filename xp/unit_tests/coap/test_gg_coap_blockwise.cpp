@@ -2335,3 +2335,915 @@ TEST(GG_COAP_BLOCKWISE, Test_BlockwiseCancelFromListener) {
     GG_TimerScheduler_Destroy(timer_scheduler1);
     GG_TimerScheduler_Destroy(timer_scheduler2);
 } 
+
+//----------------------------------------------------------------------
+// CoAP handler that returns a large payload from a block source, responding
+// to each odd block only after the block that follows it
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapRequestHandler);
+
+    GG_CoapBlockSource* block_source;
+    GG_CoapMessage*     held_response;
+    GG_CoapResponder*   held_responder;
+    size_t              requests_received;
+    size_t              responses_reordered;
+} ReorderingHandler;
+
+static GG_Result
+ReorderingHandler_OnRequest(GG_CoapRequestHandler*   _self,
+                            GG_CoapEndpoint*         endpoint,
+                            const GG_CoapMessage*    request,
+                            GG_CoapResponder*        responder,
+                            const GG_BufferMetadata* transport_metadata,
+                            GG_CoapMessage**         response)
+{
+    ReorderingHandler* self = GG_SELF(ReorderingHandler, GG_CoapRequestHandler);
+    GG_COMPILER_UNUSED(transport_metadata);
+
+    ++self->requests_received;
+
+    GG_CoapMessageBlockInfo block_info;
+    GG_Result result = GG_CoapMessage_GetBlockInfo(request, GG_COAP_MESSAGE_OPTION_BLOCK2, &block_info, 1024);
+    if (GG_FAILED(result)) {
+        return GG_COAP_MESSAGE_CODE_BAD_OPTION;
+    }
+
+    result = GG_CoapEndpoint_CreateBlockwiseResponseFromBlockSource(endpoint,
+                                                                    request,
+                                                                    GG_COAP_MESSAGE_CODE_CONTENT,
+                                                                    NULL, 0,
+                                                                    self->block_source,
+                                                                    GG_COAP_MESSAGE_OPTION_BLOCK2,
+                                                                    &block_info,
+                                                                    response);
+
+    // hold the response for odd blocks
+    if (GG_SUCCEEDED(result) && (block_info.offset / block_info.size) % 2) {
+        self->held_response  = *response;
+        self->held_responder = responder;
+        *response = NULL;
+        return GG_ERROR_WOULD_BLOCK;
+    }
+
+    // respond (with an error past the end), followed by the held response if any
+    if (GG_SUCCEEDED(result)) {
+        GG_CoapResponder_SendResponse(responder, *response);
+        GG_CoapMessage_Destroy(*response);
+        *response = NULL;
+    } else {
+        GG_CoapResponder_Respond(responder, GG_COAP_MESSAGE_CODE_BAD_OPTION, NULL, 0, NULL, 0);
+    }
+    GG_CoapResponder_Release(responder);
+    if (self->held_response) {
+        GG_CoapResponder_SendResponse(self->held_responder, self->held_response);
+        GG_CoapMessage_Destroy(self->held_response);
+        GG_CoapResponder_Release(self->held_responder);
+        self->held_response  = NULL;
+        self->held_responder = NULL;
+        ++self->responses_reordered;
+    }
+
+    return GG_ERROR_WOULD_BLOCK;
+}
+
+GG_IMPLEMENT_INTERFACE(ReorderingHandler, GG_CoapRequestHandler) {
+    ReorderingHandler_OnRequest
+};
+
+//----------------------------------------------------------------------
+// CoAP blockwise listener that checks that blocks are received in order,
+// and can pause the request after a given block
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapBlockwiseResponseListener);
+
+    GG_CoapEndpoint*        endpoint;
+    GG_CoapRequestHandle    request_handle;
+    size_t                  offset_to_pause_on;
+    bool                    paused;
+    size_t                  blocks_received;
+    size_t                  bytes_received;
+    size_t                  next_offset;
+    size_t                  out_of_order_blocks;
+    GG_Result               last_error;
+    GG_CoapMessageBlockInfo last_block_info;
+    uint8_t                 last_code;
+} OrderCheckingListener;
+
+static void
+OrderCheckingListener_OnResponseBlock(GG_CoapBlockwiseResponseListener* _self,
+                                      GG_CoapMessageBlockInfo*          block_info,
+                                      GG_CoapMessage*                   block_message)
+{
+    OrderCheckingListener* self = GG_SELF(OrderCheckingListener, GG_CoapBlockwiseResponseListener);
+
+    self->last_code       = GG_CoapMessage_GetCode(block_message);
+    self->last_block_info = *block_info;
+    if (block_info->offset != self->next_offset) {
+        ++self->out_of_order_blocks;
+    }
+    self->next_offset = block_info->offset + GG_CoapMessage_GetPayloadSize(block_message);
+    ++self->blocks_received;
+    self->bytes_received += GG_CoapMessage_GetPayloadSize(block_message);
+
+    if (self->offset_to_pause_on && block_info->offset == self->offset_to_pause_on) {
+        GG_Result result = GG_CoapEndpoint_PauseBlockwiseRequest(self->endpoint, self->request_handle);
+        LONGS_EQUAL(GG_SUCCESS, result)
+        self->paused = true;
+    }
+}
+
+static void
+OrderCheckingListener_OnError(GG_CoapBlockwiseResponseListener* _self,
+                              GG_Result                         error,
+                              const char*                       message)
+{
+    OrderCheckingListener* self = GG_SELF(OrderCheckingListener, GG_CoapBlockwiseResponseListener);
+    GG_COMPILER_UNUSED(message);
+
+    self->last_error = error;
+}
+
+GG_IMPLEMENT_INTERFACE(OrderCheckingListener, GG_CoapBlockwiseResponseListener) {
+    .OnResponseBlock = OrderCheckingListener_OnResponseBlock,
+    .OnError         = OrderCheckingListener_OnError
+};
+
+//-----------------------------------------------------------------------
+TEST(GG_COAP_BLOCKWISE, Test_PipelinedBlockwiseGet) {
+    GG_Result result;
+
+    // create two endpoints
+    GG_TimerScheduler* timer_scheduler1 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler1);
+    GG_CoapEndpoint* endpoint1;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint1);
+    GG_TimerScheduler* timer_scheduler2 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler2);
+    GG_CoapEndpoint* endpoint2;
+    GG_CoapEndpoint_Create(timer_scheduler2, NULL, NULL, &endpoint2);
+
+    // connect the two endpoints with async pipes
+    GG_AsyncPipe* pipe1 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler1, 1, &pipe1);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe2 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler2, 1, &pipe2);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1),
+                              GG_AsyncPipe_AsDataSink(pipe1));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1),
+                              GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2),
+                              GG_AsyncPipe_AsDataSink(pipe2));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2),
+                              GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // create a block source
+    BlockSource block_source = {
+        GG_INTERFACE_INITIALIZER(BlockSource, GG_CoapBlockSource)
+    };
+    block_source.payload_size = 10000;
+
+    // create and register a handler3 and a reordering handler
+    Handler3 handler3 = {
+        GG_INTERFACE_INITIALIZER(Handler3, GG_CoapRequestHandler)
+    };
+    handler3.block_source = GG_CAST(&block_source, GG_CoapBlockSource);
+    GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                           "handler3",
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                           GG_CAST(&handler3, GG_CoapRequestHandler));
+    ReorderingHandler reordering_handler = {
+        GG_INTERFACE_INITIALIZER(ReorderingHandler, GG_CoapRequestHandler)
+    };
+    reordering_handler.block_source = GG_CAST(&block_source, GG_CoapBlockSource);
+    GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                           "reorder",
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET |
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ENABLE_ASYNC,
+                                           GG_CAST(&reordering_handler, GG_CoapRequestHandler));
+
+    // make a pipelined blockwise GET request for handler3
+    OrderCheckingListener listener;
+    memset(&listener, 0, sizeof(listener));
+    GG_SET_INTERFACE(&listener, OrderCheckingListener, GG_CoapBlockwiseResponseListener);
+    GG_CoapRequestHandle request_handle;
+    GG_CoapMessageOptionParam params1[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "handler3")
+    };
+    result = GG_CoapEndpoint_SendPipelinedBlockwiseRequest(endpoint1,
+                                                           GG_COAP_METHOD_GET,
+                                                           params1, GG_ARRAY_SIZE(params1),
+                                                           NULL,
+                                                           0,
+                                                           4,
+                                                           NULL,
+                                                           GG_CAST(&listener, GG_CoapBlockwiseResponseListener),
+                                                           &request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    CHECK_FALSE(request_handle == GG_COAP_INVALID_REQUEST_HANDLE)
+
+    // the first block is requested alone
+    uint32_t now1 = 0;
+    uint32_t now2 = 0;
+    GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+    GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    LONGS_EQUAL(1, listener.blocks_received);
+    LONGS_EQUAL(1024, listener.last_block_info.size);
+
+    for (unsigned int i = 0; i < 100; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+
+    LONGS_EQUAL(GG_SUCCESS, listener.last_error);
+    LONGS_EQUAL(10, listener.blocks_received);
+    LONGS_EQUAL(10000, listener.bytes_received);
+    LONGS_EQUAL(0, listener.out_of_order_blocks);
+    LONGS_EQUAL(9 * 1024, listener.last_block_info.offset);
+    LONGS_EQUAL(0, listener.last_block_info.more);
+
+    // make a pipelined blockwise GET request for the reordering handler
+    memset(&listener, 0, sizeof(listener));
+    GG_SET_INTERFACE(&listener, OrderCheckingListener, GG_CoapBlockwiseResponseListener);
+    GG_CoapMessageOptionParam params2[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "reorder")
+    };
+    result = GG_CoapEndpoint_SendPipelinedBlockwiseRequest(endpoint1,
+                                                           GG_COAP_METHOD_GET,
+                                                           params2, GG_ARRAY_SIZE(params2),
+                                                           NULL,
+                                                           0,
+                                                           4,
+                                                           NULL,
+                                                           GG_CAST(&listener, GG_CoapBlockwiseResponseListener),
+                                                           &request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    for (unsigned int i = 0; i < 100; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+
+    CHECK_TRUE(reordering_handler.responses_reordered >= 4)
+    LONGS_EQUAL(GG_SUCCESS, listener.last_error);
+    LONGS_EQUAL(10, listener.blocks_received);
+    LONGS_EQUAL(10000, listener.bytes_received);
+    LONGS_EQUAL(0, listener.out_of_order_blocks);
+    LONGS_EQUAL(9 * 1024, listener.last_block_info.offset);
+    LONGS_EQUAL(0, listener.last_block_info.more);
+
+    // cleanup
+    if (reordering_handler.held_responder) {
+        GG_CoapMessage_Destroy(reordering_handler.held_response);
+        GG_CoapResponder_Release(reordering_handler.held_responder);
+    }
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), NULL);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+    GG_AsyncPipe_Destroy(pipe1);
+    GG_AsyncPipe_Destroy(pipe2);
+    GG_TimerScheduler_Destroy(timer_scheduler1);
+    GG_TimerScheduler_Destroy(timer_scheduler2);
+}
+
+//-----------------------------------------------------------------------
+TEST(GG_COAP_BLOCKWISE, Test_PipelinedBlockwisePut) {
+    GG_Result result;
+
+    // create two endpoints
+    GG_TimerScheduler* timer_scheduler1 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler1);
+    GG_CoapEndpoint* endpoint1;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint1);
+    GG_TimerScheduler* timer_scheduler2 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler2);
+    GG_CoapEndpoint* endpoint2;
+    GG_CoapEndpoint_Create(timer_scheduler2, NULL, NULL, &endpoint2);
+
+    // connect the two endpoints with async pipes
+    GG_AsyncPipe* pipe1 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler1, 1, &pipe1);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe2 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler2, 1, &pipe2);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1),
+                              GG_AsyncPipe_AsDataSink(pipe1));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1),
+                              GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2),
+                              GG_AsyncPipe_AsDataSink(pipe2));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2),
+                              GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // create a handler
+    Handler1 handler1 = {
+        GG_INTERFACE_INITIALIZER(Handler1, GG_CoapRequestHandler)
+    };
+    GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                           "handler1",
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_PUT,
+                                           GG_CAST(&handler1, GG_CoapRequestHandler));
+
+    // create a blockwise listener
+    BlockListener block_listener = {
+        GG_INTERFACE_INITIALIZER(BlockListener, GG_CoapBlockwiseResponseListener)
+    };
+
+    // create a block source
+    BlockSource block_source = {
+        GG_INTERFACE_INITIALIZER(BlockSource, GG_CoapBlockSource)
+    };
+    block_source.payload_size = 10000;
+
+    // make a pipelined blockwise PUT request
+    GG_CoapRequestHandle request_handle;
+    GG_CoapMessageOptionParam params[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "handler1")
+    };
+    result = GG_CoapEndpoint_SendPipelinedBlockwiseRequest(endpoint1,
+                                                           GG_COAP_METHOD_PUT,
+                                                           params, GG_ARRAY_SIZE(params),
+                                                           GG_CAST(&block_source, GG_CoapBlockSource),
+                                                           0,
+                                                           4,
+                                                           NULL,
+                                                           GG_CAST(&block_listener, GG_CoapBlockwiseResponseListener),
+                                                           &request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the first block is sent alone
+    uint32_t now1 = 0;
+    uint32_t now2 = 0;
+    GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+    LONGS_EQUAL(1, handler1.blocks_received);
+    GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    LONGS_EQUAL(1, handler1.blocks_received);
+
+    // once it is accepted, several blocks are sent at a time
+    GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+    GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+    CHECK_TRUE(handler1.blocks_received > 2)
+
+    for (unsigned int i = 0; i < 100; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+
+    LONGS_EQUAL(10, handler1.blocks_received);
+    LONGS_EQUAL(10000, handler1.bytes_received);
+    LONGS_EQUAL(9 * 1024, handler1.last_block_info.offset);
+    LONGS_EQUAL(0, handler1.last_block_info.more);
+    LONGS_EQUAL(GG_SUCCESS, block_listener.last_error);
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CHANGED, block_listener.last_code);
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), NULL);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+    GG_AsyncPipe_Destroy(pipe1);
+    GG_AsyncPipe_Destroy(pipe2);
+    GG_TimerScheduler_Destroy(timer_scheduler1);
+    GG_TimerScheduler_Destroy(timer_scheduler2);
+}
+
+//-----------------------------------------------------------------------
+TEST(GG_COAP_BLOCKWISE, Test_PipelinedBlockwisePauseResume) {
+    GG_Result result;
+
+    // create two endpoints
+    GG_TimerScheduler* timer_scheduler1 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler1);
+    GG_CoapEndpoint* endpoint1;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint1);
+    GG_TimerScheduler* timer_scheduler2 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler2);
+    GG_CoapEndpoint* endpoint2;
+    GG_CoapEndpoint_Create(timer_scheduler2, NULL, NULL, &endpoint2);
+
+    // connect the two endpoints with async pipes
+    GG_AsyncPipe* pipe1 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler1, 1, &pipe1);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe2 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler2, 1, &pipe2);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1),
+                              GG_AsyncPipe_AsDataSink(pipe1));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1),
+                              GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2),
+                              GG_AsyncPipe_AsDataSink(pipe2));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2),
+                              GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // create a block source
+    BlockSource block_source = {
+        GG_INTERFACE_INITIALIZER(BlockSource, GG_CoapBlockSource)
+    };
+    block_source.payload_size = 10000;
+
+    // create and register a handler3
+    Handler3 handler3 = {
+        GG_INTERFACE_INITIALIZER(Handler3, GG_CoapRequestHandler)
+    };
+    handler3.block_source = GG_CAST(&block_source, GG_CoapBlockSource);
+    GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                           "handler3",
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                           GG_CAST(&handler3, GG_CoapRequestHandler));
+
+    // make a pipelined blockwise GET request, pausing after the third block
+    OrderCheckingListener listener;
+    memset(&listener, 0, sizeof(listener));
+    GG_SET_INTERFACE(&listener, OrderCheckingListener, GG_CoapBlockwiseResponseListener);
+    listener.endpoint           = endpoint1;
+    listener.offset_to_pause_on = 2 * 1024;
+    GG_CoapMessageOptionParam params[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "handler3")
+    };
+    result = GG_CoapEndpoint_SendPipelinedBlockwiseRequest(endpoint1,
+                                                           GG_COAP_METHOD_GET,
+                                                           params, GG_ARRAY_SIZE(params),
+                                                           NULL,
+                                                           0,
+                                                           4,
+                                                           NULL,
+                                                           GG_CAST(&listener, GG_CoapBlockwiseResponseListener),
+                                                           &listener.request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the blocks already in flight when pausing aren't delivered while paused
+    uint32_t now1 = 0;
+    uint32_t now2 = 0;
+    for (unsigned int i = 0; i < 100; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+    CHECK_TRUE(listener.paused)
+    LONGS_EQUAL(3, listener.blocks_received);
+    LONGS_EQUAL(GG_SUCCESS, listener.last_error);
+
+    // resume
+    result = GG_CoapEndpoint_ResumeBlockwiseRequest(endpoint1, listener.request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    for (unsigned int i = 0; i < 100; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+
+    LONGS_EQUAL(GG_SUCCESS, listener.last_error);
+    LONGS_EQUAL(10, listener.blocks_received);
+    LONGS_EQUAL(10000, listener.bytes_received);
+    LONGS_EQUAL(0, listener.out_of_order_blocks);
+    LONGS_EQUAL(9 * 1024, listener.last_block_info.offset);
+    LONGS_EQUAL(0, listener.last_block_info.more);
+
+    // the request is done
+    result = GG_CoapEndpoint_ResumeBlockwiseRequest(endpoint1, listener.request_handle);
+    LONGS_EQUAL(GG_ERROR_NO_SUCH_ITEM, result);
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), NULL);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+    GG_AsyncPipe_Destroy(pipe1);
+    GG_AsyncPipe_Destroy(pipe2);
+    GG_TimerScheduler_Destroy(timer_scheduler1);
+    GG_TimerScheduler_Destroy(timer_scheduler2);
+}
+
+//----------------------------------------------------------------------
+// Data sink that drops the first transmission of some blocks
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    GG_DataSink*  sink;
+    uint32_t      block_option;
+    const size_t* blocks_to_drop;
+    size_t        blocks_to_drop_count;
+    uint32_t      dropped_mask;
+    size_t        packets_dropped;
+} LossySink;
+
+static GG_Result
+LossySink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    LossySink* self = GG_SELF(LossySink, GG_DataSink);
+
+    // check which block this is, if any
+    GG_CoapMessage* message = NULL;
+    GG_Result result = GG_CoapMessage_CreateFromDatagram(data, &message);
+    if (GG_SUCCEEDED(result)) {
+        GG_CoapMessageBlockInfo block_info;
+        result = GG_CoapMessage_GetBlockInfo(message, self->block_option, &block_info, 0);
+        GG_CoapMessage_Destroy(message);
+        if (GG_SUCCEEDED(result)) {
+            for (size_t i = 0; i < self->blocks_to_drop_count; i++) {
+                if (self->blocks_to_drop[i] == block_info.offset / block_info.size &&
+                    !(self->dropped_mask & (1 << i))) {
+                    self->dropped_mask |= (1 << i);
+                    ++self->packets_dropped;
+                    return GG_SUCCESS;
+                }
+            }
+        }
+    }
+
+    return GG_DataSink_PutData(self->sink, data, metadata);
+}
+
+static GG_Result
+LossySink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    LossySink* self = GG_SELF(LossySink, GG_DataSink);
+
+    return GG_DataSink_SetListener(self->sink, listener);
+}
+
+GG_IMPLEMENT_INTERFACE(LossySink, GG_DataSink) {
+    LossySink_PutData,
+    LossySink_SetListener
+};
+
+//----------------------------------------------------------------------
+// CoAP handler that returns a large payload with the Q-Block2 option
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapRequestHandler);
+
+    GG_CoapBlockwiseServerHelper helper;
+    GG_CoapBlockSource*          block_source;
+    size_t                       requests_received;
+    size_t                       resent_requests;
+} QBlock2Handler;
+
+static GG_Result
+QBlock2Handler_OnRequest(GG_CoapRequestHandler*   _self,
+                         GG_CoapEndpoint*         endpoint,
+                         const GG_CoapMessage*    request,
+                         GG_CoapResponder*        responder,
+                         const GG_BufferMetadata* transport_metadata,
+                         GG_CoapMessage**         response)
+{
+    QBlock2Handler* self = GG_SELF(QBlock2Handler, GG_CoapRequestHandler);
+    GG_COMPILER_UNUSED(responder);
+
+    ++self->requests_received;
+
+    bool      resent = false;
+    GG_Result result = GG_CoapBlockwiseServerHelper_OnRequest(&self->helper, request, &resent);
+    if (result != GG_SUCCESS) {
+        return result;
+    }
+    if (resent) {
+        ++self->resent_requests;
+    }
+
+    return GG_CoapBlockwiseServerHelper_CreateResponseFromBlockSource(&self->helper,
+                                                                      endpoint,
+                                                                      request,
+                                                                      transport_metadata,
+                                                                      GG_COAP_MESSAGE_CODE_CONTENT,
+                                                                      NULL, 0,
+                                                                      self->block_source,
+                                                                      response);
+}
+
+GG_IMPLEMENT_INTERFACE(QBlock2Handler, GG_CoapRequestHandler) {
+    QBlock2Handler_OnRequest
+};
+
+//----------------------------------------------------------------------
+// CoAP handler that accepts a large payload with the Q-Block1 option
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapRequestHandler);
+
+    GG_CoapBlockwiseServerHelper helper;
+    uint8_t                      data[32768];
+    size_t                       data_size;
+    size_t                       blocks_received;
+    size_t                       resent_blocks;
+} QBlock1Handler;
+
+static GG_Result
+QBlock1Handler_OnRequest(GG_CoapRequestHandler*   _self,
+                         GG_CoapEndpoint*         endpoint,
+                         const GG_CoapMessage*    request,
+                         GG_CoapResponder*        responder,
+                         const GG_BufferMetadata* transport_metadata,
+                         GG_CoapMessage**         response)
+{
+    QBlock1Handler* self = GG_SELF(QBlock1Handler, GG_CoapRequestHandler);
+    GG_COMPILER_UNUSED(responder);
+    GG_COMPILER_UNUSED(transport_metadata);
+
+    bool      resent = false;
+    GG_Result result = GG_CoapBlockwiseServerHelper_OnRequest(&self->helper, request, &resent);
+    if (result != GG_SUCCESS) {
+        return result;
+    }
+
+    // store the block where it belongs
+    ++self->blocks_received;
+    size_t payload_size = GG_CoapMessage_GetPayloadSize(request);
+    if (resent) {
+        ++self->resent_blocks;
+    } else if (self->helper.block_info.offset + payload_size <= sizeof(self->data)) {
+        memcpy(&self->data[self->helper.block_info.offset], GG_CoapMessage_GetPayload(request), payload_size);
+        if (self->helper.block_info.offset + payload_size > self->data_size) {
+            self->data_size = self->helper.block_info.offset + payload_size;
+        }
+    }
+
+    return GG_CoapBlockwiseServerHelper_CreateResponse(&self->helper,
+                                                       endpoint,
+                                                       request,
+                                                       self->helper.done ?
+                                                       GG_COAP_MESSAGE_CODE_CHANGED :
+                                                       GG_COAP_MESSAGE_CODE_CONTINUE,
+                                                       NULL, 0,
+                                                       NULL, 0,
+                                                       response);
+}
+
+GG_IMPLEMENT_INTERFACE(QBlock1Handler, GG_CoapRequestHandler) {
+    QBlock1Handler_OnRequest
+};
+
+//-----------------------------------------------------------------------
+TEST(GG_COAP_BLOCKWISE, Test_QBlockGet) {
+    GG_Result result;
+
+    // create two endpoints
+    GG_TimerScheduler* timer_scheduler1 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler1);
+    GG_CoapEndpoint* endpoint1;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint1);
+    GG_TimerScheduler* timer_scheduler2 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler2);
+    GG_CoapEndpoint* endpoint2;
+    GG_CoapEndpoint_Create(timer_scheduler2, NULL, NULL, &endpoint2);
+
+    // connect the two endpoints with async pipes, dropping some blocks sent by the server:
+    // blocks in the middle of a set, the block carried by the piggybacked response, and the
+    // last block of the payload
+    GG_AsyncPipe* pipe1 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler1, 16, &pipe1);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe2 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler2, 16, &pipe2);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    const size_t blocks_to_drop[] = { 3, 6, 7, 10, 12, 24 };
+    LossySink lossy_sink;
+    memset(&lossy_sink, 0, sizeof(lossy_sink));
+    GG_SET_INTERFACE(&lossy_sink, LossySink, GG_DataSink);
+    lossy_sink.sink                 = GG_AsyncPipe_AsDataSink(pipe2);
+    lossy_sink.block_option         = GG_COAP_MESSAGE_OPTION_QBLOCK2;
+    lossy_sink.blocks_to_drop       = blocks_to_drop;
+    lossy_sink.blocks_to_drop_count = GG_ARRAY_SIZE(blocks_to_drop);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1),
+                              GG_AsyncPipe_AsDataSink(pipe1));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1),
+                              GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2),
+                              GG_CAST(&lossy_sink, GG_DataSink));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2),
+                              GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // create a block source
+    BlockSource block_source = {
+        GG_INTERFACE_INITIALIZER(BlockSource, GG_CoapBlockSource)
+    };
+    block_source.payload_size = 25000;
+
+    // create and register a Q-Block2 handler
+    QBlock2Handler handler;
+    memset(&handler, 0, sizeof(handler));
+    GG_SET_INTERFACE(&handler, QBlock2Handler, GG_CoapRequestHandler);
+    GG_CoapBlockwiseServerHelper_Init(&handler.helper, GG_COAP_MESSAGE_OPTION_QBLOCK2, 0);
+    handler.block_source = GG_CAST(&block_source, GG_CoapBlockSource);
+    GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                           "qblock2",
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                           GG_CAST(&handler, GG_CoapRequestHandler));
+
+    // make a Q-Block GET request
+    OrderCheckingListener listener;
+    memset(&listener, 0, sizeof(listener));
+    GG_SET_INTERFACE(&listener, OrderCheckingListener, GG_CoapBlockwiseResponseListener);
+    GG_CoapRequestHandle request_handle;
+    GG_CoapMessageOptionParam params[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "qblock2")
+    };
+    GG_CoapClientParameters client_parameters = {
+        100, // ack_timeout
+        4    // max_resend_count
+    };
+    result = GG_CoapEndpoint_SendQBlockRequest(endpoint1,
+                                               GG_COAP_METHOD_GET,
+                                               params, GG_ARRAY_SIZE(params),
+                                               NULL,
+                                               0,
+                                               &client_parameters,
+                                               GG_CAST(&listener, GG_CoapBlockwiseResponseListener),
+                                               &request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    CHECK_FALSE(request_handle == GG_COAP_INVALID_REQUEST_HANDLE)
+
+    uint32_t now1 = 0;
+    uint32_t now2 = 0;
+    for (unsigned int i = 0; i < 2000; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+
+    // all the blocks were dropped once, and recovered
+    LONGS_EQUAL(GG_ARRAY_SIZE(blocks_to_drop), lossy_sink.packets_dropped);
+    CHECK_TRUE(handler.resent_requests >= 2)
+    LONGS_EQUAL(GG_SUCCESS, listener.last_error);
+    LONGS_EQUAL(25, listener.blocks_received);
+    LONGS_EQUAL(25000, listener.bytes_received);
+    LONGS_EQUAL(0, listener.out_of_order_blocks);
+    LONGS_EQUAL(24 * 1024, listener.last_block_info.offset);
+    LONGS_EQUAL(0, listener.last_block_info.more);
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CONTENT, listener.last_code);
+
+    // the request is done
+    result = GG_CoapEndpoint_CancelBlockwiseRequest(endpoint1, request_handle);
+    LONGS_EQUAL(GG_ERROR_NO_SUCH_ITEM, result);
+
+    // a server that doesn't support Q-Block2 gets classic BLOCK2 requests after its first response
+    Handler3 handler3 = {
+        GG_INTERFACE_INITIALIZER(Handler3, GG_CoapRequestHandler)
+    };
+    handler3.block_source = GG_CAST(&block_source, GG_CoapBlockSource);
+    GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                           "handler3",
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                           GG_CAST(&handler3, GG_CoapRequestHandler));
+    memset(&listener, 0, sizeof(listener));
+    GG_SET_INTERFACE(&listener, OrderCheckingListener, GG_CoapBlockwiseResponseListener);
+    GG_CoapMessageOptionParam params3[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "handler3")
+    };
+    result = GG_CoapEndpoint_SendQBlockRequest(endpoint1,
+                                               GG_COAP_METHOD_GET,
+                                               params3, GG_ARRAY_SIZE(params3),
+                                               NULL,
+                                               0,
+                                               NULL,
+                                               GG_CAST(&listener, GG_CoapBlockwiseResponseListener),
+                                               &request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    for (unsigned int i = 0; i < 100; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+    LONGS_EQUAL(GG_SUCCESS, listener.last_error);
+    LONGS_EQUAL(25, listener.blocks_received);
+    LONGS_EQUAL(25000, listener.bytes_received);
+    LONGS_EQUAL(0, listener.out_of_order_blocks);
+    LONGS_EQUAL(0, listener.last_block_info.more);
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), NULL);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+    GG_AsyncPipe_Destroy(pipe1);
+    GG_AsyncPipe_Destroy(pipe2);
+    GG_TimerScheduler_Destroy(timer_scheduler1);
+    GG_TimerScheduler_Destroy(timer_scheduler2);
+}
+
+//-----------------------------------------------------------------------
+TEST(GG_COAP_BLOCKWISE, Test_QBlockPut) {
+    GG_Result result;
+
+    // create two endpoints
+    GG_TimerScheduler* timer_scheduler1 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler1);
+    GG_CoapEndpoint* endpoint1;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint1);
+    GG_TimerScheduler* timer_scheduler2 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler2);
+    GG_CoapEndpoint* endpoint2;
+    GG_CoapEndpoint_Create(timer_scheduler2, NULL, NULL, &endpoint2);
+
+    // connect the two endpoints with async pipes, dropping some blocks sent by the client:
+    // NON blocks, and the CON block that ends a set
+    GG_AsyncPipe* pipe1 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler1, 16, &pipe1);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe2 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler2, 16, &pipe2);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    const size_t blocks_to_drop[] = { 1, 4, 9, 15 };
+    LossySink lossy_sink;
+    memset(&lossy_sink, 0, sizeof(lossy_sink));
+    GG_SET_INTERFACE(&lossy_sink, LossySink, GG_DataSink);
+    lossy_sink.sink                 = GG_AsyncPipe_AsDataSink(pipe1);
+    lossy_sink.block_option         = GG_COAP_MESSAGE_OPTION_QBLOCK1;
+    lossy_sink.blocks_to_drop       = blocks_to_drop;
+    lossy_sink.blocks_to_drop_count = GG_ARRAY_SIZE(blocks_to_drop);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1),
+                              GG_CAST(&lossy_sink, GG_DataSink));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1),
+                              GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2),
+                              GG_AsyncPipe_AsDataSink(pipe2));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2),
+                              GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // create and register a Q-Block1 handler
+    QBlock1Handler* handler = (QBlock1Handler*)GG_AllocateZeroMemory(sizeof(QBlock1Handler));
+    GG_SET_INTERFACE(handler, QBlock1Handler, GG_CoapRequestHandler);
+    GG_CoapBlockwiseServerHelper_Init(&handler->helper, GG_COAP_MESSAGE_OPTION_QBLOCK1, 0);
+    GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                           "qblock1",
+                                           GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_PUT,
+                                           GG_CAST(handler, GG_CoapRequestHandler));
+
+    // create a block source
+    BlockSource block_source = {
+        GG_INTERFACE_INITIALIZER(BlockSource, GG_CoapBlockSource)
+    };
+    block_source.payload_size = 25000;
+
+    // make a Q-Block PUT request
+    BlockListener block_listener = {
+        GG_INTERFACE_INITIALIZER(BlockListener, GG_CoapBlockwiseResponseListener)
+    };
+    GG_CoapRequestHandle request_handle;
+    GG_CoapMessageOptionParam params[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "qblock1")
+    };
+    GG_CoapClientParameters client_parameters = {
+        100, // ack_timeout
+        4    // max_resend_count
+    };
+    result = GG_CoapEndpoint_SendQBlockRequest(endpoint1,
+                                               GG_COAP_METHOD_PUT,
+                                               params, GG_ARRAY_SIZE(params),
+                                               GG_CAST(&block_source, GG_CoapBlockSource),
+                                               0,
+                                               &client_parameters,
+                                               GG_CAST(&block_listener, GG_CoapBlockwiseResponseListener),
+                                               &request_handle);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    uint32_t now1 = 0;
+    uint32_t now2 = 0;
+    for (unsigned int i = 0; i < 2000; i++) {
+        GG_TimerScheduler_SetTime(timer_scheduler1, ++now1);
+        GG_TimerScheduler_SetTime(timer_scheduler2, ++now2);
+    }
+
+    // all the blocks were dropped once, and recovered
+    LONGS_EQUAL(GG_ARRAY_SIZE(blocks_to_drop), lossy_sink.packets_dropped);
+    CHECK_TRUE(handler->helper.done)
+    LONGS_EQUAL(25000, handler->data_size);
+    LONGS_EQUAL(GG_SUCCESS, block_listener.last_error);
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CHANGED, block_listener.last_code);
+
+    // check the data
+    for (size_t offset = 0; offset < 25000; offset += 1024) {
+        uint8_t expected[1024];
+        size_t  block_size = sizeof(expected);
+        bool    more       = false;
+        GG_CoapBlockSource_GetDataSize(GG_CAST(&block_source, GG_CoapBlockSource), offset, &block_size, &more);
+        GG_CoapBlockSource_GetData(GG_CAST(&block_source, GG_CoapBlockSource), offset, block_size, expected);
+        MEMCMP_EQUAL(expected, &handler->data[offset], block_size);
+    }
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), NULL);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+    GG_AsyncPipe_Destroy(pipe1);
+    GG_AsyncPipe_Destroy(pipe2);
+    GG_TimerScheduler_Destroy(timer_scheduler1);
+    GG_TimerScheduler_Destroy(timer_scheduler2);
+    GG_FreeMemory(handler);
+}
@@ -13,6 +13,7 @@
 #include "xp/common/gg_port.h"
 #include "xp/common/gg_buffer.h"
 #include "xp/common/gg_memory.h"
+#include "xp/common/gg_utils.h"
 #include "xp/coap/gg_coap_message.h"
 
 /*----------------------------------------------------------------------
@@ -605,3 +606,111 @@ TEST(GG_COAP, Test_OptionParamsOrdering) {
 
     GG_CoapMessage_Destroy(message);
 }
+
+//----------------------------------------------------------------------
+static void
+CheckPathOptions(GG_CoapMessage* message, unsigned int path_count)
+{
+    // find the options by index
+    GG_CoapMessageOption option;
+    GG_Result result;
+    for (unsigned int i = 0; i < path_count; i++) {
+        result = GG_CoapMessage_GetOption(message, GG_COAP_MESSAGE_OPTION_URI_PATH, &option, i);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        LONGS_EQUAL(GG_COAP_MESSAGE_OPTION_TYPE_STRING, option.type);
+        LONGS_EQUAL(1, option.value.string.length);
+        LONGS_EQUAL('a' + i, option.value.string.chars[0]);
+    }
+    result = GG_CoapMessage_GetOption(message, GG_COAP_MESSAGE_OPTION_URI_PATH, &option, path_count);
+    LONGS_EQUAL(GG_ERROR_NO_SUCH_ITEM, result);
+    result = GG_CoapMessage_GetOption(message, GG_COAP_MESSAGE_OPTION_BLOCK2, &option, 0);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0x1234, option.value.uint);
+    result = GG_CoapMessage_GetOption(message, GG_COAP_MESSAGE_OPTION_CONTENT_FORMAT, &option, 0);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, option.value.uint);
+    result = GG_CoapMessage_GetOption(message, GG_COAP_MESSAGE_OPTION_BLOCK1, &option, 0);
+    LONGS_EQUAL(GG_ERROR_NO_SUCH_ITEM, result);
+    result = GG_CoapMessage_GetOption(message, 5000, &option, 0);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(GG_COAP_MESSAGE_OPTION_TYPE_OPAQUE, option.type);
+    LONGS_EQUAL(0, option.value.opaque.size);
+
+    // iterate over all the options
+    GG_CoapMessageOptionIterator iterator;
+    GG_CoapMessage_InitOptionIterator(message, GG_COAP_MESSAGE_OPTION_ITERATOR_FILTER_ANY, &iterator);
+    unsigned int option_count = 0;
+    uint32_t     last_number  = 0;
+    while (iterator.option.number) {
+        CHECK_TRUE(iterator.option.number >= last_number);
+        last_number = iterator.option.number;
+        ++option_count;
+        GG_CoapMessage_StepOptionIterator(message, &iterator);
+    }
+    LONGS_EQUAL(path_count + 3, option_count);
+    LONGS_EQUAL(GG_COAP_MESSAGE_OPTION_TYPE_EMPTY, iterator.option.type);
+
+    // iterate over some of the options
+    GG_CoapMessage_InitOptionIterator(message, GG_COAP_MESSAGE_OPTION_URI_PATH, &iterator);
+    option_count = 0;
+    while (iterator.option.number) {
+        LONGS_EQUAL(GG_COAP_MESSAGE_OPTION_URI_PATH, iterator.option.number);
+        LONGS_EQUAL('a' + option_count, iterator.option.value.string.chars[0]);
+        ++option_count;
+        GG_CoapMessage_StepOptionIterator(message, &iterator);
+    }
+    LONGS_EQUAL(path_count, option_count);
+    GG_CoapMessage_InitOptionIterator(message, GG_COAP_MESSAGE_OPTION_ETAG, &iterator);
+    LONGS_EQUAL(GG_COAP_MESSAGE_OPTION_NONE, iterator.option.number);
+}
+
+//----------------------------------------------------------------------
+TEST(GG_COAP, Test_OptionIndex) {
+    // messages with few options have all their options indexed, messages with many
+    // options don't, and the options should be found the same way in both cases
+    static const char path[] = "abcdefghijklmnopqrstuvwxyz";
+    const unsigned int path_counts[] = { 0, 1, 5, 25 };
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(path_counts); i++) {
+        GG_CoapMessageOptionParam options[28];
+        unsigned int path_count = path_counts[i];
+        memset(options, 0, sizeof(options));
+        for (unsigned int j = 0; j < path_count; j++) {
+            options[j].option.number = GG_COAP_MESSAGE_OPTION_URI_PATH;
+            options[j].option.type   = GG_COAP_MESSAGE_OPTION_TYPE_STRING;
+            options[j].option.value.string.chars  = &path[j];
+            options[j].option.value.string.length = 1;
+        }
+        options[path_count].option.number         = GG_COAP_MESSAGE_OPTION_BLOCK2;
+        options[path_count].option.type           = GG_COAP_MESSAGE_OPTION_TYPE_UINT;
+        options[path_count].option.value.uint     = 0x1234;
+        options[path_count + 1].option.number     = 5000;
+        options[path_count + 1].option.type       = GG_COAP_MESSAGE_OPTION_TYPE_OPAQUE;
+        options[path_count + 2].option.number     = GG_COAP_MESSAGE_OPTION_CONTENT_FORMAT;
+        options[path_count + 2].option.type       = GG_COAP_MESSAGE_OPTION_TYPE_UINT;
+        options[path_count + 2].option.value.uint = 0;
+
+        // check a created message
+        GG_CoapMessage* message = NULL;
+        uint8_t payload[3] = { 1, 2, 3 };
+        GG_Result result = GG_CoapMessage_Create(GG_COAP_METHOD_GET,
+                                                 GG_COAP_MESSAGE_TYPE_CON,
+                                                 options, path_count + 3,
+                                                 1, NULL, 0,
+                                                 payload, sizeof(payload),
+                                                 &message);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        CheckPathOptions(message, path_count);
+
+        // check a parsed message
+        GG_Buffer* datagram = NULL;
+        GG_CoapMessage_ToDatagram(message, &datagram);
+        GG_CoapMessage_Destroy(message);
+        result = GG_CoapMessage_CreateFromDatagram(datagram, &message);
+        GG_Buffer_Release(datagram);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        CheckPathOptions(message, path_count);
+        LONGS_EQUAL(sizeof(payload), GG_CoapMessage_GetPayloadSize(message));
+        MEMCMP_EQUAL(payload, GG_CoapMessage_GetPayload(message), sizeof(payload));
+        GG_CoapMessage_Destroy(message);
+    }
+}
@@ -0,0 +1,651 @@
+// Copyright 2017-2020 Fitbit, Inc
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <string.h>
+
+#include "xp/common/gg_io.h"
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_buffer.h"
+#include "xp/common/gg_memory.h"
+#include "xp/common/gg_utils.h"
+#include "xp/coap/gg_coap.h"
+#include "xp/coap/gg_coap_message.h"
+#include "xp/coap/gg_coap_observe.h"
+#include "xp/sockets/gg_sockets.h"
+#include "xp/utils/gg_async_pipe.h"
+
+/*----------------------------------------------------------------------
+|   tests
++---------------------------------------------------------------------*/
+TEST_GROUP(GG_COAP_OBSERVE) {
+    void setup(void) {
+    }
+
+    void teardown(void) {
+    }
+};
+
+//----------------------------------------------------------------------
+// Sink that keeps the last datagram it receives
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    unsigned int receive_count;
+    GG_Buffer*   last_received_buffer;
+} CaptureSink;
+
+static GG_Result
+CaptureSink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    CaptureSink* self = GG_SELF(CaptureSink, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+
+    if (self->last_received_buffer) {
+        GG_Buffer_Release(self->last_received_buffer);
+    }
+    self->last_received_buffer = GG_Buffer_Retain(data);
+    ++self->receive_count;
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+CaptureSink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    GG_COMPILER_UNUSED(_self);
+    GG_COMPILER_UNUSED(listener);
+
+    return GG_SUCCESS;
+}
+
+GG_IMPLEMENT_INTERFACE(CaptureSink, GG_DataSink) {
+    CaptureSink_PutData,
+    CaptureSink_SetListener
+};
+
+static void
+CaptureSink_Cleanup(CaptureSink* self)
+{
+    if (self->last_received_buffer) {
+        GG_Buffer_Release(self->last_received_buffer);
+        self->last_received_buffer = NULL;
+    }
+}
+
+// parse the last datagram received by a sink
+static GG_CoapMessage*
+CaptureSink_GetLastMessage(CaptureSink* self)
+{
+    GG_CoapMessage* message = NULL;
+    GG_Result result = GG_CoapMessage_CreateFromDatagram(self->last_received_buffer, &message);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    return message;
+}
+
+//----------------------------------------------------------------------
+// Handler for an observable resource, with a 1-byte state
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapRequestHandler);
+
+    GG_CoapObservable* observable;
+    uint8_t            state;
+} ObservableHandler;
+
+static GG_Result
+ObservableHandler_OnRequest(GG_CoapRequestHandler*   _self,
+                            GG_CoapEndpoint*         endpoint,
+                            const GG_CoapMessage*    request,
+                            GG_CoapResponder*        responder,
+                            const GG_BufferMetadata* transport_metadata,
+                            GG_CoapMessage**         response)
+{
+    ObservableHandler* self = GG_SELF(ObservableHandler, GG_CoapRequestHandler);
+    GG_COMPILER_UNUSED(responder);
+
+    GG_CoapMessageOptionParam observe_option;
+    size_t                    observe_option_count = 0;
+    GG_Result result = GG_CoapObservable_OnRequest(self->observable,
+                                                   request,
+                                                   transport_metadata,
+                                                   &observe_option,
+                                                   &observe_option_count);
+    if (GG_FAILED(result)) {
+        return result;
+    }
+
+    return GG_CoapEndpoint_CreateResponse(endpoint,
+                                          request,
+                                          GG_COAP_MESSAGE_CODE_CONTENT,
+                                          &observe_option,
+                                          observe_option_count,
+                                          &self->state,
+                                          1,
+                                          response);
+}
+
+GG_IMPLEMENT_INTERFACE(ObservableHandler, GG_CoapRequestHandler) {
+    .OnRequest = ObservableHandler_OnRequest
+};
+
+//----------------------------------------------------------------------
+// Listener that records the notifications it receives
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_CoapResponseListener);
+
+    unsigned int ack_count;
+    unsigned int response_count;
+    uint8_t      last_code;
+    uint8_t      last_state;
+    bool         last_observing;
+    uint32_t     last_sequence_number;
+    GG_Result    last_error;
+} NotificationListener;
+
+static void
+NotificationListener_OnAck(GG_CoapResponseListener* _self)
+{
+    NotificationListener* self = GG_SELF(NotificationListener, GG_CoapResponseListener);
+
+    ++self->ack_count;
+}
+
+static void
+NotificationListener_OnError(GG_CoapResponseListener* _self, GG_Result error, const char* message)
+{
+    NotificationListener* self = GG_SELF(NotificationListener, GG_CoapResponseListener);
+    GG_COMPILER_UNUSED(message);
+
+    self->last_error = error;
+}
+
+static void
+NotificationListener_OnResponse(GG_CoapResponseListener* _self, GG_CoapMessage* response)
+{
+    NotificationListener* self = GG_SELF(NotificationListener, GG_CoapResponseListener);
+
+    ++self->response_count;
+    self->last_code  = GG_CoapMessage_GetCode(response);
+    self->last_state = GG_CoapMessage_GetPayloadSize(response) ? GG_CoapMessage_GetPayload(response)[0] : 0;
+
+    GG_CoapMessageOption option;
+    GG_Result result = GG_CoapMessage_GetOption(response, GG_COAP_MESSAGE_OPTION_OBSERVE, &option, 0);
+    self->last_observing = GG_SUCCEEDED(result);
+    if (self->last_observing) {
+        self->last_sequence_number = option.value.uint;
+    }
+}
+
+GG_IMPLEMENT_INTERFACE(NotificationListener, GG_CoapResponseListener) {
+    .OnAck      = NotificationListener_OnAck,
+    .OnError    = NotificationListener_OnError,
+    .OnResponse = NotificationListener_OnResponse
+};
+
+static void
+NotificationListener_Init(NotificationListener* self)
+{
+    memset(self, 0, sizeof(*self));
+    GG_SET_INTERFACE(self, NotificationListener, GG_CoapResponseListener);
+}
+
+//----------------------------------------------------------------------
+// Advance the time of two schedulers, one ms at a time
+//----------------------------------------------------------------------
+static void
+RunSchedulers(GG_TimerScheduler* scheduler1,
+              uint32_t*          now1,
+              GG_TimerScheduler* scheduler2,
+              uint32_t*          now2,
+              unsigned int       steps)
+{
+    for (unsigned int i = 0; i < steps; i++) {
+        GG_TimerScheduler_SetTime(scheduler1, ++*now1);
+        GG_TimerScheduler_SetTime(scheduler2, ++*now2);
+    }
+}
+
+//----------------------------------------------------------------------
+TEST(GG_COAP_OBSERVE, Test_ObserveNotifications) {
+    GG_Result result;
+
+    // create two endpoints, connected with async pipes
+    GG_TimerScheduler* timer_scheduler1 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler1);
+    GG_CoapEndpoint* endpoint1;
+    GG_CoapEndpoint_Create(timer_scheduler1, NULL, NULL, &endpoint1);
+    GG_TimerScheduler* timer_scheduler2 = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler2);
+    GG_CoapEndpoint* endpoint2;
+    GG_CoapEndpoint_Create(timer_scheduler2, NULL, NULL, &endpoint2);
+    GG_AsyncPipe* pipe1 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler1, 1, &pipe1);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_AsyncPipe* pipe2 = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler2, 1, &pipe2);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), GG_AsyncPipe_AsDataSink(pipe1));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), GG_CoapEndpoint_AsDataSink(endpoint2));
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), GG_AsyncPipe_AsDataSink(pipe2));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), GG_CoapEndpoint_AsDataSink(endpoint1));
+
+    // create an observable resource on endpoint2
+    ObservableHandler handler;
+    memset(&handler, 0, sizeof(handler));
+    GG_SET_INTERFACE(&handler, ObservableHandler, GG_CoapRequestHandler);
+    result = GG_CoapObservable_Create(endpoint2, &handler.observable);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    handler.state = 1;
+    result = GG_CoapEndpoint_RegisterRequestHandler(endpoint2,
+                                                    "sensor",
+                                                    GG_COAP_REQUEST_HANDLER_FLAG_ALLOW_GET,
+                                                    GG_CAST(&handler, GG_CoapRequestHandler));
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // observe it twice from endpoint1
+    NotificationListener listener1;
+    NotificationListener_Init(&listener1);
+    NotificationListener listener2;
+    NotificationListener_Init(&listener2);
+    GG_CoapMessageOptionParam options1[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "sensor")
+    };
+    GG_CoapRequestHandle handle1 = GG_COAP_INVALID_REQUEST_HANDLE;
+    result = GG_CoapEndpoint_SendObserveRequest(endpoint1,
+                                                options1,
+                                                GG_ARRAY_SIZE(options1),
+                                                NULL,
+                                                GG_CAST(&listener1, GG_CoapResponseListener),
+                                                &handle1);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    CHECK_FALSE(handle1 == GG_COAP_INVALID_REQUEST_HANDLE);
+    GG_CoapMessageOptionParam options2[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "sensor")
+    };
+    GG_CoapRequestHandle handle2 = GG_COAP_INVALID_REQUEST_HANDLE;
+    result = GG_CoapEndpoint_SendObserveRequest(endpoint1,
+                                                options2,
+                                                GG_ARRAY_SIZE(options2),
+                                                NULL,
+                                                GG_CAST(&listener2, GG_CoapResponseListener),
+                                                &handle2);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    CHECK_FALSE(handle2 == handle1);
+
+    uint32_t now1 = 0;
+    uint32_t now2 = 0;
+    RunSchedulers(timer_scheduler1, &now1, timer_scheduler2, &now2, 10);
+    LONGS_EQUAL(2, GG_CoapObservable_GetObserverCount(handler.observable));
+    LONGS_EQUAL(1, listener1.response_count);
+    CHECK_TRUE(listener1.last_observing);
+    LONGS_EQUAL(1, listener1.last_state);
+    LONGS_EQUAL(1, listener2.response_count);
+    CHECK_TRUE(listener2.last_observing);
+
+    // notify a few times, both observers should get all the notifications
+    for (uint8_t state = 2; state <= 4; state++) {
+        handler.state = state;
+        result = GG_CoapObservable_Notify(handler.observable,
+                                          GG_COAP_MESSAGE_CODE_CONTENT,
+                                          NULL, 0,
+                                          &handler.state, 1);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        RunSchedulers(timer_scheduler1, &now1, timer_scheduler2, &now2, 10);
+        LONGS_EQUAL(state, listener1.response_count);
+        LONGS_EQUAL(state, listener1.last_state);
+        LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CONTENT, listener1.last_code);
+        LONGS_EQUAL(state, listener2.response_count);
+        LONGS_EQUAL(state, listener2.last_state);
+    }
+    LONGS_EQUAL(3, listener1.last_sequence_number);
+
+    // cancel the first observation, the next notification should remove it from the observers
+    result = GG_CoapEndpoint_CancelObservation(endpoint1, handle1);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_CoapEndpoint_CancelObservation(endpoint1, handle1);
+    LONGS_EQUAL(GG_ERROR_NO_SUCH_ITEM, result);
+    handler.state = 5;
+    result = GG_CoapObservable_Notify(handler.observable, GG_COAP_MESSAGE_CODE_CONTENT, NULL, 0, &handler.state, 1);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    RunSchedulers(timer_scheduler1, &now1, timer_scheduler2, &now2, 10);
+    LONGS_EQUAL(4, listener1.response_count);
+    LONGS_EQUAL(5, listener2.response_count);
+    LONGS_EQUAL(1, GG_CoapObservable_GetObserverCount(handler.observable));
+
+    // an error notification ends the observation
+    result = GG_CoapObservable_Notify(handler.observable, GG_COAP_MESSAGE_CODE_NOT_FOUND, NULL, 0, NULL, 0);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, GG_CoapObservable_GetObserverCount(handler.observable));
+    RunSchedulers(timer_scheduler1, &now1, timer_scheduler2, &now2, 10);
+    LONGS_EQUAL(6, listener2.response_count);
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_NOT_FOUND, listener2.last_code);
+    CHECK_FALSE(listener2.last_observing);
+    result = GG_CoapEndpoint_CancelObservation(endpoint1, handle2);
+    LONGS_EQUAL(GG_ERROR_NO_SUCH_ITEM, result);
+
+    // a plain GET doesn't register an observer
+    result = GG_CoapEndpoint_SendRequest(endpoint1,
+                                         GG_COAP_METHOD_GET,
+                                         options1, GG_ARRAY_SIZE(options1),
+                                         NULL, 0,
+                                         NULL,
+                                         GG_CAST(&listener1, GG_CoapResponseListener),
+                                         NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    RunSchedulers(timer_scheduler1, &now1, timer_scheduler2, &now2, 10);
+    LONGS_EQUAL(5, listener1.response_count);
+    CHECK_FALSE(listener1.last_observing);
+    LONGS_EQUAL(0, GG_CoapObservable_GetObserverCount(handler.observable));
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint1), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe1), NULL);
+    GG_DataSource_SetDataSink(GG_CoapEndpoint_AsDataSource(endpoint2), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe2), NULL);
+    GG_CoapObservable_Destroy(handler.observable);
+    GG_CoapEndpoint_Destroy(endpoint1);
+    GG_CoapEndpoint_Destroy(endpoint2);
+    GG_AsyncPipe_Destroy(pipe1);
+    GG_AsyncPipe_Destroy(pipe2);
+    GG_TimerScheduler_Destroy(timer_scheduler1);
+    GG_TimerScheduler_Destroy(timer_scheduler2);
+}
+
+//----------------------------------------------------------------------
+TEST(GG_COAP_OBSERVE, Test_ObservableRegistration) {
+    GG_Result result;
+
+    GG_TimerScheduler* timer_scheduler = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler);
+    CaptureSink sink;
+    memset(&sink, 0, sizeof(sink));
+    GG_SET_INTERFACE(&sink, CaptureSink, GG_DataSink);
+    GG_CoapEndpoint* endpoint;
+    GG_CoapEndpoint_Create(timer_scheduler, GG_CAST(&sink, GG_DataSink), NULL, &endpoint);
+    GG_CoapObservable* observable = NULL;
+    result = GG_CoapObservable_Create(endpoint, &observable);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // a registration from a peer
+    GG_SocketAddressMetadata peer;
+    memset(&peer, 0, sizeof(peer));
+    peer.base.type = GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS;
+    peer.base.size = sizeof(peer);
+    GG_IpAddress_SetFromString(&peer.socket_address.address, "10.0.0.1");
+    peer.socket_address.port = 5683;
+    uint8_t token[2] = { 1, 2 };
+    GG_CoapMessageOptionParam register_options[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_UINT(OBSERVE, GG_COAP_OBSERVE_REGISTER)
+    };
+    GG_CoapMessage* request = NULL;
+    result = GG_CoapMessage_Create(GG_COAP_METHOD_GET, GG_COAP_MESSAGE_TYPE_CON,
+                                   register_options, GG_ARRAY_SIZE(register_options),
+                                   1, token, sizeof(token), NULL, 0, &request);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapMessageOptionParam observe_option;
+    size_t                    observe_option_count = 0;
+    result = GG_CoapObservable_OnRequest(observable, request, &peer.base, &observe_option, &observe_option_count);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, observe_option_count);
+    LONGS_EQUAL(GG_COAP_MESSAGE_OPTION_OBSERVE, observe_option.option.number);
+    LONGS_EQUAL(1, GG_CoapObservable_GetObserverCount(observable));
+
+    // registering again only refreshes the registration
+    result = GG_CoapObservable_OnRequest(observable, request, &peer.base, &observe_option, &observe_option_count);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, observe_option_count);
+    LONGS_EQUAL(1, GG_CoapObservable_GetObserverCount(observable));
+
+    // the same token from another peer is another observer
+    result = GG_CoapObservable_OnRequest(observable, request, NULL, &observe_option, &observe_option_count);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, observe_option_count);
+    LONGS_EQUAL(2, GG_CoapObservable_GetObserverCount(observable));
+    GG_CoapMessage_Destroy(request);
+
+    // notifications go to each observer, with its token
+    uint8_t payload[3] = { 7, 8, 9 };
+    result = GG_CoapObservable_Notify(observable, GG_COAP_MESSAGE_CODE_CONTENT, NULL, 0, payload, sizeof(payload));
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(2, sink.receive_count);
+    GG_CoapMessage* notification = CaptureSink_GetLastMessage(&sink);
+    LONGS_EQUAL(GG_COAP_MESSAGE_CODE_CONTENT, GG_CoapMessage_GetCode(notification));
+    LONGS_EQUAL(GG_COAP_MESSAGE_TYPE_NON, GG_CoapMessage_GetType(notification));
+    uint8_t notification_token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    LONGS_EQUAL(sizeof(token), GG_CoapMessage_GetToken(notification, notification_token));
+    MEMCMP_EQUAL(token, notification_token, sizeof(token));
+    GG_CoapMessageOption option;
+    result = GG_CoapMessage_GetOption(notification, GG_COAP_MESSAGE_OPTION_OBSERVE, &option, 0);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, option.value.uint);
+    LONGS_EQUAL(sizeof(payload), GG_CoapMessage_GetPayloadSize(notification));
+    MEMCMP_EQUAL(payload, GG_CoapMessage_GetPayload(notification), sizeof(payload));
+    GG_CoapMessage_Destroy(notification);
+
+    // a deregistration removes the observer
+    GG_CoapMessageOptionParam deregister_options[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_UINT(OBSERVE, GG_COAP_OBSERVE_DEREGISTER)
+    };
+    result = GG_CoapMessage_Create(GG_COAP_METHOD_GET, GG_COAP_MESSAGE_TYPE_CON,
+                                   deregister_options, GG_ARRAY_SIZE(deregister_options),
+                                   2, token, sizeof(token), NULL, 0, &request);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_CoapObservable_OnRequest(observable, request, &peer.base, &observe_option, &observe_option_count);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, observe_option_count);
+    LONGS_EQUAL(1, GG_CoapObservable_GetObserverCount(observable));
+    GG_CoapMessage_Destroy(request);
+
+    // the list of observers is bounded
+    for (uint8_t i = 0; i < GG_CONFIG_COAP_OBSERVE_MAX_OBSERVERS; i++) {
+        result = GG_CoapMessage_Create(GG_COAP_METHOD_GET, GG_COAP_MESSAGE_TYPE_CON,
+                                       register_options, GG_ARRAY_SIZE(register_options),
+                                       3 + i, &i, 1, NULL, 0, &request);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        result = GG_CoapObservable_OnRequest(observable, request, &peer.base, &observe_option, &observe_option_count);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        LONGS_EQUAL(i < GG_CONFIG_COAP_OBSERVE_MAX_OBSERVERS - 1 ? 1 : 0, observe_option_count);
+        GG_CoapMessage_Destroy(request);
+    }
+    LONGS_EQUAL(GG_CONFIG_COAP_OBSERVE_MAX_OBSERVERS, GG_CoapObservable_GetObserverCount(observable));
+
+    // cleanup
+    GG_CoapObservable_Destroy(observable);
+    GG_CoapEndpoint_Destroy(endpoint);
+    CaptureSink_Cleanup(&sink);
+    GG_TimerScheduler_Destroy(timer_scheduler);
+}
+
+//----------------------------------------------------------------------
+TEST(GG_COAP_OBSERVE, Test_ConfirmableNotifications) {
+    GG_Result result;
+
+    GG_TimerScheduler* timer_scheduler = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler);
+    CaptureSink sink;
+    memset(&sink, 0, sizeof(sink));
+    GG_SET_INTERFACE(&sink, CaptureSink, GG_DataSink);
+    GG_CoapEndpoint* endpoint;
+    GG_CoapEndpoint_Create(timer_scheduler, GG_CAST(&sink, GG_DataSink), NULL, &endpoint);
+    GG_CoapObservable* observable = NULL;
+    result = GG_CoapObservable_Create(endpoint, &observable);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // register an observer
+    uint8_t token[1] = { 1 };
+    GG_CoapMessageOptionParam register_options[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_UINT(OBSERVE, GG_COAP_OBSERVE_REGISTER)
+    };
+    GG_CoapMessage* request = NULL;
+    result = GG_CoapMessage_Create(GG_COAP_METHOD_GET, GG_COAP_MESSAGE_TYPE_CON,
+                                   register_options, GG_ARRAY_SIZE(register_options),
+                                   1, token, sizeof(token), NULL, 0, &request);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapMessageOptionParam observe_option;
+    size_t                    observe_option_count = 0;
+    result = GG_CoapObservable_OnRequest(observable, request, NULL, &observe_option, &observe_option_count);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapMessage_Destroy(request);
+
+    // notify until a notification is sent as CON
+    GG_CoapMessage* notification = NULL;
+    for (unsigned int i = 0; i < GG_CONFIG_COAP_OBSERVE_CON_INTERVAL; i++) {
+        result = GG_CoapObservable_Notify(observable, GG_COAP_MESSAGE_CODE_CONTENT, NULL, 0, NULL, 0);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        notification = CaptureSink_GetLastMessage(&sink);
+        LONGS_EQUAL(i == GG_CONFIG_COAP_OBSERVE_CON_INTERVAL - 1 ? GG_COAP_MESSAGE_TYPE_CON : GG_COAP_MESSAGE_TYPE_NON,
+                    GG_CoapMessage_GetType(notification));
+        if (i != GG_CONFIG_COAP_OBSERVE_CON_INTERVAL - 1) {
+            GG_CoapMessage_Destroy(notification);
+        }
+    }
+
+    // acknowledge it, it shouldn't be resent
+    GG_CoapMessage* ack = NULL;
+    result = GG_CoapMessage_Create(0, GG_COAP_MESSAGE_TYPE_ACK, NULL, 0,
+                                   GG_CoapMessage_GetMessageId(notification),
+                                   NULL, 0, NULL, 0, &ack);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_CoapMessage_Destroy(notification);
+    GG_Buffer* ack_datagram = NULL;
+    GG_CoapMessage_ToDatagram(ack, &ack_datagram);
+    GG_CoapMessage_Destroy(ack);
+    result = GG_DataSink_PutData(GG_CoapEndpoint_AsDataSink(endpoint), ack_datagram, NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer_Release(ack_datagram);
+    unsigned int receive_count = sink.receive_count;
+    GG_TimerScheduler_SetTime(timer_scheduler, 100000);
+    LONGS_EQUAL(receive_count, sink.receive_count);
+    LONGS_EQUAL(1, GG_CoapObservable_GetObserverCount(observable));
+
+    // the next CON notification isn't acknowledged, it should be resent, and the observer removed
+    for (unsigned int i = 0; i < GG_CONFIG_COAP_OBSERVE_CON_INTERVAL; i++) {
+        result = GG_CoapObservable_Notify(observable, GG_COAP_MESSAGE_CODE_CONTENT, NULL, 0, NULL, 0);
+        LONGS_EQUAL(GG_SUCCESS, result);
+    }
+    receive_count = sink.receive_count;
+    uint32_t now = 100000;
+    for (unsigned int i = 0; i < 1000; i++) {
+        now += 1000;
+        GG_TimerScheduler_SetTime(timer_scheduler, now);
+    }
+    LONGS_EQUAL(receive_count + GG_COAP_DEFAULT_MAX_RETRANSMIT, sink.receive_count);
+    LONGS_EQUAL(0, GG_CoapObservable_GetObserverCount(observable));
+
+    // cleanup
+    GG_CoapObservable_Destroy(observable);
+    GG_CoapEndpoint_Destroy(endpoint);
+    CaptureSink_Cleanup(&sink);
+    GG_TimerScheduler_Destroy(timer_scheduler);
+}
+
+//----------------------------------------------------------------------
+TEST(GG_COAP_OBSERVE, Test_NotificationOrdering) {
+    GG_Result result;
+
+    GG_TimerScheduler* timer_scheduler = NULL;
+    GG_TimerScheduler_Create(&timer_scheduler);
+    CaptureSink sink;
+    memset(&sink, 0, sizeof(sink));
+    GG_SET_INTERFACE(&sink, CaptureSink, GG_DataSink);
+    GG_CoapEndpoint* endpoint;
+    GG_CoapEndpoint_Create(timer_scheduler, GG_CAST(&sink, GG_DataSink), NULL, &endpoint);
+    GG_DataSink* endpoint_sink = GG_CoapEndpoint_AsDataSink(endpoint);
+
+    // send a registration request
+    NotificationListener listener;
+    NotificationListener_Init(&listener);
+    GG_CoapMessageOptionParam options[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_STRING(URI_PATH, "sensor")
+    };
+    result = GG_CoapEndpoint_SendObserveRequest(endpoint,
+                                                options, GG_ARRAY_SIZE(options),
+                                                NULL,
+                                                GG_CAST(&listener, GG_CoapResponseListener),
+                                                NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, sink.receive_count);
+    GG_CoapMessage* request = CaptureSink_GetLastMessage(&sink);
+    GG_CoapMessageOption option;
+    result = GG_CoapMessage_GetOption(request, GG_COAP_MESSAGE_OPTION_OBSERVE, &option, 0);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(GG_COAP_OBSERVE_REGISTER, option.value.uint);
+    uint8_t token[GG_COAP_MESSGAGE_MAX_TOKEN_LENGTH];
+    size_t  token_length = GG_CoapMessage_GetToken(request, token);
+
+    // respond, and send notifications, some of them out of order
+    const uint32_t sequence_numbers[] = { 10, 12, 11, 0x800000, 0xFFFFFF, 2 };
+    const bool     delivered[]        = { true, true, false, true, true, true };
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(sequence_numbers); i++) {
+        GG_CoapMessageOptionParam observe_options[1] = {
+            GG_COAP_MESSAGE_OPTION_PARAM_UINT(OBSERVE, sequence_numbers[i])
+        };
+        uint8_t state = (uint8_t)i;
+        GG_CoapMessage* message = NULL;
+        result = GG_CoapMessage_Create(GG_COAP_MESSAGE_CODE_CONTENT,
+                                       i == 0 ? GG_COAP_MESSAGE_TYPE_ACK : GG_COAP_MESSAGE_TYPE_NON,
+                                       observe_options, GG_ARRAY_SIZE(observe_options),
+                                       i == 0 ? GG_CoapMessage_GetMessageId(request) : (uint16_t)(100 + i),
+                                       token, token_length,
+                                       &state, 1,
+                                       &message);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        GG_Buffer* datagram = NULL;
+        GG_CoapMessage_ToDatagram(message, &datagram);
+        GG_CoapMessage_Destroy(message);
+        unsigned int response_count = listener.response_count;
+        result = GG_DataSink_PutData(endpoint_sink, datagram, NULL);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        GG_Buffer_Release(datagram);
+        LONGS_EQUAL(response_count + (delivered[i] ? 1 : 0), listener.response_count);
+        if (delivered[i]) {
+            LONGS_EQUAL(i, listener.last_state);
+        }
+    }
+    GG_CoapMessage_Destroy(request);
+
+    // CON notifications are acknowledged
+    GG_CoapMessageOptionParam observe_options[1] = {
+        GG_COAP_MESSAGE_OPTION_PARAM_UINT(OBSERVE, 3)
+    };
+    GG_CoapMessage* message = NULL;
+    result = GG_CoapMessage_Create(GG_COAP_MESSAGE_CODE_CONTENT, GG_COAP_MESSAGE_TYPE_CON,
+                                   observe_options, GG_ARRAY_SIZE(observe_options),
+                                   200, token, token_length, NULL, 0, &message);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* datagram = NULL;
+    GG_CoapMessage_ToDatagram(message, &datagram);
+    GG_CoapMessage_Destroy(message);
+    result = GG_DataSink_PutData(endpoint_sink, datagram, NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* con_datagram = datagram;
+    GG_CoapMessage* ack = CaptureSink_GetLastMessage(&sink);
+    LONGS_EQUAL(GG_COAP_MESSAGE_TYPE_ACK, GG_CoapMessage_GetType(ack));
+    LONGS_EQUAL(0, GG_CoapMessage_GetCode(ack));
+    LONGS_EQUAL(200, GG_CoapMessage_GetMessageId(ack));
+    GG_CoapMessage_Destroy(ack);
+
+    // once the observations are gone, notifications are rejected
+    GG_CoapEndpoint_DestroyObservations(endpoint);
+    result = GG_DataSink_PutData(endpoint_sink, con_datagram, NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer_Release(con_datagram);
+    GG_CoapMessage* rst = CaptureSink_GetLastMessage(&sink);
+    LONGS_EQUAL(GG_COAP_MESSAGE_TYPE_RST, GG_CoapMessage_GetType(rst));
+    LONGS_EQUAL(200, GG_CoapMessage_GetMessageId(rst));
+    GG_CoapMessage_Destroy(rst);
+
+    // cleanup
+    GG_CoapEndpoint_Destroy(endpoint);
+    CaptureSink_Cleanup(&sink);
+    GG_TimerScheduler_Destroy(timer_scheduler);
+}
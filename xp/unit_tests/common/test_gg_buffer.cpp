@@ -4,6 +4,8 @@
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
+#include <string.h>
+
 #include "CppUTest/TestHarness.h"
 #include "CppUTestExt/MockSupport.h"
 
@@ -86,3 +88,129 @@ TEST(GG_BUFFER, Test_DynamicBuffer_SetBuffer) {
 
     GG_DynamicBuffer_Release(buf);
 }
+
+TEST(GG_BUFFER, Test_BufferPool) {
+    GG_BufferPool* pool = NULL;
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferPool_Create(64, 2, &pool));
+    CHECK_EQUAL(64, GG_BufferPool_GetBufferSize(pool));
+
+    GG_BufferPoolStats stats;
+    GG_BufferPool_GetStats(pool, &stats);
+    CHECK_EQUAL(0, stats.buffers_in_use);
+    CHECK_EQUAL(0, stats.buffers_high_water);
+    CHECK_EQUAL(0, stats.miss_count);
+
+    // allocate from the pool
+    GG_DynamicBuffer* buf1 = NULL;
+    GG_DynamicBuffer* buf2 = NULL;
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferPool_AllocateBuffer(pool, 64, &buf1));
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferPool_AllocateBuffer(pool, 10, &buf2));
+    CHECK_EQUAL(64, GG_DynamicBuffer_GetBufferSize(buf1));
+    CHECK_EQUAL(0, GG_DynamicBuffer_GetDataSize(buf1));
+    GG_BufferPool_GetStats(pool, &stats);
+    CHECK_EQUAL(2, stats.buffers_in_use);
+    CHECK_EQUAL(2, stats.buffers_high_water);
+    CHECK_EQUAL(0, stats.miss_count);
+
+    // the pool is empty, this should fall back to the heap
+    GG_DynamicBuffer* buf3 = NULL;
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferPool_AllocateBuffer(pool, 8, &buf3));
+    GG_BufferPool_GetStats(pool, &stats);
+    CHECK_EQUAL(2, stats.buffers_in_use);
+    CHECK_EQUAL(1, stats.miss_count);
+    GG_DynamicBuffer_Release(buf3);
+
+    // a buffer that's retained isn't returned until the last reference is released
+    GG_DynamicBuffer_Retain(buf1);
+    GG_DynamicBuffer_Release(buf1);
+    GG_BufferPool_GetStats(pool, &stats);
+    CHECK_EQUAL(2, stats.buffers_in_use);
+    GG_DynamicBuffer_Release(buf1);
+    GG_BufferPool_GetStats(pool, &stats);
+    CHECK_EQUAL(1, stats.buffers_in_use);
+
+    // the returned buffer is reused
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferPool_AllocateBuffer(pool, 64, &buf1));
+    GG_BufferPool_GetStats(pool, &stats);
+    CHECK_EQUAL(2, stats.buffers_in_use);
+    CHECK_EQUAL(2, stats.buffers_high_water);
+    CHECK_EQUAL(1, stats.miss_count);
+
+    // requests larger than the pool's buffer size are a miss
+    GG_DynamicBuffer_Release(buf2);
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferPool_AllocateBuffer(pool, 65, &buf2));
+    CHECK_TRUE(GG_DynamicBuffer_GetBufferSize(buf2) >= 65);
+    GG_BufferPool_GetStats(pool, &stats);
+    CHECK_EQUAL(1, stats.buffers_in_use);
+    CHECK_EQUAL(2, stats.miss_count);
+    GG_DynamicBuffer_Release(buf2);
+
+    // a pooled buffer can grow beyond the pool's buffer size
+    uint8_t data[100];
+    memset(data, 0x5A, sizeof(data));
+    CHECK_EQUAL(GG_SUCCESS, GG_DynamicBuffer_SetData(buf1, data, sizeof(data)));
+    CHECK_EQUAL(sizeof(data), GG_DynamicBuffer_GetDataSize(buf1));
+    MEMCMP_EQUAL(data, GG_DynamicBuffer_GetData(buf1), sizeof(data));
+
+    // destroying the pool with an outstanding buffer is deferred
+    GG_BufferPool_Destroy(pool);
+    MEMCMP_EQUAL(data, GG_DynamicBuffer_GetData(buf1), sizeof(data));
+    GG_DynamicBuffer_Release(buf1);
+}
+
+TEST(GG_BUFFER, Test_BufferChain) {
+    GG_BufferChain* chain = NULL;
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferChain_Create(8, &chain));
+    CHECK_EQUAL(0, GG_Buffer_GetDataSize(GG_BufferChain_AsBuffer(chain)));
+    CHECK_EQUAL(0, GG_BufferChain_GetSegmentCount(chain));
+    POINTERS_EQUAL(chain, GG_BufferChain_FromBuffer(GG_BufferChain_AsBuffer(chain)));
+
+    // append a payload, without copying it
+    GG_DynamicBuffer* payload = NULL;
+    CHECK_EQUAL(GG_SUCCESS, GG_DynamicBuffer_Create(0, &payload));
+    GG_DynamicBuffer_SetData(payload, (const uint8_t*)"world", 5);
+    POINTERS_EQUAL(NULL, GG_BufferChain_FromBuffer(GG_DynamicBuffer_AsBuffer(payload)));
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferChain_AppendBuffer(chain, GG_DynamicBuffer_AsBuffer(payload)));
+    CHECK_EQUAL(1, GG_BufferChain_GetSegmentCount(chain));
+    POINTERS_EQUAL(GG_DynamicBuffer_GetData(payload), GG_Buffer_GetData(GG_BufferChain_AsBuffer(chain)));
+
+    // prepend two headers
+    uint8_t* header = NULL;
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferChain_Prepend(chain, 1, &header));
+    header[0] = ' ';
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferChain_Prepend(chain, 5, &header));
+    memcpy(header, "hello", 5);
+    CHECK_EQUAL(GG_ERROR_NOT_ENOUGH_SPACE, GG_BufferChain_Prepend(chain, 3, &header));
+    CHECK_EQUAL(11, GG_Buffer_GetDataSize(GG_BufferChain_AsBuffer(chain)));
+    CHECK_EQUAL(2, GG_BufferChain_GetSegmentCount(chain));
+    size_t segment_size = 0;
+    const uint8_t* segment = GG_BufferChain_GetSegment(chain, 0, &segment_size);
+    CHECK_EQUAL(6, segment_size);
+    MEMCMP_EQUAL("hello ", segment, 6);
+    segment = GG_BufferChain_GetSegment(chain, 1, &segment_size);
+    CHECK_EQUAL(5, segment_size);
+    POINTERS_EQUAL(GG_DynamicBuffer_GetData(payload), segment);
+
+    // gather a range
+    uint8_t range[6];
+    CHECK_EQUAL(6, GG_BufferChain_CopyData(chain, 3, range, sizeof(range)));
+    MEMCMP_EQUAL("lo wor", range, 6);
+    CHECK_EQUAL(2, GG_BufferChain_CopyData(chain, 9, range, sizeof(range)));
+
+    // the data can be accessed contiguously
+    GG_Buffer* buffer = GG_BufferChain_AsBuffer(chain);
+    MEMCMP_EQUAL("hello world", GG_Buffer_GetData(buffer), 11);
+    POINTERS_EQUAL(NULL, GG_Buffer_UseData(buffer));
+
+    // a chain appended to another chain is flattened
+    GG_BufferChain* outer = NULL;
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferChain_Create(2, &outer));
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferChain_AppendBuffer(outer, buffer));
+    CHECK_EQUAL(GG_SUCCESS, GG_BufferChain_Prepend(outer, 2, &header));
+    memcpy(header, "> ", 2);
+    CHECK_EQUAL(3, GG_BufferChain_GetSegmentCount(outer));
+    GG_BufferChain_Release(chain);
+    GG_DynamicBuffer_Release(payload);
+    MEMCMP_EQUAL("> hello world", GG_Buffer_GetData(GG_BufferChain_AsBuffer(outer)), 13);
+    GG_Buffer_Release(GG_BufferChain_AsBuffer(outer));
+}
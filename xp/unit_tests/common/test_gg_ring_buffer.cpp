@@ -118,3 +118,36 @@ TEST(GG_RING_BUFFER, Test_RingBuffer_1) {
         ReadChunk(&ring);
     }
 }
+
+TEST(GG_RING_BUFFER, Test_RingBuffer_ContiguousData) {
+    GG_RingBuffer ring;
+    uint8_t buffer[8];
+
+    GG_RingBuffer_Init(&ring, buffer, sizeof(buffer));
+
+    // move the read position close to the end, then write data that wraps around
+    GG_RingBuffer_Write(&ring, (const uint8_t*)"xxxxx", 5);
+    GG_RingBuffer_MoveOut(&ring, 5);
+    GG_RingBuffer_Write(&ring, (const uint8_t*)"abcde", 5);
+
+    size_t size = 0;
+    const uint8_t* data = GG_RingBuffer_GetContiguousData(&ring, 0, &size);
+    CHECK_EQUAL(3, size);
+    MEMCMP_EQUAL("abc", data, size);
+
+    data = GG_RingBuffer_GetContiguousData(&ring, 1, &size);
+    CHECK_EQUAL(2, size);
+    MEMCMP_EQUAL("bc", data, size);
+
+    data = GG_RingBuffer_GetContiguousData(&ring, 3, &size);
+    CHECK_EQUAL(2, size);
+    MEMCMP_EQUAL("de", data, size);
+    CHECK_TRUE(data == buffer);
+
+    data = GG_RingBuffer_GetContiguousData(&ring, 4, &size);
+    CHECK_EQUAL(1, size);
+    CHECK_EQUAL('e', data[0]);
+
+    GG_RingBuffer_GetContiguousData(&ring, 5, &size);
+    CHECK_EQUAL(0, size);
+}
@@ -1,6 +1,8 @@
 // Copyright 2017-2020 Fitbit, Inc
 // SPDX-License-Identifier: Apache-2.0
 
+#include <string.h>
+
 #include "CppUTest/TestHarness.h"
 #include "CppUTestExt/MockSupport.h"
 
@@ -9,6 +11,7 @@
 extern "C" {
   #include "xp/common/gg_port.h"
   #include "xp/common/gg_timer.h"
+  #include "xp/common/gg_utils.h"
 }
 
 static GG_TimerListener timer1_listener;
@@ -80,3 +83,207 @@ TEST(GG_TIMER, Test_TimerGetRemainingTime) {
   GG_Timer_Destroy(timer);
   GG_TimerScheduler_Destroy(scheduler);
 }
+
+typedef struct {
+    GG_IMPLEMENTS(GG_TimerListener);
+
+    GG_Timer* timer;
+    uint32_t  fire_time;      // expected fire time
+    uint32_t  fired_at;       // scheduler time when the timer fired
+    uint32_t  fire_order;     // order in which the timer fired
+    uint32_t  reschedule_ms;  // if not 0, reschedule the timer when it fires
+    uint32_t* fire_counter;
+} RecordingTimer;
+
+static void
+RecordingTimer_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint32_t time_elapsed)
+{
+    RecordingTimer* self = GG_SELF(RecordingTimer, GG_TimerListener);
+    GG_COMPILER_UNUSED(time_elapsed);
+
+    self->fire_order = (*self->fire_counter)++;
+    if (self->reschedule_ms) {
+        self->fire_time += self->reschedule_ms;
+        GG_Timer_Schedule(timer, GG_CAST(self, GG_TimerListener), self->reschedule_ms);
+    }
+}
+
+GG_IMPLEMENT_INTERFACE(RecordingTimer, GG_TimerListener) {
+    RecordingTimer_OnTimerFired
+};
+
+static void
+RecordingTimer_Init(RecordingTimer* self, GG_TimerScheduler* scheduler, uint32_t* fire_counter)
+{
+    memset(self, 0, sizeof(*self));
+    self->fire_counter = fire_counter;
+    self->fired_at     = GG_TIMER_NEVER;
+    self->fire_order   = GG_TIMER_NEVER;
+    GG_SET_INTERFACE(self, RecordingTimer, GG_TimerListener);
+    GG_Result result = GG_TimerScheduler_CreateTimer(scheduler, &self->timer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+}
+
+static void
+RecordingTimer_Schedule(RecordingTimer* self, GG_TimerScheduler* scheduler, uint32_t ms_from_now)
+{
+    self->fire_time = GG_TimerScheduler_GetTime(scheduler) + ms_from_now;
+    GG_Result result = GG_Timer_Schedule(self->timer, GG_CAST(self, GG_TimerListener), ms_from_now);
+    LONGS_EQUAL(GG_SUCCESS, result);
+}
+
+TEST(GG_TIMER, Test_TimerPoolGrowth) {
+  GG_TimerScheduler* scheduler = NULL;
+  GG_Result result = GG_TimerScheduler_Create(&scheduler);
+  LONGS_EQUAL(GG_SUCCESS, result);
+
+  // create many more timers than the initial pool size
+  static GG_Timer* timers[1000];
+  for (unsigned int i = 0; i < 1000; i++) {
+      result = GG_TimerScheduler_CreateTimer(scheduler, &timers[i]);
+      LONGS_EQUAL(GG_SUCCESS, result);
+      CHECK(timers[i] != NULL);
+  }
+
+  // destroy half of them and check that they get recycled
+  for (unsigned int i = 0; i < 1000; i += 2) {
+      GG_Timer_Destroy(timers[i]);
+  }
+  for (unsigned int i = 0; i < 1000; i += 2) {
+      result = GG_TimerScheduler_CreateTimer(scheduler, &timers[i]);
+      LONGS_EQUAL(GG_SUCCESS, result);
+  }
+
+  GG_TimerScheduler_Destroy(scheduler);
+}
+
+TEST(GG_TIMER, Test_TimerOrdering) {
+  GG_TimerScheduler* scheduler = NULL;
+  GG_Result result = GG_TimerScheduler_Create(&scheduler);
+  LONGS_EQUAL(GG_SUCCESS, result);
+  GG_TimerScheduler_SetTime(scheduler, 12345);
+
+  // schedule timers with delays spanning several wheel levels, some with the same fire time
+  static RecordingTimer timers[500];
+  uint32_t fire_counter = 0;
+  uint32_t seed = 123456789;
+  for (unsigned int i = 0; i < GG_ARRAY_SIZE(timers); i++) {
+      RecordingTimer_Init(&timers[i], scheduler, &fire_counter);
+      seed = (1103515245 * seed + 12345);
+      uint32_t delay = (i % 10 == 0) ? 1000 : (seed >> 8) % (1 << (4 + i % 20));
+      RecordingTimer_Schedule(&timers[i], scheduler, delay);
+  }
+
+  // unschedule a few
+  for (unsigned int i = 3; i < GG_ARRAY_SIZE(timers); i += 50) {
+      GG_Timer_Unschedule(timers[i].timer);
+      CHECK_FALSE(GG_Timer_IsScheduled(timers[i].timer));
+  }
+
+  // advance the time by irregular steps until all timers have fired
+  uint32_t now = 12345;
+  uint32_t expected_fired = GG_ARRAY_SIZE(timers) - GG_ARRAY_SIZE(timers) / 50;
+  while (fire_counter < expected_fired) {
+      uint32_t next = GG_TimerScheduler_GetNextScheduledTime(scheduler);
+      CHECK(next != GG_TIMER_NEVER);
+
+      // the next scheduled time may never be later than the earliest timer
+      for (unsigned int i = 0; i < GG_ARRAY_SIZE(timers); i++) {
+          if (GG_Timer_IsScheduled(timers[i].timer)) {
+              CHECK(now + next <= timers[i].fire_time);
+          }
+      }
+
+      seed = (1103515245 * seed + 12345);
+      now += next + (seed >> 8) % 3;
+      uint32_t fired_before = fire_counter;
+      GG_TimerScheduler_SetTime(scheduler, now);
+      for (unsigned int i = 0; i < GG_ARRAY_SIZE(timers); i++) {
+          if (timers[i].fire_order >= fired_before && timers[i].fire_order < fire_counter) {
+              timers[i].fired_at = now;
+          }
+      }
+  }
+  LONGS_EQUAL(GG_TIMER_NEVER, GG_TimerScheduler_GetNextScheduledTime(scheduler));
+
+  // check that each timer fired on time, and in order of fire time
+  for (unsigned int i = 0; i < GG_ARRAY_SIZE(timers); i++) {
+      if (i % 50 == 3) {
+          LONGS_EQUAL(GG_TIMER_NEVER, timers[i].fired_at);
+          continue;
+      }
+      CHECK(timers[i].fired_at >= timers[i].fire_time);
+      CHECK(timers[i].fired_at - timers[i].fire_time < 3);
+      for (unsigned int j = 0; j < i; j++) {
+          if (j % 50 == 3) continue;
+          if (timers[j].fire_time < timers[i].fire_time) {
+              CHECK(timers[j].fire_order < timers[i].fire_order);
+          } else if (timers[j].fire_time == timers[i].fire_time) {
+              // timers with the same fire time fire in the order in which they were scheduled
+              CHECK(timers[j].fire_order < timers[i].fire_order);
+          }
+      }
+  }
+
+  GG_TimerScheduler_Destroy(scheduler);
+}
+
+TEST(GG_TIMER, Test_TimerLargeJumpsAndReschedule) {
+  GG_TimerScheduler* scheduler = NULL;
+  GG_Result result = GG_TimerScheduler_Create(&scheduler);
+  LONGS_EQUAL(GG_SUCCESS, result);
+
+  uint32_t fire_counter = 0;
+  RecordingTimer periodic;
+  RecordingTimer_Init(&periodic, scheduler, &fire_counter);
+  periodic.reschedule_ms = 1000;
+  RecordingTimer_Schedule(&periodic, scheduler, 1000);
+
+  RecordingTimer far;
+  RecordingTimer_Init(&far, scheduler, &fire_counter);
+  RecordingTimer_Schedule(&far, scheduler, 100000000);
+
+  // the next scheduled time may be a bit early for timers that aren't very close
+  uint32_t next = GG_TimerScheduler_GetNextScheduledTime(scheduler);
+  CHECK(next > 0 && next <= 1000);
+  LONGS_EQUAL(100000000, GG_Timer_GetRemainingTime(far.timer));
+
+  // a big jump fires the periodic timer only once, and it reschedules itself
+  GG_TimerScheduler_SetTime(scheduler, 50000);
+  LONGS_EQUAL(1, fire_counter);
+  CHECK_TRUE(GG_Timer_IsScheduled(periodic.timer));
+  LONGS_EQUAL(1000, GG_Timer_GetRemainingTime(periodic.timer));
+  next = GG_TimerScheduler_GetNextScheduledTime(scheduler);
+  CHECK(next > 0 && next <= 1000);
+  GG_Timer_Unschedule(periodic.timer);
+
+  // the far timer doesn't fire one ms early, but fires right on time
+  GG_TimerScheduler_SetTime(scheduler, 99999999);
+  LONGS_EQUAL(1, fire_counter);
+  LONGS_EQUAL(1, GG_TimerScheduler_GetNextScheduledTime(scheduler)); // close timers are exact
+  GG_TimerScheduler_SetTime(scheduler, 100000000);
+  LONGS_EQUAL(2, fire_counter);
+  LONGS_EQUAL(GG_TIMER_NEVER, GG_TimerScheduler_GetNextScheduledTime(scheduler));
+
+  // a timer rescheduled with a 0 delay from its listener fires again in the same call
+  RecordingTimer_Schedule(&far, scheduler, 10);
+  far.reschedule_ms = 0;
+  GG_TimerScheduler_SetTime(scheduler, 100000010);
+  LONGS_EQUAL(3, fire_counter);
+
+  // going back in time keeps the timers relative to the new time
+  RecordingTimer_Schedule(&far, scheduler, 5000);
+  GG_TimerScheduler_SetTime(scheduler, 1000);
+  LONGS_EQUAL(3, fire_counter);
+  RecordingTimer_Schedule(&periodic, scheduler, 10);
+  periodic.reschedule_ms = 0;
+  GG_TimerScheduler_SetTime(scheduler, 1010);
+  LONGS_EQUAL(4, fire_counter);
+
+  // destroying a scheduled timer unschedules it
+  GG_Timer_Destroy(far.timer);
+  LONGS_EQUAL(GG_TIMER_NEVER, GG_TimerScheduler_GetNextScheduledTime(scheduler));
+
+  GG_Timer_Destroy(periodic.timer);
+  GG_TimerScheduler_Destroy(scheduler);
+}
@@ -460,6 +460,15 @@ TEST(GG_UTILS, Test_BytesToInt64Le) {
     CHECK_EQUAL(0x8967452301efcdab, result);
 }
 
+TEST(GG_UTILS, Test_LowestBitIndex) {
+    LONGS_EQUAL(0, GG_LowestBitIndex(1));
+    LONGS_EQUAL(0, GG_LowestBitIndex(0xFFFFFFFFFFFFFFFF));
+    LONGS_EQUAL(3, GG_LowestBitIndex(0x28));
+    LONGS_EQUAL(31, GG_LowestBitIndex(0x80000000));
+    LONGS_EQUAL(32, GG_LowestBitIndex(0x100000000));
+    LONGS_EQUAL(63, GG_LowestBitIndex(0x8000000000000000));
+}
+
 //----------------------------------------------------------------------
 typedef struct {
     int field1;
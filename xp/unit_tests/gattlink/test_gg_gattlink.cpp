@@ -13,9 +13,11 @@
 #include "xp/common/gg_port.h"
 #include "xp/common/gg_timer.h"
 #include "xp/common/gg_types.h"
+#include "xp/common/gg_utils.h"
 #include "xp/gattlink/gg_gattlink.h"
 
 static size_t s_max_packet_size = 8;
+static bool   s_extended_format = false; // true when the session uses 8-bit PSNs
 
 typedef struct {
     uint8_t send_buffer[1024];
@@ -82,12 +84,49 @@ BuildControlMockRefName(char *name, uint8_t control_id)
 }
 
 static void
-OpenGattlink(uint8_t rx_window_size, uint8_t tx_window_size)
+OpenGattlinkWithVersion(uint8_t rx_window_size, uint8_t tx_window_size, uint8_t max_version)
 {
     GG_GattlinkProtocol_Start(gattlink_client.client);
-    uint8_t response[] = { 0x81, 0x00, 0x00, rx_window_size, tx_window_size };
+    uint8_t response[] = { 0x81, 0x00, max_version, rx_window_size, tx_window_size };
     GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &response, sizeof(response));
     CHECK_EQUAL(GG_SUCCESS, result);
+    s_extended_format = (max_version >= 2);
+}
+
+static void
+OpenGattlink(uint8_t rx_window_size, uint8_t tx_window_size)
+{
+    OpenGattlinkWithVersion(rx_window_size, tx_window_size, 0);
+}
+
+static void
+RecreateGattlink(GG_GattlinkCongestionControl congestion_control)
+{
+    unittest_session_config.congestion_control = congestion_control;
+    GG_GattlinkProtocol_Destroy(gattlink_client.client);
+    GG_Result result = GG_GattlinkProtocol_Create(GG_CAST(&gattlink_client, GG_GattlinkClient),
+                                                  &unittest_session_config,
+                                                  TimerScheduler,
+                                                  &gattlink_client.client);
+    CHECK_EQUAL(GG_SUCCESS, result);
+}
+
+// queue one byte of data, and expect it to be sent right away (or not) with the given PSN
+static void
+QueueOneByte(uint8_t psn, bool expect_send)
+{
+    uint8_t data[] = { psn, (uint8_t)(0xA0 + psn) };
+    if (expect_send) {
+        char name[MOCK_REF_NAME_LEN];
+        BuildDataMockRefName(name, sizeof(name), psn, -1);
+        mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data[0], sizeof(data));
+    } else {
+        mock().expectNoCall("GattlinkClient_SendRawData");
+    }
+    AddToSendBuf(&gattlink_client.send_buf, &data[1], sizeof(data) - 1);
+    GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+    mock().checkExpectations();
+    mock().clear();
 }
 
 static void ForceSendAndPayloadAck(uint8_t psn)
@@ -167,7 +206,16 @@ GattlinkClient_SendRawData(GG_GattlinkClient* _self, const void *tx_raw_data, si
     } else {
         int ack = -1;
         int psn  = -1;
-        if ((hdr & 0x40) != 0) {
+        if (s_extended_format) {
+            size_t psn_offset = 1;
+            if ((hdr & 0x40) != 0) {
+                ack = data[1];
+                psn_offset = (hdr & 0x20) ? 6 : 2;
+            }
+            if (tx_raw_data_len > psn_offset) {
+                psn = data[psn_offset];
+            }
+        } else if ((hdr & 0x40) != 0) {
             ack = ((int)hdr)&0x1f;
             if (tx_raw_data_len > 1) {
                 psn = data[1] & 0x1f;
@@ -257,7 +305,8 @@ GG_IMPLEMENT_INTERFACE(GattlinkClient, GG_GattlinkClient) {
     GattlinkClient_SendRawData,
     GattlinkClient_NotifySessionUp,
     GattlinkClient_NotifySessionReset,
-    GattlinkClient_NotifySessionStalled
+    GattlinkClient_NotifySessionStalled,
+    NULL
 };
 
 TEST_GROUP(GATTLINK)
@@ -272,6 +321,9 @@ TEST_GROUP(GATTLINK)
 
         unittest_session_config.max_tx_window_size = 12;
         unittest_session_config.max_rx_window_size = 12;
+        unittest_session_config.congestion_control = GG_GATTLINK_CONGESTION_CONTROL_NONE;
+        s_extended_format = false;
+        s_max_packet_size = 8;
 
         memset(&gattlink_client.send_buf, 0x00, sizeof(gattlink_client.send_buf));
 
@@ -315,7 +367,7 @@ TEST(GATTLINK, Test_GattlinkSelfInitiatedOpen)
     uint8_t rc[] = {
         0x81,
         0x00,
-        0x00,
+        0x02,
         unittest_session_config.max_rx_window_size,
         unittest_session_config.max_tx_window_size
     };
@@ -783,3 +835,508 @@ TEST(GATTLINK, Test_GattlinkReceivePreviousAcks)
 
     mock().checkExpectations();
 }
+
+TEST(GATTLINK, Test_GattlinkAdaptiveRetransmitTimeout)
+{
+    const uint8_t window_size = 0x8;
+    OpenGattlink(window_size, window_size);
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+
+    // before any sample, the initial timeout is used
+    GG_GattlinkProtocolStats stats;
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(4000, stats.retransmit_timeout);
+    LONGS_EQUAL(0, stats.rtt_sample_count);
+
+    mock().enable();
+
+    // send a packet and ack it 50ms later
+    uint8_t data0[] = { 0, 0xA };
+    char name[MOCK_REF_NAME_LEN];
+    BuildDataMockRefName(name, sizeof(name), 0, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data0[0], sizeof(data0));
+    AddToSendBuf(&gattlink_client.send_buf, &data0[1], sizeof(data0) - 1);
+    GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+    TimerSchedulerNow += 50;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    uint8_t ack = 0x40 | 0;
+    GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+    mock().clear();
+
+    // SRTT = 50, RTTVAR = 25, RTO = 50 + 4 * 25 = 150, raised to the 250ms lower bound
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(50, stats.smoothed_rtt);
+    LONGS_EQUAL(25, stats.rtt_variance);
+    LONGS_EQUAL(250, stats.retransmit_timeout);
+    LONGS_EQUAL(1, stats.rtt_sample_count);
+
+    // send a packet that doesn't get acked: it should be retransmitted after 250ms, not 4s
+    uint8_t data1[] = { 1, 0xB };
+    BuildDataMockRefName(name, sizeof(name), 1, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data1[0], sizeof(data1));
+    AddToSendBuf(&gattlink_client.send_buf, &data1[1], sizeof(data1) - 1);
+    GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+    TimerSchedulerNow += 200;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    mock().checkExpectations();
+    mock().clear();
+
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data1[0], sizeof(data1));
+    TimerSchedulerNow += 60;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    mock().checkExpectations();
+    mock().clear();
+
+    // the timeout backs off
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(500, stats.retransmit_timeout);
+    LONGS_EQUAL(1, stats.retransmit_timeout_count);
+
+    // an ack for a retransmitted packet isn't sampled, and the backoff is kept
+    TimerSchedulerNow += 10;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    ack = 0x40 | 1;
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(1, stats.rtt_sample_count);
+    LONGS_EQUAL(500, stats.retransmit_timeout);
+
+    // a new sample resets the backoff
+    uint8_t data2[] = { 2, 0xC };
+    BuildDataMockRefName(name, sizeof(name), 2, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data2[0], sizeof(data2));
+    AddToSendBuf(&gattlink_client.send_buf, &data2[1], sizeof(data2) - 1);
+    GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+    TimerSchedulerNow += 30;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    ack = 0x40 | 2;
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(2, stats.rtt_sample_count);
+    LONGS_EQUAL(47, stats.smoothed_rtt);
+    LONGS_EQUAL(250, stats.retransmit_timeout);
+}
+
+TEST(GATTLINK, Test_GattlinkAdaptiveAckDelay)
+{
+    OpenGattlink(0x8, 0x8);
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+
+    // nothing received yet, use the max delay
+    GG_GattlinkProtocolStats stats;
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(200, stats.ack_delay);
+
+    // receive packets 20ms apart
+    for (uint8_t psn = 0; psn < 3; psn++) {
+        uint8_t raw_data[] = { psn, 0xA, 0xB };
+        GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client,
+                                                                     &raw_data,
+                                                                     sizeof(raw_data));
+        CHECK_EQUAL(GG_SUCCESS, result);
+        GG_GattlinkProtocol_ConsumeIncomingData(gattlink_client.client, sizeof(raw_data) - 1);
+        TimerSchedulerNow += 20;
+        GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    }
+
+    // the ack is delayed by about two packet intervals
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(40, stats.ack_delay);
+}
+
+TEST(GATTLINK, Test_GattlinkSelectiveRetransmit)
+{
+    const uint8_t window_size = 0x8;
+    OpenGattlinkWithVersion(window_size, window_size, 1);
+
+    mock().enable();
+
+    // send 4 packets
+    char name[MOCK_REF_NAME_LEN];
+    for (uint8_t psn = 0; psn < 4; psn++) {
+        uint8_t data[] = { psn, (uint8_t)(0xA0 + psn) };
+        BuildDataMockRefName(name, sizeof(name), psn, -1);
+        mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data[0], sizeof(data));
+        AddToSendBuf(&gattlink_client.send_buf, &data[1], sizeof(data) - 1);
+        GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+    }
+    mock().checkExpectations();
+    mock().clear();
+
+    // the peer got all but the first one: only that one should be resent, right away
+    uint8_t sack[] = { 0x40 | 0x20 | 31, 0x00, 0x00, 0x00, 0x07 };
+    uint8_t data0[] = { 0, 0xA0 };
+    BuildDataMockRefName(name, sizeof(name), 0, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data0[0], sizeof(data0));
+    GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &sack, sizeof(sack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+    mock().clear();
+
+    // the same info again doesn't trigger another retransmission
+    mock().expectNoCall("GattlinkClient_SendRawData");
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &sack, sizeof(sack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+    mock().clear();
+
+    // when the retransmission timer expires, only the missing packet is resent
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data0[0], sizeof(data0));
+    TimerSchedulerNow += 4000;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    mock().checkExpectations();
+    mock().clear();
+
+    // ack everything
+    uint8_t ack = 0x40 | 3;
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, gattlink_client.send_buf.unread_bytes);
+}
+
+TEST(GATTLINK, Test_GattlinkOutOfOrderReceive)
+{
+    const uint8_t window_size = 0x8;
+    OpenGattlinkWithVersion(window_size, window_size, 1);
+
+    mock().enable();
+
+    // receive PSN 1 before PSN 0: it is buffered and reported right away with a selective ack
+    uint8_t sack[] = { 0x40 | 0x20 | 31, 0x00, 0x00, 0x00, 0x01 };
+    char name[MOCK_REF_NAME_LEN];
+    BuildDataMockRefName(name, sizeof(name), 0, 31);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &sack[0], sizeof(sack));
+    uint8_t data1[] = { 1, 0xB, 0xB };
+    GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &data1, sizeof(data1));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, GG_GattlinkProtocol_GetIncomingDataAvailable(gattlink_client.client));
+    mock().checkExpectations();
+    mock().clear();
+
+    // receive PSN 0, then PSN 1 is delivered once PSN 0 is consumed
+    mock().expectNCalls(2, "GattlinkClient_NotifyIncomingDataAvailable");
+    uint8_t data0[] = { 0, 0xA };
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &data0, sizeof(data0));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, GG_GattlinkProtocol_GetIncomingDataAvailable(gattlink_client.client));
+    GG_GattlinkProtocol_ConsumeIncomingData(gattlink_client.client, 1);
+    LONGS_EQUAL(2, GG_GattlinkProtocol_GetIncomingDataAvailable(gattlink_client.client));
+    uint8_t payload[2];
+    result = GG_GattlinkProtocol_GetIncomingData(gattlink_client.client, 0, payload, sizeof(payload));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    MEMCMP_EQUAL(&data1[1], payload, sizeof(payload));
+    mock().checkExpectations();
+    mock().clear();
+
+    // both packets are acked
+    uint8_t ack[] = { 0x40 | 1 };
+    BuildDataMockRefName(name, sizeof(name), -1, 1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &ack[0], sizeof(ack));
+    TimerSchedulerNow += 400;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    mock().checkExpectations();
+}
+
+TEST(GATTLINK, Test_GattlinkExtendedFormat)
+{
+    // a window larger than what 5-bit PSNs allow
+    const uint8_t window_size = 40;
+    unittest_session_config.max_tx_window_size = window_size;
+    unittest_session_config.max_rx_window_size = window_size;
+    GG_GattlinkProtocol_Destroy(gattlink_client.client);
+    GG_Result result = GG_GattlinkProtocol_Create(GG_CAST(&gattlink_client, GG_GattlinkClient),
+                                                  &unittest_session_config,
+                                                  TimerScheduler,
+                                                  &gattlink_client.client);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    OpenGattlinkWithVersion(window_size, window_size, 2);
+    LONGS_EQUAL(window_size, GG_GattlinkProtocol_GetTxWindowSize(gattlink_client.client));
+
+    mock().enable();
+
+    // a full window of packets can be in flight, each with a header byte and an 8-bit PSN
+    char name[MOCK_REF_NAME_LEN];
+    for (uint8_t psn = 0; psn <= window_size; psn++) {
+        uint8_t data[] = { 0x00, psn, (uint8_t)psn };
+        if (psn < window_size) {
+            BuildDataMockRefName(name, sizeof(name), psn, -1);
+            mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data[0], sizeof(data));
+        } else {
+            mock().expectNoCall("GattlinkClient_SendRawData");
+        }
+        AddToSendBuf(&gattlink_client.send_buf, &data[2], 1);
+        GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    // ack up to PSN 35, which frees up room for the last packet
+    uint8_t ack[] = { 0x40, 35 };
+    uint8_t last[] = { 0x00, window_size, window_size };
+    BuildDataMockRefName(name, sizeof(name), window_size, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &last[0], sizeof(last));
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(window_size - 35, gattlink_client.send_buf.unread_bytes);
+    mock().checkExpectations();
+    mock().clear();
+
+    // receive data with an 8-bit PSN, piggybacking an ack for everything
+    uint8_t data[] = { 0x40, window_size, 0, 0xAB };
+    mock().expectOneCall("GattlinkClient_NotifyIncomingDataAvailable");
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &data, sizeof(data));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, gattlink_client.send_buf.unread_bytes);
+    LONGS_EQUAL(1, GG_GattlinkProtocol_GetIncomingDataAvailable(gattlink_client.client));
+    mock().checkExpectations();
+}
+
+TEST(GATTLINK, Test_GattlinkBaseFormatWindowLimit)
+{
+    // with 5-bit PSNs, the window can't be larger than 31 packets
+    unittest_session_config.max_tx_window_size = 64;
+    unittest_session_config.max_rx_window_size = 64;
+    RecreateGattlink(GG_GATTLINK_CONGESTION_CONTROL_NONE);
+    OpenGattlinkWithVersion(64, 64, 0);
+    LONGS_EQUAL(31, GG_GattlinkProtocol_GetTxWindowSize(gattlink_client.client));
+
+    // and not larger than half the PSN space with selective acks
+    RecreateGattlink(GG_GATTLINK_CONGESTION_CONTROL_NONE);
+    OpenGattlinkWithVersion(64, 64, 1);
+    LONGS_EQUAL(16, GG_GattlinkProtocol_GetTxWindowSize(gattlink_client.client));
+}
+
+TEST(GATTLINK, Test_GattlinkBaseFormatSelectiveAck)
+{
+    // ask for a window larger than selective acks allow with 5-bit PSNs
+    unittest_session_config.max_tx_window_size = 32;
+    unittest_session_config.max_rx_window_size = 32;
+    RecreateGattlink(GG_GATTLINK_CONGESTION_CONTROL_NONE);
+    OpenGattlinkWithVersion(32, 32, 1);
+    const uint8_t window_size = 16;
+    LONGS_EQUAL(window_size, GG_GattlinkProtocol_GetTxWindowSize(gattlink_client.client));
+
+    mock().enable();
+
+    // send a full window
+    char name[MOCK_REF_NAME_LEN];
+    for (uint8_t psn = 0; psn < window_size; psn++) {
+        uint8_t data[] = { psn, (uint8_t)(0xA0 + psn) };
+        BuildDataMockRefName(name, sizeof(name), psn, -1);
+        mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data[0], sizeof(data));
+        AddToSendBuf(&gattlink_client.send_buf, &data[1], sizeof(data) - 1);
+        GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+    }
+    mock().checkExpectations();
+    mock().clear();
+
+    // the peer got everything but PSN 5: only that one should be resent
+    uint8_t sack[] = { 0x40 | 0x20 | 4, 0x00, 0x00, 0x03, 0xFF };
+    uint8_t data5[] = { 5, 0xA5 };
+    BuildDataMockRefName(name, sizeof(name), 5, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data5[0], sizeof(data5));
+    GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &sack, sizeof(sack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+    mock().clear();
+
+    // ack everything
+    uint8_t ack = 0x40 | (window_size - 1);
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, gattlink_client.send_buf.unread_bytes);
+
+    // receive PSN 1 before PSN 0: it is buffered, not taken for a retransmission,
+    // and reported right away with a selective ack
+    uint8_t receive_sack[] = { 0x40 | 0x20 | 31, 0x00, 0x00, 0x00, 0x01 };
+    BuildDataMockRefName(name, sizeof(name), 0, 31);
+    mock().expectOneCall("GattlinkClient_SendRawData")
+        .withMemoryBufferParameter(name, &receive_sack[0], sizeof(receive_sack));
+    uint8_t data1[] = { 1, 0xB };
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &data1, sizeof(data1));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, GG_GattlinkProtocol_GetIncomingDataAvailable(gattlink_client.client));
+    mock().checkExpectations();
+    mock().clear();
+
+    // receive PSN 0, both are delivered
+    mock().expectNCalls(2, "GattlinkClient_NotifyIncomingDataAvailable");
+    uint8_t data0[] = { 0, 0xA };
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &data0, sizeof(data0));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_GattlinkProtocol_ConsumeIncomingData(gattlink_client.client, 1);
+    LONGS_EQUAL(1, GG_GattlinkProtocol_GetIncomingDataAvailable(gattlink_client.client));
+    mock().checkExpectations();
+}
+
+TEST(GATTLINK, Test_GattlinkTxWindowLimit)
+{
+    OpenGattlink(0x8, 0x8);
+    LONGS_EQUAL(8, GG_GattlinkProtocol_GetTxWindowSize(gattlink_client.client));
+
+    // only 2 packets can be in flight with the limit
+    GG_GattlinkProtocol_SetTxWindowLimit(gattlink_client.client, 2);
+    LONGS_EQUAL(2, GG_GattlinkProtocol_GetTxWindowSize(gattlink_client.client));
+
+    mock().enable();
+    char name[MOCK_REF_NAME_LEN];
+    for (uint8_t psn = 0; psn < 3; psn++) {
+        uint8_t data[] = { psn, (uint8_t)(0xA0 + psn) };
+        if (psn < 2) {
+            BuildDataMockRefName(name, sizeof(name), psn, -1);
+            mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data[0], sizeof(data));
+        } else {
+            mock().expectNoCall("GattlinkClient_SendRawData");
+        }
+        AddToSendBuf(&gattlink_client.send_buf, &data[1], sizeof(data) - 1);
+        GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    // raising the limit lets the pending packet go out right away
+    uint8_t data2[] = { 2, 0xA2 };
+    BuildDataMockRefName(name, sizeof(name), 2, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data2[0], sizeof(data2));
+    GG_GattlinkProtocol_SetTxWindowLimit(gattlink_client.client, 0);
+    LONGS_EQUAL(8, GG_GattlinkProtocol_GetTxWindowSize(gattlink_client.client));
+    mock().checkExpectations();
+}
+
+TEST(GATTLINK, Test_GattlinkAimdCongestionControl)
+{
+    const uint8_t window_size = 0x8;
+    RecreateGattlink(GG_GATTLINK_CONGESTION_CONTROL_AIMD);
+    OpenGattlinkWithVersion(window_size, window_size, 1);
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+
+    GG_GattlinkProtocolStats stats;
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(4, stats.congestion_window);
+    LONGS_EQUAL(window_size, stats.slow_start_threshold);
+
+    mock().enable();
+
+    // only the initial congestion window is sent, even though the tx window is larger
+    for (uint8_t psn = 0; psn < 6; psn++) {
+        QueueOneByte(psn, psn < 4);
+    }
+
+    // slow start: the window grows by the number of packets acked, and the pending data goes out
+    uint8_t data4[] = { 4, 0xA4, 0xA5 };
+    char name[MOCK_REF_NAME_LEN];
+    BuildDataMockRefName(name, sizeof(name), 4, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data4[0], sizeof(data4));
+    uint8_t ack = 0x40 | 1;
+    GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+    mock().clear();
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(6, stats.congestion_window);
+
+    // the peer got all but PSN 2: the window is halved, and only PSN 2 is resent
+    uint8_t data2[] = { 2, 0xA2 };
+    BuildDataMockRefName(name, sizeof(name), 2, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data2[0], sizeof(data2));
+    uint8_t sack[] = { 0x40 | 0x20 | 1, 0x00, 0x00, 0x00, 0x03 };
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &sack, sizeof(sack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+    mock().clear();
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(2, stats.congestion_window);
+    LONGS_EQUAL(2, stats.slow_start_threshold);
+    LONGS_EQUAL(1, stats.congestion_event_count);
+
+    // the window doesn't grow with the ack that ends the recovery
+    ack = 0x40 | 4;
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(0, gattlink_client.send_buf.unread_bytes);
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(2, stats.congestion_window);
+
+    // only 2 packets are in flight when the retransmission timer expires
+    for (uint8_t psn = 5; psn < 8; psn++) {
+        QueueOneByte(psn, psn < 7);
+    }
+
+    // after a timeout, only one packet is resent instead of the whole window
+    uint8_t data5[] = { 5, 0xA5 };
+    BuildDataMockRefName(name, sizeof(name), 5, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name, &data5[0], sizeof(data5));
+    TimerSchedulerNow += stats.retransmit_timeout;
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+    mock().checkExpectations();
+    mock().clear();
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(1, stats.congestion_window);
+    LONGS_EQUAL(2, stats.slow_start_threshold);
+    LONGS_EQUAL(2, stats.congestion_event_count);
+
+    // slow start again: the next ack lets the other missing packet and the new one go out
+    uint8_t data6[] = { 6, 0xA6 };
+    uint8_t data7[] = { 7, 0xA7 };
+    char name6[MOCK_REF_NAME_LEN];
+    char name7[MOCK_REF_NAME_LEN];
+    BuildDataMockRefName(name6, sizeof(name6), 6, -1);
+    BuildDataMockRefName(name7, sizeof(name7), 7, -1);
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name6, &data6[0], sizeof(data6));
+    mock().expectOneCall("GattlinkClient_SendRawData").withMemoryBufferParameter(name7, &data7[0], sizeof(data7));
+    ack = 0x40 | 5;
+    result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+    CHECK_EQUAL(GG_SUCCESS, result);
+    mock().checkExpectations();
+    GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+    LONGS_EQUAL(2, stats.congestion_window);
+}
+
+TEST(GATTLINK, Test_GattlinkDelayCongestionControl)
+{
+    const uint8_t window_size = 16;
+    unittest_session_config.max_tx_window_size = window_size;
+    unittest_session_config.max_rx_window_size = window_size;
+    RecreateGattlink(GG_GATTLINK_CONGESTION_CONTROL_DELAY);
+    OpenGattlink(window_size, window_size);
+    GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+
+    // more data than we'll send
+    for (unsigned int i = 0; i < 250; i++) {
+        uint8_t byte = (uint8_t)i;
+        AddToSendBuf(&gattlink_client.send_buf, &byte, 1);
+    }
+    GG_GattlinkProtocol_NotifyOutgoingDataAvailable(gattlink_client.client);
+
+    // each round, ack the packets in flight after some round-trip time
+    struct {
+        uint32_t rtt;
+        uint8_t  last_psn;
+        uint32_t congestion_window;
+        uint32_t slow_start_threshold;
+    } rounds[] = {
+        { 100, 3,  8, window_size }, // slow start
+        { 150, 11, 6, 6           }, // 2 packets queued: leave slow start, with room for what the link carries
+        { 100, 17, 7, 6           }, // nothing queued: grow by one packet
+        { 240, 24, 6, 6           }  // 4 packets queued: shrink by one packet
+    };
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(rounds); i++) {
+        TimerSchedulerNow += rounds[i].rtt;
+        GG_TimerScheduler_SetTime(TimerScheduler, TimerSchedulerNow);
+        uint8_t ack = (uint8_t)(0x40 | rounds[i].last_psn);
+        GG_Result result = GG_GattlinkProtocol_HandleIncomingRawData(gattlink_client.client, &ack, sizeof(ack));
+        CHECK_EQUAL(GG_SUCCESS, result);
+
+        GG_GattlinkProtocolStats stats;
+        GG_GattlinkProtocol_GetStats(gattlink_client.client, &stats);
+        LONGS_EQUAL(rounds[i].congestion_window, stats.congestion_window);
+        LONGS_EQUAL(rounds[i].slow_start_threshold, stats.slow_start_threshold);
+        LONGS_EQUAL(0, stats.retransmit_timeout_count);
+    }
+}
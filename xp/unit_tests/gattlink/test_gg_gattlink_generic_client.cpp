@@ -244,9 +244,9 @@ TEST(GG_GENERIC_GATTLINK_CLIENT, Test_GattlinkGenericClient_Basics) {
     LONGS_EQUAL(sizeof(data), GG_Buffer_GetDataSize(GG_MemoryDataSink_GetBuffer(memory_sink)));
     MEMCMP_EQUAL(data, GG_Buffer_GetData(GG_MemoryDataSink_GetBuffer(memory_sink)), sizeof(data));
 
-    // max packet size should be 7+1 (1 byte header) because the largest buffer we sent was 7 bytes
-    // and the MTU allows up to 100
-    LONGS_EQUAL(8, counting_sink.max_packet_size);
+    // max packet size should be 7+2 (1 byte header + 1 byte PSN with the extended packet format)
+    // because the largest buffer we sent was 7 bytes and the MTU allows up to 100
+    LONGS_EQUAL(9, counting_sink.max_packet_size);
 
     // reset the max packet size counter
     counting_sink.max_packet_size = 0;
@@ -506,3 +506,319 @@ TEST(GG_GENERIC_GATTLINK_CLIENT, Test_GattlinkGenericClient_DroppedPackets) {
     GG_MemoryDataSink_Destroy(memory_sink_b);
     GG_Ipv4FrameSerializer_Destroy(frame_serializer);
 }
+
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    GG_Buffer*                   packets[8];
+    GG_GattlinkFragmentsMetadata fragments[8]; ///< Fragments of each packet (count 0 when not a batch)
+    size_t                       packet_count;
+} HoldingSink;
+
+static GG_Result
+HoldingSink_PutData(GG_DataSink* _self, GG_Buffer* buffer, const GG_BufferMetadata* metadata)
+{
+    HoldingSink* self = GG_SELF(HoldingSink, GG_DataSink);
+    if (self->packet_count == GG_ARRAY_SIZE(self->packets)) {
+        return GG_ERROR_WOULD_BLOCK;
+    }
+    memset(&self->fragments[self->packet_count], 0, sizeof(self->fragments[0]));
+    if (metadata && metadata->type == GG_BUFFER_METADATA_TYPE_GATTLINK_FRAGMENTS) {
+        self->fragments[self->packet_count] = *(const GG_GattlinkFragmentsMetadata*)metadata;
+    }
+    self->packets[self->packet_count++] = GG_Buffer_Retain(buffer);
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+HoldingSink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    GG_COMPILER_UNUSED(_self);
+    GG_COMPILER_UNUSED(listener);
+    return GG_SUCCESS;
+}
+
+static void
+HoldingSink_ReleaseAll(HoldingSink* self)
+{
+    for (size_t i = 0; i < self->packet_count; i++) {
+        GG_Buffer_Release(self->packets[i]);
+    }
+    self->packet_count = 0;
+}
+
+GG_IMPLEMENT_INTERFACE(HoldingSink, GG_DataSink) {
+    .PutData     = HoldingSink_PutData,
+    .SetListener = HoldingSink_SetListener
+};
+
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSinkListener);
+
+    unsigned int can_put_count;
+} CountingListener;
+
+static void
+CountingListener_OnCanPut(GG_DataSinkListener* _self)
+{
+    CountingListener* self = GG_SELF(CountingListener, GG_DataSinkListener);
+    ++self->can_put_count;
+}
+
+GG_IMPLEMENT_INTERFACE(CountingListener, GG_DataSinkListener) {
+    .OnCanPut = CountingListener_OnCanPut
+};
+
+//----------------------------------------------------------------------
+TEST(GG_GENERIC_GATTLINK_CLIENT, Test_GattlinkGenericClient_ZeroCopySend) {
+    GG_Ipv4FrameSerializer* frame_serializer;
+    GG_Result result = GG_Ipv4FrameSerializer_Create(NULL, &frame_serializer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    TestFrameAssembler frame_assembler;
+    GG_SET_INTERFACE(&frame_assembler, TestFrameAssembler, GG_FrameAssembler);
+
+    GG_GattlinkGenericClient* client = NULL;
+    result = GG_GattlinkGenericClient_Create(TimerScheduler, 64,
+                                             0, 0, 100,
+                                             NULL,
+                                             GG_Ipv4FrameSerializer_AsFrameSerializer(frame_serializer),
+                                             GG_CAST(&frame_assembler, GG_FrameAssembler),
+                                             &client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    HoldingSink transport;
+    memset(&transport, 0, sizeof(transport));
+    GG_SET_INTERFACE(&transport, HoldingSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(client),
+                              GG_CAST(&transport, GG_DataSink));
+
+    CountingListener listener;
+    listener.can_put_count = 0;
+    GG_SET_INTERFACE(&listener, CountingListener, GG_DataSinkListener);
+    GG_DataSink* user_sink = GG_GattlinkGenericClient_GetUserSideAsDataSink(client);
+    GG_DataSink_SetListener(user_sink, GG_CAST(&listener, GG_DataSinkListener));
+
+    // open the session, with the peer answering the reset request
+    result = GG_GattlinkGenericClient_Start(client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    uint8_t reset_complete[] = { 0x81, 0x00, 0x02, 0x08, 0x08 };
+    GG_StaticBuffer reset_complete_buffer;
+    GG_StaticBuffer_Init(&reset_complete_buffer, reset_complete, sizeof(reset_complete));
+    GG_DataSink* transport_sink = GG_GattlinkGenericClient_GetTransportSideAsDataSink(client);
+    result = GG_DataSink_PutData(transport_sink, GG_StaticBuffer_AsBuffer(&reset_complete_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    HoldingSink_ReleaseAll(&transport);
+    listener.can_put_count = 0;
+
+    // send a frame
+    uint8_t data[20];
+    memset(data, 7, sizeof(data));
+    GG_StaticBuffer data_buffer;
+    GG_StaticBuffer_Init(&data_buffer, data, sizeof(data));
+    result = GG_DataSink_PutData(user_sink, GG_StaticBuffer_AsBuffer(&data_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the packet is the header followed by the payload, referenced in place
+    LONGS_EQUAL(1, transport.packet_count);
+    GG_BufferChain* packet = GG_BufferChain_FromBuffer(transport.packets[0]);
+    CHECK_TRUE(packet != NULL);
+    LONGS_EQUAL(2, GG_BufferChain_GetSegmentCount(packet));
+    size_t segment_size = 0;
+    const uint8_t* header = GG_BufferChain_GetSegment(packet, 0, &segment_size);
+    LONGS_EQUAL(2, segment_size);
+    LONGS_EQUAL(0x00, header[0]);
+    LONGS_EQUAL(0x00, header[1]);
+    GG_BufferChain_GetSegment(packet, 1, &segment_size);
+    LONGS_EQUAL(GG_Buffer_GetDataSize(transport.packets[0]) - 2, segment_size);
+
+    // once acked, the payload can't be overwritten while the transport still holds it
+    uint8_t ack[] = { 0x40, 0x00 };
+    GG_StaticBuffer ack_buffer;
+    GG_StaticBuffer_Init(&ack_buffer, ack, sizeof(ack));
+    result = GG_DataSink_PutData(transport_sink, GG_StaticBuffer_AsBuffer(&ack_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, listener.can_put_count);
+    result = GG_DataSink_PutData(user_sink, GG_StaticBuffer_AsBuffer(&data_buffer), NULL);
+    LONGS_EQUAL(GG_ERROR_WOULD_BLOCK, result);
+
+    // releasing the packet unblocks the writer
+    HoldingSink_ReleaseAll(&transport);
+    LONGS_EQUAL(2, listener.can_put_count);
+    result = GG_DataSink_PutData(user_sink, GG_StaticBuffer_AsBuffer(&data_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, transport.packet_count);
+
+    // the client memory outlives views still held by the transport
+    GG_GattlinkGenericClient_Destroy(client);
+    HoldingSink_ReleaseAll(&transport);
+    GG_Ipv4FrameSerializer_Destroy(frame_serializer);
+}
+
+//----------------------------------------------------------------------
+TEST(GG_GENERIC_GATTLINK_CLIENT, Test_GattlinkGenericClient_BatchedSend) {
+    GG_Ipv4FrameSerializer* frame_serializer;
+    GG_Result result = GG_Ipv4FrameSerializer_Create(NULL, &frame_serializer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    TestFrameAssembler frame_assembler;
+    GG_SET_INTERFACE(&frame_assembler, TestFrameAssembler, GG_FrameAssembler);
+
+    GG_GattlinkGenericClient* client = NULL;
+    result = GG_GattlinkGenericClient_Create(TimerScheduler, 256,
+                                             0, 0, 10,
+                                             NULL,
+                                             GG_Ipv4FrameSerializer_AsFrameSerializer(frame_serializer),
+                                             GG_CAST(&frame_assembler, GG_FrameAssembler),
+                                             &client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_GattlinkGenericClient_EnableTransportBatching(client, true);
+
+    HoldingSink transport;
+    memset(&transport, 0, sizeof(transport));
+    GG_SET_INTERFACE(&transport, HoldingSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(client),
+                              GG_CAST(&transport, GG_DataSink));
+    GG_MemoryDataSink* user_side_output;
+    result = GG_MemoryDataSink_Create(&user_side_output);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetUserSideAsDataSource(client),
+                              GG_MemoryDataSink_AsDataSink(user_side_output));
+
+    // open the session, with the peer answering the reset request
+    result = GG_GattlinkGenericClient_Start(client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    uint8_t reset_complete[] = { 0x81, 0x00, 0x02, 0x08, 0x08 };
+    GG_StaticBuffer reset_complete_buffer;
+    GG_StaticBuffer_Init(&reset_complete_buffer, reset_complete, sizeof(reset_complete));
+    GG_DataSink* transport_sink = GG_GattlinkGenericClient_GetTransportSideAsDataSink(client);
+    result = GG_DataSink_PutData(transport_sink, GG_StaticBuffer_AsBuffer(&reset_complete_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    HoldingSink_ReleaseAll(&transport);
+
+    // send a frame that needs several packets: they all come out in one batch
+    uint8_t data[40];
+    memset(data, 7, sizeof(data));
+    GG_StaticBuffer data_buffer;
+    GG_StaticBuffer_Init(&data_buffer, data, sizeof(data));
+    GG_DataSink* user_sink = GG_GattlinkGenericClient_GetUserSideAsDataSink(client);
+    result = GG_DataSink_PutData(user_sink, GG_StaticBuffer_AsBuffer(&data_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, transport.packet_count);
+    CHECK_TRUE(transport.fragments[0].fragment_count > 1);
+    size_t batch_size = 0;
+    const uint8_t* fragment = GG_Buffer_GetData(transport.packets[0]);
+    for (size_t i = 0; i < transport.fragments[0].fragment_count; i++) {
+        CHECK_TRUE(transport.fragments[0].fragment_sizes[i] <= 10);
+        LONGS_EQUAL(i, fragment[1]); // PSNs 0, 1, ... (extended packet format)
+        fragment   += transport.fragments[0].fragment_sizes[i];
+        batch_size += transport.fragments[0].fragment_sizes[i];
+    }
+    LONGS_EQUAL(GG_Buffer_GetDataSize(transport.packets[0]), batch_size);
+    HoldingSink_ReleaseAll(&transport);
+
+    // a batch received from the transport is handled packet by packet
+    uint8_t incoming[] = { 0x00, 0x00, 'a', 'b', 0x00, 0x01, 'c', 'd' };
+    GG_StaticBuffer incoming_buffer;
+    GG_StaticBuffer_Init(&incoming_buffer, incoming, sizeof(incoming));
+    GG_GattlinkFragmentsMetadata incoming_fragments;
+    memset(&incoming_fragments, 0, sizeof(incoming_fragments));
+    incoming_fragments.base.type         = GG_BUFFER_METADATA_TYPE_GATTLINK_FRAGMENTS;
+    incoming_fragments.base.size         = sizeof(incoming_fragments);
+    incoming_fragments.fragment_count    = 2;
+    incoming_fragments.fragment_sizes[0] = 4;
+    incoming_fragments.fragment_sizes[1] = 4;
+    result = GG_DataSink_PutData(transport_sink,
+                                 GG_StaticBuffer_AsBuffer(&incoming_buffer),
+                                 &incoming_fragments.base);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* received = GG_MemoryDataSink_GetBuffer(user_side_output);
+    LONGS_EQUAL(4, GG_Buffer_GetDataSize(received));
+    MEMCMP_EQUAL("abcd", GG_Buffer_GetData(received), 4);
+
+    // a batch whose fragments don't add up is rejected
+    incoming_fragments.fragment_sizes[1] = 5;
+    result = GG_DataSink_PutData(transport_sink,
+                                 GG_StaticBuffer_AsBuffer(&incoming_buffer),
+                                 &incoming_fragments.base);
+    LONGS_EQUAL(GG_ERROR_INVALID_PARAMETERS, result);
+
+    GG_GattlinkGenericClient_Destroy(client);
+    HoldingSink_ReleaseAll(&transport);
+    GG_MemoryDataSink_Destroy(user_side_output);
+    GG_Ipv4FrameSerializer_Destroy(frame_serializer);
+}
+
+//----------------------------------------------------------------------
+// A peer that only supports the base packet format (version 1) gets a
+// session where selective acks still work with the default window sizes.
+//----------------------------------------------------------------------
+TEST(GG_GENERIC_GATTLINK_CLIENT, Test_GattlinkGenericClient_BaseFormatPeer) {
+    GG_Ipv4FrameSerializer* frame_serializer;
+    GG_Result result = GG_Ipv4FrameSerializer_Create(NULL, &frame_serializer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    TestFrameAssembler frame_assembler;
+    GG_SET_INTERFACE(&frame_assembler, TestFrameAssembler, GG_FrameAssembler);
+
+    // use the default window sizes
+    GG_GattlinkGenericClient* client = NULL;
+    result = GG_GattlinkGenericClient_Create(TimerScheduler, 256,
+                                             0, 0, 100,
+                                             NULL,
+                                             GG_Ipv4FrameSerializer_AsFrameSerializer(frame_serializer),
+                                             GG_CAST(&frame_assembler, GG_FrameAssembler),
+                                             &client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    HoldingSink transport;
+    memset(&transport, 0, sizeof(transport));
+    GG_SET_INTERFACE(&transport, HoldingSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(client),
+                              GG_CAST(&transport, GG_DataSink));
+    GG_MemoryDataSink* user_side_output;
+    result = GG_MemoryDataSink_Create(&user_side_output);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetUserSideAsDataSource(client),
+                              GG_MemoryDataSink_AsDataSink(user_side_output));
+
+    // open the session, with a version 1 peer answering the reset request with large windows
+    result = GG_GattlinkGenericClient_Start(client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    uint8_t reset_complete[] = { 0x81, 0x00, 0x01, 32, 32 };
+    GG_StaticBuffer reset_complete_buffer;
+    GG_StaticBuffer_Init(&reset_complete_buffer, reset_complete, sizeof(reset_complete));
+    GG_DataSink* transport_sink = GG_GattlinkGenericClient_GetTransportSideAsDataSink(client);
+    result = GG_DataSink_PutData(transport_sink, GG_StaticBuffer_AsBuffer(&reset_complete_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    HoldingSink_ReleaseAll(&transport);
+
+    // a packet received ahead of the expected one is selectively acked right away
+    uint8_t packet_1[] = { 0x01, 'b' };
+    GG_StaticBuffer packet_buffer;
+    GG_StaticBuffer_Init(&packet_buffer, packet_1, sizeof(packet_1));
+    result = GG_DataSink_PutData(transport_sink, GG_StaticBuffer_AsBuffer(&packet_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, transport.packet_count);
+    const uint8_t expected_sack[] = { 0x40 | 0x20 | 31, 0x00, 0x00, 0x00, 0x01 };
+    LONGS_EQUAL(sizeof(expected_sack), GG_Buffer_GetDataSize(transport.packets[0]));
+    MEMCMP_EQUAL(expected_sack, GG_Buffer_GetData(transport.packets[0]), sizeof(expected_sack));
+    HoldingSink_ReleaseAll(&transport);
+
+    // once the missing packet arrives, both are delivered in order
+    uint8_t packet_0[] = { 0x00, 'a' };
+    GG_StaticBuffer_Init(&packet_buffer, packet_0, sizeof(packet_0));
+    result = GG_DataSink_PutData(transport_sink, GG_StaticBuffer_AsBuffer(&packet_buffer), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* received = GG_MemoryDataSink_GetBuffer(user_side_output);
+    LONGS_EQUAL(2, GG_Buffer_GetDataSize(received));
+    MEMCMP_EQUAL("ab", GG_Buffer_GetData(received), 2);
+
+    GG_GattlinkGenericClient_Destroy(client);
+    HoldingSink_ReleaseAll(&transport);
+    GG_MemoryDataSink_Destroy(user_side_output);
+    GG_Ipv4FrameSerializer_Destroy(frame_serializer);
+}
@@ -291,7 +291,8 @@ GG_IMPLEMENT_INTERFACE(GattlinkClient, GG_GattlinkClient) {
     .SendRawData                 = GattlinkClient_SendRawData,
     .NotifySessionReady          = GattlinkClient_NotifySessionReady,
     .NotifySessionReset          = GattlinkClient_NotifySessionReset,
-    .NotifySessionStalled        = GattlinkClient_NotifySessionStalled
+    .NotifySessionStalled        = GattlinkClient_NotifySessionStalled,
+    .SendPacket                  = NULL
 };
 
 //----------------------------------------------------------------------
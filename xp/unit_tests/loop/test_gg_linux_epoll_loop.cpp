@@ -0,0 +1,199 @@
+// Copyright 2017-2020 Fitbit, Inc
+// SPDX-License-Identifier: Apache-2.0
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+
+#include "xp/common/gg_port.h"
+#include "xp/common/gg_timer.h"
+#include "xp/common/gg_utils.h"
+#include "xp/loop/gg_loop.h"
+#include "xp/loop/extensions/gg_loop_fd.h"
+
+//----------------------------------------------------------------------
+TEST_GROUP(GG_LINUX_EPOLL_LOOP)
+{
+    void setup(void) {
+    }
+
+    void teardown(void) {
+    }
+};
+
+typedef struct {
+    GG_LoopFileDescriptorEventHandler handler;
+    GG_Loop*                          loop;
+    int                               read_fd;
+    int                               write_fd;
+    unsigned int                      read_count;
+    unsigned int                      expected_read_count;
+    bool                              drain;
+    bool                              remove_when_done;
+} TestFdHandler;
+
+static void
+TestFdHandler_OnEvent(GG_LoopEventHandler* _self, GG_Loop* loop)
+{
+    TestFdHandler* self = GG_SELF_M(handler.base, TestFdHandler, GG_LoopEventHandler);
+
+    if (self->handler.event_flags & GG_EVENT_FLAG_FD_CAN_READ) {
+        uint8_t byte;
+        do {
+            if (read(self->read_fd, &byte, 1) != 1) {
+                // nothing more to read
+                self->handler.event_flags &= ~GG_EVENT_FLAG_FD_CAN_READ;
+                break;
+            }
+            ++self->read_count;
+        } while (self->drain);
+    }
+
+    if (self->read_count == self->expected_read_count) {
+        if (self->remove_when_done) {
+            GG_Loop_RemoveFileDescriptorHandler(loop, &self->handler);
+        }
+        GG_Loop_RequestTermination(loop);
+    }
+}
+
+GG_IMPLEMENT_INTERFACE(TestFdHandler, GG_LoopEventHandler) {
+    .OnEvent = TestFdHandler_OnEvent
+};
+
+static void
+TestFdHandler_Init(TestFdHandler* self, GG_Loop* loop, unsigned int expected_read_count, bool drain)
+{
+    memset(self, 0, sizeof(*self));
+    int fds[2];
+    int result = socketpair(AF_UNIX, SOCK_DGRAM, 0, fds);
+    LONGS_EQUAL(0, result);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+    self->read_fd             = fds[0];
+    self->write_fd            = fds[1];
+    self->loop                = loop;
+    self->expected_read_count = expected_read_count;
+    self->drain               = drain;
+    self->handler.fd          = fds[0];
+    self->handler.event_mask  = GG_EVENT_FLAG_FD_CAN_READ;
+    GG_SET_INTERFACE(&self->handler.base, TestFdHandler, GG_LoopEventHandler);
+}
+
+static void
+TestFdHandler_Deinit(TestFdHandler* self)
+{
+    close(self->read_fd);
+    close(self->write_fd);
+}
+
+typedef struct {
+    GG_IMPLEMENTS(GG_TimerListener);
+
+    GG_Loop* loop;
+    bool     fired;
+} ExitTimer;
+
+static void
+ExitTimer_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint32_t actual_ms_elapsed)
+{
+    ExitTimer* self = GG_SELF(ExitTimer, GG_TimerListener);
+    GG_COMPILER_UNUSED(timer);
+    GG_COMPILER_UNUSED(actual_ms_elapsed);
+
+    self->fired = true;
+    GG_Loop_RequestTermination(self->loop);
+}
+
+GG_IMPLEMENT_INTERFACE(ExitTimer, GG_TimerListener) {
+    .OnTimerFired = ExitTimer_OnTimerFired
+};
+
+//----------------------------------------------------------------------
+// Check that a handler that reads only one datagram per event keeps
+// being notified until everything has been read, even though the
+// file descriptor is registered in edge-triggered mode.
+//----------------------------------------------------------------------
+TEST(GG_LINUX_EPOLL_LOOP, Test_NonDrainingHandler) {
+    GG_Loop* loop = NULL;
+    GG_Result result = GG_Loop_Create(&loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Loop_BindToCurrentThread(loop);
+
+    TestFdHandler handler;
+    TestFdHandler_Init(&handler, loop, 3, false);
+    result = GG_Loop_AddFileDescriptorHandler(loop, &handler.handler);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // write 3 datagrams at once, so that only one edge is reported
+    uint8_t byte = 0;
+    for (unsigned int i = 0; i < 3; i++) {
+        LONGS_EQUAL(1, write(handler.write_fd, &byte, 1));
+    }
+
+    // setup a timer so we don't wait forever if something goes wrong
+    ExitTimer exit_timer;
+    exit_timer.loop  = loop;
+    exit_timer.fired = false;
+    GG_SET_INTERFACE(&exit_timer, ExitTimer, GG_TimerListener);
+    GG_Timer* timer = NULL;
+    result = GG_TimerScheduler_CreateTimer(GG_Loop_GetTimerScheduler(loop), &timer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Timer_Schedule(timer, GG_CAST(&exit_timer, GG_TimerListener), 5000);
+
+    result = GG_Loop_Run(loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(3, handler.read_count);
+    CHECK_FALSE(exit_timer.fired);
+
+    GG_Loop_RemoveFileDescriptorHandler(loop, &handler.handler);
+    TestFdHandler_Deinit(&handler);
+    GG_Timer_Destroy(timer);
+    GG_Loop_Destroy(loop);
+}
+
+//----------------------------------------------------------------------
+// Check that only the ready handler is called when many are registered,
+// and that a handler can remove itself from within its callback.
+//----------------------------------------------------------------------
+TEST(GG_LINUX_EPOLL_LOOP, Test_ManyHandlers) {
+    GG_Loop* loop = NULL;
+    GG_Result result = GG_Loop_Create(&loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Loop_BindToCurrentThread(loop);
+
+    static TestFdHandler handlers[200];
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(handlers); i++) {
+        TestFdHandler_Init(&handlers[i], loop, 2, true);
+        handlers[i].remove_when_done = true;
+        result = GG_Loop_AddFileDescriptorHandler(loop, &handlers[i].handler);
+        LONGS_EQUAL(GG_SUCCESS, result);
+    }
+
+    // make one of the handlers ready
+    TestFdHandler* ready_handler = &handlers[GG_ARRAY_SIZE(handlers) / 2];
+    uint8_t byte = 0;
+    LONGS_EQUAL(1, write(ready_handler->write_fd, &byte, 1));
+    LONGS_EQUAL(1, write(ready_handler->write_fd, &byte, 1));
+
+    result = GG_Loop_Run(loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(handlers); i++) {
+        LONGS_EQUAL(&handlers[i] == ready_handler ? 2 : 0, handlers[i].read_count);
+    }
+    CHECK_TRUE(GG_LINKED_LIST_NODE_IS_UNLINKED(&ready_handler->handler.base.list_node));
+
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(handlers); i++) {
+        GG_Loop_RemoveFileDescriptorHandler(loop, &handlers[i].handler);
+        TestFdHandler_Deinit(&handlers[i]);
+    }
+    GG_Loop_Destroy(loop);
+}
@@ -18,6 +18,9 @@
 #include "xp/module/gg_module.h"
 #include "xp/utils/gg_memory_data_source.h"
 #include "xp/utils/gg_memory_data_sink.h"
+#include "xp/utils/gg_async_pipe.h"
+#include "xp/gattlink/gg_gattlink_generic_client.h"
+#include "xp/protocols/gg_ipv4_protocol.h"
 #include "xp/nip/gg_nip.h"
 #include "xp/sockets/ports/nip/gg_nip_sockets.h"
 
@@ -84,6 +87,7 @@ TEST(GG_NIP, Test_NipSockets) {
 
     GG_Buffer* received_buffer = GG_MemoryDataSink_GetBuffer(transport_sink);
     LONGS_EQUAL(20 + 8 + 3, GG_Buffer_GetDataSize(received_buffer));
+    MEMCMP_EQUAL(data1_bytes, GG_Buffer_GetData(received_buffer) + 20 + 8, sizeof(data1_bytes));
 
     GG_MemoryDataSink* udp_sink;
     GG_MemoryDataSink_Create(&udp_sink);
@@ -105,3 +109,678 @@ TEST(GG_NIP, Test_NipSockets) {
 
     GG_DatagramSocket_Destroy(socket);
 }
+
+//----------------------------------------------------------------------
+TEST(GG_NIP, Test_NipMultipleStacks) {
+    // create two stacks, connected back to back
+    GG_IpAddress address_a;
+    GG_IpAddress address_b;
+    GG_IpAddress_SetFromString(&address_a, "169.254.0.2");
+    GG_IpAddress_SetFromString(&address_b, "169.254.0.3");
+    GG_NipStack* stack_a = NULL;
+    GG_NipStack* stack_b = NULL;
+    GG_Result result = GG_NipStack_Create(&address_a, &stack_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_NipStack_Create(&address_b, &stack_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack_a), GG_NipStack_AsDataSink(stack_b));
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack_b), GG_NipStack_AsDataSink(stack_a));
+
+    // each stack has its own port space
+    GG_SocketAddress local_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    local_address.port = 5683;
+    GG_SocketAddress remote_address_a = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    remote_address_a.address = address_b;
+    remote_address_a.port    = 5683;
+    GG_DatagramSocket* socket_a = NULL;
+    GG_DatagramSocket* socket_b = NULL;
+    result = GG_NipDatagramSocket_CreateWithStack(stack_a, &local_address, &remote_address_a, false, 1024, &socket_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_NipDatagramSocket_CreateWithStack(stack_b, &local_address, NULL, false, 1024, &socket_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the default stack isn't affected
+    GG_DatagramSocket* socket_default = NULL;
+    result = GG_NipDatagramSocket_Create(&local_address, NULL, false, 1024, &socket_default);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    GG_MemoryDataSink* sink_b;
+    GG_MemoryDataSink_Create(&sink_b);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket_b), GG_MemoryDataSink_AsDataSink(sink_b));
+
+    // send from A to B
+    GG_StaticBuffer payload;
+    GG_StaticBuffer_Init(&payload, (const uint8_t*)"hello", 5);
+    result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(socket_a), GG_StaticBuffer_AsBuffer(&payload), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* received = GG_MemoryDataSink_GetBuffer(sink_b);
+    LONGS_EQUAL(5, GG_Buffer_GetDataSize(received));
+    MEMCMP_EQUAL("hello", GG_Buffer_GetData(received), 5);
+
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket_b), NULL);
+    GG_MemoryDataSink_Destroy(sink_b);
+    GG_DatagramSocket_Destroy(socket_default);
+    GG_DatagramSocket_Destroy(socket_a);
+    GG_DatagramSocket_Destroy(socket_b);
+    GG_NipStack_Destroy(stack_a);
+    GG_NipStack_Destroy(stack_b);
+}
+
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    unsigned int packet_count;
+} CountingSink;
+
+static GG_Result
+CountingSink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    CountingSink* self = GG_SELF(CountingSink, GG_DataSink);
+    GG_COMPILER_UNUSED(data);
+    GG_COMPILER_UNUSED(metadata);
+
+    ++self->packet_count;
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+CountingSink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    GG_COMPILER_UNUSED(_self);
+    GG_COMPILER_UNUSED(listener);
+
+    return GG_SUCCESS;
+}
+
+GG_IMPLEMENT_INTERFACE(CountingSink, GG_DataSink) {
+    .PutData     = CountingSink_PutData,
+    .SetListener = CountingSink_SetListener
+};
+
+//----------------------------------------------------------------------
+TEST(GG_NIP, Test_NipPortTable) {
+    GG_IpAddress address_a;
+    GG_IpAddress address_b;
+    GG_IpAddress_SetFromString(&address_a, "169.254.0.2");
+    GG_IpAddress_SetFromString(&address_b, "169.254.0.3");
+    GG_NipStack* stack_a = NULL;
+    GG_NipStack* stack_b = NULL;
+    GG_Result result = GG_NipStack_Create(&address_a, &stack_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_NipStack_Create(&address_b, &stack_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack_a), GG_NipStack_AsDataSink(stack_b));
+
+    // add bound and unbound endpoints to B, well past the initial size of the port table,
+    // which must grow to accommodate them all
+    static GG_NipUdpEndpoint endpoints[256];
+    CountingSink sinks[256];
+    unsigned int endpoint_count = 0;
+    for (unsigned int i = 0; i < GG_ARRAY_SIZE(endpoints); i++) {
+        GG_SocketAddress local_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+        local_address.port = (i % 2) ? 0 : (uint16_t)(1000 + 64 * i); // spread the ports over many slots
+        GG_NipUdpEndpoint_Init(&endpoints[i], &local_address, NULL, false);
+        memset(&sinks[i], 0, sizeof(sinks[i]));
+        GG_SET_INTERFACE(&sinks[i], CountingSink, GG_DataSink);
+        endpoints[i].data_sink = GG_CAST(&sinks[i], GG_DataSink);
+        result = GG_NipStack_AddUdpEndpoint(stack_b, &endpoints[i]);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        ++endpoint_count;
+    }
+    LONGS_EQUAL(GG_ARRAY_SIZE(endpoints), endpoint_count);
+
+    // check that the dynamic ports are all different and in range
+    for (unsigned int i = 1; i < endpoint_count; i += 2) {
+        CHECK_FALSE(endpoints[i].local_port_bound);
+        CHECK_TRUE(endpoints[i].local_address.port >= 0xC000);
+        for (unsigned int j = 0; j < i; j++) {
+            CHECK_TRUE(endpoints[i].local_address.port != endpoints[j].local_address.port);
+        }
+    }
+
+    // remove a bound endpoint and a dynamic one, which makes room for two more
+    result = GG_Nip_RemoveEndpoint(&endpoints[2]);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_Nip_RemoveEndpoint(&endpoints[3]);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // a port that is still used can't be bound again
+    GG_NipUdpEndpoint extra;
+    GG_NipUdpEndpoint_Init(&extra, &endpoints[4].local_address, NULL, false);
+    result = GG_NipStack_AddUdpEndpoint(stack_b, &extra);
+    LONGS_EQUAL(GG_ERROR_ADDRESS_IN_USE, result);
+
+    // a port that was freed can be bound again
+    GG_NipUdpEndpoint_Init(&extra, &endpoints[2].local_address, NULL, false);
+    result = GG_NipStack_AddUdpEndpoint(stack_b, &extra);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_Nip_RemoveEndpoint(&extra);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // send one datagram to each remaining endpoint, and one to an unknown port
+    GG_StaticBuffer payload;
+    GG_StaticBuffer_Init(&payload, (const uint8_t*)"hello", 5);
+    for (unsigned int i = 0; i <= endpoint_count; i++) {
+        if (i == 2 || i == 3) {
+            continue;
+        }
+        GG_NipUdpEndpoint sender;
+        GG_SocketAddress remote_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+        remote_address.address = address_b;
+        remote_address.port    = (i == endpoint_count) ? 999 : endpoints[i].local_address.port;
+        GG_NipUdpEndpoint_Init(&sender, NULL, &remote_address, true);
+        result = GG_NipStack_AddUdpEndpoint(stack_a, &sender);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        result = GG_DataSink_PutData(GG_CAST(&sender, GG_DataSink), GG_StaticBuffer_AsBuffer(&payload), NULL);
+        LONGS_EQUAL(GG_SUCCESS, result);
+        GG_Nip_RemoveEndpoint(&sender);
+    }
+
+    // each endpoint got its datagram, and the first remaining unbound endpoint got the stray one
+    for (unsigned int i = 0; i < endpoint_count; i++) {
+        unsigned int expected = (i == 2 || i == 3) ? 0 : 1;
+        if (i == 1) {
+            ++expected;
+        }
+        LONGS_EQUAL(expected, sinks[i].packet_count);
+    }
+
+    // when the wildcard endpoint goes away, the next unbound one takes over
+    GG_Nip_RemoveEndpoint(&endpoints[1]);
+    GG_NipUdpEndpoint sender;
+    GG_SocketAddress remote_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    remote_address.address = address_b;
+    remote_address.port    = 999;
+    GG_NipUdpEndpoint_Init(&sender, NULL, &remote_address, true);
+    GG_NipStack_AddUdpEndpoint(stack_a, &sender);
+    result = GG_DataSink_PutData(GG_CAST(&sender, GG_DataSink), GG_StaticBuffer_AsBuffer(&payload), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(2, sinks[5].packet_count);
+    GG_Nip_RemoveEndpoint(&sender);
+
+    GG_NipStack_Destroy(stack_a);
+    GG_NipStack_Destroy(stack_b);
+}
+
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    unsigned int   packet_count;
+    bool           is_chain;
+    size_t         segment_count;
+    const uint8_t* segment_data[2];
+    size_t         segment_size[2];
+} ChainInspectingSink;
+
+static GG_Result
+ChainInspectingSink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    ChainInspectingSink* self = GG_SELF(ChainInspectingSink, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+
+    ++self->packet_count;
+
+    // read the segments the way a chain-aware transport would, without coalescing them
+    GG_BufferChain* chain = GG_BufferChain_FromBuffer(data);
+    self->is_chain = (chain != NULL);
+    if (chain) {
+        self->segment_count = GG_BufferChain_GetSegmentCount(chain);
+        for (size_t i = 0; i < self->segment_count && i < GG_ARRAY_SIZE(self->segment_data); i++) {
+            self->segment_data[i] = GG_BufferChain_GetSegment(chain, i, &self->segment_size[i]);
+        }
+    }
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+ChainInspectingSink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    GG_COMPILER_UNUSED(_self);
+    GG_COMPILER_UNUSED(listener);
+
+    return GG_SUCCESS;
+}
+
+GG_IMPLEMENT_INTERFACE(ChainInspectingSink, GG_DataSink) {
+    .PutData     = ChainInspectingSink_PutData,
+    .SetListener = ChainInspectingSink_SetListener
+};
+
+//----------------------------------------------------------------------
+TEST(GG_NIP, Test_NipSendZeroCopy) {
+    GG_IpAddress address_a;
+    GG_IpAddress address_b;
+    GG_IpAddress_SetFromString(&address_a, "169.254.0.2");
+    GG_IpAddress_SetFromString(&address_b, "169.254.0.3");
+    GG_NipStack* stack = NULL;
+    GG_Result result = GG_NipStack_Create(&address_a, &stack);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    ChainInspectingSink transport_sink;
+    memset(&transport_sink, 0, sizeof(transport_sink));
+    GG_SET_INTERFACE(&transport_sink, ChainInspectingSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack), GG_CAST(&transport_sink, GG_DataSink));
+
+    GG_NipUdpEndpoint sender;
+    GG_SocketAddress remote_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    remote_address.address = address_b;
+    remote_address.port    = 5683;
+    GG_NipUdpEndpoint_Init(&sender, NULL, &remote_address, true);
+    result = GG_NipStack_AddUdpEndpoint(stack, &sender);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // send a payload
+    GG_DynamicBuffer* payload = NULL;
+    result = GG_DynamicBuffer_Create(100, &payload);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DynamicBuffer_SetDataSize(payload, 100);
+    memset(GG_DynamicBuffer_UseData(payload), 'x', 100);
+    result = GG_DataSink_PutData(GG_CAST(&sender, GG_DataSink), GG_DynamicBuffer_AsBuffer(payload), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the transport gets a chain with the headers in front of the payload, which isn't copied
+    LONGS_EQUAL(1, transport_sink.packet_count);
+    CHECK_TRUE(transport_sink.is_chain);
+    LONGS_EQUAL(2, transport_sink.segment_count);
+    LONGS_EQUAL(20 + 8, transport_sink.segment_size[0]);
+    LONGS_EQUAL(100, transport_sink.segment_size[1]);
+    POINTERS_EQUAL(GG_DynamicBuffer_GetData(payload), transport_sink.segment_data[1]);
+
+    GG_DynamicBuffer_Release(payload);
+    GG_Nip_RemoveEndpoint(&sender);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack), NULL);
+    GG_NipStack_Destroy(stack);
+}
+
+//----------------------------------------------------------------------
+// Transport between two stacks, that holds a packet pushed back by the
+// receiving stack and retries when that stack says it can accept data again.
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+    GG_IMPLEMENTS(GG_DataSinkListener);
+
+    GG_DataSink* sink;
+    GG_Buffer*   held_packet;
+} HoldingTransport;
+
+static GG_Result
+HoldingTransport_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    HoldingTransport* self = GG_SELF(HoldingTransport, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+
+    // only one packet can be held
+    if (self->held_packet) {
+        return GG_ERROR_WOULD_BLOCK;
+    }
+
+    GG_Result result = GG_DataSink_PutData(self->sink, data, NULL);
+    if (result == GG_ERROR_WOULD_BLOCK) {
+        self->held_packet = GG_Buffer_Retain(data);
+        return GG_SUCCESS;
+    }
+
+    return result;
+}
+
+static GG_Result
+HoldingTransport_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    GG_COMPILER_UNUSED(_self);
+    GG_COMPILER_UNUSED(listener);
+
+    return GG_SUCCESS;
+}
+
+static void
+HoldingTransport_OnCanPut(GG_DataSinkListener* _self)
+{
+    HoldingTransport* self = GG_SELF(HoldingTransport, GG_DataSinkListener);
+
+    if (self->held_packet == NULL) {
+        return;
+    }
+
+    GG_Result result = GG_DataSink_PutData(self->sink, self->held_packet, NULL);
+    if (result != GG_ERROR_WOULD_BLOCK) {
+        GG_Buffer_Release(self->held_packet);
+        self->held_packet = NULL;
+    }
+}
+
+GG_IMPLEMENT_INTERFACE(HoldingTransport, GG_DataSink) {
+    .PutData     = HoldingTransport_PutData,
+    .SetListener = HoldingTransport_SetListener
+};
+
+GG_IMPLEMENT_INTERFACE(HoldingTransport, GG_DataSinkListener) {
+    .OnCanPut = HoldingTransport_OnCanPut
+};
+
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    GG_DataSinkListener* listener;
+    bool                 blocked;
+    unsigned int         packet_count;
+    uint8_t              last_value;
+} PushBackSink;
+
+static GG_Result
+PushBackSink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    PushBackSink* self = GG_SELF(PushBackSink, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+
+    if (self->blocked) {
+        return GG_ERROR_WOULD_BLOCK;
+    }
+
+    ++self->packet_count;
+    self->last_value = GG_Buffer_GetData(data)[0];
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+PushBackSink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    PushBackSink* self = GG_SELF(PushBackSink, GG_DataSink);
+
+    self->listener = listener;
+
+    return GG_SUCCESS;
+}
+
+GG_IMPLEMENT_INTERFACE(PushBackSink, GG_DataSink) {
+    .PutData     = PushBackSink_PutData,
+    .SetListener = PushBackSink_SetListener
+};
+
+//----------------------------------------------------------------------
+TEST(GG_NIP, Test_NipReceivePushBack) {
+    // create two stacks, with a holding transport from A to B
+    GG_IpAddress address_a;
+    GG_IpAddress address_b;
+    GG_IpAddress_SetFromString(&address_a, "169.254.0.2");
+    GG_IpAddress_SetFromString(&address_b, "169.254.0.3");
+    GG_NipStack* stack_a = NULL;
+    GG_NipStack* stack_b = NULL;
+    GG_Result result = GG_NipStack_Create(&address_a, &stack_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_NipStack_Create(&address_b, &stack_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    HoldingTransport transport;
+    memset(&transport, 0, sizeof(transport));
+    transport.sink = GG_NipStack_AsDataSink(stack_b);
+    GG_SET_INTERFACE(&transport, HoldingTransport, GG_DataSink);
+    GG_SET_INTERFACE(&transport, HoldingTransport, GG_DataSinkListener);
+    GG_DataSink_SetListener(transport.sink, GG_CAST(&transport, GG_DataSinkListener));
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack_a), GG_CAST(&transport, GG_DataSink));
+
+    GG_SocketAddress local_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    local_address.port = 5683;
+    GG_SocketAddress remote_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    remote_address.address = address_b;
+    remote_address.port    = 5683;
+    GG_DatagramSocket* socket_a = NULL;
+    GG_DatagramSocket* socket_b = NULL;
+    result = GG_NipDatagramSocket_CreateWithStack(stack_a, &local_address, &remote_address, false, 1024, &socket_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_NipDatagramSocket_CreateWithStack(stack_b, &local_address, NULL, false, 1024, &socket_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    PushBackSink sink_b;
+    memset(&sink_b, 0, sizeof(sink_b));
+    GG_SET_INTERFACE(&sink_b, PushBackSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket_b), GG_CAST(&sink_b, GG_DataSink));
+    CHECK_TRUE(sink_b.listener != NULL);
+
+    // send a first packet, it goes straight through
+    uint8_t value = 1;
+    GG_StaticBuffer payload;
+    GG_StaticBuffer_Init(&payload, &value, 1);
+    result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(socket_a), GG_StaticBuffer_AsBuffer(&payload), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, sink_b.packet_count);
+
+    // push back, the packet is held by the transport instead of being lost
+    sink_b.blocked = true;
+    value = 2;
+    result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(socket_a), GG_StaticBuffer_AsBuffer(&payload), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(1, sink_b.packet_count);
+    CHECK_TRUE(transport.held_packet != NULL);
+
+    // the transport can't take more while it holds a packet
+    result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(socket_a), GG_StaticBuffer_AsBuffer(&payload), NULL);
+    LONGS_EQUAL(GG_ERROR_WOULD_BLOCK, result);
+
+    // unblock, the held packet is delivered
+    sink_b.blocked = false;
+    GG_DataSinkListener_OnCanPut(sink_b.listener);
+    POINTERS_EQUAL(NULL, transport.held_packet);
+    LONGS_EQUAL(2, sink_b.packet_count);
+    LONGS_EQUAL(2, sink_b.last_value);
+
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket_b), NULL);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack_a), NULL);
+    GG_DatagramSocket_Destroy(socket_a);
+    GG_DatagramSocket_Destroy(socket_b);
+    GG_NipStack_Destroy(stack_a);
+    GG_NipStack_Destroy(stack_b);
+}
+
+//----------------------------------------------------------------------
+// Sink that pushes back every other datagram it is given, and checks that
+// the datagrams it accepts are the ones sent by the test, intact and in order.
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    GG_DataSinkListener* listener;
+    bool                 blocked;
+    unsigned int         push_back_count;
+    unsigned int         packet_count;
+    bool                 intact;
+} AlternatingSink;
+
+static GG_Result
+AlternatingSink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    AlternatingSink* self = GG_SELF(AlternatingSink, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+
+    if (self->blocked) {
+        ++self->push_back_count;
+        return GG_ERROR_WOULD_BLOCK;
+    }
+    self->blocked = true;
+
+    // each datagram is filled with its index
+    const uint8_t* payload = GG_Buffer_GetData(data);
+    if (GG_Buffer_GetDataSize(data) != 40) {
+        self->intact = false;
+    }
+    for (size_t i = 0; i < GG_Buffer_GetDataSize(data); i++) {
+        if (payload[i] != (uint8_t)self->packet_count) {
+            self->intact = false;
+        }
+    }
+    ++self->packet_count;
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+AlternatingSink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    AlternatingSink* self = GG_SELF(AlternatingSink, GG_DataSink);
+
+    self->listener = listener;
+
+    return GG_SUCCESS;
+}
+
+GG_IMPLEMENT_INTERFACE(AlternatingSink, GG_DataSink) {
+    .PutData     = AlternatingSink_PutData,
+    .SetListener = AlternatingSink_SetListener
+};
+
+//----------------------------------------------------------------------
+// Send datagrams from one stack to another over gattlink, with a receiving
+// socket that pushes back: nothing should be lost or corrupted in the
+// gattlink client's frame reassembly.
+//----------------------------------------------------------------------
+static void
+CheckGattlinkReceivePushBack(bool in_place_reassembly)
+{
+    GG_TimerScheduler* timer_scheduler = NULL;
+    GG_Result result = GG_TimerScheduler_Create(&timer_scheduler);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create the two stacks
+    GG_IpAddress address_a;
+    GG_IpAddress address_b;
+    GG_IpAddress_SetFromString(&address_a, "169.254.0.2");
+    GG_IpAddress_SetFromString(&address_b, "169.254.0.3");
+    GG_NipStack* stack_a = NULL;
+    GG_NipStack* stack_b = NULL;
+    result = GG_NipStack_Create(&address_a, &stack_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_NipStack_Create(&address_b, &stack_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a gattlink client for each stack, with small fragments so that packets span several of them
+    GG_Ipv4FrameSerializer* frame_serializer = NULL;
+    result = GG_Ipv4FrameSerializer_Create(NULL, &frame_serializer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Ipv4FrameAssembler* frame_assembler_a = NULL;
+    GG_Ipv4FrameAssembler* frame_assembler_b = NULL;
+    result = GG_Ipv4FrameAssembler_Create(1280, NULL, NULL, &frame_assembler_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_Ipv4FrameAssembler_Create(1280, NULL, NULL, &frame_assembler_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Ipv4FrameAssembler_EnableInPlaceReassembly(frame_assembler_b, in_place_reassembly);
+    GG_GattlinkGenericClient* client_a = NULL;
+    GG_GattlinkGenericClient* client_b = NULL;
+    result = GG_GattlinkGenericClient_Create(timer_scheduler, 1024, 0, 0, 20, NULL,
+                                             GG_Ipv4FrameSerializer_AsFrameSerializer(frame_serializer),
+                                             GG_Ipv4FrameAssembler_AsFrameAssembler(frame_assembler_a),
+                                             &client_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_GattlinkGenericClient_Create(timer_scheduler, 1024, 0, 0, 20, NULL,
+                                             GG_Ipv4FrameSerializer_AsFrameSerializer(frame_serializer),
+                                             GG_Ipv4FrameAssembler_AsFrameAssembler(frame_assembler_b),
+                                             &client_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // connect the clients back to back
+    GG_AsyncPipe* pipe_a_to_b = NULL;
+    GG_AsyncPipe* pipe_b_to_a = NULL;
+    result = GG_AsyncPipe_Create(timer_scheduler, 8, &pipe_a_to_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_AsyncPipe_Create(timer_scheduler, 8, &pipe_b_to_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(client_a),
+                              GG_AsyncPipe_AsDataSink(pipe_a_to_b));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe_a_to_b),
+                              GG_GattlinkGenericClient_GetTransportSideAsDataSink(client_b));
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(client_b),
+                              GG_AsyncPipe_AsDataSink(pipe_b_to_a));
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe_b_to_a),
+                              GG_GattlinkGenericClient_GetTransportSideAsDataSink(client_a));
+
+    // connect the stacks on top of the clients
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack_a),
+                              GG_GattlinkGenericClient_GetUserSideAsDataSink(client_a));
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetUserSideAsDataSource(client_b),
+                              GG_NipStack_AsDataSink(stack_b));
+
+    // open the session
+    result = GG_GattlinkGenericClient_Start(client_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_GattlinkGenericClient_Start(client_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    uint32_t now = 0;
+    for (; now < 100; now++) {
+        GG_TimerScheduler_SetTime(timer_scheduler, now);
+    }
+
+    // create the sockets
+    GG_SocketAddress local_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    local_address.port = 5683;
+    GG_SocketAddress remote_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    remote_address.address = address_b;
+    remote_address.port    = 5683;
+    GG_DatagramSocket* socket_a = NULL;
+    GG_DatagramSocket* socket_b = NULL;
+    result = GG_NipDatagramSocket_CreateWithStack(stack_a, &local_address, &remote_address, false, 1024, &socket_a);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_NipDatagramSocket_CreateWithStack(stack_b, &local_address, NULL, false, 1024, &socket_b);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    AlternatingSink sink_b;
+    memset(&sink_b, 0, sizeof(sink_b));
+    sink_b.intact = true;
+    GG_SET_INTERFACE(&sink_b, AlternatingSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket_b), GG_CAST(&sink_b, GG_DataSink));
+
+    // send datagrams filled with their index
+    const unsigned int datagram_count = 10;
+    for (unsigned int i = 0; i < datagram_count; i++) {
+        uint8_t payload[40];
+        memset(payload, (int)i, sizeof(payload));
+        GG_StaticBuffer payload_buffer;
+        GG_StaticBuffer_Init(&payload_buffer, payload, sizeof(payload));
+        result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(socket_a),
+                                     GG_StaticBuffer_AsBuffer(&payload_buffer),
+                                     NULL);
+        LONGS_EQUAL(GG_SUCCESS, result);
+    }
+
+    // let the data flow, unblocking the receiver from time to time
+    for (; now < 2000 && sink_b.packet_count < datagram_count; now++) {
+        GG_TimerScheduler_SetTime(timer_scheduler, now);
+        if (now % 10 == 0 && sink_b.blocked) {
+            sink_b.blocked = false;
+            GG_DataSinkListener_OnCanPut(sink_b.listener);
+        }
+    }
+    LONGS_EQUAL(datagram_count, sink_b.packet_count);
+    CHECK_TRUE(sink_b.intact);
+    CHECK_TRUE(sink_b.push_back_count > 0);
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket_b), NULL);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(stack_a), NULL);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetUserSideAsDataSource(client_b), NULL);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(client_a), NULL);
+    GG_DataSource_SetDataSink(GG_GattlinkGenericClient_GetTransportSideAsDataSource(client_b), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe_a_to_b), NULL);
+    GG_DataSource_SetDataSink(GG_AsyncPipe_AsDataSource(pipe_b_to_a), NULL);
+    GG_DatagramSocket_Destroy(socket_a);
+    GG_DatagramSocket_Destroy(socket_b);
+    GG_AsyncPipe_Destroy(pipe_a_to_b);
+    GG_AsyncPipe_Destroy(pipe_b_to_a);
+    GG_GattlinkGenericClient_Destroy(client_a);
+    GG_GattlinkGenericClient_Destroy(client_b);
+    GG_Ipv4FrameAssembler_Destroy(frame_assembler_a);
+    GG_Ipv4FrameAssembler_Destroy(frame_assembler_b);
+    GG_Ipv4FrameSerializer_Destroy(frame_serializer);
+    GG_NipStack_Destroy(stack_a);
+    GG_NipStack_Destroy(stack_b);
+    GG_TimerScheduler_Destroy(timer_scheduler);
+}
+
+//----------------------------------------------------------------------
+TEST(GG_NIP, Test_NipGattlinkReceivePushBack) {
+    CheckGattlinkReceivePushBack(false);
+    CheckGattlinkReceivePushBack(true);
+}
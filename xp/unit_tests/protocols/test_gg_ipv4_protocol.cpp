@@ -179,6 +179,142 @@ TEST(GG_IPV4_PROTOCOL, Test_Ipv4FrameAssembler_2) {
     }
 }
 
+TEST(GG_IPV4_PROTOCOL, Test_Ipv4FrameAssembler_InPlace) {
+    GG_Ipv4FrameAssembler* ipv4_frame_assembler;
+    GG_Result result = GG_Ipv4FrameAssembler_Create(100, NULL, NULL, &ipv4_frame_assembler);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_Ipv4FrameAssembler_EnableInPlaceReassembly(ipv4_frame_assembler, true);
+    GG_FrameAssembler* frame_assembler = GG_Ipv4FrameAssembler_AsFrameAssembler(ipv4_frame_assembler);
+
+    // reassemble packets while holding on to all of them, so that the assembler has to move on
+    // to new buffers without touching the packets already emitted
+    GG_Buffer* frames[20];
+    for (unsigned int i = 0; i < 20; i++) {
+        uint8_t packet[100];
+        size_t packet_size = 20 + (i * 7) % 80;
+        memset(packet, (int)i, sizeof(packet));
+        packet[0] = 0x45;
+        packet[1] = 0;
+        packet[2] = (uint8_t)(packet_size >> 8);
+        packet[3] = (uint8_t)packet_size;
+
+        frames[i] = NULL;
+        size_t fed = 0;
+        while (fed < packet_size) {
+            uint8_t* feed_buffer = NULL;
+            size_t   feed_buffer_size = 0;
+            GG_FrameAssembler_GetFeedBuffer(frame_assembler, &feed_buffer, &feed_buffer_size);
+            CHECK(feed_buffer != NULL);
+            CHECK(feed_buffer_size != 0);
+            size_t data_size = GG_MIN(feed_buffer_size, packet_size - fed);
+            memcpy(feed_buffer, &packet[fed], data_size);
+            result = GG_FrameAssembler_Feed(frame_assembler, &data_size, &frames[i]);
+            CHECK_EQUAL(GG_SUCCESS, result);
+            fed += data_size;
+        }
+        CHECK(frames[i] != NULL);
+        LONGS_EQUAL(packet_size, GG_Buffer_GetDataSize(frames[i]));
+    }
+
+    // the first two packets are views of the same buffer, one after the other
+    CHECK(GG_Buffer_GetData(frames[1]) > GG_Buffer_GetData(frames[0]) + GG_Buffer_GetDataSize(frames[0]));
+
+    // all the packets are intact
+    for (unsigned int i = 0; i < 20; i++) {
+        const uint8_t* frame_data = GG_Buffer_GetData(frames[i]);
+        size_t frame_size = GG_Buffer_GetDataSize(frames[i]);
+        LONGS_EQUAL(0x45, frame_data[0]);
+        LONGS_EQUAL(frame_size, GG_BytesToInt16Be(&frame_data[2]));
+        for (size_t j = 4; j < frame_size; j++) {
+            LONGS_EQUAL(i, frame_data[j]);
+        }
+    }
+
+    // packets outlive the assembler
+    GG_Ipv4FrameAssembler_Destroy(ipv4_frame_assembler);
+    for (unsigned int i = 0; i < 20; i++) {
+        GG_Buffer_Release(frames[i]);
+    }
+}
+
+TEST(GG_IPV4_PROTOCOL, Test_Ipv4FrameAssembler_InPlaceSteadyState) {
+    GG_Ipv4FrameAssembler* ipv4_frame_assembler;
+    GG_Result result = GG_Ipv4FrameAssembler_Create(100, NULL, NULL, &ipv4_frame_assembler);
+    CHECK_EQUAL(GG_SUCCESS, result);
+    GG_Ipv4FrameAssembler_EnableInPlaceReassembly(ipv4_frame_assembler, true);
+    GG_FrameAssembler* frame_assembler = GG_Ipv4FrameAssembler_AsFrameAssembler(ipv4_frame_assembler);
+
+    // reassemble packets while holding on to the first one for the whole test, so that its
+    // ring can't be freed and its memory handed out again, and to the last 2, like a receiver
+    // that is a bit behind
+    GG_Buffer*     first_frames[4];
+    const uint8_t* ring_start = NULL;
+    const uint8_t* ring_end   = NULL;
+    GG_Buffer*     held[2]    = { NULL, NULL };
+    for (unsigned int i = 0; i < 100; i++) {
+        uint8_t packet[100];
+        size_t packet_size = 20 + (i * 7) % 80;
+        memset(packet, (int)i, sizeof(packet));
+        packet[0] = 0x45;
+        packet[1] = 0;
+        packet[2] = (uint8_t)(packet_size >> 8);
+        packet[3] = (uint8_t)packet_size;
+
+        GG_Buffer* frame = NULL;
+        size_t fed = 0;
+        while (fed < packet_size) {
+            uint8_t* feed_buffer = NULL;
+            size_t   feed_buffer_size = 0;
+            GG_FrameAssembler_GetFeedBuffer(frame_assembler, &feed_buffer, &feed_buffer_size);
+            CHECK(feed_buffer != NULL);
+            size_t data_size = GG_MIN(feed_buffer_size, packet_size - fed);
+            memcpy(feed_buffer, &packet[fed], data_size);
+            result = GG_FrameAssembler_Feed(frame_assembler, &data_size, &frame);
+            CHECK_EQUAL(GG_SUCCESS, result);
+            fed += data_size;
+        }
+        CHECK(frame != NULL);
+        LONGS_EQUAL(packet_size, GG_Buffer_GetDataSize(frame));
+        const uint8_t* frame_data = GG_Buffer_GetData(frame);
+        LONGS_EQUAL(i, frame_data[4]);
+
+        if (i < 4) {
+            // the first packets each take a slot of the same ring
+            first_frames[i] = frame;
+            if (ring_start == NULL || frame_data < ring_start) {
+                ring_start = frame_data;
+            }
+            if (ring_end == NULL || frame_data + 100 > ring_end) {
+                ring_end = frame_data + 100;
+            }
+        } else {
+            // in steady state, the packet objects and the ring are reused, instead of
+            // new ones being allocated
+            CHECK_TRUE(frame == first_frames[1] || frame == first_frames[2] || frame == first_frames[3]);
+            CHECK_TRUE(frame_data >= ring_start && frame_data + packet_size <= ring_end);
+        }
+
+        // keep the first packet, and release the oldest of the others
+        if (i == 0) {
+            continue;
+        }
+        if (held[0]) {
+            GG_Buffer_Release(held[0]);
+        }
+        held[0] = held[1];
+        held[1] = frame;
+    }
+
+    // the held packets are still intact, and outlive the assembler
+    GG_Ipv4FrameAssembler_Destroy(ipv4_frame_assembler);
+    LONGS_EQUAL(0, GG_Buffer_GetData(first_frames[0])[4]);
+    GG_Buffer_Release(first_frames[0]);
+    for (unsigned int i = 0; i < 2; i++) {
+        LONGS_EQUAL(98 + i, GG_Buffer_GetData(held[i])[4]);
+        GG_Buffer_Release(held[i]);
+    }
+}
+
 TEST(GG_IPV4_PROTOCOL, Test_Ipv4Checksum) {
     uint8_t packet1[20] = {
         0x45, 0x00, 0x00, 0x22, 0x1b, 0xee, 0x00, 0x00, 0x40, 0x11, 0x00, 0x00, 0x0a, 0x01, 0x02, 0x03,
@@ -327,6 +463,11 @@ TEST(GG_IPV4_PROTOCOL, Test_HeaderCompression) {
     for (unsigned int i = 0; i < 100000; i ++) {
         GG_RingBuffer_Init(&serialized, serialized_buffer, sizeof(serialized_buffer));
 
+        // alternate between reassembling to new buffers and reassembling in place
+        if (i % 1000 == 0) {
+            GG_Ipv4FrameAssembler_EnableInPlaceReassembly(assembler, (i / 1000) % 2 == 1);
+        }
+
         // make a packet
         size_t payload_size = trivial_rand() % 300;
         GG_Ipv4PacketHeader ip_header = { 0 };
@@ -371,11 +512,28 @@ TEST(GG_IPV4_PROTOCOL, Test_HeaderCompression) {
             payload[j] = trivial_rand() & 0xFF;
         }
 
+        // serialize either a contiguous buffer or a chain split at a random position
+        GG_StaticBuffer frame;
+        GG_BufferChain* chain = NULL;
+        if (i % 2) {
+            GG_StaticBuffer_Init(&frame, packet, ip_header.total_length);
+        } else {
+            size_t split = trivial_rand() % (ip_header.total_length + 1);
+            GG_StaticBuffer_Init(&frame, &packet[split], ip_header.total_length - split);
+            result = GG_BufferChain_Create(split, &chain);
+            LONGS_EQUAL(GG_SUCCESS, result);
+            uint8_t* header = NULL;
+            result = GG_BufferChain_Prepend(chain, split, &header);
+            LONGS_EQUAL(GG_SUCCESS, result);
+            memcpy(header, packet, split);
+            result = GG_BufferChain_AppendBuffer(chain, GG_StaticBuffer_AsBuffer(&frame));
+            LONGS_EQUAL(GG_SUCCESS, result);
+        }
         result = GG_FrameSerializer_SerializeFrame(GG_Ipv4FrameSerializer_AsFrameSerializer(serializer),
-                                                   packet,
-                                                   ip_header.total_length,
+                                                   chain ? GG_BufferChain_AsBuffer(chain) : GG_StaticBuffer_AsBuffer(&frame),
                                                    &serialized);
         LONGS_EQUAL(GG_SUCCESS, result);
+        GG_BufferChain_Release(chain);
         size_t serialized_size = GG_RingBuffer_GetAvailable(&serialized);
         CHECK_TRUE(serialized_size <= (size_t)(ip_header.total_length + 2)); // shouldn't expand by more than 2 bytes
 
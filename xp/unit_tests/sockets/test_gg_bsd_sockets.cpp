@@ -165,3 +165,383 @@ TEST(GG_SOCKETS, Test_MultiSocketDestroy) {
 
     GG_Loop_Destroy(loop);
 }
+
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+
+    GG_Loop*           loop;
+    GG_DatagramSocket* socket;          // socket to echo back through, or NULL
+    unsigned int       received_count;
+    unsigned int       expected_count;
+    uint8_t            last_value;
+    bool               in_order;
+    GG_SocketAddress   last_source;
+    GG_Buffer*         retained;        // one buffer kept past the socket's lifetime
+} CountingSink;
+
+static GG_Result
+CountingSink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    CountingSink* self = GG_SELF(CountingSink, GG_DataSink);
+
+    LONGS_EQUAL(1, GG_Buffer_GetDataSize(data));
+    uint8_t value = GG_Buffer_GetData(data)[0];
+    if (self->received_count && value != (uint8_t)(self->last_value + 1)) {
+        self->in_order = false;
+    }
+    self->last_value = value;
+    CHECK_TRUE(metadata != NULL);
+    LONGS_EQUAL(GG_BUFFER_METADATA_TYPE_SOURCE_SOCKET_ADDRESS, metadata->type);
+    self->last_source = ((const GG_SocketAddressMetadata*)metadata)->socket_address;
+
+    if (self->retained == NULL) {
+        self->retained = GG_Buffer_Retain(data);
+    }
+
+    // echo the datagram back to its sender
+    if (self->socket) {
+        GG_SocketAddressMetadata destination;
+        destination.base.type      = GG_BUFFER_METADATA_TYPE_DESTINATION_SOCKET_ADDRESS;
+        destination.base.size      = sizeof(destination);
+        destination.socket_address = self->last_source;
+        GG_Result result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(self->socket), data, &destination.base);
+        LONGS_EQUAL(GG_SUCCESS, result);
+    }
+
+    if (++self->received_count == self->expected_count) {
+        GG_Loop_RequestTermination(self->loop);
+    }
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+CountingSink_SetListener(GG_DataSink* self, GG_DataSinkListener* listener)
+{
+    GG_COMPILER_UNUSED(self);
+    GG_COMPILER_UNUSED(listener);
+
+    return GG_SUCCESS;
+}
+
+GG_IMPLEMENT_INTERFACE(CountingSink, GG_DataSink) {
+    .PutData     = CountingSink_PutData,
+    .SetListener = CountingSink_SetListener
+};
+
+//----------------------------------------------------------------------
+// Check that a burst of datagrams is delivered in order, each with its own
+// source address, and that replies sent while the burst is being delivered
+// all make it back.
+//----------------------------------------------------------------------
+TEST(GG_SOCKETS, Test_DatagramBurstEcho) {
+    GG_Loop* loop = NULL;
+    GG_Result result = GG_Loop_Create(&loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a server socket bound to a free port
+    GG_DatagramSocket* server = NULL;
+    GG_SocketAddress server_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    GG_IpAddress_SetFromInteger(&server_address.address, 0x7F000001);
+    for (server_address.port = 2000; server_address.port <= 60000; server_address.port++) {
+        result = GG_BsdDatagramSocket_Create(&server_address, NULL, false, 1024, &server);
+        if (GG_SUCCEEDED(result)) {
+            break;
+        }
+    }
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a client socket that sends to the server
+    GG_DatagramSocket* client = NULL;
+    result = GG_BsdDatagramSocket_Create(NULL, &server_address, false, 1024, &client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    result = GG_DatagramSocket_Attach(server, loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_DatagramSocket_Attach(client, loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the server echoes everything back
+    const unsigned int datagram_count = 50;
+    CountingSink server_sink;
+    memset(&server_sink, 0, sizeof(server_sink));
+    server_sink.socket         = server;
+    server_sink.in_order       = true;
+    server_sink.expected_count = datagram_count + 1; // never terminate the loop
+    GG_SET_INTERFACE(&server_sink, CountingSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(server), GG_CAST(&server_sink, GG_DataSink));
+
+    CountingSink client_sink;
+    memset(&client_sink, 0, sizeof(client_sink));
+    client_sink.loop           = loop;
+    client_sink.in_order       = true;
+    client_sink.expected_count = datagram_count;
+    GG_SET_INTERFACE(&client_sink, CountingSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(client), GG_CAST(&client_sink, GG_DataSink));
+
+    // send a burst of datagrams before running the loop, so they are all queued at once
+    for (unsigned int i = 0; i < datagram_count; i++) {
+        uint8_t value = (uint8_t)i;
+        GG_StaticBuffer buffer;
+        GG_StaticBuffer_Init(&buffer, &value, 1);
+        result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(client), GG_StaticBuffer_AsBuffer(&buffer), NULL);
+        LONGS_EQUAL(GG_SUCCESS, result);
+    }
+
+    // schedule an exit timer in case something goes wrong
+    ExitTimer timer_handler;
+    timer_handler.loop = loop;
+    GG_SET_INTERFACE(&timer_handler, ExitTimer, GG_TimerListener);
+    GG_Timer* timer = NULL;
+    result = GG_TimerScheduler_CreateTimer(GG_Loop_GetTimerScheduler(loop), &timer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Timer_Schedule(timer, GG_CAST(&timer_handler, GG_TimerListener), 5000);
+
+    result = GG_Loop_Run(loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    LONGS_EQUAL(datagram_count, server_sink.received_count);
+    LONGS_EQUAL(datagram_count, client_sink.received_count);
+    CHECK_TRUE(server_sink.in_order);
+    CHECK_TRUE(client_sink.in_order);
+    LONGS_EQUAL(server_address.port, client_sink.last_source.port);
+
+    // buffers retained by a sink remain valid after the socket is gone
+    GG_DatagramSocket_Destroy(server);
+    GG_DatagramSocket_Destroy(client);
+    LONGS_EQUAL(0, GG_Buffer_GetData(server_sink.retained)[0]);
+    GG_Buffer_Release(server_sink.retained);
+    GG_Buffer_Release(client_sink.retained);
+
+    GG_Timer_Destroy(timer);
+    GG_Loop_Destroy(loop);
+}
+
+//----------------------------------------------------------------------
+// Check that a buffer chain is sent as a single datagram.
+//----------------------------------------------------------------------
+TEST(GG_SOCKETS, Test_DatagramBufferChain) {
+    GG_Loop* loop = NULL;
+    GG_Result result = GG_Loop_Create(&loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a server socket bound to a free port
+    GG_DatagramSocket* server = NULL;
+    GG_SocketAddress server_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    GG_IpAddress_SetFromInteger(&server_address.address, 0x7F000001);
+    for (server_address.port = 2000; server_address.port <= 60000; server_address.port++) {
+        result = GG_BsdDatagramSocket_Create(&server_address, NULL, false, 1024, &server);
+        if (GG_SUCCEEDED(result)) {
+            break;
+        }
+    }
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a client socket that sends to the server
+    GG_DatagramSocket* client = NULL;
+    result = GG_BsdDatagramSocket_Create(NULL, &server_address, false, 1024, &client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    result = GG_DatagramSocket_Attach(server, loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_DatagramSocket_Attach(client, loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the sink destroys the client when it receives the datagram
+    SocketSink sink;
+    sink.loop               = loop;
+    sink.socket2            = client;
+    sink.last_received_data = NULL;
+    GG_SET_INTERFACE(&sink, SocketSink, GG_DataSink);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(server), GG_CAST(&sink, GG_DataSink));
+
+    // send a chain with a header and two payload segments
+    GG_StaticBuffer part1;
+    GG_StaticBuffer part2;
+    GG_StaticBuffer_Init(&part1, (const uint8_t*)"cd", 2);
+    GG_StaticBuffer_Init(&part2, (const uint8_t*)"ef", 2);
+    GG_BufferChain* chain = NULL;
+    result = GG_BufferChain_Create(2, &chain);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_BufferChain_AppendBuffer(chain, GG_StaticBuffer_AsBuffer(&part1));
+    GG_BufferChain_AppendBuffer(chain, GG_StaticBuffer_AsBuffer(&part2));
+    uint8_t* header = NULL;
+    result = GG_BufferChain_Prepend(chain, 2, &header);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    memcpy(header, "ab", 2);
+    result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(client), GG_BufferChain_AsBuffer(chain), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_BufferChain_Release(chain);
+
+    // schedule an exit timer in case something goes wrong
+    ExitTimer timer_handler;
+    timer_handler.loop = loop;
+    GG_SET_INTERFACE(&timer_handler, ExitTimer, GG_TimerListener);
+    GG_Timer* timer = NULL;
+    result = GG_TimerScheduler_CreateTimer(GG_Loop_GetTimerScheduler(loop), &timer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Timer_Schedule(timer, GG_CAST(&timer_handler, GG_TimerListener), 5000);
+
+    result = GG_Loop_Run(loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    CHECK_TRUE(sink.last_received_data != NULL);
+    LONGS_EQUAL(6, GG_Buffer_GetDataSize(sink.last_received_data));
+    MEMCMP_EQUAL("abcdef", GG_Buffer_GetData(sink.last_received_data), 6);
+    GG_Buffer_Release(sink.last_received_data);
+
+    GG_DatagramSocket_Destroy(server);
+    GG_Timer_Destroy(timer);
+    GG_Loop_Destroy(loop);
+}
+
+//----------------------------------------------------------------------
+typedef struct {
+    GG_IMPLEMENTS(GG_DataSink);
+    GG_IMPLEMENTS(GG_TimerListener);
+
+    GG_Loop*             loop;
+    GG_DataSinkListener* listener;
+    GG_Timer*            unblock_timer;
+    bool                 blocked;
+    unsigned int         push_back_count;
+    unsigned int         received_count;
+    unsigned int         expected_count;
+    bool                 in_order;
+} PushBackSink;
+
+static GG_Result
+PushBackSink_PutData(GG_DataSink* _self, GG_Buffer* data, const GG_BufferMetadata* metadata)
+{
+    PushBackSink* self = GG_SELF(PushBackSink, GG_DataSink);
+    GG_COMPILER_UNUSED(metadata);
+
+    // push back every other datagram, and unblock a bit later
+    if (self->blocked) {
+        ++self->push_back_count;
+        GG_Timer_Schedule(self->unblock_timer, GG_CAST(self, GG_TimerListener), 1);
+        return GG_ERROR_WOULD_BLOCK;
+    }
+    self->blocked = true;
+
+    LONGS_EQUAL(1, GG_Buffer_GetDataSize(data));
+    if (GG_Buffer_GetData(data)[0] != (uint8_t)self->received_count) {
+        self->in_order = false;
+    }
+    if (++self->received_count == self->expected_count) {
+        GG_Loop_RequestTermination(self->loop);
+    }
+
+    return GG_SUCCESS;
+}
+
+static GG_Result
+PushBackSink_SetListener(GG_DataSink* _self, GG_DataSinkListener* listener)
+{
+    PushBackSink* self = GG_SELF(PushBackSink, GG_DataSink);
+
+    self->listener = listener;
+
+    return GG_SUCCESS;
+}
+
+static void
+PushBackSink_OnTimerFired(GG_TimerListener* _self, GG_Timer* timer, uint32_t actual_ms_elapsed)
+{
+    PushBackSink* self = GG_SELF(PushBackSink, GG_TimerListener);
+    GG_COMPILER_UNUSED(timer);
+    GG_COMPILER_UNUSED(actual_ms_elapsed);
+
+    self->blocked = false;
+    if (self->listener) {
+        GG_DataSinkListener_OnCanPut(self->listener);
+    }
+}
+
+GG_IMPLEMENT_INTERFACE(PushBackSink, GG_DataSink) {
+    .PutData     = PushBackSink_PutData,
+    .SetListener = PushBackSink_SetListener
+};
+
+GG_IMPLEMENT_INTERFACE(PushBackSink, GG_TimerListener) {
+    .OnTimerFired = PushBackSink_OnTimerFired
+};
+
+//----------------------------------------------------------------------
+// Check that datagrams pushed back by the sink are held by the socket and
+// delivered, in order, once the sink can accept data again.
+//----------------------------------------------------------------------
+TEST(GG_SOCKETS, Test_DatagramSinkPushBack) {
+    GG_Loop* loop = NULL;
+    GG_Result result = GG_Loop_Create(&loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a server socket bound to a free port
+    GG_DatagramSocket* server = NULL;
+    GG_SocketAddress server_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    GG_IpAddress_SetFromInteger(&server_address.address, 0x7F000001);
+    for (server_address.port = 2000; server_address.port <= 60000; server_address.port++) {
+        result = GG_BsdDatagramSocket_Create(&server_address, NULL, false, 1024, &server);
+        if (GG_SUCCEEDED(result)) {
+            break;
+        }
+    }
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // create a client socket that sends to the server
+    GG_DatagramSocket* client = NULL;
+    result = GG_BsdDatagramSocket_Create(NULL, &server_address, false, 1024, &client);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    result = GG_DatagramSocket_Attach(server, loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    result = GG_DatagramSocket_Attach(client, loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // the server's sink pushes back after each datagram
+    const unsigned int datagram_count = 20;
+    PushBackSink sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.loop           = loop;
+    sink.expected_count = datagram_count;
+    sink.in_order       = true;
+    GG_SET_INTERFACE(&sink, PushBackSink, GG_DataSink);
+    GG_SET_INTERFACE(&sink, PushBackSink, GG_TimerListener);
+    result = GG_TimerScheduler_CreateTimer(GG_Loop_GetTimerScheduler(loop), &sink.unblock_timer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(server), GG_CAST(&sink, GG_DataSink));
+    CHECK_TRUE(sink.listener != NULL);
+
+    // send a burst of datagrams before running the loop, so they are read in batches
+    for (unsigned int i = 0; i < datagram_count; i++) {
+        uint8_t value = (uint8_t)i;
+        GG_StaticBuffer buffer;
+        GG_StaticBuffer_Init(&buffer, &value, 1);
+        result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(client), GG_StaticBuffer_AsBuffer(&buffer), NULL);
+        LONGS_EQUAL(GG_SUCCESS, result);
+    }
+
+    // schedule an exit timer in case something goes wrong
+    ExitTimer timer_handler;
+    timer_handler.loop = loop;
+    GG_SET_INTERFACE(&timer_handler, ExitTimer, GG_TimerListener);
+    GG_Timer* timer = NULL;
+    result = GG_TimerScheduler_CreateTimer(GG_Loop_GetTimerScheduler(loop), &timer);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Timer_Schedule(timer, GG_CAST(&timer_handler, GG_TimerListener), 5000);
+
+    result = GG_Loop_Run(loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // nothing was lost, even though the sink pushed back
+    LONGS_EQUAL(datagram_count, sink.received_count);
+    CHECK_TRUE(sink.in_order);
+    CHECK_TRUE(sink.push_back_count > 0);
+
+    GG_DatagramSocket_Destroy(server);
+    GG_DatagramSocket_Destroy(client);
+    GG_Timer_Destroy(sink.unblock_timer);
+    GG_Timer_Destroy(timer);
+    GG_Loop_Destroy(loop);
+}
@@ -0,0 +1,128 @@
+// Copyright 2017-2020 Fitbit, Inc
+// SPDX-License-Identifier: Apache-2.0
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+
+#include "xp/common/gg_common.h"
+#include "xp/loop/gg_loop.h"
+#include "xp/sockets/gg_sockets.h"
+#include "xp/utils/gg_memory_data_sink.h"
+#include "xp/stack_builder/gg_stack_builder.h"
+#include "xp/nip/gg_nip.h"
+#include "xp/sockets/ports/nip/gg_nip_sockets.h"
+
+//----------------------------------------------------------------------
+TEST_GROUP(GG_NIP_STACK_BUILDER)
+{
+    void setup(void) {
+    }
+
+    void teardown(void) {
+        GG_Nip_Terminate();
+    }
+};
+
+//----------------------------------------------------------------------
+// Stacks without a socket element leave it to the application to create
+// its sockets, which must then go through the stack's network interface.
+//----------------------------------------------------------------------
+TEST(GG_NIP_STACK_BUILDER, Test_NetifGattlinkWithApplicationSocket) {
+    GG_Loop* loop;
+    GG_Result result = GG_Loop_Create(&loop);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    GG_Stack* stack = NULL;
+    result = GG_StackBuilder_BuildStack(GG_STACK_DESCRIPTOR_NETIF_GATTLINK,
+                                        NULL,
+                                        0,
+                                        GG_STACK_ROLE_NODE,
+                                        NULL,
+                                        loop,
+                                        NULL,
+                                        NULL,
+                                        &stack);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_StackIpConfiguration ip_configuration;
+    result = GG_Stack_GetIpConfiguration(stack, &ip_configuration);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // capture what comes out of the bottom of the network interface
+    GG_StackElementInfo netif_info;
+    result = GG_Stack_GetElementByIndex(stack, 0, &netif_info);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    LONGS_EQUAL(GG_STACK_ELEMENT_TYPE_IP_NETWORK_INTERFACE, netif_info.type);
+    GG_StackElementPortInfo netif_bottom;
+    result = GG_Stack_GetPortById(stack, netif_info.id, GG_STACK_PORT_ID_BOTTOM, &netif_bottom);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_MemoryDataSink* netif_sink = NULL;
+    result = GG_MemoryDataSink_Create(&netif_sink);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(netif_bottom.source, GG_MemoryDataSink_AsDataSink(netif_sink));
+
+    // create an application socket, the way an app would for this stack
+    GG_SocketAddress local_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    local_address.port = 5683;
+    GG_SocketAddress remote_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    remote_address.address = ip_configuration.remote_address;
+    remote_address.port    = 5683;
+    GG_DatagramSocket* socket = NULL;
+    result = GG_NipDatagramSocket_Create(&local_address, &remote_address, false, 1024, &socket);
+    LONGS_EQUAL(GG_SUCCESS, result);
+
+    // send through the socket, it should come out of the stack's network interface
+    GG_StaticBuffer payload;
+    GG_StaticBuffer_Init(&payload, (const uint8_t*)"hello", 5);
+    result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(socket), GG_StaticBuffer_AsBuffer(&payload), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* ip_packet_buffer = GG_MemoryDataSink_GetBuffer(netif_sink);
+    LONGS_EQUAL(20 + 8 + 5, GG_Buffer_GetDataSize(ip_packet_buffer));
+    const uint8_t* ip_packet = GG_Buffer_GetData(ip_packet_buffer);
+    MEMCMP_EQUAL(ip_configuration.local_address.ipv4, &ip_packet[12], 4);  // IP src addr
+    MEMCMP_EQUAL(ip_configuration.remote_address.ipv4, &ip_packet[16], 4); // IP dst addr
+    MEMCMP_EQUAL("hello", &ip_packet[28], 5);
+
+    // send from a peer, it should be received by the socket
+    GG_NipStack* peer_stack = NULL;
+    result = GG_NipStack_Create(&ip_configuration.remote_address, &peer_stack);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(peer_stack), netif_bottom.sink);
+    GG_SocketAddress peer_remote_address = GG_SOCKET_ADDRESS_NULL_INITIALIZER;
+    peer_remote_address.address = ip_configuration.local_address;
+    peer_remote_address.port    = 5683;
+    GG_DatagramSocket* peer_socket = NULL;
+    result = GG_NipDatagramSocket_CreateWithStack(peer_stack,
+                                                  &local_address,
+                                                  &peer_remote_address,
+                                                  false,
+                                                  1024,
+                                                  &peer_socket);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_MemoryDataSink* socket_sink = NULL;
+    result = GG_MemoryDataSink_Create(&socket_sink);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket), GG_MemoryDataSink_AsDataSink(socket_sink));
+    result = GG_DataSink_PutData(GG_DatagramSocket_AsDataSink(peer_socket), GG_StaticBuffer_AsBuffer(&payload), NULL);
+    LONGS_EQUAL(GG_SUCCESS, result);
+    GG_Buffer* received = GG_MemoryDataSink_GetBuffer(socket_sink);
+    LONGS_EQUAL(5, GG_Buffer_GetDataSize(received));
+    MEMCMP_EQUAL("hello", GG_Buffer_GetData(received), 5);
+
+    // cleanup
+    GG_DataSource_SetDataSink(GG_DatagramSocket_AsDataSource(socket), NULL);
+    GG_DataSource_SetDataSink(GG_NipStack_AsDataSource(peer_stack), NULL);
+    GG_DatagramSocket_Destroy(peer_socket);
+    GG_DatagramSocket_Destroy(socket);
+    GG_NipStack_Destroy(peer_stack);
+    GG_Stack_Destroy(stack);
+    GG_MemoryDataSink_Destroy(socket_sink);
+    GG_MemoryDataSink_Destroy(netif_sink);
+    GG_Loop_Destroy(loop);
+}